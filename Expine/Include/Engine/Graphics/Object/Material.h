@@ -2,12 +2,23 @@
 
 namespace D3D
 {
+	struct ShaderTextureInfo;
+
 	enum EBlendMode
 	{
 		BlendNone,
 		BlendMasked
 	};
 
+	// Textures a static material provides to the static mesh pipeline.
+
+	enum EMaterialTexture
+	{
+		MaterialTextureDiffuse,
+		MaterialTextureNormal,
+		NumMaterialTextures
+	};
+
 	struct KMaterialExpression
 	{
 
@@ -68,6 +79,16 @@ namespace D3D
 		{}
 
 		virtual void FreeComponents() = 0;
+
+		// NULL when the material does not sample the texture.
+
+		virtual const ShaderTextureInfo * GetTexture
+		(
+			const EMaterialTexture Texture
+		)	const
+		{
+			return NULL;
+		}
 	};
 
 	class CMaterialLab
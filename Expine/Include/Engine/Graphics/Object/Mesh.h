@@ -2,6 +2,8 @@
 
 #include "Material.h"
 
+#include "Utils/Container/StringTable.h"
+
 namespace D3D
 {
 	struct KMesh
@@ -67,6 +69,18 @@ namespace D3D
 			return Map.at(CreateIndex(LodIdx, SectionIdx));
 		}
 
+		const KMeshSectionInfo * Find(Int32 LodIdx, Int32 SectionIdx) const
+		{
+			auto Iter = Map.find(CreateIndex(LodIdx, SectionIdx));
+
+			if (Iter == Map.end())
+			{
+				return NULL;
+			}
+
+			return &Iter->second;
+		}
+
 		KMeshSectionInfo & Get(Int32 LodIdx, Int32 SectionIdx)
 		{
 			return Map.at(CreateIndex(LodIdx, SectionIdx));
@@ -86,16 +100,27 @@ namespace D3D
 	{
 	private:
 
-		TMap<String, KStaticMesh*> MeshMap;
+		// Ids are interned, lookups compare indices and stored keys never dangle.
+
+		THashMap<InternedString, KStaticMesh*> MeshMap;
 
 	public:
 
 		inline KStaticMesh * FindMesh
 		(
-			const String& MeshId
+			const StringView & MeshId
 		)
 		{
-			KStaticMesh ** Mesh = MeshMap.Find(MeshId);
+			InternedString Key;
+
+			// An id that was never interned cannot be in the map.
+
+			if (!InternedString::Find(MeshId, Key))
+			{
+				return nullptr;
+			}
+
+			KStaticMesh ** Mesh = MeshMap.Find(Key);
 
 			if (Mesh)
 			{
@@ -107,21 +132,21 @@ namespace D3D
 
 		inline void AddMesh
 		(
-			const String & Id,
+			const StringView & Id,
 			KStaticMesh * Mesh
 		)
 		{
-			MeshMap.insert_or_assign(Id, Mesh);
+			MeshMap.insert_or_assign(InternedString(Id), Mesh);
 		}
 
 		template <class... Args>
 		inline void AddMesh
 		(
-			const String & Id,
+			const StringView & Id,
 			const Args&&... Arguments
 		)
 		{
-			MeshMap.insert_or_assign(Id, new KStaticMesh(std::forward<Args>(Arguments)...));
+			MeshMap.insert_or_assign(InternedString(Id), new KStaticMesh(std::forward<Args>(Arguments)...));
 		}
 	};
 }
\ No newline at end of file
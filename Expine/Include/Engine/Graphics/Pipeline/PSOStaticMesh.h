@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Raw/RawCommandList.h"
+#include "Raw/RawPipelineState.h"
+
+namespace D3D
+{
+	namespace Pipelines
+	{
+		namespace StaticMesh
+		{
+			// Vertex buffer slots, geometry is shared and instances step per draw instance.
+
+			enum EInputSlots
+			{
+				SlotGeometry,
+				SlotInstances
+			};
+
+			// Root constant telling the pixel shader which material textures are bound.
+
+			enum EMaterialFlags
+			{
+				MaterialDiffuse	= 1,
+				MaterialNormal	= 2,
+				MaterialMasked	= 4
+			};
+
+			class PipelineGeometry : public CSingleton<PipelineGeometry>, public PipelineObject<PipelineGeometry>
+			{
+			public:
+
+				enum ERootParameters
+				{
+					SceneConstants,
+					MaterialTextures,
+					MaterialConstants,
+					NumRootParameters
+				};
+
+			private:
+
+				bool Available = false;
+
+				virtual ErrorCode CreateRootSignature() override;
+				virtual ErrorCode CreatePipelineState() override;
+
+			public:
+
+				virtual ErrorCode Initialize() override;
+
+				// False when the shaders failed to compile, static meshes are not drawn then.
+
+				inline bool IsAvailable() const
+				{
+					return Available;
+				}
+
+				virtual inline void Apply
+				(
+					RGrpCommandList * CmdList
+				)	const
+				{
+					CmdList->ApplyPipelineState(PipelineState);
+					CmdList->SetCommandSignature(CommandSignature);
+				}
+			};
+		}
+	}
+}
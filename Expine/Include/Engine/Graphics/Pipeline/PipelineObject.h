@@ -3,6 +3,8 @@
 #include <Smart.h>
 #include "DirectX/D3D.h"
 
+#include <Utils/Shader/CompileScheduler.h>
+
 namespace D3D
 {
 	class RGrpCommandList;
@@ -66,52 +68,59 @@ namespace D3D
 	class PipelineObject : public PipelineObjectBase
 	{};
 
-	template
-	<
-		class Child
-	>
-	PipelineObject<Child> * NewPipelineObject()
+	// Pipeline state created by CreateVariation, applied like the pipeline it was derived from.
+
+	class PipelineVariation : public PipelineObjectBase
 	{
-		return new PipelineObject<Child>();
-	}
+	public:
+
+		virtual void Apply
+		(
+			RGrpCommandList * CmdList
+		)	const override;
+	};
 
 	class ShaderDefinition
 	{
 	private:
 
-		TSet<UINT32>	HashValues;
-		UINT32			Hash;
-		UINT32			HashName;
-		UINT32			HashDefinition;
-		String			NameDefinition;
-
-	public:
-
-		inline UINT32 GetHash() const
-		{
-			return Hash ^ HashName;
-		}
+		String			Name;
+		TVector<String>	Values;
+		size_t			Selected = 0;
 
 	public:
 
 		ShaderDefinition
 		(
-			const String			& Name,
-			const THashSet<String>	& Values
+			const String			& DefinitionName,
+			const THashSet<String>	& DefinitionValues
 		) :
-			NameDefinition(Name)
+			Name(DefinitionName),
+			Values(DefinitionValues.begin(), DefinitionValues.end())
 		{
-			for (const String & Val : Values)
-			{
-				HashValues.emplace(std::hash<String>()(Val));
-			}
+			// Indices stay the same however the set was filled.
 
-			HashName = std::hash<String>()(Name);
+			std::sort(Values.begin(), Values.end());
 		}
 
 		inline void operator=(const UINT Index)
 		{
-			Hash = *HashValues.find(Index);
+			Selected = Index < Values.size() ? Index : 0;
+		}
+
+		inline const String & GetName() const
+		{
+			return Name;
+		}
+
+		inline const TVector<String> & GetValues() const
+		{
+			return Values;
+		}
+
+		inline const String & GetValue() const
+		{
+			return Values[Selected];
 		}
 	};
 
@@ -129,22 +138,73 @@ namespace D3D
 			const THashSet<String>	& Values
 		)
 		{
-			Definitions.emplace_back(Name, Values);
+			if (!Values.empty())
+			{
+				Definitions.emplace_back(Name, Values);
+			}
+		}
+
+		inline ShaderDefinition * FindDefinition
+		(
+			const String & Name
+		)
+		{
+			for (ShaderDefinition & Definition : Definitions)
+			{
+				if (Definition.GetName() == Name)
+				{
+					return &Definition;
+				}
+			}
+
+			return NULL;
 		}
 
-		inline size_t GetHash() const
+		// The selected value of every definition.
+
+		inline TVector<ShaderCache::ShaderDefine> GetDefines() const
 		{
-			size_t Hash = 0;
+			TVector<ShaderCache::ShaderDefine> Defines;
 
 			for (const ShaderDefinition & Definition : Definitions)
 			{
-				Hash ^= Definition.GetHash();
+				Defines.push_back({ Definition.GetName(), Definition.GetValue() });
 			}
 
-			return Hash;
+			return Defines;
+		}
+
+		inline TVector<ShaderCache::PermutationAxis> GetAxes() const
+		{
+			TVector<ShaderCache::PermutationAxis> Axes;
+
+			for (const ShaderDefinition & Definition : Definitions)
+			{
+				Axes.push_back({ Definition.GetName(), Definition.GetValues() });
+			}
+
+			return Axes;
+		}
+
+		inline Uint64 GetHash() const
+		{
+			return ShaderCache::HashShaderDefines(GetDefines());
 		}
 	};
 
+	/************************************************************
+	*
+	*	Pipeline variations over every value combination of the
+	*	definition map. SchedulePermutations compiles their
+	*	shaders in the background, Update creates the pipelines
+	*	once all shaders of a permutation are in the cache and
+	*	GetPipeline hands out the default pipeline until then.
+	*
+	*	The members are defined in PipelineObject.cpp, which
+	*	instantiates them for every pipeline using them.
+	*
+	************************************************************/
+
 	template
 	<
 		class Child
@@ -153,8 +213,20 @@ namespace D3D
 	{
 	protected:
 
-		SharedPointer<PipelineObject<Child> >					Default;
-		TMap<size_t, SharedPointer<PipelineObject<Child> > >	Permutations;
+		struct PendingPermutation
+		{
+			TVector<ShaderCache::ShaderDefine>	Defines;
+
+			// Key hashes of the scheduled shader compiles.
+
+			TVector<Uint64>						Shaders;
+		};
+
+		// Not owned, the default pipeline usually is a singleton itself.
+
+		PipelineObject<Child>								*	Default;
+		TMap<Uint64, SharedPointer<PipelineVariation> >			Permutations;
+		THashMap<Uint64, PendingPermutation>					Pending;
 		ShaderDefinitionValueMap								DefinitionValueMap;
 
 	public:
@@ -176,12 +248,21 @@ namespace D3D
 			PipelineObject<Child> * DefaultObject
 		);
 
+		// Creates the permutation right away, compiling on the calling thread when its shaders are not cached.
+
 		ErrorCode AddPermutation
 		(
-			TArray<ShaderMacro*, 6>	Macros
+			const TVector<ShaderCache::ShaderDefine> & Defines
 		);
 
-		PipelineObject<Child> * GetPipeline
+		ErrorCode SchedulePermutations
+		(
+			const Int32 Priority = ShaderCache::CompilePriorityBackground
+		);
+
+		ErrorCode Update();
+
+		PipelineObjectBase * GetPipeline
 		(
 			const ShaderDefinitionValueMap & Definitions
 		)	const;
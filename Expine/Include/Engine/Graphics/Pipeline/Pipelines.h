@@ -407,5 +407,9 @@ namespace D3D
 		}
 
 		extern ErrorCode InitializePipelines();
+
+		// Creates the pipeline permutations whose shaders finished compiling.
+
+		extern ErrorCode UpdatePipelines();
 	}
 }
\ No newline at end of file
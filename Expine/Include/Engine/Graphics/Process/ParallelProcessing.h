@@ -1,8 +1,8 @@
 #pragma once
 
 #include "ParallelProcessingMesh.h"
+#include "ParallelProcessingGraph.h"
 
-#include <tbb/reader_writer_lock.h>
 #include <tbb/concurrent_priority_queue.h>
 #include <tbb/parallel_do.h>
 
@@ -60,7 +60,6 @@ namespace D3D
 
 		//std::vector<IParallelProcessingUnit*> ProcessingUnits;
 		tbb::concurrent_priority_queue<IParallelProcessingUnit*, CParallelProcessingRelevancy<Ordering>> ProcessingUnits;
-		tbb::reader_writer_lock ProcessingRWLock;
 
 	private:
 
@@ -71,9 +70,14 @@ namespace D3D
 
 		void RunImpl()
 		{
-			ProcessingRWLock.lock_read();
-			auto Queue = std::move(ProcessingUnits);
-			ProcessingRWLock.unlock();
+			TVector<IParallelProcessingUnit*> Queue;
+			IParallelProcessingUnit * Unit;
+
+			while (ProcessingUnits.try_pop(Unit))
+			{
+				Queue.push_back(Unit);
+			}
+
 			tbb::parallel_do(Queue.begin(), Queue.end(), Processor);
 		}
 
@@ -84,10 +88,7 @@ namespace D3D
 			IParallelProcessingUnit * Unit
 		)	override
 		{
-			tbb::reader_writer_lock::scoped_lock Lock(ProcessingRWLock);
-			{
-				ProcessingUnits.push(Unit);
-			}
+			ProcessingUnits.push(Unit);
 		}
 
 		virtual void RunProcessing() override
@@ -101,26 +102,47 @@ namespace D3D
 
 	};
 
-	class CParallelProcessPrerequisite
+	class CParallelProcessManager : public CSingleton<CParallelProcessManager>, public IParallelProcessListener
 	{
 	private:
-		TSet<IParallelProcessingUnit> PrerequisitedProcesses;
-	};
+		CParallelProcessGraph ProcessGraph;
 
-	class CParallelProcessManager : public CSingleton<CParallelProcessManager>
-	{
-	private:
-		CParallelMeshProcess ProcessMesh;
+		TMutex ProcessedUnitsMutex;
+		TVector<IParallelProcessingUnit*> ProcessedUnits;
 
 	protected:
-		void OnProcessingUnitFinish(IParallelProcessingUnit * Unit);
-		void OnProcessingUnitAbort(IParallelProcessingUnit * Unit);
+		virtual void OnProcessingUnitFinish(IParallelProcessingUnit * Unit) override;
+		virtual void OnProcessingUnitAbort(IParallelProcessingUnit * Unit) override;
 
 	public:
-		template<typename T>
-		inline typename std::enable_if<std::is_same<T, CMeshAttributeProcessor>::value > AddProcessingUnit(T * Unit)
+		CParallelProcessManager();
+		~CParallelProcessManager();
+
+		// The manager takes ownership of its units, they are released after RunProcessing.
+
+		inline void AddProcessingUnit
+		(
+					IParallelProcessingUnit			* Unit,
+			const	CParallelProcessPrerequisite	& Prerequisites = CParallelProcessPrerequisite()
+		)
+		{
+			ProcessGraph.AddProcessingUnit(Unit, Prerequisites);
+		}
+
+		inline void SetStageConcurrency
+		(
+			const EProcessingStage	Stage,
+			const Uint32			MaxConcurrency
+		)
 		{
-			ProcessMesh.AddProcessingUnit(Unit);
+			ProcessGraph.SetStageConcurrency(Stage, MaxConcurrency);
 		}
+
+		inline void Cancel()
+		{
+			ProcessGraph.Cancel();
+		}
+
+		void RunProcessing();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "ParallelProcessingUnit.h"
+
+#include <tbb/task_group.h>
+
+namespace D3D
+{
+	class CParallelProcessPrerequisite
+	{
+	private:
+
+		TVector<IParallelProcessingUnit*> PrerequisitedProcesses;
+
+	public:
+
+		CParallelProcessPrerequisite() = default;
+		CParallelProcessPrerequisite
+		(
+			std::initializer_list<IParallelProcessingUnit*> Units
+		) :
+			PrerequisitedProcesses(Units)
+		{}
+
+		inline void Add
+		(
+			IParallelProcessingUnit * Unit
+		)
+		{
+			PrerequisitedProcesses.push_back(Unit);
+		}
+
+		inline const TVector<IParallelProcessingUnit*> & GetUnits() const
+		{
+			return PrerequisitedProcesses;
+		}
+	};
+
+	class IParallelProcessListener
+	{
+	public:
+
+		virtual void OnProcessingUnitFinish
+		(
+			IParallelProcessingUnit * Unit
+		) = 0;
+
+		virtual void OnProcessingUnitAbort
+		(
+			IParallelProcessingUnit * Unit
+		) = 0;
+	};
+
+	/************************************************************
+	*
+	*	Runs processing units once all of their prerequisites
+	*	have finished. Ready units are dispatched by priority
+	*	within their stage, and each stage may limit how many
+	*	of its units run at the same time. Units whose
+	*	prerequisites were aborted or which are still pending
+	*	on cancellation are aborted as well.
+	*
+	************************************************************/
+
+	class CParallelProcessGraph
+	{
+	public:
+
+		static constexpr Uint32 UnlimitedConcurrency = static_cast<Uint32>(-1);
+
+	private:
+
+		enum ENodeState
+		{
+			NodePending,
+			NodeReady,
+			NodeRunning,
+			NodeFinished,
+			NodeAborted
+		};
+
+		struct Node
+		{
+			IParallelProcessingUnit *	Unit;
+			Uint32						Stage;
+			Uint32						NumPending = 0;
+			bool						PrerequisiteAborted = false;
+			ENodeState					State = NodePending;
+			TVector<Node*>				Dependents;
+		};
+
+		struct NodeRelevancy
+		{
+			inline bool operator()
+			(
+				const Node * Lhs,
+				const Node * Rhs
+			)	const
+			{
+				return Lhs->Unit->GetPriority() < Rhs->Unit->GetPriority();
+			}
+		};
+
+		struct Stage
+		{
+			Uint32									MaxConcurrency = UnlimitedConcurrency;
+			Uint32									NumRunning = 0;
+			TPriorityQueue<Node*, NodeRelevancy>	Ready;
+		};
+
+	private:
+
+		TMutex										GraphMutex;
+		TVector<TUniquePtr<Node> >					Nodes;
+		THashMap<IParallelProcessingUnit*, Node*>	NodeMap;
+		TArray<Stage, ProcessingStageCount>			Stages;
+
+		TAtomic<bool>								Cancelled;
+		Uint32										NumOutstanding = 0;
+		bool										Running = false;
+
+		tbb::task_group								Tasks;
+		IParallelProcessListener *					Listener = NULL;
+
+	private:
+
+		void Execute
+		(
+			Node * Target
+		);
+
+		// Both expect GraphMutex to be held and collect nodes whose
+		// callbacks have to be invoked once it has been released.
+
+		void Complete
+		(
+			Node			*	Target,
+			const bool			Aborted,
+			TVector<Node*>	&	Aborts
+		);
+
+		void Dispatch
+		(
+			TVector<Node*> & Aborts
+		);
+
+		void NotifyAborts
+		(
+			const TVector<Node*> & Aborts
+		);
+
+	public:
+
+		CParallelProcessGraph();
+
+		inline void SetListener
+		(
+			IParallelProcessListener * Listener
+		)
+		{
+			this->Listener = Listener;
+		}
+
+		void SetStageConcurrency
+		(
+			const EProcessingStage	Stage,
+			const Uint32			MaxConcurrency
+		);
+
+		// May be called while the graph is running. Prerequisites that are
+		// not part of the graph or have already finished are ignored.
+
+		void AddProcessingUnit
+		(
+					IParallelProcessingUnit			* Unit,
+			const	CParallelProcessPrerequisite	& Prerequisites = CParallelProcessPrerequisite()
+		);
+
+		// Blocks until all units have finished or were aborted, then clears the graph.
+
+		void Run();
+
+		void Cancel();
+
+		inline bool IsCancelled() const
+		{
+			return Cancelled.load(std::memory_order_relaxed);
+		}
+	};
+}
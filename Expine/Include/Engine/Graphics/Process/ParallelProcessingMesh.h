@@ -172,6 +172,11 @@ namespace D3D
 			return 1;
 		}
 
+		virtual EProcessingStage GetStage() const override
+		{
+			return ProcessingStageTangents;
+		}
+
 		virtual void Process(int32_t N) override
 		{
 			if (Source->BuildSettings.GenerateLightmapUVs)
@@ -4,9 +4,28 @@
 
 namespace D3D
 {
+	enum EProcessingStage
+	{
+		ProcessingStageGeneric,
+		ProcessingStageImport,
+		ProcessingStageWeld,
+		ProcessingStageTangents,
+		ProcessingStageLod,
+		ProcessingStageCook,
+		ProcessingStageUpload,
+		ProcessingStageCount
+	};
+
 	class IParallelProcessingUnit
 	{
 	public:
+		virtual ~IParallelProcessingUnit() = default;
+
+		virtual EProcessingStage GetStage() const
+		{
+			return ProcessingStageGeneric;
+		}
+
 		virtual void Process
 		(
 			int32_t N
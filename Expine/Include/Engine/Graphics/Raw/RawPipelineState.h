@@ -4,6 +4,8 @@
 #include "Raw/RawShader.h"
 #include "Raw/RawRootSignature.h"
 
+#include <Utils/Shader/PipelineCache.h>
+
 namespace D3D
 {
 	enum ShaderType
@@ -108,6 +110,48 @@ namespace D3D
 		SharedPointer<CGrpShader>			ShaderGroup;
 		UniquePointer<InitializeOptions>	InitOptions;
 		ComPointer<IPipelineState>			PipelineState;
+		PipelineCache::Hash128				CacheKey;
+
+	private:
+
+		ErrorCode CreateCached
+		(
+			InitializeOptionsGraphics * Options
+		);
+
+		ErrorCode CreateCached
+		(
+			InitializeOptionsCompute * Options
+		);
+
+	public:
+
+		inline const PipelineCache::Hash128 & GetCacheKey() const
+		{
+			return CacheKey;
+		}
+
+	public:
+
+		// Loads the pipeline blobs stored for this adapter and driver, call before the first pipeline is created.
+
+		static ErrorCode InitializeCache
+		(
+			IUnknown * const pAdapter
+		);
+
+		// With UsedOnly pipelines not created during this run are dropped from the file, call it that way at shutdown.
+
+		static bool SaveCache
+		(
+			const bool UsedOnly = false
+		);
+
+		// Writes the hit and miss counts of this run to the log.
+
+		static void LogCacheStats();
+
+		static PipelineCache::PipelineCacheStats GetCacheStats();
 
 	public:
 
@@ -14,8 +14,17 @@ namespace D3D
 
 		D3D12_ROOT_SIGNATURE_DESC SignatureDesc;
 
+		// Content hash of the serialized signature, part of pipeline cache keys.
+
+		Uint64 Hash = 0;
+
 	public:
 
+		inline Uint64 GetHash() const
+		{
+			return Hash;
+		}
+
 		inline IRootSignature * operator ->() const
 		{
 			return RootSignature.Get();
@@ -3,6 +3,8 @@
 #include "DirectX/D3D.h"
 #include "Pipeline/PipelineObject.h"
 
+#include <Utils/Shader/ShaderCache.h>
+
 namespace D3D
 {
 	class RShader
@@ -24,6 +26,10 @@ namespace D3D
 		String							EntryPoint;
 		String							Target;
 
+		// Registry key, hashes path, entry point, target and macros.
+
+		Uint64							KeyHash = 0;
+
 	private:
 
 		TVector<ConstPointer<PipelineObjectBase> > ConnectedObjects;
@@ -73,17 +79,76 @@ namespace D3D
 			return IncludeHandler;
 		}
 
-	protected:
+		inline Uint64 GetKeyHash() const
+		{
+			return KeyHash;
+		}
 
-		ErrorCode ReCompileShader();
-		ErrorCode CompileShader
+		static ShaderCache::ShaderKey GetShaderKey
 		(
-			const	WString					& Directory,
-			const	WString					& Filename,
+			const	WString					& PathFull,
 			const	String					& EntryPoint,
 			const	String					& Target,
-			const	TVector<ShaderMacro>	& Macros,
-					ID3DInclude				* Includes = NULL
+			const	TVector<ShaderMacro>	& Macros
+		);
+
+		ShaderCache::ShaderKey GetShaderKey() const;
+
+		// Safe to use from several threads. Without a handler includes are read relative to the source.
+
+		static std::shared_ptr<ShaderCache::IShaderCompiler> CreateCompiler
+		(
+			const	WString		& PathFull,
+					ID3DInclude	* Includes = NULL
+		);
+
+	protected:
+
+		ErrorCode ReCompileShader
+		(
+			ShaderCache::CShaderCache & Cache
+		);
+
+		// Takes over a finished compile and recreates the connected pipeline states.
+
+		ErrorCode ReloadShader
+		(
+			const ShaderCache::ShaderCompileOutput	& Output,
+			const bool								  Compiled
+		);
+
+		ErrorCode ApplyCompileOutput
+		(
+			const ShaderCache::ShaderCompileOutput	& Output,
+			const bool								  Compiled
+		);
+
+		// Describes the shader without compiling it, the bytecode is applied later.
+
+		void SetSource
+		(
+			const	WString						& Directory,
+			const	WString						& Filename,
+			const	String						& EntryPoint,
+			const	String						& Target,
+			const	TVector<ShaderMacro>		& Macros,
+					ID3DInclude					* Includes = NULL
+		);
+
+		ErrorCode CompileShader
+		(
+					ShaderCache::CShaderCache	& Cache,
+			const	WString						& Directory,
+			const	WString						& Filename,
+			const	String						& EntryPoint,
+			const	String						& Target,
+			const	TVector<ShaderMacro>		& Macros,
+					ID3DInclude					* Includes = NULL
+		);
+
+		ErrorCode CompileCached
+		(
+			ShaderCache::CShaderCache & Cache
 		);
 
 		ErrorCode LoadShader
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "ResourceAllocator.h"
+
+#include <tbb/task_arena.h>
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+namespace D3D
+{
+	struct ResourceStreamRequest;
+	struct ResourceStreamResult;
+
+	/************************************************************
+	*
+	*	View over the data of one request, either a chain of
+	*	pooled read blocks or the output of a processor.
+	*
+	************************************************************/
+
+	class ResourceStreamData
+	{
+	private:
+
+		TVector<TPair<const Byte*, size_t> > Spans;
+
+		size_t Size = 0;
+
+	public:
+
+		inline void Add
+		(
+			const Byte *	Data,
+			const size_t	DataSize
+		)
+		{
+			Spans.emplace_back(Data, DataSize);
+			Size += DataSize;
+		}
+
+		inline size_t GetSize() const
+		{
+			return Size;
+		}
+
+		inline size_t GetNumSpans() const
+		{
+			return Spans.size();
+		}
+
+		inline const TPair<const Byte*, size_t> & GetSpan
+		(
+			const size_t Index
+		)	const
+		{
+			return Spans[Index];
+		}
+
+		inline void CopyTo
+		(
+			Byte * Destination
+		)	const
+		{
+			for (const auto & Span : Spans)
+			{
+				std::memcpy(Destination, Span.first, Span.second);
+				Destination += Span.second;
+			}
+		}
+	};
+
+	class IResourceStreamProcessor
+	{
+	public:
+
+		// Runs on a worker thread.
+
+		virtual ErrorCode Process
+		(
+			const	ResourceStreamRequest	& Request,
+			const	ResourceStreamData		& Input,
+					TVector<Byte>			& Output
+		) = 0;
+	};
+
+	class IResourceStreamSink
+	{
+	public:
+
+		// May be called from several workers at once.
+
+		virtual ErrorCode Stage
+		(
+			const	ResourceStreamRequest	& Request,
+			const	ResourceStreamData		& Data,
+					ResourceStreamResult	& Result
+		) = 0;
+	};
+
+	struct ResourceStreamRequest
+	{
+		WString						Path;
+		Uint64						Offset		= 0;
+		Uint64						Size		= 0;
+		Uint64						Alignment	= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+		IResourceStreamProcessor *	Processor	= NULL;
+
+		std::function<void(const ResourceStreamResult&)> OnComplete;
+	};
+
+	struct ResourceStreamResult
+	{
+		ErrorCode					Status = E_FAIL;
+		Uint64						SizeRead = 0;
+		Uint64						SizeStaged = 0;
+
+		SharedPointer<RResource>	Resource;
+		Uint64						ResourceOffset = 0;
+	};
+
+	/************************************************************
+	*
+	*	Sinks
+	*
+	************************************************************/
+
+	class CResourceStreamSinkNull : public IResourceStreamSink
+	{
+	private:
+
+		TAtomic<Uint64> BytesStaged;
+
+	public:
+
+		CResourceStreamSinkNull() :
+			BytesStaged(0)
+		{}
+
+		inline Uint64 GetBytesStaged() const
+		{
+			return BytesStaged.load();
+		}
+
+		virtual ErrorCode Stage
+		(
+			const	ResourceStreamRequest	& Request,
+			const	ResourceStreamData		& Data,
+					ResourceStreamResult	& Result
+		)	override;
+	};
+
+	class CResourceStreamSinkUpload : public IResourceStreamSink
+	{
+	private:
+
+		TMutex				Mutex;
+		CResourceAllocator	Allocator;
+
+	public:
+
+		CResourceStreamSinkUpload() :
+			Allocator(PageGenericRead)
+		{}
+
+		// Pages may be reused once the GPU has passed the fence value.
+
+		void DiscardPages
+		(
+			const UINT64 FenceValue
+		);
+
+		virtual ErrorCode Stage
+		(
+			const	ResourceStreamRequest	& Request,
+			const	ResourceStreamData		& Data,
+					ResourceStreamResult	& Result
+		)	override;
+	};
+
+	/************************************************************
+	*
+	*	Fixed size read blocks. The pool size is the in-flight
+	*	byte budget of the stream, readers wait for blocks to be
+	*	returned once it is exhausted.
+	*
+	************************************************************/
+
+	class CResourceStreamBufferPool
+	{
+	private:
+
+		TMutex						Mutex;
+		std::condition_variable		Available;
+
+		TVector<TUniquePtr<Byte[]> >	Blocks;
+		TVector<Byte*>					FreeBlocks;
+
+		size_t BlockSize = 0;
+
+	public:
+
+		void Initialize
+		(
+			const size_t BlockSize,
+			const size_t NumBlocks
+		);
+
+		inline size_t GetBlockSize() const
+		{
+			return BlockSize;
+		}
+
+		inline size_t GetNumBlocks() const
+		{
+			return Blocks.size();
+		}
+
+		Byte * Acquire();
+
+		void Release
+		(
+			Byte * Block
+		);
+
+		size_t GetNumFreeBlocks();
+	};
+
+	/************************************************************
+	*
+	*	Reads requests on a dedicated I/O thread into pooled
+	*	blocks, processes them on workers and hands the result
+	*	to the sink. Reading stalls while the budget is in use.
+	*	Completions are reported in the order of Enqueue, jobs
+	*	finishing early wait for their predecessors.
+	*
+	************************************************************/
+
+	class CResourceStream
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			Uint64					BudgetBytes	= 64ULL << 20;
+			Uint64					BlockSize	= 256ULL << 10;
+			IResourceStreamSink *	Sink		= NULL;
+		};
+
+	private:
+
+		struct Job
+		{
+			ResourceStreamRequest	Request;
+			ResourceStreamResult	Result;
+			TVector<Byte*>			Blocks;
+			Uint64					Sequence = 0;
+		};
+
+	private:
+
+		CResourceStreamBufferPool	BufferPool;
+		IResourceStreamSink *		Sink = NULL;
+
+		TMutex						QueueMutex;
+		std::condition_variable		QueueSignal;
+		std::condition_variable		IdleSignal;
+		TQueue<TUniquePtr<Job> >	Queue;
+
+		Uint32						NumPending = 0;
+		Uint32						NumProcessing = 0;
+		Uint64						NumEnqueued = 0;
+		bool						Stopping = false;
+
+		// Finished jobs by sequence, only one thread reports at a time.
+
+		TMutex						CompletionMutex;
+		TMap<Uint64, Job*>			Completed;
+		Uint64						NumCompleted = 0;
+		bool						Completing = false;
+
+		TAtomic<Uint64>				BytesInFlight;
+		TAtomic<Uint64>				BytesInFlightPeak;
+
+		std::thread					ReadThread;
+		// Enqueued tasks make progress even without worker threads,
+		// spawned ones would wait for a thread joining the arena.
+
+		tbb::task_arena				Workers;
+
+	private:
+
+		void ReadLoop();
+
+		bool Read
+		(
+			Job & Target
+		);
+
+		void Process
+		(
+			Job * Target
+		);
+
+		void Finish
+		(
+			Job * Target
+		);
+
+		void Complete
+		(
+			Job * Target
+		);
+
+		void ReleaseBlocks
+		(
+			Job & Target
+		);
+
+	public:
+
+		CResourceStream();
+		~CResourceStream();
+
+		ErrorCode Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		void Shutdown();
+
+		void Enqueue
+		(
+			ResourceStreamRequest && Request
+		);
+
+		// Blocks until every enqueued request has completed.
+
+		void Flush();
+
+		inline Uint64 GetBytesInFlight() const
+		{
+			return BytesInFlight.load();
+		}
+
+		inline Uint64 GetBytesInFlightPeak() const
+		{
+			return BytesInFlightPeak.load();
+		}
+	};
+}
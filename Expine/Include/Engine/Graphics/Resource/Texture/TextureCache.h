@@ -0,0 +1,240 @@
+#pragma once
+
+#include "Resource/Texture/TextureResource.h"
+#include "Resource/Texture/TextureStreaming.h"
+#include "Command/CommandList.h"
+
+#include "Utils/Container/StringTable.h"
+
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace D3D
+{
+	struct ShaderTextureInfo
+	{
+		WString								TextureName;
+		WString								TexturePath;
+		DescriptorHeapEntry					HeapEntry;
+		SharedPointer<CTextureResource>		Resource;
+		SharedPointer<RShaderResourceView>	ShaderResource;
+		TextureStreamingHandle				StreamingHandle = InvalidTextureStreamingHandle;
+
+		ShaderTextureInfo() = default;
+		ShaderTextureInfo
+		(
+			const WString				& Name,
+			const WString				& Path,
+			const DescriptorHeapEntry	& Entry,
+			CTextureResource			* pResource
+		);
+	};
+
+	struct TextureCacheStats
+	{
+		Uint64	Hits				= 0;
+		Uint64	Misses				= 0;
+
+		// Requests that found the texture still loading and waited for it.
+
+		Uint64	InFlightHits		= 0;
+		Uint64	Failures			= 0;
+
+		Uint64	LoadMicroseconds	= 0;
+		Uint64	MaxLoadMicroseconds	= 0;
+
+		inline double GetAverageLoadMilliseconds() const
+		{
+			return Misses ? LoadMicroseconds / 1000.0 / Misses : 0.0;
+		}
+	};
+
+	/************************************************************
+	*
+	*	Concurrent map from texture path to its info, split
+	*	into shards with a lock each. Keys are interned paths,
+	*	normalized so that spellings differing in case or
+	*	separators share one entry, and compared as indices.
+	*	Loaders still get the path as first requested.
+	*
+	*	The first request for a path loads it on the
+	*	calling thread, concurrent requests wait on the same
+	*	future instead of loading it again. Failed loads are
+	*	dropped so they can be retried, an exception thrown by
+	*	the loader is passed on to everyone waiting.
+	*
+	************************************************************/
+
+	class CTextureCache
+	{
+	public:
+
+		struct Entry
+		{
+			WString							Path;
+			InternedWString					Key;
+			std::shared_future<ErrorCode>	Ready;
+			std::thread::id					LoadingThread;
+			ShaderTextureInfo				Info;
+		};
+
+		// Fills in the info of a new entry, may run on several threads at once.
+
+		typedef std::function<ErrorCode(const WString & Path, const WString & Name, ShaderTextureInfo & Info)> TLoader;
+
+	private:
+
+		static constexpr Uint32 NumShards = 16;
+
+		struct Shard
+		{
+			mutable TMutex										Mutex;
+			THashMap<InternedWString, SharedPointer<Entry> >	Entries;
+		};
+
+	private:
+
+		Shard			Shards[NumShards];
+
+		TAtomic<Uint64>	Hits;
+		TAtomic<Uint64>	Misses;
+		TAtomic<Uint64>	InFlightHits;
+		TAtomic<Uint64>	Failures;
+		TAtomic<Uint64>	LoadMicroseconds;
+		TAtomic<Uint64>	MaxLoadMicroseconds;
+
+	private:
+
+		Shard & GetShard
+		(
+			const InternedWString & Key
+		)	const;
+
+		SharedPointer<Entry> FindEntry
+		(
+			const InternedWString & Key
+		)	const;
+
+		static bool IsReady
+		(
+			const Entry & Item
+		);
+
+		// Ready without an error, never throws.
+
+		static bool IsLoaded
+		(
+			const Entry & Item
+		);
+
+	public:
+
+		CTextureCache();
+
+		// Returns the entry for the path, loading it on this thread if it
+		// is not cached yet. Wait on Ready before reading the info.
+
+		SharedPointer<Entry> Acquire
+		(
+			const WStringView	& Path,
+			const WStringView	& Name,
+			const TLoader		& Loader
+		);
+
+		ErrorCode GetOrLoad
+		(
+			const WStringView		& Path,
+			const WStringView		& Name,
+				  ShaderTextureInfo	& Info,
+			const TLoader			& Loader
+		);
+
+		// Loads every path not cached yet in parallel and waits for all of
+		// them, returns the first error. Names default to the paths.
+
+		ErrorCode Prefetch
+		(
+			const TVector<WString>	& Paths,
+			const TVector<WString>	& Names,
+			const TLoader			& Loader
+		);
+
+		// Copies the info of a loaded texture, false while missing or still loading.
+
+		bool Find
+		(
+			const WStringView		& Path,
+				  ShaderTextureInfo	& Info
+		)	const;
+
+		bool Contains
+		(
+			const WStringView & Path
+		)	const;
+
+		// Runs the callback on the info under the shard lock, inserting an
+		// empty entry first if there is none. Waits for a pending load
+		// unless called from the loading thread itself.
+
+		template<class Function> bool Modify
+		(
+			const WStringView	& Path,
+				  Function		&& Callback
+		);
+
+		TextureCacheStats GetStats() const;
+
+		size_t GetSize() const;
+	};
+
+	template<class Function> bool CTextureCache::Modify(const WStringView & Path, Function && Callback)
+	{
+		const InternedWString Key = InternedWString::FromPath(Path);
+
+		Shard & Target = GetShard(Key);
+
+		std::unique_lock<TMutex> Lock(Target.Mutex);
+
+		auto Iter = Target.Entries.find(Key);
+
+		if (Iter != Target.Entries.end() &&
+			Iter->second->LoadingThread != std::thread::id() &&
+			Iter->second->LoadingThread != std::this_thread::get_id())
+		{
+			SharedPointer<Entry> Pending = Iter->second;
+
+			Lock.unlock();
+			Pending->Ready.wait();
+			Lock.lock();
+
+			Iter = Target.Entries.find(Key);
+		}
+
+		if (Iter != Target.Entries.end())
+		{
+			Callback(Iter.value()->Info, false);
+			return false;
+		}
+
+		SharedPointer<Entry> Item;
+		{
+			Item.Construct();
+		}
+
+		std::promise<ErrorCode> Done;
+		{
+			Done.set_value(S_OK);
+		}
+
+		Item->Path	= WString(Path.begin(), Path.end());
+		Item->Key	= Key;
+		Item->Ready	= Done.get_future().share();
+
+		Callback(Item->Info, true);
+
+		Target.Entries.emplace(Key, Item);
+
+		return true;
+	}
+}
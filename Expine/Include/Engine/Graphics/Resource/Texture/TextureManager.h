@@ -1,34 +1,13 @@
 #pragma once
 
-#include "Resource/Texture/TextureResource.h"
-#include "Command/CommandList.h"
+#include "Resource/Texture/TextureCache.h"
 
 namespace D3D
 {
-	struct ShaderTextureInfo
-	{
-		WString								TextureName;
-		WString								TexturePath;
-		DescriptorHeapEntry					HeapEntry;
-		SharedPointer<CTextureResource>		Resource;
-		SharedPointer<RShaderResourceView>	ShaderResource;
-
-		ShaderTextureInfo() = default;
-		ShaderTextureInfo
-		(
-			const WString				& Name,
-			const WString				& Path,
-			const DescriptorHeapEntry	& Entry,
-			CTextureResource			* pResource
-		);
-	};
-
-	class CTextureManager : public CSingleton<CTextureManager>
+	class CTextureManager : public CSingleton<CTextureManager>, public ITextureStreamingBackend
 	{
 	public:
 
-		typedef THashMap<WStringView, ShaderTextureInfo> TTextures;
-
 		class CTextureInitializationStream
 		{
 			friend class CTextureManager;
@@ -49,7 +28,11 @@ namespace D3D
 
 	private:
 
-		TTextures Textures;
+		CTextureCache Textures;
+
+		// Serializes the use of the command list, descriptor heaps and streamer.
+
+		TMutex LoadMutex;
 
 	protected:
 
@@ -59,11 +42,63 @@ namespace D3D
 
 		UniquePointer<CCPUDescriptorHeapPool> SRVDescriptorHeaps;
 
+	private:
+
+		// Updates a replaced resource is kept alive for, the GPU may still read it.
+
+		static constexpr Uint64 StreamingRetireDelay = 3;
+
+		CTextureStreamer Streamer;
+
+		THashMap<TextureStreamingHandle, WString> StreamedTextures;
+
+		TVector<TPair<Uint64, SharedPointer<CTextureResource> > > RetiredResources;
+
+		Uint64 StreamingFrame = 0;
+
+	private:
+
+		ErrorCode LoadTexture
+		(
+			const WString					& TexturePath,
+			const WString					& TextureName,
+				  ShaderTextureInfo			& Info,
+			CTextureInitializationStream	* Stream
+		);
+
+		CTextureCache::TLoader GetLoader
+		(
+			CTextureInitializationStream * Stream = NULL
+		);
+
+		// Expects the load mutex to be held.
+
+		ErrorCode ReplaceStreamedResource
+		(
+			const TextureStreamingHandle	Handle,
+			const Uint32					FirstMip
+		);
+
+		virtual bool LoadMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		)	override;
+
+		virtual void EvictMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		)	override;
+
 	public:
 
-		const ShaderTextureInfo * GetShaderTextureInfo
+		bool GetShaderTextureInfo
 		(
-			const WStringView & Name
+			const WStringView		& Name,
+				  ShaderTextureInfo	& Info
 		)	const;
 
 	public:
@@ -86,6 +121,19 @@ namespace D3D
 			return AddTexture(TexturePath, TextureName);
 		}
 
+		// Loads all textures in parallel, textures already cached are skipped.
+
+		ErrorCode PrefetchTextures
+		(
+			const TVector<WString> & TexturePaths,
+			const TVector<WString> & TextureNames
+		);
+
+		inline TextureCacheStats GetCacheStats() const
+		{
+			return Textures.GetStats();
+		}
+
 		ErrorCode AddLookupPath
 		(
 			const WStringView & Path
@@ -194,5 +242,43 @@ namespace D3D
 		);
 
 		void FinishExecution();
+
+		// Registers a DDS texture whose mips are loaded on demand. Only the
+		// pinned mips are guaranteed, the resource in the returned info is
+		// replaced as mips stream in while the descriptor stays the same.
+
+		ErrorCode AddStreamedTexture
+		(
+			const WStringView & TexturePath,
+			const WStringView & TextureName,
+			ShaderTextureInfo & Info
+		);
+
+		ErrorCode AddStreamedTexture
+		(
+			const StringView & TexturePath,
+			const StringView & TextureName,
+			ShaderTextureInfo & Info
+		)
+		{
+			return AddStreamedTexture(
+				WString(TexturePath.begin(), TexturePath.end()),
+				WString(TextureName.begin(), TextureName.end()),
+				Info);
+		}
+
+		// Issues loads and evictions, called once per frame after culling.
+
+		void UpdateStreaming();
+
+		void SetStreamingBudget
+		(
+			const Uint64 BudgetBytes
+		);
+
+		inline CTextureStreamer & GetStreamer()
+		{
+			return Streamer;
+		}
 	};
 }
\ No newline at end of file
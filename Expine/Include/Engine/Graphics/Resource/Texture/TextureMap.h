@@ -8,6 +8,7 @@
 
 #include <Utils/File/File.h>
 #include <Utils/StringOp.h>
+#include <Utils/Texture/SplatMap.h>
 
 namespace rapidxml { template<class T> class xml_node; }
 namespace D3D
@@ -48,13 +49,16 @@ namespace D3D
 		};
 
 		typedef TMap<Uint8, TextureData>	TTextureSet;
-		typedef TVector<Uint8>				TTextureMap;
+		typedef Texture::Splat::CSplatMap	TTextureMap;
 
 	private:
 
 		TTextureSet TextureSet;
 		TTextureMap TextureMap;
 
+		Uint MapWidth	= 0;
+		Uint MapHeight	= 0;
+
 		Uint8 NumTextures			= 0;
 		Uint8 NumTexturesNormal		= 0;
 		Uint8 NumTexturesParallax	= 0;
@@ -115,7 +119,7 @@ namespace D3D
 			const Uint Position
 		)	const
 		{
-			return TextureMap[Position];
+			return TextureMap.Get(static_cast<Uint64>(Position));
 		}
 
 	private:
@@ -160,6 +164,8 @@ namespace D3D
 			const rapidxml::xml_node<char> * Tree
 		);
 
+		// Accepts splat maps as written by CSplatMap and raw index maps, which are compressed on load.
+
 		ErrorCode ReadTextureMap
 		(
 			const CCommandListContext	& CmdListCtx,
@@ -5,13 +5,32 @@
 
 #include <DXTK/DDSTextureLoader.h>
 
+namespace Texture
+{
+	namespace DDS
+	{
+		class CDDSContainer;
+	}
+}
+
 namespace D3D
 {
 	class CTextureResource : public RResource
 	{
 	private:
 
-		TVector<D3D12_SUBRESOURCE_DATA> SubResourceData;
+		static ErrorCode OpenDDSContainer
+		(
+					Texture::DDS::CDDSContainer	& Container,
+			const	WString						& FilePath
+		);
+
+		static void AppendSubresourceData
+		(
+			const	Texture::DDS::CDDSContainer		& Container,
+					TVector<D3D12_SUBRESOURCE_DATA>	& SubResourceData,
+			const	Uint32							  FirstMip = 0
+		);
 
 	public:
 
@@ -32,6 +51,16 @@ namespace D3D
 			const D3D12_RESOURCE_STATES	  InitialState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
 		);
 
+		// Creates the texture with the mips from FirstMip down only.
+
+		ErrorCode LoadDDSTextureMips
+		(
+			const CCommandListContext	& CmdListCtx,
+			const WString				& FilePath,
+			const Uint32				  FirstMip,
+			const D3D12_RESOURCE_STATES	  InitialState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+		);
+
 		ErrorCode LoadDDSTextureArray
 		(
 			const CCommandListContext	& CmdListCtx,
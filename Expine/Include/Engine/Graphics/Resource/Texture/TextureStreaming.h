@@ -0,0 +1,376 @@
+#pragma once
+
+#include <limits>
+
+namespace D3D
+{
+	class CTextureStreamer;
+
+	typedef Uint32 TextureStreamingHandle;
+
+	static constexpr TextureStreamingHandle InvalidTextureStreamingHandle = std::numeric_limits<Uint32>::max();
+
+	struct TextureStreamingDesc
+	{
+		Uint32	Width		= 0;
+		Uint32	Height		= 0;
+		Uint32	ArraySize	= 1;
+		Uint32	MipLevels	= 1;
+
+		// DXGI format, only used to size the mips.
+
+		Uint32	Format		= 0;
+
+		// Coarsest mip a resident range may start at, block compressed
+		// textures cannot start at a level that is not block aligned.
+
+		Uint32	LastStreamableMip = std::numeric_limits<Uint32>::max();
+	};
+
+	struct TextureStreamingStats
+	{
+		Uint64	BudgetBytes		= 0;
+		Uint64	ResidentBytes	= 0;
+		Uint64	PendingBytes	= 0;
+		Uint64	PinnedBytes		= 0;
+
+		Uint32	NumTextures		= 0;
+		Uint32	NumPending		= 0;
+
+		// Totals since initialization.
+
+		Uint64	NumLoads		= 0;
+		Uint64	NumEvictions	= 0;
+		Uint64	NumFailedLoads	= 0;
+		Uint64	NumDeferred		= 0;
+	};
+
+	/************************************************************
+	*
+	*	Performs the actual uploads for the streamer. A mip
+	*	range always extends down to the smallest mip, so a
+	*	texture is described by its finest resident level.
+	*
+	************************************************************/
+
+	class ITextureStreamingBackend
+	{
+	public:
+
+		// Makes mips [FirstMip, MipLevels) resident. Completion is reported
+		// through CTextureStreamer::CompleteLoad, from any thread.
+
+		virtual bool LoadMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		) = 0;
+
+		// Drops every mip finer than FirstMip, counts as freed right away.
+
+		virtual void EvictMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		) = 0;
+	};
+
+	// Keeps no data, loads complete on request or with the next call to Complete.
+
+	class CTextureStreamingBackendNull : public ITextureStreamingBackend
+	{
+	private:
+
+		struct PendingLoad
+		{
+			TextureStreamingHandle	Handle;
+			Uint32					FirstMip;
+		};
+
+	private:
+
+		CTextureStreamer *		Streamer = NULL;
+		bool					Immediate = true;
+
+		TVector<PendingLoad>	Pending;
+
+	public:
+
+		CTextureStreamingBackendNull
+		(
+			CTextureStreamer	* Streamer,
+			const bool			  Immediate = true
+		) :
+			Streamer(Streamer),
+			Immediate(Immediate)
+		{}
+
+		virtual bool LoadMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		)	override;
+
+		virtual void EvictMips
+		(
+			const TextureStreamingHandle	  Handle,
+			const TextureStreamingDesc		& Desc,
+			const Uint32					  FirstMip
+		)	override;
+
+		// Reports every deferred load as finished.
+
+		void Complete
+		(
+			const bool Success = true
+		);
+
+		inline size_t GetNumPending() const
+		{
+			return Pending.size();
+		}
+	};
+
+	/************************************************************
+	*
+	*	Mip residency under a byte budget. Culling reports the
+	*	mip each texture needs, Update then issues loads in
+	*	order of priority and evicts mips that are no longer
+	*	needed, or belong to less important textures, to make
+	*	room. The mips from MinResidentSize down are pinned and
+	*	loaded ahead of everything else, so there is always a
+	*	fallback to sample.
+	*
+	*	Register, Unregister and Update have to be called from
+	*	one thread, RequestMip and CompleteLoad from any.
+	*
+	************************************************************/
+
+	class CTextureStreamer
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			Uint64						BudgetBytes			= 512ULL << 20;
+			ITextureStreamingBackend *	Backend				= NULL;
+
+			// Largest dimension of the pinned mips.
+
+			Uint32						MinResidentSize		= 64;
+
+			// Updates without a request before unneeded mips may be evicted.
+
+			Uint32						EvictionDelay		= 30;
+
+			Uint32						MaxLoadsPerUpdate	= 16;
+			Uint64						MaxPendingBytes		= 64ULL << 20;
+		};
+
+	private:
+
+		static constexpr Uint32 MaxMipLevels = 16;
+		static constexpr Uint32 NoRequest = std::numeric_limits<Uint32>::max();
+
+		struct Entry
+		{
+			TextureStreamingDesc	Desc;
+
+			// Bytes of all mips from the index down to the smallest.
+
+			Uint64					TailBytes[MaxMipLevels + 1];
+
+			Uint32					MinResidentMip = 0;
+			Uint32					ResidentMip = 0;
+			Uint32					PendingMip = 0;
+			Uint32					WantedMip = 0;
+
+			Float					Priority = 0.0f;
+			Uint64					LastRequest = 0;
+
+			bool					Registered = false;
+
+			// Written by culling threads between updates.
+
+			TAtomic<Uint32>			RequiredMip;
+			TAtomic<Uint32>			ScreenSize;
+
+			inline bool IsPending() const
+			{
+				return PendingMip != ResidentMip;
+			}
+
+			inline Uint64 GetBytes
+			(
+				const Uint32 FirstMip,
+				const Uint32 LastMip
+			)	const
+			{
+				return TailBytes[FirstMip] - TailBytes[LastMip];
+			}
+		};
+
+		struct Completion
+		{
+			TextureStreamingHandle	Handle;
+			Uint32					FirstMip;
+			bool					Success;
+		};
+
+	private:
+
+		InitializeOptions				Options;
+
+		TVector<TUniquePtr<Entry> >		Entries;
+		TVector<TextureStreamingHandle>	FreeHandles;
+
+		TMutex							CompletionMutex;
+		TVector<Completion>				Completions;
+
+		TextureStreamingStats			Stats;
+		Uint64							Frame = 0;
+
+	private:
+
+		void ProcessCompletions();
+
+		void CollectRequests();
+
+		bool IssueLoad
+		(
+			const TextureStreamingHandle	Handle,
+				  Entry					&	Target,
+			const Uint32					FirstMip
+		);
+
+		void Evict
+		(
+			const TextureStreamingHandle	Handle,
+				  Entry					&	Target,
+			const Uint32					FirstMip
+		);
+
+		void Release
+		(
+			const TextureStreamingHandle Handle
+		);
+
+		// Frees at least the given amount by evicting unneeded mips first,
+		// then demoting textures of lower priority by one mip at a time.
+
+		bool MakeRoom
+		(
+			const Uint64					Bytes,
+			const TextureStreamingHandle	Requester,
+			const Float						Priority
+		);
+
+	public:
+
+		ErrorCode Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		TextureStreamingHandle Register
+		(
+			const TextureStreamingDesc & Desc
+		);
+
+		void Unregister
+		(
+			const TextureStreamingHandle Handle
+		);
+
+		// Issues the load of the pinned mips now instead of with the next update.
+
+		void LoadPinnedMips
+		(
+			const TextureStreamingHandle Handle
+		);
+
+		// Records the mip needed this frame, the finest request wins.
+
+		void RequestMip
+		(
+			const TextureStreamingHandle	Handle,
+			const Uint32					Mip,
+			const Uint32					ScreenSize = 0
+		);
+
+		// Derives the mip from the projected size in pixels of the largest dimension.
+
+		void RequestScreenSize
+		(
+			const TextureStreamingHandle	Handle,
+			const Float						ScreenSize
+		);
+
+		void CompleteLoad
+		(
+			const TextureStreamingHandle	Handle,
+			const Uint32					FirstMip,
+			const bool						Success
+		);
+
+		void Update();
+
+		void SetBudget
+		(
+			const Uint64 BudgetBytes
+		);
+
+		static Uint32 ComputeRequiredMip
+		(
+			const Uint32	Width,
+			const Uint32	Height,
+			const Float		ScreenSize
+		);
+
+		static Uint64 ComputeMipBytes
+		(
+			const TextureStreamingDesc	& Desc,
+			const Uint32				  Mip
+		);
+
+		inline Uint32 GetResidentMip
+		(
+			const TextureStreamingHandle Handle
+		)	const
+		{
+			return Entries[Handle]->ResidentMip;
+		}
+
+		inline Uint32 GetMinResidentMip
+		(
+			const TextureStreamingHandle Handle
+		)	const
+		{
+			return Entries[Handle]->MinResidentMip;
+		}
+
+		inline bool IsPending
+		(
+			const TextureStreamingHandle Handle
+		)	const
+		{
+			return Entries[Handle]->IsPending();
+		}
+
+		inline const TextureStreamingDesc & GetDesc
+		(
+			const TextureStreamingHandle Handle
+		)	const
+		{
+			return Entries[Handle]->Desc;
+		}
+
+		inline const TextureStreamingStats & GetStats() const
+		{
+			return Stats;
+		}
+	};
+}
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "DirectX/D3D.h"
+#include "Object/Mesh.h"
+
+namespace D3D
+{
+	/************************************************************
+	*
+	*	Per instance transform as uploaded to the instance buffer.
+	*
+	************************************************************/
+
+	struct InstanceTransform
+	{
+		Vector3f	Position;
+		Float		Scale;
+		Vector3f	Rotation;
+		Uint32		ObjectId;
+	};
+
+	/************************************************************
+	*
+	*	Quantized instance transform. Positions are stored
+	*	relative to the bounds of the owning batch, rotations
+	*	as 16 bit angles in [-PI, PI]. The object id is kept
+	*	whole, it is the value of the object handle.
+	*
+	************************************************************/
+
+	struct InstanceTransformQuantized
+	{
+		Uint16 Position[3];
+		Uint16 Scale;
+		Uint16 Rotation[3];
+		Uint16 Padding;
+		Uint32 ObjectId;
+	};
+
+	/************************************************************
+	*
+	*	Vertex of the shared static geometry, one per wedge of
+	*	the source mesh.
+	*
+	************************************************************/
+
+	struct StaticMeshVertex
+	{
+		Vector3f Position;
+		Vector3f Normal;
+		Vector2f Texcoord;
+	};
+
+	static_assert(sizeof(InstanceTransform) == 32, "InstanceTransform layout mismatch");
+	static_assert(sizeof(InstanceTransformQuantized) == 20, "InstanceTransformQuantized layout mismatch");
+
+	struct InstanceBatchKey
+	{
+		static constexpr Uint32 MaxMeshes		= 1U << 24;
+		static constexpr Uint32 MaxMaterials	= 1U << 24;
+		static constexpr Uint32 MaxLods			= 1U << 8;
+
+		Uint64 Key;
+
+		// Material first to minimize pipeline changes, then mesh and lod.
+
+		static constexpr inline Uint64 Create
+		(
+			const Uint32 Mesh,
+			const Uint32 Lod,
+			const Uint32 Material
+		)
+		{
+			return
+				(static_cast<Uint64>(Material	& 0xFFFFFF) << 40) |
+				(static_cast<Uint64>(Mesh		& 0xFFFFFF) << 16) |
+				(static_cast<Uint64>(Lod		& 0xFF)		<< 8);
+		}
+
+		inline Uint32 GetMaterial() const
+		{
+			return static_cast<Uint32>(Key >> 40) & 0xFFFFFF;
+		}
+
+		inline Uint32 GetMesh() const
+		{
+			return static_cast<Uint32>(Key >> 16) & 0xFFFFFF;
+		}
+
+		inline Uint32 GetLod() const
+		{
+			return static_cast<Uint32>(Key >> 8) & 0xFF;
+		}
+
+		inline bool operator<
+		(
+			const InstanceBatchKey & Other
+		)	const
+		{
+			return Key < Other.Key;
+		}
+
+		inline bool operator==
+		(
+			const InstanceBatchKey & Other
+		)	const
+		{
+			return Key == Other.Key;
+		}
+	};
+
+	struct InstanceMeshRange
+	{
+		Uint32	IndexCount;
+		Uint32	StartIndex;
+		Int32	BaseVertex;
+	};
+
+	// Consecutive commands drawing batches of one material.
+
+	struct InstanceMaterialRange
+	{
+		Uint32 Material;
+		Uint32 FirstCommand;
+		Uint32 NumCommands;
+	};
+
+	struct InstanceBatch
+	{
+		InstanceBatchKey	Key;
+		Uint32				FirstInstance;
+		Uint32				NumInstances;
+		Vector3f			BoundsMin;
+		Vector3f			BoundsExtent;
+		Float				ScaleMax;
+	};
+
+	class CInstanceBatchBuilder
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			bool	QuantizePositions		= false;
+			Uint32	ParallelSortThreshold	= 4096;
+		};
+
+	private:
+
+		struct InstanceRecord
+		{
+			Uint64 Key;
+			Uint32 Index;
+
+			inline bool operator<
+			(
+				const InstanceRecord & Other
+			)	const
+			{
+				return Key < Other.Key || (Key == Other.Key && Index < Other.Index);
+			}
+		};
+
+	private:
+
+		InitializeOptions Options;
+
+		THashMap<const void*, Uint32>		MeshIds;
+		THashMap<const void*, Uint32>		MaterialIds;
+		TVector<const void*>				Materials;
+
+		// One range per section, keyed like the batches drawing it.
+
+		THashMap<Uint64, InstanceMeshRange> MeshRanges;
+		THashSet<Uint32>					MeshGeometries;
+
+		TVector<StaticMeshVertex>			GeometryVertices;
+		TVector<Uint32>						GeometryIndices;
+		Uint32								GeometryRevision = 0;
+
+		TVector<InstanceRecord>				Records;
+		TVector<InstanceTransform>			Transforms;
+
+		TVector<InstanceBatch>				Batches;
+		TVector<InstanceTransform>			Instances;
+		TVector<InstanceTransformQuantized>	InstancesQuantized;
+
+	private:
+
+		static constexpr inline Uint32 CreateMeshGeometryKey
+		(
+			const Uint32 Mesh,
+			const Uint32 Lod
+		)
+		{
+			return ((Mesh & 0xFFFFFF) << 8) | (Lod & 0xFF);
+		}
+
+		void SortRecords();
+		void PackBatch
+		(
+			InstanceBatch & Batch
+		);
+
+	public:
+
+		inline const TVector<InstanceBatch> & GetBatches() const
+		{
+			return Batches;
+		}
+
+		inline const TVector<InstanceTransform> & GetInstances() const
+		{
+			return Instances;
+		}
+
+		inline const TVector<InstanceTransformQuantized> & GetInstancesQuantized() const
+		{
+			return InstancesQuantized;
+		}
+
+		// The material registered with the id, as passed to RegisterMaterial.
+
+		inline const void * GetMaterial
+		(
+			const Uint32 Material
+		)	const
+		{
+			return Material < Materials.size() ? Materials[Material] : NULL;
+		}
+
+		inline size_t GetNumMaterials() const
+		{
+			return Materials.size();
+		}
+
+		inline bool IsQuantized() const
+		{
+			return Options.QuantizePositions;
+		}
+
+		inline size_t GetNumInstances() const
+		{
+			return Records.size();
+		}
+
+		inline const TVector<StaticMeshVertex> & GetGeometryVertices() const
+		{
+			return GeometryVertices;
+		}
+
+		inline const TVector<Uint32> & GetGeometryIndices() const
+		{
+			return GeometryIndices;
+		}
+
+		// Changes whenever geometry was added, uploaded copies are stale then.
+
+		inline Uint32 GetGeometryRevision() const
+		{
+			return GeometryRevision;
+		}
+
+	public:
+
+		CInstanceBatchBuilder() = default;
+		CInstanceBatchBuilder
+		(
+			const InitializeOptions & Options
+		);
+
+		Uint32 RegisterMesh
+		(
+			const void * Mesh
+		);
+
+		Uint32 RegisterMaterial
+		(
+			const void * Material
+		);
+
+		void SetMeshRange
+		(
+			const Uint32				Mesh,
+			const Uint32				Lod,
+			const Uint32				Material,
+			const InstanceMeshRange &	Range
+		);
+
+		const InstanceMeshRange * GetMeshRange
+		(
+			const InstanceBatchKey & Key
+		)	const;
+
+		inline const InstanceMeshRange * GetMeshRange
+		(
+			const Uint32 Mesh,
+			const Uint32 Lod,
+			const Uint32 Material
+		)	const
+		{
+			return GetMeshRange(InstanceBatchKey{ InstanceBatchKey::Create(Mesh, Lod, Material) });
+		}
+
+		inline bool HasMeshGeometry
+		(
+			const Uint32 Mesh,
+			const Uint32 Lod
+		)	const
+		{
+			return MeshGeometries.find(CreateMeshGeometryKey(Mesh, Lod)) != MeshGeometries.end();
+		}
+
+		// Appends the lod to the shared geometry with the triangles grouped by material,
+		// each group becomes the range of its section. Kept across frames.
+
+		void AddMeshGeometry
+		(
+			const Uint32		Mesh,
+			const Uint32		Lod,
+			const KStaticMesh &	Source
+		);
+
+		// Clears per frame data, registered meshes and capacity are kept.
+
+		void Reset();
+
+		inline void AddInstance
+		(
+			const Uint32				Mesh,
+			const Uint32				Lod,
+			const Uint32				Material,
+			const InstanceTransform &	Transform
+		)
+		{
+			Records.push_back({ InstanceBatchKey::Create(Mesh, Lod, Material), static_cast<Uint32>(Transforms.size()) });
+			Transforms.push_back(Transform);
+		}
+
+		void Build();
+
+		template
+		<
+			typename Command = D3D12_DRAW_INDEXED_ARGUMENTS
+		>
+		inline size_t EmitCommands
+		(
+			TVector<Command>				& Commands,
+			TVector<InstanceMaterialRange>	* MaterialRanges = NULL
+		)	const;
+
+		static void Quantize
+		(
+			const InstanceTransform		&	Transform,
+			const InstanceBatch			&	Batch,
+				  InstanceTransformQuantized & Result
+		);
+
+		static void Dequantize
+		(
+			const InstanceTransformQuantized	&	Quantized,
+			const InstanceBatch					&	Batch,
+				  InstanceTransform				&	Result
+		);
+	};
+
+	/************************************************************
+	*
+	*	Emits one indexed indirect draw per batch. A batch draws
+	*	the section of its material only, batches without a
+	*	registered section range are skipped. Batches are sorted
+	*	by material, MaterialRanges receives one range per run.
+	*
+	************************************************************/
+
+	template
+	<
+		typename Command
+	>
+	inline size_t CInstanceBatchBuilder::EmitCommands(TVector<Command> & Commands, TVector<InstanceMaterialRange> * MaterialRanges) const
+	{
+		size_t NumCommands = 0;
+
+		for (const auto & Batch : Batches)
+		{
+			const InstanceMeshRange * Range = GetMeshRange(Batch.Key);
+
+			if (!Range)
+			{
+				continue;
+			}
+
+			Command Cmd;
+			{
+				Cmd.IndexCountPerInstance	= Range->IndexCount;
+				Cmd.InstanceCount			= Batch.NumInstances;
+				Cmd.StartIndexLocation		= Range->StartIndex;
+				Cmd.BaseVertexLocation		= Range->BaseVertex;
+				Cmd.StartInstanceLocation	= Batch.FirstInstance;
+			}
+
+			if (MaterialRanges)
+			{
+				if (MaterialRanges->empty() || MaterialRanges->back().Material != Batch.Key.GetMaterial())
+				{
+					MaterialRanges->push_back({ Batch.Key.GetMaterial(), static_cast<Uint32>(Commands.size()), 0 });
+				}
+
+				++MaterialRanges->back().NumCommands;
+			}
+
+			Commands.push_back(Cmd);
+
+			++NumCommands;
+		}
+
+		return NumCommands;
+	}
+}
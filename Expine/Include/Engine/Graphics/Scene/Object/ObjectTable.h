@@ -12,6 +12,221 @@ namespace D3D
 		Vector3f Rotation;
 	};
 
+	/************************************************************
+	*
+	*	Binary object table layout:
+	*
+	*	ObjectTableHeader
+	*	ObjectTableTypeRange	[NumTypeRanges]
+	*	ObjectTableEntry		[NumEntries]
+	*
+	*	Entries are sorted by type, then by the Morton code of
+	*	their position within the table bounds.
+	*
+	************************************************************/
+
+	struct ObjectTableHeader
+	{
+		static constexpr Uint32 Signature		= 0x4C42544F; // 'OTBL'
+		static constexpr Uint32 CurrentVersion	= 1;
+
+		Uint32		Magic;
+		Uint32		Version;
+		Uint32		NumEntries;
+		Uint32		NumTypeRanges;
+		Vector3f	BoundsMin;
+		Vector3f	BoundsMax;
+	};
+
+	struct ObjectTableTypeRange
+	{
+		Uint32 Type;
+		Uint32 First;
+		Uint32 Count;
+	};
+
+	struct ObjectHandle
+	{
+		static constexpr Uint32 IndexBits	= 24;
+		static constexpr Uint32 IndexMask	= (1U << IndexBits) - 1;
+		static constexpr Uint32 Invalid		= static_cast<Uint32>(-1);
+
+		Uint32 Value = Invalid;
+
+		static inline ObjectHandle Make
+		(
+			const EObjectType	Type,
+			const Uint32		Index
+		)
+		{
+			ObjectHandle Handle;
+			{
+				Handle.Value = (static_cast<Uint32>(Type) << IndexBits) | (Index & IndexMask);
+			}
+
+			return Handle;
+		}
+
+		inline bool IsValid() const
+		{
+			return Value != Invalid;
+		}
+
+		inline EObjectType GetType() const
+		{
+			return static_cast<EObjectType>(Value >> IndexBits);
+		}
+
+		inline Uint32 GetIndex() const
+		{
+			return Value & IndexMask;
+		}
+	};
+
+	/************************************************************
+	*
+	*	Type segregated object storage. Objects of one type are
+	*	placed in fixed size chunks which are never moved, so
+	*	handles and pointers stay valid until Clear. Slots are
+	*	reserved serially and may then be constructed in parallel,
+	*	they only count as objects once committed.
+	*
+	************************************************************/
+
+	class CObjectArena
+	{
+	public:
+
+		static constexpr Uint32 ChunkShift	= 10;
+		static constexpr Uint32 ChunkSize	= 1U << ChunkShift;
+
+	private:
+
+		struct TypeStorage
+		{
+			size_t			ElementSize	= 0;
+			Uint32			NumElements	= 0;
+			TVector<Byte*>	Chunks;
+
+			void			(*Destroy)(void*)			= NULL;
+			CSceneObject *	(*GetSceneObject)(void*)	= NULL;
+		};
+
+		TArray<TypeStorage, ObjectTypeCount> Types;
+
+	public:
+
+		CObjectArena() = default;
+		CObjectArena(const CObjectArena&) = delete;
+		CObjectArena& operator=(const CObjectArena&) = delete;
+
+		~CObjectArena()
+		{
+			Clear();
+		}
+
+		void Clear();
+
+		// Returns the index of the first reserved slot. Not thread safe.
+
+		template<class Object>
+		Uint32 Reserve
+		(
+			const EObjectType	Type,
+			const Uint32		Count
+		);
+
+		// Call once all reserved objects are constructed. Until then they are
+		// neither resolved nor destroyed, so a range whose construction threw
+		// is never touched again.
+
+		inline void Commit
+		(
+			const EObjectType	Type,
+			const Uint32		Count
+		)
+		{
+			Types[Type].NumElements += Count;
+		}
+
+		inline void * GetSlot
+		(
+			const EObjectType	Type,
+			const Uint32		Index
+		)	const
+		{
+			const TypeStorage & Storage = Types[Type];
+			{
+				return Storage.Chunks[Index >> ChunkShift] + (Index & (ChunkSize - 1)) * Storage.ElementSize;
+			}
+		}
+
+		inline Uint32 GetNumObjects
+		(
+			const EObjectType Type
+		)	const
+		{
+			return Types[Type].NumElements;
+		}
+
+		inline CSceneObject * Resolve
+		(
+			const ObjectHandle Handle
+		)	const
+		{
+			if (!Handle.IsValid() || Handle.GetIndex() >= Types[Handle.GetType()].NumElements)
+			{
+				return NULL;
+			}
+
+			return Types[Handle.GetType()].GetSceneObject(GetSlot(Handle.GetType(), Handle.GetIndex()));
+		}
+
+		template<class Object>
+		inline Object * Get
+		(
+			const ObjectHandle Handle
+		)	const
+		{
+			return static_cast<Object*>(GetSlot(Handle.GetType(), Handle.GetIndex()));
+		}
+	};
+
+	template<class Object>
+	Uint32 CObjectArena::Reserve(const EObjectType Type, const Uint32 Count)
+	{
+		static_assert(std::is_base_of<CSceneObject, Object>::value, "Arena objects must derive from CSceneObject.");
+
+		TypeStorage & Storage = Types[Type];
+
+		if (Storage.ElementSize == 0)
+		{
+			Storage.ElementSize		= (sizeof(Object) + alignof(Object) - 1) & ~(alignof(Object) - 1);
+			Storage.Destroy			= [](void * Memory) { static_cast<Object*>(Memory)->~Object(); };
+			Storage.GetSceneObject	= [](void * Memory) { return static_cast<CSceneObject*>(static_cast<Object*>(Memory)); };
+		}
+		else if (Storage.ElementSize != ((sizeof(Object) + alignof(Object) - 1) & ~(alignof(Object) - 1)))
+		{
+			throw Exception("Object arena type mismatch.");
+		}
+
+		const Uint32 First = Storage.NumElements;
+
+		if (First + Count > ObjectHandle::IndexMask)
+		{
+			throw Exception("Object arena exhausted.");
+		}
+
+		const size_t NumChunks = (First + Count + ChunkSize - 1) >> ChunkShift;
+
+		while (Storage.Chunks.size() < NumChunks)
+		{
+			Storage.Chunks.push_back(static_cast<Byte*>(::operator new(Storage.ElementSize * ChunkSize)));
+		}
+
+		return First;
+	}
+
 	class ObjectTable;
 	class ObjectTableCache
 	{
@@ -40,26 +255,55 @@ namespace D3D
 			virtual void OnFinish() = 0;
 		};
 
-		void LoadTable(ObjectTable & Table);
+		// Instantiates all entries into the arena, one parallel pass per type range.
+		// Handles receives one handle per table entry, in table order.
+
+		ErrorCode LoadTable
+		(
+			const	ObjectTable				& Table,
+					CObjectArena			& Arena,
+					TVector<ObjectHandle>	& Handles
+		);
 	};
 
 	class ObjectTable
 	{
 	private:
-		
-		TVector<ObjectTableEntry> Entries;
+
+		TVector<ObjectTableEntry>		Entries;
+		TVector<ObjectTableTypeRange>	TypeRanges;
+
+		Vector3f BoundsMin;
+		Vector3f BoundsMax;
 
 	protected:
 
-		void Sort();
+		void ComputeBounds();
+		void ComputeTypeRanges();
 
 	public:
 
+		// Sorts by type and Morton code and rebuilds the type ranges.
+
+		void Sort();
+
+		static Uint32 GetMortonCode
+		(
+			const Vector3f & Position,
+			const Vector3f & BoundsMin,
+			const Vector3f & BoundsMax
+		);
+
 		inline const TVector<ObjectTableEntry> & GetEntries() const
 		{
 			return Entries;
 		}
 
+		inline const TVector<ObjectTableTypeRange> & GetTypeRanges() const
+		{
+			return TypeRanges;
+		}
+
 		template<class... Args>
 		inline void AddEntry
 		(
@@ -75,11 +319,24 @@ namespace D3D
 			const size_t			 NumEntries
 		)
 		{
-			Entries.insert(Entries.end(), 
-				Entry, 
+			Entries.insert(Entries.end(),
+				Entry,
 				Entry + NumEntries);
 		}
 
+		// Accepts the binary format as well as a bare entry array, which is sorted on load.
+
+		ErrorCode Read
+		(
+			const Byte *	Data,
+			const size_t	Size
+		);
+
+		void Write
+		(
+			TVector<Byte> & Output
+		);
+
 		ObjectTable() = default;
 
 		template<class Container>
@@ -89,8 +346,8 @@ namespace D3D
 		)
 		{
 			std::copy(
-				std::begin(Elements), 
-				std::end(Elements), 
+				std::begin(Elements),
+				std::end(Elements),
 				std::back_inserter(Entries)
 			);
 		}
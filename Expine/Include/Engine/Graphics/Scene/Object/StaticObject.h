@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Object.h"
+#include "ObjectBatch.h"
+#include "Scene/Spatial/SpatialBounds.h"
 
 namespace D3D
 {
@@ -18,6 +20,41 @@ namespace D3D
 	public:
 		
 		virtual inline EObjectType ObjectType() const = 0;
+
+		// Static objects are drawn in instanced batches by CStaticObjectRenderer.
+
+		virtual void Render
+		(
+			const CSceneRenderer * Renderer
+		)	const override final
+		{}
+
+		// World bounds used by the spatial index of the area. Objects
+		// without geometry are indexed as a unit box at their center.
+
+		virtual BoundingBox GetBounds() const
+		{
+			return BoundingBox::FromCenter(Controller->GetCenterPosition(), Vector3f(0.5f, 0.5f, 0.5f));
+		}
+
+		// Adds one instance per material section of the given lod, tagged with ObjectId.
+
+		virtual void GatherInstances
+		(
+					CInstanceBatchBuilder & Builder,
+			const	Uint32					Lod,
+			const	Uint32					ObjectId
+		)	const
+		{}
+
+		// Called for visible objects with their projected size in pixels,
+		// requests the texture mips the materials need at that size.
+
+		virtual void RequestTextureMips
+		(
+			const Float ScreenSize
+		)	const
+		{}
 	};
 
 	class CStaticObjectFactory
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Scene/Object/ObjectBatch.h"
+
+#include "Buffer/BufferVertex.h"
+#include "Buffer/BufferIndex.h"
+#include "Buffer/BufferCommand.h"
+
+namespace D3D
+{
+	class CScene;
+	class CSceneRenderer;
+
+	/************************************************************
+	*
+	*	Draws the static objects of the scene area as instanced
+	*	batches, one indirect draw per mesh section. Geometry is
+	*	uploaded when the builder gains a mesh, transforms and
+	*	draw commands are rebuilt every frame. The draws are
+	*	split where the material changes, each part binds the
+	*	textures of its material.
+	*
+	************************************************************/
+
+	class CStaticObjectRenderer
+	{
+	private:
+
+		ConstPointer<CScene>				Scene;
+		ConstPointer<CSceneRenderer>		SceneRenderer;
+		ConstPointer<CCommandListContext>	CmdListCtx;
+
+		CInstanceBatchBuilder					Builder;
+		TVector<D3D12_DRAW_INDEXED_ARGUMENTS>	Commands;
+		TVector<InstanceMaterialRange>			MaterialRanges;
+
+		// Texture table of each builder material, occupied on first use.
+
+		THashMap<Uint32, DescriptorHeapRange>	MaterialDescriptors;
+
+		UniquePointer<CVertexBuffer>	GeometryVertexBuffer;
+		UniquePointer<CIndexBuffer>		GeometryIndexBuffer;
+		UniquePointer<CVertexBuffer>	InstanceBuffer;
+		UniquePointer<CCommandBuffer>	CommandBuffer;
+
+		Uint32 GeometryRevision	= 0;
+		size_t InstanceCapacity	= 0;
+		size_t CommandCapacity	= 0;
+
+	private:
+
+		ErrorCode CreateGeometryBuffers();
+		ErrorCode ReserveInstances
+		(
+			const size_t NumInstances
+		);
+		ErrorCode ReserveCommands
+		(
+			const size_t NumCommands
+		);
+
+		ErrorCode UploadData();
+
+		// Copies the texture views of the material into its table, Flags receives the EMaterialFlags.
+
+		const DescriptorHeapRange & UpdateMaterialDescriptors
+		(
+			const Uint32	Material,
+				  Uint32 &	Flags
+		);
+
+	public:
+
+		inline const CInstanceBatchBuilder & GetBuilder() const
+		{
+			return Builder;
+		}
+
+	public:
+
+		CStaticObjectRenderer
+		(
+			const CSceneRenderer * pSceneRenderer
+		);
+
+		// Gathers and batches the visible instances, called once per frame before Render.
+
+		void Update();
+		void Render();
+	};
+}
@@ -3,7 +3,12 @@
 #include "DirectX/D3D.h"
 
 #include "Scene/Object/Intersection.h"
+#include "Scene/Object/ObjectBatch.h"
 #include "Scene/Object/ObjectTable.h"
+#include "Scene/Spatial/LooseQuadTree.h"
+#include "Scene/Spatial/BoundingVolumeHierarchy.h"
+
+#include <future>
 
 namespace D3D
 {
@@ -32,9 +37,25 @@ namespace D3D
 
 	public:
 
-		struct InitializeOptions
+		inline CAreaNode * GetSubNode
+		(
+			const UINT Index
+		)	const
+		{
+			return SubNodes[Index];
+		}
+
+		inline BoundingBox GetBounds() const
 		{
+			return BoundingBox(Position, Position + Size);
+		}
+
+	public:
 
+		struct InitializeOptions
+		{
+			Vector3f Position;
+			Vector3f Size;
 		};
 
 	public:
@@ -42,9 +63,14 @@ namespace D3D
 		CAreaNode
 		(
 			const InitializeOptions & Options
-		)
+		) :
+			Size(Options.Size),
+			Position(Options.Position)
 		{
-
+			for (auto & Node : SubNodes)
+			{
+				Node = NULL;
+			}
 		}
 	};
 
@@ -78,17 +104,89 @@ namespace D3D
 		{}
 	};
 
+	// UTF-8 path of the game database, "GameDatabase" in Engine.cfg of the working directory.
+
+	const String & GetGameDatabasePath();
+
 	enum EAreaType
 	{
 		AreaIndoor,
 		AreaOutdoor
 	};
+
+	// Projects object bounds to pixels for texture streaming and lod selection.
+
+	struct AreaStreamingView
+	{
+		Vector3f	Origin;
+
+		// Pixels covered by one unit at a distance of one.
+
+		Float		ProjectionScale = 0.0f;
+
+		// Objects covering at least this many pixels draw lod zero, every halving selects the next lod.
+
+		Float		LodScreenSize	= 512.0f;
+
+		inline Uint32 SelectLod
+		(
+			const Float ScreenSize
+		)	const
+		{
+			Uint32 Lod	= 0;
+			Float Size	= LodScreenSize;
+
+			while (ScreenSize < Size && Lod + 1 < InstanceBatchKey::MaxLods)
+			{
+				Size *= 0.5f;
+				Lod++;
+			}
+
+			return Lod;
+		}
+	};
 	
 	class CSceneArea
 	{
 	private:
 
-		ObjectTable StaticObjectTable;
+		ObjectTable				StaticObjectTable;
+		CObjectArena			StaticObjects;
+		TVector<ObjectHandle>	StaticObjectHandles;
+
+		CLooseQuadTree				StaticObjectIndex;
+		CBoundingVolumeHierarchy	DynamicObjectIndex;
+
+		// Valid while the object tables of the area are read on a pool reader.
+
+		std::future<int>			PendingTables;
+
+	public:
+
+		virtual ~CSceneArea();
+
+		inline CLooseQuadTree & GetStaticObjectIndex()
+		{
+			return StaticObjectIndex;
+		}
+
+		inline CBoundingVolumeHierarchy & GetDynamicObjectIndex()
+		{
+			return DynamicObjectIndex;
+		}
+
+		// Adds the instances of all static objects whose indexed bounds intersect
+		// the frustum, instances are tagged with the value of the object handle.
+		// With a streaming view the objects also request their texture mips and
+		// draw the lod selected by their projected size, Lod is the finest one.
+
+		void GatherStaticInstances
+		(
+			const ViewFrustum			& Frustum,
+				  CInstanceBatchBuilder	& Builder,
+			const Uint32				  Lod = 0,
+			const AreaStreamingView		* StreamingView = NULL
+		)	const;
 
 	protected:
 
@@ -106,6 +204,16 @@ namespace D3D
 
 		virtual EAreaType GetAreaType() const = 0;
 
+		// Creates the static objects once the tables read by Load arrived,
+		// until then the area has none. Called once per frame.
+
+		ErrorCode UpdateLoad();
+
+		inline bool IsLoading() const
+		{
+			return PendingTables.valid();
+		}
+
 		ErrorCode LoadArea
 		(
 			const UINT AreaId
@@ -4,6 +4,7 @@
 #include "Scene/Scene.h"
 #include "Scene/SceneComposite.h"
 #include "Scene/Outdoor/OcclusionMap.h"
+#include "Scene/Object/StaticObjectRenderer.h"
 
 #include <Utils/Routine/ServiceThread.h>
 
@@ -65,6 +66,7 @@ namespace D3D
 		UniquePointer<CSceneLight::CRenderer>		LightRenderer;
 		UniquePointer<CSceneComposite::CRenderer>	CompositeRenderer;
 		UniquePointer<CSceneOutdoor::CRenderer>		OutdoorRenderer;
+		UniquePointer<CStaticObjectRenderer>		StaticObjectRenderer;
 		UniquePointer<PostProcess::CPostProcess>	PostProcess;
 
 	private:
@@ -88,6 +90,7 @@ namespace D3D
 		void RenderGeometry();
 		void RenderShadowMap();
 		void RenderOutdoor();
+		void RenderModels();
 		void RenderViewFrustum();
 		void RenderComposite();
 		void RenderToBackBuffer();
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "SpatialBounds.h"
+
+namespace D3D
+{
+	/************************************************************
+	*
+	*	Binned SAH bounding volume hierarchy for dynamic objects.
+	*	Modifications are deferred until Commit, which either
+	*	refits the existing tree or rebuilds it once the refitted
+	*	root has degraded past the configured threshold.
+	*
+	************************************************************/
+
+	class CBoundingVolumeHierarchy
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			Uint32	MaxLeafSize			= 4;
+			Uint32	NumBins				= 16;
+			Float	RebuildThreshold	= 1.5f;
+		};
+
+	private:
+
+		static constexpr Uint32 InvalidIndex	= static_cast<Uint32>(-1);
+		static constexpr Uint32 MaxStackDepth	= 64;
+		static constexpr Uint32 MaxBins			= 32;
+
+		// Inner nodes store their first child in First, the second child
+		// is always First + 1. Leaves store a range into Indices.
+
+		struct Node
+		{
+			BoundingBox Bounds;
+			Uint32		First;
+			Uint32		Count;
+
+			inline bool IsLeaf() const
+			{
+				return Count != 0;
+			}
+		};
+
+		struct Item
+		{
+			BoundingBox Bounds;
+			Uint32		UserData;
+			bool		Alive;
+		};
+
+	private:
+
+		InitializeOptions	Options;
+
+		TVector<Node>		Nodes;
+		TVector<Uint32>		Indices;
+		TVector<Item>		Items;
+		TVector<Uint32>		FreeItems;
+
+		// Removed items stay referenced by the tree until the next build.
+
+		TVector<Uint32>		RetiredItems;
+
+		size_t				NumItems		= 0;
+		Float				BuildArea		= 0.0f;
+
+		bool				NeedsRebuild	= false;
+		bool				NeedsRefit		= false;
+
+	private:
+
+		void Build();
+		void Refit();
+
+		void Subdivide
+		(
+			const Uint32 NodeIndex,
+			const Uint32 Depth
+		);
+
+		template
+		<
+			typename NodeTest,
+			typename Visitor
+		>
+		inline void Traverse
+		(
+			NodeTest	&& TestNode,
+			Visitor		&& Visit
+		)	const;
+
+	public:
+
+		CBoundingVolumeHierarchy();
+		CBoundingVolumeHierarchy
+		(
+			const InitializeOptions & Options
+		);
+
+		inline size_t GetNumItems() const
+		{
+			return NumItems;
+		}
+
+		inline size_t GetNumNodes() const
+		{
+			return Nodes.size();
+		}
+
+		inline bool IsDirty() const
+		{
+			return NeedsRebuild || NeedsRefit;
+		}
+
+		inline const BoundingBox & GetBounds
+		(
+			const SpatialHandle Handle
+		)	const
+		{
+			return Items[Handle].Bounds;
+		}
+
+		void Clear();
+
+		SpatialHandle Insert
+		(
+			const BoundingBox & Bounds,
+			const Uint32		UserData
+		);
+
+		void InsertBatch
+		(
+			const BoundingBox	*	Bounds,
+			const Uint32		*	UserData,
+			const size_t			NumItems,
+				  SpatialHandle *	Handles = NULL
+		);
+
+		void Update
+		(
+			const SpatialHandle		Handle,
+			const BoundingBox	&	Bounds
+		);
+
+		void Remove
+		(
+			const SpatialHandle Handle
+		);
+
+		// Applies pending modifications. Queries see the state of the last commit.
+
+		void Commit
+		(
+			const bool ForceRebuild = false
+		);
+
+		template<typename Visitor>
+		inline void QueryFrustum
+		(
+			const ViewFrustum	&	Frustum,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Frustum](const BoundingBox & Bounds) { return Bounds.Intersects(Frustum); },
+				std::forward<Visitor>(Visit));
+		}
+
+		template<typename Visitor>
+		inline void QuerySphere
+		(
+			const SpatialSphere &	Sphere,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Sphere](const BoundingBox & Bounds) { return Bounds.Intersects(Sphere); },
+				std::forward<Visitor>(Visit));
+		}
+
+		template<typename Visitor>
+		inline void QueryBox
+		(
+			const BoundingBox	&	Box,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Box](const BoundingBox & Bounds) { return Bounds.Intersects(Box); },
+				std::forward<Visitor>(Visit));
+		}
+
+		template<typename Visitor>
+		inline void QueryRay
+		(
+			const SpatialRay	&	Ray,
+				  Visitor		&&	Visit
+		)	const
+		{
+			const Vector3f InverseDirection = Ray.GetInverseDirection();
+
+			Float Distance = 0.0f;
+
+			Traverse(
+				[&](const BoundingBox & Bounds) { return Bounds.Intersects(Ray, InverseDirection, Distance); },
+				[&](const Uint32 UserData) { return Visit(UserData, Distance); });
+		}
+	};
+
+	template
+	<
+		typename NodeTest,
+		typename Visitor
+	>
+	inline void CBoundingVolumeHierarchy::Traverse(NodeTest && TestNode, Visitor && Visit) const
+	{
+		if (Nodes.empty())
+		{
+			return;
+		}
+
+		Uint32 Stack[MaxStackDepth];
+		Uint32 StackSize = 0;
+
+		Stack[StackSize++] = 0;
+
+		while (StackSize)
+		{
+			const Node & Current = Nodes[Stack[--StackSize]];
+
+			if (!TestNode(Current.Bounds))
+			{
+				continue;
+			}
+
+			if (Current.IsLeaf())
+			{
+				for (Uint32 N = Current.First; N < Current.First + Current.Count; ++N)
+				{
+					const Item & Candidate = Items[Indices[N]];
+
+					if (Candidate.Alive && TestNode(Candidate.Bounds))
+					{
+						if (!Visit(Candidate.UserData))
+						{
+							return;
+						}
+					}
+				}
+			}
+			else
+			{
+				Stack[StackSize++] = Current.First + 1;
+				Stack[StackSize++] = Current.First;
+			}
+		}
+	}
+}
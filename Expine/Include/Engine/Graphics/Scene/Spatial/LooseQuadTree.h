@@ -0,0 +1,319 @@
+#pragma once
+
+#include "SpatialBounds.h"
+
+namespace D3D
+{
+	/************************************************************
+	*
+	*	Loose quadtree over the X/Y plane. Nodes of all levels
+	*	are stored in one flat array, children are addressed
+	*	arithmetically. Each object lives in exactly one node,
+	*	selected by its size and center, so updates never
+	*	split or merge nodes. Objects not contained in the root
+	*	are kept in an overflow node tested by every query.
+	*
+	************************************************************/
+
+	class CLooseQuadTree
+	{
+	public:
+
+		static constexpr Uint32 MaxLevels = 10;
+
+		struct InitializeOptions
+		{
+			Vector2f	Origin		= Vector2f(0.0f, 0.0f);
+			Vector2f	Size		= Vector2f(1.0f, 1.0f);
+			Uint32		Depth		= 7;
+			Float		Looseness	= 2.0f;
+		};
+
+	private:
+
+		static constexpr Uint32 InvalidIndex	= static_cast<Uint32>(-1);
+		static constexpr Uint32 OverflowLevel	= MaxLevels + 1;
+
+		struct Node
+		{
+			// X/Y hold the loose cell, Z the height range of the subtree.
+
+			BoundingBox Bounds;
+			Uint32		FirstItem		= InvalidIndex;
+			Uint32		NumItems		= 0;
+			Uint32		NumSubtreeItems = 0;
+		};
+
+		struct Item
+		{
+			BoundingBox Bounds;
+			Uint32		UserData;
+			Uint32		Node	= InvalidIndex;
+			Uint32		Prev	= InvalidIndex;
+			Uint32		Next	= InvalidIndex;
+		};
+
+		struct NodeLocation
+		{
+			Uint32 Level;
+			Uint32 X;
+			Uint32 Y;
+		};
+
+	private:
+
+		InitializeOptions	Options;
+
+		TVector<Node>		Nodes;
+		TVector<Item>		Items;
+		TVector<Uint32>		FreeItems;
+
+		Uint32				LevelOffsets[MaxLevels + 1];
+
+		size_t				NumItems = 0;
+
+	private:
+
+		// The overflow node is stored behind the deepest level.
+
+		inline Uint32 GetOverflowIndex() const
+		{
+			return LevelOffsets[Options.Depth];
+		}
+
+		inline Uint32 GetNodeIndex
+		(
+			const NodeLocation & Location
+		)	const
+		{
+			if (Location.Level == OverflowLevel)
+			{
+				return GetOverflowIndex();
+			}
+
+			return LevelOffsets[Location.Level] + Location.Y * (1U << Location.Level) + Location.X;
+		}
+
+		NodeLocation LocateNode
+		(
+			const BoundingBox & Bounds
+		)	const;
+
+		// Links the item into the node at Location, which LocateNode picked for its bounds.
+
+		void Link
+		(
+			const SpatialHandle Handle,
+				  NodeLocation	Location
+		);
+
+		void Unlink
+		(
+			const SpatialHandle Handle
+		);
+
+		SpatialHandle AllocateItem();
+
+		template
+		<
+			typename NodeTest,
+			typename ItemTest,
+			typename Visitor
+		>
+		inline void Traverse
+		(
+			NodeTest	&& TestNode,
+			ItemTest	&& TestItem,
+			Visitor		&& Visit
+		)	const;
+
+	public:
+
+		CLooseQuadTree();
+		CLooseQuadTree
+		(
+			const InitializeOptions & Options
+		);
+
+		void Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		void Clear();
+
+		inline size_t GetNumItems() const
+		{
+			return NumItems;
+		}
+
+		inline const BoundingBox & GetBounds
+		(
+			const SpatialHandle Handle
+		)	const
+		{
+			return Items[Handle].Bounds;
+		}
+
+		SpatialHandle Insert
+		(
+			const BoundingBox & Bounds,
+			const Uint32		UserData
+		);
+
+		// Node selection runs in parallel, linking is serial.
+
+		void InsertBatch
+		(
+			const BoundingBox	*	Bounds,
+			const Uint32		*	UserData,
+			const size_t			NumItems,
+				  SpatialHandle *	Handles = NULL
+		);
+
+		void Update
+		(
+			const SpatialHandle		Handle,
+			const BoundingBox	&	Bounds
+		);
+
+		void Remove
+		(
+			const SpatialHandle Handle
+		);
+
+		template<typename Visitor>
+		inline void QueryFrustum
+		(
+			const ViewFrustum	&	Frustum,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Frustum](const BoundingBox & Bounds) { return Bounds.Intersects(Frustum); },
+				[&Frustum](const BoundingBox & Bounds) { return Bounds.Intersects(Frustum); },
+				std::forward<Visitor>(Visit));
+		}
+
+		template<typename Visitor>
+		inline void QuerySphere
+		(
+			const SpatialSphere &	Sphere,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Sphere](const BoundingBox & Bounds) { return Bounds.Intersects(Sphere); },
+				[&Sphere](const BoundingBox & Bounds) { return Bounds.Intersects(Sphere); },
+				std::forward<Visitor>(Visit));
+		}
+
+		template<typename Visitor>
+		inline void QueryBox
+		(
+			const BoundingBox	&	Box,
+				  Visitor		&&	Visit
+		)	const
+		{
+			Traverse(
+				[&Box](const BoundingBox & Bounds) { return Bounds.Intersects(Box); },
+				[&Box](const BoundingBox & Bounds) { return Bounds.Intersects(Box); },
+				std::forward<Visitor>(Visit));
+		}
+
+		// Visitor receives the user data and the entry distance, unordered.
+
+		template<typename Visitor>
+		inline void QueryRay
+		(
+			const SpatialRay	&	Ray,
+				  Visitor		&&	Visit
+		)	const
+		{
+			const Vector3f InverseDirection = Ray.GetInverseDirection();
+
+			Float Distance = 0.0f;
+
+			Traverse(
+				[&](const BoundingBox & Bounds) { return Bounds.Intersects(Ray, InverseDirection, Distance); },
+				[&](const BoundingBox & Bounds) { return Bounds.Intersects(Ray, InverseDirection, Distance); },
+				[&](const Uint32 UserData) { return Visit(UserData, Distance); });
+		}
+	};
+
+	/************************************************************
+	*
+	*	Visitors return false to stop the traversal.
+	*
+	************************************************************/
+
+	template
+	<
+		typename NodeTest,
+		typename ItemTest,
+		typename Visitor
+	>
+	inline void CLooseQuadTree::Traverse(NodeTest && TestNode, ItemTest && TestItem, Visitor && Visit) const
+	{
+		if (Nodes.empty())
+		{
+			return;
+		}
+
+		for (Uint32 ItemIndex = Nodes[GetOverflowIndex()].FirstItem; ItemIndex != InvalidIndex; ItemIndex = Items[ItemIndex].Next)
+		{
+			if (TestItem(Items[ItemIndex].Bounds))
+			{
+				if (!Visit(Items[ItemIndex].UserData))
+				{
+					return;
+				}
+			}
+		}
+
+		if (Nodes[0].NumSubtreeItems == 0)
+		{
+			return;
+		}
+
+		NodeLocation Stack[MaxLevels * 3 + 1];
+		Uint32 StackSize = 0;
+
+		Stack[StackSize++] = { 0, 0, 0 };
+
+		while (StackSize)
+		{
+			const NodeLocation Location = Stack[--StackSize];
+			const Node & Current = Nodes[GetNodeIndex(Location)];
+
+			if (Current.NumSubtreeItems == 0 || !TestNode(Current.Bounds))
+			{
+				continue;
+			}
+
+			for (Uint32 ItemIndex = Current.FirstItem; ItemIndex != InvalidIndex; ItemIndex = Items[ItemIndex].Next)
+			{
+				if (TestItem(Items[ItemIndex].Bounds))
+				{
+					if (!Visit(Items[ItemIndex].UserData))
+					{
+						return;
+					}
+				}
+			}
+
+			if (Location.Level + 1 < Options.Depth)
+			{
+				for (Uint32 Child = 0; Child < 4; ++Child)
+				{
+					Stack[StackSize++] =
+					{
+						Location.Level + 1,
+						Location.X * 2 + (Child & 1),
+						Location.Y * 2 + (Child >> 1)
+					};
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Scene/View/ViewFrustum.h"
+
+namespace D3D
+{
+	using SpatialHandle = Uint32;
+
+	static constexpr SpatialHandle InvalidSpatialHandle = static_cast<SpatialHandle>(-1);
+
+	struct SpatialSphere
+	{
+		Vector3f	Center;
+		Float		Radius;
+	};
+
+	struct SpatialRay
+	{
+		Vector3f	Origin;
+		Vector3f	Direction;
+		Float		Length = MAX_FLT;
+
+		inline Vector3f GetInverseDirection() const
+		{
+			return Vector3f(
+				Direction.X != 0.0f ? 1.0f / Direction.X : MAX_FLT,
+				Direction.Y != 0.0f ? 1.0f / Direction.Y : MAX_FLT,
+				Direction.Z != 0.0f ? 1.0f / Direction.Z : MAX_FLT);
+		}
+	};
+
+	struct BoundingBox
+	{
+		Vector3f Min;
+		Vector3f Max;
+
+		inline BoundingBox() :
+			Min(MAX_FLT, MAX_FLT, MAX_FLT),
+			Max(-MAX_FLT, -MAX_FLT, -MAX_FLT)
+		{}
+
+		inline BoundingBox
+		(
+			const Vector3f & Min,
+			const Vector3f & Max
+		) :
+			Min(Min), Max(Max)
+		{}
+
+		static inline BoundingBox FromCenter
+		(
+			const Vector3f & Center,
+			const Vector3f & HalfExtent
+		)
+		{
+			return BoundingBox(Center - HalfExtent, Center + HalfExtent);
+		}
+
+		inline bool IsValid() const
+		{
+			return Min.X <= Max.X && Min.Y <= Max.Y && Min.Z <= Max.Z;
+		}
+
+		inline Vector3f GetCenter() const
+		{
+			return (Min + Max) * 0.5f;
+		}
+
+		inline Vector3f GetExtent() const
+		{
+			return Max - Min;
+		}
+
+		inline Float GetSurfaceArea() const
+		{
+			if (!IsValid())
+			{
+				return 0.0f;
+			}
+
+			const Vector3f E = Max - Min;
+			{
+				return 2.0f * (E.X * E.Y + E.Y * E.Z + E.Z * E.X);
+			}
+		}
+
+		inline void Add
+		(
+			const Vector3f & Point
+		)
+		{
+			Min = Min.ComponentMin(Point);
+			Max = Max.ComponentMax(Point);
+		}
+
+		inline void Add
+		(
+			const BoundingBox & Other
+		)
+		{
+			Min = Min.ComponentMin(Other.Min);
+			Max = Max.ComponentMax(Other.Max);
+		}
+
+		inline bool Contains
+		(
+			const BoundingBox & Other
+		)	const
+		{
+			return
+				Other.Min.X >= Min.X && Other.Max.X <= Max.X &&
+				Other.Min.Y >= Min.Y && Other.Max.Y <= Max.Y &&
+				Other.Min.Z >= Min.Z && Other.Max.Z <= Max.Z;
+		}
+
+		inline bool Intersects
+		(
+			const BoundingBox & Other
+		)	const
+		{
+			return
+				Other.Min.X <= Max.X && Other.Max.X >= Min.X &&
+				Other.Min.Y <= Max.Y && Other.Max.Y >= Min.Y &&
+				Other.Min.Z <= Max.Z && Other.Max.Z >= Min.Z;
+		}
+
+		inline bool Intersects
+		(
+			const SpatialSphere & Sphere
+		)	const
+		{
+			const Vector3f Closest = Sphere.Center.ComponentMax(Min).ComponentMin(Max);
+			{
+				return (Closest - Sphere.Center).SizeSquared() <= Sphere.Radius * Sphere.Radius;
+			}
+		}
+
+		inline bool Intersects
+		(
+			const ViewFrustum & Frustum
+		)	const
+		{
+			return Frustum.IntersectsBox(Min, Max - Min);
+		}
+
+		/************************************************************
+		*
+		*	Slab test, returns the entry distance along the ray.
+		*
+		************************************************************/
+
+		inline bool Intersects
+		(
+			const SpatialRay	&	Ray,
+			const Vector3f		&	InverseDirection,
+				  Float			&	Distance
+		)	const
+		{
+			Float TMin = 0.0f;
+			Float TMax = Ray.Length;
+
+			for (int32 N = 0; N < 3; ++N)
+			{
+				Float T0 = (Min.Component(N) - Ray.Origin.Component(N)) * InverseDirection.Component(N);
+				Float T1 = (Max.Component(N) - Ray.Origin.Component(N)) * InverseDirection.Component(N);
+
+				if (T0 > T1)
+				{
+					std::swap(T0, T1);
+				}
+
+				TMin = Math::Max(TMin, T0);
+				TMax = Math::Min(TMax, T1);
+
+				if (TMin > TMax)
+				{
+					return false;
+				}
+			}
+
+			Distance = TMin;
+
+			return true;
+		}
+	};
+}
@@ -70,7 +70,7 @@ namespace D3D
 		ErrorCode CompileShaderGroupVariation
 		(
 			TArray<ShaderMacro*, NumShaderTypes>	Macros,
-			SharedPointer<CGrpShader>				Result
+			SharedPointer<CGrpShader>			&	Result
 		) const;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectX/D3D.h>
+#include <Utils/Shader/CompileScheduler.h>
 
 namespace D3D
 {
@@ -8,13 +9,19 @@ namespace D3D
 	{
 		friend class RShader;
 		friend class CGrpShader;
-		friend class CFileNotifyCallback;
 
 	private:
 
-		TMutex								Mutex;
-		WString								ShaderDefaultDirectory;
-		TVector<SharedPointer<RShader> >	Shaders;
+		TMutex										Mutex;
+		WString										ShaderDefaultDirectory;
+		THashMap<Uint64, SharedPointer<RShader> >	Shaders;
+		ShaderCache::CShaderCache					Cache;
+		ShaderCache::CCompileScheduler				Scheduler;
+		bool										CompilerInitialized = false;
+
+	private:
+
+		void InitializeCompiler();
 
 	public:
 
@@ -30,23 +37,48 @@ namespace D3D
 		(
 			const	WString					& Path,
 			const	String					& EntryPoint,
+			const	String					& Target,
 			const	TVector<ShaderMacro>	& Macros,
 					SharedPointer<RShader>	& Result
 		)	const;
 
-		bool GetShaderByPathEntrypoint
+		bool GetShader
 		(
-			const	WString					& Path,
-			const	String					& EntryPoint,
+			const	Uint64					  KeyHash,
 					SharedPointer<RShader>	& Result
 		)	const;
 
-		bool GetShaderByPath
+		inline ShaderCache::ShaderCacheStats GetCacheStats() const
+		{
+			return Cache.GetStats();
+		}
+
+		// Compiles into the cache on a worker, a later InitializeShader with the same arguments loads the result.
+		// A custom include handler has to outlive the compile.
+
+		Uint64 ScheduleShader
 		(
 			const	WString					& Path,
-					SharedPointer<RShader>	& Result
+			const	String					& EntryPoint,
+			const	String					& Target,
+			const	TVector<ShaderMacro>	& Macros,
+					ShaderInclude			* Includes = NULL,
+			const	Int32					  Priority = ShaderCache::CompilePriorityNormal
+		);
+
+		bool PrioritizeShader
+		(
+			const	Uint64	KeyHash,
+			const	Int32	Priority = ShaderCache::CompilePriorityVisible
+		);
+
+		bool IsShaderPending
+		(
+			const	Uint64	KeyHash
 		)	const;
 
+		void WaitForShaders();
+
 		void Update();
 		ErrorCode EnableDevelopmentMode();
 
@@ -111,8 +143,8 @@ namespace D3D
 
 		ErrorCode OnUpdateShader
 		(
-			const WString & Path
-		)	const;
+			const Uint64 KeyHash
+		);
 
 		ErrorCode InitializeShader
 		(
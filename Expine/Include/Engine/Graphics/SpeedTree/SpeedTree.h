@@ -3,6 +3,8 @@
 #include "Raw/RawResource.h"
 #include "Scene/Object/StaticObject.h"
 #include "Object/Mesh.h"
+#include "Resource/Texture/TextureStreaming.h"
+#include "Resource/Texture/TextureCache.h"
 #include "Utils/File/File.h"
 #include "ThirdParty/SpeedTree/Core/Core.h"
 
@@ -65,6 +67,11 @@ namespace D3D
 
 			const KRenderState * RenderState;
 
+			// Diffuse and normal map as the static mesh pipeline binds them.
+
+			ShaderTextureInfo				Textures[NumMaterialTextures];
+			bool							HasTexture[NumMaterialTextures] = {};
+
 			SPTMaterial
 			(
 						KMaterialStatic	*	ParentMaterial,
@@ -75,6 +82,14 @@ namespace D3D
 			);
 
 			virtual void FreeComponents() override {};
+
+			virtual const ShaderTextureInfo * GetTexture
+			(
+				const EMaterialTexture Texture
+			)	const override
+			{
+				return HasTexture[Texture] ? &Textures[Texture] : NULL;
+			}
 		};
 
 		class CMaterialLoader
@@ -104,6 +119,8 @@ namespace D3D
 
 			SPTMaterial * StaticMaterial = 0;
 
+			TVector<TextureStreamingHandle> StreamedTextures;
+
 		public:
 
 			ErrorCode LoadMaterial
@@ -118,6 +135,11 @@ namespace D3D
 			{
 				return StaticMaterial;
 			}
+
+			const TVector<TextureStreamingHandle> & GetStreamedTextures() const
+			{
+				return StreamedTextures;
+			}
 		};
 
 	private:
@@ -128,6 +150,16 @@ namespace D3D
 
 		SpeedTree::CCore Core;
 
+		KStaticMesh * StaticMesh = NULL;
+
+		// Bounds of all lods relative to the tree origin.
+
+		BoundingBox LocalBounds;
+
+		// Textures of all materials whose mips are loaded on demand.
+
+		TVector<TextureStreamingHandle> StreamedTextures;
+
 	private:
 
 		void ProcessTriangleCorners
@@ -166,12 +198,53 @@ namespace D3D
 		);
 
 		inline const char * GetLastError() const;
+
+		inline KStaticMesh * GetStaticMesh() const
+		{
+			return StaticMesh;
+		}
+
+		inline const BoundingBox & GetLocalBounds() const
+		{
+			return LocalBounds;
+		}
+
+		void RequestTextureMips
+		(
+			const Float ScreenSize
+		)	const;
 	};
 
 	class CSpeedTreeObjectController : public ISceneObjectController
 	{
+	private:
+
+		Vector3f Position;
+		Vector3f Rotation;
+
 	public:
 
+		inline CSpeedTreeObjectController
+		(
+			const Vector3f & Position,
+			const Vector3f & Rotation
+		) :
+			Position(Position),
+			Rotation(Rotation)
+		{
+			Environment = NULL;
+		}
+
+		virtual const Vector3f & GetCenterPosition() const override
+		{
+			return Position;
+		}
+
+		virtual const Vector3f & GetRotation() const override
+		{
+			return Rotation;
+		}
+
 		virtual bool InsideFrustum
 		(
 			const ViewFrustum & Frustum
@@ -210,9 +283,18 @@ namespace D3D
 			return ObjectTypeSpeedTree;
 		}
 
-		virtual void Render
+		virtual BoundingBox GetBounds() const override;
+
+		virtual void GatherInstances
+		(
+					CInstanceBatchBuilder & Builder,
+			const	Uint32					Lod,
+			const	Uint32					ObjectId
+		)	const override;
+
+		virtual void RequestTextureMips
 		(
-			const CSceneRenderer * Renderer
+			const Float ScreenSize
 		)	const override;
 	};
 }
\ No newline at end of file
@@ -5,64 +5,107 @@
 #include "Singleton.h"
 #include "ErrorCode.h"
 
+#include "Utils/Log/AsyncLog.h"
+#include "Utils/Parsing/NumberParsing.h"
+
+#include <cstdio>
 #include <sstream>
 #include <io.h>
 #include <fstream>
 #include <iostream>
+#include <type_traits>
 
 namespace D3D
 {
 	enum ELogLevel
 	{
-		LogInfo,
-		LogWarning,
-		LogError,
-		LogException,
-		LogFatal,
-		LogNum
+		LogInfo			= Logging::LevelInfo,
+		LogWarning		= Logging::LevelWarning,
+		LogError		= Logging::LevelError,
+		LogException	= Logging::LevelException,
+		LogFatal		= Logging::LevelFatal,
+		LogNum			= Logging::LevelNum
 	};
 
+	/************************************************************
+	*
+	*	Collects the text streamed in one statement and hands it
+	*	to the asynchronous log as a record, EndLine and the end
+	*	of the statement close a record.
+	*
+	*	Text is still built on the calling thread. Code that logs
+	*	often should use the LOG_ macros, which defer formatting
+	*	to the writer and limit records per call site.
+	*
+	************************************************************/
+
 	class CErrorLog
 	{
 	private:
 
-		std::wstringstream InputStream;
+		static Logging::LogSite Sites[LogNum];
 
 	private:
 
-		static CErrorLog LogInstance[LogNum];
+		ELogLevel	Level;
+		String		Line;
+
+		void Submit();
 
 	public:
 
 		template<ELogLevel Level = LogInfo>
-		static inline CErrorLog & Log()
+		static inline CErrorLog Log()
 		{
-			return LogInstance[Level];
+			return CErrorLog(Level);
 		}
 
 		template<ELogLevel Level = LogInfo, class... Arguments>
-		static inline CErrorLog & Log(Arguments&&... Args)
+		static inline CErrorLog Log(Arguments&&... Args)
 		{
-			return (LogInstance[Level] << ... << Args);
+			CErrorLog Entry(Level);
+			{
+				(Entry << ... << Args);
+			}
+
+			return Entry;
 		}
 
-		CErrorLog() = default;
-		CErrorLog(const CErrorLog & Other)
+		explicit CErrorLog
+		(
+			const ELogLevel Level
+		)
+			: Level(Level)
+		{}
+
+		CErrorLog(CErrorLog && Other)
+			: Level(Other.Level)
+			, Line(std::move(Other.Line))
 		{
-			InputStream.copyfmt(Other.InputStream);
+			Other.Line.clear();
 		}
 
-		inline CErrorLog & operator << 
+		CErrorLog(const CErrorLog &) = delete;
+		CErrorLog & operator=(const CErrorLog &) = delete;
+
+		~CErrorLog()
+		{
+			if (!Line.empty())
+			{
+				Submit();
+			}
+		}
+
+		inline CErrorLog & operator <<
 		(
 			const char * Log
 		)
 		{
-			if constexpr (IsDebugMode)
+			if (Log)
 			{
-				std::cout << Log;
+				Line += Log;
 			}
 
-			InputStream << Log;
 			return *this;
 		}
 
@@ -71,12 +114,41 @@ namespace D3D
 			const ErrorCode & Code
 		)
 		{
-			if constexpr (IsDebugMode)
+			char Text[16];
+			{
+				Line.append(Text, snprintf(Text, sizeof(Text), "0x%08X", static_cast<unsigned int>(Code.Result)));
+			}
+
+			return *this;
+		}
+
+		template<class Type, class = typename std::enable_if<std::is_arithmetic<Type>::value || std::is_enum<Type>::value>::type>
+		inline CErrorLog & operator <<
+		(
+			const Type Value
+		)
+		{
+			if constexpr (std::is_same<Type, bool>::value)
+			{
+				Line += Value ? "true" : "false";
+			}
+			else if constexpr (std::is_same<Type, char>::value)
+			{
+				Line.push_back(Value);
+			}
+			else if constexpr (std::is_enum<Type>::value)
+			{
+				Line += std::to_string(static_cast<typename std::underlying_type<Type>::type>(Value));
+			}
+			else if constexpr (std::is_floating_point<Type>::value)
 			{
-				std::cout << Code;
+				Line += Parsing::FormatFloat(Value);
+			}
+			else
+			{
+				Line += std::to_string(Value);
 			}
 
-			InputStream << Code;
 			return *this;
 		}
 
@@ -88,49 +160,35 @@ namespace D3D
 			return Function(*this);
 		}
 
+		// Wide text is converted to UTF-8, paths outside of ASCII stay readable.
+
 		inline CErrorLog & operator <<
 		(
 			const WString & Log
 		)
 		{
-			if constexpr (IsDebugMode)
-			{
-				std::wcout << Log;
-			}
-
-			InputStream << Log;
+			Logging::AppendUTF8(Log.data(), Log.size(), Line);
 			return *this;
 		}
 
-		inline CErrorLog & operator << 
+		inline CErrorLog & operator <<
 		(
 			const String & Log
 		)
 		{
-			if constexpr (IsDebugMode)
-			{
-				std::cout << Log;
-			}
-
-			InputStream << WString(Log.begin(), Log.end());
+			Line += Log;
 			return *this;
 		}
 
 		inline CErrorLog & DoEndLine()
 		{
-			if constexpr (IsDebugMode)
-			{
-				std::wcout << std::endl;
-			}
-
-			InputStream << std::endl;
-
+			Submit();
 			return *this;
 		}
 
 		static inline CErrorLog & EndLine(CErrorLog & Log)
 		{
-			return Log << "\n";
+			return Log.DoEndLine();
 		}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+namespace Archive
+{
+	namespace LZ
+	{
+		/************************************************************
+		*
+		*	Byte oriented LZ77 codec in the style of LZ4. A block
+		*	is a sequence of tokens, each holding a run of literals
+		*	followed by a match of at least four bytes within the
+		*	last 64 KiB. Blocks carry no header, the decoded size
+		*	has to be known by the caller.
+		*
+		************************************************************/
+
+		static constexpr size_t MinMatch = 4;
+		static constexpr size_t MaxOffset = 65535;
+
+		// Worst case size of an encoded block.
+
+		inline size_t GetBound
+		(
+			const size_t Size
+		)
+		{
+			return Size + Size / 255 + 16;
+		}
+
+		// Returns the encoded size, zero if the output would not be smaller than the input.
+
+		size_t Compress
+		(
+			const Byte	*	Source,
+			const size_t	SourceSize,
+				  Byte	*	Destination,
+			const size_t	DestinationCapacity
+		);
+
+		// Fails unless the block decodes to exactly DestinationSize bytes.
+
+		bool Decompress
+		(
+			const Byte	*	Source,
+			const size_t	SourceSize,
+				  Byte	*	Destination,
+			const size_t	DestinationSize
+		);
+	}
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include "Utils/File/MappedFile.h"
+
+namespace Archive
+{
+	/************************************************************
+	*
+	*	Pack file layout, little endian:
+	*
+	*	PackHeader
+	*	Entry data, each entry aligned on its own
+	*	PackEntry[NumEntries], sorted by path
+	*	PackChunk[NumChunks]
+	*	Uint32[NumSlots], open addressed path hash index
+	*	Path strings, not terminated
+	*
+	*	Paths are stored normalized, lower case with forward
+	*	slashes. Compressed entries are split into chunks that
+	*	decode independently, chunks that do not shrink are
+	*	stored as is.
+	*
+	************************************************************/
+
+	static constexpr Uint32 PackMagic = 0x4B415045; // EPAK
+	static constexpr Uint32 PackVersion = 1;
+
+	static constexpr Uint32 PackEmptySlot = 0xFFFFFFFF;
+	static constexpr Uint32 PackChunkStored = 0x80000000;
+
+	enum EPackEntryFlags
+	{
+		PackEntryCompressed = 1 << 0
+	};
+
+	struct PackHeader
+	{
+		Uint32	Magic;
+		Uint32	Version;
+		Uint32	NumEntries;
+		Uint32	NumChunks;
+		Uint32	NumSlots;
+		Uint32	ChunkSize;
+		Uint64	EntriesOffset;
+		Uint64	ChunksOffset;
+		Uint64	SlotsOffset;
+		Uint64	NamesOffset;
+		Uint64	NamesSize;
+	};
+
+	struct PackEntry
+	{
+		Uint64	PathHash;
+		Uint64	Offset;
+		Uint64	Size;
+		Uint64	StoredSize;
+		Uint32	NameOffset;
+		Uint32	NameLength;
+		Uint32	Flags;
+		Uint32	FirstChunk;
+	};
+
+	struct PackChunk
+	{
+		// Relative to the entry data.
+
+		Uint32	Offset;
+
+		// Encoded size, PackChunkStored marks uncompressed chunks.
+
+		Uint32	Size;
+	};
+
+	// Lower case with forward slashes and no leading separator.
+
+	String NormalizePath
+	(
+		const WStringView & Path
+	);
+
+	String NormalizePath
+	(
+		const StringView & Path
+	);
+
+	Uint64 HashPath
+	(
+		const StringView & NormalizedPath
+	);
+
+	/************************************************************
+	*
+	*	Read only access to a mapped pack. Uncompressed entries
+	*	are returned as views into the mapping without a copy.
+	*	All methods are safe to call from several threads.
+	*
+	************************************************************/
+
+	class CPackFile
+	{
+	private:
+
+		File::CMappedFile	Mapping;
+
+		const PackHeader *	Header = NULL;
+		const PackEntry *	Entries = NULL;
+		const PackChunk *	Chunks = NULL;
+		const Uint32 *		Slots = NULL;
+		const char *		Names = NULL;
+
+	private:
+
+		bool Validate();
+
+		bool DecodeChunk
+		(
+			const PackEntry	& Entry,
+			const Uint32	  Chunk,
+				  Byte		* Destination
+		)	const;
+
+	public:
+
+		CPackFile() = default;
+
+		CPackFile(const CPackFile &) = delete;
+		CPackFile & operator=(const CPackFile &) = delete;
+
+		bool Open
+		(
+			const WString & Path
+		);
+
+		void Close();
+
+		// Entry of the path, NULL if the pack does not contain it.
+
+		const PackEntry * Find
+		(
+			const WStringView & Path
+		)	const;
+
+		const PackEntry * FindNormalized
+		(
+			const StringView	& NormalizedPath,
+			const Uint64		  Hash
+		)	const;
+
+		// Data of an uncompressed entry, NULL for compressed ones.
+
+		const Byte * GetView
+		(
+			const PackEntry & Entry
+		)	const;
+
+		bool Read
+		(
+			const PackEntry		& Entry,
+				  TVector<Byte>	& Output
+		)	const;
+
+		// Decodes only the chunks covering the range.
+
+		bool ReadRange
+		(
+			const PackEntry	& Entry,
+			const Uint64	  Offset,
+			const Uint64	  Bytes,
+				  Byte		* Destination
+		)	const;
+
+		void Prefetch
+		(
+			const PackEntry & Entry
+		)	const;
+
+		inline bool IsOpen() const
+		{
+			return Header != NULL;
+		}
+
+		inline Uint32 GetNumEntries() const
+		{
+			return Header ? Header->NumEntries : 0;
+		}
+
+		inline const PackEntry & GetEntry
+		(
+			const Uint32 Index
+		)	const
+		{
+			return Entries[Index];
+		}
+
+		inline StringView GetPath
+		(
+			const PackEntry & Entry
+		)	const
+		{
+			return StringView(Names + Entry.NameOffset, Entry.NameLength);
+		}
+	};
+
+	/************************************************************
+	*
+	*	Builds a pack from files and memory. Entries are
+	*	compressed in parallel and written in path order, so
+	*	the same input always yields the same pack.
+	*
+	************************************************************/
+
+	class CPackWriter
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			Uint32	ChunkSize = 64 * 1024;
+
+			// Uncompressed entries start on a page so they can be mapped directly.
+
+			Uint32	Alignment = 4096;
+			Uint32	CompressedAlignment = 16;
+
+			bool	Compress = true;
+
+			// Entries that do not shrink below this fraction are stored.
+
+			Float	MaxCompressedRatio = 0.9f;
+		};
+
+	private:
+
+		struct Source
+		{
+			String			Path;
+			WString			FilePath;
+			TVector<Byte>	Data;
+			bool			Compress;
+		};
+
+	private:
+
+		InitializeOptions	Options;
+		TVector<Source>		Sources;
+
+	public:
+
+		CPackWriter() = default;
+		CPackWriter
+		(
+			const InitializeOptions & Options
+		) :
+			Options(Options)
+		{}
+
+		// The file is read when the pack is written.
+
+		void AddFile
+		(
+			const WStringView	& Path,
+			const WString		& FilePath,
+			const bool			  Compress = true
+		);
+
+		void AddData
+		(
+			const WStringView	& Path,
+				  TVector<Byte>	&& Data,
+			const bool			  Compress = true
+		);
+
+		// Fails on duplicate paths and unreadable files.
+
+		bool Write
+		(
+			const WString & OutputPath
+		);
+
+		inline size_t GetNumEntries() const
+		{
+			return Sources.size();
+		}
+	};
+}
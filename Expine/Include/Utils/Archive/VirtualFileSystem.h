@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Utils/Archive/PackFile.h"
+
+namespace Archive
+{
+	// Contents of a file, either a view into a mapped pack or an owned copy.
+
+	class CFileData
+	{
+	private:
+
+		TVector<Byte>	Storage;
+		const Byte *	Data = NULL;
+		Uint64			Size = 0;
+		bool			View = false;
+
+	public:
+
+		CFileData() = default;
+
+		CFileData(const CFileData &) = delete;
+		CFileData & operator=(const CFileData &) = delete;
+
+		CFileData(CFileData && Other);
+		CFileData & operator=(CFileData && Other);
+
+		void SetView
+		(
+			const Byte		* Data,
+			const Uint64	  Size
+		);
+
+		void SetStorage
+		(
+			TVector<Byte> && Storage
+		);
+
+		// Copies a view, owned data is moved out.
+
+		void DetachContent
+		(
+			TVector<Byte> & Result
+		);
+
+		inline const Byte * GetData() const
+		{
+			return Data;
+		}
+
+		inline Uint64 GetSize() const
+		{
+			return Size;
+		}
+
+		inline bool IsView() const
+		{
+			return View;
+		}
+	};
+
+	/************************************************************
+	*
+	*	Resolves asset paths against a stack of mounts. Later
+	*	mounts take precedence, so loose directories mounted
+	*	after the packs override their entries during
+	*	development. Mounting is not thread safe, lookups and
+	*	reads are.
+	*
+	************************************************************/
+
+	class CVirtualFileSystem
+	{
+	private:
+
+		struct Mount
+		{
+			WString					Directory;
+			TUniquePtr<CPackFile>	Pack;
+		};
+
+	private:
+
+		TVector<Mount> Mounts;
+
+	private:
+
+		bool FindFile
+		(
+			const WStringView		& Path,
+			const String			& Normalized,
+			const Uint64			  Hash,
+			const CPackFile		*&	Pack,
+			const PackEntry		*&	Entry,
+				  WString			& FilePath
+		)	const;
+
+	public:
+
+		bool MountPack
+		(
+			const WString & Path
+		);
+
+		void MountDirectory
+		(
+			const WString & Directory
+		);
+
+		void UnmountAll();
+
+		bool Exists
+		(
+			const WStringView & Path
+		)	const;
+
+		// Uncompressed pack entries are mapped without a copy.
+
+		bool Open
+		(
+			const WStringView	& Path,
+				  CFileData		& Data
+		)	const;
+
+		bool Read
+		(
+			const WStringView	& Path,
+				  TVector<Byte>	& Output
+		)	const;
+
+		// Starts paging in pack data ahead of the actual read.
+
+		void Prefetch
+		(
+			const WStringView & Path
+		)	const;
+
+		inline size_t GetNumMounts() const
+		{
+			return Mounts.size();
+		}
+	};
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <string_view>
+
+struct StringTableStats
+{
+	Uint64 NumStrings = 0;
+	Uint64 NumBytes = 0;
+	Uint64 IndexCapacity = 0;
+};
+
+/************************************************************
+*
+*	Interns strings into 32 bit indices. Every distinct text
+*	is stored once, null terminated, in blocks that are never
+*	moved or freed, so a view of an interned string stays
+*	valid for the lifetime of the process.
+*
+*	Lookups never lock. Entries are published to a hash index
+*	of indices, a full index is replaced by a larger one and
+*	kept alive for readers still probing it. Inserts of new
+*	strings are serialized.
+*
+*	Index 0 is the empty string.
+*
+************************************************************/
+
+template<class Char>
+class TStringTable
+{
+public:
+
+	typedef std::basic_string_view<Char> TView;
+
+	static constexpr Uint32 NotFound = ~0u;
+
+private:
+
+	struct Entry
+	{
+		const Char *	Data;
+		Uint32			Length;
+		Uint64			Hash;
+	};
+
+	struct IndexTable
+	{
+		Uint32							Mask;
+		TUniquePtr<std::atomic<Uint32>[]>	Slots;
+	};
+
+	static constexpr Uint32 PageBits = 12;
+	static constexpr Uint32 PageSize = 1u << PageBits;
+	static constexpr Uint32 MaxPages = 4096;
+	static constexpr size_t BlockSize = 64 * 1024;
+
+	std::atomic<Entry *>				Pages[MaxPages];
+	std::atomic<IndexTable *>			Index;
+
+	// Only touched under the mutex.
+
+	mutable TMutex						Mutex;
+	Uint32								NumEntries = 0;
+	TVector<TUniquePtr<Entry[]> >		EntryPages;
+	TVector<TUniquePtr<IndexTable> >	IndexTables;
+	TVector<TUniquePtr<Char[]> >		Blocks;
+	Char *								BlockCursor = NULL;
+	size_t								BlockRemaining = 0;
+	Uint64								NumBytes = 0;
+
+private:
+
+	inline const Entry & GetEntry
+	(
+		const Uint32 Index
+	)	const
+	{
+		return Pages[Index >> PageBits].load(std::memory_order_acquire)[Index & (PageSize - 1)];
+	}
+
+	Uint32 Probe
+	(
+		const IndexTable	& Table,
+		const TView			& Text,
+		const Uint64		  Hash
+	)	const;
+
+	const Char * Store
+	(
+		const TView & Text
+	);
+
+	void Grow();
+
+public:
+
+	TStringTable();
+
+	TStringTable(const TStringTable &) = delete;
+	TStringTable & operator=(const TStringTable &) = delete;
+
+	// Never destroyed, handles may be used while static objects are torn down.
+
+	static TStringTable & Global();
+
+	static Uint64 Hash
+	(
+		const TView & Text
+	);
+
+	// Forward slashes, no repeated or trailing separators, "." and resolvable ".." segments removed.
+	// ASCII letters are lowered, other characters are kept as they are. Paths differing in case only
+	// become one key, as they name one file on Windows. Only use it for keys of case insensitive sources.
+
+	static void NormalizePath
+	(
+		const TView						& Path,
+			  std::basic_string<Char>	& Result
+	);
+
+	Uint32 Intern
+	(
+		const TView & Text
+	);
+
+	// NotFound when the text was never interned.
+
+	Uint32 Find
+	(
+		const TView & Text
+	)	const;
+
+	Uint32 InternPath
+	(
+		const TView & Path
+	);
+
+	Uint32 FindPath
+	(
+		const TView & Path
+	)	const;
+
+	inline TView Get
+	(
+		const Uint32 Index
+	)	const
+	{
+		const Entry & Value = GetEntry(Index);
+		{
+			return TView(Value.Data, Value.Length);
+		}
+	}
+
+	inline const Char * GetData
+	(
+		const Uint32 Index
+	)	const
+	{
+		return GetEntry(Index).Data;
+	}
+
+	inline Uint64 GetHash
+	(
+		const Uint32 Index
+	)	const
+	{
+		return GetEntry(Index).Hash;
+	}
+
+	StringTableStats GetStats() const;
+};
+
+extern template class TStringTable<char>;
+extern template class TStringTable<wchar_t>;
+
+/************************************************************
+*
+*	Handle of a string in the global table. Compares, orders
+*	and hashes as its index, the text is only read when asked
+*	for. Default constructed handles are the empty string.
+*
+************************************************************/
+
+template<class Char>
+class TInternedString
+{
+public:
+
+	typedef TStringTable<Char>				TTable;
+	typedef typename TTable::TView			TView;
+
+private:
+
+	Uint32 Index = 0;
+
+	explicit constexpr TInternedString
+	(
+		const Uint32 Index,
+		const bool
+	)
+		: Index(Index)
+	{}
+
+public:
+
+	constexpr TInternedString() = default;
+
+	explicit TInternedString
+	(
+		const TView & Text
+	)
+		: Index(TTable::Global().Intern(Text))
+	{}
+
+	explicit TInternedString
+	(
+		const Char * Text
+	)
+		: Index(TTable::Global().Intern(TView(Text)))
+	{}
+
+	// Normalized as by TStringTable::NormalizePath, so case is folded.
+
+	static inline TInternedString FromPath
+	(
+		const TView & Path
+	)
+	{
+		return TInternedString(TTable::Global().InternPath(Path), true);
+	}
+
+	// Looks up without interning, false when the text is unknown and so cannot be a key of any map.
+	// Result is left empty then, NotFound is no index of the table.
+
+	static inline bool Find
+	(
+		const TView				& Text,
+			  TInternedString	& Result
+	)
+	{
+		const Uint32 Found = TTable::Global().Find(Text);
+
+		if (Found == TTable::NotFound)
+		{
+			Result = TInternedString();
+			return false;
+		}
+
+		Result = TInternedString(Found, true);
+
+		return true;
+	}
+
+	static inline bool FindPath
+	(
+		const TView				& Path,
+			  TInternedString	& Result
+	)
+	{
+		const Uint32 Found = TTable::Global().FindPath(Path);
+
+		if (Found == TTable::NotFound)
+		{
+			Result = TInternedString();
+			return false;
+		}
+
+		Result = TInternedString(Found, true);
+
+		return true;
+	}
+
+	inline Uint32 GetIndex() const
+	{
+		return Index;
+	}
+
+	inline bool IsEmpty() const
+	{
+		return Index == 0;
+	}
+
+	inline TView GetView() const
+	{
+		return TTable::Global().Get(Index);
+	}
+
+	inline const Char * c_str() const
+	{
+		return TTable::Global().GetData(Index);
+	}
+
+	inline Uint64 GetHash() const
+	{
+		return TTable::Global().GetHash(Index);
+	}
+
+	inline operator TView() const
+	{
+		return GetView();
+	}
+
+	inline bool operator==(const TInternedString & Other) const
+	{
+		return Index == Other.Index;
+	}
+
+	inline bool operator!=(const TInternedString & Other) const
+	{
+		return Index != Other.Index;
+	}
+
+	inline bool operator<(const TInternedString & Other) const
+	{
+		return Index < Other.Index;
+	}
+};
+
+typedef TInternedString<char>		InternedString;
+typedef TInternedString<wchar_t>	InternedWString;
+
+namespace std
+{
+	template<class Char>
+	struct hash<TInternedString<Char> >
+	{
+		// Indices are dense, an odd multiplier keeps them apart in the low bits used by power of two tables.
+
+		inline size_t operator()(const TInternedString<Char> & Value) const
+		{
+			return static_cast<size_t>(Value.GetIndex() * 0x9E3779B97F4A7C15ull);
+		}
+	};
+}
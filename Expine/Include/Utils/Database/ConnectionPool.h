@@ -0,0 +1,256 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include "Utils/Database/SQLite.h"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace Database
+{
+	namespace SQLite
+	{
+		struct ConnectionPoolStats
+		{
+			Uint64 NumReads = 0;
+			Uint64 NumWrites = 0;
+			Uint64 NumFailedWrites = 0;
+			Uint64 NumBatches = 0;
+			Uint64 MaxBatchSize = 0;
+			Uint64 ReadMicroseconds = 0;
+			Uint64 WriteMicroseconds = 0;
+		};
+
+		/************************************************************
+		*
+		*	Concurrent access to one database file in WAL mode.
+		*
+		*	Reads run on a pool of workers, each owning a read only
+		*	connection with its own statement cache, so readers never
+		*	wait on each other or on the writer.
+		*
+		*	Writes are queued to a single writer connection. Queued
+		*	writes are committed together in one transaction, a batch
+		*	closes when it is full or when no further write arrives
+		*	within the batch window. A failing write reports its
+		*	error without affecting the others of its batch.
+		*
+		*	Futures of tasks still queued when the pool stops are
+		*	broken, reads are dropped while writes are committed.
+		*
+		************************************************************/
+
+		class CConnectionPool
+		{
+		public:
+
+			struct InitializeOptions
+			{
+				// UTF-8 path of the database file.
+
+				String	Path;
+
+				// Zero starts one reader per hardware thread.
+
+				Uint32	NumReaders = 0;
+
+				Uint32	MaxBatchSize = 256;
+				Uint32	BatchMicroseconds = 2000;
+
+				// Time a connection waits on a lock before failing with SQLITE_BUSY.
+
+				Uint32	BusyTimeoutMilliseconds = 5000;
+
+				// Opens the readers only, the file has to exist and keeps its journal mode.
+				// Writes fail with SQLITE_READONLY.
+
+				bool	ReadOnly = false;
+			};
+
+			typedef std::function<void(CDatabase & Connection)> TReadTask;
+			typedef std::function<int(CDatabase & Connection)> TWriteTask;
+
+		private:
+
+			struct WriteEntry
+			{
+				TWriteTask			Task;
+				std::promise<int>	Result;
+			};
+
+			InitializeOptions						Options;
+
+			TVector<TUniquePtr<CDatabase> >			Readers;
+			TVector<std::thread>					ReaderThreads;
+
+			TUniquePtr<CDatabase>					Writer;
+			std::thread								WriterThread;
+
+			mutable TMutex							Mutex;
+			std::condition_variable					ReadAvailable;
+			std::condition_variable					WriteAvailable;
+
+			TQueue<TReadTask>						ReadQueue;
+			TQueue<WriteEntry>						WriteQueue;
+
+			bool									Stopping = false;
+
+			// Set while the threads run, SubmitRead and WriteAsync only queue with it set.
+
+			bool									Running = false;
+
+			ConnectionPoolStats						Stats;
+
+		private:
+
+			// Opens the writer and switches the file to WAL mode.
+
+			int InitializeWriter();
+
+			void ReaderMain
+			(
+				CDatabase & Connection
+			);
+
+			void WriterMain();
+
+			void SubmitRead
+			(
+				TReadTask && Task
+			);
+
+		public:
+
+			CConnectionPool() = default;
+			~CConnectionPool();
+
+			CConnectionPool(const CConnectionPool &) = delete;
+			CConnectionPool & operator=(const CConnectionPool &) = delete;
+
+			// Creates the file when missing and switches it to WAL mode, fails with SQLITE_CANTOPEN when the file stays in another mode.
+			// Read only pools neither create nor switch the file.
+
+			int Initialize
+			(
+				const InitializeOptions & Options
+			);
+
+			void Stop();
+
+			inline bool IsRunning() const
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+				{
+					return Running;
+				}
+			}
+
+			// Runs the function on a reader, it must not hold on to the connection.
+
+			template
+			<
+				typename Function
+			>
+			inline auto ReadAsync
+			(
+				Function && Task
+			)	-> std::future<decltype(Task(std::declval<CDatabase&>()))>
+			{
+				typedef decltype(Task(std::declval<CDatabase&>())) ResultType;
+
+				auto Packaged = std::make_shared<std::packaged_task<ResultType(CDatabase&)> >(std::forward<Function>(Task));
+
+				std::future<ResultType> Result = Packaged->get_future();
+				{
+					SubmitRead([Packaged](CDatabase & Connection)
+					{
+						(*Packaged)(Connection);
+					});
+				}
+
+				return Result;
+			}
+
+			// Collects the rows of the query on a reader, layout and result have to outlive the future.
+
+			template
+			<
+				typename	Type,
+				typename... Members,
+				typename... Types
+			>
+			inline std::future<int> QueryAllAsync
+			(
+				const	String							&		Query,
+				const	TRowLayout<Type, Members...>	&		Layout,
+						TVector<Type>					&		Result,
+				const	Types							&...	Values
+			)
+			{
+				return ReadAsync([Query, &Layout, &Result, Values...](CDatabase & Connection)
+				{
+					return Connection.QueryAll(Query, Layout, Result, Values...);
+				});
+			}
+
+			std::future<int> WriteAsync
+			(
+				TWriteTask && Task
+			);
+
+			// Executes a statement on the writer. Values are copied, C strings have to stay valid until the future is ready.
+
+			template
+			<
+				typename... Types
+			>
+			inline std::future<int> ExecuteAsync
+			(
+				const	String	&		Query,
+				const	Types	&...	Values
+			)
+			{
+				return WriteAsync([Query, Values...](CDatabase & Connection)
+				{
+					DataSet Result;
+					{
+						return Connection.ExecutePrepared(Query, Result, Values...);
+					}
+				});
+			}
+
+			// Blocks until every write queued so far is committed.
+
+			int Flush();
+
+			ConnectionPoolStats GetStats() const;
+		};
+	
+		// Pools by path, every loader reading the same file shares its readers.
+		// Read only requests share a writable pool of the path when one is open.
+
+		class CConnectionPoolManager : public CSingleton<CConnectionPoolManager>
+		{
+		private:
+
+			TMutex Mutex;
+
+		private:
+
+			TMap<String, SharedPointer<CConnectionPool> > OpenedPools;
+			TMap<String, SharedPointer<CConnectionPool> > OpenedReadOnlyPools;
+
+		public:
+
+			SharedPointer<CConnectionPool> OpenPool
+			(
+				const String	& Path,
+				const bool		  ReadOnly = false
+			);
+		};
+	}
+}
\ No newline at end of file
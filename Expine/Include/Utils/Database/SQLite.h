@@ -8,6 +8,9 @@
 
 #include "Private/sqlite3.h"
 
+#include <chrono>
+#include <tuple>
+
 namespace Database
 {
 	namespace SQLite
@@ -187,6 +190,528 @@ namespace Database
 			String Query;
 		};
 
+		struct StatementStats
+		{
+			String Query;
+
+			Uint64 NumExecutions = 0;
+			Uint64 NumRows = 0;
+			Uint64 PrepareMicroseconds = 0;
+			Uint64 TotalMicroseconds = 0;
+			Uint64 MaxMicroseconds = 0;
+		};
+
+		/************************************************************
+		*
+		*	A prepared statement owned by the statement cache of its
+		*	database. Parameters are bound by their one based index.
+		*	With SQLITE_STATIC text and blobs are not copied and have
+		*	to stay alive until the statement is reset, statements
+		*	outliving the call binding them use SQLITE_TRANSIENT.
+		*
+		************************************************************/
+
+		class CStatement
+		{
+			friend class CDatabase;
+			friend class CCursor;
+
+		private:
+
+			sqlite3_stmt *	Statement = NULL;
+			StatementStats	Stats;
+			Uint64			LastUsed = 0;
+
+		public:
+
+			CStatement
+			(
+				sqlite3_stmt	* Statement,
+				const String	& Query
+			);
+
+			~CStatement();
+
+			CStatement(const CStatement &) = delete;
+			CStatement & operator=(const CStatement &) = delete;
+
+			inline sqlite3_stmt * Get() const
+			{
+				return Statement;
+			}
+
+			inline const StatementStats & GetStats() const
+			{
+				return Stats;
+			}
+
+			template
+			<
+				typename Type
+			>
+			inline int Bind
+			(
+				const	int						  Index,
+				const	Type					& Value,
+				const	sqlite3_destructor_type	  Lifetime = SQLITE_STATIC
+			)
+			{
+				if constexpr (std::is_same<Type, std::nullptr_t>::value)
+				{
+					return sqlite3_bind_null(Statement, Index);
+				}
+				else if constexpr (std::is_integral<Type>::value || std::is_enum<Type>::value)
+				{
+					return sqlite3_bind_int64(Statement, Index, static_cast<sqlite3_int64>(Value));
+				}
+				else if constexpr (std::is_floating_point<Type>::value)
+				{
+					return sqlite3_bind_double(Statement, Index, static_cast<double>(Value));
+				}
+				else if constexpr (std::is_convertible<const Type &, const char *>::value)
+				{
+					return sqlite3_bind_text(Statement, Index, Value, -1, Lifetime);
+				}
+				else if constexpr (std::is_base_of<std::string, Type>::value || std::is_base_of<std::string_view, Type>::value)
+				{
+					return sqlite3_bind_text(Statement, Index, Value.data(), static_cast<int>(Value.size()), Lifetime);
+				}
+				else if constexpr (std::is_same<Type, TVector<Byte> >::value)
+				{
+					return sqlite3_bind_blob(Statement, Index, Value.data(), static_cast<int>(Value.size()), Lifetime);
+				}
+				else
+				{
+					static_assert(sizeof(Type) == 0, "Unsupported parameter type.");
+				}
+			}
+
+			// Binds the values to the parameters 1 to N, stops at the first error.
+
+			template
+			<
+				typename... Types
+			>
+			inline int BindAll
+			(
+				const sqlite3_destructor_type	Lifetime,
+				const Types &...				Values
+			)
+			{
+				int Index = 0;
+				int Result = SQLITE_OK;
+
+				((Result = Result == SQLITE_OK ? Bind(++Index, Values, Lifetime) : Result), ...);
+
+				return Result;
+			}
+
+			// Makes the statement reusable and drops the bound values.
+
+			void Reset();
+		};
+
+		struct BlobView
+		{
+			const Byte *	Data = NULL;
+			size_t			Size = 0;
+		};
+
+		/************************************************************
+		*
+		*	The current row of a cursor. Columns are read straight
+		*	from the statement, text and blob views stay valid until
+		*	the cursor moves on.
+		*
+		************************************************************/
+
+		class CRow
+		{
+		private:
+
+			sqlite3_stmt * Statement = NULL;
+
+		public:
+
+			CRow() = default;
+
+			inline explicit CRow
+			(
+				sqlite3_stmt * Statement
+			) :
+				Statement(Statement)
+			{}
+
+			inline int GetColumnCount() const
+			{
+				return sqlite3_column_count(Statement);
+			}
+
+			inline const char * GetColumnName
+			(
+				const int Column
+			)	const
+			{
+				return sqlite3_column_name(Statement, Column);
+			}
+
+			// Column names compare without case like SQL identifiers, -1 when missing.
+
+			int FindColumn
+			(
+				const char * Name
+			)	const;
+
+			inline bool IsNull
+			(
+				const int Column
+			)	const
+			{
+				return sqlite3_column_type(Statement, Column) == SQLITE_NULL;
+			}
+
+			inline Int64 GetInt64
+			(
+				const int Column
+			)	const
+			{
+				return sqlite3_column_int64(Statement, Column);
+			}
+
+			inline double GetDouble
+			(
+				const int Column
+			)	const
+			{
+				return sqlite3_column_double(Statement, Column);
+			}
+
+			inline StringView GetText
+			(
+				const int Column
+			)	const
+			{
+				const char * Text = reinterpret_cast<const char*>(sqlite3_column_text(Statement, Column));
+				{
+					return Text ? StringView(Text, sqlite3_column_bytes(Statement, Column)) : StringView();
+				}
+			}
+
+			inline BlobView GetBlobView
+			(
+				const int Column
+			)	const
+			{
+				BlobView View;
+				{
+					View.Data = reinterpret_cast<const Byte*>(sqlite3_column_blob(Statement, Column));
+					View.Size = View.Data ? sqlite3_column_bytes(Statement, Column) : 0;
+				}
+
+				return View;
+			}
+
+			// False for NULL and for columns out of range, the value is left untouched then.
+
+			template
+			<
+				typename Type
+			>
+			inline bool Get
+			(
+				const	int		Column,
+						Type	& Value
+			)	const
+			{
+				if (Column < 0 || Column >= GetColumnCount() || IsNull(Column))
+				{
+					return false;
+				}
+
+				if constexpr (std::is_same<Type, bool>::value)
+				{
+					Value = GetInt64(Column) != 0;
+				}
+				else if constexpr (std::is_integral<Type>::value || std::is_enum<Type>::value)
+				{
+					Value = static_cast<Type>(GetInt64(Column));
+				}
+				else if constexpr (std::is_floating_point<Type>::value)
+				{
+					Value = static_cast<Type>(GetDouble(Column));
+				}
+				else if constexpr (std::is_base_of<std::string, Type>::value || std::is_base_of<std::wstring, Type>::value)
+				{
+					const StringView Text = GetText(Column);
+					{
+						Value.assign(Text.begin(), Text.end());
+					}
+				}
+				else if constexpr (std::is_same<Type, StringView>::value)
+				{
+					Value = GetText(Column);
+				}
+				else if constexpr (std::is_same<Type, BlobView>::value)
+				{
+					Value = GetBlobView(Column);
+				}
+				else if constexpr (std::is_same<Type, TVector<Byte> >::value)
+				{
+					const BlobView Blob = GetBlobView(Column);
+					{
+						Value.assign(Blob.Data, Blob.Data + Blob.Size);
+					}
+				}
+				else
+				{
+					static_assert(sizeof(Type) == 0, "Unsupported column type.");
+				}
+
+				return true;
+			}
+
+			template
+			<
+				typename Type
+			>
+			inline bool Get
+			(
+				const	char	* Name,
+						Type	& Value
+			)	const
+			{
+				return Get(FindColumn(Name), Value);
+			}
+		};
+
+		template
+		<
+			typename Type,
+			typename Member
+		>
+		struct TColumn
+		{
+			const char *	Name;
+			Member Type::*	Field;
+		};
+
+		template
+		<
+			typename Type,
+			typename Member
+		>
+		constexpr TColumn<Type, Member> Column
+		(
+			const char		* Name,
+			Member Type::*	  Field
+		)
+		{
+			return { Name, Field };
+		}
+
+		/************************************************************
+		*
+		*	Maps result columns by name onto the members of a row
+		*	struct. Names are resolved once per query, every row is
+		*	then read by column index.
+		*
+		*	static const auto Layout = MakeRowLayout
+		*	(
+		*		Column("ObjectTableId", &Entry::Id),
+		*		Column("Data",			&Entry::Data)
+		*	);
+		*
+		************************************************************/
+
+		template
+		<
+			typename	Type,
+			typename... Members
+		>
+		class TRowLayout
+		{
+		public:
+
+			static constexpr size_t NumColumns = sizeof...(Members);
+
+			typedef TArray<int, NumColumns> IndexArray;
+
+		private:
+
+			std::tuple<TColumn<Type, Members>...> Columns;
+
+			template
+			<
+				size_t... N
+			>
+			inline void ReadColumns
+			(
+				const	CRow		& Row,
+				const	IndexArray	& Indices,
+						Type		& Value,
+				std::index_sequence<N...>
+			)	const
+			{
+				(Row.Get(Indices[N], Value.*(std::get<N>(Columns).Field)), ...);
+			}
+
+			template
+			<
+				size_t... N
+			>
+			inline bool ResolveColumns
+			(
+				const	CRow		& Row,
+						IndexArray	& Indices,
+				std::index_sequence<N...>
+			)	const
+			{
+				return (((Indices[N] = Row.FindColumn(std::get<N>(Columns).Name)) >= 0) && ...);
+			}
+
+		public:
+
+			constexpr TRowLayout
+			(
+				const TColumn<Type, Members> &... Columns
+			) :
+				Columns(Columns...)
+			{}
+
+			// False when the result lacks one of the columns.
+
+			inline bool Resolve
+			(
+				const	CRow		& Row,
+						IndexArray	& Indices
+			)	const
+			{
+				return ResolveColumns(Row, Indices, std::index_sequence_for<Members...>());
+			}
+
+			// NULL columns keep the member's value.
+
+			inline void Read
+			(
+				const	CRow		& Row,
+				const	IndexArray	& Indices,
+						Type		& Value
+			)	const
+			{
+				ReadColumns(Row, Indices, Value, std::index_sequence_for<Members...>());
+			}
+		};
+
+		template
+		<
+			typename	Type,
+			typename... Members
+		>
+		constexpr TRowLayout<Type, Members...> MakeRowLayout
+		(
+			const TColumn<Type, Members> &... Columns
+		)
+		{
+			return TRowLayout<Type, Members...>(Columns...);
+		}
+
+		/************************************************************
+		*
+		*	Streams the rows of a cached statement. The cursor holds
+		*	the execute mutex of its database until it is closed or
+		*	destroyed, so no other query may run on the database in
+		*	between, not even from the same thread.
+		*
+		************************************************************/
+
+		class CCursor
+		{
+			friend class CDatabase;
+
+		private:
+
+			std::unique_lock<TMutex>	Lock;
+			CStatement *				Statement = NULL;
+			CRow						Row;
+
+			int							ErrorCode = SQLITE_OK;
+			Uint64						NumRows = 0;
+			Uint64						Microseconds = 0;
+
+		public:
+
+			CCursor() = default;
+
+			CCursor
+			(
+				CCursor && Other
+			);
+
+			CCursor & operator=
+			(
+				CCursor && Other
+			);
+
+			~CCursor();
+
+			// Steps to the next row, false after the last row or on an error.
+
+			bool Next();
+
+			void Close();
+
+			// SQLITE_OK while rows remain and after the last one.
+
+			inline int GetErrorCode() const
+			{
+				return ErrorCode;
+			}
+
+			inline bool IsOpen() const
+			{
+				return Statement != NULL;
+			}
+
+			inline const CRow & GetRow() const
+			{
+				return Row;
+			}
+
+			// Appends one element per remaining row.
+
+			template
+			<
+				typename	Type,
+				typename... Members
+			>
+			inline int FetchAll
+			(
+				const	TRowLayout<Type, Members...>	& Layout,
+						TVector<Type>					& Result
+			)
+			{
+				if (!IsOpen())
+				{
+					return ErrorCode;
+				}
+
+				typename TRowLayout<Type, Members...>::IndexArray Indices;
+
+				if (!Layout.Resolve(Row, Indices))
+				{
+					Close();
+					return ErrorCode = SQLITE_RANGE;
+				}
+
+				while (Next())
+				{
+					Layout.Read(Row, Indices, Result.emplace_back());
+				}
+
+				return ErrorCode;
+			}
+		};
+
 		class CDatabase;
 		class CDatabaseManager : public CSingleton<CDatabaseManager>
 		{
@@ -225,6 +750,15 @@ namespace Database
 
 			sqlite3 * Database = NULL;
 
+		private:
+
+			// Prepared statements by their SQL text, the least recently used is finalized beyond MaxStatements.
+
+			static constexpr size_t MaxStatements = 128;
+
+			THashMap<String, TUniquePtr<CStatement> > Statements;
+			Uint64 StatementUses = 0;
+
 		private:
 
 			DataSet LastResult;
@@ -248,14 +782,129 @@ namespace Database
 			(
 				const String & Path
 			);
+
+			// Flags as for sqlite3_open_v2, SQLITE_OPEN_READONLY for pool readers.
+
+			int OpenDB
+			(
+				const String	& Path,
+				const int		  Flags
+			);
+
+			int SetBusyTimeout
+			(
+				const int Milliseconds
+			);
 			int Execute
 			(
 				const String & Query, DataSet & QueryResult
 			);
-			int ExecutePrepared
+
+			// Finds or prepares the statement for the query. The caller has to hold the execute mutex.
+
+			int Prepare
 			(
-				const String & Query, DataSet & QueryResult
+				const String & Query, CStatement *& Statement
+			);
+
+			// Steps through the bound statement, appends the rows and resets it.
+
+			int Fetch
+			(
+				CStatement & Statement, DataSet & QueryResult
 			);
+
+			template
+			<
+				typename... Types
+			>
+			inline int ExecutePrepared
+			(
+				const	String		&		Query, 
+						DataSet		&		QueryResult,
+				const	Types		&...	Values
+			)
+			{
+				std::scoped_lock<TMutex> Lock(ExecuteMutex);
+
+				CStatement * Statement;
+
+				int ErrorCode;
+
+				if ((ErrorCode = Prepare(Query, Statement)) != SQLITE_OK)
+				{
+					return ErrorCode;
+				}
+
+				// Stepped and reset before returning, the values outlive the bindings.
+
+				if ((ErrorCode = Statement->BindAll(SQLITE_STATIC, Values...)) != SQLITE_OK)
+				{
+					Statement->Reset();
+					return ErrorCode;
+				}
+
+				return Fetch(*Statement, QueryResult);
+			}
+
+			// Opens a cursor over the rows of the query, check IsOpen and GetErrorCode for failures.
+
+			template
+			<
+				typename... Types
+			>
+			inline CCursor Query
+			(
+				const	String		&		Query,
+				const	Types		&...	Values
+			)
+			{
+				CCursor Cursor;
+				{
+					Cursor.Lock = std::unique_lock<TMutex>(ExecuteMutex);
+				}
+
+				CStatement * Statement = NULL;
+
+				if ((Cursor.ErrorCode = Prepare(Query, Statement)) != SQLITE_OK)
+				{
+					Cursor.Lock.unlock();
+					return Cursor;
+				}
+
+				Cursor.Statement	= Statement;
+				Cursor.Row			= CRow(Statement->Get());
+
+				// The cursor steps after the call returned, temporary arguments are gone by then.
+
+				if ((Cursor.ErrorCode = Statement->BindAll(SQLITE_TRANSIENT, Values...)) != SQLITE_OK)
+				{
+					Cursor.Close();
+				}
+
+				return Cursor;
+			}
+
+			template
+			<
+				typename	Type,
+				typename... Members,
+				typename... Types
+			>
+			inline int QueryAll
+			(
+				const	String							&		Query,
+				const	TRowLayout<Type, Members...>	&		Layout,
+						TVector<Type>					&		Result,
+				const	Types							&...	Values
+			)
+			{
+				return this->Query(Query, Values...).FetchAll(Layout, Result);
+			}
+
+			TVector<StatementStats> GetStatementStats();
+
+			void ClearStatements();
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+#include "Singleton.h"
+
+#include "Utils/File/File.h"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace File
+{
+	enum EIOPriority
+	{
+		IOPriorityHigh,
+		IOPriorityNormal,
+		IOPriorityLow,
+		NumIOPriorities
+	};
+
+	/************************************************************
+	*
+	*	File opened for asynchronous reads. A second handle
+	*	bypassing the system cache is opened alongside when
+	*	the file system supports it, large reads go through
+	*	that one.
+	*
+	************************************************************/
+
+	class CAsyncFile
+	{
+		friend class CAsyncIO;
+
+	private:
+
+		// Native handle or descriptor, -1 when closed.
+
+		intptr_t	Handle = -1;
+		intptr_t	DirectHandle = -1;
+
+		Uint64		Size = 0;
+
+		// Set once the handles are bound to the completion port.
+
+		bool		Associated = false;
+
+	public:
+
+		CAsyncFile() = default;
+		~CAsyncFile();
+
+		CAsyncFile(const CAsyncFile &) = delete;
+		CAsyncFile & operator=(const CAsyncFile &) = delete;
+
+		bool Open
+		(
+			const WString & Path
+		);
+
+		void Close();
+
+		inline bool IsOpen() const
+		{
+			return Handle != -1;
+		}
+
+		inline bool HasDirectHandle() const
+		{
+			return DirectHandle != -1;
+		}
+
+		inline Uint64 GetSize() const
+		{
+			return Size;
+		}
+	};
+
+	// Called on the I/O thread once every byte of the request arrived or it failed.
+
+	typedef std::function<void(ErrorTypes Error)> TIOCallback;
+
+	struct IORequest
+	{
+		CAsyncFile *	File = NULL;
+		Uint64			Offset = 0;
+		Uint64			Size = 0;
+		Byte *			Destination = NULL;
+		EIOPriority		Priority = IOPriorityNormal;
+		TIOCallback		Callback;
+	};
+
+	struct IOStats
+	{
+		Uint64	NumRequests = 0;
+		Uint64	NumFailed = 0;
+		Uint64	NumPieces = 0;
+		Uint64	NumDirectPieces = 0;
+		Uint64	BytesRead = 0;
+		Uint32	MaxInFlight = 0;
+	};
+
+	/************************************************************
+	*
+	*	Asynchronous read engine. Requests are cut into pieces
+	*	that are kept in flight up to the queue depth, higher
+	*	priority pieces are issued first. Uses io_uring on
+	*	Linux and a completion port on Windows, other systems
+	*	and kernels without io_uring fall back to a pool of
+	*	threads doing blocking reads.
+	*
+	*	Reads of at least DirectThreshold bytes bypass the
+	*	system cache. They land in pooled sector aligned
+	*	buffers, registered with the ring where possible, and
+	*	are copied out from there.
+	*
+	************************************************************/
+
+	class CAsyncIO : public CSingleton<CAsyncIO>
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			Uint32	QueueDepth = 32;
+			Uint32	PieceSize = 1 << 20;
+			Uint64	DirectThreshold = 16ULL << 20;
+			Uint32	NumBuffers = 16;
+			bool	UseDirectIO = true;
+		};
+
+		struct Operation;
+		struct Piece;
+		class CBackend;
+
+		static constexpr Uint32 SectorSize = 4096;
+
+	private:
+
+		InitializeOptions			Options;
+
+		TUniquePtr<CBackend>		Backend;
+		std::thread					Thread;
+
+		TMutex						QueueMutex;
+		TDeque<Piece*>				Pending[NumIOPriorities];
+		bool						Running = false;
+
+		Byte *						BufferMemory = NULL;
+		TVector<Uint32>				FreeBuffers;
+		Uint32						InFlight = 0;
+
+		TMutex						StatsMutex;
+		IOStats						Stats;
+
+	private:
+
+		void Run();
+
+		void Dispatch();
+
+		void Complete
+		(
+			Piece		* Target,
+			const Int64	  Result
+		);
+
+		void Finish
+		(
+			Operation * Target
+		);
+
+	public:
+
+		CAsyncIO();
+		~CAsyncIO();
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		// Completes every queued request before returning.
+
+		void Shutdown();
+
+		void Submit
+		(
+			IORequest * Requests,
+			const size_t Count
+		);
+
+		std::future<ErrorTypes> Read
+		(
+			CAsyncFile		& File,
+			const Uint64	  Offset,
+			const Uint64	  Size,
+			Byte			* Destination,
+			const EIOPriority Priority = IOPriorityNormal
+		);
+
+		IOStats GetStats();
+
+		// Name of the platform backend in use.
+
+		const char * GetBackendName() const;
+
+		inline bool IsRunning() const
+		{
+			return Backend != NULL;
+		}
+
+		// Blocking on a read from inside a callback would never return.
+
+		inline bool IsIOThread() const
+		{
+			return std::this_thread::get_id() == Thread.get_id();
+		}
+
+		inline Byte * GetBuffer
+		(
+			const Uint32 Index
+		)	const
+		{
+			return BufferMemory + static_cast<size_t>(Index) * (Options.PieceSize + SectorSize);
+		}
+
+		inline const InitializeOptions & GetOptions() const
+		{
+			return Options;
+		}
+	};
+}
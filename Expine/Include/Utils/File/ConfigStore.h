@@ -0,0 +1,471 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+namespace File
+{
+	class CFileSystemWatcher;
+
+	enum EConfigValueType
+	{
+		ConfigValueString,
+		ConfigValueInt,
+		ConfigValueFloat,
+		ConfigValueBool
+	};
+
+	struct ConfigError
+	{
+		// Set by the store, parsers leave it empty.
+
+		WString	Path;
+
+		// Zero when the error is not tied to a line.
+
+		Uint32	Line = 0;
+		String	Key;
+		String	Message;
+	};
+
+	/************************************************************
+	*
+	*	Flat, immutable key value table. Every value is converted
+	*	once when the table is built, reads are a binary search
+	*	over the key hashes and never parse again.
+	*
+	*	Keys and texts live in one string pool, entries refer to
+	*	it by offset, so a table is written to and read from a
+	*	cache file as two plain blocks.
+	*
+	************************************************************/
+
+	class CConfigTable
+	{
+	public:
+
+		struct Entry
+		{
+			Uint64	KeyHash;
+			Uint32	KeyOffset;
+			Uint32	KeyLength;
+			Uint32	ValueOffset;
+			Uint32	ValueLength;
+			Uint32	Type;
+			Uint32	Line;
+			Int64	Integer;
+			double	Real;
+		};
+
+	private:
+
+		TVector<Entry>	Entries;
+		String			Pool;
+
+	public:
+
+		static Uint64 HashKey
+		(
+			const StringView & Key
+		);
+
+		// Parses XML in place, the buffer is modified and has to end with a null character.
+		// Elements become "Root.Child", attributes "Root.Child@Name", repeated siblings "Root.Child[1]".
+
+		bool ParseXML
+		(
+				  char					* Buffer,
+				  TVector<ConfigError>	& Errors
+		);
+
+		// Lines of "Key = Value", "[Section]" prefixes the following keys with "Section.".
+		// Lines starting with '#' or ';' are comments.
+
+		bool ParseText
+		(
+			const StringView			& Content,
+				  TVector<ConfigError>	& Errors
+		);
+
+		void Serialize
+		(
+			TVector<Byte> & Output
+		)	const;
+
+		bool Deserialize
+		(
+			const Byte		* Data,
+			const size_t	  Size
+		);
+
+		const Entry * Find
+		(
+			const StringView & Key
+		)	const;
+
+		inline bool Contains
+		(
+			const StringView & Key
+		)	const
+		{
+			return Find(Key) != NULL;
+		}
+
+		inline size_t GetNumEntries() const
+		{
+			return Entries.size();
+		}
+
+		inline const Entry & GetEntry
+		(
+			const size_t Index
+		)	const
+		{
+			return Entries[Index];
+		}
+
+		inline StringView GetKey
+		(
+			const Entry & Value
+		)	const
+		{
+			return StringView(Pool.data() + Value.KeyOffset, Value.KeyLength);
+		}
+
+		inline StringView GetText
+		(
+			const Entry & Value
+		)	const
+		{
+			return StringView(Pool.data() + Value.ValueOffset, Value.ValueLength);
+		}
+
+		// False when the key is missing or its value does not convert to the type.
+
+		template<class Type>
+		inline bool Get
+		(
+			const StringView	& Key,
+				  Type			& Value
+		)	const
+		{
+			const Entry * Found = Find(Key);
+
+			if (Found == NULL)
+			{
+				return false;
+			}
+
+			if constexpr (std::is_same<Type, bool>::value)
+			{
+				if (Found->Type != ConfigValueBool && Found->Type != ConfigValueInt)
+				{
+					return false;
+				}
+
+				Value = Found->Integer != 0;
+			}
+			else if constexpr (std::is_integral<Type>::value || std::is_enum<Type>::value)
+			{
+				if (Found->Type != ConfigValueInt)
+				{
+					return false;
+				}
+
+				Value = static_cast<Type>(Found->Integer);
+			}
+			else if constexpr (std::is_floating_point<Type>::value)
+			{
+				if (Found->Type != ConfigValueFloat && Found->Type != ConfigValueInt)
+				{
+					return false;
+				}
+
+				Value = static_cast<Type>(Found->Real);
+			}
+			else if constexpr (std::is_same<Type, StringView>::value)
+			{
+				Value = GetText(*Found);
+			}
+			else if constexpr (std::is_base_of<std::string, Type>::value)
+			{
+				const StringView Text = GetText(*Found);
+				{
+					Value.assign(Text.data(), Text.size());
+				}
+			}
+			else if constexpr (std::is_base_of<std::wstring, Type>::value)
+			{
+				const StringView Text = GetText(*Found);
+				{
+					Value.assign(Text.begin(), Text.end());
+				}
+			}
+			else
+			{
+				static_assert(std::is_same<Type, void>::value, "Unsupported config value type.");
+			}
+
+			return true;
+		}
+
+		template<class Type>
+		inline Type GetOr
+		(
+			const StringView	& Key,
+			const Type			& Default
+		)	const
+		{
+			Type Value;
+
+			if (!Get(Key, Value))
+			{
+				return Default;
+			}
+
+			return Value;
+		}
+
+		// Keys added, removed or changed from Previous to this table.
+
+		TVector<String> Diff
+		(
+			const CConfigTable & Previous
+		)	const;
+
+	private:
+
+		void Add
+		(
+			const StringView	& Key,
+			const StringView	& Value,
+			const Uint32		  Line
+		);
+
+		bool Finalize
+		(
+			TVector<ConfigError> & Errors
+		);
+	};
+
+	struct ConfigSchemaEntry
+	{
+		String				Key;
+		EConfigValueType	Type = ConfigValueString;
+		bool				Required = false;
+
+		// Inclusive bounds of numeric values.
+
+		double				Min = -std::numeric_limits<double>::infinity();
+		double				Max = std::numeric_limits<double>::infinity();
+	};
+
+	typedef TVector<ConfigSchemaEntry> ConfigSchema;
+
+	// Strings accept every value, floats accept integers as well.
+
+	bool ValidateConfig
+	(
+		const CConfigTable			& Table,
+		const ConfigSchema			& Schema,
+			  TVector<ConfigError>	& Errors
+	);
+
+	typedef std::shared_ptr<const CConfigTable> TConfigTablePtr;
+
+	struct ConfigChange
+	{
+		WString			Path;
+		TConfigTablePtr	Previous;
+		TConfigTablePtr	Current;
+		TVector<String>	ChangedKeys;
+	};
+
+	typedef std::function<void(const ConfigChange & Change)> TConfigChangeCallback;
+
+	struct ConfigStoreStats
+	{
+		Uint64 NumLoads = 0;
+		Uint64 NumCacheHits = 0;
+		Uint64 NumContentHits = 0;
+		Uint64 NumParsed = 0;
+		Uint64 NumFailed = 0;
+		Uint64 NumReloads = 0;
+		Uint64 ParseMicroseconds = 0;
+		Uint64 LoadMicroseconds = 0;
+	};
+
+	/************************************************************
+	*
+	*	Loads config files into tables and keeps them current.
+	*
+	*	Parsed tables are cached in <CacheDirectory>, one file
+	*	per config, stamped with the size, write time and content
+	*	hash of its source. An unchanged write time skips reading
+	*	the source, a touched but equal file is recognized by its
+	*	hash and never parsed again.
+	*
+	*	Watched directories mark changed configs, Update reloads
+	*	them on the calling thread and notifies subscribers. A
+	*	reload that fails to parse or validate keeps the previous
+	*	table and is reported through GetErrors.
+	*
+	************************************************************/
+
+	class CConfigStore
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			WString CacheDirectory = L"ConfigCache";
+
+			// Without the cache every load parses the source.
+
+			bool	UseCache = true;
+		};
+
+	private:
+
+		struct Subscription
+		{
+			Uint32					Handle;
+			TConfigChangeCallback	Callback;
+		};
+
+		struct Document
+		{
+			TConfigTablePtr			Table;
+			ConfigSchema			Schema;
+			TVector<Subscription>	Subscriptions;
+		};
+
+		InitializeOptions						Options;
+
+		mutable TMutex							Mutex;
+		THashMap<WString, Document>				Documents;
+		THashMap<Uint32, WString>				SubscriptionPaths;
+		Uint32									NextSubscription = 0;
+
+		THashSet<WString>						PendingReloads;
+		TVector<TUniquePtr<CFileSystemWatcher> >	Watchers;
+
+		TVector<ConfigError>					Errors;
+		ConfigStoreStats						Stats;
+
+	private:
+
+		WString GetCachePath
+		(
+			const WString & Path
+		)	const;
+
+		bool ReadTable
+		(
+			const WString				& Path,
+				  CConfigTable			& Table,
+				  TVector<ConfigError>	& Errors
+		);
+
+		void AddErrors
+		(
+			const WString				& Path,
+				  TVector<ConfigError>	& Errors
+		);
+
+		void WriteCache
+		(
+			const WString		& CachePath,
+			const Uint64		  SourceTime,
+			const Uint64		  SourceSize,
+			const Uint64		  ContentHash,
+			const CConfigTable	& Table
+		)	const;
+
+		bool LoadDocument
+		(
+			const WString				& Path,
+			const ConfigSchema			& Schema,
+				  TConfigTablePtr		& Result,
+				  TVector<ConfigError>	& Errors
+		);
+
+	public:
+
+		CConfigStore();
+		~CConfigStore();
+
+		CConfigStore(const CConfigStore &) = delete;
+		CConfigStore & operator=(const CConfigStore &) = delete;
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		// Files ending in ".xml" are parsed as XML, everything else as key value text.
+		// Returns the loaded table or null, a loaded config is not read again until it changes.
+
+		TConfigTablePtr Load
+		(
+			const WString & Path
+		);
+
+		TConfigTablePtr Get
+		(
+			const WString & Path
+		)	const;
+
+		// Validates the current table and every reload of the config.
+
+		bool SetSchema
+		(
+			const WString		& Path,
+			const ConfigSchema	& Schema
+		);
+
+		Uint32 Subscribe
+		(
+			const WString				& Path,
+			const TConfigChangeCallback	& Callback
+		);
+
+		void Unsubscribe
+		(
+			const Uint32 Handle
+		);
+
+		// Marks loaded configs below the directory for reload when their files change.
+		// Paths are made absolute and normalized, a config matches however it was loaded.
+
+		bool Watch
+		(
+			const WString & Directory
+		);
+
+		// Marks a loaded config for reload by the next Update.
+
+		void Invalidate
+		(
+			const WString & Path
+		);
+
+		// Reloads marked configs and calls their subscribers, returns the number of reloaded configs.
+
+		size_t Update();
+
+		TVector<ConfigError> GetErrors
+		(
+			const bool Clear = true
+		);
+
+		ConfigStoreStats GetStats() const;
+
+		void Clear();
+	};
+}
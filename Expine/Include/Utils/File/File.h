@@ -21,11 +21,11 @@ namespace File
 	{
 	private:
 
-		size_t			MappingSize;
-		size_t			MappingSizeMax;
+		size_t			MappingSize = 0;
+		size_t			MappingSizeMax = 0;
 		TVector<Byte>	MappingBytes;
-		void*			MappingHandle;
-		DWORD			AccessMem;
+		void*			MappingHandle = NULL;
+		DWORD			AccessMem = 0;
 
 	public:
 
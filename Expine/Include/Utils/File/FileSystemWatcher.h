@@ -1,118 +1,136 @@
 #pragma once
 
-#include "File.h"
-#include <WindowsH.h>
+#include "Defines.h"
+#include "Types.h"
+
+#include <chrono>
+#include <functional>
+#include <thread>
 
 namespace File
 {
-	class CFileSystemWatcher : protected OVERLAPPED
+	enum EFileChange
 	{
-	public:
+		FileChangeAdded,
+		FileChangeModified,
+		FileChangeRemoved
+	};
 
-		struct TFileNotifyInformation : public FILE_NOTIFY_INFORMATION
-		{
-			inline TFileNotifyInformation * Next()
-			{
-				if (NextEntryOffset == 0)
-				{
-					return NULL;
-				}
-
-				return reinterpret_cast<TFileNotifyInformation*>(reinterpret_cast<BYTE*>(this) + NextEntryOffset);
-			}
-
-			inline WString GetFileName()
-			{
-				return WString
-				(
-					this->FileName,
-					this->FileName + this->FileNameLength / sizeof(wchar_t)
-				);
-			}
-		};
+	struct FileChange
+	{
+		// Relative to the watched directory, separated by '/'.
 
-		struct IChangeNotifyCallback
-		{
-		public:
-			virtual bool OnFileChangeNotify
-			(
-				TFileNotifyInformation * pChanges
-			) PURE;
-		};
+		WString		Path;
+		EFileChange	Type;
+	};
 
-	private:
+	struct FileChangeSet
+	{
+		TVector<FileChange> Changes;
 
-		IChangeNotifyCallback	*	FileNotifyCallback				= NULL;
-		TFileNotifyInformation	*	FileNotifyInformation			= NULL;
-		DWORD						FileNotifyInformationCount		= 0;
-		DWORD						FileNotifyInformationMax		= 0;
+		// Events were dropped by the system, anything below the directory may have changed.
 
-		HANDLE						CompletionPort					= INVALID_HANDLE_VALUE;
-		HANDLE						DirectoryHandle					= INVALID_HANDLE_VALUE;
-		LPCWSTR						DirectoryPath					= NULL;
+		bool Overflow = false;
+	};
+
+	// Called on the watcher thread with one batch per burst of changes.
+
+	typedef std::function<void(const FileChangeSet & Changes)> TFileChangeCallback;
 
+	/************************************************************
+	*
+	*	Watches a directory tree and reports changes in batches.
+	*	Events are collected until the directory was quiet for
+	*	DebounceMs, or for at most MaxDelayMs, and repeated
+	*	events on the same file are folded into one, so a save
+	*	that writes a file several times shows up once.
+	*
+	*	Uses inotify on Linux, one watch per directory, and
+	*	ReadDirectoryChangesW on Windows.
+	*
+	************************************************************/
+
+	class CFileSystemWatcher
+	{
 	public:
 
-		inline HANDLE GetCompletionPortHandle() 
-		{ 
-			return CompletionPort; 
-		}
+		struct InitializeOptions
+		{
+			WString				Directory;
+			bool				Recursive = true;
 
-		inline HANDLE GetDirectoryHandle() 
-		{ 
-			return DirectoryHandle; 
-		}
+			Uint32				DebounceMs = 100;
+			Uint32				MaxDelayMs = 1000;
 
-		inline LPCWSTR GetDirectoryPath() 
-		{ 
-			return DirectoryPath; 
-		}
+			// Glob patterns like "*.hlsl" or "Textures/**.dds", empty reports every file.
 
-		inline void SetCallback
-		(
-			IChangeNotifyCallback * pCallback
-		)
+			TVector<WString>	Patterns;
+		};
+
+		class CBackend;
+
+		struct PendingChange
 		{
-			FileNotifyCallback = pCallback;
-		}
+			EFileChange First;
+			EFileChange Last;
+		};
 
 	private:
-		
-		bool OnChangeNotify();
 
-		static void CALLBACK OnDirectoryChange
-		(
-			DWORD			dwErrorCode,
-			DWORD			dwNotifyFilter,
-			LPOVERLAPPED	lpOverlapped
-		);
+		InitializeOptions					Options;
+		TFileChangeCallback					Callback;
 
-		HRESULT WatchDirectoryChangesAsync();
-		HRESULT InitializeNotifyArray();
-		HRESULT InitializeCompletionRoutine();
-		HRESULT InitializeDirectory();
+		TUniquePtr<CBackend>				Backend;
+		std::thread							Thread;
+		TAtomic<bool>						Running;
 
-	public:
+		THashMap<WString, PendingChange>	Pending;
+		bool								PendingOverflow = false;
+
+	private:
 
-		HRESULT Stop();
+		void Run();
 
-		CFileSystemWatcher
+		void Add
 		(
-			SIZE_T iMaxNotifies
+			const WString		& Path,
+			const EFileChange	  Type
 		);
 
+		void Deliver();
+
+	public:
+
+		CFileSystemWatcher();
 		~CFileSystemWatcher();
 
-		HRESULT Initialize
+		CFileSystemWatcher(const CFileSystemWatcher &) = delete;
+		CFileSystemWatcher & operator=(const CFileSystemWatcher &) = delete;
+
+		bool Initialize
 		(
-			LPCWSTR pFileDirectory
+			const InitializeOptions		& Options,
+			const TFileChangeCallback	& Callback
 		);
 
-		HRESULT Watch();
+		void Stop();
 
-		HRESULT Watch
-		(
-			DWORD dwWaitMS
-		);
+		inline bool IsWatching() const
+		{
+			return Running;
+		}
+
+		inline const WString & GetDirectory() const
+		{
+			return Options.Directory;
+		}
 	};
-}
\ No newline at end of file
+
+	// '*' and '?' stop at '/', "**" does not. Patterns without a '/' apply to the file name only.
+
+	bool MatchGlob
+	(
+		const WStringView & Pattern,
+		const WStringView & Path
+	);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+namespace File
+{
+	enum EMappedFileAdvice
+	{
+		MappedFileAdviceNormal,
+		MappedFileAdviceSequential,
+		MappedFileAdviceRandom
+	};
+
+	/************************************************************
+	*
+	*	Read only view of a whole file. Pages are faulted in on
+	*	first access, Prefetch can be used to start reading a
+	*	range ahead of time.
+	*
+	************************************************************/
+
+	class CMappedFile
+	{
+	private:
+
+		const Byte *	Data = NULL;
+		Uint64			Size = 0;
+		bool			Opened = false;
+
+	public:
+
+		CMappedFile() = default;
+		~CMappedFile();
+
+		CMappedFile(const CMappedFile &) = delete;
+		CMappedFile & operator=(const CMappedFile &) = delete;
+
+		CMappedFile
+		(
+			CMappedFile && Other
+		);
+
+		CMappedFile & operator=
+		(
+			CMappedFile && Other
+		);
+
+		bool Open
+		(
+			const WString & Path
+		);
+
+		bool Open
+		(
+			const String & Path
+		);
+
+		void Close();
+
+		// Hint only, failures are ignored.
+
+		void Advise
+		(
+			const EMappedFileAdvice Advice
+		)	const;
+
+		void Prefetch
+		(
+			const Uint64 Offset,
+			const Uint64 Bytes
+		)	const;
+
+		inline bool IsOpen() const
+		{
+			return Opened;
+		}
+
+		inline const Byte * GetData() const
+		{
+			return Data;
+		}
+
+		inline Uint64 GetSize() const
+		{
+			return Size;
+		}
+	};
+}
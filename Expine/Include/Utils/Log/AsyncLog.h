@@ -0,0 +1,583 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+
+// Records below this level are removed at compile time, 0 keeps every level.
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+namespace Logging
+{
+	enum ELogLevel
+	{
+		LevelInfo,
+		LevelWarning,
+		LevelError,
+		LevelException,
+		LevelFatal,
+		LevelNum
+	};
+
+	static constexpr Uint32 MinLevel = LOG_MIN_LEVEL;
+
+	// Records per second and call site, zero for no limit.
+
+	static constexpr Uint32 DefaultRateLimit = 100;
+
+	const char * GetLevelName
+	(
+		const ELogLevel Level
+	);
+
+	/************************************************************
+	*
+	*	Static description of a place that logs. Constructed as
+	*	a constant, so a site costs no initialization guard, and
+	*	never destroyed, the writer refers to it by address.
+	*
+	*	Format texts use "{}" for the next argument, "{{" and
+	*	"}}" for braces.
+	*
+	************************************************************/
+
+	struct LogSite
+	{
+		const char *		Category;
+		const char *		Format;
+		const char *		File;
+		Uint32				Line;
+		ELogLevel			Level;
+		Uint32				RateLimit;
+
+		// Rate limit window, written by every thread logging at the site.
+
+		std::atomic<Uint64>	WindowStart;
+		std::atomic<Uint32>	WindowCount;
+		std::atomic<Uint32>	Suppressed;
+
+		constexpr LogSite
+		(
+			const char *	Category,
+			const char *	Format,
+			const char *	File,
+			const Uint32	Line,
+			const ELogLevel	Level,
+			const Uint32	RateLimit = DefaultRateLimit
+		)
+			: Category(Category)
+			, Format(Format)
+			, File(File)
+			, Line(Line)
+			, Level(Level)
+			, RateLimit(RateLimit)
+			, WindowStart(0)
+			, WindowCount(0)
+			, Suppressed(0)
+		{}
+
+		LogSite(const LogSite &) = delete;
+		LogSite & operator=(const LogSite &) = delete;
+	};
+
+	/************************************************************
+	*
+	*	Records are fixed blocks of RecordSize bytes. The first
+	*	block starts with a header, arguments follow as a byte
+	*	stream continued in up to MaxRecordBlocks - 1 further
+	*	blocks. Strings are copied, longer ones are cut to fit.
+	*
+	************************************************************/
+
+	static constexpr size_t RecordSize = 128;
+	static constexpr size_t MaxRecordBlocks = 16;
+
+	struct RecordHeader
+	{
+		// Nanoseconds of the steady clock.
+
+		Uint64			Timestamp;
+		const LogSite *	Site;
+
+		// Records dropped by the rate limit of the site since the previous record.
+
+		Uint32			Suppressed;
+		Uint16			PayloadSize;
+		Uint8			NumBlocks;
+		Uint8			Reserved;
+	};
+
+	static constexpr size_t MaxPayloadSize = MaxRecordBlocks * RecordSize - sizeof(RecordHeader);
+
+	enum EArgumentType
+	{
+		ArgumentInt,
+		ArgumentUint,
+		ArgumentFloat,
+		ArgumentBool,
+		ArgumentPointer,
+		ArgumentString,
+		ArgumentWString,
+		ArgumentHex
+	};
+
+	// Written as 0x and at least eight upper case hex digits, for error codes and flags.
+
+	struct HexValue
+	{
+		Uint64 Value;
+	};
+
+	template<class Type>
+	inline HexValue Hex
+	(
+		const Type Value
+	)
+	{
+		static_assert(std::is_integral<Type>::value, "Integer expected.");
+
+		return HexValue{ static_cast<Uint64>(static_cast<typename std::make_unsigned<Type>::type>(Value)) };
+	}
+
+	// Appends the UTF-16 (Windows) or UTF-32 text as UTF-8.
+
+	void AppendUTF8
+	(
+		const wchar_t	* Text,
+		const size_t	  Length,
+			  String	& Output
+	);
+
+	inline Uint64 GetTimestamp()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	class CArgumentWriter
+	{
+	private:
+
+		Byte *	Data;
+		size_t	Size = 0;
+
+		inline void WriteScalar
+		(
+			const EArgumentType	  Type,
+			const void			* Value
+		)
+		{
+			if (Size + 1 + sizeof(Uint64) > MaxPayloadSize)
+			{
+				return;
+			}
+
+			Data[Size] = static_cast<Byte>(Type);
+			{
+				memcpy(Data + Size + 1, Value, sizeof(Uint64));
+			}
+
+			Size += 1 + sizeof(Uint64);
+		}
+
+		inline void WriteText
+		(
+			const EArgumentType	  Type,
+			const void			* Text,
+			const size_t		  Length,
+			const size_t		  CharSize
+		)
+		{
+			if (Size + 1 + sizeof(Uint16) > MaxPayloadSize)
+			{
+				return;
+			}
+
+			const Uint16 Copied = static_cast<Uint16>(std::min(Length, (MaxPayloadSize - Size - 1 - sizeof(Uint16)) / CharSize));
+
+			Data[Size] = static_cast<Byte>(Type);
+			{
+				memcpy(Data + Size + 1, &Copied, sizeof(Uint16));
+				memcpy(Data + Size + 1 + sizeof(Uint16), Text, Copied * CharSize);
+			}
+
+			Size += 1 + sizeof(Uint16) + Copied * CharSize;
+		}
+
+	public:
+
+		explicit CArgumentWriter
+		(
+			Byte * Data
+		)
+			: Data(Data)
+		{}
+
+		inline size_t GetSize() const
+		{
+			return Size;
+		}
+
+		template<class Type>
+		inline void Write
+		(
+			const Type & Value
+		)
+		{
+			if constexpr (std::is_same<Type, HexValue>::value)
+			{
+				WriteScalar(ArgumentHex, &Value.Value);
+			}
+			else if constexpr (std::is_same<Type, bool>::value)
+			{
+				const Uint64 Wide = Value ? 1 : 0;
+				{
+					WriteScalar(ArgumentBool, &Wide);
+				}
+			}
+			else if constexpr (std::is_enum<Type>::value)
+			{
+				Write(static_cast<typename std::underlying_type<Type>::type>(Value));
+			}
+			else if constexpr (std::is_integral<Type>::value && std::is_signed<Type>::value)
+			{
+				const Int64 Wide = Value;
+				{
+					WriteScalar(ArgumentInt, &Wide);
+				}
+			}
+			else if constexpr (std::is_integral<Type>::value)
+			{
+				const Uint64 Wide = Value;
+				{
+					WriteScalar(ArgumentUint, &Wide);
+				}
+			}
+			else if constexpr (std::is_floating_point<Type>::value)
+			{
+				const double Wide = Value;
+				{
+					WriteScalar(ArgumentFloat, &Wide);
+				}
+			}
+			else if constexpr (std::is_pointer<Type>::value && (std::is_convertible<Type, std::string_view>::value || std::is_convertible<Type, std::wstring_view>::value))
+			{
+				if (Value == NULL)
+				{
+					WriteText(ArgumentString, "(null)", 6, sizeof(char));
+				}
+				else
+				{
+					Write(std::basic_string_view<typename std::remove_const<typename std::remove_pointer<Type>::type>::type>(Value));
+				}
+			}
+			else if constexpr (std::is_convertible<const Type &, std::string_view>::value)
+			{
+				const std::string_view Text = Value;
+				{
+					WriteText(ArgumentString, Text.data(), Text.size(), sizeof(char));
+				}
+			}
+			else if constexpr (std::is_convertible<const Type &, std::wstring_view>::value)
+			{
+				const std::wstring_view Text = Value;
+				{
+					WriteText(ArgumentWString, Text.data(), Text.size(), sizeof(wchar_t));
+				}
+			}
+			else if constexpr (std::is_pointer<Type>::value)
+			{
+				const Uint64 Wide = reinterpret_cast<uintptr_t>(Value);
+				{
+					WriteScalar(ArgumentPointer, &Wide);
+				}
+			}
+			else
+			{
+				static_assert(std::is_same<Type, void>::value, "Unsupported log argument type.");
+			}
+		}
+	};
+
+	// Copies an encoded record into the ring of the calling thread, a full ring drops it.
+
+	void Submit
+	(
+		const LogSite	& Site,
+		const Uint64	  Timestamp,
+		const Uint32	  Suppressed,
+		const Byte		* Payload,
+		const size_t	  PayloadSize
+	);
+
+	// Blocks until every record submitted so far by any thread has been written.
+
+	void Flush();
+
+	// Counts the record against the rate limit of its site, false when it has to be dropped.
+
+	inline bool Admit
+	(
+			  LogSite	& Site,
+		const Uint64	  Timestamp,
+			  Uint32	& Suppressed
+	)
+	{
+		Suppressed = 0;
+
+		if (Site.RateLimit == 0)
+		{
+			return true;
+		}
+
+		Uint64 Start = Site.WindowStart.load(std::memory_order_relaxed);
+
+		if (Timestamp - Start >= 1000000000ull)
+		{
+			// One thread opens the next window, the others count into it.
+
+			if (Site.WindowStart.compare_exchange_strong(Start, Timestamp, std::memory_order_relaxed))
+			{
+				Site.WindowCount.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		if (Site.WindowCount.fetch_add(1, std::memory_order_relaxed) >= Site.RateLimit)
+		{
+			Site.Suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		if (Site.Suppressed.load(std::memory_order_relaxed) != 0)
+		{
+			Suppressed = Site.Suppressed.exchange(0, std::memory_order_relaxed);
+		}
+
+		return true;
+	}
+
+	/************************************************************
+	*
+	*	Logs at a site. The calling thread only takes the time,
+	*	encodes the arguments and copies the record into its own
+	*	ring, formatting and file access happen on the writer.
+	*
+	*	Fatal records are flushed before returning.
+	*
+	************************************************************/
+
+	template<class... Arguments>
+	inline void Write
+	(
+			  LogSite	& Site,
+		const Arguments	&... Args
+	)
+	{
+		const Uint64 Timestamp = GetTimestamp();
+
+		Uint32 Suppressed;
+
+		if (!Admit(Site, Timestamp, Suppressed))
+		{
+			return;
+		}
+
+		Byte Payload[MaxPayloadSize];
+
+		CArgumentWriter Writer(Payload);
+		{
+			(Writer.Write(Args), ...);
+		}
+
+		Submit(Site, Timestamp, Suppressed, Payload, Writer.GetSize());
+
+		if (Site.Level >= LevelFatal)
+		{
+			Flush();
+		}
+	}
+
+	struct LogStats
+	{
+		Uint64 NumRecords = 0;
+		Uint64 NumDropped = 0;
+
+		// Rate limited records, counted when the next record of their site passes.
+
+		Uint64 NumSuppressed = 0;
+		Uint64 NumBatches = 0;
+		Uint64 MaxBatchSize = 0;
+		Uint64 NumRotations = 0;
+		Uint64 NumThreads = 0;
+		Uint64 WriteMicroseconds = 0;
+	};
+
+	/************************************************************
+	*
+	*	Background writer draining the per thread rings.
+	*
+	*	Every thread that logs owns a single producer ring of
+	*	RingCapacity records, so producers never wait on a lock
+	*	or on each other. The writer wakes every FlushMilliseconds,
+	*	orders the drained records of all threads by time, formats
+	*	them and appends them to <Directory>/<Name>.log and to
+	*	stdout.
+	*
+	*	A file reaching MaxFileSize is renamed to <Name>.1.log,
+	*	older ones move up to <Name>.<MaxFiles - 1>.log, the last
+	*	one is deleted.
+	*
+	*	Records logged before Initialize wait in their rings.
+	*
+	************************************************************/
+
+	class CLogWriter
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			WString	Directory = L"Logs";
+			WString	Name = L"Expine";
+
+			Uint64	MaxFileSize = 8 * 1024 * 1024;
+			Uint32	MaxFiles = 5;
+
+			bool	WriteFile = true;
+			bool	WriteStdout = true;
+
+			Uint32	FlushMilliseconds = 10;
+
+			// Records per thread, rounded up to a power of two. Applies to threads logging for the first time.
+
+			Uint32	RingCapacity = 1024;
+		};
+
+	private:
+
+		InitializeOptions			Options;
+
+		std::thread					Thread;
+
+		mutable TMutex				Mutex;
+		std::condition_variable		Wake;
+		std::condition_variable		Flushed;
+
+		struct DrainedRecord
+		{
+			Uint64	Timestamp;
+			Uint32	Thread;
+			size_t	Offset;
+		};
+
+		// Reused between batches, only touched by the writer thread.
+
+		TVector<DrainedRecord>		Drained;
+		TVector<Byte>				Staging;
+
+		Uint64						FlushRequested = 0;
+		Uint64						FlushCompleted = 0;
+		bool						Stopping = false;
+
+		std::ofstream				Stream;
+		Uint64						FileSize = 0;
+
+		// Steady and system clock taken together, converts record times to wall time.
+
+		Int64						SteadyBase = 0;
+		Int64						SystemBase = 0;
+
+		Int64						DateSecond = -1;
+		char						Date[32] = {};
+
+		LogStats					Stats;
+
+	private:
+
+		void WriterMain();
+
+		size_t Drain
+		(
+			String & Output
+		);
+
+		void FormatRecord
+		(
+			const RecordHeader	& Header,
+			const Uint32		  Thread,
+			const Byte			* Payload,
+				  String		& Output
+		);
+
+		void WriteOutput
+		(
+			const String & Output
+		);
+
+		WString GetFilePath
+		(
+			const Uint32 Index
+		)	const;
+
+		bool OpenFile();
+		void RotateFiles();
+
+	public:
+
+		CLogWriter() = default;
+		~CLogWriter();
+
+		CLogWriter(const CLogWriter &) = delete;
+		CLogWriter & operator=(const CLogWriter &) = delete;
+
+		static CLogWriter & Instance();
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		// Writes every pending record before returning.
+
+		void Stop();
+
+		void Flush();
+
+		LogStats GetStats() const;
+
+		inline bool IsRunning() const
+		{
+			return Thread.joinable();
+		}
+	};
+}
+
+#define LOG_AT_LEVEL(Level, Category, RateLimit, Format, ...)												\
+	do																										\
+	{																										\
+		if constexpr (static_cast<Uint32>(Level) >= Logging::MinLevel)										\
+		{																									\
+			static Logging::LogSite LogCallSite(Category, Format, __FILE__, __LINE__, Level, RateLimit);	\
+			{																								\
+				Logging::Write(LogCallSite, ##__VA_ARGS__);													\
+			}																								\
+		}																									\
+	}																										\
+	while (false)
+
+#define LOG_INFO(Category, Format, ...)			LOG_AT_LEVEL(Logging::LevelInfo, Category, Logging::DefaultRateLimit, Format, ##__VA_ARGS__)
+#define LOG_WARNING(Category, Format, ...)		LOG_AT_LEVEL(Logging::LevelWarning, Category, Logging::DefaultRateLimit, Format, ##__VA_ARGS__)
+#define LOG_ERROR(Category, Format, ...)		LOG_AT_LEVEL(Logging::LevelError, Category, Logging::DefaultRateLimit, Format, ##__VA_ARGS__)
+#define LOG_FATAL(Category, Format, ...)		LOG_AT_LEVEL(Logging::LevelFatal, Category, 0, Format, ##__VA_ARGS__)
+
+// Explicit records per second for the site, zero for no limit.
+
+#define LOG_LIMITED(Level, Category, RateLimit, Format, ...)	LOG_AT_LEVEL(Level, Category, RateLimit, Format, ##__VA_ARGS__)
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <limits>
+#include <type_traits>
+
+namespace Parsing
+{
+	/************************************************************
+	*
+	*	Scanning over [First, Last), 16 bytes per step. Each
+	*	returns Last when nothing matches. Whitespace is ' ',
+	*	'\t', '\r' and '\n'.
+	*
+	************************************************************/
+
+	const char * SkipWhitespace
+	(
+		const char * First,
+		const char * Last
+	);
+
+	const char * FindWhitespace
+	(
+		const char * First,
+		const char * Last
+	);
+
+	const char * FindCharacter
+	(
+		const char * First,
+		const char * Last,
+		const char	 Character
+	);
+
+	/************************************************************
+	*
+	*	Number parsing at First, nothing in front of the number
+	*	is skipped. Returns the end of the number or NULL when
+	*	there is none or it does not fit the type.
+	*
+	*	Floats take [+-]digits[.digits][e[+-]digits] as well as
+	*	inf, infinity and nan, and are rounded correctly. Eight
+	*	digits are converted at once, the binary value follows
+	*	from a 128 bit product with a power of five, only inputs
+	*	with more than 19 significant digits and a few halfway
+	*	cases fall back to the C runtime.
+	*
+	*	Integers take [+-]digits, decimal only.
+	*
+	************************************************************/
+
+	const char * ParseFloat
+	(
+		const char	* First,
+		const char	* Last,
+			  double	& Value
+	);
+
+	const char * ParseFloat
+	(
+		const char	* First,
+		const char	* Last,
+			  float		& Value
+	);
+
+	const char * ParseInteger
+	(
+		const char	* First,
+		const char	* Last,
+			  Int64		& Value
+	);
+
+	const char * ParseInteger
+	(
+		const char	* First,
+		const char	* Last,
+			  Uint64	& Value
+	);
+
+	template<class Type>
+	inline const char * ParseNumber
+	(
+		const char	* First,
+		const char	* Last,
+			  Type		& Value
+	)
+	{
+		static_assert(std::is_arithmetic<Type>::value && !std::is_same<Type, bool>::value, "Number type expected.");
+
+		if constexpr (std::is_floating_point<Type>::value)
+		{
+			if constexpr (std::is_same<Type, float>::value)
+			{
+				return ParseFloat(First, Last, Value);
+			}
+			else
+			{
+				double Wide;
+
+				const char * End = ParseFloat(First, Last, Wide);
+
+				if (End)
+				{
+					Value = static_cast<Type>(Wide);
+				}
+
+				return End;
+			}
+		}
+		else
+		{
+			typedef typename std::conditional<std::is_signed<Type>::value, Int64, Uint64>::type WideType;
+
+			WideType Wide;
+
+			const char * End = ParseInteger(First, Last, Wide);
+
+			if (End == NULL || Wide < static_cast<WideType>(std::numeric_limits<Type>::min()) || Wide > static_cast<WideType>(std::numeric_limits<Type>::max()))
+			{
+				return NULL;
+			}
+
+			Value = static_cast<Type>(Wide);
+
+			return End;
+		}
+	}
+
+	// The whole text has to be the number.
+
+	template<class Type>
+	inline bool TryParse
+	(
+		const StringView	& Text,
+			  Type			& Value
+	)
+	{
+		const char * Last = Text.data() + Text.size();
+		{
+			return ParseNumber(Text.data(), Last, Value) == Last;
+		}
+	}
+
+	// Numbers separated by whitespace, whitespace around them is skipped. Returns the end of the last one or NULL.
+
+	template<class Type>
+	inline const char * ParseList
+	(
+		const char		* First,
+		const char		* Last,
+			  Type		* Values,
+		const size_t	  Count
+	)
+	{
+		for (size_t N = 0; N < Count; ++N)
+		{
+			First = SkipWhitespace(First, Last);
+
+			if ((First = ParseNumber(First, Last, Values[N])) == NULL)
+			{
+				return NULL;
+			}
+
+			if (First != Last && N + 1 < Count && *First != ' ' && *First != '\t' && *First != '\r' && *First != '\n')
+			{
+				return NULL;
+			}
+		}
+
+		return First;
+	}
+
+	/************************************************************
+	*
+	*	Shortest text that parses back to the same value, the
+	*	nearest one if several are equally short. Plain notation
+	*	for decimal exponents from -5 to 16, scientific beyond.
+	*
+	*	Writes at most MaxFloatLength characters without a null
+	*	character and returns the end.
+	*
+	************************************************************/
+
+	static constexpr size_t MaxFloatLength = 32;
+
+	char * FormatFloat
+	(
+		const double	  Value,
+			  char		* Buffer
+	);
+
+	char * FormatFloat
+	(
+		const float		  Value,
+			  char		* Buffer
+	);
+
+	template<class Type>
+	inline String FormatFloat
+	(
+		const Type Value
+	)
+	{
+		char Buffer[MaxFloatLength];
+		{
+			return String(Buffer, FormatFloat(Value, Buffer));
+		}
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include "Utils/Shader/ShaderCache.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace ShaderCache
+{
+	struct PermutationAxis
+	{
+		String			Name;
+		TVector<String>	Values;
+	};
+
+	// Every combination of one value per axis. Repeated axes and values are merged, so no macro set is produced twice.
+
+	TVector<TVector<ShaderDefine> > EnumeratePermutations
+	(
+		const TVector<PermutationAxis> & Axes
+	);
+
+	enum ECompilePriority
+	{
+		CompilePriorityBackground	= -100,
+		CompilePriorityNormal		= 0,
+		CompilePriorityVisible		= 100
+	};
+
+	struct CompileResult
+	{
+		Uint64				KeyHash = 0;
+		bool				Succeeded = false;
+		bool				FromCache = false;
+		ShaderCompileOutput	Output;
+	};
+
+	typedef std::function<void(const CompileResult & Result)> TCompileCallback;
+
+	struct CompileRequest
+	{
+		ShaderKey							Key;
+
+		// Called from several workers at once.
+
+		std::shared_ptr<IShaderCompiler>	Compiler;
+
+		Int32								Priority = CompilePriorityNormal;
+		TCompileCallback					Callback;
+	};
+
+	struct CompileSchedulerStats
+	{
+		Uint64 NumSubmitted = 0;
+		Uint64 NumMerged = 0;
+		Uint64 NumCompleted = 0;
+		Uint64 NumFailed = 0;
+		Uint32 MaxConcurrent = 0;
+	};
+
+	/************************************************************
+	*
+	*	Compiles shaders on a pool of workers, highest priority
+	*	first and in submission order within a priority.
+	*
+	*	Requests for a key that is still queued are merged into
+	*	the queued job, its priority becomes the higher of both.
+	*	A key is never compiled by two workers at once, a request
+	*	arriving while its key compiles runs afterwards, so the
+	*	last result delivered reflects the latest sources.
+	*
+	*	Callbacks run on the worker that compiled the job.
+	*
+	************************************************************/
+
+	class CCompileScheduler
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			// Zero starts one worker per hardware thread.
+
+			Uint32			NumThreads = 0;
+
+			// Requests go straight to their compiler without a cache.
+
+			CShaderCache *	Cache = NULL;
+		};
+
+	private:
+
+		struct Job
+		{
+			CompileRequest				Request;
+			TVector<TCompileCallback>	Callbacks;
+			Uint64						Sequence = 0;
+			bool						Blocked = false;
+		};
+
+		struct QueueEntry
+		{
+			Int32	Priority;
+			Uint64	Sequence;
+			Uint64	KeyHash;
+
+			inline bool operator<(const QueueEntry & Other) const
+			{
+				return Priority != Other.Priority ? Priority < Other.Priority : Sequence > Other.Sequence;
+			}
+		};
+
+		InitializeOptions					Options;
+
+		TVector<std::thread>				Workers;
+
+		mutable TMutex						Mutex;
+		std::condition_variable				WorkAvailable;
+		std::condition_variable				WorkDone;
+
+		THashMap<Uint64, Job>				Jobs;
+		THashSet<Uint64>					Running;
+		TPriorityQueue<QueueEntry>			Queue;
+
+		Uint64								Sequence = 0;
+		bool								Stopping = false;
+
+		CompileSchedulerStats				Stats;
+
+	private:
+
+		void WorkerMain();
+
+		void Enqueue
+		(
+			const Uint64	  KeyHash,
+				  Job		& Entry
+		);
+
+	public:
+
+		CCompileScheduler() = default;
+		~CCompileScheduler();
+
+		CCompileScheduler(const CCompileScheduler &) = delete;
+		CCompileScheduler & operator=(const CCompileScheduler &) = delete;
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		// Waits for running compiles, queued requests are dropped without a callback.
+
+		void Stop();
+
+		// Returns the key hash identifying the request.
+
+		Uint64 Submit
+		(
+			CompileRequest && Request
+		);
+
+		// Moves a queued request, false when it already started or finished.
+
+		bool SetPriority
+		(
+			const Uint64 KeyHash,
+			const Int32	 Priority
+		);
+
+		bool IsPending
+		(
+			const Uint64 KeyHash
+		)	const;
+
+		size_t GetNumPending() const;
+
+		// Blocks until every submitted request has completed.
+
+		void Wait();
+
+		CompileSchedulerStats GetStats() const;
+
+		inline bool IsRunning() const
+		{
+			return !Workers.empty();
+		}
+	};
+}
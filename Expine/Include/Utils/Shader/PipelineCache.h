@@ -0,0 +1,346 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace PipelineCache
+{
+	struct Hash128
+	{
+		Uint64 Low = 0;
+		Uint64 High = 0;
+
+		inline bool operator==(const Hash128 & Other) const
+		{
+			return Low == Other.Low && High == Other.High;
+		}
+
+		inline bool operator!=(const Hash128 & Other) const
+		{
+			return !(*this == Other);
+		}
+	};
+
+	struct Hash128Hasher
+	{
+		inline size_t operator()(const Hash128 & Value) const
+		{
+			return static_cast<size_t>(Value.Low ^ (Value.High * 0x9E3779B97F4A7C15ULL));
+		}
+	};
+
+	// Two independent 64 bit lanes, stable across runs and platforms.
+
+	Hash128 HashBytes128
+	(
+		const void		* Data,
+		const size_t	  Size
+	);
+
+	/************************************************************
+	*
+	*	Canonical little endian encoding of a state. Fields are
+	*	written one by one, so padding and pointers never reach
+	*	the hash and equal states always encode equally.
+	*
+	************************************************************/
+
+	class CStateWriter
+	{
+	private:
+
+		TVector<Byte> Content;
+
+	public:
+
+		template<class Type>
+		inline CStateWriter & Append
+		(
+			const Type Value
+		)
+		{
+			static_assert(std::is_integral<Type>::value || std::is_enum<Type>::value, "Integral or enum expected.");
+
+			const Uint64 Wide = static_cast<Uint64>(Value);
+
+			for (Uint32 Shift = 0; Shift < sizeof(Type) * 8; Shift += 8)
+			{
+				Content.push_back(static_cast<Byte>(Wide >> Shift));
+			}
+
+			return *this;
+		}
+
+		inline CStateWriter & Append
+		(
+			const Float Value
+		)
+		{
+			Uint32 Bits;
+			{
+				std::memcpy(&Bits, &Value, sizeof(Bits));
+			}
+
+			return Append(Bits);
+		}
+
+		// Null strings encode like empty ones.
+
+		inline CStateWriter & Append
+		(
+			const char * Value
+		)
+		{
+			const size_t Length = Value ? std::strlen(Value) : 0;
+
+			Append(static_cast<Uint32>(Length));
+			Content.insert(Content.end(), Value, Value + Length);
+
+			return *this;
+		}
+
+		inline CStateWriter & Append
+		(
+			const Hash128 & Value
+		)
+		{
+			return Append(Value.Low).Append(Value.High);
+		}
+
+		inline const TVector<Byte> & GetContent() const
+		{
+			return Content;
+		}
+
+		inline void Clear()
+		{
+			Content.clear();
+		}
+	};
+
+	typedef Uint32 StateHandle;
+
+	static constexpr StateHandle InvalidState = ~0u;
+
+	/************************************************************
+	*
+	*	Interns encoded sub-states, equal encodings of the same
+	*	kind share one entry and one handle. Kinds are chosen by
+	*	the caller, blend, rasterizer and so on.
+	*
+	************************************************************/
+
+	class CStatePool
+	{
+	private:
+
+		struct Entry
+		{
+			Uint32			Kind;
+			Hash128			Hash;
+			TVector<Byte>	Content;
+		};
+
+		TVector<Entry>									Entries;
+		THashMap<Hash128, StateHandle, Hash128Hasher>	Index;
+		Uint64											NumRequests = 0;
+
+	public:
+
+		StateHandle Intern
+		(
+			const Uint32	  Kind,
+			const void		* Data,
+			const size_t	  Size
+		);
+
+		inline StateHandle Intern
+		(
+			const Uint32			  Kind,
+			const CStateWriter		& Writer
+		)
+		{
+			return Intern(Kind, Writer.GetContent().data(), Writer.GetContent().size());
+		}
+
+		inline Uint32 GetKind
+		(
+			const StateHandle Handle
+		)	const
+		{
+			return Entries[Handle].Kind;
+		}
+
+		// Covers kind and content.
+
+		inline const Hash128 & GetHash
+		(
+			const StateHandle Handle
+		)	const
+		{
+			return Entries[Handle].Hash;
+		}
+
+		inline const TVector<Byte> & GetContent
+		(
+			const StateHandle Handle
+		)	const
+		{
+			return Entries[Handle].Content;
+		}
+
+		inline size_t GetNumStates() const
+		{
+			return Entries.size();
+		}
+
+		inline Uint64 GetNumRequests() const
+		{
+			return NumRequests;
+		}
+
+		void Clear();
+	};
+
+	struct PipelineDescription
+	{
+		// Caller defined, graphics or compute.
+
+		Uint32					Type = 0;
+
+		// Interned sub-states in a caller defined order.
+
+		TVector<StateHandle>	States;
+
+		// Content hashes of the shader bytecode, empty stages as zero.
+
+		TVector<Uint64>			Shaders;
+
+		// Every remaining field, formats, topology, sample description.
+
+		TVector<Byte>			Fixed;
+	};
+
+	struct PipelineCacheStats
+	{
+		Uint64 NumRequests = 0;
+		Uint64 NumCreated = 0;
+		Uint64 NumBlobHits = 0;
+		Uint64 NumBlobRejected = 0;
+		Uint64 NumStates = 0;
+		Uint64 NumStateRequests = 0;
+		Uint64 TotalMicroseconds = 0;
+		Uint64 MaxMicroseconds = 0;
+	};
+
+	/************************************************************
+	*
+	*	Pipelines created during a run, keyed by a 128 bit hash
+	*	of their full description. Every record keeps the driver
+	*	blob of its pipeline, Save writes the records with their
+	*	sub-states stored once to <Directory>/Pipelines.bin and
+	*	Load on the next launch hands the blobs back before the
+	*	pipelines are first created.
+	*
+	*	Blobs are dropped when the device hash changes, the
+	*	descriptions are kept.
+	*
+	************************************************************/
+
+	class CPipelineCache
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			WString Directory = L"PipelineCache";
+
+			// Adapter and driver, blobs of another device are useless.
+
+			Uint64	DeviceHash = 0;
+		};
+
+		struct Record
+		{
+			Hash128				Key;
+			PipelineDescription	Description;
+			TVector<Byte>		Blob;
+			bool				Used = false;
+		};
+
+	private:
+
+		InitializeOptions								Options;
+
+		mutable TMutex									Mutex;
+		CStatePool										States;
+		THashMap<Hash128, Record, Hash128Hasher>		Records;
+		PipelineCacheStats								Stats;
+
+	private:
+
+		WString GetFilePath() const;
+
+	public:
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		StateHandle Intern
+		(
+			const Uint32			  Kind,
+			const CStateWriter		& Writer
+		);
+
+		Hash128 GetKey
+		(
+			const PipelineDescription & Description
+		)	const;
+
+		// Remembers the description, false when no blob is stored for it yet.
+
+		bool Request
+		(
+			const Hash128				& Key,
+			const PipelineDescription	& Description,
+				  TVector<Byte>			& Blob
+		);
+
+		void SetBlob
+		(
+			const Hash128		& Key,
+			TVector<Byte>		&& Blob
+		);
+
+		void RejectBlob
+		(
+			const Hash128 & Key
+		);
+
+		void RecordCreation
+		(
+			const Uint64	Microseconds,
+			const bool		FromBlob
+		);
+
+		bool Load();
+
+		// With UsedOnly records not requested during this run are left out.
+
+		bool Save
+		(
+			const bool UsedOnly = false
+		)	const;
+
+		size_t GetNumRecords() const;
+
+		PipelineCacheStats GetStats() const;
+
+		void Clear();
+	};
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+namespace ShaderCache
+{
+	/************************************************************
+	*
+	*	64 bit hashing, not cryptographic. Used for shader keys,
+	*	file contents and cache object names.
+	*
+	************************************************************/
+
+	Uint64 HashBytes
+	(
+		const void		* Data,
+		const size_t	  Size,
+		const Uint64	  Seed = 0
+	);
+
+	inline Uint64 HashCombine
+	(
+		const Uint64 Seed,
+		const Uint64 Value
+	)
+	{
+		return Seed ^ (Value + 0x9E3779B97F4A7C15ULL + (Seed << 6) + (Seed >> 2));
+	}
+
+	class CHasher
+	{
+	private:
+
+		Uint64 State;
+
+	public:
+
+		inline CHasher
+		(
+			const Uint64 Seed = 0
+		) :
+			State(Seed)
+		{}
+
+		// Length is part of the hash, so ("ab", "c") and ("a", "bc") differ.
+
+		inline CHasher & Append
+		(
+			const void		* Data,
+			const size_t	  Size
+		)
+		{
+			State = HashCombine(State, HashBytes(Data, Size, Size));
+			return *this;
+		}
+
+		inline CHasher & Append
+		(
+			const StringView & Value
+		)
+		{
+			return Append(Value.data(), Value.size());
+		}
+
+		inline CHasher & Append
+		(
+			const WStringView & Value
+		)
+		{
+			return Append(Value.data(), Value.size() * sizeof(wchar_t));
+		}
+
+		inline CHasher & Append
+		(
+			const Uint64 Value
+		)
+		{
+			State = HashCombine(State, Value);
+			return *this;
+		}
+
+		inline Uint64 Finish() const
+		{
+			return State;
+		}
+	};
+
+	struct ShaderDefine
+	{
+		String Name;
+		String Value;
+	};
+
+	struct ShaderKey
+	{
+		// Source file as it is opened by the compiler.
+
+		WString					Path;
+		String					EntryPoint;
+		String					Profile;
+		TVector<ShaderDefine>	Defines;
+	};
+
+	// Defines are sorted by name first, their order does not matter.
+
+	Uint64 HashShaderDefines
+	(
+		const TVector<ShaderDefine> & Defines
+	);
+
+	Uint64 HashShaderKey
+	(
+		const ShaderKey & Key
+	);
+
+	// Forward slashes, so paths reported by the compiler and the file watcher compare equal.
+
+	WString NormalizePath
+	(
+		const WStringView & Path
+	);
+
+	struct ShaderCompileOutput
+	{
+		TVector<Byte>		Bytecode;
+
+		// Every file read besides the source itself, nested includes too.
+
+		TVector<WString>	Includes;
+
+		String				Messages;
+	};
+
+	class IShaderCompiler
+	{
+	public:
+
+		virtual ~IShaderCompiler() = default;
+
+		virtual bool Compile
+		(
+			const ShaderKey				& Key,
+				  ShaderCompileOutput	& Output
+		) = 0;
+
+		// Changes with compiler version and flags, so their objects do not mix.
+
+		virtual Uint64 GetCompilerHash() const = 0;
+	};
+
+	struct ShaderCacheStats
+	{
+		Uint64 NumHits = 0;
+		Uint64 NumMisses = 0;
+		Uint64 NumFailed = 0;
+	};
+
+	/************************************************************
+	*
+	*	Persistent bytecode cache. For every shader key the
+	*	files it read during the last compile are recorded in
+	*	<key>.dep. The object name hashes the key together with
+	*	the current contents of those files, so an object in
+	*	<object>.cso is valid exactly as long as none of its
+	*	inputs changed, and going back to an earlier version of
+	*	a file finds the earlier object again.
+	*
+	*	The reverse edges, file to keys, answer which shaders
+	*	an edited include affects.
+	*
+	************************************************************/
+
+	class CShaderCache
+	{
+	public:
+
+		struct InitializeOptions
+		{
+			WString Directory = L"ShaderCache";
+		};
+
+	private:
+
+		WString											Directory;
+
+		mutable TMutex									Mutex;
+		THashMap<WString, Uint64>						FileHashes;
+		THashMap<Uint64, TVector<WString> >				Dependencies;
+		THashMap<WString, THashSet<Uint64> >			Dependents;
+		ShaderCacheStats								Stats;
+
+	private:
+
+		WString GetEntryPath
+		(
+			const Uint64	  Hash,
+			const wchar_t	* Extension
+		)	const;
+
+		bool ReadDependencies
+		(
+			const Uint64		  KeyHash,
+			TVector<WString>	& Files
+		)	const;
+
+		bool WriteDependencies
+		(
+			const Uint64			  KeyHash,
+			const TVector<WString>	& Files
+		)	const;
+
+		bool ReadObject
+		(
+			const Uint64	  ObjectHash,
+			TVector<Byte>	& Bytecode
+		)	const;
+
+		bool WriteObject
+		(
+			const Uint64			  ObjectHash,
+			const TVector<Byte>		& Bytecode
+		)	const;
+
+		Uint64 GetObjectHash
+		(
+			const Uint64			  KeyHash,
+			const Uint64			  CompilerHash,
+			const TVector<WString>	& Files
+		);
+
+		void SetDependencies
+		(
+			const Uint64			  KeyHash,
+			const TVector<WString>	& Files
+		);
+
+	public:
+
+		bool Initialize
+		(
+			const InitializeOptions & Options
+		);
+
+		// Loads the bytecode from the cache or compiles and stores it. Safe to call from several threads.
+
+		bool Compile
+		(
+			const ShaderKey				& Key,
+				  IShaderCompiler		& Compiler,
+				  ShaderCompileOutput	& Output,
+				  bool					* FromCache = NULL
+		);
+
+		// Content hash of a file, remembered until the file is invalidated. Missing files hash to zero.
+
+		Uint64 GetFileHash
+		(
+			const WString & Path
+		);
+
+		// Forgets the file contents and returns the keys of every shader that read the file.
+
+		TVector<Uint64> Invalidate
+		(
+			const WStringView & Path
+		);
+
+		void Clear();
+
+		ShaderCacheStats GetStats() const;
+
+		inline const WString & GetDirectory() const
+		{
+			return Directory;
+		}
+	};
+}
@@ -4,6 +4,9 @@
 #include "Defines.h"
 
 #include <algorithm>
+#include <cstring>
+
+#include "Utils/Parsing/NumberParsing.h"
 
 #include "Hyper.h"
 
@@ -99,11 +102,13 @@ public:
 		return true;
 	}
 
-	/********************************************************************************************************
+	/************************************************************
 	*
-	*	Returns true if character array is a floating point with format of (-)x[1 + n].x[1 + m]( ) or (-)x[1 + n]( ) .
+	*	Returns true if the characters up to Last, a space or a
+	*	null character are a number, see Parsing::ParseFloat and
+	*	Parsing::ParseInteger for the accepted formats.
 	*
-	********************************************************************************************************/
+	************************************************************/
 
 	template
 	<
@@ -111,80 +116,60 @@ public:
 	> 
 	static bool __fastcall TryConvertToFloatingPoint
 	(
-		const char * P,
-		FloatingPoint & R
+		const char			* P,
+		const char			* Last,
+			  FloatingPoint	& R
 	)
 	{
-		if (!IsCharArray(P))
-		{
-			return false;
-		}
-
-		FloatingPoint D = 0.0;
-		FloatingPoint F;
-
-		bool N;
-
-		if (*P == '-')
-		{
-			N = true;
-			++P;
-		}
-		else
-		{
-			N = false;
-		}
-
-		while (*P - '0' <= 9U)
+		const char * End = Parsing::ParseNumber(P, Last, R);
 		{
-			D = (D * 10) + (*P++ - '0');
-		}
-
-		if (*P == '.')
-		{
-			F = 0.0;
-
-			const char * O = P++;
-
-			while (*P - '0' <= 9U)
-			{
-				F = (F * 10) + (*P++ - '0');
-			}
-
-			D += F * Math::FPower10LookupTable[P - O];
+			return End != NULL && (End == Last || *End == ' ' || *End == 0);
 		}
+	}
 
-		if (*P && *P != ' ')
+	template
+	<
+		typename FloatingPoint
+	> 
+	static bool __fastcall TryConvertToFloatingPoint
+	(
+		const char		* P,
+		FloatingPoint	& R
+	)
+	{
+		if (!IsCharArray(P))
 		{
 			return false;
 		}
 
-		if (N)
-		{
-			R = -D;
-		}
-		else
+		return TryConvertToFloatingPoint(P, P + std::strlen(P), R);
+	}
+
+	template
+	<
+		typename Integer
+	>
+	static bool __fastcall TryConvertToInteger
+	(
+		const char	* P,
+		const char	* Last,
+			  Integer	& R
+	)
+	{
+		const char * End = Parsing::ParseNumber(P, Last, R);
 		{
-			R = D;
+			return End != NULL && (End == Last || *End == ' ' || *End == 0);
 		}
-
-		return true;
 	}
 
-	/**********************************************************************************
-	*
-	*	Returns true if character array is a integer with format of (-)x[1 + n]( ) .
-	*
-	**********************************************************************************/
-
 	template
 	<
 		typename Integer
 	>
 	static bool __fastcall TryConvertToInteger
 	(
-		const char * P,
-		Integer & R
+		const char	* P,
+		Integer		& R
 	)
 	{
 		if (!IsCharArray(P))
@@ -192,40 +177,7 @@ public:
 			return false;
 		}
 
-		bool N;
-
-		if (*P == '-')
-		{
-			N = true;
-			++P;
-		}
-		else
-		{
-			N = false;
-		}
-
-		int V = 0;
-
-		while (*P)
-		{
-			if (*P - '0' > 9U)
-			{
-				if (*P == ' ')
-				{
-					break;
-				}
-
-				return false;
-			}
-			else
-			{
-				V = V * 10 + (*P++ - '0');
-			}
-		}
-
-		R = N ? -V : V;
-
-		return true;
+		return TryConvertToInteger(P, P + std::strlen(P), R);
 	}
 
 	template
@@ -234,36 +186,47 @@ public:
 	>
 	static bool __fastcall TryConvertToUnsignedInteger
 	(
-		const char * P,
-		Integer & R
+		const char	* P,
+		Integer		& R
 	)
 	{
-		if (!IsCharArray(P))
+		static_assert(std::is_unsigned<Integer>::value, "Unsigned integer expected.");
+
+		return TryConvertToInteger(P, R);
+	}
+
+	/************************************************************
+	*
+	*	Returns true if the characters are Count numbers split
+	*	by whitespace.
+	*
+	************************************************************/
+
+	template
+	<
+		typename VectorType
+	>
+	FORCEINLINE bool TryConvertToVector
+	(
+		VectorType		& R,
+		const unsigned	  Count
+	)	const
+	{
+		const char * P		= GetData();
+		const char * Last	= P + GetSize();
+
+		float Components[4];
+
+		if ((P = Parsing::ParseList(P, Last, Components, Count)) == NULL || Parsing::SkipWhitespace(P, Last) != Last)
 		{
 			return false;
 		}
 
-		int V = 0;
-
-		while (*P)
+		for (unsigned N = 0; N < Count; ++N)
 		{
-			if (*P - '0' > 9U)
-			{
-				if (*P == ' ')
-				{
-					break;
-				}
-
-				return false;
-			}
-			else
-			{
-				V = V * 10 + (*P++ - '0');
-			}
+			R.Component(N) = Components[N];
 		}
 
-		R = V;
-
 		return true;
 	}
 
@@ -272,7 +235,7 @@ public:
 		double & R
 	) const
 	{
-		return TryConvertToFloatingPoint(GetData(), R);
+		return TryConvertToFloatingPoint(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -289,7 +252,7 @@ public:
 		float & R
 	) const
 	{
-		return TryConvertToFloatingPoint(GetData(), R);
+		return TryConvertToFloatingPoint(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -297,7 +260,7 @@ public:
 		int8_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -305,7 +268,7 @@ public:
 		int16_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -313,7 +276,7 @@ public:
 		int32_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -321,7 +284,7 @@ public:
 		int64_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -329,7 +292,7 @@ public:
 		uint8_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -337,7 +300,7 @@ public:
 		uint16_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -345,7 +308,7 @@ public:
 		uint32_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -353,7 +316,7 @@ public:
 		uint64_t & R
 	) const
 	{
-		return TryConvertToInteger(GetData(), R);
+		return TryConvertToInteger(GetData(), GetData() + GetSize(), R);
 	}
 
 	FORCEINLINE bool operator >>
@@ -375,40 +338,7 @@ public:
 		Vector2f & R
 	) const
 	{
-		unsigned O = 0;
-		unsigned L;
-
-		const char * P = GetData();
-
-		Vector2f V;
-
-#pragma unroll(1)
-		for (unsigned N = 0; N < 2; ++N)
-		{
-			L = O;
-			O = static_cast<const Derived*>(this)->Find(' ', O);
-
-			if (O == static_cast<const Derived*>(this)->npos)
-			{
-				if (!TryConvertToFloatingPoint(P + O + 1, V.Component(N)))
-				{
-					return false;
-				}
-
-				R = V;
-
-				return true;
-			}
-
-			if (!TryConvertToFloatingPoint(P + L, V.Component(N)))
-			{
-				return false;
-			}
-
-			O++;
-		}
-
-		return false;
+		return TryConvertToVector(R, 2);
 	}
 
 	FORCEINLINE bool operator >>
@@ -416,40 +346,7 @@ public:
 		Vector3f & R
 	) const
 	{
-		Vector3f V;
-
-		unsigned O = 0;
-		unsigned L;
-
-		const char * P = GetData();
-
-#pragma unroll(1)
-		for (unsigned N = 0; N < 3; ++N)
-		{
-			L = O;
-			O = static_cast<const Derived*>(this)->Find(' ', O);
-
-			if (O == static_cast<const Derived*>(this)->npos)
-			{
-				if (!TryConvertToFloatingPoint(P + O + 1, V.Component(N)))
-				{
-					return false;
-				}
-
-				R = V;
-
-				return true;
-			}
-
-			if (!TryConvertToFloatingPoint(P + L, V.Component(N)))
-			{
-				return false;
-			}
-
-			O++;
-		}
-
-		return false;
+		return TryConvertToVector(R, 3);
 	}
 
 	FORCEINLINE bool operator >>
@@ -457,40 +354,7 @@ public:
 		Vector4f & R
 	) const
 	{
-		Vector4f V;
-
-		unsigned O = 0;
-		unsigned L;
-
-		const char * P = GetData();
-
-#pragma unroll(1)
-		for (unsigned N = 0; N < 4; ++N)
-		{
-			L = O;
-			O = static_cast<const Derived*>(this)->Find(' ', O);
-
-			if (O == static_cast<const Derived*>(this)->npos)
-			{
-				if (!TryConvertToFloatingPoint(P + O + 1, V.Component(N)))
-				{
-					return false;
-				}
-
-				R = V;
-
-				return true;
-			}
-
-			if (!TryConvertToFloatingPoint(P + L, V.Component(N)))
-			{
-				return false;
-			}
-
-			O++;
-		}
-
-		return false;
+		return TryConvertToVector(R, 4);
 	}
 };
 
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+namespace System
+{
+	// Instruction sets beyond the SSE2 baseline of the build. Code using
+	// them lives in separate paths and is selected at runtime.
+
+	struct CpuFeatures
+	{
+		bool SSSE3	= false;
+		bool SSE41	= false;
+		bool AVX	= false;
+		bool AVX2	= false;
+		bool FMA	= false;
+	};
+
+	// Queried once on first use, AVX flags also require OS support for the YMM state.
+
+	const CpuFeatures & GetCpuFeatures();
+}
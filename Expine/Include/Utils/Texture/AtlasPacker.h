@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Utils/Texture/MipGenerator.h"
+
+namespace Texture
+{
+	namespace Atlas
+	{
+		struct PackRect
+		{
+			Uint32	Width = 0;
+			Uint32	Height = 0;
+		};
+
+		struct PackPlacement
+		{
+			Uint32	Page = 0;
+			Uint32	X = 0;
+			Uint32	Y = 0;
+		};
+
+		/************************************************************
+		*
+		*	MaxRects packer, best short side fit. Rectangles are
+		*	placed from the largest down in a fixed order, so the
+		*	result only depends on the input. The page starts at
+		*	the smallest power of two holding the total area and
+		*	grows up to the maximum, rectangles that still do not
+		*	fit open further pages of the maximum size.
+		*
+		*	Positions and the page size are multiples of the
+		*	alignment, which has to be a power of two.
+		*
+		************************************************************/
+
+		bool PackRectangles
+		(
+			const TVector<PackRect>			& Rects,
+			const Uint32					  MaxWidth,
+			const Uint32					  MaxHeight,
+			const Uint32					  Alignment,
+				  TVector<PackPlacement>	& Placements,
+				  Uint32					& PageWidth,
+				  Uint32					& PageHeight,
+				  Uint32					& NumPages
+		);
+
+		struct AtlasOptions
+		{
+			Uint32						MaxWidth = 8192;
+			Uint32						MaxHeight = 8192;
+
+			// Mips that are built per image and never bleed into their neighbours,
+			// the atlas chain ends there.
+
+			Uint32						MipLevels = 6;
+
+			// Gutter in texels on the last of those mips.
+
+			Uint32						Padding = 1;
+
+			// Cells cover whole blocks on every mip, four for BC formats.
+
+			Uint32						BlockAlignment = BC::BlockDimension;
+
+			// Encodes the pages, otherwise they stay RGBA8.
+
+			bool						Compress = false;
+
+			// With Wrap set the gutter repeats the opposite edge, for tiling textures.
+
+			Mip::MipOptions				Mips;
+			BC::BlockCompressionOptions	Compression;
+		};
+
+		struct AtlasRegion
+		{
+			Uint32	Page = 0;
+
+			// Image texels on the top level, without the gutter.
+
+			Uint32	X = 0;
+			Uint32	Y = 0;
+			Uint32	Width = 0;
+			Uint32	Height = 0;
+		};
+
+		// One entry per image, indexed by the values of TerrainVertex::AtlasIndices.
+
+		struct AtlasRemap
+		{
+			Float	OffsetU;
+			Float	OffsetV;
+			Float	ScaleU;
+			Float	ScaleV;
+
+			Float	Slice;
+
+			// Coarsest mip that may be sampled without bleeding.
+
+			Float	MaxMip;
+
+			Float	Reserved[2];
+		};
+
+		struct AtlasPage
+		{
+			// RGBA8 rows or BC blocks per mip.
+
+			TVector<TVector<Byte> > Levels;
+		};
+
+		/************************************************************
+		*
+		*	Offline atlas builder for images of mixed sizes. Each
+		*	image gets a cell holding it and its gutter, aligned
+		*	so that the cell still covers whole blocks on every
+		*	kept mip. Mips are filtered per image and copied into
+		*	the page levels with the gutter filled by edge or
+		*	wrap replication, so filtering never reaches into the
+		*	next image. Images are processed in parallel and the
+		*	output is deterministic.
+		*
+		************************************************************/
+
+		class CAtlasBuilder
+		{
+		private:
+
+			AtlasOptions			Options;
+
+			Uint32					PageWidth = 0;
+			Uint32					PageHeight = 0;
+			Uint32					NumLevels = 0;
+			Uint32					Gutter = 0;
+
+			TVector<AtlasRegion>	Regions;
+			TVector<AtlasPage>		Pages;
+
+		public:
+
+			bool Build
+			(
+				const TVector<BC::ImageRGBA8>	& Images,
+				const AtlasOptions				& Options
+			);
+
+			void GetRemapTable
+			(
+				TVector<AtlasRemap> & Table
+			)	const;
+
+			// DXGI format of the page data.
+
+			Uint32 GetFormat() const;
+
+			// Stores the pages as a DDS texture array.
+
+			bool WriteContainer
+			(
+				TVector<Byte> & Output
+			)	const;
+
+			inline const TVector<AtlasRegion> & GetRegions() const
+			{
+				return Regions;
+			}
+
+			inline const TVector<AtlasPage> & GetPages() const
+			{
+				return Pages;
+			}
+
+			inline Uint32 GetPageWidth() const
+			{
+				return PageWidth;
+			}
+
+			inline Uint32 GetPageHeight() const
+			{
+				return PageHeight;
+			}
+
+			inline Uint32 GetNumLevels() const
+			{
+				return NumLevels;
+			}
+
+			inline Uint32 GetGutter() const
+			{
+				return Gutter;
+			}
+		};
+	}
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+namespace Texture
+{
+	namespace BC
+	{
+		enum EBlockFormat
+		{
+			BlockFormatBC1,
+			BlockFormatBC3,
+			BlockFormatBC4,
+			BlockFormatBC5,
+			BlockFormatBC6H,
+			BlockFormatBC7
+		};
+
+		enum EBlockQuality
+		{
+			BlockQualityFast,
+			BlockQualityNormal,
+			BlockQualityHigh
+		};
+
+		struct BlockCompressionOptions
+		{
+			EBlockFormat	Format			= BlockFormatBC1;
+			EBlockQuality	Quality			= BlockQualityNormal;
+
+			// Only changes the reported format, sRGB data is encoded as is.
+
+			bool			Srgb			= false;
+
+			// BC1 only, pixels below the threshold become transparent black.
+
+			bool			AlphaCutout		= false;
+			Uint8			AlphaThreshold	= 128;
+
+			// Decodes the result again to fill in the error statistics.
+
+			bool			MeasureQuality	= false;
+		};
+
+		struct BlockCompressionStats
+		{
+			double	Seconds				= 0.0;
+			double	MegabytesPerSecond	= 0.0;
+
+			// Over all encoded channels, HDR data is measured against its peak value.
+
+			double	PSNR				= 0.0;
+		};
+
+		struct ImageRGBA8
+		{
+			const Byte *	Data		= NULL;
+			Uint32			Width		= 0;
+			Uint32			Height		= 0;
+			Uint64			RowPitch	= 0;
+		};
+
+		struct ImageRGBA32F
+		{
+			const Float *	Data		= NULL;
+			Uint32			Width		= 0;
+			Uint32			Height		= 0;
+			Uint64			RowPitch	= 0;
+		};
+
+		static constexpr Uint32 BlockDimension = 4;
+		static constexpr Uint32 BlockPixels = BlockDimension * BlockDimension;
+
+		// Size of one encoded block in bytes.
+
+		Uint32 GetBlockSize
+		(
+			const EBlockFormat Format
+		);
+
+		// Matching DXGI format value, see Texture::DDS::EDDSFormat.
+
+		Uint32 GetFormat
+		(
+			const EBlockFormat	Format,
+			const bool			Srgb
+		);
+
+		Uint64 GetCompressedSize
+		(
+			const EBlockFormat	Format,
+			const Uint32		Width,
+			const Uint32		Height
+		);
+
+		/************************************************************
+		*
+		*	Single block codecs, pixels are stored row by row.
+		*	LDR formats use RGBA8, BC4 reads and writes only the
+		*	given channel, BC5 red and green. BC6H works on
+		*	RGBA32F and ignores alpha.
+		*
+		*	The BC7 encoder emits mode 6 only, the BC6H encoder
+		*	mode 11 with unsigned values. Decoders handle the
+		*	unpartitioned modes (BC7 4 to 6, BC6H 11) and return
+		*	false for others, which decode to magenta. BC1 to BC5
+		*	decode through SSSE3 shuffles when the CPU has them.
+		*
+		************************************************************/
+
+		void EncodeBlockBC1
+		(
+			const Byte			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality,
+			const bool			AlphaCutout = false,
+			const Uint8			AlphaThreshold = 128
+		);
+
+		void EncodeBlockBC3
+		(
+			const Byte			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality
+		);
+
+		void EncodeBlockBC4
+		(
+			const Byte			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality,
+			const Uint32		Channel = 0
+		);
+
+		void EncodeBlockBC5
+		(
+			const Byte			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality
+		);
+
+		void EncodeBlockBC6H
+		(
+			const Float			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality
+		);
+
+		void EncodeBlockBC7
+		(
+			const Byte			Pixels[BlockPixels][4],
+				  Byte		*	Block,
+			const EBlockQuality	Quality
+		);
+
+		void DecodeBlockBC1
+		(
+			const Byte	*	Block,
+				  Byte		Pixels[BlockPixels][4]
+		);
+
+		void DecodeBlockBC3
+		(
+			const Byte	*	Block,
+				  Byte		Pixels[BlockPixels][4]
+		);
+
+		void DecodeBlockBC4
+		(
+			const Byte	*	Block,
+				  Byte		Pixels[BlockPixels][4],
+			const Uint32	Channel = 0
+		);
+
+		void DecodeBlockBC5
+		(
+			const Byte	*	Block,
+				  Byte		Pixels[BlockPixels][4]
+		);
+
+		bool DecodeBlockBC6H
+		(
+			const Byte	*	Block,
+				  Float		Pixels[BlockPixels][4],
+			const bool		Signed = false
+		);
+
+		bool DecodeBlockBC7
+		(
+			const Byte	*	Block,
+				  Byte		Pixels[BlockPixels][4]
+		);
+
+		/************************************************************
+		*
+		*	Whole image codecs, block rows are processed in
+		*	parallel. Partial blocks at the border replicate the
+		*	last row and column.
+		*
+		************************************************************/
+
+		bool Compress
+		(
+			const ImageRGBA8				& Image,
+			const BlockCompressionOptions	& Options,
+				  TVector<Byte>				& Output,
+				  BlockCompressionStats		* Stats = NULL
+		);
+
+		bool Compress
+		(
+			const ImageRGBA32F				& Image,
+			const BlockCompressionOptions	& Options,
+				  TVector<Byte>				& Output,
+				  BlockCompressionStats		* Stats = NULL
+		);
+
+		bool Decompress
+		(
+			const EBlockFormat		Format,
+			const Byte			*	Blocks,
+			const Uint32			Width,
+			const Uint32			Height,
+				  TVector<Byte>	&	Output
+		);
+
+		bool Decompress
+		(
+			const EBlockFormat		Format,
+			const Byte			*	Blocks,
+			const Uint32			Width,
+			const Uint32			Height,
+				  TVector<Float> &	Output
+		);
+
+		// Compares the first NumChannels channels of two images of equal size.
+
+		double ComputePSNR
+		(
+			const ImageRGBA8	& Reference,
+			const ImageRGBA8	& Image,
+			const Uint32		  NumChannels = 4
+		);
+
+		double ComputePSNR
+		(
+			const ImageRGBA32F	& Reference,
+			const ImageRGBA32F	& Image,
+			const Uint32		  NumChannels = 3
+		);
+
+		Uint16 FloatToHalf
+		(
+			const Float Value
+		);
+
+		Float HalfToFloat
+		(
+			const Uint16 Value
+		);
+	}
+}
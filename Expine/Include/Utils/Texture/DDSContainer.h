@@ -0,0 +1,324 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include "Utils/File/MappedFile.h"
+
+namespace Texture
+{
+	namespace DDS
+	{
+		enum DDS_ALPHA_MODE
+		{
+			DDS_ALPHA_MODE_UNKNOWN = 0,
+			DDS_ALPHA_MODE_STRAIGHT = 1,
+			DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+			DDS_ALPHA_MODE_OPAQUE = 3,
+			DDS_ALPHA_MODE_CUSTOM = 4,
+		};
+
+		enum EDDSResult
+		{
+			DDSResultOk,
+			DDSResultOpenFailed,
+			DDSResultInvalidMagic,
+			DDSResultInvalidHeader,
+			DDSResultUnsupportedFormat,
+			DDSResultUnsupportedDimension,
+			DDSResultTruncated
+		};
+
+		// Values match D3D12_RESOURCE_DIMENSION.
+
+		enum EDDSDimension
+		{
+			DDSDimensionUnknown		= 0,
+			DDSDimensionTexture1D	= 2,
+			DDSDimensionTexture2D	= 3,
+			DDSDimensionTexture3D	= 4
+		};
+
+		// Values match DXGI_FORMAT, only the formats referenced by
+		// the container itself are named.
+
+		enum EDDSFormat
+		{
+			DDSFormatUnknown				= 0,
+			DDSFormatR32G32B32A32Float		= 2,
+			DDSFormatR16G16B16A16Float		= 10,
+			DDSFormatR16G16B16A16Unorm		= 11,
+			DDSFormatR16G16B16A16Snorm		= 13,
+			DDSFormatR32G32Float			= 16,
+			DDSFormatR10G10B10A2Unorm		= 24,
+			DDSFormatR8G8B8A8Unorm			= 28,
+			DDSFormatR8G8B8A8UnormSrgb		= 29,
+			DDSFormatR8G8B8A8Snorm			= 31,
+			DDSFormatR16G16Float			= 34,
+			DDSFormatR16G16Unorm			= 35,
+			DDSFormatR16G16Snorm			= 37,
+			DDSFormatR32Float				= 41,
+			DDSFormatR8G8Unorm				= 49,
+			DDSFormatR8G8Snorm				= 51,
+			DDSFormatR16Float				= 54,
+			DDSFormatR16Unorm				= 56,
+			DDSFormatR8Unorm				= 61,
+			DDSFormatA8Unorm				= 65,
+			DDSFormatR8G8B8G8Unorm			= 68,
+			DDSFormatG8R8G8B8Unorm			= 69,
+			DDSFormatBC1Typeless			= 70,
+			DDSFormatBC1Unorm				= 71,
+			DDSFormatBC1UnormSrgb			= 72,
+			DDSFormatBC2Typeless			= 73,
+			DDSFormatBC2Unorm				= 74,
+			DDSFormatBC2UnormSrgb			= 75,
+			DDSFormatBC3Typeless			= 76,
+			DDSFormatBC3Unorm				= 77,
+			DDSFormatBC3UnormSrgb			= 78,
+			DDSFormatBC4Typeless			= 79,
+			DDSFormatBC4Unorm				= 80,
+			DDSFormatBC4Snorm				= 81,
+			DDSFormatBC5Typeless			= 82,
+			DDSFormatBC5Unorm				= 83,
+			DDSFormatBC5Snorm				= 84,
+			DDSFormatB5G6R5Unorm			= 85,
+			DDSFormatB5G5R5A1Unorm			= 86,
+			DDSFormatB8G8R8A8Unorm			= 87,
+			DDSFormatB8G8R8X8Unorm			= 88,
+			DDSFormatB8G8R8A8UnormSrgb		= 91,
+			DDSFormatBC6HTypeless			= 94,
+			DDSFormatBC6HUf16				= 95,
+			DDSFormatBC6HSf16				= 96,
+			DDSFormatBC7Typeless			= 97,
+			DDSFormatBC7Unorm				= 98,
+			DDSFormatBC7UnormSrgb			= 99,
+			DDSFormatYUY2					= 107,
+			DDSFormatB4G4R4A4Unorm			= 115
+		};
+
+		struct DDSFormatInfo
+		{
+			Uint32	BitsPerBlock = 0;
+			Uint32	BlockWidth = 1;
+			Uint32	BlockHeight = 1;
+			bool	Compressed = false;
+		};
+
+		struct DDSSubresource
+		{
+			Uint32			Mip;
+			Uint32			Slice;
+
+			Uint32			Width;
+			Uint32			Height;
+			Uint32			Depth;
+
+			// Row and slice pitch of the data as stored in the file.
+
+			Uint64			Offset;
+			Uint64			RowPitch;
+			Uint64			SlicePitch;
+			Uint64			Size;
+
+			Uint32			NumRows;
+			Uint32			BlocksWide;
+			Uint32			BlocksHigh;
+
+			const Byte *	Data;
+		};
+
+		/************************************************************
+		*
+		*	Validates a DDS file and lays out all of its
+		*	subresources in D3D12 order (mips of slice 0, then mips
+		*	of slice 1 and so on). Subresource data points into the
+		*	mapped file or the memory passed to Parse, which has to
+		*	outlive the container.
+		*
+		************************************************************/
+
+		class CDDSContainer
+		{
+		private:
+
+			File::CMappedFile		Mapping;
+
+			const Byte *			Data = NULL;
+			Uint64					Size = 0;
+
+			EDDSDimension			Dimension = DDSDimensionUnknown;
+			Uint32					Format = DDSFormatUnknown;
+			DDSFormatInfo			FormatInfo;
+			DDS_ALPHA_MODE			AlphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+			Uint32					Width = 0;
+			Uint32					Height = 0;
+			Uint32					Depth = 0;
+			Uint32					ArraySize = 0;
+			Uint32					MipLevels = 0;
+			bool					Cube = false;
+
+			TVector<DDSSubresource>	Subresources;
+
+		public:
+
+			static constexpr Uint32 MaxMipLevels = 15;
+
+		public:
+
+			EDDSResult Open
+			(
+				const WString & Path
+			);
+
+			EDDSResult Open
+			(
+				const String & Path
+			);
+
+			EDDSResult Parse
+			(
+				const Byte *	Data,
+				const Uint64	Size
+			);
+
+			void Close();
+
+			// Starts reading the given mips of every slice ahead of time.
+
+			void PrefetchMips
+			(
+				const Uint32 FirstMip,
+				const Uint32 NumMips
+			)	const;
+
+			// Copies one subresource into memory with a different pitch,
+			// a zero slice pitch means slices are packed by row pitch.
+
+			bool CopySubresource
+			(
+				const Uint32	Index,
+					  Byte *	Destination,
+				const Uint64	DestinationRowPitch,
+				const Uint64	DestinationSlicePitch = 0
+			)	const;
+
+			static bool GetFormatInfo
+			(
+				const Uint32			Format,
+					  DDSFormatInfo &	Info
+			);
+
+			inline Uint32 GetSubresourceIndex
+			(
+				const Uint32 Mip,
+				const Uint32 Slice
+			)	const
+			{
+				return Mip + Slice * MipLevels;
+			}
+
+			inline const DDSSubresource & GetSubresource
+			(
+				const Uint32 Mip,
+				const Uint32 Slice
+			)	const
+			{
+				return Subresources[GetSubresourceIndex(Mip, Slice)];
+			}
+
+			inline const TVector<DDSSubresource> & GetSubresources() const
+			{
+				return Subresources;
+			}
+
+			inline EDDSDimension GetDimension() const
+			{
+				return Dimension;
+			}
+
+			inline Uint32 GetFormat() const
+			{
+				return Format;
+			}
+
+			inline const DDSFormatInfo & GetFormatInfo() const
+			{
+				return FormatInfo;
+			}
+
+			inline DDS_ALPHA_MODE GetAlphaMode() const
+			{
+				return AlphaMode;
+			}
+
+			inline Uint32 GetWidth() const
+			{
+				return Width;
+			}
+
+			inline Uint32 GetHeight() const
+			{
+				return Height;
+			}
+
+			inline Uint32 GetDepth() const
+			{
+				return Depth;
+			}
+
+			// Number of textures, a cube map counts as one.
+
+			inline Uint32 GetArraySize() const
+			{
+				return ArraySize;
+			}
+
+			// Number of 2D slices, six per cube map.
+
+			inline Uint32 GetNumSlices() const
+			{
+				return Cube ? ArraySize * 6 : ArraySize;
+			}
+
+			inline Uint32 GetMipLevels() const
+			{
+				return MipLevels;
+			}
+
+			inline bool IsCubeMap() const
+			{
+				return Cube;
+			}
+
+			inline const Byte * GetData() const
+			{
+				return Data;
+			}
+
+			inline Uint64 GetSize() const
+			{
+				return Size;
+			}
+		};
+
+		/************************************************************
+		*
+		*	Writes a 2D texture or texture array with the DX10
+		*	header. Subresources are given in D3D12 order with
+		*	tightly packed rows.
+		*
+		************************************************************/
+
+		bool WriteContainer
+		(
+			const Uint32				Format,
+			const Uint32				Width,
+			const Uint32				Height,
+			const Uint32				ArraySize,
+			const Uint32				MipLevels,
+			const TVector<const Byte*>	& Subresources,
+				  TVector<Byte>			& Output
+		);
+	}
+}
@@ -26,20 +26,13 @@
 #include <vector>
 #include <stdint.h>
 
+#include "DDSContainer.h"
+
 
 namespace Texture
 {
 	namespace DDS
 	{
-		enum DDS_ALPHA_MODE
-		{
-			DDS_ALPHA_MODE_UNKNOWN = 0,
-			DDS_ALPHA_MODE_STRAIGHT = 1,
-			DDS_ALPHA_MODE_PREMULTIPLIED = 2,
-			DDS_ALPHA_MODE_OPAQUE = 3,
-			DDS_ALPHA_MODE_CUSTOM = 4,
-		};
-
 		enum DDS_LOADER_FLAGS
 		{
 			DDS_LOADER_DEFAULT = 0,
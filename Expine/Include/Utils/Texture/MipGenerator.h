@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Utils/Texture/BlockCompression.h"
+
+namespace Texture
+{
+	namespace Mip
+	{
+		enum EMipFilter
+		{
+			MipFilterBox,
+			MipFilterKaiser,
+			MipFilterLanczos
+		};
+
+		struct MipOptions
+		{
+			EMipFilter	Filter = MipFilterKaiser;
+
+			// Zero generates the full chain down to 1x1.
+
+			Uint32		MaxLevels = 0;
+
+			// Color channels are filtered in linear space.
+
+			bool		Srgb = false;
+
+			// Channels are decoded to [-1, 1] and renormalized on every level.
+
+			bool		NormalMap = false;
+
+			// Rescales alpha so the fraction of pixels passing the
+			// alpha test matches the top level.
+
+			bool		PreserveAlphaCoverage = false;
+			Float		AlphaReference = 0.5f;
+
+			// Filter taps wrap around instead of clamping to the edge.
+
+			bool		Wrap = false;
+		};
+
+		struct MipLevel
+		{
+			Uint32			Width = 0;
+			Uint32			Height = 0;
+
+			// RGBA in filter space, linear or decoded normals.
+
+			TVector<Float>	Pixels;
+		};
+
+		/************************************************************
+		*
+		*	Builds a mip chain on the CPU. Each level is resampled
+		*	from the one above with a separable filter, rows are
+		*	processed in parallel bands.
+		*
+		************************************************************/
+
+		class CMipChain
+		{
+		private:
+
+			MipOptions			Options;
+			TVector<MipLevel>	Levels;
+
+		private:
+
+			void BuildChain();
+
+			void PreserveAlphaCoverage();
+
+			void RenormalizeLevel
+			(
+				MipLevel & Level
+			);
+
+		public:
+
+			bool Generate
+			(
+				const BC::ImageRGBA8	& Source,
+				const MipOptions		& Options
+			);
+
+			bool Generate
+			(
+				const BC::ImageRGBA32F	& Source,
+				const MipOptions		& Options
+			);
+
+			// Converts a level back to its storage encoding.
+
+			void GetLevel
+			(
+				const Uint32			Level,
+					  TVector<Byte>	&	Pixels,
+					  BC::ImageRGBA8	&	Image
+			)	const;
+
+			void GetLevel
+			(
+				const Uint32				Level,
+					  BC::ImageRGBA32F	&	Image
+			)	const;
+
+			inline Uint32 GetNumLevels() const
+			{
+				return static_cast<Uint32>(Levels.size());
+			}
+
+			inline const MipLevel & GetLevel
+			(
+				const Uint32 Level
+			)	const
+			{
+				return Levels[Level];
+			}
+
+			static Uint32 GetNumLevels
+			(
+				const Uint32 Width,
+				const Uint32 Height
+			);
+		};
+	}
+}
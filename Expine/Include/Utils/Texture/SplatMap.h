@@ -0,0 +1,236 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include "Utils/File/MappedFile.h"
+
+namespace Texture
+{
+	namespace Splat
+	{
+		/************************************************************
+		*
+		*	Splat map layout, little endian:
+		*
+		*	SplatHeader
+		*	SplatTile[TilesX * TilesY], row major
+		*	Tile data, each tile 4 byte aligned
+		*
+		*	A tile holds a palette of up to 16 indices followed by
+		*	bit packed palette slots, 0, 1, 2 or 4 bits per cell.
+		*	Tiles using more distinct indices store 8 bit cells
+		*	without a palette. Cells are addressed with a stride
+		*	of TileSize, partial tiles at the border are padded.
+		*
+		************************************************************/
+
+		static constexpr Uint32 SplatMagic = 0x544C5053; // SPLT
+		static constexpr Uint32 SplatVersion = 1;
+
+		static constexpr Uint32 SplatMaxPalette = 16;
+
+		struct SplatHeader
+		{
+			Uint32	Magic;
+			Uint32	Version;
+			Uint32	Width;
+			Uint32	Height;
+			Uint32	TileShift;
+			Uint32	TilesX;
+			Uint32	TilesY;
+			Uint32	Reserved;
+			Uint64	DataSize;
+		};
+
+		struct SplatTile
+		{
+			// Relative to the tile data.
+
+			Uint32	Offset;
+
+			// Bits per cell, 8 stores the indices directly.
+
+			Uint8	Bits;
+			Uint8	NumColors;
+			Uint16	Reserved;
+		};
+
+		class CSplatMap
+		{
+		private:
+
+			File::CMappedFile	Mapping;
+			TVector<Byte>		Storage;
+
+			SplatHeader			Header = {};
+			const SplatTile *	Tiles = NULL;
+			const Byte *		Data = NULL;
+
+			Uint32				TileMask = 0;
+
+		private:
+
+			bool Attach
+			(
+				const Byte		* Content,
+				const Uint64	  Size
+			);
+
+			void DecodeTile
+			(
+				const Uint32	  TileX,
+				const Uint32	  TileY,
+				const Uint32	  X,
+				const Uint32	  Y,
+				const Uint32	  Width,
+				const Uint32	  Height,
+					  Uint8		* Output,
+				const size_t	  Pitch
+			)	const;
+
+		public:
+
+			CSplatMap() = default;
+
+			CSplatMap(const CSplatMap &) = delete;
+			CSplatMap & operator=(const CSplatMap &) = delete;
+
+			static bool IsSplatMap
+			(
+				const Byte		* Content,
+				const Uint64	  Size
+			);
+
+			// TileSize must be a power of two between 4 and 256.
+
+			bool Encode
+			(
+				const Uint8		* Indices,
+				const Uint32	  Width,
+				const Uint32	  Height,
+				const Uint32	  TileSize = 64
+			);
+
+			// Maps the file, tiles are paged in as they are read.
+
+			bool Open
+			(
+				const WString & Path
+			);
+
+			bool Load
+			(
+				TVector<Byte> && Content
+			);
+
+			bool Write
+			(
+				const WString & Path
+			)	const;
+
+			void Close();
+
+			// Decodes a rectangle, rows are Pitch bytes apart.
+
+			void DecodeRegion
+			(
+				const Uint32	  X,
+				const Uint32	  Y,
+				const Uint32	  Width,
+				const Uint32	  Height,
+					  Uint8		* Output,
+				const size_t	  Pitch
+			)	const;
+
+			// Decodes Count cells starting at a row major position, wrapping into the following rows.
+
+			void DecodeLinear
+			(
+				const Uint64	  Position,
+				const Uint64	  Count,
+					  Uint8		* Output
+			)	const;
+
+			void Decode
+			(
+				TVector<Uint8> & Output
+			)	const;
+
+			// Starts paging in the tiles covering a rectangle.
+
+			void Prefetch
+			(
+				const Uint32 X,
+				const Uint32 Y,
+				const Uint32 Width,
+				const Uint32 Height
+			)	const;
+
+			inline Uint8 Get
+			(
+				const Uint32 X,
+				const Uint32 Y
+			)	const
+			{
+				const SplatTile & Tile = Tiles[(Y >> Header.TileShift) * Header.TilesX + (X >> Header.TileShift)];
+
+				const Byte * Palette = Data + Tile.Offset;
+
+				if (Tile.Bits == 0)
+				{
+					return Palette[0];
+				}
+
+				const Uint32 Cell	= ((Y & TileMask) << Header.TileShift) | (X & TileMask);
+				const Uint32 Bit	= Cell * Tile.Bits;
+
+				const Uint32 * Words = reinterpret_cast<const Uint32*>(Palette + ((Tile.NumColors + 3) & ~3));
+
+				const Uint32 Value = (Words[Bit >> 5] >> (Bit & 31)) & ((1u << Tile.Bits) - 1);
+
+				return Tile.NumColors ? Palette[Value] : static_cast<Uint8>(Value);
+			}
+
+			inline Uint8 Get
+			(
+				const Uint64 Position
+			)	const
+			{
+				return Get(static_cast<Uint32>(Position % Header.Width), static_cast<Uint32>(Position / Header.Width));
+			}
+
+			inline bool IsEmpty() const
+			{
+				return Tiles == NULL;
+			}
+
+			inline Uint32 GetWidth() const
+			{
+				return Header.Width;
+			}
+
+			inline Uint32 GetHeight() const
+			{
+				return Header.Height;
+			}
+
+			inline Uint32 GetTileSize() const
+			{
+				return 1u << Header.TileShift;
+			}
+
+			inline Uint64 GetNumCells() const
+			{
+				return static_cast<Uint64>(Header.Width) * Header.Height;
+			}
+
+			// Bytes of tile data, excluding header and tile table.
+
+			inline Uint64 GetCompressedSize() const
+			{
+				return Header.DataSize;
+			}
+		};
+	}
+}
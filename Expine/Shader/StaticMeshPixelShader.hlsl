@@ -0,0 +1,85 @@
+// Instanced static mesh geometry, see Pipelines::StaticMesh::PipelineGeometry.
+
+// Matches Pipelines::StaticMesh::EMaterialFlags.
+
+#define MATERIAL_DIFFUSE	1
+#define MATERIAL_NORMAL		2
+#define MATERIAL_MASKED		4
+
+cbuffer MaterialConstants : register(b1)
+{
+	uint MaterialFlags;
+};
+
+Texture2D		DiffuseTexture	: register(t0);
+Texture2D		NormalTexture	: register(t1);
+
+SamplerState	LinearSampler	: register(s0);
+
+struct PSInput
+{
+	float4	Position		: SV_POSITION;
+	float3	WorldPosition	: POSITION;
+	float3	Normal			: NORMAL;
+	float2	Texcoord		: TEXCOORD0;
+};
+
+struct PSOutput
+{
+	float4 Color	: SV_TARGET0;
+	float4 Normal	: SV_TARGET1;
+};
+
+// The geometry carries no tangents, the frame is derived from the screen space derivatives.
+
+float3 PerturbNormal(float3 Normal, float3 WorldPosition, float2 Texcoord, float3 TangentNormal)
+{
+	const float3 DPX	= ddx(WorldPosition);
+	const float3 DPY	= ddy(WorldPosition);
+	const float2 DUVX	= ddx(Texcoord);
+	const float2 DUVY	= ddy(Texcoord);
+
+	const float3 DPYPerp = cross(DPY, Normal);
+	const float3 DPXPerp = cross(Normal, DPX);
+
+	const float3 Tangent	= DPYPerp * DUVX.x + DPXPerp * DUVY.x;
+	const float3 Bitangent	= DPYPerp * DUVX.y + DPXPerp * DUVY.y;
+
+	const float InvScale = rsqrt(max(max(dot(Tangent, Tangent), dot(Bitangent, Bitangent)), 1e-12f));
+
+	return normalize(mul(TangentNormal, float3x3(Tangent * InvScale, Bitangent * InvScale, Normal)));
+}
+
+PSOutput PSMain(PSInput Input, bool FrontFace : SV_IsFrontFace)
+{
+	float4 Diffuse = float4(1.0f, 1.0f, 1.0f, 1.0f);
+
+	if (MaterialFlags & MATERIAL_DIFFUSE)
+	{
+		Diffuse = DiffuseTexture.Sample(LinearSampler, Input.Texcoord);
+	}
+
+	if (MaterialFlags & MATERIAL_MASKED)
+	{
+		clip(Diffuse.a - 0.5f);
+	}
+
+	// Two sided geometry, back faces use the flipped normal.
+
+	float3 Normal = normalize(FrontFace ? Input.Normal : -Input.Normal);
+
+	if (MaterialFlags & MATERIAL_NORMAL)
+	{
+		const float3 TangentNormal = NormalTexture.Sample(LinearSampler, Input.Texcoord).xyz * 2.0f - 1.0f;
+
+		Normal = PerturbNormal(Normal, Input.WorldPosition, Input.Texcoord, TangentNormal);
+	}
+
+	PSOutput Output;
+	{
+		Output.Color	= float4(Diffuse.rgb, 1.0f);
+		Output.Normal	= float4(Normal * 0.5f + 0.5f, 1.0f);
+	}
+
+	return Output;
+}
@@ -0,0 +1,66 @@
+// Instanced static mesh geometry, see Pipelines::StaticMesh::PipelineGeometry.
+
+cbuffer ViewConstants : register(b0)
+{
+	float3				ViewOrigin;
+	float3				ViewFocus;
+	float3				ViewUp;
+	float3				ViewRotation;
+
+	row_major float4x4	ViewMatrix;
+	row_major float4x4	ViewProjectionMatrix;
+};
+
+struct VSInput
+{
+	float3	Position				: POSITION;
+	float3	Normal					: NORMAL;
+	float2	Texcoord				: TEXCOORD0;
+
+	// InstanceTransform, position and scale, rotation and the object id.
+
+	float4	InstancePositionScale	: TEXCOORD1;
+	float3	InstanceRotation		: TEXCOORD2;
+	uint	InstanceObjectId		: TEXCOORD3;
+};
+
+struct VSOutput
+{
+	float4	Position		: SV_POSITION;
+	float3	WorldPosition	: POSITION;
+	float3	Normal			: NORMAL;
+	float2	Texcoord		: TEXCOORD0;
+};
+
+// Rotations around X, Y and Z in radians, applied in that order to row vectors.
+
+float3x3 RotationMatrix(float3 Angles)
+{
+	float3 S;
+	float3 C;
+
+	sincos(Angles, S, C);
+
+	const float3x3 RotationX = float3x3(1.0f, 0.0f, 0.0f, 0.0f, C.x, S.x, 0.0f, -S.x, C.x);
+	const float3x3 RotationY = float3x3(C.y, 0.0f, -S.y, 0.0f, 1.0f, 0.0f, S.y, 0.0f, C.y);
+	const float3x3 RotationZ = float3x3(C.z, S.z, 0.0f, -S.z, C.z, 0.0f, 0.0f, 0.0f, 1.0f);
+
+	return mul(mul(RotationX, RotationY), RotationZ);
+}
+
+VSOutput VSMain(VSInput Input)
+{
+	const float3x3 Rotation = RotationMatrix(Input.InstanceRotation);
+
+	const float3 WorldPosition = mul(Input.Position * Input.InstancePositionScale.w, Rotation) + Input.InstancePositionScale.xyz;
+
+	VSOutput Output;
+	{
+		Output.Position			= mul(float4(WorldPosition, 1.0f), ViewProjectionMatrix);
+		Output.WorldPosition	= WorldPosition;
+		Output.Normal			= mul(Input.Normal, Rotation);
+		Output.Texcoord			= Input.Texcoord;
+	}
+
+	return Output;
+}
@@ -174,6 +174,18 @@ namespace D3D
 		Window = Parameter.DefaultWindow;
 		Viewport = Parameter.DefaultViewport;
 
+		// Records logged before this point wait in their thread rings.
+
+		if (!Logging::CLogWriter::Instance().IsRunning())
+		{
+			Logging::CLogWriter::InitializeOptions LogOptions;
+			{
+				LogOptions.WriteStdout = IsDebugMode;
+			}
+
+			Logging::CLogWriter::Instance().Initialize(LogOptions);
+		}
+
 		ErrorCode Error;
 
 		if ((Error = InitializeDevice()))
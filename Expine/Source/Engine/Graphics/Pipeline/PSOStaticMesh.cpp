@@ -0,0 +1,175 @@
+#include "Precompiled.h"
+
+#include "Pipeline/Pipelines.h"
+#include "Pipeline/PSOStaticMesh.h"
+#include "Utils/State/StateRasterizer.h"
+#include "Utils/State/StateBlend.h"
+#include "Utils/State/StateDepthStencil.h"
+#include "Utils/State/StateSampler.h"
+
+#include "Scene/Scene.h"
+#include "Scene/Object/ObjectBatch.h"
+
+namespace D3D
+{
+	namespace Pipelines
+	{
+		namespace StaticMesh
+		{
+			ErrorCode PipelineGeometry::CreateRootSignature()
+			{
+				ErrorCode Error;
+
+				RootSignature = new RRootSignature();
+				{
+					CD3DX12_ROOT_PARAMETER RootParameters[NumRootParameters];
+					{
+						CD3DX12_DESCRIPTOR_RANGE DescriptorRangesCBV[1];
+						{
+							DescriptorRangesCBV[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+						}
+
+						RootParameters[SceneConstants].InitAsDescriptorTable(_countof(DescriptorRangesCBV), DescriptorRangesCBV, D3D12_SHADER_VISIBILITY_ALL);
+
+						// Bound per material between the indirect draws of its batches.
+
+						CD3DX12_DESCRIPTOR_RANGE DescriptorRangesSRV[1];
+						{
+							DescriptorRangesSRV[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, NumMaterialTextures, 0);
+						}
+
+						RootParameters[MaterialTextures].InitAsDescriptorTable(_countof(DescriptorRangesSRV), DescriptorRangesSRV, D3D12_SHADER_VISIBILITY_PIXEL);
+						RootParameters[MaterialConstants].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+					}
+
+					D3D12_STATIC_SAMPLER_DESC SamplerDescs[1];
+					{
+						SamplerDescs[0] = SamplerStates::LinearSampler
+						(
+							0,
+							D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+							D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+							D3D12_TEXTURE_ADDRESS_MODE_WRAP
+						);
+					}
+
+					if ((Error = RootSignature->Create(RRootSignature::InitializeOptions(_countof(RootParameters), RootParameters, _countof(SamplerDescs), SamplerDescs))))
+					{
+						return Error;
+					}
+				}
+
+				D3D12_INDIRECT_ARGUMENT_DESC ArgumentDescs[1] = {};
+				{
+					ArgumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+				}
+
+				D3D12_COMMAND_SIGNATURE_DESC CommandSignatureDesc = {};
+				{
+					CommandSignatureDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+					CommandSignatureDesc.NumArgumentDescs = _countof(ArgumentDescs);
+					CommandSignatureDesc.pArgumentDescs = ArgumentDescs;
+				}
+
+				CommandSignature = new RCommandSignature();
+				{
+					if ((Error = CommandSignature->Create(CommandSignatureDesc)))
+					{
+						return Error;
+					}
+				}
+
+				return S_OK;
+			}
+
+			ErrorCode PipelineGeometry::Initialize()
+			{
+				ErrorCode Error;
+
+				Available = false;
+
+				if ((Error = PipelineObjectBase::Initialize()))
+				{
+					return Error;
+				}
+
+				Available = true;
+
+				return S_OK;
+			}
+
+			ErrorCode PipelineGeometry::CreatePipelineState()
+			{
+				ErrorCode Error;
+
+				static SharedPointer<CGrpShader> DefaultShader;
+
+				if (DefaultShader == NULL)
+				{
+					DefaultShader = new CGrpShader(this);
+				}
+
+				if ((Error = DefaultShader->CompileShaderType(CGrpShader::Vertex, L"StaticMeshVertexShader.hlsl", "VSMain", "vs_5_0")))
+				{
+					return Error;
+				}
+
+				if ((Error = DefaultShader->CompileShaderType(CGrpShader::Pixel, L"StaticMeshPixelShader.hlsl", "PSMain", "ps_5_0")))
+				{
+					return Error;
+				}
+
+				PipelineState = new RPipelineState(RootSignature);
+				{
+					// Instances carry InstanceTransform, position and scale, rotation and the object id.
+
+					D3D12_INPUT_ELEMENT_DESC InputElementDesc[] =
+					{
+						"POSITION",	0, DXGI_FORMAT_R32G32B32_FLOAT,		SlotGeometry,	0,	D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,		0,
+						"NORMAL",	0, DXGI_FORMAT_R32G32B32_FLOAT,		SlotGeometry,	12,	D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,		0,
+						"TEXCOORD",	0, DXGI_FORMAT_R32G32_FLOAT,		SlotGeometry,	24,	D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,		0,
+						"TEXCOORD",	1, DXGI_FORMAT_R32G32B32A32_FLOAT,	SlotInstances,	0,	D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA,	1,
+						"TEXCOORD",	2, DXGI_FORMAT_R32G32B32_FLOAT,		SlotInstances,	16,	D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA,	1,
+						"TEXCOORD",	3, DXGI_FORMAT_R32_UINT,			SlotInstances,	28,	D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA,	1
+					};
+
+					static_assert(sizeof(StaticMeshVertex) == 32, "StaticMeshVertex does not match the input layout");
+
+					D3D12_INPUT_LAYOUT_DESC InputLayoutDesc = INPUT_LAYOUT(InputElementDesc);
+					D3D12_DEPTH_STENCIL_DESC DepthStencilDesc = DepthStencilState::Default;
+					D3D12_BLEND_DESC BlendDesc = BlendState::NoBlend;
+
+					// Leaves and fronds are two sided, nothing is culled.
+
+					D3D12_RASTERIZER_DESC RasterizerDesc = RasterizerState::CullNone;
+
+					DXGI_FORMAT RTVFormats[2] =
+					{
+						CScene::ColorSceneFormat,
+						CScene::NormalSceneFormat
+					};
+
+					RPipelineState::InitializeOptions * Options = new RPipelineState::InitializeOptionsGraphics
+					(
+						DefaultShader,
+						InputLayoutDesc,
+						BlendDesc,
+						RasterizerDesc,
+						DepthStencilDesc,
+						D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
+						_countof(RTVFormats),
+						RTVFormats,
+						CSceneComponents::DepthFormat
+					);
+
+					if ((Error = PipelineState->Create(Options)))
+					{
+						return Error;
+					}
+				}
+
+				return S_OK;
+			}
+		}
+	}
+}
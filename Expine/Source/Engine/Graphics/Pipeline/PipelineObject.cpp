@@ -1,10 +1,13 @@
 #include "Precompiled.h"
 
 #include "Pipeline/PipelineObject.h"
+#include "Pipeline/Pipelines.h"
 #include "Buffer/BufferConstant.h"
+#include "Raw/RawCommandList.h"
 #include "Raw/RawCommandSignature.h"
 #include "Raw/RawRootSignature.h"
 #include "Raw/RawPipelineState.h"
+#include "Raw/RawShader.h"
 
 namespace D3D
 {
@@ -77,6 +80,11 @@ namespace D3D
 		return S_OK;
 	}
 
+	void PipelineVariation::Apply(RGrpCommandList * CmdList) const
+	{
+		CmdList->ApplyPipelineState(PipelineState);
+	}
+
 	template<class Child>
 	void PSOPermutations<Child>::CreateShaderDefinitionValueMap
 	(
@@ -98,54 +106,183 @@ namespace D3D
 		Default = DefaultObject;
 	}
 
+	// Points into the defines, which have to outlive the result.
+
+	static TVector<ShaderMacro> GetShaderMacros(const TVector<ShaderCache::ShaderDefine> & Defines)
+	{
+		TVector<ShaderMacro> Macros;
+		{
+			for (const ShaderCache::ShaderDefine & Define : Defines)
+			{
+				Macros.push_back({ Define.Name.c_str(), Define.Value.c_str() });
+			}
+
+			Macros.push_back({ NULL, NULL });
+		}
+
+		return Macros;
+	}
+
 	template<class Child>
 	ErrorCode PSOPermutations<Child>::AddPermutation
 	(
-		TArray<ShaderMacro*, 6>	Macros
+		const TVector<ShaderCache::ShaderDefine> & Defines
+	)
+	{
+		const Uint64 Hash = ShaderCache::HashShaderDefines(Defines);
+
+		if (Permutations.find(Hash) != Permutations.end())
+		{
+			return S_OK;
+		}
+
+		if (Default->GetPipeline() == NULL)
+		{
+			return E_FAIL;
+		}
+
+		const CGrpShader * Shaders = Default->GetPipeline()->GetShaderGroup();
+
+		TVector<ShaderMacro> Macros = GetShaderMacros(Defines);
+
+		TArray<ShaderMacro*, CGrpShader::NumShaderTypes> StageMacros = {};
+		{
+			for (UINT N = 0; N < CGrpShader::NumShaderTypes; ++N)
+			{
+				if (Shaders->GetShader(static_cast<CGrpShader::EShaderType>(N)))
+				{
+					StageMacros[N] = Macros.data();
+				}
+			}
+		}
+
+		SharedPointer<PipelineVariation> Variation = new PipelineVariation();
+
+		ErrorCode Error = Default->CreateVariation(StageMacros, Variation.Get());
+
+		if (Error)
+		{
+			return Error;
+		}
+
+		Permutations.insert_or_assign(Hash, Variation);
+
+		return S_OK;
+	}
+
+	template<class Child>
+	ErrorCode PSOPermutations<Child>::SchedulePermutations
+	(
+		const Int32 Priority
 	)
 	{
-		SharedPointer<PipelineObject<Child> > PipelineObject = NewPipelineObject<Child>();
-		size_t Hash;
-		std::hash<LPCSTR> Hasher;
+		if (Default->GetPipeline() == NULL)
+		{
+			return E_FAIL;
+		}
 
-		for (ShaderMacro * Macro : Macros)
+		const CGrpShader * Shaders = Default->GetPipeline()->GetShaderGroup();
+
+		for (TVector<ShaderCache::ShaderDefine> & Defines : ShaderCache::EnumeratePermutations(DefinitionValueMap.GetAxes()))
 		{
-			for (Hash = 0; Macro->Definition && Macro->Name; Macro->Definition++)
+			const Uint64 Hash = ShaderCache::HashShaderDefines(Defines);
+
+			if (Permutations.find(Hash) != Permutations.end() || Pending.find(Hash) != Pending.end())
 			{
-				Hash ^= Hasher(Macro->Definition) ^ Hasher(Macro->Name);
+				continue;
 			}
 
-			if (Permutations.Find(Hash))
+			PendingPermutation Permutation;
+			{
+				Permutation.Defines = std::move(Defines);
+			}
+
+			const TVector<ShaderMacro> Macros = GetShaderMacros(Permutation.Defines);
+
+			for (UINT N = 0; N < CGrpShader::NumShaderTypes; ++N)
+			{
+				const RShader * Shader = Shaders->GetShader(static_cast<CGrpShader::EShaderType>(N));
+
+				if (Shader)
+				{
+					Permutation.Shaders.push_back(CShaderManager::Instance().ScheduleShader
+					(
+						Shader->GetPath(),
+						Shader->GetEntryPoint(),
+						Shader->GetTarget(),
+						Macros,
+						Shader->GetIncludeHandler().Get(),
+						Priority
+					));
+				}
+			}
+
+			Pending.insert({ Hash, std::move(Permutation) });
+		}
+
+		return S_OK;
+	}
+
+	template<class Child>
+	ErrorCode PSOPermutations<Child>::Update()
+	{
+		for (auto Iter = Pending.begin(); Iter != Pending.end();)
+		{
+			const bool Compiled = std::none_of(Iter->second.Shaders.begin(), Iter->second.Shaders.end(), [](const Uint64 Shader)
+			{
+				return CShaderManager::Instance().IsShaderPending(Shader);
+			});
+
+			if (!Compiled)
 			{
+				++Iter;
 				continue;
 			}
 
-			ErrorCode Error = Default->CreateVariation(Macros, PipelineObject.Get());
+			// The shaders load from the cache now.
+
+			const ErrorCode Error = AddPermutation(Iter->second.Defines);
+
+			Iter = Pending.erase(Iter);
 
 			if (Error)
 			{
 				return Error;
 			}
-
-			Permutations.insert_or_assign(Hash, PipelineObject);
 		}
 
 		return S_OK;
 	}
 
 	template<class Child>
-	PipelineObject<Child> * PSOPermutations<Child>::GetPipeline
+	PipelineObjectBase * PSOPermutations<Child>::GetPipeline
 	(
 		const ShaderDefinitionValueMap & Definitions
 	)	const
 	{
-		const SharedPointer<PipelineObject<Child> > * Object = Permutations.Find(Definitions.GetHash());
+		const Uint64 Hash = Definitions.GetHash();
 
-		if (Object)
+		const auto Object = Permutations.find(Hash);
+
+		if (Object != Permutations.end())
 		{
-			return Object->Get();
+			return Object->second.Get();
 		}
 
-		return nullptr;
+		// Requested means visible, its shaders move to the front of the queue.
+
+		const auto Waiting = Pending.find(Hash);
+
+		if (Waiting != Pending.end())
+		{
+			for (const Uint64 Shader : Waiting->second.Shaders)
+			{
+				CShaderManager::Instance().PrioritizeShader(Shader, ShaderCache::CompilePriorityVisible);
+			}
+		}
+
+		return Default;
 	}
-}
+
+	template class PSOPermutations<Pipelines::VolumetricLighting::ApplyLighting>;
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "Pipeline/PSOAtmosphere.h"
 #include "Pipeline/PSOPostProcess.h"
 #include "Pipeline/PSOTerrain.h"
+#include "Pipeline/PSOStaticMesh.h"
 #include "Pipeline/PSOTriangle.h"
 #include "Pipeline/PSOLine.h"
 #include "Pipeline/PSOComposite.h"
@@ -411,6 +412,16 @@ namespace D3D
 				}
 			}
 
+			// Static meshes are optional, the scene is drawn without them when their shaders fail.
+
+			if (StaticMesh::PipelineGeometry::New())
+			{
+				if ((Error = StaticMesh::PipelineGeometry::Instance().Initialize()))
+				{
+					CErrorLog::Log<LogWarning>() << "Static mesh pipeline unavailable: " << Error << CErrorLog::EndLine;
+				}
+			}
+
 			if (VolumetricLighting::DownsamplePipeline::New())
 			{
 				if ((Error = VolumetricLighting::DownsamplePipeline::Instance().Initialize()))
@@ -451,6 +462,26 @@ namespace D3D
 				}
 			}
 
+			// The upsampling variants compile in the background, the default pipeline stands in meanwhile.
+
+			if (PSOPermutations<VolumetricLighting::ApplyLighting>::New(VolumetricLighting::ApplyLighting::Instance_Pointer()))
+			{
+				PSOPermutations<VolumetricLighting::ApplyLighting> & Permutations = PSOPermutations<VolumetricLighting::ApplyLighting>::Instance();
+				{
+					Permutations.CreateShaderDefinitionValueMap
+					({
+						{ "FOGMODE",		{ "FOGMODE_FULL" } },
+						{ "UPSAMPLEMODE",	{ "UPSAMPLEMODE_BILINEAR", "UPSAMPLEMODE_BILATERAL" } },
+						{ "SAMPLEMODE",		{ "SAMPLEMODE_SINGLE" } }
+					});
+				}
+
+				if ((Error = Permutations.SchedulePermutations()))
+				{
+					return Error;
+				}
+			}
+
 			if (VolumetricLighting::ApplyLightingMSAA::New())
 			{
 				if ((Error = VolumetricLighting::ApplyLightingMSAA::Instance().Initialize()))
@@ -511,6 +542,16 @@ namespace D3D
 			
 			return S_OK;
 		}
+
+		ErrorCode UpdatePipelines()
+		{
+			if (PSOPermutations<VolumetricLighting::ApplyLighting>::Instance_Pointer())
+			{
+				return PSOPermutations<VolumetricLighting::ApplyLighting>::Instance().Update();
+			}
+
+			return S_OK;
+		}
 }
 
 	ErrorCode D3D::Pipelines::VolumetricLighting::DownsamplePipeline::CreateRootSignature()
@@ -0,0 +1,60 @@
+#include "Precompiled.h"
+
+#include "Process/ParallelProcessing.h"
+
+namespace D3D
+{
+	CParallelProcessManager::CParallelProcessManager()
+	{
+		ProcessGraph.SetListener(this);
+	}
+
+	CParallelProcessManager::~CParallelProcessManager()
+	{
+		ProcessGraph.Cancel();
+		ProcessGraph.Run();
+
+		for (IParallelProcessingUnit * Unit : ProcessedUnits)
+		{
+			delete Unit;
+		}
+	}
+
+	void CParallelProcessManager::OnProcessingUnitFinish(IParallelProcessingUnit * Unit)
+	{
+		std::lock_guard<TMutex> Lock(ProcessedUnitsMutex);
+		{
+			ProcessedUnits.push_back(Unit);
+		}
+	}
+
+	void CParallelProcessManager::OnProcessingUnitAbort(IParallelProcessingUnit * Unit)
+	{
+		CErrorLog::Log<LogWarning>() << "Processing unit aborted";
+
+		std::lock_guard<TMutex> Lock(ProcessedUnitsMutex);
+		{
+			ProcessedUnits.push_back(Unit);
+		}
+	}
+
+	void CParallelProcessManager::RunProcessing()
+	{
+		ProcessGraph.Run();
+
+		// Units are kept alive until the graph no longer references them.
+
+		TVector<IParallelProcessingUnit*> Units;
+		{
+			std::lock_guard<TMutex> Lock(ProcessedUnitsMutex);
+			{
+				Units.swap(ProcessedUnits);
+			}
+		}
+
+		for (IParallelProcessingUnit * Unit : Units)
+		{
+			delete Unit;
+		}
+	}
+}
@@ -0,0 +1,293 @@
+#include "Precompiled.h"
+
+#include "Process/ParallelProcessingGraph.h"
+
+namespace D3D
+{
+	CParallelProcessGraph::CParallelProcessGraph() :
+		Cancelled(false)
+	{}
+
+	void CParallelProcessGraph::SetStageConcurrency(const EProcessingStage Stage, const Uint32 MaxConcurrency)
+	{
+		std::lock_guard<TMutex> Lock(GraphMutex);
+		{
+			Stages[Stage].MaxConcurrency = Math::Max(MaxConcurrency, 1U);
+		}
+	}
+
+	void CParallelProcessGraph::AddProcessingUnit(IParallelProcessingUnit * Unit, const CParallelProcessPrerequisite & Prerequisites)
+	{
+		TVector<Node*> Aborts;
+
+		{
+			std::lock_guard<TMutex> Lock(GraphMutex);
+
+			if (NodeMap.Find(Unit))
+			{
+				CErrorLog::Log<LogWarning>() << "Processing unit added twice to the graph";
+				return;
+			}
+
+			Node * Target = Nodes.emplace(Nodes.end(), new Node())->get();
+			{
+				Target->Unit	= Unit;
+				Target->Stage	= Unit->GetStage();
+			}
+
+			for (IParallelProcessingUnit * Prerequisite : Prerequisites.GetUnits())
+			{
+				Node ** Source = NodeMap.Find(Prerequisite);
+
+				if (!Source)
+				{
+					continue;
+				}
+
+				switch ((*Source)->State)
+				{
+					case NodePending:
+					case NodeReady:
+					case NodeRunning:
+					{
+						(*Source)->Dependents.push_back(Target);
+						Target->NumPending++;
+					}
+
+					break;
+
+					case NodeAborted:
+					{
+						Target->PrerequisiteAborted = true;
+					}
+
+					break;
+
+					default:
+					{
+					}
+				}
+			}
+
+			NodeMap.emplace(Unit, Target);
+			NumOutstanding++;
+
+			if (Target->NumPending == 0)
+			{
+				if (Target->PrerequisiteAborted)
+				{
+					Complete(Target, true, Aborts);
+				}
+				else
+				{
+					Target->State = NodeReady;
+					Stages[Target->Stage].Ready.push(Target);
+				}
+			}
+
+			if (Running)
+			{
+				Dispatch(Aborts);
+			}
+		}
+
+		NotifyAborts(Aborts);
+	}
+
+	void CParallelProcessGraph::Execute(Node * Target)
+	{
+		IParallelProcessingUnit * Unit = Target->Unit;
+
+		bool Aborted = false;
+
+		try
+		{
+			const int32_t IterationCount = Unit->GetIterationCount();
+
+			for (int32_t N = 0; N < IterationCount; ++N)
+			{
+				if (IsCancelled())
+				{
+					Aborted = true;
+					break;
+				}
+
+				Unit->Process(N);
+			}
+		}
+		catch (const Exception & Exception)
+		{
+			CErrorLog::Log<LogException>() << "Processing unit failed: " << Exception.what();
+			Aborted = true;
+		}
+
+		// Dependents are released only after the callback returned.
+
+		if (!Aborted && Listener)
+		{
+			Listener->OnProcessingUnitFinish(Unit);
+		}
+
+		TVector<Node*> Aborts;
+
+		{
+			std::lock_guard<TMutex> Lock(GraphMutex);
+			{
+				Stages[Target->Stage].NumRunning--;
+
+				Complete(Target, Aborted, Aborts);
+				Dispatch(Aborts);
+			}
+		}
+
+		NotifyAborts(Aborts);
+	}
+
+	void CParallelProcessGraph::Complete(Node * Target, const bool Aborted, TVector<Node*> & Aborts)
+	{
+		Target->State = Aborted ? NodeAborted : NodeFinished;
+
+		NumOutstanding--;
+
+		if (Aborted)
+		{
+			Aborts.push_back(Target);
+		}
+
+		for (Node * Dependent : Target->Dependents)
+		{
+			Dependent->PrerequisiteAborted |= Aborted;
+
+			if (--Dependent->NumPending > 0)
+			{
+				continue;
+			}
+
+			if (Dependent->PrerequisiteAborted || IsCancelled())
+			{
+				Complete(Dependent, true, Aborts);
+			}
+			else
+			{
+				Dependent->State = NodeReady;
+				Stages[Dependent->Stage].Ready.push(Dependent);
+			}
+		}
+	}
+
+	void CParallelProcessGraph::Dispatch(TVector<Node*> & Aborts)
+	{
+		for (Stage & Current : Stages)
+		{
+			while (!Current.Ready.empty())
+			{
+				if (!IsCancelled() && Current.NumRunning >= Current.MaxConcurrency)
+				{
+					break;
+				}
+
+				Node * Target = Current.Ready.top();
+				{
+					Current.Ready.pop();
+				}
+
+				if (IsCancelled())
+				{
+					Complete(Target, true, Aborts);
+					continue;
+				}
+
+				Target->State = NodeRunning;
+				Current.NumRunning++;
+
+				Tasks.run([this, Target]()
+				{
+					Execute(Target);
+				});
+			}
+		}
+	}
+
+	void CParallelProcessGraph::NotifyAborts(const TVector<Node*> & Aborts)
+	{
+		if (!Listener)
+		{
+			return;
+		}
+
+		for (Node * Target : Aborts)
+		{
+			Listener->OnProcessingUnitAbort(Target->Unit);
+		}
+	}
+
+	void CParallelProcessGraph::Run()
+	{
+		TVector<Node*> Aborts;
+
+		{
+			std::lock_guard<TMutex> Lock(GraphMutex);
+			{
+				Running = true;
+				Dispatch(Aborts);
+			}
+		}
+
+		NotifyAborts(Aborts);
+
+		Tasks.wait();
+
+		Aborts.clear();
+
+		{
+			std::lock_guard<TMutex> Lock(GraphMutex);
+
+			// Whatever is left waits on a cycle and can never become ready.
+
+			if (NumOutstanding > 0)
+			{
+				CErrorLog::Log<LogError>() << "Processing graph has " << NumOutstanding << " units with unresolved prerequisites";
+
+				for (auto & Target : Nodes)
+				{
+					if (Target->State == NodePending)
+					{
+						Target->State = NodeAborted;
+						Aborts.push_back(Target.get());
+					}
+				}
+			}
+		}
+
+		NotifyAborts(Aborts);
+
+		std::lock_guard<TMutex> Lock(GraphMutex);
+		{
+			Running			= false;
+			NumOutstanding	= 0;
+
+			Nodes.clear();
+			NodeMap.clear();
+
+			Cancelled.store(false);
+		}
+	}
+
+	void CParallelProcessGraph::Cancel()
+	{
+		Cancelled.store(true);
+
+		TVector<Node*> Aborts;
+
+		{
+			std::lock_guard<TMutex> Lock(GraphMutex);
+
+			if (Running)
+			{
+				Dispatch(Aborts);
+			}
+		}
+
+		NotifyAborts(Aborts);
+	}
+}
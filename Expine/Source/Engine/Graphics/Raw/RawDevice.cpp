@@ -1,6 +1,7 @@
 #include "Precompiled.h"
 
 #include "Raw/RawDevice.h"
+#include "Raw/RawPipelineState.h"
 #include "Command/CommandQueue.h"
 #include "Pipeline/Pipelines.h"
 #include "Resource/Texture/TextureManager.h"
@@ -80,11 +81,23 @@ namespace D3D
 				return Error;
 			}
 
+			// Without a cache every pipeline is simply compiled by the driver.
+
+			if ((Error = RPipelineState::InitializeCache(pAdapter)))
+			{
+				CErrorLog::Log<LogWarning>() << "Unable to initialize pipeline cache: " << Error << CErrorLog::EndLine;
+			}
+
 			if ((Error = SetupPipelines()))
 			{
 				return Error;
 			}
 
+			// Keeps the blobs of this launch even if it does not shut down cleanly.
+
+			RPipelineState::SaveCache();
+			RPipelineState::LogCacheStats();
+
 			if ((Error = SetupCommandQueues()))
 			{
 				return Error;
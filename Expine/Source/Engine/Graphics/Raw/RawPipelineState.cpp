@@ -3,8 +3,350 @@
 #include "Raw/RawPipelineState.h"
 #include "Raw/RawDevice.h"
 
+#include <chrono>
+
 namespace D3D
 {
+	/****
+	*	Pipeline cache
+	****/
+
+	enum EPipelineStateKind : Uint32
+	{
+		PipelineStateBlend,
+		PipelineStateRasterizer,
+		PipelineStateDepthStencil,
+		PipelineStateInputLayout,
+		PipelineStateStreamOutput
+	};
+
+	static PipelineCache::CPipelineCache g_PipelineCache;
+
+	static Uint64 HashByteCode
+	(
+		const D3D12_SHADER_BYTECODE & ByteCode
+	)
+	{
+		if (ByteCode.pShaderBytecode == NULL || ByteCode.BytecodeLength == 0)
+		{
+			return 0;
+		}
+
+		return ShaderCache::HashBytes(ByteCode.pShaderBytecode, ByteCode.BytecodeLength);
+	}
+
+	static PipelineCache::StateHandle InternBlendState
+	(
+		const D3D12_BLEND_DESC & Desc
+	)
+	{
+		PipelineCache::CStateWriter Writer;
+		{
+			Writer.Append(Desc.AlphaToCoverageEnable);
+			Writer.Append(Desc.IndependentBlendEnable);
+
+			for (const D3D12_RENDER_TARGET_BLEND_DESC & Target : Desc.RenderTarget)
+			{
+				Writer.Append(Target.BlendEnable);
+				Writer.Append(Target.LogicOpEnable);
+				Writer.Append(Target.SrcBlend);
+				Writer.Append(Target.DestBlend);
+				Writer.Append(Target.BlendOp);
+				Writer.Append(Target.SrcBlendAlpha);
+				Writer.Append(Target.DestBlendAlpha);
+				Writer.Append(Target.BlendOpAlpha);
+				Writer.Append(Target.LogicOp);
+				Writer.Append(Target.RenderTargetWriteMask);
+			}
+		}
+
+		return g_PipelineCache.Intern(PipelineStateBlend, Writer);
+	}
+
+	static PipelineCache::StateHandle InternRasterizerState
+	(
+		const D3D12_RASTERIZER_DESC & Desc
+	)
+	{
+		PipelineCache::CStateWriter Writer;
+		{
+			Writer.Append(Desc.FillMode);
+			Writer.Append(Desc.CullMode);
+			Writer.Append(Desc.FrontCounterClockwise);
+			Writer.Append(Desc.DepthBias);
+			Writer.Append(Desc.DepthBiasClamp);
+			Writer.Append(Desc.SlopeScaledDepthBias);
+			Writer.Append(Desc.DepthClipEnable);
+			Writer.Append(Desc.MultisampleEnable);
+			Writer.Append(Desc.AntialiasedLineEnable);
+			Writer.Append(Desc.ForcedSampleCount);
+			Writer.Append(Desc.ConservativeRaster);
+		}
+
+		return g_PipelineCache.Intern(PipelineStateRasterizer, Writer);
+	}
+
+	static PipelineCache::StateHandle InternDepthStencilState
+	(
+		const D3D12_DEPTH_STENCIL_DESC & Desc
+	)
+	{
+		PipelineCache::CStateWriter Writer;
+		{
+			Writer.Append(Desc.DepthEnable);
+			Writer.Append(Desc.DepthWriteMask);
+			Writer.Append(Desc.DepthFunc);
+			Writer.Append(Desc.StencilEnable);
+			Writer.Append(Desc.StencilReadMask);
+			Writer.Append(Desc.StencilWriteMask);
+
+			for (const D3D12_DEPTH_STENCILOP_DESC & Face : { Desc.FrontFace, Desc.BackFace })
+			{
+				Writer.Append(Face.StencilFailOp);
+				Writer.Append(Face.StencilDepthFailOp);
+				Writer.Append(Face.StencilPassOp);
+				Writer.Append(Face.StencilFunc);
+			}
+		}
+
+		return g_PipelineCache.Intern(PipelineStateDepthStencil, Writer);
+	}
+
+	static PipelineCache::StateHandle InternInputLayout
+	(
+		const D3D12_INPUT_LAYOUT_DESC & Desc
+	)
+	{
+		PipelineCache::CStateWriter Writer;
+		{
+			const UINT NumElements = Desc.pInputElementDescs ? Desc.NumElements : 0;
+
+			Writer.Append(NumElements);
+
+			for (UINT N = 0; N < NumElements; ++N)
+			{
+				const D3D12_INPUT_ELEMENT_DESC & Element = Desc.pInputElementDescs[N];
+
+				Writer.Append(Element.SemanticName);
+				Writer.Append(Element.SemanticIndex);
+				Writer.Append(Element.Format);
+				Writer.Append(Element.InputSlot);
+				Writer.Append(Element.AlignedByteOffset);
+				Writer.Append(Element.InputSlotClass);
+				Writer.Append(Element.InstanceDataStepRate);
+			}
+		}
+
+		return g_PipelineCache.Intern(PipelineStateInputLayout, Writer);
+	}
+
+	static PipelineCache::StateHandle InternStreamOutput
+	(
+		const D3D12_STREAM_OUTPUT_DESC & Desc
+	)
+	{
+		PipelineCache::CStateWriter Writer;
+		{
+			const UINT NumEntries = Desc.pSODeclaration ? Desc.NumEntries : 0;
+			const UINT NumStrides = Desc.pBufferStrides ? Desc.NumStrides : 0;
+
+			Writer.Append(NumEntries);
+
+			for (UINT N = 0; N < NumEntries; ++N)
+			{
+				const D3D12_SO_DECLARATION_ENTRY & Entry = Desc.pSODeclaration[N];
+
+				Writer.Append(Entry.Stream);
+				Writer.Append(Entry.SemanticName);
+				Writer.Append(Entry.SemanticIndex);
+				Writer.Append(Entry.StartComponent);
+				Writer.Append(Entry.ComponentCount);
+				Writer.Append(Entry.OutputSlot);
+			}
+
+			Writer.Append(NumStrides);
+
+			for (UINT N = 0; N < NumStrides; ++N)
+			{
+				Writer.Append(Desc.pBufferStrides[N]);
+			}
+
+			Writer.Append(Desc.RasterizedStream);
+		}
+
+		return g_PipelineCache.Intern(PipelineStateStreamOutput, Writer);
+	}
+
+	static PipelineCache::PipelineDescription DescribePipeline
+	(
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC	& Desc,
+		const Uint64								  RootSignature
+	)
+	{
+		PipelineCache::PipelineDescription Description;
+		{
+			Description.Type = Graphics;
+
+			Description.States =
+			{
+				InternBlendState(Desc.BlendState),
+				InternRasterizerState(Desc.RasterizerState),
+				InternDepthStencilState(Desc.DepthStencilState),
+				InternInputLayout(Desc.InputLayout),
+				InternStreamOutput(Desc.StreamOutput)
+			};
+
+			Description.Shaders =
+			{
+				HashByteCode(Desc.VS),
+				HashByteCode(Desc.PS),
+				HashByteCode(Desc.DS),
+				HashByteCode(Desc.HS),
+				HashByteCode(Desc.GS)
+			};
+		}
+
+		PipelineCache::CStateWriter Fixed;
+		{
+			Fixed.Append(RootSignature);
+			Fixed.Append(Desc.SampleMask);
+			Fixed.Append(Desc.IBStripCutValue);
+			Fixed.Append(Desc.PrimitiveTopologyType);
+			Fixed.Append(Desc.NumRenderTargets);
+
+			for (const DXGI_FORMAT Format : Desc.RTVFormats)
+			{
+				Fixed.Append(Format);
+			}
+
+			Fixed.Append(Desc.DSVFormat);
+			Fixed.Append(Desc.SampleDesc.Count);
+			Fixed.Append(Desc.SampleDesc.Quality);
+			Fixed.Append(Desc.NodeMask);
+			Fixed.Append(Desc.Flags);
+		}
+
+		Description.Fixed = Fixed.GetContent();
+
+		return Description;
+	}
+
+	static PipelineCache::PipelineDescription DescribePipeline
+	(
+		const D3D12_COMPUTE_PIPELINE_STATE_DESC		& Desc,
+		const Uint64								  RootSignature
+	)
+	{
+		PipelineCache::PipelineDescription Description;
+		{
+			Description.Type = Compute;
+			Description.Shaders =
+			{
+				HashByteCode(Desc.CS)
+			};
+		}
+
+		PipelineCache::CStateWriter Fixed;
+		{
+			Fixed.Append(RootSignature);
+			Fixed.Append(Desc.NodeMask);
+			Fixed.Append(Desc.Flags);
+		}
+
+		Description.Fixed = Fixed.GetContent();
+
+		return Description;
+	}
+
+	static ErrorCode CreatePipelineState
+	(
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC	* Desc,
+			  ComPointer<IPipelineState>			& PipelineState
+	)
+	{
+		return DEVICE->CreateGraphicsPipelineState(Desc, IID_PPV_ARGS(&PipelineState));
+	}
+
+	static ErrorCode CreatePipelineState
+	(
+		const D3D12_COMPUTE_PIPELINE_STATE_DESC		* Desc,
+			  ComPointer<IPipelineState>			& PipelineState
+	)
+	{
+		return DEVICE->CreateComputePipelineState(Desc, IID_PPV_ARGS(&PipelineState));
+	}
+
+	template<class Desc>
+	static ErrorCode CreatePipelineStateCached
+	(
+				Desc						* Options,
+		const	Uint64						  RootSignature,
+				PipelineCache::Hash128		& Key,
+				ComPointer<IPipelineState>	& PipelineState
+	)
+	{
+		const PipelineCache::PipelineDescription Description = DescribePipeline(*Options, RootSignature);
+
+		Key = g_PipelineCache.GetKey(Description);
+
+		TVector<Byte> Blob;
+
+		bool FromBlob = g_PipelineCache.Request(Key, Description, Blob);
+
+		if (FromBlob)
+		{
+			Options->CachedPSO.pCachedBlob				= Blob.data();
+			Options->CachedPSO.CachedBlobSizeInBytes	= Blob.size();
+		}
+
+		const auto Start = std::chrono::high_resolution_clock::now();
+
+		ErrorCode Error = CreatePipelineState(Options, PipelineState);
+
+		// The driver refuses blobs of another version, create from scratch.
+
+		if (Error && FromBlob)
+		{
+			g_PipelineCache.RejectBlob(Key);
+
+			Options->CachedPSO.pCachedBlob				= NULL;
+			Options->CachedPSO.CachedBlobSizeInBytes	= 0;
+
+			FromBlob = false;
+			Error = CreatePipelineState(Options, PipelineState);
+		}
+
+		// The options outlive the blob, they are kept for ReCreate.
+
+		Options->CachedPSO.pCachedBlob				= NULL;
+		Options->CachedPSO.CachedBlobSizeInBytes	= 0;
+
+		if (Error)
+		{
+			return Error;
+		}
+
+		const auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start);
+		{
+			g_PipelineCache.RecordCreation(static_cast<Uint64>(Elapsed.count()), FromBlob);
+		}
+
+		if (!FromBlob)
+		{
+			ComPointer<IBlob> Cached;
+
+			if (!(Error = PipelineState->GetCachedBlob(&Cached)))
+			{
+				const Byte * Data = static_cast<const Byte*>(Cached->GetBufferPointer());
+				{
+					g_PipelineCache.SetBlob(Key, TVector<Byte>(Data, Data + Cached->GetBufferSize()));
+				}
+			}
+		}
+
+		return S_OK;
+	}
+
 	ShaderType RPipelineState::InitializeOptionsGraphics::Type()
 	{
 		return Graphics;
@@ -456,28 +798,110 @@ namespace D3D
 		this->RootSignature = RootSignature;
 	}
 
-	ErrorCode RPipelineState::Create
+	ErrorCode RPipelineState::InitializeCache(IUnknown * const pAdapter)
+	{
+		PipelineCache::CPipelineCache::InitializeOptions Options;
+
+		ComPointer<IDXGIAdapter1> Adapter;
+
+		if (pAdapter && !FAILED(pAdapter->QueryInterface(IID_PPV_ARGS(&Adapter))))
+		{
+			DXGI_ADAPTER_DESC1 AdapterDesc;
+
+			if (!FAILED(Adapter->GetDesc1(&AdapterDesc)))
+			{
+				Options.DeviceHash = ShaderCache::HashCombine(Options.DeviceHash, AdapterDesc.VendorId);
+				Options.DeviceHash = ShaderCache::HashCombine(Options.DeviceHash, AdapterDesc.DeviceId);
+				Options.DeviceHash = ShaderCache::HashCombine(Options.DeviceHash, AdapterDesc.SubSysId);
+				Options.DeviceHash = ShaderCache::HashCombine(Options.DeviceHash, AdapterDesc.Revision);
+			}
+
+			LARGE_INTEGER DriverVersion;
+
+			if (!FAILED(Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion)))
+			{
+				Options.DeviceHash = ShaderCache::HashCombine(Options.DeviceHash, static_cast<Uint64>(DriverVersion.QuadPart));
+			}
+		}
+
+		if (!g_PipelineCache.Initialize(Options))
+		{
+			return E_FAIL;
+		}
+
+		// Missing on the first launch.
+
+		g_PipelineCache.Load();
+
+		return S_OK;
+	}
+
+	bool RPipelineState::SaveCache(const bool UsedOnly)
+	{
+		return g_PipelineCache.Save(UsedOnly);
+	}
+
+	void RPipelineState::LogCacheStats()
+	{
+		const PipelineCache::PipelineCacheStats Stats = g_PipelineCache.GetStats();
+
+		// Created without a usable blob, compiled by the driver.
+
+		const Uint64 NumMisses = Stats.NumCreated - Stats.NumBlobHits;
+
+		CErrorLog::Log<LogInfo>()
+			<< "Pipeline cache: " << Stats.NumCreated << " pipelines, "
+			<< Stats.NumBlobHits << " hits, "
+			<< NumMisses << " misses, "
+			<< Stats.NumBlobRejected << " rejected blobs, "
+			<< Stats.TotalMicroseconds / std::max<Uint64>(Stats.NumCreated, 1) << " us average, "
+			<< Stats.MaxMicroseconds << " us max"
+			<< CErrorLog::EndLine;
+	}
+
+	PipelineCache::PipelineCacheStats RPipelineState::GetCacheStats()
+	{
+		return g_PipelineCache.GetStats();
+	}
+
+	ErrorCode RPipelineState::CreateCached
 	(
 		InitializeOptionsGraphics * Options
 	)
 	{
 		Options->pRootSignature = RootSignature.GetRef();
 		{
-			return DEVICE->CreateGraphicsPipelineState(Options, IID_PPV_ARGS(&PipelineState));
+			return CreatePipelineStateCached<D3D12_GRAPHICS_PIPELINE_STATE_DESC>(Options, RootSignature->GetHash(), CacheKey, PipelineState);
 		}
 	}
 
-	ErrorCode RPipelineState::Create
+	ErrorCode RPipelineState::CreateCached
 	(
 		InitializeOptionsCompute * Options
 	)
 	{
 		Options->pRootSignature = RootSignature.GetRef();
 		{
-			return DEVICE->CreateComputePipelineState(Options, IID_PPV_ARGS(&PipelineState));
+			return CreatePipelineStateCached<D3D12_COMPUTE_PIPELINE_STATE_DESC>(Options, RootSignature->GetHash(), CacheKey, PipelineState);
 		}
 	}
 
+	ErrorCode RPipelineState::Create
+	(
+		InitializeOptionsGraphics * Options
+	)
+	{
+		return CreateCached(Options);
+	}
+
+	ErrorCode RPipelineState::Create
+	(
+		InitializeOptionsCompute * Options
+	)
+	{
+		return CreateCached(Options);
+	}
+
 	ErrorCode RPipelineState::Create(InitializeOptions * Options)
 	{
 		InitOptions = Options; Ensure(InitOptions);
@@ -535,7 +959,7 @@ namespace D3D
 				Options->SetShader(Shaders);
 			}
 
-			return DEVICE->CreateComputePipelineState(Options, IID_PPV_ARGS(&PipelineState));
+			return CreateCached(Options);
 		}
 		else
 		{
@@ -544,7 +968,7 @@ namespace D3D
 				Options->SetShader(Shaders);
 			}
 
-			return DEVICE->CreateGraphicsPipelineState(Options, IID_PPV_ARGS(&PipelineState));
+			return CreateCached(Options);
 		}
 	}
 }
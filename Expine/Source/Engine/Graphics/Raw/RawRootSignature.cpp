@@ -3,6 +3,8 @@
 #include "Raw/RawRootSignature.h"
 #include "Raw/RawDevice.h"
 
+#include <Utils/Shader/ShaderCache.h>
+
 namespace D3D
 {
 	ErrorCode RRootSignature::Create(const RRootSignature::InitializeOptions & Options)
@@ -25,6 +27,8 @@ namespace D3D
 
 		Ensure(pSignature != NULL);
 
+		Hash = ShaderCache::HashBytes(pSignature->GetBufferPointer(), pSignature->GetBufferSize());
+
 		Error = DEVICE->CreateRootSignature
 		(
 			0,
@@ -22,12 +22,27 @@
 
 namespace D3D
 {
+	static WString WidenPath(const LPCSTR pFileName)
+	{
+		const std::wstring Wide = std::wstring_convert<std::codecvt_utf8<wchar_t> >().from_bytes(pFileName);
+
+		WString Result;
+		{
+			Result.assign(Wide.begin(), Wide.end());
+		}
+
+		return Result;
+	}
+
+	// Each open include keeps its own file, nested and concurrent compiles may share the handler.
+
 	class CDefaultIncludeHandler : public ID3DInclude
 	{
 	private:
 
-		UniquePointer<File::CFile> File;
-		WString Directory;
+		TMutex											Mutex;
+		THashMap<LPCVOID, TUniquePtr<File::CFile> >		Files;
+		WString											Directory;
 
 	public:
 
@@ -41,70 +56,300 @@ namespace D3D
 
 		virtual HRESULT WINAPI Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID *ppData, UINT *pBytes) override
 		{
-			const Uint Length = std::strlen(pFileName);
-			
-			WString FileName;
+			WString FullPath = Directory;
 			{
-				FileName.reserve(Length * 2);
+				FullPath.append(L"\\").append(WidenPath(pFileName));
 			}
 
-			MultiByteToWideChar(CP_UTF8, 0, pFileName, std::strlen(pFileName), FileName.data(), FileName.length());
+			TUniquePtr<File::CFile> Include(new File::CFile(FullPath));
 
-			WString FullPath = Directory;
+			if (Include->ReadFileContent() != File::ErrorNone)
 			{
-				FullPath.append(L"\\").append(FileName);
+				return ERROR_FILE_INVALID;
 			}
 
-			File = new File::CFile(FullPath);
+			*ppData = Include->GetContentRef().data();
+			*pBytes = Include->GetContentRef().size();
 
-			if (File->ReadFileContent() != File::ErrorNone)
+			std::scoped_lock<TMutex> Lock(Mutex);
 			{
-				return ERROR_FILE_INVALID;
+				Files[*ppData] = std::move(Include);
 			}
 
-			*ppData = File->GetContentRef().data();
-			*pBytes = File->GetContentRef().size();
-
 			return S_OK;
 		}
 
 		virtual HRESULT WINAPI Close(LPCVOID pData) override
 		{
-			if (File)
+			std::scoped_lock<TMutex> Lock(Mutex);
 			{
-				File.SafeRelease();
+				Files.erase(pData);
 			}
 
 			return S_OK;
 		}
 	};
 
-	ErrorCode RShader::ReCompileShader()
-	{
-		ErrorCode EC = D3DCompileFromFile
-		(
-			PathFull.c_str(),
-			Macros.empty() ? NULL : Macros.data(),
-			IncludeHandler.Get(),
-			EntryPoint.c_str(),
-			Target.c_str(),
-			SHADER_COMPILE_FLAGS,
-			0,
-			&Code,
-			&Error
-		);
+	// Forwards to the shader's include handler and records every file it was asked for.
+
+	class CIncludeRecorder : public ID3DInclude
+	{
+	private:
+
+		ID3DInclude			* Includes;
+		const WString		& Directory;
+		TVector<WString>	& Opened;
+
+	public:
+
+		CIncludeRecorder(ID3DInclude * Includes, const WString & Directory, TVector<WString> & Opened) :
+			Includes(Includes),
+			Directory(Directory),
+			Opened(Opened)
+		{}
+
+		virtual HRESULT WINAPI Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID *ppData, UINT *pBytes) override
+		{
+			WString Include = Directory;
+			{
+				Include.append(WidenPath(pFileName));
+			}
+
+			Opened.push_back(std::move(Include));
+
+			if (Includes == NULL)
+			{
+				return E_FAIL;
+			}
+
+			return Includes->Open(IncludeType, pFileName, pParentData, ppData, pBytes);
+		}
+
+		virtual HRESULT WINAPI Close(LPCVOID pData) override
+		{
+			if (Includes == NULL)
+			{
+				return S_OK;
+			}
+
+			return Includes->Close(pData);
+		}
+	};
+
+	// Stateless between calls, the compile scheduler runs it on several workers.
+
+	class CD3DShaderCompiler : public ShaderCache::IShaderCompiler
+	{
+	private:
+
+		TUniquePtr<CDefaultIncludeHandler>	DefaultIncludes;
+
+		ID3DInclude						*	Includes;
+		WString								Directory;
+
+	public:
+
+		CD3DShaderCompiler(ID3DInclude * Includes, const WString & PathFull) :
+			Includes(Includes)
+		{
+			if (Includes == NULL)
+			{
+				DefaultIncludes.reset(new CDefaultIncludeHandler(PathFull));
+				this->Includes = DefaultIncludes.get();
+			}
+
+			const size_t Separator = PathFull.find_last_of(L"\\/");
+
+			if (Separator != WString::npos)
+			{
+				Directory.assign(PathFull.begin(), PathFull.begin() + Separator + 1);
+			}
+		}
+
+		virtual bool Compile(const ShaderCache::ShaderKey & Key, ShaderCache::ShaderCompileOutput & Output) override
+		{
+			File::CFile Source(Key.Path);
+
+			if (Source.ReadFileContent() != File::ErrorNone)
+			{
+				Output.Messages = String("Unable to read shader source.");
+				return false;
+			}
+
+			TVector<ShaderMacro> Macros;
+			{
+				for (const ShaderCache::ShaderDefine & Define : Key.Defines)
+				{
+					Macros.push_back({ Define.Name.c_str(), Define.Value.c_str() });
+				}
+
+				Macros.push_back({ NULL, NULL });
+			}
+
+			const std::string SourceName = std::wstring_convert<std::codecvt_utf8<wchar_t> >().to_bytes(Key.Path);
+
+			CIncludeRecorder Recorder(Includes, Directory, Output.Includes);
+
+			ComPointer<IBlob> Code;
+			ComPointer<IBlob> Error;
+
+			const HRESULT Result = D3DCompile
+			(
+				Source.GetContentRef().data(),
+				Source.GetContentRef().size(),
+				SourceName.c_str(),
+				Macros.data(),
+				&Recorder,
+				Key.EntryPoint.c_str(),
+				Key.Profile.c_str(),
+				SHADER_COMPILE_FLAGS,
+				0,
+				&Code,
+				&Error
+			);
+
+			if (Error)
+			{
+				const char * Messages = static_cast<const char*>(Error->GetBufferPointer());
+				{
+					Output.Messages.assign(Messages, Messages + Error->GetBufferSize());
+				}
+			}
+
+			if (FAILED(Result) || !Code)
+			{
+				return false;
+			}
+
+			const Byte * Bytecode = static_cast<const Byte*>(Code->GetBufferPointer());
+			{
+				Output.Bytecode.assign(Bytecode, Bytecode + Code->GetBufferSize());
+			}
+
+			return true;
+		}
+
+		virtual Uint64 GetCompilerHash() const override
+		{
+			return ShaderCache::CHasher()
+				.Append(static_cast<Uint64>(SHADER_COMPILE_FLAGS))
+				.Append(static_cast<Uint64>(D3D_COMPILER_VERSION))
+				.Finish();
+		}
+	};
+
+	static ErrorCode CreateBlob(const void * Data, const size_t Size, ComPointer<IBlob> & Blob)
+	{
+		ErrorCode Error;
+
+		if ((Error = D3DCreateBlob(Size, &Blob)))
+		{
+			return Error;
+		}
+
+		std::memcpy(Blob->GetBufferPointer(), Data, Size);
+
+		return S_OK;
+	}
+
+	ShaderCache::ShaderKey RShader::GetShaderKey
+	(
+		const	WString					& PathFull,
+		const	String					& EntryPoint,
+		const	String					& Target,
+		const	TVector<ShaderMacro>	& Macros
+	)
+	{
+		ShaderCache::ShaderKey Key;
+		{
+			Key.Path		= PathFull;
+			Key.EntryPoint	= EntryPoint;
+			Key.Profile		= Target;
+
+			// The list ends with an empty macro.
+
+			for (const ShaderMacro & Macro : Macros)
+			{
+				if (Macro.Name)
+				{
+					Key.Defines.push_back({ String(Macro.Name), String(Macro.Definition ? Macro.Definition : "") });
+				}
+			}
+		}
+
+		return Key;
+	}
+
+	ShaderCache::ShaderKey RShader::GetShaderKey() const
+	{
+		return GetShaderKey(PathFull, EntryPoint, Target, Macros);
+	}
+
+	std::shared_ptr<ShaderCache::IShaderCompiler> RShader::CreateCompiler(const WString & PathFull, ID3DInclude * Includes)
+	{
+		return std::make_shared<CD3DShaderCompiler>(Includes, PathFull);
+	}
+
+	ErrorCode RShader::ApplyCompileOutput(const ShaderCache::ShaderCompileOutput & Output, const bool Compiled)
+	{
+		Error.SafeRelease();
+
+		if (!Output.Messages.empty())
+		{
+			CreateBlob(Output.Messages.data(), Output.Messages.size(), Error);
+		}
+
+		// A failed compile keeps the previous bytecode.
+
+		if (!Compiled)
+		{
+			return E_FAIL;
+		}
+
+		ComPointer<IBlob> Bytecode;
+
+		ErrorCode EC;
+
+		if ((EC = CreateBlob(Output.Bytecode.data(), Output.Bytecode.size(), Bytecode)))
+		{
+			return EC;
+		}
+
+		Code = Bytecode;
+
+		return S_OK;
+	}
+
+	ErrorCode RShader::CompileCached(ShaderCache::CShaderCache & Cache)
+	{
+		const ShaderCache::ShaderKey Key = GetShaderKey();
+
+		CD3DShaderCompiler Compiler(IncludeHandler.Get(), PathFull);
+
+		ShaderCache::ShaderCompileOutput Output;
+
+		const bool Compiled = Cache.Compile(Key, Compiler, Output);
+
+		KeyHash = ShaderCache::HashShaderKey(Key);
+
+		return ApplyCompileOutput(Output, Compiled);
+	}
+
+	ErrorCode RShader::ReloadShader(const ShaderCache::ShaderCompileOutput & Output, const bool Compiled)
+	{
+		ErrorCode EC = ApplyCompileOutput(Output, Compiled);
 
 		if (EC)
 		{
-			CErrorLog::Log<LogError>() << "Unable to compile shader: " << PathFull << CErrorLog::EndLine;
-			
+			StringView Message;
+
 			if (Error)
 			{
-				CErrorLog::Log<LogError>() << String(
-					static_cast<char*>(Error->GetBufferPointer()),
-					static_cast<char*>(Error->GetBufferPointer()) + Error->GetBufferSize()) << CErrorLog::EndLine;
+				Message = StringView(static_cast<const char*>(Error->GetBufferPointer()), Error->GetBufferSize());
 			}
 
+			LOG_ERROR("Shader", "Unable to reload shader {}: {}", PathFull, Message);
+
 			return EC;
 		}
 
@@ -121,14 +366,25 @@ namespace D3D
 		return S_OK;
 	}
 
-	ErrorCode RShader::CompileShader
+	ErrorCode RShader::ReCompileShader(ShaderCache::CShaderCache & Cache)
+	{
+		CD3DShaderCompiler Compiler(IncludeHandler.Get(), PathFull);
+
+		ShaderCache::ShaderCompileOutput Output;
+
+		const bool Compiled = Cache.Compile(GetShaderKey(), Compiler, Output);
+
+		return ReloadShader(Output, Compiled);
+	}
+
+	void RShader::SetSource
 	(
-		const	WString					& ShaderDirectory,
-		const	WString					& ShaderFilename,
-		const	String					& ShaderEntryPoint,
-		const	String					& ShaderTarget,
-		const	TVector<ShaderMacro>	& ShaderMacros,
-				ID3DInclude				* ShaderIncludeHandler
+		const	WString						& ShaderDirectory,
+		const	WString						& ShaderFilename,
+		const	String						& ShaderEntryPoint,
+		const	String						& ShaderTarget,
+		const	TVector<ShaderMacro>		& ShaderMacros,
+				ID3DInclude					* ShaderIncludeHandler
 	)
 	{
 		Path		= ShaderFilename;
@@ -146,18 +402,24 @@ namespace D3D
 			IncludeHandler = ShaderIncludeHandler;
 		}
 
-		return D3DCompileFromFile
-		(
-			PathFull.c_str(),
-			Macros.empty() ? NULL : Macros.data(),
-			IncludeHandler.Get(),
-			EntryPoint.c_str(),
-			Target.c_str(),
-			SHADER_COMPILE_FLAGS,
-			0,
-			&Code,
-			&Error
-		);
+		KeyHash = ShaderCache::HashShaderKey(GetShaderKey());
+	}
+
+	ErrorCode RShader::CompileShader
+	(
+				ShaderCache::CShaderCache	& Cache,
+		const	WString						& ShaderDirectory,
+		const	WString						& ShaderFilename,
+		const	String						& ShaderEntryPoint,
+		const	String						& ShaderTarget,
+		const	TVector<ShaderMacro>		& ShaderMacros,
+				ID3DInclude					* ShaderIncludeHandler
+	)
+	{
+		SetSource(ShaderDirectory, ShaderFilename, ShaderEntryPoint, ShaderTarget, ShaderMacros, ShaderIncludeHandler);
+		{
+			return CompileCached(Cache);
+		}
 	}
 
 	ErrorCode RShader::LoadShader(const WString & Path)
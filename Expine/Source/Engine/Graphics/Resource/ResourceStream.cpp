@@ -0,0 +1,395 @@
+#include "Precompiled.h"
+
+#include "Resource/ResourceStream.h"
+
+#include <experimental/filesystem>
+#include <fstream>
+
+namespace D3D
+{
+	ErrorCode CResourceStreamSinkNull::Stage(const ResourceStreamRequest & Request, const ResourceStreamData & Data, ResourceStreamResult & Result)
+	{
+		BytesStaged += Data.GetSize();
+
+		Result.SizeStaged = Data.GetSize();
+
+		return S_OK;
+	}
+
+	void CResourceStreamBufferPool::Initialize(const size_t BlockSize, const size_t NumBlocks)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		this->BlockSize = BlockSize;
+
+		Blocks.clear();
+		FreeBlocks.clear();
+
+		for (size_t N = 0; N < NumBlocks; ++N)
+		{
+			Blocks.emplace_back(new Byte[BlockSize]);
+			FreeBlocks.push_back(Blocks.back().get());
+		}
+	}
+
+	Byte * CResourceStreamBufferPool::Acquire()
+	{
+		std::unique_lock<TMutex> Lock(Mutex);
+
+		Available.wait(Lock, [this]()
+		{
+			return !FreeBlocks.empty();
+		});
+
+		Byte * Block = FreeBlocks.back();
+		{
+			FreeBlocks.pop_back();
+		}
+
+		return Block;
+	}
+
+	void CResourceStreamBufferPool::Release(Byte * Block)
+	{
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				FreeBlocks.push_back(Block);
+			}
+		}
+
+		Available.notify_one();
+	}
+
+	size_t CResourceStreamBufferPool::GetNumFreeBlocks()
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return FreeBlocks.size();
+		}
+	}
+
+	CResourceStream::CResourceStream() :
+		BytesInFlight(0),
+		BytesInFlightPeak(0)
+	{}
+
+	CResourceStream::~CResourceStream()
+	{
+		Shutdown();
+	}
+
+	ErrorCode CResourceStream::Initialize(const InitializeOptions & Options)
+	{
+		if (!Options.Sink || Options.BlockSize == 0 || Options.BudgetBytes < Options.BlockSize)
+		{
+			return E_INVALIDARG;
+		}
+
+		Shutdown();
+
+		Sink = Options.Sink;
+		Stopping = false;
+
+		BufferPool.Initialize(
+			static_cast<size_t>(Options.BlockSize),
+			static_cast<size_t>(Options.BudgetBytes / Options.BlockSize));
+
+		ReadThread = std::thread(&CResourceStream::ReadLoop, this);
+
+		return S_OK;
+	}
+
+	void CResourceStream::Shutdown()
+	{
+		if (!ReadThread.joinable())
+		{
+			return;
+		}
+
+		Flush();
+
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+			{
+				Stopping = true;
+			}
+		}
+
+		QueueSignal.notify_all();
+		ReadThread.join();
+	}
+
+	void CResourceStream::Enqueue(ResourceStreamRequest && Request)
+	{
+		TUniquePtr<Job> Target(new Job());
+		{
+			Target->Request = std::move(Request);
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+			{
+				Target->Sequence = NumEnqueued++;
+
+				Queue.push(std::move(Target));
+				NumPending++;
+			}
+		}
+
+		QueueSignal.notify_one();
+	}
+
+	void CResourceStream::Flush()
+	{
+		{
+			std::unique_lock<TMutex> Lock(QueueMutex);
+
+			IdleSignal.wait(Lock, [this]()
+			{
+				return NumPending == 0 && NumProcessing == 0;
+			});
+		}
+	}
+
+	void CResourceStream::ReadLoop()
+	{
+		while (true)
+		{
+			TUniquePtr<Job> Target;
+
+			{
+				std::unique_lock<TMutex> Lock(QueueMutex);
+
+				QueueSignal.wait(Lock, [this]()
+				{
+					return Stopping || !Queue.empty();
+				});
+
+				if (Queue.empty())
+				{
+					return;
+				}
+
+				Target = std::move(Queue.front());
+				Queue.pop();
+			}
+
+			if (!Read(*Target))
+			{
+				Finish(Target.release());
+				continue;
+			}
+
+			Job * Pending = Target.release();
+
+			{
+				std::lock_guard<TMutex> Lock(QueueMutex);
+				{
+					NumProcessing++;
+				}
+			}
+
+			Workers.enqueue([this, Pending]()
+			{
+				Process(Pending);
+
+				// Signalled under the lock, Flush may return and destroy the stream right after.
+
+				std::lock_guard<TMutex> Lock(QueueMutex);
+				{
+					NumProcessing--;
+					IdleSignal.notify_all();
+				}
+			});
+		}
+	}
+
+	bool CResourceStream::Read(Job & Target)
+	{
+		const ResourceStreamRequest & Request = Target.Request;
+
+		std::ifstream Stream(std::experimental::filesystem::path(Request.Path.c_str()), std::ios::in | std::ios::binary | std::ios::ate);
+
+		if (!Stream.is_open())
+		{
+			LOG_ERROR("Stream", "Failed to open streamed resource: {}", Request.Path);
+			return false;
+		}
+
+		const Uint64 FileSize = static_cast<Uint64>(Stream.tellg());
+
+		if (Request.Offset > FileSize)
+		{
+			LOG_ERROR("Stream", "Stream offset outside of file: {}", Request.Path);
+			return false;
+		}
+
+		const Uint64 Size = Request.Size ? Math::Min(Request.Size, FileSize - Request.Offset) : FileSize - Request.Offset;
+
+		const size_t BlockSize	= BufferPool.GetBlockSize();
+		const size_t NumBlocks	= static_cast<size_t>((Size + BlockSize - 1) / BlockSize);
+
+		// A request has to fit into the budget as a whole, otherwise it could never complete.
+
+		if (NumBlocks > BufferPool.GetNumBlocks())
+		{
+			LOG_ERROR("Stream", "Streamed resource exceeds the stream budget: {}", Request.Path);
+			return false;
+		}
+
+		Stream.seekg(static_cast<std::streamoff>(Request.Offset));
+
+		Uint64 Remaining = Size;
+
+		for (size_t N = 0; N < NumBlocks; ++N)
+		{
+			Byte * Block = BufferPool.Acquire();
+			{
+				Target.Blocks.push_back(Block);
+			}
+
+			const size_t BlockBytes = static_cast<size_t>(Math::Min<Uint64>(Remaining, BlockSize));
+
+			const Uint64 InFlight = BytesInFlight += BlockSize;
+
+			Uint64 Peak = BytesInFlightPeak.load();
+
+			while (InFlight > Peak && !BytesInFlightPeak.compare_exchange_weak(Peak, InFlight))
+			{
+			}
+
+			if (!Stream.read(reinterpret_cast<char*>(Block), BlockBytes))
+			{
+				LOG_ERROR("Stream", "Failed to read streamed resource: {}", Request.Path);
+				return false;
+			}
+
+			Remaining -= BlockBytes;
+		}
+
+		Target.Result.SizeRead = Size;
+
+		return true;
+	}
+
+	void CResourceStream::Process(Job * Target)
+	{
+		const size_t BlockSize = BufferPool.GetBlockSize();
+
+		ResourceStreamData Input;
+		{
+			Uint64 Remaining = Target->Result.SizeRead;
+
+			for (Byte * Block : Target->Blocks)
+			{
+				const size_t BlockBytes = static_cast<size_t>(Math::Min<Uint64>(Remaining, BlockSize));
+				{
+					Input.Add(Block, BlockBytes);
+				}
+
+				Remaining -= BlockBytes;
+			}
+		}
+
+		if (Target->Request.Processor)
+		{
+			TVector<Byte> Output;
+
+			Target->Result.Status = Target->Request.Processor->Process(Target->Request, Input, Output);
+
+			// Read blocks are no longer needed once the processor is done.
+
+			ReleaseBlocks(*Target);
+
+			if (Target->Result.Status == S_OK)
+			{
+				ResourceStreamData Processed;
+				{
+					Processed.Add(Output.data(), Output.size());
+				}
+
+				Target->Result.Status = Sink->Stage(Target->Request, Processed, Target->Result);
+			}
+		}
+		else
+		{
+			Target->Result.Status = Sink->Stage(Target->Request, Input, Target->Result);
+		}
+
+		Finish(Target);
+	}
+
+	void CResourceStream::ReleaseBlocks(Job & Target)
+	{
+		// Accounted before the blocks are handed out again, the peak never exceeds the budget.
+
+		BytesInFlight -= Target.Blocks.size() * BufferPool.GetBlockSize();
+
+		for (Byte * Block : Target.Blocks)
+		{
+			BufferPool.Release(Block);
+		}
+
+		Target.Blocks.clear();
+	}
+
+	void CResourceStream::Finish(Job * Target)
+	{
+		// Blocks go back right away, only the report waits for earlier jobs.
+
+		ReleaseBlocks(*Target);
+
+		std::unique_lock<TMutex> Lock(CompletionMutex);
+
+		Completed.emplace(Target->Sequence, Target);
+
+		if (Completing)
+		{
+			return;
+		}
+
+		Completing = true;
+
+		while (!Completed.empty() && Completed.begin()->first == NumCompleted)
+		{
+			Job * Next = Completed.begin()->second;
+			{
+				Completed.erase(Completed.begin());
+				NumCompleted++;
+			}
+
+			Lock.unlock();
+			{
+				Complete(Next);
+			}
+			Lock.lock();
+		}
+
+		Completing = false;
+	}
+
+	void CResourceStream::Complete(Job * Target)
+	{
+		if (Target->Request.OnComplete)
+		{
+			Target->Request.OnComplete(Target->Result);
+		}
+
+		delete Target;
+
+		bool Idle;
+
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+			{
+				Idle = --NumPending == 0;
+			}
+		}
+
+		if (Idle)
+		{
+			IdleSignal.notify_all();
+		}
+	}
+}
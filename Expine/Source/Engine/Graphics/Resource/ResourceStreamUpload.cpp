@@ -0,0 +1,36 @@
+#include "Precompiled.h"
+
+#include "Resource/ResourceStream.h"
+
+// The upload sink is kept apart, the stream itself links without the allocator.
+
+namespace D3D
+{
+	void CResourceStreamSinkUpload::DiscardPages(const UINT64 FenceValue)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Allocator.DiscardPages(FenceValue);
+		}
+	}
+
+	ErrorCode CResourceStreamSinkUpload::Stage(const ResourceStreamRequest & Request, const ResourceStreamData & Data, ResourceStreamResult & Result)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		ResourceEntry Entry = Allocator.Allocate(Data.GetSize(), Request.Alignment);
+
+		if (!Entry.Resource)
+		{
+			return E_FAIL;
+		}
+
+		Data.CopyTo(static_cast<Byte*>(Entry.ResourceVA.CPUAddress.Pointer) + Entry.ResourceOffset);
+
+		Result.Resource			= Entry.Resource;
+		Result.ResourceOffset	= Entry.ResourceOffset;
+		Result.SizeStaged		= Data.GetSize();
+
+		return S_OK;
+	}
+}
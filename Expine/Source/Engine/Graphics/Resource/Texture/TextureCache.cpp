@@ -0,0 +1,298 @@
+#include "Precompiled.h"
+
+#include "Resource/Texture/TextureCache.h"
+
+#include <tbb/parallel_for.h>
+
+#include <chrono>
+
+namespace D3D
+{
+	ShaderTextureInfo::ShaderTextureInfo
+	(
+		const WString				& Name,
+		const WString				& Path,
+		const DescriptorHeapEntry	& Entry,
+		CTextureResource			* pResource
+	)
+	{
+		TextureName = Name;
+		TexturePath = Path;
+		HeapEntry = Entry;
+		Resource = pResource;
+	}
+
+	CTextureCache::CTextureCache() :
+		Hits(0),
+		Misses(0),
+		InFlightHits(0),
+		Failures(0),
+		LoadMicroseconds(0),
+		MaxLoadMicroseconds(0)
+	{
+	}
+
+	CTextureCache::Shard & CTextureCache::GetShard(const InternedWString & Key) const
+	{
+		return const_cast<Shard&>(Shards[Key.GetHash() % NumShards]);
+	}
+
+	SharedPointer<CTextureCache::Entry> CTextureCache::FindEntry(const InternedWString & Key) const
+	{
+		const Shard & Target = GetShard(Key);
+
+		std::lock_guard<TMutex> Lock(Target.Mutex);
+
+		const auto Iter = Target.Entries.find(Key);
+
+		if (Iter == Target.Entries.end())
+		{
+			return nullptr;
+		}
+
+		return Iter->second;
+	}
+
+	bool CTextureCache::IsReady(const Entry & Item)
+	{
+		return Item.Ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	bool CTextureCache::IsLoaded(const Entry & Item)
+	{
+		if (!IsReady(Item))
+		{
+			return false;
+		}
+
+		try
+		{
+			return Item.Ready.get() == S_OK;
+		}
+		catch (...)
+		{
+			return false;
+		}
+	}
+
+	SharedPointer<CTextureCache::Entry> CTextureCache::Acquire(const WStringView & Path, const WStringView & Name, const TLoader & Loader)
+	{
+		const InternedWString Key = InternedWString::FromPath(Path);
+
+		Shard & Target = GetShard(Key);
+
+		std::promise<ErrorCode>	Done;
+		SharedPointer<Entry>	Item;
+
+		{
+			std::lock_guard<TMutex> Lock(Target.Mutex);
+
+			const auto Iter = Target.Entries.find(Key);
+
+			if (Iter != Target.Entries.end())
+			{
+				if (IsReady(*Iter->second))
+				{
+					Hits++;
+				}
+				else
+				{
+					InFlightHits++;
+				}
+
+				return Iter->second;
+			}
+
+			Item.Construct();
+
+			Item->Path			= WString(Path.begin(), Path.end());
+			Item->Key			= Key;
+			Item->Ready			= Done.get_future().share();
+			Item->LoadingThread	= std::this_thread::get_id();
+
+			Target.Entries.emplace(Key, Item);
+		}
+
+		Misses++;
+
+		// Loaded outside of the shard lock, requests for other paths in
+		// the same shard go on while this one is in flight.
+
+		const auto Start = std::chrono::steady_clock::now();
+
+		ErrorCode			Error = S_OK;
+		std::exception_ptr	Exception;
+
+		try
+		{
+			Error = Loader(Item->Path, WString(Name.begin(), Name.end()), Item->Info);
+		}
+		catch (...)
+		{
+			Error		= E_FAIL;
+			Exception	= std::current_exception();
+		}
+
+		const Uint64 Elapsed = static_cast<Uint64>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count());
+
+		LoadMicroseconds += Elapsed;
+
+		Uint64 Peak = MaxLoadMicroseconds.load();
+
+		while (Elapsed > Peak && !MaxLoadMicroseconds.compare_exchange_weak(Peak, Elapsed));
+
+		{
+			std::lock_guard<TMutex> Lock(Target.Mutex);
+
+			if (Error)
+			{
+				const auto Iter = Target.Entries.find(Key);
+
+				if (Iter != Target.Entries.end() && Iter->second.Get() == Item.Get())
+				{
+					Target.Entries.erase(Iter);
+				}
+			}
+
+			Item->LoadingThread = std::thread::id();
+		}
+
+		if (Error)
+		{
+			Failures++;
+		}
+
+		// Waiting threads and the caller see the exception on Ready.get.
+
+		if (Exception)
+		{
+			Done.set_exception(Exception);
+		}
+		else
+		{
+			Done.set_value(Error);
+		}
+
+		return Item;
+	}
+
+	ErrorCode CTextureCache::GetOrLoad(const WStringView & Path, const WStringView & Name, ShaderTextureInfo & Info, const TLoader & Loader)
+	{
+		ErrorCode Error;
+
+		SharedPointer<Entry> Item = Acquire(Path, Name, Loader);
+
+		if ((Error = Item->Ready.get()))
+		{
+			return Error;
+		}
+
+		Shard & Target = GetShard(Item->Key);
+
+		std::lock_guard<TMutex> Lock(Target.Mutex);
+		{
+			Info = Item->Info;
+		}
+
+		return S_OK;
+	}
+
+	ErrorCode CTextureCache::Prefetch(const TVector<WString> & Paths, const TVector<WString> & Names, const TLoader & Loader)
+	{
+		TVector<SharedPointer<Entry> > Items(Paths.size());
+
+		tbb::parallel_for(size_t(0), Paths.size(), [&](const size_t Index)
+		{
+			Items[Index] = Acquire(Paths[Index], Index < Names.size() ? Names[Index] : Paths[Index], Loader);
+		});
+
+		ErrorCode Result = S_OK;
+
+		for (const SharedPointer<Entry> & Item : Items)
+		{
+			const ErrorCode Error = Item->Ready.get();
+
+			if (Error && !Result)
+			{
+				Result = Error;
+			}
+		}
+
+		return Result;
+	}
+
+	bool CTextureCache::Find(const WStringView & Path, ShaderTextureInfo & Info) const
+	{
+		InternedWString Key;
+
+		// A path never interned was never requested.
+
+		if (!InternedWString::FindPath(Path, Key))
+		{
+			return false;
+		}
+
+		SharedPointer<Entry> Item = FindEntry(Key);
+
+		if (!Item || !IsLoaded(*Item))
+		{
+			return false;
+		}
+
+		// Copied under the shard lock, Modify may change the info at any time.
+
+		const Shard & Target = GetShard(Key);
+
+		std::lock_guard<TMutex> Lock(Target.Mutex);
+		{
+			Info = Item->Info;
+		}
+
+		return true;
+	}
+
+	bool CTextureCache::Contains(const WStringView & Path) const
+	{
+		InternedWString Key;
+
+		if (!InternedWString::FindPath(Path, Key))
+		{
+			return false;
+		}
+
+		SharedPointer<Entry> Item = FindEntry(Key);
+		{
+			return Item && IsLoaded(*Item);
+		}
+	}
+
+	TextureCacheStats CTextureCache::GetStats() const
+	{
+		TextureCacheStats Stats;
+		{
+			Stats.Hits					= Hits.load();
+			Stats.Misses				= Misses.load();
+			Stats.InFlightHits			= InFlightHits.load();
+			Stats.Failures				= Failures.load();
+			Stats.LoadMicroseconds		= LoadMicroseconds.load();
+			Stats.MaxLoadMicroseconds	= MaxLoadMicroseconds.load();
+		}
+
+		return Stats;
+	}
+
+	size_t CTextureCache::GetSize() const
+	{
+		size_t Size = 0;
+
+		for (const Shard & Target : Shards)
+		{
+			std::lock_guard<TMutex> Lock(Target.Mutex);
+			{
+				Size += Target.Entries.size();
+			}
+		}
+
+		return Size;
+	}
+}
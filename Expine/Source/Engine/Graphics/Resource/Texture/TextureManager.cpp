@@ -6,32 +6,13 @@
 #include <locale.h>
 #include <Utils/XML.h>
 
+#include "Utils/Texture/DDSContainer.h"
+
 namespace D3D
 {
-	ShaderTextureInfo::ShaderTextureInfo
-	(
-		const WString				& Name,
-		const WString				& Path,
-		const DescriptorHeapEntry	& Entry,
-		CTextureResource			* pResource
-	)
-	{
-		TextureName = Name;
-		TexturePath = Path;
-		HeapEntry = Entry;
-		Resource = pResource;
-	}
-
-	const ShaderTextureInfo * CTextureManager::GetShaderTextureInfo(const WStringView & Name) const
+	bool CTextureManager::GetShaderTextureInfo(const WStringView & Name, ShaderTextureInfo & Info) const
 	{
-		const auto Iter = Textures.find(Name);
-
-		if (Iter == Textures.end())
-		{
-			return NULL;
-		}
-
-		return &Iter->second;
+		return Textures.Find(Name, Info);
 	}
 
 	CTextureManager::CTextureManager()
@@ -42,55 +23,35 @@ namespace D3D
 		ThrowOnError(CommandContext->Create(true, D3D12_COMMAND_LIST_TYPE_COPY));
 
 		CommandContext->Get()->SetName(L"CMDList Texture Manager");
-	}
-
-	CTextureManager::~CTextureManager()
-	{
-	}
-
-	ErrorCode CTextureManager::AddTexture(const WStringView & TexturePath, const WStringView & TextureName)
-	{
-		ErrorCode Error;
-
-		if (Textures.find(TexturePath) != Textures.end())
-		{
-			return ERROR_ALREADY_EXISTS;
-		}
-
-		UniquePointer<CTextureResource> Texture = new CTextureResource();
 
-		if ((Error = Texture->LoadTextureType(CommandContext.GetRef(), TexturePath)))
+		CTextureStreamer::InitializeOptions StreamingOptions;
 		{
-			return Error;
+			StreamingOptions.Backend = this;
 		}
 
-		Textures.emplace(std::piecewise_construct, std::forward_as_tuple<>(TexturePath), std::forward_as_tuple<>(
-			TextureName, 
-			TexturePath,
-			SRVDescriptorHeaps->RequestDescriptorHeapRange(),
-			Texture.Detach()
-		));
-
-		return S_OK;
+		ThrowOnError(Streamer.Initialize(StreamingOptions));
 	}
 
-	ErrorCode CTextureManager::AddLookupPath(const WStringView & Path)
+	CTextureManager::~CTextureManager()
 	{
-		return ErrorCode();
 	}
 
-	ErrorCode CTextureManager::GetOrAddTexture(const WStringView & TexturePath, const WStringView & TextureName, ShaderTextureInfo & Info, CTextureInitializationStream * Stream)
+	ErrorCode CTextureManager::LoadTexture(const WString & TexturePath, const WString & TextureName, ShaderTextureInfo & Info, CTextureInitializationStream * Stream)
 	{
 		ErrorCode Error;
 
-		TTextures::iterator Item = Textures.find(TexturePath);
+		// Start reading the file before waiting for the command list, so
+		// parallel loads overlap their I/O.
 
-		if (Item != Textures.end())
+		Texture::DDS::CDDSContainer Container;
+
+		if (Container.Open(TexturePath) == Texture::DDS::DDSResultOk)
 		{
-			Info = Item->second;
-			return S_OK;
+			Container.PrefetchMips(0, Container.GetMipLevels());
 		}
 
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
 		UniquePointer<CTextureResource> Texture = new CTextureResource();
 
 		if (Stream)
@@ -99,6 +60,8 @@ namespace D3D
 			{
 				return Error;
 			}
+
+			Stream->NeedsDispatch = true;
 		}
 		else
 		{
@@ -108,14 +71,11 @@ namespace D3D
 			}
 		}
 
-		DescriptorHeapRange DHRange = SRVDescriptorHeaps->RequestDescriptorHeapRange();
-
-		Info = Textures.emplace(std::piecewise_construct, std::forward_as_tuple<>(TexturePath), std::forward_as_tuple<>(
+		Info = ShaderTextureInfo(
 			TextureName,
 			TexturePath,
-			DHRange,
-			Texture.Detach()
-			)).first.value();
+			SRVDescriptorHeaps->RequestDescriptorHeapRange(),
+			Texture.Detach());
 
 		Info.ShaderResource = new RShaderResourceView();
 
@@ -144,6 +104,42 @@ namespace D3D
 		return S_OK;
 	}
 
+	CTextureCache::TLoader CTextureManager::GetLoader(CTextureInitializationStream * Stream)
+	{
+		return [this, Stream](const WString & TexturePath, const WString & TextureName, ShaderTextureInfo & Info)
+		{
+			return LoadTexture(TexturePath, TextureName, Info, Stream);
+		};
+	}
+
+	ErrorCode CTextureManager::AddTexture(const WStringView & TexturePath, const WStringView & TextureName)
+	{
+		if (Textures.Contains(TexturePath))
+		{
+			return ERROR_ALREADY_EXISTS;
+		}
+
+		ShaderTextureInfo Info;
+		{
+			return Textures.GetOrLoad(TexturePath, TextureName, Info, GetLoader());
+		}
+	}
+
+	ErrorCode CTextureManager::AddLookupPath(const WStringView & Path)
+	{
+		return ErrorCode();
+	}
+
+	ErrorCode CTextureManager::GetOrAddTexture(const WStringView & TexturePath, const WStringView & TextureName, ShaderTextureInfo & Info, CTextureInitializationStream * Stream)
+	{
+		return Textures.GetOrLoad(TexturePath, TextureName, Info, GetLoader(Stream));
+	}
+
+	ErrorCode CTextureManager::PrefetchTextures(const TVector<WString> & TexturePaths, const TVector<WString> & TextureNames)
+	{
+		return Textures.Prefetch(TexturePaths, TextureNames, GetLoader());
+	}
+
 	void CTextureManager::LoadTexturesFromDirectory(const WString & DirectoryPath)
 	{
 
@@ -165,6 +161,9 @@ namespace D3D
 			return ERROR_FILE_INVALID;
 		}
 
+		TVector<WString> TexturePaths;
+		TVector<WString> TextureNames;
+
 		for (const auto & Iter : Document.GetRoot())
 		{
 			const auto NameChild = Iter.second.get_child_optional(L"Name").get_ptr();
@@ -199,11 +198,14 @@ namespace D3D
 				continue;
 			}
 
-			if ((Error = AddTexture(*PathValue, *NameValue)))
-			{
-				CErrorLog::Log<LogError>() << "Unable to add texture." << Error << CErrorLog::EndLine;
-				return Error;
-			}
+			TexturePaths.push_back(*PathValue);
+			TextureNames.push_back(*NameValue);
+		}
+
+		if ((Error = PrefetchTextures(TexturePaths, TextureNames)))
+		{
+			CErrorLog::Log<LogError>() << "Unable to add texture." << Error << CErrorLog::EndLine;
+			return Error;
 		}
 
 		return S_OK;
@@ -213,6 +215,8 @@ namespace D3D
 	{
 		ErrorCode Error;
 
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
 		UniquePointer<CTextureResource> Texture = new CTextureResource();
 
 		if ((Error = Texture->Create(Options)))
@@ -243,22 +247,24 @@ namespace D3D
 			Stream->NeedsDispatch = true;
 		}
 
-		auto Iter = Textures.find(TexturePath);
-
-		if (Iter != Textures.end())
+		Textures.Modify(TexturePath, [&](ShaderTextureInfo & Entry, const bool Inserted)
 		{
-			Info				= Iter.value();
-			Info.TextureName	= TextureName;
-			Info.Resource		= Texture.Detach();
-		}
-		else
-		{
-			Info = Textures.emplace(std::piecewise_construct, std::forward_as_tuple<>(TexturePath), std::forward_as_tuple<>(
-				TextureName,
-				TexturePath,
-				SRVDescriptorHeaps->RequestDescriptorHeapRange(),
-				Texture.Detach())).first->second;
-		}
+			if (Inserted)
+			{
+				Entry = ShaderTextureInfo(
+					WString(TextureName.begin(), TextureName.end()),
+					WString(TexturePath.begin(), TexturePath.end()),
+					SRVDescriptorHeaps->RequestDescriptorHeapRange(),
+					Texture.Detach());
+			}
+			else
+			{
+				Entry.TextureName	= WString(TextureName.begin(), TextureName.end());
+				Entry.Resource		= Texture.Detach();
+			}
+
+			Info = Entry;
+		});
 
 		Info.ShaderResource = new RShaderResourceView();
 
@@ -293,6 +299,8 @@ namespace D3D
 	{
 		ErrorCode Error;
 
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
 		UniquePointer<CTextureResource> Texture = new CTextureResource();
 
 		if ((Error = Texture->Create(Options)))
@@ -300,22 +308,24 @@ namespace D3D
 			return Error;
 		}
 
-		auto Iter = Textures.find(TexturePath);
-
-		if (Iter != Textures.end())
+		Textures.Modify(TexturePath, [&](ShaderTextureInfo & Entry, const bool Inserted)
 		{
-			Info				= Iter.value();
-			Info.TextureName	= TextureName;
-			Info.Resource		= Texture.Detach();
-		}
-		else
-		{
-			Info = Textures.emplace(std::piecewise_construct, std::forward_as_tuple<>(TexturePath), std::forward_as_tuple<>(
-				TextureName,
-				TexturePath,
-				SRVDescriptorHeaps->RequestDescriptorHeapRange(),
-				Texture.Detach())).first->second;
-		}
+			if (Inserted)
+			{
+				Entry = ShaderTextureInfo(
+					WString(TextureName.begin(), TextureName.end()),
+					WString(TexturePath.begin(), TexturePath.end()),
+					SRVDescriptorHeaps->RequestDescriptorHeapRange(),
+					Texture.Detach());
+			}
+			else
+			{
+				Entry.TextureName	= WString(TextureName.begin(), TextureName.end());
+				Entry.Resource		= Texture.Detach();
+			}
+
+			Info = Entry;
+		});
 
 		Info.ShaderResource = new RShaderResourceView();
 
@@ -331,6 +341,8 @@ namespace D3D
 
 	void CTextureManager::CopyDataToResource(ShaderTextureInfo & Info, const size_t StartSubResource, const size_t NumSubResources, D3D12_SUBRESOURCE_DATA * SubResourceData)
 	{
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
 		CommandContext->CopyDataToTexture
 		(
 			Info.Resource.Get(),
@@ -345,6 +357,180 @@ namespace D3D
 		CommandContext->WaitForCompletion();
 	}
 
+	ErrorCode CTextureManager::AddStreamedTexture(const WStringView & TexturePath, const WStringView & TextureName, ShaderTextureInfo & Info)
+	{
+		return Textures.GetOrLoad(TexturePath, TextureName, Info, [this](const WString & Path, const WString & Name, ShaderTextureInfo & Entry) -> ErrorCode
+		{
+			TextureStreamingDesc Desc;
+			{
+				Texture::DDS::CDDSContainer Container;
+
+				if (Container.Open(Path) != Texture::DDS::DDSResultOk ||
+					Container.GetDimension() != Texture::DDS::DDSDimensionTexture2D)
+				{
+					LOG_ERROR("Texture", "Unable to open streamed texture: {}", Path);
+					return ERROR_FILE_INVALID;
+				}
+
+				Desc.Width		= Container.GetWidth();
+				Desc.Height		= Container.GetHeight();
+				Desc.ArraySize	= Container.GetNumSlices();
+				Desc.MipLevels	= Container.GetMipLevels();
+				Desc.Format		= Container.GetFormat();
+
+				// A resource can only start at a block aligned mip.
+
+				const Texture::DDS::DDSFormatInfo & FormatInfo = Container.GetFormatInfo();
+
+				if (FormatInfo.Compressed)
+				{
+					Desc.LastStreamableMip = 0;
+
+					while (Desc.LastStreamableMip + 1 < Desc.MipLevels &&
+						(Desc.Width >> (Desc.LastStreamableMip + 1)) % FormatInfo.BlockWidth == 0 &&
+						(Desc.Height >> (Desc.LastStreamableMip + 1)) % FormatInfo.BlockHeight == 0)
+					{
+						++Desc.LastStreamableMip;
+					}
+				}
+			}
+
+			std::lock_guard<TMutex> Lock(LoadMutex);
+
+			const TextureStreamingHandle Handle = Streamer.Register(Desc);
+
+			if (Handle == InvalidTextureStreamingHandle)
+			{
+				return E_INVALIDARG;
+			}
+
+			StreamedTextures[Handle] = Path;
+
+			Entry = ShaderTextureInfo(
+				Name,
+				Path,
+				SRVDescriptorHeaps->RequestDescriptorHeapRange(),
+				NULL);
+
+			Entry.StreamingHandle	= Handle;
+			Entry.ShaderResource	= new RShaderResourceView();
+
+			// The pinned mips are loaded right away to have a fallback from the start.
+
+			Streamer.LoadPinnedMips(Handle);
+
+			if (!Entry.Resource)
+			{
+				Streamer.Unregister(Handle);
+				StreamedTextures.erase(Handle);
+
+				return E_FAIL;
+			}
+
+			return S_OK;
+		});
+	}
+
+	ErrorCode CTextureManager::ReplaceStreamedResource(const TextureStreamingHandle Handle, const Uint32 FirstMip)
+	{
+		ErrorCode Error;
+
+		const auto Path = StreamedTextures.find(Handle);
+
+		if (Path == StreamedTextures.end())
+		{
+			return E_INVALIDARG;
+		}
+
+		UniquePointer<CTextureResource> Texture = new CTextureResource();
+
+		if ((Error = Texture->LoadDDSTextureMips(CommandContext.GetRef(), Path->second, FirstMip)))
+		{
+			return Error;
+		}
+
+		RGrpCommandList * CmdList = CommandContext.Get();
+
+		if ((Error = CmdList->Close()))
+		{
+			return Error;
+		}
+
+		CCommandQueueCopy::Instance().ExecuteCommandList(CommandContext.GetRef());
+
+		if ((Error = CmdList->Reset()))
+		{
+			return Error;
+		}
+
+		Textures.Modify(Path->second, [&](ShaderTextureInfo & Info, const bool Inserted)
+		{
+			if (Info.Resource)
+			{
+				RetiredResources.emplace_back(StreamingFrame, Info.Resource);
+			}
+
+			Info.Resource = Texture.Detach();
+
+			// Views keep their descriptor, so shaders pick up the new mips without rebinding.
+
+			if ((Error = Info.ShaderResource->CreateFromResource(Info.Resource.As<RResource>(), Info.HeapEntry)))
+			{
+				return;
+			}
+
+			Info.Resource->Get()->SetName(Info.TextureName.c_str());
+		});
+
+		return Error;
+	}
+
+	bool CTextureManager::LoadMips(const TextureStreamingHandle Handle, const TextureStreamingDesc & Desc, const Uint32 FirstMip)
+	{
+		ErrorCode Error;
+
+		if ((Error = ReplaceStreamedResource(Handle, FirstMip)))
+		{
+			LOG_ERROR("Texture", "Unable to stream texture mips: {}", Logging::Hex(Error.Result));
+			return false;
+		}
+
+		Streamer.CompleteLoad(Handle, FirstMip, true);
+
+		return true;
+	}
+
+	void CTextureManager::EvictMips(const TextureStreamingHandle Handle, const TextureStreamingDesc & Desc, const Uint32 FirstMip)
+	{
+		ErrorCode Error;
+
+		if ((Error = ReplaceStreamedResource(Handle, FirstMip)))
+		{
+			LOG_ERROR("Texture", "Unable to evict texture mips: {}", Logging::Hex(Error.Result));
+		}
+	}
+
+	void CTextureManager::UpdateStreaming()
+	{
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
+		Streamer.Update();
+
+		++StreamingFrame;
+
+		RetiredResources.erase(std::remove_if(RetiredResources.begin(), RetiredResources.end(), [this](const TPair<Uint64, SharedPointer<CTextureResource> > & Retired)
+		{
+			return StreamingFrame - Retired.first > StreamingRetireDelay;
+		}), RetiredResources.end());
+	}
+
+	void CTextureManager::SetStreamingBudget(const Uint64 BudgetBytes)
+	{
+		std::lock_guard<TMutex> Lock(LoadMutex);
+
+		Streamer.SetBudget(BudgetBytes);
+	}
+
 	CTextureManager::CTextureInitializationStream::CTextureInitializationStream()
 	{
 		CommandContext = new CCommandListContext();
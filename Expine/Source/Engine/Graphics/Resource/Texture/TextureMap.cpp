@@ -71,42 +71,55 @@ namespace D3D
 		}
 #endif
 
-		File::CFile File(FilePath);
-
-		if (!File.OpenFileRead())
+		if (!TextureMap.Open(WString(FilePath)))
 		{
-			return ERROR_FILE_INVALID;
+			File::CFile File(FilePath);
+
+			TVector<Uint8> Indices;
+
+			if (File.ReadFileContentInto(Indices) != File::ErrorNone || Indices.empty())
+			{
+				return ERROR_FILE_INVALID;
+			}
+
+			// Raw maps carry no size, rows of the terrain width when it fits.
+
+			const Uint64 Size	= Indices.size();
+			const Uint64 Width	= MapWidth && Size % MapWidth == 0 ? MapWidth : std::min<Uint64>(Size, 4096);
+			const Uint64 Height	= (Size + Width - 1) / Width;
+
+			Indices.resize(static_cast<size_t>(Width * Height), 0);
+
+			if (!TextureMap.Encode(Indices.data(), static_cast<Uint32>(Width), static_cast<Uint32>(Height)))
+			{
+				return ERROR_FILE_INVALID;
+			}
 		}
 
 #ifdef TEXTURE_ATLAS_UAV
-		if (File.GetFileSize() != BufferSize)
+		if (TextureMap.GetNumCells() != BufferSize)
 		{
 			return E_INVALIDARG;
 		}
 
-		if (File.ReadFileContentInto(TextureMap) != File::ErrorNone)
+		TVector<Uint8> Indices;
 		{
-			return ERROR_FILE_INVALID;
+			TextureMap.Decode(Indices);
 		}
 
 		TextureAtlasUAV->GetResource()->AsCopyDest(CmdListCtx);
 		{
 			D3D12_SUBRESOURCE_DATA SubResourceData;
 			{
-				SubResourceData.pData		= TextureMap.data();
+				SubResourceData.pData		= Indices.data();
 				SubResourceData.RowPitch	= 1;
-				SubResourceData.SlicePitch	= TextureMap.size();
+				SubResourceData.SlicePitch	= Indices.size();
 			}
 
 			CmdListCtx.CopyDataToTexture(TextureAtlasUAV->GetResource(), &SubResourceData, 0, 1);
 		}
 
 		TextureAtlasUAV->GetResource()->AsUnorderedAccessView(CmdListCtx);
-#else
-		if (File.ReadFileContentInto(TextureMap) != File::ErrorNone)
-		{
-			return ERROR_FILE_INVALID;
-		}
 #endif
 
 		return S_OK;
@@ -247,6 +260,9 @@ namespace D3D
 	{
 		ErrorCode Error;
 
+		MapWidth	= Width;
+		MapHeight	= Height;
+
 		if ((Error = LoadTextures(CmdListCtx, 
 			pDescriptorHeapEntrySRV, 
 			pDescriptorHeapEntryNormalsSRV, 
@@ -2,6 +2,8 @@
 
 #include "Resource/Texture/TextureResource.h"
 
+#include "Utils/Texture/DDSContainer.h"
+
 namespace D3D
 {
 	CTextureResource::CTextureResource()
@@ -19,35 +21,57 @@ namespace D3D
 
 	ErrorCode CTextureResource::LoadDDSTexture(const CCommandListContext & CmdListCtx, const WString & FilePath, const D3D12_RESOURCE_STATES InitialState)
 	{
-		ErrorCode Error;
+		return LoadDDSTextureMips(CmdListCtx, FilePath, 0, InitialState);
+	}
 
-		TUniquePtr<uint8_t[]> TextureMemory;
+	ErrorCode CTextureResource::LoadDDSTextureMips(const CCommandListContext & CmdListCtx, const WString & FilePath, const Uint32 FirstMip, const D3D12_RESOURCE_STATES InitialState)
+	{
+		ErrorCode Error;
 
-		ComPointer<IResource> TempResource;
+		Texture::DDS::CDDSContainer Container;
 
-		if ((Error = DirectX::LoadDDSTextureFromFile(
-			DEVICE,
-			FilePath.c_str(),
-			&TempResource,
-			TextureMemory,
-			SubResourceData)))
+		if ((Error = OpenDDSContainer(Container, FilePath)))
 		{
 			return Error;
 		}
 
-		D3D12_RESOURCE_DESC ResourceDesc = TempResource->GetDesc();
+		if (FirstMip >= Container.GetMipLevels())
+		{
+			return E_INVALIDARG;
+		}
 
-		if ((Error = Create(InitializeOptions::Texture2D(
-			ResourceDesc.Width,
-			ResourceDesc.Height,
-			ResourceDesc.Format,
-			ResourceDesc.MipLevels,
-			NULL,
-			D3D12_RESOURCE_STATE_COPY_DEST))))
+		const UINT NumSlices	= Container.GetNumSlices();
+		const UINT MipLevels	= Container.GetMipLevels() - FirstMip;
+
+		const Texture::DDS::DDSSubresource & Top = Container.GetSubresource(FirstMip, 0);
+
+		if ((Error = Create(NumSlices > 1
+			? InitializeOptions::Texture2DArray(
+				Top.Width,
+				Top.Height,
+				static_cast<DXGI_FORMAT>(Container.GetFormat()),
+				NumSlices,
+				MipLevels,
+				NULL,
+				D3D12_RESOURCE_STATE_COPY_DEST)
+			: InitializeOptions::Texture2D(
+				Top.Width,
+				Top.Height,
+				static_cast<DXGI_FORMAT>(Container.GetFormat()),
+				MipLevels,
+				NULL,
+				D3D12_RESOURCE_STATE_COPY_DEST))))
 		{
 			return Error;
 		}
 
+		TVector<D3D12_SUBRESOURCE_DATA> SubResourceData;
+		{
+			AppendSubresourceData(Container, SubResourceData, FirstMip);
+		}
+
+		// Data is read straight from the mapping into the upload page.
+
 		CmdListCtx.CopyDataToTexture
 		(
 			this,
@@ -68,57 +92,54 @@ namespace D3D
 			return E_INVALIDARG;
 		}
 
-		D3D12_RESOURCE_DESC	ResourceDesc;
-		D3D12_RESOURCE_DESC ResourceDescLast;
+		// Every file has to stay mapped until its data has been copied.
 
-		TVector<TUniquePtr<Uint8[]> > TextureMemory(TextureFilePathes.size());
+		TVector<Texture::DDS::CDDSContainer> Containers(TextureFilePathes.size());
 
-		for (UINT N = TextureFilePathes.size() - 1; N != -1; --N)
+		for (size_t N = 0; N < TextureFilePathes.size(); ++N)
 		{
-			ID3D12Resource * TempTexture;
-
-			if (TextureFilePathes[N].empty())
-			{
-				continue;
-			}
-
-			if ((Error = DirectX::LoadDDSTextureFromFile(
-				DEVICE,
-				TextureFilePathes[N].c_str(),
-				&TempTexture,
-				TextureMemory[N],
-				SubResourceData)))
+			if ((Error = OpenDDSContainer(Containers[N], TextureFilePathes[N])))
 			{
 				return Error;
 			}
 
-			ResourceDesc = TempTexture->GetDesc();
+			const Texture::DDS::CDDSContainer & First	= Containers.front();
+			const Texture::DDS::CDDSContainer & Current	= Containers[N];
 
-			if (N != TextureFilePathes.size() - 1)
+			if (Current.GetNumSlices()	!= 1					||
+				Current.GetWidth()		!= First.GetWidth()		||
+				Current.GetHeight()		!= First.GetHeight()	||
+				Current.GetFormat()		!= First.GetFormat()	||
+				Current.GetMipLevels()	!= First.GetMipLevels())
 			{
-				if (!RResource::ResourceDescCompatible(ResourceDesc, ResourceDescLast))
-				{
-					return E_FAIL;
-				}
-			}
-			else
-			{
-				ResourceDescLast = ResourceDesc;
+				CErrorLog::Log<LogError>() << "Texture array element does not match the first element: " << TextureFilePathes[N];
+				return E_FAIL;
 			}
 		}
 
+		const Texture::DDS::CDDSContainer & First = Containers.front();
+
 		if ((Error = Create(InitializeOptions::Texture2DArray(
-			ResourceDesc.Width,
-			ResourceDesc.Height,
-			ResourceDesc.Format,
+			First.GetWidth(),
+			First.GetHeight(),
+			static_cast<DXGI_FORMAT>(First.GetFormat()),
 			TextureFilePathes.size(),
-			ResourceDesc.MipLevels,
+			First.GetMipLevels(),
 			NULL,
 			D3D12_RESOURCE_STATE_COPY_DEST))))
 		{
 			return Error;
 		}
 
+		// Slice major, so the mips of each file follow each other.
+
+		TVector<D3D12_SUBRESOURCE_DATA> SubResourceData;
+
+		for (const Texture::DDS::CDDSContainer & Container : Containers)
+		{
+			AppendSubresourceData(Container, SubResourceData);
+		}
+
 		CmdListCtx.CopyDataToTexture
 		(
 			this,
@@ -129,4 +150,43 @@ namespace D3D
 
 		return S_OK;
 	}
+
+	ErrorCode CTextureResource::OpenDDSContainer(Texture::DDS::CDDSContainer & Container, const WString & FilePath)
+	{
+		const Texture::DDS::EDDSResult Result = Container.Open(FilePath);
+
+		if (Result != Texture::DDS::DDSResultOk)
+		{
+			CErrorLog::Log<LogError>() << "Failed to load DDS texture (" << static_cast<int>(Result) << "): " << FilePath;
+			return E_FAIL;
+		}
+
+		if (Container.GetDimension() != Texture::DDS::DDSDimensionTexture2D)
+		{
+			CErrorLog::Log<LogError>() << "DDS texture is not two dimensional: " << FilePath;
+			return E_FAIL;
+		}
+
+		return S_OK;
+	}
+
+	void CTextureResource::AppendSubresourceData(const Texture::DDS::CDDSContainer & Container, TVector<D3D12_SUBRESOURCE_DATA> & SubResourceData, const Uint32 FirstMip)
+	{
+		for (const Texture::DDS::DDSSubresource & Subresource : Container.GetSubresources())
+		{
+			if (Subresource.Mip < FirstMip)
+			{
+				continue;
+			}
+
+			D3D12_SUBRESOURCE_DATA Data;
+			{
+				Data.pData		= Subresource.Data;
+				Data.RowPitch	= static_cast<LONG_PTR>(Subresource.RowPitch);
+				Data.SlicePitch	= static_cast<LONG_PTR>(Subresource.SlicePitch);
+			}
+
+			SubResourceData.push_back(Data);
+		}
+	}
 }
@@ -0,0 +1,505 @@
+#include "Precompiled.h"
+
+#include "Resource/Texture/TextureStreaming.h"
+
+#include "Utils/Texture/DDSContainer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace D3D
+{
+	bool CTextureStreamingBackendNull::LoadMips(const TextureStreamingHandle Handle, const TextureStreamingDesc & Desc, const Uint32 FirstMip)
+	{
+		if (Immediate)
+		{
+			Streamer->CompleteLoad(Handle, FirstMip, true);
+		}
+		else
+		{
+			Pending.push_back({ Handle, FirstMip });
+		}
+
+		return true;
+	}
+
+	void CTextureStreamingBackendNull::EvictMips(const TextureStreamingHandle Handle, const TextureStreamingDesc & Desc, const Uint32 FirstMip)
+	{
+	}
+
+	void CTextureStreamingBackendNull::Complete(const bool Success)
+	{
+		for (const PendingLoad & Load : Pending)
+		{
+			Streamer->CompleteLoad(Load.Handle, Load.FirstMip, Success);
+		}
+
+		Pending.clear();
+	}
+
+	ErrorCode CTextureStreamer::Initialize(const InitializeOptions & Options)
+	{
+		if (!Options.Backend)
+		{
+			return E_INVALIDARG;
+		}
+
+		this->Options = Options;
+
+		Stats.BudgetBytes = Options.BudgetBytes;
+
+		return S_OK;
+	}
+
+	TextureStreamingHandle CTextureStreamer::Register(const TextureStreamingDesc & Desc)
+	{
+		if (Desc.Width == 0 || Desc.Height == 0 || Desc.ArraySize == 0 || Desc.MipLevels == 0 || Desc.MipLevels > MaxMipLevels)
+		{
+			return InvalidTextureStreamingHandle;
+		}
+
+		TextureStreamingHandle Handle;
+
+		if (FreeHandles.empty())
+		{
+			Handle = static_cast<TextureStreamingHandle>(Entries.size());
+			Entries.emplace_back(new Entry());
+		}
+		else
+		{
+			Handle = FreeHandles.back();
+			FreeHandles.pop_back();
+		}
+
+		Entry & Target = *Entries[Handle];
+
+		Target.Desc = Desc;
+		Target.TailBytes[Desc.MipLevels] = 0;
+
+		for (Uint32 Mip = Desc.MipLevels; Mip-- > 0;)
+		{
+			Target.TailBytes[Mip] = Target.TailBytes[Mip + 1] + ComputeMipBytes(Desc, Mip);
+		}
+
+		Target.MinResidentMip = std::min(Desc.MipLevels - 1, Desc.LastStreamableMip);
+
+		while (Target.MinResidentMip > 0 && std::max(Desc.Width >> (Target.MinResidentMip - 1), Desc.Height >> (Target.MinResidentMip - 1)) <= Options.MinResidentSize)
+		{
+			--Target.MinResidentMip;
+		}
+
+		// Nothing is resident until the pinned mips have been loaded.
+
+		Target.ResidentMip	= Desc.MipLevels;
+		Target.PendingMip	= Desc.MipLevels;
+		Target.WantedMip	= Target.MinResidentMip;
+		Target.Priority		= 0.0f;
+		Target.LastRequest	= Frame;
+		Target.Registered	= true;
+
+		Target.RequiredMip	= NoRequest;
+		Target.ScreenSize	= 0;
+
+		Stats.PinnedBytes += Target.TailBytes[Target.MinResidentMip];
+		Stats.NumTextures++;
+
+		return Handle;
+	}
+
+	void CTextureStreamer::Unregister(const TextureStreamingHandle Handle)
+	{
+		Entry & Target = *Entries[Handle];
+
+		if (!Target.Registered)
+		{
+			return;
+		}
+
+		Target.Registered = false;
+
+		Stats.PinnedBytes -= Target.TailBytes[Target.MinResidentMip];
+		Stats.NumTextures--;
+
+		// A pending load still has to be accounted for before the handle is reused.
+
+		if (!Target.IsPending())
+		{
+			Release(Handle);
+		}
+	}
+
+	void CTextureStreamer::LoadPinnedMips(const TextureStreamingHandle Handle)
+	{
+		Entry & Target = *Entries[Handle];
+
+		if (Target.Registered && !Target.IsPending() && Target.ResidentMip > Target.MinResidentMip)
+		{
+			IssueLoad(Handle, Target, Target.MinResidentMip);
+		}
+	}
+
+	void CTextureStreamer::Release(const TextureStreamingHandle Handle)
+	{
+		Entry & Target = *Entries[Handle];
+		{
+			Stats.ResidentBytes -= Target.TailBytes[Target.ResidentMip];
+		}
+
+		Target.ResidentMip	= Target.Desc.MipLevels;
+		Target.PendingMip	= Target.Desc.MipLevels;
+
+		FreeHandles.push_back(Handle);
+	}
+
+	void CTextureStreamer::RequestMip(const TextureStreamingHandle Handle, const Uint32 Mip, const Uint32 ScreenSize)
+	{
+		Entry & Target = *Entries[Handle];
+
+		Uint32 Current = Target.RequiredMip.load(std::memory_order_relaxed);
+
+		while (Mip < Current && !Target.RequiredMip.compare_exchange_weak(Current, Mip, std::memory_order_relaxed));
+
+		Current = Target.ScreenSize.load(std::memory_order_relaxed);
+
+		while (ScreenSize > Current && !Target.ScreenSize.compare_exchange_weak(Current, ScreenSize, std::memory_order_relaxed));
+	}
+
+	void CTextureStreamer::RequestScreenSize(const TextureStreamingHandle Handle, const Float ScreenSize)
+	{
+		const TextureStreamingDesc & Desc = Entries[Handle]->Desc;
+		{
+			RequestMip(Handle, ComputeRequiredMip(Desc.Width, Desc.Height, ScreenSize), static_cast<Uint32>(std::max(ScreenSize, 1.0f)));
+		}
+	}
+
+	void CTextureStreamer::CompleteLoad(const TextureStreamingHandle Handle, const Uint32 FirstMip, const bool Success)
+	{
+		std::lock_guard<TMutex> Lock(CompletionMutex);
+		{
+			Completions.push_back({ Handle, FirstMip, Success });
+		}
+	}
+
+	void CTextureStreamer::ProcessCompletions()
+	{
+		TVector<Completion> Finished;
+		{
+			std::lock_guard<TMutex> Lock(CompletionMutex);
+			std::swap(Finished, Completions);
+		}
+
+		for (const Completion & Result : Finished)
+		{
+			Entry & Target = *Entries[Result.Handle];
+
+			if (Target.PendingMip != Result.FirstMip || !Target.IsPending())
+			{
+				continue;
+			}
+
+			const Uint64 Bytes = Target.GetBytes(Result.FirstMip, Target.ResidentMip);
+
+			Stats.PendingBytes -= Bytes;
+			Stats.NumPending--;
+
+			if (Result.Success)
+			{
+				Stats.ResidentBytes += Bytes;
+				Stats.NumLoads++;
+
+				Target.ResidentMip = Result.FirstMip;
+			}
+			else
+			{
+				Stats.NumFailedLoads++;
+			}
+
+			Target.PendingMip = Target.ResidentMip;
+
+			if (!Target.Registered)
+			{
+				Release(Result.Handle);
+			}
+		}
+	}
+
+	void CTextureStreamer::CollectRequests()
+	{
+		for (TextureStreamingHandle Handle = 0; Handle < Entries.size(); ++Handle)
+		{
+			Entry & Target = *Entries[Handle];
+
+			if (!Target.Registered)
+			{
+				continue;
+			}
+
+			const Uint32 Required	= Target.RequiredMip.exchange(NoRequest, std::memory_order_relaxed);
+			const Uint32 ScreenSize	= Target.ScreenSize.exchange(0, std::memory_order_relaxed);
+
+			if (Required != NoRequest)
+			{
+				Target.WantedMip	= std::min(Required, Target.MinResidentMip);
+				Target.LastRequest	= Frame;
+
+				// Without a screen size the size of the wanted mip stands in.
+
+				Target.Priority = ScreenSize ? static_cast<Float>(ScreenSize) : static_cast<Float>(std::max(
+					std::max(Target.Desc.Width >> Target.WantedMip, 1U),
+					std::max(Target.Desc.Height >> Target.WantedMip, 1U)));
+			}
+			else if (Frame - Target.LastRequest > Options.EvictionDelay)
+			{
+				Target.WantedMip	= Target.MinResidentMip;
+				Target.Priority		= 0.0f;
+			}
+		}
+	}
+
+	bool CTextureStreamer::IssueLoad(const TextureStreamingHandle Handle, Entry & Target, const Uint32 FirstMip)
+	{
+		if (!Options.Backend->LoadMips(Handle, Target.Desc, FirstMip))
+		{
+			Stats.NumFailedLoads++;
+			return false;
+		}
+
+		Stats.PendingBytes += Target.GetBytes(FirstMip, Target.ResidentMip);
+		Stats.NumPending++;
+
+		Target.PendingMip = FirstMip;
+
+		return true;
+	}
+
+	void CTextureStreamer::Evict(const TextureStreamingHandle Handle, Entry & Target, const Uint32 FirstMip)
+	{
+		Options.Backend->EvictMips(Handle, Target.Desc, FirstMip);
+
+		Stats.ResidentBytes -= Target.GetBytes(Target.ResidentMip, FirstMip);
+		Stats.NumEvictions++;
+
+		Target.ResidentMip	= FirstMip;
+		Target.PendingMip	= FirstMip;
+	}
+
+	bool CTextureStreamer::MakeRoom(const Uint64 Bytes, const TextureStreamingHandle Requester, const Float Priority)
+	{
+		TVector<TextureStreamingHandle> Victims;
+
+		for (TextureStreamingHandle Handle = 0; Handle < Entries.size(); ++Handle)
+		{
+			const Entry & Target = *Entries[Handle];
+
+			if (Handle != Requester && Target.Registered && !Target.IsPending() && Target.ResidentMip < Target.MinResidentMip)
+			{
+				Victims.push_back(Handle);
+			}
+		}
+
+		Uint64 Freed = 0;
+
+		// Mips nobody asked for, least recently requested first.
+
+		std::sort(Victims.begin(), Victims.end(), [this](const TextureStreamingHandle Left, const TextureStreamingHandle Right)
+		{
+			const Entry & A = *Entries[Left];
+			const Entry & B = *Entries[Right];
+
+			return A.LastRequest != B.LastRequest ? A.LastRequest < B.LastRequest : A.Priority < B.Priority;
+		});
+
+		for (const TextureStreamingHandle Handle : Victims)
+		{
+			if (Freed >= Bytes)
+			{
+				return true;
+			}
+
+			Entry & Target = *Entries[Handle];
+
+			if (Target.WantedMip > Target.ResidentMip)
+			{
+				Freed += Target.GetBytes(Target.ResidentMip, Target.WantedMip);
+				Evict(Handle, Target, Target.WantedMip);
+			}
+		}
+
+		// Demote less important textures one mip per pass, so the
+		// loss of detail is spread instead of hitting one texture.
+
+		std::sort(Victims.begin(), Victims.end(), [this](const TextureStreamingHandle Left, const TextureStreamingHandle Right)
+		{
+			return Entries[Left]->Priority < Entries[Right]->Priority;
+		});
+
+		bool Progress = true;
+
+		while (Freed < Bytes && Progress)
+		{
+			Progress = false;
+
+			for (const TextureStreamingHandle Handle : Victims)
+			{
+				Entry & Target = *Entries[Handle];
+
+				if (Target.Priority >= Priority)
+				{
+					break;
+				}
+
+				if (Target.ResidentMip < Target.MinResidentMip)
+				{
+					Freed += Target.GetBytes(Target.ResidentMip, Target.ResidentMip + 1);
+					Evict(Handle, Target, Target.ResidentMip + 1);
+
+					Progress = true;
+
+					if (Freed >= Bytes)
+					{
+						break;
+					}
+				}
+			}
+		}
+
+		return Freed >= Bytes;
+	}
+
+	void CTextureStreamer::Update()
+	{
+		ProcessCompletions();
+
+		++Frame;
+
+		CollectRequests();
+
+		// Pinned mips are loaded regardless of the budget.
+
+		for (TextureStreamingHandle Handle = 0; Handle < Entries.size(); ++Handle)
+		{
+			LoadPinnedMips(Handle);
+		}
+
+		const Uint64 Used = Stats.ResidentBytes + Stats.PendingBytes;
+
+		if (Used > Options.BudgetBytes)
+		{
+			MakeRoom(Used - Options.BudgetBytes, InvalidTextureStreamingHandle, std::numeric_limits<Float>::max());
+		}
+
+		TVector<TextureStreamingHandle> Candidates;
+
+		for (TextureStreamingHandle Handle = 0; Handle < Entries.size(); ++Handle)
+		{
+			const Entry & Target = *Entries[Handle];
+
+			if (Target.Registered && !Target.IsPending() && Target.ResidentMip <= Target.MinResidentMip && Target.WantedMip < Target.ResidentMip)
+			{
+				Candidates.push_back(Handle);
+			}
+		}
+
+		std::sort(Candidates.begin(), Candidates.end(), [this](const TextureStreamingHandle Left, const TextureStreamingHandle Right)
+		{
+			const Entry & A = *Entries[Left];
+			const Entry & B = *Entries[Right];
+
+			if (A.Priority != B.Priority)
+			{
+				return A.Priority > B.Priority;
+			}
+
+			return A.ResidentMip - A.WantedMip > B.ResidentMip - B.WantedMip;
+		});
+
+		Uint32 NumIssued = 0;
+
+		for (const TextureStreamingHandle Handle : Candidates)
+		{
+			if (NumIssued >= Options.MaxLoadsPerUpdate || Stats.PendingBytes >= Options.MaxPendingBytes)
+			{
+				break;
+			}
+
+			Entry & Target = *Entries[Handle];
+
+			const Uint64 Cost = Target.GetBytes(Target.WantedMip, Target.ResidentMip);
+
+			auto GetAvailable = [this]()
+			{
+				const Uint64 Used = Stats.ResidentBytes + Stats.PendingBytes;
+				{
+					return Used < Options.BudgetBytes ? Options.BudgetBytes - Used : 0;
+				}
+			};
+
+			if (Cost > GetAvailable())
+			{
+				MakeRoom(Cost - GetAvailable(), Handle, Target.Priority);
+			}
+
+			// Load as much of the request as fits, the rest follows once room is made.
+
+			const Uint64 Available = GetAvailable();
+
+			Uint32 FirstMip = Target.WantedMip;
+
+			while (FirstMip < Target.ResidentMip && Target.GetBytes(FirstMip, Target.ResidentMip) > Available)
+			{
+				++FirstMip;
+			}
+
+			if (FirstMip == Target.ResidentMip)
+			{
+				Stats.NumDeferred++;
+				continue;
+			}
+
+			if (IssueLoad(Handle, Target, FirstMip))
+			{
+				++NumIssued;
+			}
+		}
+	}
+
+	void CTextureStreamer::SetBudget(const Uint64 BudgetBytes)
+	{
+		Options.BudgetBytes	= BudgetBytes;
+		Stats.BudgetBytes	= BudgetBytes;
+	}
+
+	Uint32 CTextureStreamer::ComputeRequiredMip(const Uint32 Width, const Uint32 Height, const Float ScreenSize)
+	{
+		const Float Ratio = static_cast<Float>(std::max(Width, Height)) / std::max(ScreenSize, 1.0f);
+
+		if (Ratio <= 1.0f)
+		{
+			return 0;
+		}
+
+		return static_cast<Uint32>(std::floor(std::log2(Ratio)));
+	}
+
+	Uint64 CTextureStreamer::ComputeMipBytes(const TextureStreamingDesc & Desc, const Uint32 Mip)
+	{
+		Texture::DDS::DDSFormatInfo Info;
+
+		// Unknown formats are sized as four bytes per texel.
+
+		if (!Texture::DDS::CDDSContainer::GetFormatInfo(Desc.Format, Info))
+		{
+			Info.BitsPerBlock	= 32;
+			Info.BlockWidth		= 1;
+			Info.BlockHeight	= 1;
+		}
+
+		const Uint64 Width	= std::max(Desc.Width >> Mip, 1U);
+		const Uint64 Height	= std::max(Desc.Height >> Mip, 1U);
+
+		const Uint64 BlocksWide = (Width + Info.BlockWidth - 1) / Info.BlockWidth;
+		const Uint64 BlocksHigh = (Height + Info.BlockHeight - 1) / Info.BlockHeight;
+
+		return (BlocksWide * Info.BitsPerBlock + 7) / 8 * BlocksHigh * Desc.ArraySize;
+	}
+}
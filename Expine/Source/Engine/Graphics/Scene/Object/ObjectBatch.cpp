@@ -0,0 +1,304 @@
+#include "Precompiled.h"
+
+#include "Scene/Object/ObjectBatch.h"
+
+#include <tbb/parallel_sort.h>
+#include <tbb/parallel_for.h>
+
+namespace D3D
+{
+	static constexpr Float GQuantizeScaleMax = 16.0f;
+
+	static inline Uint16 QuantizeUnit(const Float Value)
+	{
+		return static_cast<Uint16>(Math::Clamp(Value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	static inline Float DequantizeUnit(const Uint16 Value)
+	{
+		return static_cast<Float>(Value) * (1.0f / 65535.0f);
+	}
+
+	static inline Uint16 QuantizeAngle(const Float Angle)
+	{
+		return QuantizeUnit((Angle + PI) * (0.5f * INV_PI));
+	}
+
+	static inline Float DequantizeAngle(const Uint16 Value)
+	{
+		return DequantizeUnit(Value) * (2.0f * PI) - PI;
+	}
+
+	CInstanceBatchBuilder::CInstanceBatchBuilder(const InitializeOptions & Options) :
+		Options(Options)
+	{}
+
+	Uint32 CInstanceBatchBuilder::RegisterMesh(const void * Mesh)
+	{
+		Uint32 * Id = MeshIds.Find(Mesh);
+
+		if (Id)
+		{
+			return *Id;
+		}
+
+		if (MeshIds.size() >= InstanceBatchKey::MaxMeshes)
+		{
+			throw Exception("Instance batch mesh limit exceeded.");
+		}
+
+		const Uint32 NewId = static_cast<Uint32>(MeshIds.size());
+		{
+			MeshIds.insert(std::make_pair(Mesh, NewId));
+		}
+
+		return NewId;
+	}
+
+	Uint32 CInstanceBatchBuilder::RegisterMaterial(const void * Material)
+	{
+		Uint32 * Id = MaterialIds.Find(Material);
+
+		if (Id)
+		{
+			return *Id;
+		}
+
+		if (MaterialIds.size() >= InstanceBatchKey::MaxMaterials)
+		{
+			throw Exception("Instance batch material limit exceeded.");
+		}
+
+		const Uint32 NewId = static_cast<Uint32>(MaterialIds.size());
+		{
+			MaterialIds.insert(std::make_pair(Material, NewId));
+			Materials.push_back(Material);
+		}
+
+		return NewId;
+	}
+
+	void CInstanceBatchBuilder::SetMeshRange(const Uint32 Mesh, const Uint32 Lod, const Uint32 Material, const InstanceMeshRange & Range)
+	{
+		MeshRanges.insert_or_assign(InstanceBatchKey::Create(Mesh, Lod, Material), Range);
+	}
+
+	const InstanceMeshRange * CInstanceBatchBuilder::GetMeshRange(const InstanceBatchKey & Key) const
+	{
+		auto Iter = MeshRanges.find(Key.Key);
+
+		if (Iter == MeshRanges.end())
+		{
+			return NULL;
+		}
+
+		return &Iter->second;
+	}
+
+	void CInstanceBatchBuilder::AddMeshGeometry(const Uint32 Mesh, const Uint32 Lod, const KStaticMesh & Source)
+	{
+		if (!MeshGeometries.insert(CreateMeshGeometryKey(Mesh, Lod)).second)
+		{
+			return;
+		}
+
+		if (Lod >= Source.SourceModels.size() || !Source.SourceModels[Lod].Mesh)
+		{
+			return;
+		}
+
+		const KMesh & Model = *Source.SourceModels[Lod].Mesh;
+
+		const Uint32 NumWedges	= static_cast<Uint32>(Model.WedgeIndices.size() / 3 * 3);
+		const Uint32 BaseVertex	= static_cast<Uint32>(GeometryVertices.size());
+
+		// One vertex per wedge, the wedges of a face are consecutive.
+
+		GeometryVertices.resize(BaseVertex + NumWedges);
+
+		for (Uint32 N = 0; N < NumWedges; ++N)
+		{
+			const Uint32 Position = static_cast<Uint32>(Model.WedgeIndices[N]);
+
+			if (Position >= Model.VertexPositions.size())
+			{
+				throw Exception("Instance batch mesh has an invalid wedge.");
+			}
+
+			StaticMeshVertex & Vertex = GeometryVertices[BaseVertex + N];
+			{
+				Vertex.Position = Model.VertexPositions[Position];
+				Vertex.Normal	= N < Model.WedgeTangentZ.size()		? Model.WedgeTangentZ[N]		: Vector3f(0.0f, 0.0f, 1.0f);
+				Vertex.Texcoord	= N < Model.WedgeTexcoords[0].size()	? Model.WedgeTexcoords[0][N]	: Vector2f(0.0f, 0.0f);
+			}
+		}
+
+		// Faces are grouped by the material of their section, sections sharing a
+		// material end up in one range since batches are keyed by material.
+
+		TMap<Uint32, TVector<Uint32> > MaterialFaces;
+
+		for (Uint32 Face = 0; Face < NumWedges / 3; ++Face)
+		{
+			const Int32 Section = Face < Model.FaceMaterialIndices.size() ? Model.FaceMaterialIndices[Face] : 0;
+
+			const KMeshSectionInfo * Info = Source.SectionInfoMap.Find(Lod, Section);
+
+			const Int32 MaterialIdx = Info ? Info->MaterialIdx : Section;
+
+			if (MaterialIdx < 0 || MaterialIdx >= static_cast<Int32>(Source.StaticMaterials.size()))
+			{
+				continue;
+			}
+
+			MaterialFaces[RegisterMaterial(Source.StaticMaterials[MaterialIdx])].push_back(Face);
+		}
+
+		for (const auto & Faces : MaterialFaces)
+		{
+			InstanceMeshRange Range;
+			{
+				Range.IndexCount = static_cast<Uint32>(Faces.second.size() * 3);
+				Range.StartIndex = static_cast<Uint32>(GeometryIndices.size());
+				Range.BaseVertex = static_cast<Int32>(BaseVertex);
+			}
+
+			for (const Uint32 Face : Faces.second)
+			{
+				GeometryIndices.push_back(Face * 3 + 0);
+				GeometryIndices.push_back(Face * 3 + 1);
+				GeometryIndices.push_back(Face * 3 + 2);
+			}
+
+			SetMeshRange(Mesh, Lod, Faces.first, Range);
+		}
+
+		++GeometryRevision;
+	}
+
+	void CInstanceBatchBuilder::Reset()
+	{
+		Records.clear();
+		Transforms.clear();
+		Batches.clear();
+		Instances.clear();
+		InstancesQuantized.clear();
+	}
+
+	void CInstanceBatchBuilder::SortRecords()
+	{
+		if (Records.size() >= Options.ParallelSortThreshold)
+		{
+			tbb::parallel_sort(Records.begin(), Records.end());
+		}
+		else
+		{
+			std::sort(Records.begin(), Records.end());
+		}
+	}
+
+	void CInstanceBatchBuilder::PackBatch(InstanceBatch & Batch)
+	{
+		const InstanceRecord * BatchRecords = Records.data() + Batch.FirstInstance;
+
+		Vector3f BoundsMin = Transforms[BatchRecords[0].Index].Position;
+		Vector3f BoundsMax = BoundsMin;
+
+		Float ScaleMax = 0.0f;
+
+		for (Uint32 N = 0; N < Batch.NumInstances; ++N)
+		{
+			const InstanceTransform & Transform = Transforms[BatchRecords[N].Index];
+
+			Instances[Batch.FirstInstance + N] = Transform;
+
+			BoundsMin = BoundsMin.ComponentMin(Transform.Position);
+			BoundsMax = BoundsMax.ComponentMax(Transform.Position);
+			ScaleMax  = Math::Max(ScaleMax, Transform.Scale);
+		}
+
+		Batch.BoundsMin		= BoundsMin;
+		Batch.BoundsExtent	= BoundsMax - BoundsMin;
+		Batch.ScaleMax		= Math::Min(ScaleMax, GQuantizeScaleMax);
+
+		if (Options.QuantizePositions)
+		{
+			for (Uint32 N = 0; N < Batch.NumInstances; ++N)
+			{
+				Quantize(Instances[Batch.FirstInstance + N], Batch, InstancesQuantized[Batch.FirstInstance + N]);
+			}
+		}
+	}
+
+	void CInstanceBatchBuilder::Build()
+	{
+		Batches.clear();
+
+		if (Records.empty())
+		{
+			Instances.clear();
+			InstancesQuantized.clear();
+			return;
+		}
+
+		SortRecords();
+
+		Instances.resize(Records.size());
+
+		if (Options.QuantizePositions)
+		{
+			InstancesQuantized.resize(Records.size());
+		}
+
+		Uint32 First = 0;
+
+		for (Uint32 N = 1; N <= Records.size(); ++N)
+		{
+			if (N == Records.size() || Records[N].Key != Records[First].Key)
+			{
+				InstanceBatch & Batch = *Batches.emplace(Batches.end());
+				{
+					Batch.Key.Key		= Records[First].Key;
+					Batch.FirstInstance = First;
+					Batch.NumInstances	= N - First;
+				}
+
+				First = N;
+			}
+		}
+
+		tbb::parallel_for(size_t(0), Batches.size(), [this](size_t N)
+		{
+			PackBatch(Batches[N]);
+		});
+	}
+
+	void CInstanceBatchBuilder::Quantize(const InstanceTransform & Transform, const InstanceBatch & Batch, InstanceTransformQuantized & Result)
+	{
+		const Vector3f Relative = Transform.Position - Batch.BoundsMin;
+
+		for (int32 N = 0; N < 3; ++N)
+		{
+			const Float Extent = Batch.BoundsExtent.Component(N);
+
+			Result.Position[N] = Extent > 0.0f ? QuantizeUnit(Relative.Component(N) / Extent) : 0;
+			Result.Rotation[N] = QuantizeAngle(Transform.Rotation.Component(N));
+		}
+
+		Result.Scale	= QuantizeUnit(Batch.ScaleMax > 0.0f ? Transform.Scale / Batch.ScaleMax : 0.0f);
+		Result.Padding	= 0;
+		Result.ObjectId = Transform.ObjectId;
+	}
+
+	void CInstanceBatchBuilder::Dequantize(const InstanceTransformQuantized & Quantized, const InstanceBatch & Batch, InstanceTransform & Result)
+	{
+		for (int32 N = 0; N < 3; ++N)
+		{
+			Result.Position.Component(N) = Batch.BoundsMin.Component(N) + DequantizeUnit(Quantized.Position[N]) * Batch.BoundsExtent.Component(N);
+			Result.Rotation.Component(N) = DequantizeAngle(Quantized.Rotation[N]);
+		}
+
+		Result.Scale	= DequantizeUnit(Quantized.Scale) * Batch.ScaleMax;
+		Result.ObjectId = Quantized.ObjectId;
+	}
+}
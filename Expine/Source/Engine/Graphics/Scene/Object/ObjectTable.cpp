@@ -3,7 +3,11 @@
 #include "ObjectTable.h"
 #include "SpeedTree.h"
 
-static constexpr size_t GObjectTableCacheCapacity = 256U;
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+static constexpr size_t GObjectTableParallelGrain = 256U;
 
 namespace D3D
 {
@@ -28,15 +32,33 @@ namespace D3D
 		virtual inline EObjectType GetSubType() const = 0;
 	};
 
+	class CSpeedTreeTableObject : public CSpeedTreeObject
+	{
+	private:
+
+		CSpeedTreeObjectController TableController;
+
+	public:
+
+		inline CSpeedTreeTableObject(CSpeedTree * Spt, const ObjectTableEntry & Entry) :
+			CSpeedTreeObject(Spt, NULL),
+			TableController(Entry.Position, Entry.Rotation)
+		{
+			SetObjectController(&TableController);
+		}
+	};
+
 	class SpeedTreeTypeInfo : public ObjectTypeInfo
 	{
 	public:
 
 		static constexpr EObjectType Type = ObjectTypeSpeedTree;
 
+		using ObjectClass = CSpeedTreeTableObject;
+
 	private:
 
-		CSpeedTree * Spt;
+		CSpeedTree * Spt = NULL;
 
 		inline void Initialize(const String& FilePath)
 		{
@@ -61,10 +83,9 @@ namespace D3D
 			return Type;
 		}
 
-		template<class Allocator = std::allocator<CSpeedTreeObject> >
-		CSpeedTreeObject * Create(const ObjectTableEntry * Entry, Allocator & Allocator = std::allocator<CSpeedTreeObject>())
+		inline ObjectClass * Create(const ObjectTableEntry & Entry, void * Memory) const
 		{
-
+			return new (Memory) ObjectClass(Spt, Entry);
 		}
 	};
 
@@ -144,7 +165,7 @@ namespace D3D
 			}
 
 			return static_cast<Class*>(ObjectTypeMap[Class::Type].emplace(
-				ObjectTypeId, new Class(ObjectTypeId, std::forward<Args>(Arguments)...)).second);
+				ObjectTypeId, new Class(ObjectTypeId, std::forward<Args>(Arguments)...)).first->second);
 		}
 
 		template <class Class>
@@ -176,199 +197,291 @@ namespace D3D
 
 	class ObjectFactory
 	{
-	private:
-
 	public:
 
-		template <class Object, class ObjectInfo>
-		static Object * Create(ObjectInfo * Info, ObjectTableEntry * Entry)
-		{
-			return Info->Create(Entry);
-		}
-
-		template <class ObjectInfo, class Iterator, class Result>
-		static void CreateMultiple(ObjectInfo * Info, Iterator & Iter, const Iterator & End, Result & Container)
+		// Type infos are resolved serially since the storage is not thread safe,
+		// the objects of the range are then constructed in parallel.
+
+		template <class ObjectInfo>
+		static void CreateRange
+		(
+			const	ObjectTableTypeRange	& Range,
+			const	ObjectTableEntry		* Entries,
+					ObjectTypeStorage		& Storage,
+					CObjectArena			& Arena,
+					ObjectHandle			* Handles
+		)
 		{
-			const Uint32 Type = Iter->Type;
+			THashMap<Uint32, ObjectInfo*> Infos;
 
-			for (Iter; Iter != End && Iter->Type == Type; ++Iter)
+			for (Uint32 N = 0; N < Range.Count; ++N)
 			{
-				Container.Add(static_cast<ObjectInfo*>(Info)->Create(&*Iter));
-			}
-		}
-	};
-
-	ObjectTableCache::ObjectTableCache() :
-		Cache(GObjectTableCacheCapacity)
-	{
-	}
-
-	class ObjectContainer
-	{
-		template<class C, size_t ElementCount> class SimpleAllocator
-		{
-		public:
+				const Uint32 Id = Entries[Range.First + N].Id;
 
-			constexpr static size_t NodeHeapSize = ElementCount * sizeof(C);
-
-		private:
-
-			HANDLE Heap;
-
-		public:
-
-			inline SimpleAllocator() 
-			{
-				if (!(Heap = HeapCreate(HEAP_CREATE_ALIGN_16, 0, 0))) 
+				if (!Infos.Find(Id))
 				{
-					throw ERROR_INVALID_HANDLE;
+					Infos.emplace(Id, Storage.AddObjectType<ObjectInfo>(Id));
 				}
 			}
 
-			inline ~SimpleAllocator() noexcept 
+			const Uint32 First = Arena.Reserve<typename ObjectInfo::ObjectClass>(ObjectInfo::Type, Range.Count);
+
+			tbb::parallel_for(tbb::blocked_range<Uint32>(0, Range.Count, GObjectTableParallelGrain), [&](const tbb::blocked_range<Uint32> & Block)
 			{
-				if (Heap) 
+				for (Uint32 N = Block.begin(); N != Block.end(); ++N)
 				{
-					HeapDestroy(Heap);
+					const ObjectTableEntry & Entry = Entries[Range.First + N];
+
+					(*Infos.Find(Entry.Id))->Create(Entry, Arena.GetSlot(ObjectInfo::Type, First + N));
+
+					Handles[Range.First + N] = ObjectHandle::Make(ObjectInfo::Type, First + N);
 				}
-			}
+			});
 
-			inline C * Allocate() const noexcept 
-			{
-				return reinterpret_cast<C*>(HeapAlloc(Heap, 0, NodeHeapSize));
-			}
+			Arena.Commit(ObjectInfo::Type, Range.Count);
+		}
+	};
 
-			inline C * Allocate(size_t NumElements) const noexcept 
-			{
-				return reinterpret_cast<C*>(HeapAlloc(Heap, 0, NumElements * sizeof(C)));
-			}
+	void CObjectArena::Clear()
+	{
+		for (Uint32 Type = 0; Type < ObjectTypeCount; ++Type)
+		{
+			TypeStorage & Storage = Types[Type];
 
-			inline C * ReAllocate(C * Memory, size_t Size) const noexcept 
+			for (Uint32 N = 0; N < Storage.NumElements; ++N)
 			{
-				return reinterpret_cast<C*>(HeapReAlloc(Heap, HEAP_REALLOC_IN_PLACE_ONLY, Memory, Size));
+				Storage.Destroy(GetSlot(static_cast<EObjectType>(Type), N));
 			}
 
-			inline void Deallocate(C * N) const noexcept 
+			for (Byte * Chunk : Storage.Chunks)
 			{
-				HeapFree(Heap, 0, N);
+				::operator delete(Chunk);
 			}
-		};
 
-		class Allocator : public SimpleAllocator<CSceneObject, GObjectTableCacheCapacity>
-		{
-		private:
-
-			size_t Space = 0;
-			size_t SpaceAvailable = 0;
-
-			CSceneObject * Memory;
-
-			TVector<TPair<CSceneObject*, size_t> > Allocations;
+			Storage = TypeStorage();
+		}
+	}
 
-		public:
+	ErrorCode ObjectTableLoader::LoadTable(const ObjectTable & Table, CObjectArena & Arena, TVector<ObjectHandle> & Handles)
+	{
+		const auto & Entries = Table.GetEntries();
 
-			Allocator() = default;
+		Handles.assign(Entries.size(), ObjectHandle());
 
-			inline void * allocate(const size_t Size) { return Allocate(Size); };
-			inline void * Allocate(const size_t Size)
+		try
+		{
+			for (const ObjectTableTypeRange & Range : Table.GetTypeRanges())
 			{
-				if (SpaceAvailable < Size)
+				switch (Range.Type)
 				{
-					if (Memory)
+					case ObjectTypeSpeedTree:
 					{
-						CSceneObject * M = Memory;
-						
-						if (!(Memory = ReAllocate(Memory, Space + Size * GObjectTableCacheCapacity)))
-						{
-							Allocations.push_back(std::make_pair(Memory, Space));
-
-							if (!(Memory = SimpleAllocator::Allocate()))
-							{
-								throw Exception("Out of Memory.");
-							}
-
-							Space = SpaceAvailable = SimpleAllocator::NodeHeapSize - Size;
-						}
-						else
-						{
-							Space += 
-								Size * GObjectTableCacheCapacity;
-							SpaceAvailable += 
-								Size * GObjectTableCacheCapacity - Size;
-						}
+						ObjectFactory::CreateRange<SpeedTreeTypeInfo>(Range, Entries.data(), GStorage, Arena, Handles.data());
 					}
-					else
-					{
-						if (!(Memory = SimpleAllocator::Allocate()))
-						{
-							throw Exception("Out of Memory.");
-						}
 
-						Space = SimpleAllocator::NodeHeapSize - Size;
+					break;
+
+					default:
+					{
+						CErrorLog::Log<LogError>() << "Unknown object type in table: " << Range.Type;
 					}
 				}
+			}
+		}
+		catch (const Exception & Exception)
+		{
+			CErrorLog::Log<LogException>(Exception.what(), CErrorLog::EndLine);
+			return E_FAIL;
+		}
+
+		return S_OK;
+	}
+
+	Uint32 ObjectTable::GetMortonCode(const Vector3f & Position, const Vector3f & BoundsMin, const Vector3f & BoundsMax)
+	{
+		// 10 bits per axis, interleaved as ..zyxzyx.
+
+		auto Spread = [](Uint32 Value)
+		{
+			Value = (Value | (Value << 16)) & 0x030000FF;
+			Value = (Value | (Value <<  8)) & 0x0300F00F;
+			Value = (Value | (Value <<  4)) & 0x030C30C3;
+			Value = (Value | (Value <<  2)) & 0x09249249;
 
-				SpaceAvailable -= Size;
+			return Value;
+		};
+
+		auto Quantize = [](const Float Value, const Float Min, const Float Max)
+		{
+			const Float Extent = Max - Min;
+
+			if (Extent <= SMALL_NUMBER)
+			{
+				return 0U;
 			}
+
+			return static_cast<Uint32>(Math::Clamp((Value - Min) / Extent, 0.0f, 1.0f) * 1023.0f);
 		};
 
-	private:
+		return
+			(Spread(Quantize(Position.X, BoundsMin.X, BoundsMax.X)) << 0) |
+			(Spread(Quantize(Position.Y, BoundsMin.Y, BoundsMax.Y)) << 1) |
+			(Spread(Quantize(Position.Z, BoundsMin.Z, BoundsMax.Z)) << 2);
+	}
 
-		TVector<CSceneObject*> ObjectPointers;
-		
-	protected:
+	void ObjectTable::ComputeBounds()
+	{
+		BoundsMin = Vector3f(MAX_FLT, MAX_FLT, MAX_FLT);
+		BoundsMax = Vector3f(-MAX_FLT, -MAX_FLT, -MAX_FLT);
 
-		Allocator ObjectHeap;
+		for (const ObjectTableEntry & Entry : Entries)
+		{
+			BoundsMin = BoundsMin.ComponentMin(Entry.Position);
+			BoundsMax = BoundsMax.ComponentMax(Entry.Position);
+		}
+	}
 
-	public:
+	void ObjectTable::ComputeTypeRanges()
+	{
+		TypeRanges.clear();
 
-		void Add(CSceneObject * Object)
+		for (Uint32 N = 0; N < Entries.size(); ++N)
 		{
+			if (TypeRanges.empty() || TypeRanges.back().Type != Entries[N].Type)
+			{
+				TypeRanges.push_back({ Entries[N].Type, N, 0 });
+			}
 
+			TypeRanges.back().Count++;
 		}
-	};
+	}
 
-	void ObjectTableLoader::LoadTable(ObjectTable & Table)
+	void ObjectTable::Sort()
 	{
-		ObjectContainer Container;
-		ObjectTypeStorage Storage;
+		ComputeBounds();
 
-		const auto & Entries = Table.GetEntries();
+		TVector<TPair<Uint64, Uint32> > Keys(Entries.size());
 
-		try
+		for (Uint32 N = 0; N < Entries.size(); ++N)
+		{
+			Keys[N].first	= (static_cast<Uint64>(Entries[N].Type) << 32) | GetMortonCode(Entries[N].Position, BoundsMin, BoundsMax);
+			Keys[N].second	= N;
+		}
+
+		tbb::parallel_sort(Keys.begin(), Keys.end());
+
+		TVector<ObjectTableEntry> Sorted(Entries.size());
+
+		for (Uint32 N = 0; N < Keys.size(); ++N)
+		{
+			Sorted[N] = Entries[Keys[N].second];
+		}
+
+		Entries.swap(Sorted);
+
+		ComputeTypeRanges();
+	}
+
+	ErrorCode ObjectTable::Read(const Byte * Data, const size_t Size)
+	{
+		if (Size >= sizeof(ObjectTableHeader) && reinterpret_cast<const ObjectTableHeader*>(Data)->Magic == ObjectTableHeader::Signature)
 		{
-			ObjectTypeInfo * Info;
+			ObjectTableHeader Header;
+			{
+				std::memcpy(&Header, Data, sizeof(Header));
+			}
+
+			if (Header.Version != ObjectTableHeader::CurrentVersion)
+			{
+				CErrorLog::Log<LogError>() << "Unsupported object table version: " << Header.Version;
+				return E_FAIL;
+			}
+
+			const size_t RangesSize		= Header.NumTypeRanges * sizeof(ObjectTableTypeRange);
+			const size_t EntriesSize	= Header.NumEntries * sizeof(ObjectTableEntry);
 
-			for (auto Iter = Entries.begin(); Iter != Entries.end(); ++Iter)
+			if (Size != sizeof(ObjectTableHeader) + RangesSize + EntriesSize)
 			{
-				switch (Iter->Type)
+				CErrorLog::Log<LogError>() << "Invalid object table size: " << Size;
+				return E_FAIL;
+			}
+
+			const ObjectTableTypeRange	* Ranges	= reinterpret_cast<const ObjectTableTypeRange*>(Data + sizeof(ObjectTableHeader));
+			const ObjectTableEntry		* Records	= reinterpret_cast<const ObjectTableEntry*>(Data + sizeof(ObjectTableHeader) + RangesSize);
+
+			for (Uint32 N = 0; N < Header.NumTypeRanges; ++N)
+			{
+				const ObjectTableTypeRange & Range = Ranges[N];
+
+				if (Range.First > Header.NumEntries || Range.Count > Header.NumEntries - Range.First)
 				{
-					case ObjectTypeSpeedTree:
+					CErrorLog::Log<LogError>() << "Invalid object table type range: " << N;
+					return E_FAIL;
+				}
+
+				for (Uint32 Entry = Range.First; Entry < Range.First + Range.Count; ++Entry)
+				{
+					if (Records[Entry].Type != Range.Type)
 					{
-						ObjectFactory::CreateMultiple(Storage.AddObjectType<SpeedTreeTypeInfo>(Iter->Id), Iter, Entries.end(), Container);
+						CErrorLog::Log<LogError>() << "Object table entry " << Entry << " does not match the type of range " << N;
+						return E_FAIL;
 					}
-
-					break;
 				}
 			}
+
+			if (!Entries.empty())
+			{
+				// Merging tables invalidates the stored order.
+
+				AddEntries(Records, Header.NumEntries);
+				Sort();
+
+				return S_OK;
+			}
+
+			AddEntries(Records, Header.NumEntries);
+
+			TypeRanges.assign(Ranges, Ranges + Header.NumTypeRanges);
+
+			BoundsMin = Header.BoundsMin;
+			BoundsMax = Header.BoundsMax;
+
+			return S_OK;
 		}
-		catch (const Exception & Exception)
+
+		if (Size % sizeof(ObjectTableEntry) != 0)
 		{
-			CErrorLog::Log<LogException>(Exception.what(), CErrorLog::EndLine);
+			CErrorLog::Log<LogError>() << "Invalid object table size: " << Size;
+			return E_FAIL;
 		}
+
+		AddEntries(reinterpret_cast<const ObjectTableEntry*>(Data), Size / sizeof(ObjectTableEntry));
+		Sort();
+
+		return S_OK;
 	}
 
-	inline void ObjectTable::Sort()
+	void ObjectTable::Write(TVector<Byte> & Output)
 	{
-		std::sort(
-			std::begin(Entries),
-			std::end(Entries),
-			[this](
-				const ObjectTableEntry & Lhs,
-				const ObjectTableEntry & Rhs)
-			{
-				return Lhs.Type < Rhs.Type;
-			}
-		);
+		Sort();
+
+		ObjectTableHeader Header;
+		{
+			Header.Magic			= ObjectTableHeader::Signature;
+			Header.Version			= ObjectTableHeader::CurrentVersion;
+			Header.NumEntries		= static_cast<Uint32>(Entries.size());
+			Header.NumTypeRanges	= static_cast<Uint32>(TypeRanges.size());
+			Header.BoundsMin		= BoundsMin;
+			Header.BoundsMax		= BoundsMax;
+		}
+
+		const size_t RangesSize		= TypeRanges.size() * sizeof(ObjectTableTypeRange);
+		const size_t EntriesSize	= Entries.size() * sizeof(ObjectTableEntry);
+
+		Output.resize(sizeof(Header) + RangesSize + EntriesSize);
+
+		std::memcpy(Output.data(), &Header, sizeof(Header));
+		std::memcpy(Output.data() + sizeof(Header), TypeRanges.data(), RangesSize);
+		std::memcpy(Output.data() + sizeof(Header) + RangesSize, Entries.data(), EntriesSize);
 	}
-}
+}
\ No newline at end of file
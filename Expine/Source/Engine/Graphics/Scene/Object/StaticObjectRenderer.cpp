@@ -0,0 +1,282 @@
+#include "Precompiled.h"
+
+#include "Scene/Object/StaticObjectRenderer.h"
+#include "Scene/SceneRenderer.h"
+#include "Scene/SceneArea.h"
+#include "Scene/SceneView.h"
+#include "Pipeline/PSOStaticMesh.h"
+#include "Resource/Texture/TextureCache.h"
+
+namespace D3D
+{
+	// Buffer uploads require the data to be strictly smaller than the buffer.
+
+	static inline size_t GetBufferCapacity(const size_t Count)
+	{
+		size_t Capacity = 64;
+
+		while (Capacity <= Count)
+		{
+			Capacity <<= 1;
+		}
+
+		return Capacity;
+	}
+
+	CStaticObjectRenderer::CStaticObjectRenderer(const CSceneRenderer * pSceneRenderer)
+	{
+		SceneRenderer	= pSceneRenderer;								Ensure(SceneRenderer);
+		Scene			= pSceneRenderer->GetScene();					Ensure(Scene);
+		CmdListCtx		= SceneRenderer->GetGeometryCommandContext();	Ensure(CmdListCtx);
+	}
+
+	ErrorCode CStaticObjectRenderer::CreateGeometryBuffers()
+	{
+		ErrorCode Error;
+
+		UniquePointer<CVertexBuffer> VertexBuffer = new CVertexBuffer(new GrpVertexBufferDescriptor(sizeof(StaticMeshVertex), GetBufferCapacity(Builder.GetGeometryVertices().size())));
+		{
+			if ((Error = VertexBuffer->Create(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)))
+			{
+				return Error;
+			}
+		}
+
+		UniquePointer<CIndexBuffer> IndexBuffer = new CIndexBuffer(new GrpIndexBufferDescriptor(DXGI_FORMAT_R32_UINT, GetBufferCapacity(Builder.GetGeometryIndices().size())));
+		{
+			if ((Error = IndexBuffer->Create(D3D12_RESOURCE_STATE_INDEX_BUFFER)))
+			{
+				return Error;
+			}
+		}
+
+		GeometryVertexBuffer	= VertexBuffer.Detach();
+		GeometryIndexBuffer		= IndexBuffer.Detach();
+
+		return S_OK;
+	}
+
+	ErrorCode CStaticObjectRenderer::ReserveInstances(const size_t NumInstances)
+	{
+		if (NumInstances < InstanceCapacity)
+		{
+			return S_OK;
+		}
+
+		ErrorCode Error;
+
+		const size_t Capacity = GetBufferCapacity(NumInstances);
+
+		UniquePointer<CVertexBuffer> Buffer = new CVertexBuffer(new GrpVertexBufferDescriptor(sizeof(InstanceTransform), Capacity));
+		{
+			if ((Error = Buffer->Create(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)))
+			{
+				return Error;
+			}
+		}
+
+		InstanceBuffer		= Buffer.Detach();
+		InstanceCapacity	= Capacity;
+
+		return S_OK;
+	}
+
+	ErrorCode CStaticObjectRenderer::ReserveCommands(const size_t NumCommands)
+	{
+		if (NumCommands < CommandCapacity)
+		{
+			return S_OK;
+		}
+
+		ErrorCode Error;
+
+		const size_t Capacity = GetBufferCapacity(NumCommands);
+
+		UniquePointer<CCommandBuffer> Buffer = new CCommandBuffer(new GrpCommandBufferDescriptor(sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), Capacity));
+		{
+			if ((Error = Buffer->Create(D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)))
+			{
+				return Error;
+			}
+		}
+
+		CommandBuffer	= Buffer.Detach();
+		CommandCapacity	= Capacity;
+
+		return S_OK;
+	}
+
+	ErrorCode CStaticObjectRenderer::UploadData()
+	{
+		ErrorCode Error;
+
+		const TVector<StaticMeshVertex>	& Vertices	= Builder.GetGeometryVertices();
+		const TVector<Uint32>			& Indices	= Builder.GetGeometryIndices();
+
+		if (GeometryRevision != Builder.GetGeometryRevision())
+		{
+			if ((Error = CreateGeometryBuffers()))
+			{
+				return Error;
+			}
+
+			GeometryVertexBuffer->GetBufferData().UploadData(Vertices.data(), Vertices.size(), CmdListCtx.GetRef());
+			GeometryIndexBuffer->GetBufferData().UploadData(Indices.data(), Indices.size(), CmdListCtx.GetRef());
+
+			GeometryRevision = Builder.GetGeometryRevision();
+		}
+
+		const TVector<InstanceTransform> & Instances = Builder.GetInstances();
+
+		if ((Error = ReserveInstances(Instances.size())))
+		{
+			return Error;
+		}
+
+		if ((Error = ReserveCommands(Commands.size())))
+		{
+			return Error;
+		}
+
+		InstanceBuffer->GetBufferData().UploadData(Instances.data(), Instances.size(), CmdListCtx.GetRef());
+		CommandBuffer->GetBufferData().UploadData(Commands.data(), Commands.size(), CmdListCtx.GetRef());
+
+		return S_OK;
+	}
+
+	const DescriptorHeapRange & CStaticObjectRenderer::UpdateMaterialDescriptors(const Uint32 Material, Uint32 & Flags)
+	{
+		Flags = 0;
+
+		auto Iter = MaterialDescriptors.find(Material);
+
+		if (Iter == MaterialDescriptors.end())
+		{
+			Iter = MaterialDescriptors.insert(std::make_pair(Material, CmdListCtx->OccupyViewDescriptorRange(NumMaterialTextures))).first;
+		}
+
+		// Static objects register their static materials with the builder.
+
+		const KMaterialStatic * Source = static_cast<const KMaterialStatic*>(Builder.GetMaterial(Material));
+
+		if (!Source)
+		{
+			return Iter->second;
+		}
+
+		const ShaderTextureInfo * Textures[NumMaterialTextures] =
+		{
+			Source->GetTexture(MaterialTextureDiffuse),
+			Source->GetTexture(MaterialTextureNormal)
+		};
+
+		const ShaderTextureInfo * Bound = Textures[MaterialTextureDiffuse] ? Textures[MaterialTextureDiffuse] : Textures[MaterialTextureNormal];
+
+		if (!Bound)
+		{
+			return Iter->second;
+		}
+
+		// Missing textures repeat a bound view, the flags keep the shader from sampling them.
+		// Streamed textures recreate their view in place, so the copies are refreshed every frame.
+
+		DescriptorHeapEntry Entries[NumMaterialTextures];
+
+		for (Uint32 N = 0; N < NumMaterialTextures; ++N)
+		{
+			Entries[N] = Textures[N] ? Textures[N]->HeapEntry : Bound->HeapEntry;
+		}
+
+		const DescriptorHeapRange & Range = Iter->second;
+		{
+			Range.DescriptorHeap->CopyDescriptorHeapEntries(Range, Entries);
+		}
+
+		if (Textures[MaterialTextureDiffuse])
+		{
+			Flags |= Pipelines::StaticMesh::MaterialDiffuse;
+		}
+
+		if (Textures[MaterialTextureNormal])
+		{
+			Flags |= Pipelines::StaticMesh::MaterialNormal;
+		}
+
+		if (Source->Material && Source->Material->BlendMode == BlendMasked)
+		{
+			Flags |= Pipelines::StaticMesh::MaterialMasked;
+		}
+
+		return Range;
+	}
+
+	void CStaticObjectRenderer::Update()
+	{
+		Builder.Reset();
+		Commands.clear();
+		MaterialRanges.clear();
+
+		const CSceneArea * Area = Scene->GetArea();
+
+		if (!Area)
+		{
+			return;
+		}
+
+		const CSceneView & View = Scene->GetView();
+
+		// Half the viewport height over the tangent of half the vertical field of view.
+
+		AreaStreamingView StreamingView;
+		{
+			StreamingView.Origin			= View.GetViewSetup().ViewOrigin;
+			StreamingView.ProjectionScale	= 0.5f * static_cast<Float>(View.GetSize().Y) * View.GetViewSetup().ProjectionUnadjustedMatrix.MatrixArray[1][1];
+		}
+
+		Area->GatherStaticInstances(View.GetViewFrustum(), Builder, 0, &StreamingView);
+
+		Builder.Build();
+		Builder.EmitCommands(Commands, &MaterialRanges);
+	}
+
+	void CStaticObjectRenderer::Render()
+	{
+		const Pipelines::StaticMesh::PipelineGeometry * Pipeline = Pipelines::StaticMesh::PipelineGeometry::Instance_Pointer();
+
+		if (Commands.empty() || !Pipeline || !Pipeline->IsAvailable())
+		{
+			return;
+		}
+
+		ThrowOnError(UploadData());
+
+		const RGrpCommandList & CmdList = CmdListCtx.GetRef();
+
+		Pipeline->Apply(CmdListCtx);
+		{
+			CmdListCtx->SetGraphicsRootDescriptorTable(Pipelines::StaticMesh::PipelineGeometry::SceneConstants, DIDSceneCBV);
+
+			const RRenderTargetView * RenderTargets[] =
+			{
+				Scene->GetColorRTV().Get(),
+				Scene->GetNormalRTV().Get()
+			};
+
+			CmdList.SetRenderTargets<_countof(RenderTargets)>(RenderTargets, Scene->GetDepthDSV().GetRef());
+			CmdList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+			CmdList.SetVertexBuffer(GeometryVertexBuffer.GetRef(), Pipelines::StaticMesh::SlotGeometry);
+			CmdList.SetVertexBuffer(InstanceBuffer.GetRef(), Pipelines::StaticMesh::SlotInstances);
+			CmdList.SetIndexBuffer(GeometryIndexBuffer.GetRef());
+
+			for (const InstanceMaterialRange & Range : MaterialRanges)
+			{
+				Uint32 Flags;
+
+				CmdListCtx->SetGraphicsRootDescriptorTable(Pipelines::StaticMesh::PipelineGeometry::MaterialTextures, UpdateMaterialDescriptors(Range.Material, Flags));
+				CmdList.SetGraphicsRoot32BitConstants(Pipelines::StaticMesh::PipelineGeometry::MaterialConstants, 1, &Flags);
+				CmdList.ExecuteIndirect(Range.NumCommands, CommandBuffer.Get(), Range.FirstCommand * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+			}
+		}
+	}
+}
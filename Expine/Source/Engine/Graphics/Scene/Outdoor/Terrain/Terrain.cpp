@@ -591,12 +591,8 @@ namespace D3D
 		{
 			ErrorCode Error;
 
-			const ShaderTextureInfo * RainDropNormalTextureInfo = CTextureManager::Instance().GetShaderTextureInfo(L"RainDrop_N.dds");
-
-			if (RainDropNormalTextureInfo)
+			if (CTextureManager::Instance().GetShaderTextureInfo(L"RainDrop_N.dds", TexInfoRainDrop))
 			{
-				TexInfoRainDrop = *RainDropNormalTextureInfo;
-
 				RDescriptorHeap::CopyInto<1, 1>
 				(
 					&DescriptorHeapRange(TexInfoRainDrop.HeapEntry), &DescriptorHeapRange(ViewDescriptorHeap.Get(), Pipelines::Terrain::SRV_Normal)
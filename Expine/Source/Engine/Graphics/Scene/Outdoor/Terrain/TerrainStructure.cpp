@@ -317,8 +317,24 @@ namespace D3D
 
 			if (Height)
 			{
+				// Indices of the current and the next row, decoded a row at a time.
+
+				TVector<Uint8> TextureRows(VertexCountX * 2);
+
+				Uint8 * TextureRow		= TextureRows.data();
+				Uint8 * TextureRowTop	= TextureRows.data() + VertexCountX;
+
+				TextureMap.DecodeLinear(Offset, VertexCountX, TextureRowTop);
+
 				for (Int Z = 0; Z < VertexCountZ; ++Z)
 				{
+					std::swap(TextureRow, TextureRowTop);
+
+					if (Z + 1 < VertexCountZ)
+					{
+						TextureMap.DecodeLinear(Offset + (Z + 1) * VertexCountX, VertexCountX, TextureRowTop);
+					}
+
 					for (Int X = 0; X < VertexCountX; ++X)
 					{
 						Vertices[O].Position = Vector3f
@@ -338,7 +354,7 @@ namespace D3D
 							TextureV
 						);
 
-						const auto & Iter = TextureSet.at(TextureMap[O]);
+						const auto & Iter = TextureSet.at(TextureRow[X]);
 
 						Vertices[O].AtlasIndices[TextureColor][0] = Iter.Offset;
 						Vertices[O].AtlasIndices[TextureNormal][0] = Iter.OffsetNormal;
@@ -346,7 +362,7 @@ namespace D3D
 
 						if (StartX + X + 1 < VertexCountX)
 						{
-							const auto & IterRight = TextureSet.at(TextureMap[O + 1]);
+							const auto & IterRight = TextureSet.at(TextureRow[X + 1]);
 
 							Vertices[O].AtlasIndices[TextureColor][1] = IterRight.Offset;
 							Vertices[O].AtlasIndices[TextureNormal][1] = IterRight.OffsetNormal;
@@ -361,7 +377,7 @@ namespace D3D
 
 						if (StartZ + Z + 1 < VertexCountZ)
 						{
-							const auto & IterTop = TextureSet.at(TextureMap[O + VertexCountX]);
+							const auto & IterTop = TextureSet.at(TextureRowTop[X]);
 
 							Vertices[O].AtlasIndices[TextureColor][2] = IterTop.Offset;
 							Vertices[O].AtlasIndices[TextureNormal][2] = IterTop.OffsetNormal;
@@ -377,7 +393,7 @@ namespace D3D
 						if (StartZ + Z + 1 < VertexCountZ && 
 							StartX + X + 1 < VertexCountX)
 						{
-							const auto & IterTopRight = TextureSet.at(TextureMap[O + VertexCountX + 1]);
+							const auto & IterTopRight = TextureSet.at(TextureRowTop[X + 1]);
 
 							Vertices[O].AtlasIndices[TextureColor][3] = IterTopRight.Offset;
 							Vertices[O].AtlasIndices[TextureNormal][3] = IterTopRight.OffsetNormal;
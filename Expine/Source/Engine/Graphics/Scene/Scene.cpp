@@ -493,6 +493,13 @@ namespace D3D
 			Properties.NextShadowMapRenderTimePoint
 		);
 
+		// Static objects of a loading area show up with the frame after their tables arrived.
+
+		if (Area)
+		{
+			Area->UpdateLoad();
+		}
+
 		UpdateView();
 		UpdateConstants();
 		{
@@ -2,71 +2,256 @@
 
 #include "Scene/SceneArea.h"
 #include "Scene/Object/ObjectTable.h"
+#include "Scene/Object/StaticObject.h"
 
-#include "Utils/Database/SQLite.h"
+#include "Utils/Database/ConnectionPool.h"
+#include "Utils/File/ConfigStore.h"
 
 namespace D3D
 {
 	ErrorCode CSceneArea::LoadStaticObjects()
 	{
-		return ErrorCode();
+		ErrorCode Error;
+
+		StaticObjects.Clear();
+
+		if ((Error = ObjectTableLoader::Instance().LoadTable(StaticObjectTable, StaticObjects, StaticObjectHandles)))
+		{
+			return Error;
+		}
+
+		// The index user data is the position in StaticObjectHandles.
+
+		TVector<BoundingBox>	ObjectBounds;
+		TVector<Uint32>			ObjectIndices;
+
+		ObjectBounds.reserve(StaticObjectHandles.size());
+		ObjectIndices.reserve(StaticObjectHandles.size());
+
+		BoundingBox AreaBounds;
+
+		for (Uint32 N = 0; N < StaticObjectHandles.size(); ++N)
+		{
+			// The static arena only holds static objects.
+
+			const CStaticObject * Object = static_cast<const CStaticObject*>(StaticObjects.Resolve(StaticObjectHandles[N]));
+
+			if (Object)
+			{
+				ObjectBounds.push_back(Object->GetBounds());
+				ObjectIndices.push_back(N);
+
+				AreaBounds.Add(ObjectBounds.back());
+			}
+		}
+
+		// The tree spans all objects, later insertions outside of it overflow.
+
+		CLooseQuadTree::InitializeOptions IndexOptions;
+
+		if (AreaBounds.IsValid())
+		{
+			IndexOptions.Origin	= Vector2f(AreaBounds.Min.X, AreaBounds.Min.Y);
+			IndexOptions.Size	= Vector2f(
+				Math::Max(AreaBounds.Max.X - AreaBounds.Min.X, 1.0f),
+				Math::Max(AreaBounds.Max.Y - AreaBounds.Min.Y, 1.0f));
+		}
+
+		StaticObjectIndex.Initialize(IndexOptions);
+		StaticObjectIndex.InsertBatch(ObjectBounds.data(), ObjectIndices.data(), ObjectBounds.size());
+
+		return S_OK;
+	}
+
+	void CSceneArea::GatherStaticInstances(const ViewFrustum & Frustum, CInstanceBatchBuilder & Builder, const Uint32 Lod, const AreaStreamingView * StreamingView) const
+	{
+		StaticObjectIndex.QueryFrustum(Frustum, [&](const Uint32 Index)
+		{
+			const ObjectHandle Handle = StaticObjectHandles[Index];
+
+			const CStaticObject * Object = static_cast<const CStaticObject*>(StaticObjects.Resolve(Handle));
+
+			if (!Object)
+			{
+				return true;
+			}
+
+			if (!StreamingView)
+			{
+				Object->GatherInstances(Builder, Lod, Handle.Value);
+				return true;
+			}
+
+			const BoundingBox Bounds = Object->GetBounds();
+
+			// Inside the bounds the object is taken to cover the whole view.
+
+			const Float Radius		= Math::Max(Bounds.GetExtent().Size() * 0.5f, SMALL_NUMBER);
+			const Float Distance	= Math::Max((Bounds.GetCenter() - StreamingView->Origin).Size(), Radius);
+			const Float ScreenSize	= 2.0f * Radius * StreamingView->ProjectionScale / Distance;
+
+			Object->GatherInstances(Builder, Math::Max(Lod, StreamingView->SelectLod(ScreenSize)), Handle.Value);
+			Object->RequestTextureMips(ScreenSize);
+
+			return true;
+		});
 	}
 
 	ErrorCode CSceneArea::LoadDynamicObjects()
 	{
-		return ErrorCode();
+		// Areas carry no dynamic objects yet, they are inserted at runtime
+		// and become visible to queries with the next commit.
+
+		DynamicObjectIndex.Clear();
+		DynamicObjectIndex.Commit(true);
+
+		return S_OK;
+	}
+
+	const String & GetGameDatabasePath()
+	{
+		static const String Path = []()
+		{
+			File::CConfigStore::InitializeOptions Options;
+			{
+				Options.UseCache = false;
+			}
+
+			File::CConfigStore Store;
+			{
+				Store.Initialize(Options);
+			}
+
+			const File::TConfigTablePtr Config = Store.Load(L"Engine.cfg");
+
+			String Result;
+
+			if (!Config || !Config->Get("GameDatabase", Result))
+			{
+				Result = "Game.db";
+
+				CErrorLog::Log<LogWarning>() << "No GameDatabase in Engine.cfg, using: " << Result;
+			}
+
+			return Result;
+		}();
+
+		return Path;
+	}
+
+	CSceneArea::~CSceneArea()
+	{
+		// The reader writes into the area until the tables are read.
+
+		if (PendingTables.valid())
+		{
+			PendingTables.wait();
+		}
 	}
 
 	ErrorCode CSceneArea::Load(const AreaLoadParameters & Parameters)
 	{
-		SharedPointer<Database::SQLite::CDatabase> DB = Database::SQLite::CDatabaseManager::Instance().OpenDatabase(L"C:\\Users\\a\\Documents\\Navicat\\MySQL\\servers\\d\\Game.db");
+		// Nothing is written, the pool opens readers only and leaves the journal mode of the file alone.
+
+		SharedPointer<Database::SQLite::CConnectionPool> Pool = Database::SQLite::CConnectionPoolManager::Instance().OpenPool(GetGameDatabasePath(), true);
 
-		StringStream Query;
+		if (!Pool)
 		{
-			Query << "SELECT * FROM ObjectTable WHERE AreaId = " << Parameters.AreaId;
+			return ERROR_DATABASE_DOES_NOT_EXIST;
 		}
 
-		Database::SQLite::DataSet ResultSet;
-		
-		if (DB->ExecutePrepared(Query.str(), ResultSet) == SQLITE_OK && !ResultSet.empty())
+		// A load still reading into the tables finishes first.
+
+		if (PendingTables.valid())
 		{
-			Uint32 ObjectTableId;
-			TVector<Uint8> ObjectTableData;
+			PendingTables.wait();
+		}
 
-			auto Data = ResultSet.Find("Data");
+		const UINT AreaId = Properties.AreaId = Parameters.AreaId;
+
+		// The rows are read on a pool reader and Load returns right away, the objects are
+		// created by UpdateLoad once the query finished. Areas loading at the same time do
+		// not wait on one connection. The blob is read in place, no copy of the table data is made.
+
+		PendingTables = Pool->ReadAsync([this, AreaId](Database::SQLite::CDatabase & Connection)
+		{
+			Database::SQLite::CCursor Cursor = Connection.Query("SELECT ObjectTableId, Data FROM ObjectTable WHERE AreaId = ?", AreaId);
 
-			if (Data)
+			size_t NumTables = 0;
+
+			while (Cursor.Next())
 			{
-				for (size_t N = 0; N < Data->size(); ++N)
+				NumTables++;
+
+				const Database::SQLite::CRow & Row = Cursor.GetRow();
+
+				Uint32 ObjectTableId;
+
+				if (!Row.Get(0, ObjectTableId))
 				{
-					if (!ResultSet.GetRecordAs("ObjectTableId", ObjectTableId, N))
-					{
-						CErrorLog::Log<LogError>() << "No ObjectTable.Id for AreaId: " << Parameters.AreaId;
-						continue;
-					}
-
-					auto ObjectTableData = Data->at(N);
-					auto ObjectTableSize = ObjectTableData.size();
-
-					if (ObjectTableSize % sizeof(ObjectTable) != 0)
-					{
-						CErrorLog::Log<LogError>() << "Invalid ObjectTable.Size for ObjectTable.Id: " << ObjectTableId;
-						continue;
-					}
-
-					StaticObjectTable.AddEntries(reinterpret_cast<const ObjectTableEntry*>(
-						ObjectTableData.data()), 
-						ObjectTableData.size() / sizeof(ObjectTable));
+					CErrorLog::Log<LogError>() << "No ObjectTable.Id for AreaId: " << AreaId;
+					continue;
+				}
+
+				const Database::SQLite::BlobView ObjectTableData = Row.GetBlobView(1);
+
+				if (ObjectTableData.Data == NULL)
+				{
+					CErrorLog::Log<LogError>() << "No ObjectTable.Data for ObjectTable.Id: " << ObjectTableId;
+					continue;
+				}
+
+				if (StaticObjectTable.Read(ObjectTableData.Data, ObjectTableData.Size) != S_OK)
+				{
+					CErrorLog::Log<LogError>() << "Invalid ObjectTable.Data for ObjectTable.Id: " << ObjectTableId;
+					continue;
 				}
 			}
-			else
+
+			if (Cursor.GetErrorCode() == SQLITE_OK && NumTables == 0)
 			{
-				CErrorLog::Log<LogError>() << "No ObjectTable.Data for AreaId: " << Parameters.AreaId;
+				CErrorLog::Log<LogInfo>() << "No ObjectTable for AreaId: " << AreaId;
 			}
+
+			return Cursor.GetErrorCode();
+		});
+
+		return LoadDynamicObjects();
+	}
+
+	ErrorCode CSceneArea::UpdateLoad()
+	{
+		if (!PendingTables.valid() || PendingTables.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return S_OK;
 		}
-		else
+
+		int QueryResult;
+
+		// The future is broken when the pool stops before the query ran.
+
+		try
+		{
+			QueryResult = PendingTables.get();
+		}
+		catch (const std::future_error &)
+		{
+			QueryResult = SQLITE_ABORT;
+		}
+
+		if (QueryResult != SQLITE_OK)
+		{
+			CErrorLog::Log<LogError>() << "Unable to query ObjectTable for AreaId: " << Properties.AreaId;
+		}
+
+		ErrorCode Error;
+
+		// All tables of the area are merged, objects are created once.
+
+		if ((Error = LoadStaticObjects()))
 		{
-			CErrorLog::Log<LogInfo>() << "No ObjectTable for AreaId: " << Parameters.AreaId;
+			CErrorLog::Log<LogError>() << "Unable to create the static objects of AreaId: " << Properties.AreaId;
+			return Error;
 		}
 
 		return S_OK;
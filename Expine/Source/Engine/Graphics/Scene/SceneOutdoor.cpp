@@ -3,6 +3,8 @@
 #include "Scene/SceneRenderer.h"
 #include "Scene/SceneOutdoor.h"
 
+#include <codecvt>
+
 namespace D3D
 {
 	ErrorCode CSceneOutdoor::CreateTerrain()
@@ -37,7 +39,9 @@ namespace D3D
 	{
 		ErrorCode Error;
 
-		SharedPointer<Database::SQLite::CDatabase> DB = Database::SQLite::CDatabaseManager::Instance().OpenDatabase(L"C:\\Users\\a\\Documents\\Navicat\\MySQL\\servers\\d\\Game.db");
+		const WString DatabasePath = std::wstring_convert<std::codecvt_utf8<wchar_t> >().from_bytes(GetGameDatabasePath());
+
+		SharedPointer<Database::SQLite::CDatabase> DB = Database::SQLite::CDatabaseManager::Instance().OpenDatabase(DatabasePath);
 
 		if (!DB)
 		{
@@ -54,101 +58,111 @@ namespace D3D
 			return Error;
 		}
 
-		StringStream Query;
-		{
-			Query << "SELECT * FROM Maps WHERE ID = " << MapID;
-		}
+		Properties.TerrainExists	= FALSE;
+		Properties.AtmosphereExists = FALSE;
 
-		Database::SQLite::DataSet
-			ResultSetMap,
-			ResultSetTerrain,
-			ResultSetAtmosphere;
+		bool TerrainReferenced		= false;
+		bool AtmosphereReferenced	= false;
+
+		// Cursors hold the database until they are closed, each one lives in its own scope.
 
-		if (DB->ExecutePrepared(Query.str(), ResultSetMap) != SQLITE_OK)
 		{
-			return ERROR_DS_DATABASE_ERROR;
-		}
+			Database::SQLite::CCursor MapCursor = DB->Query("SELECT * FROM Maps WHERE ID = ?", MapID);
 
-		Properties.TerrainExists	= FALSE;
-		Properties.AtmosphereExists = FALSE;
+			if (MapCursor.Next())
+			{
+				const Database::SQLite::CRow & Row = MapCursor.GetRow();
 
-		if (!ResultSetMap.empty())
+				TerrainReferenced =
+					Row.Get("Width",				Properties.TerrainProperties.TerrainSize.X)		&&
+					Row.Get("Height",				Properties.TerrainProperties.TerrainSize.Y)		&&
+					Row.Get("ScaleFactor",			Properties.TerrainProperties.ScaleFactor)		&&
+					Row.Get("ScaleFactorHeight",	Properties.TerrainProperties.ScaleFactorHeight) &&
+					Row.Get("TerrainID",			Properties.TerrainProperties.TerrainID);
+
+				AtmosphereReferenced =
+					Row.Get("AtmosphereID",			Properties.AtmosphereProperties.AtmosphereID);
+			}
+
+			if (MapCursor.GetErrorCode() != SQLITE_OK)
+			{
+				return ERROR_DS_DATABASE_ERROR;
+			}
+		}
+
+		if (TerrainReferenced)
 		{
-			if (ResultSetMap.GetRecordAs("Width",				Properties.TerrainProperties.TerrainSize.X)		&&
-				ResultSetMap.GetRecordAs("Height",				Properties.TerrainProperties.TerrainSize.Y)		&&
-				ResultSetMap.GetRecordAs("ScaleFactor",			Properties.TerrainProperties.ScaleFactor)		&&
-				ResultSetMap.GetRecordAs("ScaleFactorHeight",	Properties.TerrainProperties.ScaleFactorHeight) &&
-				ResultSetMap.GetRecordAs("TerrainID",			Properties.TerrainProperties.TerrainID))
+			String HeightMapFormat;
+
+			bool TerrainFound = false;
+
 			{
-				Query = StringStream();
+				Database::SQLite::CCursor TerrainCursor = DB->Query("SELECT * FROM Terrain WHERE ID = ?", Properties.TerrainProperties.TerrainID);
+
+				if (TerrainCursor.Next())
 				{
-					Query << "SELECT * FROM Terrain WHERE ID = " << Properties.TerrainProperties.TerrainID;
+					const Database::SQLite::CRow & Row = TerrainCursor.GetRow();
+
+					TerrainFound =
+						Row.Get("TextureSet",		Properties.TerrainProperties.TextureSet)	&&
+						Row.Get("TextureMap",		Properties.TerrainProperties.TextureMap)	&&
+						Row.Get("HeightMap",		Properties.TerrainProperties.HeightMap)		&&
+						Row.Get("Name",				Properties.TerrainProperties.Name)			&&
+						Row.Get("HeightFormat",		HeightMapFormat);
+
+					Row.Get("ColorMap",		Properties.TerrainProperties.ColorMap);
+					Row.Get("NormalMap",	Properties.TerrainProperties.NormalMap);
 				}
 
-				if (DB->ExecutePrepared(Query.str(), ResultSetTerrain) != SQLITE_OK)
+				if (TerrainCursor.GetErrorCode() != SQLITE_OK)
 				{
 					return ERROR_DS_DATABASE_ERROR;
 				}
+			}
 
-				if (!ResultSetTerrain.empty())
+			if (TerrainFound)
+			{
+				if ((Properties.TerrainProperties.HeightDataType = Terrain::GetHeightMapFormat(HeightMapFormat)) != Terrain::UNKNOWN_FORMAT)
 				{
-					String HeightMapFormat;
-
-					if (ResultSetTerrain.GetRecordAs("TextureSet",		Properties.TerrainProperties.TextureSet)	&&
-						ResultSetTerrain.GetRecordAs("TextureMap",		Properties.TerrainProperties.TextureMap)	&&
-						ResultSetTerrain.GetRecordAs("HeightMap",		Properties.TerrainProperties.HeightMap)		&&
-						ResultSetTerrain.GetRecordAs("Name",			Properties.TerrainProperties.Name)			&&
-						ResultSetTerrain.GetRecordAs("HeightFormat",	HeightMapFormat))
+					auto FileNotExists = [=](const WString& FilePath) -> bool
 					{
-						if ((Properties.TerrainProperties.HeightDataType = Terrain::GetHeightMapFormat(HeightMapFormat)) != Terrain::UNKNOWN_FORMAT)
+						CErrorLog::Log<LogError>() << String::MakeString<String::Whitespace>("LoadMapOutdoor:", String(FilePath.begin(), FilePath.end()), "does not exist") << CErrorLog::EndLine;
+						return false;
+					};
+
+					if (File::DoAllFilesExist(	FileNotExists,
+												Properties.TerrainProperties.TextureMap,
+												Properties.TerrainProperties.TextureSet,
+												Properties.TerrainProperties.HeightMap))
+					{
+						Properties.TerrainExists =
+							Properties.TerrainProperties.TerrainSize.X	> 0 &&
+							Properties.TerrainProperties.TerrainSize.Y	> 0 &&
+							Properties.TerrainProperties.ScaleFactor	> 0;
+
+						if (Properties.TerrainExists)
 						{
-							auto FileNotExists = [=](const WString& FilePath) -> bool
-							{
-								CErrorLog::Log<LogError>() << String::MakeString<String::Whitespace>("LoadMapOutdoor:", String(FilePath.begin(), FilePath.end()), "does not exist") << CErrorLog::EndLine;
-								return false;
-							};
-
-							if (File::DoAllFilesExist(	FileNotExists,
-														Properties.TerrainProperties.TextureMap,
-														Properties.TerrainProperties.TextureSet,
-														Properties.TerrainProperties.HeightMap))
-							{
-								Properties.TerrainExists =
-									Properties.TerrainProperties.TerrainSize.X	> 0 &&
-									Properties.TerrainProperties.TerrainSize.Y	> 0 &&
-									Properties.TerrainProperties.ScaleFactor	> 0;
-
-								if (Properties.TerrainExists)
-								{
-									ResultSetTerrain.GetRecordAs("ColorMap",	Properties.TerrainProperties.ColorMap);
-									ResultSetTerrain.GetRecordAs("NormalMap",	Properties.TerrainProperties.NormalMap);
-
-									Properties.TerrainProperties.TerrainSizeScaled = 
-										Properties.TerrainProperties.TerrainSize * 
-										Properties.TerrainProperties.ScaleFactor;
-								}
-							}
+							Properties.TerrainProperties.TerrainSizeScaled = 
+								Properties.TerrainProperties.TerrainSize * 
+								Properties.TerrainProperties.ScaleFactor;
 						}
 					}
 				}
 			}
+		}
 
-			if (ResultSetMap.GetRecordAs("AtmosphereID", Properties.AtmosphereProperties.AtmosphereID))
-			{
-				Query = StringStream();
-				{
-					Query << "SELECT * FROM Atmosphere WHERE ID = " << Properties.AtmosphereProperties.AtmosphereID;
-				}
+		if (AtmosphereReferenced)
+		{
+			Database::SQLite::CCursor AtmosphereCursor = DB->Query("SELECT ID FROM Atmosphere WHERE ID = ?", Properties.AtmosphereProperties.AtmosphereID);
 
-				if (DB->ExecutePrepared(Query.str(), ResultSetAtmosphere) != SQLITE_OK)
-				{
-					return ERROR_DS_DATABASE_ERROR;
-				}
+			if (AtmosphereCursor.Next())
+			{
+				Properties.AtmosphereExists = TRUE;
+			}
 
-				if (!ResultSetAtmosphere.empty())
-				{
-					Properties.AtmosphereExists = TRUE;
-				}
+			if (AtmosphereCursor.GetErrorCode() != SQLITE_OK)
+			{
+				return ERROR_DS_DATABASE_ERROR;
 			}
 		}
 
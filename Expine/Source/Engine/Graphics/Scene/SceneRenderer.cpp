@@ -7,6 +7,7 @@
 #include "Pipeline/Pipelines.h"
 #include "Pipeline/PSOLine.h"
 #include "Pipeline/PSOTriangle.h"
+#include "Resource/Texture/TextureManager.h"
 
 #include <future>
 
@@ -148,6 +149,14 @@ namespace D3D
 		}
 	}
 
+	void CSceneRenderer::RenderModels()
+	{
+		if (StaticObjectRenderer)
+		{
+			StaticObjectRenderer->Render();
+		}
+	}
+
 	void CSceneRenderer::RenderOcclusionMap()
 	{
 		UINT Frame = Scene->GetProperties().FrameIndexCurrent;
@@ -396,6 +405,7 @@ namespace D3D
 		RenderParts[RENDER_FRUSTUM]		= true;
 		RenderParts[RENDER_GEOMETRY]	= true;
 		RenderParts[RENDER_OUTDOOR]		= true;
+		RenderParts[RENDER_MODELS]		= true;
 		RenderParts[RENDER_SHADOWS]		= true;
 		RenderParts[RENDER_LIGHTS]		= true;
 	}
@@ -612,6 +622,11 @@ namespace D3D
 			// TODO
 		}
 
+		if (RenderParts[RENDER_MODELS])
+		{
+			RenderModels();
+		}
+
 		ThrowOnError(CmdContextGeometry.Close());
 
 		CmdContextGeometry.Finish(Frame);
@@ -684,7 +699,20 @@ namespace D3D
 				
 				break;
 			}
+
+			if (!StaticObjectRenderer)
+			{
+				StaticObjectRenderer = new CStaticObjectRenderer(this);
+			}
+
+			StaticObjectRenderer->Update();
 		}
+
+		// Culling has reported the screen sizes of this frame.
+
+		CTextureManager::Instance().UpdateStreaming();
+
+		Pipelines::UpdatePipelines();
 	}
 
 	void CSceneRenderer::RenderOcclusion()
@@ -0,0 +1,331 @@
+#include "Precompiled.h"
+
+#include "Scene/Spatial/BoundingVolumeHierarchy.h"
+
+namespace D3D
+{
+	CBoundingVolumeHierarchy::CBoundingVolumeHierarchy()
+	{}
+
+	CBoundingVolumeHierarchy::CBoundingVolumeHierarchy(const InitializeOptions & Options) :
+		Options(Options)
+	{
+		this->Options.MaxLeafSize	= Math::Max(Options.MaxLeafSize, 1U);
+		this->Options.NumBins		= Math::Clamp(Options.NumBins, 2U, MaxBins);
+	}
+
+	void CBoundingVolumeHierarchy::Clear()
+	{
+		Nodes.clear();
+		Indices.clear();
+		Items.clear();
+		FreeItems.clear();
+		RetiredItems.clear();
+
+		NumItems		= 0;
+		BuildArea		= 0.0f;
+		NeedsRebuild	= false;
+		NeedsRefit		= false;
+	}
+
+	SpatialHandle CBoundingVolumeHierarchy::Insert(const BoundingBox & Bounds, const Uint32 UserData)
+	{
+		SpatialHandle Handle;
+
+		if (!FreeItems.empty())
+		{
+			Handle = FreeItems.back();
+			FreeItems.pop_back();
+		}
+		else
+		{
+			Handle = static_cast<SpatialHandle>(Items.size());
+			Items.emplace_back();
+		}
+
+		Item & Target = Items[Handle];
+		{
+			Target.Bounds	= Bounds;
+			Target.UserData = UserData;
+			Target.Alive	= true;
+		}
+
+		NumItems++;
+		NeedsRebuild = true;
+
+		return Handle;
+	}
+
+	void CBoundingVolumeHierarchy::InsertBatch(const BoundingBox * Bounds, const Uint32 * UserData, const size_t NumNewItems, SpatialHandle * Handles)
+	{
+		Items.reserve(Items.size() + NumNewItems);
+
+		for (size_t N = 0; N < NumNewItems; ++N)
+		{
+			const SpatialHandle Handle = Insert(Bounds[N], UserData[N]);
+
+			if (Handles)
+			{
+				Handles[N] = Handle;
+			}
+		}
+	}
+
+	void CBoundingVolumeHierarchy::Update(const SpatialHandle Handle, const BoundingBox & Bounds)
+	{
+		Items[Handle].Bounds = Bounds;
+		NeedsRefit = true;
+	}
+
+	void CBoundingVolumeHierarchy::Remove(const SpatialHandle Handle)
+	{
+		Item & Target = Items[Handle];
+
+		if (!Target.Alive)
+		{
+			return;
+		}
+
+		Target.Alive = false;
+
+		RetiredItems.push_back(Handle);
+
+		NumItems--;
+		NeedsRebuild = true;
+	}
+
+	void CBoundingVolumeHierarchy::Commit(const bool ForceRebuild)
+	{
+		if (ForceRebuild || NeedsRebuild)
+		{
+			Build();
+			return;
+		}
+
+		if (NeedsRefit)
+		{
+			Refit();
+
+			if (!Nodes.empty() && Nodes[0].Bounds.GetSurfaceArea() > BuildArea * Options.RebuildThreshold)
+			{
+				Build();
+			}
+		}
+	}
+
+	void CBoundingVolumeHierarchy::Build()
+	{
+		Nodes.clear();
+		Indices.clear();
+
+		NeedsRebuild	= false;
+		NeedsRefit		= false;
+
+		// No leaf references removed items anymore, their slots may be reused.
+
+		FreeItems.insert(FreeItems.end(), RetiredItems.begin(), RetiredItems.end());
+		RetiredItems.clear();
+
+		for (Uint32 N = 0; N < Items.size(); ++N)
+		{
+			if (Items[N].Alive)
+			{
+				Indices.push_back(N);
+			}
+		}
+
+		if (Indices.empty())
+		{
+			BuildArea = 0.0f;
+			return;
+		}
+
+		Nodes.reserve(Indices.size() * 2);
+
+		Node & Root = *Nodes.emplace(Nodes.end());
+		{
+			Root.First = 0;
+			Root.Count = static_cast<Uint32>(Indices.size());
+		}
+
+		Subdivide(0, 1);
+
+		BuildArea = Nodes[0].Bounds.GetSurfaceArea();
+	}
+
+	void CBoundingVolumeHierarchy::Subdivide(const Uint32 NodeIndex, const Uint32 Depth)
+	{
+		BoundingBox Bounds;
+		BoundingBox CentroidBounds;
+
+		const Uint32 First = Nodes[NodeIndex].First;
+		const Uint32 Count = Nodes[NodeIndex].Count;
+
+		for (Uint32 N = First; N < First + Count; ++N)
+		{
+			const BoundingBox & ItemBounds = Items[Indices[N]].Bounds;
+
+			Bounds.Add(ItemBounds);
+			CentroidBounds.Add(ItemBounds.GetCenter());
+		}
+
+		Nodes[NodeIndex].Bounds = Bounds;
+
+		if (Count <= Options.MaxLeafSize || Depth + 2 >= MaxStackDepth)
+		{
+			return;
+		}
+
+		struct Bin
+		{
+			BoundingBox Bounds;
+			Uint32		Count = 0;
+		};
+
+		const Uint32 NumBins = Options.NumBins;
+
+		Float	BestCost	= static_cast<Float>(Count) * Bounds.GetSurfaceArea();
+		Int32	BestAxis	= -1;
+		Uint32	BestSplit	= 0;
+
+		const Vector3f CentroidExtent = CentroidBounds.GetExtent();
+
+		for (Int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const Float AxisExtent = CentroidExtent.Component(Axis);
+
+			if (AxisExtent <= SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const Float AxisMin		= CentroidBounds.Min.Component(Axis);
+			const Float AxisScale	= static_cast<Float>(NumBins) / AxisExtent;
+
+			Bin Bins[MaxBins];
+
+			for (Uint32 N = First; N < First + Count; ++N)
+			{
+				const BoundingBox & ItemBounds = Items[Indices[N]].Bounds;
+
+				const Uint32 BinIndex = Math::Min(NumBins - 1, static_cast<Uint32>((ItemBounds.GetCenter().Component(Axis) - AxisMin) * AxisScale));
+
+				Bins[BinIndex].Bounds.Add(ItemBounds);
+				Bins[BinIndex].Count++;
+			}
+
+			// Sweep from the right to collect suffix areas, then evaluate from the left.
+
+			Float	RightArea[MaxBins];
+			Uint32	RightCount[MaxBins];
+
+			BoundingBox Accumulated;
+			Uint32		AccumulatedCount = 0;
+
+			for (Uint32 N = NumBins - 1; N > 0; --N)
+			{
+				Accumulated.Add(Bins[N].Bounds);
+				AccumulatedCount += Bins[N].Count;
+
+				RightArea[N]	= Accumulated.GetSurfaceArea();
+				RightCount[N]	= AccumulatedCount;
+			}
+
+			Accumulated			= BoundingBox();
+			AccumulatedCount	= 0;
+
+			for (Uint32 N = 0; N < NumBins - 1; ++N)
+			{
+				Accumulated.Add(Bins[N].Bounds);
+				AccumulatedCount += Bins[N].Count;
+
+				if (AccumulatedCount == 0 || RightCount[N + 1] == 0)
+				{
+					continue;
+				}
+
+				const Float Cost =
+					Accumulated.GetSurfaceArea() * AccumulatedCount +
+					RightArea[N + 1] * RightCount[N + 1];
+
+				if (Cost < BestCost)
+				{
+					BestCost	= Cost;
+					BestAxis	= Axis;
+					BestSplit	= N + 1;
+				}
+			}
+		}
+
+		if (BestAxis < 0)
+		{
+			return;
+		}
+
+		const Float AxisMin		= CentroidBounds.Min.Component(BestAxis);
+		const Float AxisScale	= static_cast<Float>(NumBins) / CentroidExtent.Component(BestAxis);
+
+		auto Middle = std::partition(Indices.begin() + First, Indices.begin() + First + Count, [&](const Uint32 Index)
+		{
+			const Uint32 BinIndex = Math::Min(NumBins - 1, static_cast<Uint32>((Items[Index].Bounds.GetCenter().Component(BestAxis) - AxisMin) * AxisScale));
+			{
+				return BinIndex < BestSplit;
+			}
+		});
+
+		const Uint32 LeftCount = static_cast<Uint32>(Middle - (Indices.begin() + First));
+
+		if (LeftCount == 0 || LeftCount == Count)
+		{
+			return;
+		}
+
+		const Uint32 ChildIndex = static_cast<Uint32>(Nodes.size());
+
+		Nodes.emplace_back();
+		Nodes.emplace_back();
+
+		Nodes[ChildIndex + 0].First = First;
+		Nodes[ChildIndex + 0].Count = LeftCount;
+		Nodes[ChildIndex + 1].First = First + LeftCount;
+		Nodes[ChildIndex + 1].Count = Count - LeftCount;
+
+		Nodes[NodeIndex].First = ChildIndex;
+		Nodes[NodeIndex].Count = 0;
+
+		Subdivide(ChildIndex + 0, Depth + 1);
+		Subdivide(ChildIndex + 1, Depth + 1);
+	}
+
+	void CBoundingVolumeHierarchy::Refit()
+	{
+		NeedsRefit = false;
+
+		// Children are always allocated after their parent.
+
+		for (size_t N = Nodes.size(); N-- > 0;)
+		{
+			Node & Current = Nodes[N];
+
+			BoundingBox Bounds;
+
+			if (Current.IsLeaf())
+			{
+				for (Uint32 I = Current.First; I < Current.First + Current.Count; ++I)
+				{
+					if (Items[Indices[I]].Alive)
+					{
+						Bounds.Add(Items[Indices[I]].Bounds);
+					}
+				}
+			}
+			else
+			{
+				Bounds.Add(Nodes[Current.First + 0].Bounds);
+				Bounds.Add(Nodes[Current.First + 1].Bounds);
+			}
+
+			Current.Bounds = Bounds;
+		}
+	}
+}
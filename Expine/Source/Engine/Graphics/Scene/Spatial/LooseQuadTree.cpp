@@ -0,0 +1,398 @@
+#include "Precompiled.h"
+
+#include "Scene/Spatial/LooseQuadTree.h"
+
+#include <tbb/parallel_for.h>
+
+namespace D3D
+{
+	static constexpr size_t GQuadTreeParallelInsertThreshold = 1024;
+
+	CLooseQuadTree::CLooseQuadTree()
+	{
+		Initialize(InitializeOptions());
+	}
+
+	CLooseQuadTree::CLooseQuadTree(const InitializeOptions & Options)
+	{
+		Initialize(Options);
+	}
+
+	void CLooseQuadTree::Initialize(const InitializeOptions & Options)
+	{
+		this->Options = Options;
+		this->Options.Depth = Math::Clamp(Options.Depth, 1U, MaxLevels);
+		this->Options.Looseness = Math::Max(Options.Looseness, 1.0f);
+
+		Uint32 NumNodes = 0;
+
+		for (Uint32 Level = 0; Level <= this->Options.Depth; ++Level)
+		{
+			LevelOffsets[Level] = NumNodes;
+			NumNodes += (1U << Level) * (1U << Level);
+		}
+
+		Nodes.clear();
+		Nodes.resize(LevelOffsets[this->Options.Depth] + 1);
+
+		for (Uint32 Level = 0; Level < this->Options.Depth; ++Level)
+		{
+			const Uint32 Cells = 1U << Level;
+
+			const Float CellX = this->Options.Size.X / Cells;
+			const Float CellY = this->Options.Size.Y / Cells;
+
+			const Float LooseX = CellX * (this->Options.Looseness - 1.0f) * 0.5f;
+			const Float LooseY = CellY * (this->Options.Looseness - 1.0f) * 0.5f;
+
+			for (Uint32 Y = 0; Y < Cells; ++Y)
+			{
+				for (Uint32 X = 0; X < Cells; ++X)
+				{
+					Node & Current = Nodes[GetNodeIndex({ Level, X, Y })];
+					{
+						Current.Bounds.Min = Vector3f(this->Options.Origin.X + CellX * X - LooseX, this->Options.Origin.Y + CellY * Y - LooseY, MAX_FLT);
+						Current.Bounds.Max = Vector3f(this->Options.Origin.X + CellX * (X + 1) + LooseX, this->Options.Origin.Y + CellY * (Y + 1) + LooseY, -MAX_FLT);
+					}
+				}
+			}
+		}
+
+		Items.clear();
+		FreeItems.clear();
+
+		NumItems = 0;
+	}
+
+	void CLooseQuadTree::Clear()
+	{
+		Initialize(Options);
+	}
+
+	CLooseQuadTree::NodeLocation CLooseQuadTree::LocateNode(const BoundingBox & Bounds) const
+	{
+		const Vector3f Center = Bounds.GetCenter();
+		const Vector3f Extent = Bounds.GetExtent();
+
+		const Float ObjectSize = Math::Max(Extent.X, Extent.Y);
+
+		// Deepest level whose loose slack still covers the object.
+
+		Uint32 Level = 0;
+
+		const Float Slack = Options.Looseness - 1.0f;
+
+		while (Level + 1 < Options.Depth)
+		{
+			const Uint32 Cells = 1U << (Level + 1);
+			const Float CellSize = Math::Min(Options.Size.X, Options.Size.Y) / Cells;
+
+			if (ObjectSize > CellSize * Slack)
+			{
+				break;
+			}
+
+			++Level;
+		}
+
+		const Uint32 Cells = 1U << Level;
+
+		const Float U = (Center.X - Options.Origin.X) / Options.Size.X;
+		const Float V = (Center.Y - Options.Origin.Y) / Options.Size.Y;
+
+		NodeLocation Location;
+		{
+			Location.Level	= Level;
+			Location.X		= static_cast<Uint32>(Math::Clamp(static_cast<Int32>(U * Cells), 0, static_cast<Int32>(Cells) - 1));
+			Location.Y		= static_cast<Uint32>(Math::Clamp(static_cast<Int32>(V * Cells), 0, static_cast<Int32>(Cells) - 1));
+		}
+
+		auto Contains = [&Bounds](const Node & Target)
+		{
+			return
+				Bounds.Min.X >= Target.Bounds.Min.X && Bounds.Max.X <= Target.Bounds.Max.X &&
+				Bounds.Min.Y >= Target.Bounds.Min.Y && Bounds.Max.Y <= Target.Bounds.Max.Y;
+		};
+
+		// Objects outside of the tree go to the overflow node, objects
+		// too large for their cell go to the root.
+
+		if (!Contains(Nodes[0]))
+		{
+			return { OverflowLevel, 0, 0 };
+		}
+
+		if (Level > 0 && !Contains(Nodes[GetNodeIndex(Location)]))
+		{
+			return { 0, 0, 0 };
+		}
+
+		return Location;
+	}
+
+	SpatialHandle CLooseQuadTree::AllocateItem()
+	{
+		if (!FreeItems.empty())
+		{
+			const SpatialHandle Handle = FreeItems.back();
+			{
+				FreeItems.pop_back();
+			}
+
+			return Handle;
+		}
+
+		Items.emplace_back();
+
+		return static_cast<SpatialHandle>(Items.size() - 1);
+	}
+
+	void CLooseQuadTree::Link(const SpatialHandle Handle, NodeLocation Location)
+	{
+		Item & Target = Items[Handle];
+
+		const Uint32 NodeIndex = GetNodeIndex(Location);
+
+		Node & Owner = Nodes[NodeIndex];
+		{
+			Target.Node = NodeIndex;
+			Target.Prev = InvalidIndex;
+			Target.Next = Owner.FirstItem;
+
+			if (Owner.FirstItem != InvalidIndex)
+			{
+				Items[Owner.FirstItem].Prev = Handle;
+			}
+
+			Owner.FirstItem = Handle;
+			Owner.NumItems++;
+		}
+
+		if (Location.Level == OverflowLevel)
+		{
+			Owner.NumSubtreeItems++;
+			return;
+		}
+
+		// Propagate item count and height range up to the root.
+
+		while (true)
+		{
+			Node & Current = Nodes[GetNodeIndex(Location)];
+			{
+				Current.NumSubtreeItems++;
+				Current.Bounds.Min.Z = Math::Min(Current.Bounds.Min.Z, Target.Bounds.Min.Z);
+				Current.Bounds.Max.Z = Math::Max(Current.Bounds.Max.Z, Target.Bounds.Max.Z);
+			}
+
+			if (Location.Level == 0)
+			{
+				break;
+			}
+
+			Location.Level -= 1;
+			Location.X /= 2;
+			Location.Y /= 2;
+		}
+	}
+
+	void CLooseQuadTree::Unlink(const SpatialHandle Handle)
+	{
+		Item & Target = Items[Handle];
+
+		if (Target.Node == InvalidIndex)
+		{
+			return;
+		}
+
+		Node & Owner = Nodes[Target.Node];
+		{
+			if (Target.Prev != InvalidIndex)
+			{
+				Items[Target.Prev].Next = Target.Next;
+			}
+			else
+			{
+				Owner.FirstItem = Target.Next;
+			}
+
+			if (Target.Next != InvalidIndex)
+			{
+				Items[Target.Next].Prev = Target.Prev;
+			}
+
+			Owner.NumItems--;
+		}
+
+		if (Target.Node == GetOverflowIndex())
+		{
+			Owner.NumSubtreeItems--;
+
+			Target.Node = InvalidIndex;
+			Target.Prev = InvalidIndex;
+			Target.Next = InvalidIndex;
+
+			return;
+		}
+
+		Uint32 Level = 0;
+
+		while (Target.Node >= LevelOffsets[Level + 1])
+		{
+			++Level;
+		}
+
+		const Uint32 Cells = 1U << Level;
+		const Uint32 Local = Target.Node - LevelOffsets[Level];
+
+		NodeLocation Location = { Level, Local % Cells, Local / Cells };
+
+		// Height ranges are conservative and only shrink on Clear.
+
+		while (true)
+		{
+			Nodes[GetNodeIndex(Location)].NumSubtreeItems--;
+
+			if (Location.Level == 0)
+			{
+				break;
+			}
+
+			Location.Level -= 1;
+			Location.X /= 2;
+			Location.Y /= 2;
+		}
+
+		Target.Node = InvalidIndex;
+		Target.Prev = InvalidIndex;
+		Target.Next = InvalidIndex;
+	}
+
+	SpatialHandle CLooseQuadTree::Insert(const BoundingBox & Bounds, const Uint32 UserData)
+	{
+		const SpatialHandle Handle = AllocateItem();
+
+		Item & Target = Items[Handle];
+		{
+			Target.Bounds	= Bounds;
+			Target.UserData = UserData;
+		}
+
+		Link(Handle, LocateNode(Bounds));
+
+		NumItems++;
+
+		return Handle;
+	}
+
+	void CLooseQuadTree::InsertBatch(const BoundingBox * Bounds, const Uint32 * UserData, const size_t NumNewItems, SpatialHandle * Handles)
+	{
+		TVector<SpatialHandle> Allocated(NumNewItems);
+
+		for (size_t N = 0; N < NumNewItems; ++N)
+		{
+			Allocated[N] = AllocateItem();
+		}
+
+		TVector<NodeLocation> Locations(NumNewItems);
+
+		auto Locate = [&](size_t N)
+		{
+			Item & Target = Items[Allocated[N]];
+			{
+				Target.Bounds	= Bounds[N];
+				Target.UserData = UserData[N];
+			}
+
+			Locations[N] = LocateNode(Bounds[N]);
+		};
+
+		if (NumNewItems >= GQuadTreeParallelInsertThreshold)
+		{
+			tbb::parallel_for(size_t(0), NumNewItems, Locate);
+		}
+		else
+		{
+			for (size_t N = 0; N < NumNewItems; ++N)
+			{
+				Locate(N);
+			}
+		}
+
+		for (size_t N = 0; N < NumNewItems; ++N)
+		{
+			Link(Allocated[N], Locations[N]);
+
+			if (Handles)
+			{
+				Handles[N] = Allocated[N];
+			}
+		}
+
+		NumItems += NumNewItems;
+	}
+
+	void CLooseQuadTree::Update(const SpatialHandle Handle, const BoundingBox & Bounds)
+	{
+		Item & Target = Items[Handle];
+
+		const NodeLocation Location = LocateNode(Bounds);
+
+		if (Target.Node != InvalidIndex)
+		{
+			if (GetNodeIndex(Location) == Target.Node)
+			{
+				// Same cell, only the height range may grow.
+
+				Target.Bounds = Bounds;
+
+				if (Location.Level == OverflowLevel)
+				{
+					return;
+				}
+
+				NodeLocation Current = Location;
+
+				while (true)
+				{
+					Node & Parent = Nodes[GetNodeIndex(Current)];
+					{
+						Parent.Bounds.Min.Z = Math::Min(Parent.Bounds.Min.Z, Bounds.Min.Z);
+						Parent.Bounds.Max.Z = Math::Max(Parent.Bounds.Max.Z, Bounds.Max.Z);
+					}
+
+					if (Current.Level == 0)
+					{
+						break;
+					}
+
+					Current.Level -= 1;
+					Current.X /= 2;
+					Current.Y /= 2;
+				}
+
+				return;
+			}
+		}
+
+		Unlink(Handle);
+		{
+			Target.Bounds = Bounds;
+		}
+		Link(Handle, Location);
+	}
+
+	void CLooseQuadTree::Remove(const SpatialHandle Handle)
+	{
+		if (Items[Handle].Node == InvalidIndex)
+		{
+			return;
+		}
+
+		Unlink(Handle);
+
+		FreeItems.push_back(Handle);
+
+		NumItems--;
+	}
+}
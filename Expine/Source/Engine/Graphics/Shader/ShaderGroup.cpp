@@ -43,7 +43,7 @@ namespace D3D
 		return Result;
 	}
 
-	ErrorCode CGrpShader::CompileShaderGroupVariation(TArray<ShaderMacro*, NumShaderTypes> Macros, SharedPointer<CGrpShader> ResultShader) const
+	ErrorCode CGrpShader::CompileShaderGroupVariation(TArray<ShaderMacro*, NumShaderTypes> Macros, SharedPointer<CGrpShader> & ResultShader) const
 	{
 		if (OwnerObject == NULL)
 		{
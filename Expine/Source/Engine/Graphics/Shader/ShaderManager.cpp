@@ -5,154 +5,189 @@
 
 #include "Utils/File/FileSystemWatcher.h"
 
-#ifndef MAX_SHADERS
-static constexpr UINT MaxShaders = 512;
-#else
-static constexpr UINT MaxShaders = MAX_SHADERS;
-#endif
+#include <future>
 
 namespace D3D
 {
 	static UniquePointer<File::CFileSystemWatcher> g_pShaderChangeWatcher;
 
-	class CFileNotifyCallback : public File::CFileSystemWatcher::IChangeNotifyCallback
+	// Filled by the watcher thread, recompiled by Update.
+
+	static TMutex			g_ShaderChangeMutex;
+	static THashSet<WString>	g_ShaderChanges;
+
+	// Filled by the compile workers, taken over by Update.
+
+	static TMutex																g_CompletedShaderMutex;
+	static TVector<TPair<SharedPointer<RShader>, ShaderCache::CompileResult> >	g_CompletedShaders;
+
+	void CShaderManager::InitializeCompiler()
 	{
-		virtual bool OnFileChangeNotify(File::CFileSystemWatcher::TFileNotifyInformation * pChanges) override
+		if (CompilerInitialized)
 		{
-			do
-			{
-				if (CShaderManager::Instance().OnUpdateShader(pChanges->GetFileName()))
-				{
-					return true;
-				}
-			} while (pChanges = pChanges->Next());
-
-			return true;
+			return;
 		}
-	};
 
-	ErrorCode CShaderManager::OnUpdateShader(const WString & Path) const
-	{
-		SharedPointer<RShader> Shader;
+		CompilerInitialized = true;
+
+		// Without a directory the cache still tracks dependencies, it only stops persisting.
 
-		if (!GetShaderByPath(Path, Shader))
+		if (!Cache.Initialize(ShaderCache::CShaderCache::InitializeOptions()))
 		{
-			return S_OK;
+			CErrorLog::Log<LogWarning>() << "Unable to create shader cache directory: " << Cache.GetDirectory() << CErrorLog::EndLine;
 		}
 
-		ErrorCode Error;
-
-		if ((Error = Shader->ReCompileShader()))
+		ShaderCache::CCompileScheduler::InitializeOptions Options;
 		{
-			return Error;
+			Options.Cache = &Cache;
 		}
 
-		return S_OK;
+		Scheduler.Initialize(Options);
 	}
 
-	ErrorCode CShaderManager::EnableDevelopmentMode()
+	ErrorCode CShaderManager::OnUpdateShader(const Uint64 KeyHash)
 	{
-		static CFileNotifyCallback ShaderChangeCallback;
-
-		if (g_pShaderChangeWatcher == NULL)
+		SharedPointer<RShader> Shader;
 		{
-			g_pShaderChangeWatcher = new File::CFileSystemWatcher(MaxShaders);
+			std::scoped_lock<TMutex> Lock(Mutex);
+
+			if (!GetShader(KeyHash, Shader))
+			{
+				return S_OK;
+			}
 		}
 
-		ErrorCode Error = g_pShaderChangeWatcher->Initialize(ShaderDefaultDirectory.c_str());
+		// The shader keeps its previous bytecode until Update takes over the result.
 
-		if (Error)
+		ShaderCache::CompileRequest Request;
 		{
-			return Error;
+			Request.Key			= Shader->GetShaderKey();
+			Request.Compiler	= RShader::CreateCompiler(Shader->PathFull, Shader->IncludeHandler.Get());
+			Request.Priority	= ShaderCache::CompilePriorityVisible;
+			Request.Callback	= [Shader](const ShaderCache::CompileResult & Result)
+			{
+				std::scoped_lock<TMutex> Lock(g_CompletedShaderMutex);
+				{
+					g_CompletedShaders.emplace_back(Shader, Result);
+				}
+			};
 		}
 
-		g_pShaderChangeWatcher->SetCallback(&ShaderChangeCallback);
+		Scheduler.Submit(std::move(Request));
 
 		return S_OK;
 	}
 
-	bool CShaderManager::GetShader
+	Uint64 CShaderManager::ScheduleShader
 	(
 		const	WString					& Path,
 		const	String					& EntryPoint,
+		const	String					& Target,
 		const	TVector<ShaderMacro>	& Macros,
-				SharedPointer<RShader>	& Result
-	)	const
+				ShaderInclude			* Includes,
+		const	Int32					  Priority
+	)
 	{
-		for (auto & Shader : Shaders)
 		{
-			bool Equal = true;
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				InitializeCompiler();
+			}
+		}
+
+		WString PathFull = ShaderDefaultDirectory;
+		{
+			PathFull.append(L"\\").append(Path);
+		}
+
+		ShaderCache::CompileRequest Request;
+		{
+			Request.Key			= RShader::GetShaderKey(PathFull, EntryPoint, Target, Macros);
+			Request.Compiler	= RShader::CreateCompiler(PathFull, Includes);
+			Request.Priority	= Priority;
+		}
+
+		return Scheduler.Submit(std::move(Request));
+	}
+
+	bool CShaderManager::PrioritizeShader(const Uint64 KeyHash, const Int32 Priority)
+	{
+		return Scheduler.SetPriority(KeyHash, Priority);
+	}
+
+	bool CShaderManager::IsShaderPending(const Uint64 KeyHash) const
+	{
+		return Scheduler.IsPending(KeyHash);
+	}
+
+	void CShaderManager::WaitForShaders()
+	{
+		Scheduler.Wait();
+	}
 
-			if (Shader->GetEntryPoint() == EntryPoint && Shader->GetPath() == Path)
+	ErrorCode CShaderManager::EnableDevelopmentMode()
+	{
+		if (g_pShaderChangeWatcher == NULL)
+		{
+			g_pShaderChangeWatcher = new File::CFileSystemWatcher();
+		}
+
+		File::CFileSystemWatcher::InitializeOptions Options;
+		{
+			Options.Directory	= ShaderDefaultDirectory;
+			Options.Patterns	= { L"*.hlsl", L"*.hlsli" };
+		}
+
+		const bool Watching = g_pShaderChangeWatcher->Initialize(Options, [](const File::FileChangeSet & Changes)
+		{
+			std::scoped_lock<TMutex> Lock(g_ShaderChangeMutex);
+
+			for (const File::FileChange & Change : Changes.Changes)
 			{
-				if (!Macros.empty())
+				if (Change.Type != File::FileChangeRemoved)
 				{
-					if (Macros.size() != Shader->Macros.size())
-					{
-						continue;
-					}
-
-					for (UINT N = 0; N < Shader->Macros.size() - 1; ++N)
-					{
-						if (strcmp(Macros[N].Definition, Shader->Macros[N].Definition))
-						{
-							Equal = false;
-							break;
-						}
-
-						if (strcmp(Macros[N].Name, Shader->Macros[N].Name))
-						{
-							Equal = false;
-							break;
-						}
-					}
-
-					if (!Equal)
-					{
-						continue;
-					}
+					g_ShaderChanges.insert(Change.Path);
 				}
-
-				Result = Shader;
-				return true;
 			}
+		});
+
+		if (!Watching)
+		{
+			return E_FAIL;
 		}
 
-		return false;
+		return S_OK;
 	}
 
-	bool CShaderManager::GetShaderByPathEntrypoint
+	bool CShaderManager::GetShader
 	(
 		const	WString					& Path,
 		const	String					& EntryPoint,
+		const	String					& Target,
+		const	TVector<ShaderMacro>	& Macros,
 				SharedPointer<RShader>	& Result
 	)	const
 	{
-		for (auto & Shader : Shaders)
+		WString PathFull = ShaderDefaultDirectory;
 		{
-			if (Shader->GetEntryPoint() == EntryPoint && Shader->GetPath() == Path)
-			{
-				Result = Shader;
-				return true;
-			}
+			PathFull.append(L"\\").append(Path);
 		}
 
-		return false;
+		return GetShader(ShaderCache::HashShaderKey(RShader::GetShaderKey(PathFull, EntryPoint, Target, Macros)), Result);
 	}
 
-	inline bool CShaderManager::GetShaderByPath
+	bool CShaderManager::GetShader
 	(
-		const	WString					& Path,
+		const	Uint64					  KeyHash,
 				SharedPointer<RShader>	& Result
 	)	const
 	{
-		for (auto & Shader : Shaders)
+		const auto Iter = Shaders.find(KeyHash);
+
+		if (Iter != Shaders.end())
 		{
-			if (Shader->GetPath() == Path)
-			{
-				Result = Shader;
-				return true;
-			}
+			Result = Iter->second;
+			return true;
 		}
 
 		return false;
@@ -165,6 +200,8 @@ namespace D3D
 	CShaderManager::~CShaderManager()
 	{
 		g_pShaderChangeWatcher.SafeRelease();
+
+		Scheduler.Stop();
 	}
 
 	CShaderManager::CShaderManager(const WString & Directory) : 
@@ -173,9 +210,45 @@ namespace D3D
 
 	void CShaderManager::Update()
 	{
-		if (g_pShaderChangeWatcher)
+		THashSet<WString> Changes;
 		{
-			g_pShaderChangeWatcher->Watch();
+			std::scoped_lock<TMutex> Lock(g_ShaderChangeMutex);
+
+			Changes.swap(g_ShaderChanges);
+		}
+
+		// Every shader that read one of the files, once, however many of its includes changed.
+
+		THashSet<Uint64> Keys;
+
+		for (const WString & Path : Changes)
+		{
+			WString PathFull = ShaderDefaultDirectory;
+			{
+				PathFull.append(L"/").append(Path);
+			}
+
+			for (const Uint64 KeyHash : Cache.Invalidate(PathFull))
+			{
+				Keys.insert(KeyHash);
+			}
+		}
+
+		for (const Uint64 KeyHash : Keys)
+		{
+			OnUpdateShader(KeyHash);
+		}
+
+		TVector<TPair<SharedPointer<RShader>, ShaderCache::CompileResult> > Completed;
+		{
+			std::scoped_lock<TMutex> Lock(g_CompletedShaderMutex);
+
+			Completed.swap(g_CompletedShaders);
+		}
+
+		for (const auto & Shader : Completed)
+		{
+			Shader.first->ReloadShader(Shader.second.Output, Shader.second.Succeeded);
 		}
 	}
 
@@ -185,20 +258,17 @@ namespace D3D
 		{
 			std::scoped_lock<TMutex> Lock(Mutex);
 
-			for (UINT N = 0; N < Shaders.size();)
+			for (auto Iter = Shaders.begin(); Iter != Shaders.end();)
 			{
-				RShader * pShader = Shaders[N].Get();
+				RShader * pShader = Iter.value().Get();
 
-				if (pShader->RemoveObject(Object))
+				if (pShader->RemoveObject(Object) && pShader->ConnectedObjectCount() == 0)
 				{
-					if (pShader->ConnectedObjectCount() == 0)
-					{
-						Shaders.erase(Shaders.begin() + N);
-					}
+					Iter = Shaders.erase(Iter);
 				}
 				else
 				{
-					++N;
+					++Iter;
 				}
 			}
 		}
@@ -211,10 +281,12 @@ namespace D3D
 				SharedPointer<RShader>	& Shader
 	)
 	{
-		std::scoped_lock<TMutex> Lock(Mutex);
+		std::unique_lock<TMutex> Lock(Mutex);
 
 		TVector<ShaderMacro> MacroList;
 
+		// A list holding only the terminating macro is the same as no list.
+
 		if(Options.Macros)
 		{
 			UINT N;
@@ -226,11 +298,6 @@ namespace D3D
 
 			MacroList.push_back(Options.Macros[N]);
 
-			if (MacroList.size() == 1)
-			{
-				return E_INVALIDARG;
-			}
-
 			if (MacroList[MacroList.size() - 1].Name		!= NULL ||
 				MacroList[MacroList.size() - 1].Definition	!= NULL)
 			{
@@ -238,42 +305,93 @@ namespace D3D
 			}
 		}
 
-		if (GetShader(Options.Path, Options.EntryPoint, MacroList, Shader))
+		if (GetShader(Options.Path, Options.EntryPoint, Options.TargetVersion, MacroList, Shader))
+		{
+			Shader->AddObject(Object);
+			return S_OK;
+		}
+
+		InitializeCompiler();
+
+		SharedPointer<RShader> Compiled = new RShader();
+		{
+			Compiled->SetSource
+			(
+				ShaderDefaultDirectory,
+				Options.Path,
+				Options.EntryPoint,
+				Options.TargetVersion,
+				MacroList,
+				Options.IncludeHandler.Get()
+			);
+		}
+
+		// Goes through the scheduler like the background compiles, a queued compile of the same
+		// permutation is merged and moves ahead. The registry is unlocked while the worker runs.
+
+		std::shared_ptr<std::promise<ShaderCache::CompileResult> > Done = std::make_shared<std::promise<ShaderCache::CompileResult> >();
+
+		std::future<ShaderCache::CompileResult> Pending = Done->get_future();
+
+		ShaderCache::CompileRequest Request;
+		{
+			Request.Key			= Compiled->GetShaderKey();
+			Request.Compiler	= RShader::CreateCompiler(Compiled->PathFull, Compiled->IncludeHandler.Get());
+			Request.Priority	= ShaderCache::CompilePriorityVisible;
+			Request.Callback	= [Done](const ShaderCache::CompileResult & Result)
+			{
+				Done->set_value(Result);
+			};
+		}
+
+		// Only the request holds the promise now, a request dropped by Stop breaks it.
+
+		Done.reset();
+
+		Lock.unlock();
+
+		Scheduler.Submit(std::move(Request));
+
+		ShaderCache::CompileResult Result;
+
+		try
 		{
+			Result = Pending.get();
+		}
+		catch (const std::future_error &)
+		{
+			return E_ABORT;
+		}
+
+		Lock.lock();
+
+		if (GetShader(Compiled->GetKeyHash(), Shader))
+		{
+			Shader->AddObject(Object);
 			return S_OK;
 		}
 
-		Shader = new RShader();
+		Shader = Compiled;
 
-		ErrorCode Error = Shader->CompileShader
-		(
-			ShaderDefaultDirectory,
-			Options.Path,
-			Options.EntryPoint,
-			Options.TargetVersion,
-			MacroList,
-			Options.IncludeHandler.Get()
-		);
+		ErrorCode Error = Shader->ApplyCompileOutput(Result.Output, Result.Succeeded);
 
 		if (Error)
 		{
-			CErrorLog::Log<LogError>() << "Error on Shader compilation: ";
+			// Reloads run while rendering, the text is formatted on the log writer.
+
+			StringView Message;
 
 			if (Shader->GetError())
 			{
-				CErrorLog::Log<LogError>() << String
-				(
-					static_cast<char*>(Shader->GetError()->GetBufferPointer()),
-					static_cast<char*>(Shader->GetError()->GetBufferPointer()) + Shader->GetError()->GetBufferSize()
-				);
+				Message = StringView(static_cast<const char*>(Shader->GetError()->GetBufferPointer()), Shader->GetError()->GetBufferSize());
 			}
-			
-			CErrorLog::Log<LogError>() << CErrorLog::EndLine << "ErrorCode: " << Error << CErrorLog::EndLine;
+
+			LOG_ERROR("Shader", "Error on shader compilation ({}): {}", Logging::Hex(Error.Result), Message);
 
 			return Error;
 		}
 
-		Shaders.push_back(Shader);
+		Shaders[Shader->GetKeyHash()] = Shader;
 		{
 			Shader->AddObject(Object);
 		}
@@ -7,6 +7,35 @@
 
 namespace D3D
 {
+	namespace
+	{
+		// DDS textures are streamed, other formats are loaded in full.
+
+		ErrorCode LoadMaterialTexture(const char * Path, ShaderTextureInfo & Info, TVector<TextureStreamingHandle> & StreamedTextures)
+		{
+			const size_t Length = strlen(Path);
+
+			if (Length < 4 || _strnicmp(Path + Length - 4, ".dds", 4) != 0)
+			{
+				return CTextureManager::Instance().GetOrAddTexture(String(Path), String(Path), Info);
+			}
+
+			ErrorCode Error;
+
+			if ((Error = CTextureManager::Instance().AddStreamedTexture(String(Path), String(Path), Info)))
+			{
+				return Error;
+			}
+
+			if (Info.StreamingHandle != InvalidTextureStreamingHandle)
+			{
+				StreamedTextures.push_back(Info.StreamingHandle);
+			}
+
+			return S_OK;
+		}
+	}
+
 	ErrorCode CSpeedTree::CMaterialLoader::LoadMaterial(const SpeedTree::SRenderState * pRenderState, WindType WindType, LodType LodType, int32_t NumBillboards)
 	{
 		ErrorCode Error;
@@ -44,10 +73,7 @@ namespace D3D
 
 		if (TexturePathDiffuse)
 		{
-			if (Error = CTextureManager::Instance().GetOrAddTexture(
-				String(TexturePathDiffuse),
-				String(TexturePathDiffuse),
-				TexInfoDiffuse))
+			if ((Error = LoadMaterialTexture(TexturePathDiffuse, TexInfoDiffuse, StreamedTextures)))
 			{
 				return Error;
 			}
@@ -59,10 +85,7 @@ namespace D3D
 		{
 			if (TexturePathDiffuseDetails)
 			{
-				if (Error = CTextureManager::Instance().GetOrAddTexture(
-					String(TexturePathDiffuseDetails),
-					String(TexturePathDiffuseDetails),
-					TexInfoDiffuseDetails))
+				if ((Error = LoadMaterialTexture(TexturePathDiffuseDetails, TexInfoDiffuseDetails, StreamedTextures)))
 				{
 					return Error;
 				}
@@ -73,10 +96,7 @@ namespace D3D
 
 		if (TexturePathSpecular)
 		{
-			if (Error = CTextureManager::Instance().GetOrAddTexture(
-				String(TexturePathSpecular),
-				String(TexturePathSpecular),
-				TexInfoSpecular))
+			if ((Error = LoadMaterialTexture(TexturePathSpecular, TexInfoSpecular, StreamedTextures)))
 			{
 				return Error;
 			}
@@ -86,10 +106,7 @@ namespace D3D
 
 		if (TexturePathNormal)
 		{
-			if (Error = CTextureManager::Instance().GetOrAddTexture(
-				String(TexturePathNormal),
-				String(TexturePathNormal),
-				TexInfoNormal))
+			if ((Error = LoadMaterialTexture(TexturePathNormal, TexInfoNormal, StreamedTextures)))
 			{
 				return Error;
 			}
@@ -98,10 +115,7 @@ namespace D3D
 
 			if (TexturePathNormalDetails)
 			{
-				if (Error = CTextureManager::Instance().GetOrAddTexture(
-					String(TexturePathNormalDetails),
-					String(TexturePathNormalDetails),
-					TexInfoNormalDetails))
+				if ((Error = LoadMaterialTexture(TexturePathNormalDetails, TexInfoNormalDetails, StreamedTextures)))
 				{
 					return Error;
 				}
@@ -144,6 +158,19 @@ namespace D3D
 		}
 
 		StaticMaterial = new SPTMaterial(0, Material, pRenderState, GeometryType, WindType);
+		{
+			if (TexturePathDiffuse)
+			{
+				StaticMaterial->Textures[MaterialTextureDiffuse]	= TexInfoDiffuse;
+				StaticMaterial->HasTexture[MaterialTextureDiffuse]	= true;
+			}
+
+			if (TexturePathNormal)
+			{
+				StaticMaterial->Textures[MaterialTextureNormal]		= TexInfoNormal;
+				StaticMaterial->HasTexture[MaterialTextureNormal]	= true;
+			}
+		}
 
 		return S_OK;
 	}
@@ -181,33 +208,33 @@ namespace D3D
 
 		DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_DIFFUSE_TEXCOORDS, VertexIdx, SPTData);
 		{
-			Mesh.WedgeTexcoords[0].front() = Vector2f(SPTData[0], SPTData[1]);
+			Mesh.WedgeTexcoords[0].back() = Vector2f(SPTData[0], SPTData[1]);
 		}
 
 		DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_LIGHTMAP_TEXCOORDS, VertexIdx, SPTData);
 		{
-			Mesh.WedgeTexcoords[1].front() = Vector2f(SPTData[0], SPTData[1]);
+			Mesh.WedgeTexcoords[1].back() = Vector2f(SPTData[0], SPTData[1]);
 		}
 
 		DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_WIND_BRANCH_DATA, VertexIdx, SPTData);
 		{
-			Mesh.WedgeTexcoords[2].front() = Vector2f(SPTData[0], SPTData[1]);
+			Mesh.WedgeTexcoords[2].back() = Vector2f(SPTData[0], SPTData[1]);
 		}
 
 		if (RenderState->m_bFacingLeavesPresent)
 		{
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_LEAF_CARD_LOD_SCALAR, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[3].front() = Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[4].front() = Vector2f::ZeroVector;
+				Mesh.WedgeTexcoords[3].back() = Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[4].back() = Vector2f::ZeroVector;
 			}
 		}
 		else
 		{
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_LOD_POSITION, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[3].front() = Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[4].front() = Vector2f(SPTData[2], 0.0f);
+				Mesh.WedgeTexcoords[3].back() = Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[4].back() = Vector2f(SPTData[2], 0.0f);
 			}
 		}
 
@@ -215,21 +242,21 @@ namespace D3D
 		{
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_DETAIL_TEXCOORDS, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[5].front() = Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[5].back() = Vector2f(SPTData[0], SPTData[1]);
 			}
 
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_BRANCH_SEAM_DIFFUSE, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[6].front()		= Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[4].front().Y	= SPTData[2];
+				Mesh.WedgeTexcoords[6].back()		= Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[4].back().Y		= SPTData[2];
 			}
 		}
 		else if (RenderState->m_bFrondsPresent)
 		{
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_WIND_EXTRA_DATA, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[5].front() = Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[6].front() = Vector2f(SPTData[2], 0.0f);
+				Mesh.WedgeTexcoords[5].back() = Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[6].back() = Vector2f(SPTData[2], 0.0f);
 			}
 		}
 		else if (
@@ -245,19 +272,19 @@ namespace D3D
 				DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_LEAF_ANCHOR_POINT, VertexIdx, SPTData);
 			}
 
-			Mesh.WedgeTexcoords[4].front().Y		= -SPTData[0];
-			Mesh.WedgeTexcoords[5].front()			= Vector2f(SPTData[1], SPTData[2]);
+			Mesh.WedgeTexcoords[4].back().Y		= -SPTData[0];
+			Mesh.WedgeTexcoords[5].back()		= Vector2f(SPTData[1], SPTData[2]);
 
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_WIND_EXTRA_DATA, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[6].front()		= Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[7].front().X	= SPTData[2];
+				Mesh.WedgeTexcoords[6].back()		= Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[7].back().X		= SPTData[2];
 			}
 
 			DrawCall.GetProperty(SpeedTree::VERTEX_PROPERTY_WIND_FLAGS, VertexIdx, SPTData);
 			{
-				Mesh.WedgeTexcoords[6].front()		= Vector2f(SPTData[0], SPTData[1]);
-				Mesh.WedgeTexcoords[7].front().Y	= SPTData[0];
+				Mesh.WedgeTexcoords[6].back()		= Vector2f(SPTData[0], SPTData[1]);
+				Mesh.WedgeTexcoords[7].back().Y		= SPTData[0];
 			}
 		}
 	}
@@ -388,6 +415,10 @@ namespace D3D
 						DrawCall.m_nRenderStateIndex, MaterialIdx));
 
 					StaticMesh->StaticMaterials.push_back(Loader.GetMaterial());
+
+					StreamedTextures.insert(StreamedTextures.end(),
+						Loader.GetStreamedTextures().begin(),
+						Loader.GetStreamedTextures().end());
 				}
 				else
 				{
@@ -420,8 +451,10 @@ namespace D3D
 				const Int32 NumTriangles = DrawCall.m_nNumIndices / 3;
 				const Int32 NumTrianglesExisting = Mesh->WedgeIndices.size() / 3;
 
-				Mesh->FaceMaterialIndices.ResizeUninitialized(NumTriangles);
-				Mesh->FaceSmoothingMasks.ResizeUninitialized(NumTriangles);
+				// Faces of all draw calls are appended, the material index of a face is at its face index.
+
+				Mesh->FaceMaterialIndices.reserve(NumTrianglesExisting + NumTriangles);
+				Mesh->FaceSmoothingMasks.reserve(NumTrianglesExisting + NumTriangles);
 
 				for (Int32 TriangleIdx = 0; TriangleIdx < NumTriangles; ++TriangleIdx)
 				{
@@ -433,30 +466,34 @@ namespace D3D
 						ProcessTriangleCorners(TriangleIdx, Corner, DrawCall, RenderState, pIndices16, pIndices32, *Mesh, VertexOffset, NumUVs);
 					}
 				}
+			}
 
-				KStaticMeshSourceModel * LodModel = &*StaticMesh->SourceModels.emplace(StaticMesh->SourceModels.end());
-				{
-					LodModel->BuildSettings.GenerateLightmapUVs				= false;
-					LodModel->BuildSettings.RecomputeNormals				= false;
-					LodModel->BuildSettings.RecomputeTangents				= false;
-					LodModel->BuildSettings.RemoveDegenerates				= true;
-					LodModel->BuildSettings.UseFullPrecisionUVs				= false;
-					LodModel->BuildSettings.UseHighPrecisionTangentBasis	= false;
-					LodModel->ScreenSize									= 0.1f / Math::Max(2.0f, static_cast<float>(StaticMesh->StaticMaterials.size()));
-					LodModel->Mesh											= Mesh;
-
-					CParallelProcessManager::Instance().AddProcessingUnit(new CMeshAttributeProcessor(LodModel));
-				}
+			// One source model per lod, the draw calls of the lod are its sections.
 
-				const int32_t LodIdx = StaticMesh->SourceModels.size();
+			KStaticMeshSourceModel * LodModel = &*StaticMesh->SourceModels.emplace(StaticMesh->SourceModels.end());
+			{
+				LodModel->BuildSettings.GenerateLightmapUVs				= false;
+				LodModel->BuildSettings.RecomputeNormals				= false;
+				LodModel->BuildSettings.RecomputeTangents				= false;
+				LodModel->BuildSettings.RemoveDegenerates				= true;
+				LodModel->BuildSettings.UseFullPrecisionUVs				= false;
+				LodModel->BuildSettings.UseHighPrecisionTangentBasis	= false;
+				LodModel->ScreenSize									= 0.1f / Math::Max(2.0f, static_cast<float>(StaticMesh->StaticMaterials.size()));
+				LodModel->Mesh											= Mesh;
+
+				CParallelProcessManager::Instance().AddProcessingUnit(new CMeshAttributeProcessor(LodModel));
+			}
 
-				for (int32_t MaterialIdx = 0; MaterialIdx < StaticMesh->StaticMaterials.size(); ++MaterialIdx)
+			const int32_t ModelIdx = StaticMesh->SourceModels.size() - 1;
+
+			for (int32_t MaterialIdx = 0; MaterialIdx < StaticMesh->StaticMaterials.size(); ++MaterialIdx)
+			{
+				KMeshSectionInfo Info;
 				{
-					KMeshSectionInfo & Info = StaticMesh->SectionInfoMap.Get(LodIdx, MaterialIdx);
-					{
-						Info.MaterialIdx = MaterialIdx;
-					}
+					Info.MaterialIdx = MaterialIdx;
 				}
+
+				StaticMesh->SectionInfoMap.Set(ModelIdx, MaterialIdx, Info);
 			}
 
 			if (Core.GetGeometry()->m_sVertBBs.m_nNumBillboards > 0)
@@ -465,9 +502,31 @@ namespace D3D
 			}
 		}
 
+		LocalBounds = BoundingBox();
+
+		for (const KStaticMeshSourceModel & Model : StaticMesh->SourceModels)
+		{
+			for (const Vector3f & Position : Model.Mesh->VertexPositions)
+			{
+				LocalBounds.Add(Position);
+			}
+		}
+
+		this->StaticMesh = StaticMesh;
+
 		return S_OK;
 	}
 
+	void CSpeedTree::RequestTextureMips(const Float ScreenSize) const
+	{
+		CTextureStreamer & Streamer = CTextureManager::Instance().GetStreamer();
+
+		for (const TextureStreamingHandle Handle : StreamedTextures)
+		{
+			Streamer.RequestScreenSize(Handle, ScreenSize);
+		}
+	}
+
 	inline const char * CSpeedTree::GetLastError() const
 	{
 		return Core.GetError();
@@ -513,8 +572,92 @@ namespace D3D
 		}
 	}
 
-	void CSpeedTreeObject::Render(const CSceneRenderer * Renderer) const
+	BoundingBox CSpeedTreeObject::GetBounds() const
+	{
+		if (!Spt || !Spt->GetLocalBounds().IsValid())
+		{
+			return CStaticObject::GetBounds();
+		}
+
+		const BoundingBox & Local = Spt->GetLocalBounds();
+
+		// Trees only turn around the up axis, the horizontal extent covers every rotation.
+
+		const Float Radius = Math::Max(
+			Math::Max(Math::Abs(Local.Min.X), Math::Abs(Local.Max.X)),
+			Math::Max(Math::Abs(Local.Min.Y), Math::Abs(Local.Max.Y)));
+
+		const Vector3f & Center = Controller->GetCenterPosition();
+
+		return BoundingBox(
+			Vector3f(Center.X - Radius, Center.Y - Radius, Center.Z + Local.Min.Z),
+			Vector3f(Center.X + Radius, Center.Y + Radius, Center.Z + Local.Max.Z));
+	}
+
+	void CSpeedTreeObject::GatherInstances(CInstanceBatchBuilder & Builder, const Uint32 Lod, const Uint32 ObjectId) const
 	{
+		if (!Spt || !Controller)
+		{
+			return;
+		}
+
+		const KStaticMesh * Mesh = Spt->GetStaticMesh();
+
+		if (!Mesh)
+		{
+			return;
+		}
+
+		if (Mesh->SourceModels.empty())
+		{
+			return;
+		}
+
+		const Uint32 MeshLod = Math::Min(Lod, static_cast<Uint32>(Mesh->SourceModels.size() - 1));
+
+		InstanceTransform Transform;
+		{
+			Transform.Position	= Controller->GetCenterPosition();
+			Transform.Rotation	= Controller->GetRotation();
+			Transform.Scale		= 1.0f;
+			Transform.ObjectId	= ObjectId;
+		}
+
+		const Uint32 MeshId = Builder.RegisterMesh(Mesh);
+
+		// Geometry is appended once per lod, the first instance of a tree brings it in.
+
+		if (!Builder.HasMeshGeometry(MeshId, MeshLod))
+		{
+			Builder.AddMeshGeometry(MeshId, MeshLod, *Mesh);
+		}
+
+		const TVector<KMaterialStatic*> & Materials = Mesh->StaticMaterials;
+
+		for (size_t N = 0; N < Materials.size(); ++N)
+		{
+			// Sections of a material listed twice share one range, it is drawn once.
+
+			if (std::find(Materials.begin(), Materials.begin() + N, Materials[N]) != Materials.begin() + N)
+			{
+				continue;
+			}
+
+			const Uint32 MaterialId = Builder.RegisterMaterial(Materials[N]);
+
+			if (Builder.GetMeshRange(MeshId, MeshLod, MaterialId))
+			{
+				Builder.AddInstance(MeshId, MeshLod, MaterialId, Transform);
+			}
+		}
+	}
+
+	void CSpeedTreeObject::RequestTextureMips(const Float ScreenSize) const
+	{
+		if (Spt)
+		{
+			Spt->RequestTextureMips(ScreenSize);
+		}
 	}
 
 	CSpeedTree::SPTMaterial::SPTMaterial(
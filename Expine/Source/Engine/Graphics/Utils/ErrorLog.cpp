@@ -4,5 +4,28 @@
 
 namespace D3D
 {
-	CErrorLog CErrorLog::LogInstance[LogNum];
+	Logging::LogSite CErrorLog::Sites[LogNum] =
+	{
+		{ "Graphics", "{}", __FILE__, __LINE__, Logging::LevelInfo, 0 },
+		{ "Graphics", "{}", __FILE__, __LINE__, Logging::LevelWarning, 0 },
+		{ "Graphics", "{}", __FILE__, __LINE__, Logging::LevelError, 0 },
+		{ "Graphics", "{}", __FILE__, __LINE__, Logging::LevelException, 0 },
+		{ "Graphics", "{}", __FILE__, __LINE__, Logging::LevelFatal, 0 }
+	};
+
+	void CErrorLog::Submit()
+	{
+		// A line longer than one record is split over several.
+
+		static constexpr size_t MaxLength = Logging::MaxPayloadSize - 1 - sizeof(Uint16);
+
+		const std::string_view Text(Line.data(), Line.size());
+
+		for (size_t Offset = 0; Offset < Text.size(); Offset += MaxLength)
+		{
+			Logging::Write(Sites[Level], Text.substr(Offset, MaxLength));
+		}
+
+		Line.clear();
+	}
 }
@@ -4,6 +4,8 @@
 #include "Engine/Graphics/Scene/SceneView.h"
 #include "Engine/Graphics/Scene/Scene.h"
 #include "Engine/Graphics/Screen.h"
+#include "Engine/Graphics/Raw/RawPipelineState.h"
+#include "Utils/File/AsyncIO.h"
 
 #include <thread>
 
@@ -80,6 +82,10 @@ LRESULT CALLBACK WndProc
 
 		case WM_DESTROY:
 		{
+			// Pipelines no longer created by this build age out of the file.
+
+			RPipelineState::LogCacheStats();
+			RPipelineState::SaveCache(true);
 			PostQuitMessage(0);
 		}
 
@@ -501,8 +507,16 @@ int APIENTRY wWinMain
 		return false;
 	}
 
+	// Started before any resource is loaded, file reads fall back to blocking ones without it.
+
+	if (!File::CAsyncIO::New()->Initialize(File::CAsyncIO::InitializeOptions()))
+	{
+		CErrorLog::Log<LogWarning>() << "Unable to start asynchronous file IO" << CErrorLog::EndLine;
+	}
+
     if (!InitializeInstance(hInstance, nCmdShow))
     {
+		File::CAsyncIO::Instance().Shutdown();
         return false;
     }
 
@@ -514,5 +528,7 @@ int APIENTRY wWinMain
 		DispatchMessage(&Msg);
     }
 
+	File::CAsyncIO::Instance().Shutdown();
+
     return (int)Msg.wParam;
 }
\ No newline at end of file
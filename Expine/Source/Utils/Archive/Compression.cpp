@@ -0,0 +1,282 @@
+#include "Utils/Archive/Compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Archive
+{
+	namespace LZ
+	{
+		namespace
+		{
+			constexpr Uint32 HashBits = 14;
+
+			// Trailing bytes that are always stored as literals.
+
+			constexpr size_t LastLiterals = 5;
+
+			inline Uint32 Read32(const Byte * Data)
+			{
+				Uint32 Value;
+				{
+					std::memcpy(&Value, Data, sizeof(Value));
+				}
+
+				return Value;
+			}
+
+			inline Uint32 Hash(const Uint32 Value)
+			{
+				return (Value * 2654435761u) >> (32 - HashBits);
+			}
+
+			class CBlockWriter
+			{
+			private:
+
+				Byte *	Cursor;
+				Byte *	End;
+				bool	Overflow = false;
+
+			public:
+
+				CBlockWriter(Byte * Destination, const size_t Capacity) :
+					Cursor(Destination),
+					End(Destination + Capacity)
+				{}
+
+				inline void Put(const Byte Value)
+				{
+					if (Cursor < End)
+					{
+						*Cursor++ = Value;
+					}
+					else
+					{
+						Overflow = true;
+					}
+				}
+
+				inline void Put(const Byte * Data, const size_t Size)
+				{
+					if (static_cast<size_t>(End - Cursor) < Size)
+					{
+						Overflow = true;
+						return;
+					}
+
+					std::memcpy(Cursor, Data, Size);
+					Cursor += Size;
+				}
+
+				inline void PutLength(size_t Length)
+				{
+					for (; Length >= 255; Length -= 255)
+					{
+						Put(255);
+					}
+
+					Put(static_cast<Byte>(Length));
+				}
+
+				inline Byte * GetCursor() const
+				{
+					return Cursor;
+				}
+
+				inline bool HasOverflow() const
+				{
+					return Overflow;
+				}
+			};
+
+			void WriteSequence(CBlockWriter & Writer, const Byte * Literals, const size_t NumLiterals, const size_t Offset, const size_t MatchLength)
+			{
+				const size_t MatchCode = MatchLength ? MatchLength - MinMatch : 0;
+
+				Writer.Put(static_cast<Byte>(
+					(NumLiterals < 15 ? NumLiterals : 15) << 4 |
+					(MatchCode < 15 ? MatchCode : 15)));
+
+				if (NumLiterals >= 15)
+				{
+					Writer.PutLength(NumLiterals - 15);
+				}
+
+				Writer.Put(Literals, NumLiterals);
+
+				if (MatchLength)
+				{
+					Writer.Put(static_cast<Byte>(Offset));
+					Writer.Put(static_cast<Byte>(Offset >> 8));
+
+					if (MatchCode >= 15)
+					{
+						Writer.PutLength(MatchCode - 15);
+					}
+				}
+			}
+		}
+
+		size_t Compress(const Byte * Source, const size_t SourceSize, Byte * Destination, const size_t DestinationCapacity)
+		{
+			CBlockWriter Writer(Destination, std::min(DestinationCapacity, SourceSize));
+
+			size_t Anchor = 0;
+
+			if (SourceSize > MinMatch + LastLiterals)
+			{
+				TVector<Uint32> Table(size_t(1) << HashBits, 0);
+
+				const size_t MatchLimit = SourceSize - LastLiterals;
+
+				size_t Position = 1;
+
+				Table[Hash(Read32(Source))] = 0;
+
+				while (Position + MinMatch <= MatchLimit && !Writer.HasOverflow())
+				{
+					const Uint32 Sequence	= Read32(Source + Position);
+					const Uint32 Slot		= Hash(Sequence);
+					size_t Candidate		= Table[Slot];
+
+					Table[Slot] = static_cast<Uint32>(Position);
+
+					if (Candidate >= Position || Position - Candidate > MaxOffset || Read32(Source + Candidate) != Sequence)
+					{
+						// Steps grow over incompressible data.
+
+						Position += 1 + ((Position - Anchor) >> 6);
+						continue;
+					}
+
+					while (Position > Anchor && Candidate > 0 && Source[Position - 1] == Source[Candidate - 1])
+					{
+						--Position;
+						--Candidate;
+					}
+
+					size_t Length = MinMatch;
+
+					while (Position + Length < MatchLimit && Source[Candidate + Length] == Source[Position + Length])
+					{
+						++Length;
+					}
+
+					WriteSequence(Writer, Source + Anchor, Position - Anchor, Position - Candidate, Length);
+
+					Position += Length;
+					Anchor = Position;
+
+					if (Position + MinMatch <= MatchLimit)
+					{
+						Table[Hash(Read32(Source + Position - 2))] = static_cast<Uint32>(Position - 2);
+					}
+				}
+			}
+
+			WriteSequence(Writer, Source + Anchor, SourceSize - Anchor, 0, 0);
+
+			if (Writer.HasOverflow())
+			{
+				return 0;
+			}
+
+			const size_t Size = static_cast<size_t>(Writer.GetCursor() - Destination);
+
+			return Size < SourceSize ? Size : 0;
+		}
+
+		bool Decompress(const Byte * Source, const size_t SourceSize, Byte * Destination, const size_t DestinationSize)
+		{
+			const Byte * Input		= Source;
+			const Byte * InputEnd	= Source + SourceSize;
+
+			size_t Written = 0;
+
+			const auto ReadLength = [&](size_t & Length)
+			{
+				Byte Value;
+
+				do
+				{
+					if (Input >= InputEnd)
+					{
+						return false;
+					}
+
+					Value = *Input++;
+					Length += Value;
+				}
+				while (Value == 255);
+
+				return true;
+			};
+
+			while (Input < InputEnd)
+			{
+				const Byte Token = *Input++;
+
+				size_t NumLiterals = Token >> 4;
+
+				if (NumLiterals == 15 && !ReadLength(NumLiterals))
+				{
+					return false;
+				}
+
+				if (static_cast<size_t>(InputEnd - Input) < NumLiterals || DestinationSize - Written < NumLiterals)
+				{
+					return false;
+				}
+
+				std::memcpy(Destination + Written, Input, NumLiterals);
+
+				Input	+= NumLiterals;
+				Written	+= NumLiterals;
+
+				// The last sequence ends after its literals.
+
+				if (Input == InputEnd)
+				{
+					break;
+				}
+
+				if (InputEnd - Input < 2)
+				{
+					return false;
+				}
+
+				const size_t Offset = Input[0] | static_cast<size_t>(Input[1]) << 8;
+
+				Input += 2;
+
+				size_t Length = Token & 15;
+
+				if (Length == 15 && !ReadLength(Length))
+				{
+					return false;
+				}
+
+				Length += MinMatch;
+
+				if (Offset == 0 || Offset > Written || DestinationSize - Written < Length)
+				{
+					return false;
+				}
+
+				// Matches may overlap the bytes they produce.
+
+				const Byte * Match = Destination + Written - Offset;
+
+				for (size_t N = 0; N < Length; ++N)
+				{
+					Destination[Written + N] = Match[N];
+				}
+
+				Written += Length;
+			}
+
+			return Written == DestinationSize;
+		}
+	}
+}
@@ -0,0 +1,607 @@
+#include "Utils/Archive/PackFile.h"
+#include "Utils/Archive/Compression.h"
+#include "Utils/File/File.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Archive
+{
+	namespace
+	{
+		constexpr Uint64 TableAlignment = 8;
+
+		inline Uint64 AlignUp(const Uint64 Value, const Uint64 Alignment)
+		{
+			return (Value + Alignment - 1) / Alignment * Alignment;
+		}
+
+		inline bool IsPowerOfTwo(const Uint64 Value)
+		{
+			return Value != 0 && (Value & (Value - 1)) == 0;
+		}
+
+		// Ranges are checked without overflowing on corrupt offsets.
+
+		inline bool IsInside(const Uint64 Offset, const Uint64 Size, const Uint64 Limit)
+		{
+			return Offset <= Limit && Size <= Limit - Offset;
+		}
+
+		// Rounded up without the sum overflowing, a corrupt size may need more than 2^32 chunks.
+
+		inline Uint64 GetNumChunks(const PackEntry & Entry, const Uint32 ChunkSize)
+		{
+			return Entry.Size / ChunkSize + (Entry.Size % ChunkSize != 0 ? 1 : 0);
+		}
+
+		template<class Char> String Normalize(const Char * Path, const size_t Length)
+		{
+			String Result;
+			{
+				Result.reserve(Length);
+			}
+
+			for (size_t N = 0; N < Length; ++N)
+			{
+				const Uint32 Code = static_cast<Uint32>(static_cast<typename std::make_unsigned<Char>::type>(Path[N]));
+
+				if (Code == '\\' || Code == '/')
+				{
+					if (!Result.empty() && Result.back() != '/')
+					{
+						Result.push_back('/');
+					}
+				}
+				else if (Code < 0x80)
+				{
+					Result.push_back(static_cast<char>(Code >= 'A' && Code <= 'Z' ? Code + ('a' - 'A') : Code));
+				}
+				else if (Code < 0x800 || sizeof(Char) == 1)
+				{
+					// Narrow input is taken as UTF-8 already.
+
+					if (sizeof(Char) == 1)
+					{
+						Result.push_back(static_cast<char>(Code));
+					}
+					else
+					{
+						Result.push_back(static_cast<char>(0xC0 | Code >> 6));
+						Result.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+					}
+				}
+				else
+				{
+					Result.push_back(static_cast<char>(0xE0 | Code >> 12));
+					Result.push_back(static_cast<char>(0x80 | (Code >> 6 & 0x3F)));
+					Result.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+				}
+			}
+
+			// Leading "./" segments refer to the root as well.
+
+			size_t Start = 0;
+
+			while (Result.compare(Start, 2, "./") == 0)
+			{
+				Start += 2;
+			}
+
+			Result.erase(0, Start);
+
+			return Result;
+		}
+	}
+
+	String NormalizePath(const WStringView & Path)
+	{
+		return Normalize(Path.data(), Path.size());
+	}
+
+	String NormalizePath(const StringView & Path)
+	{
+		return Normalize(Path.data(), Path.size());
+	}
+
+	Uint64 HashPath(const StringView & NormalizedPath)
+	{
+		Uint64 Hash = 0xCBF29CE484222325ULL;
+
+		for (const char Char : NormalizedPath)
+		{
+			Hash ^= static_cast<Byte>(Char);
+			Hash *= 0x100000001B3ULL;
+		}
+
+		return Hash;
+	}
+
+	bool CPackFile::Open(const WString & Path)
+	{
+		Close();
+
+		if (!Mapping.Open(Path))
+		{
+			return false;
+		}
+
+		if (!Validate())
+		{
+			Close();
+			return false;
+		}
+
+		Mapping.Advise(File::MappedFileAdviceRandom);
+
+		return true;
+	}
+
+	void CPackFile::Close()
+	{
+		Mapping.Close();
+
+		Header	= NULL;
+		Entries	= NULL;
+		Chunks	= NULL;
+		Slots	= NULL;
+		Names	= NULL;
+	}
+
+	bool CPackFile::Validate()
+	{
+		const Byte *	Data = Mapping.GetData();
+		const Uint64	Size = Mapping.GetSize();
+
+		if (Size < sizeof(PackHeader))
+		{
+			return false;
+		}
+
+		const PackHeader * Candidate = reinterpret_cast<const PackHeader*>(Data);
+
+		if (Candidate->Magic != PackMagic ||
+			Candidate->Version != PackVersion ||
+			Candidate->ChunkSize == 0 ||
+			(Candidate->NumSlots != 0 && !IsPowerOfTwo(Candidate->NumSlots)) ||
+			Candidate->NumSlots < Candidate->NumEntries)
+		{
+			return false;
+		}
+
+		if (!IsInside(Candidate->EntriesOffset, Candidate->NumEntries * Uint64(sizeof(PackEntry)), Size) ||
+			!IsInside(Candidate->ChunksOffset, Candidate->NumChunks * Uint64(sizeof(PackChunk)), Size) ||
+			!IsInside(Candidate->SlotsOffset, Candidate->NumSlots * Uint64(sizeof(Uint32)), Size) ||
+			!IsInside(Candidate->NamesOffset, Candidate->NamesSize, Size) ||
+			Candidate->EntriesOffset % TableAlignment ||
+			Candidate->ChunksOffset % TableAlignment ||
+			Candidate->SlotsOffset % TableAlignment)
+		{
+			return false;
+		}
+
+		const PackEntry * EntryTable = reinterpret_cast<const PackEntry*>(Data + Candidate->EntriesOffset);
+
+		for (Uint32 N = 0; N < Candidate->NumEntries; ++N)
+		{
+			const PackEntry & Entry = EntryTable[N];
+
+			if (!IsInside(Entry.Offset, Entry.StoredSize, Size) ||
+				!IsInside(Entry.NameOffset, Entry.NameLength, Candidate->NamesSize))
+			{
+				return false;
+			}
+
+			if (Entry.Flags & PackEntryCompressed)
+			{
+				const Uint64 Count = GetNumChunks(Entry, Candidate->ChunkSize);
+
+				if (Entry.FirstChunk > Candidate->NumChunks ||
+					Count > Uint64(Candidate->NumChunks) - Entry.FirstChunk)
+				{
+					return false;
+				}
+			}
+			else if (Entry.StoredSize != Entry.Size)
+			{
+				return false;
+			}
+		}
+
+		Header	= Candidate;
+		Entries	= EntryTable;
+		Chunks	= reinterpret_cast<const PackChunk*>(Data + Header->ChunksOffset);
+		Slots	= reinterpret_cast<const Uint32*>(Data + Header->SlotsOffset);
+		Names	= reinterpret_cast<const char*>(Data + Header->NamesOffset);
+
+		return true;
+	}
+
+	const PackEntry * CPackFile::Find(const WStringView & Path) const
+	{
+		const String Normalized = NormalizePath(Path);
+
+		return FindNormalized(Normalized, HashPath(Normalized));
+	}
+
+	const PackEntry * CPackFile::FindNormalized(const StringView & NormalizedPath, const Uint64 Hash) const
+	{
+		if (!Header || Header->NumSlots == 0)
+		{
+			return NULL;
+		}
+
+		const Uint32 Mask = Header->NumSlots - 1;
+
+		for (Uint32 Probe = 0, Slot = static_cast<Uint32>(Hash) & Mask; Probe < Header->NumSlots; ++Probe, Slot = (Slot + 1) & Mask)
+		{
+			const Uint32 Index = Slots[Slot];
+
+			if (Index == PackEmptySlot || Index >= Header->NumEntries)
+			{
+				return NULL;
+			}
+
+			const PackEntry & Entry = Entries[Index];
+
+			if (Entry.PathHash == Hash && GetPath(Entry) == NormalizedPath)
+			{
+				return &Entry;
+			}
+		}
+
+		return NULL;
+	}
+
+	const Byte * CPackFile::GetView(const PackEntry & Entry) const
+	{
+		if (Entry.Flags & PackEntryCompressed)
+		{
+			return NULL;
+		}
+
+		return Mapping.GetData() + Entry.Offset;
+	}
+
+	bool CPackFile::DecodeChunk(const PackEntry & Entry, const Uint32 Chunk, Byte * Destination) const
+	{
+		const PackChunk &	Record		= Chunks[Entry.FirstChunk + Chunk];
+		const Uint64		Begin		= static_cast<Uint64>(Chunk) * Header->ChunkSize;
+		const size_t		RawSize		= static_cast<size_t>(std::min<Uint64>(Header->ChunkSize, Entry.Size - Begin));
+		const size_t		EncodedSize	= Record.Size & ~PackChunkStored;
+
+		if (!IsInside(Record.Offset, EncodedSize, Entry.StoredSize))
+		{
+			return false;
+		}
+
+		const Byte * Source = Mapping.GetData() + Entry.Offset + Record.Offset;
+
+		if (Record.Size & PackChunkStored)
+		{
+			if (EncodedSize != RawSize)
+			{
+				return false;
+			}
+
+			std::memcpy(Destination, Source, RawSize);
+
+			return true;
+		}
+
+		return LZ::Decompress(Source, EncodedSize, Destination, RawSize);
+	}
+
+	bool CPackFile::Read(const PackEntry & Entry, TVector<Byte> & Output) const
+	{
+		Output.resize(static_cast<size_t>(Entry.Size));
+
+		return ReadRange(Entry, 0, Entry.Size, Output.data());
+	}
+
+	bool CPackFile::ReadRange(const PackEntry & Entry, const Uint64 Offset, const Uint64 Bytes, Byte * Destination) const
+	{
+		if (!IsInside(Offset, Bytes, Entry.Size))
+		{
+			return false;
+		}
+
+		if (Bytes == 0)
+		{
+			return true;
+		}
+
+		if (!(Entry.Flags & PackEntryCompressed))
+		{
+			std::memcpy(Destination, Mapping.GetData() + Entry.Offset + Offset, static_cast<size_t>(Bytes));
+			return true;
+		}
+
+		const Uint32 ChunkSize	= Header->ChunkSize;
+		const Uint32 First		= static_cast<Uint32>(Offset / ChunkSize);
+		const Uint32 Last		= static_cast<Uint32>((Offset + Bytes - 1) / ChunkSize);
+
+		TAtomic<bool> Failed(false);
+
+		tbb::parallel_for(First, Last + 1, [&](const Uint32 Chunk)
+		{
+			const Uint64 Begin	= static_cast<Uint64>(Chunk) * ChunkSize;
+			const Uint64 End	= std::min<Uint64>(Begin + ChunkSize, Entry.Size);
+
+			const Uint64 CopyBegin	= std::max(Begin, Offset);
+			const Uint64 CopyEnd	= std::min(End, Offset + Bytes);
+
+			Byte * Target = Destination + (CopyBegin - Offset);
+
+			// Whole chunks decode in place, partial ones through a copy.
+
+			if (CopyBegin == Begin && CopyEnd == End)
+			{
+				if (!DecodeChunk(Entry, Chunk, Target))
+				{
+					Failed = true;
+				}
+
+				return;
+			}
+
+			TVector<Byte> Scratch(static_cast<size_t>(End - Begin));
+
+			if (!DecodeChunk(Entry, Chunk, Scratch.data()))
+			{
+				Failed = true;
+				return;
+			}
+
+			std::memcpy(Target, Scratch.data() + (CopyBegin - Begin), static_cast<size_t>(CopyEnd - CopyBegin));
+		});
+
+		return !Failed;
+	}
+
+	void CPackFile::Prefetch(const PackEntry & Entry) const
+	{
+		Mapping.Prefetch(Entry.Offset, Entry.StoredSize);
+	}
+
+	void CPackWriter::AddFile(const WStringView & Path, const WString & FilePath, const bool Compress)
+	{
+		Source Item;
+		{
+			Item.Path		= NormalizePath(Path);
+			Item.FilePath	= FilePath;
+			Item.Compress	= Compress;
+		}
+
+		Sources.push_back(std::move(Item));
+	}
+
+	void CPackWriter::AddData(const WStringView & Path, TVector<Byte> && Data, const bool Compress)
+	{
+		Source Item;
+		{
+			Item.Path		= NormalizePath(Path);
+			Item.Data		= std::move(Data);
+			Item.Compress	= Compress;
+		}
+
+		Sources.push_back(std::move(Item));
+	}
+
+	bool CPackWriter::Write(const WString & OutputPath)
+	{
+		if (Options.ChunkSize == 0 ||
+			Options.ChunkSize & PackChunkStored ||
+			!IsPowerOfTwo(Options.Alignment) ||
+			!IsPowerOfTwo(Options.CompressedAlignment))
+		{
+			return false;
+		}
+
+		std::stable_sort(Sources.begin(), Sources.end(), [](const Source & A, const Source & B)
+		{
+			return A.Path < B.Path;
+		});
+
+		for (size_t N = 0; N < Sources.size(); ++N)
+		{
+			if (Sources[N].Path.empty() || (N > 0 && Sources[N].Path == Sources[N - 1].Path))
+			{
+				return false;
+			}
+		}
+
+		struct Encoded
+		{
+			TVector<Byte>		Data;
+			TVector<PackChunk>	Chunks;
+			Uint64				Size = 0;
+			bool				Compressed = false;
+		};
+
+		TVector<Encoded> Results(Sources.size());
+
+		TAtomic<bool> Failed(false);
+
+		tbb::parallel_for(size_t(0), Sources.size(), [&](const size_t Index)
+		{
+			Source &	Item	= Sources[Index];
+			Encoded &	Result	= Results[Index];
+
+			if (!Item.FilePath.empty())
+			{
+				File::CFile Input(Item.FilePath);
+
+				if (Input.ReadFileContentInto(Item.Data) != File::ErrorNone)
+				{
+					Failed = true;
+					return;
+				}
+			}
+
+			Result.Size = Item.Data.size();
+
+			if (Options.Compress && Item.Compress && !Item.Data.empty())
+			{
+				const size_t NumChunks = static_cast<size_t>((Result.Size + Options.ChunkSize - 1) / Options.ChunkSize);
+
+				TVector<TVector<Byte> > Blocks(NumChunks);
+
+				tbb::parallel_for(size_t(0), NumChunks, [&](const size_t Chunk)
+				{
+					const size_t Begin	= Chunk * Options.ChunkSize;
+					const size_t Size	= std::min<size_t>(Options.ChunkSize, Item.Data.size() - Begin);
+
+					Blocks[Chunk].resize(Size);
+
+					const size_t EncodedSize = LZ::Compress(Item.Data.data() + Begin, Size, Blocks[Chunk].data(), Size);
+
+					if (EncodedSize)
+					{
+						Blocks[Chunk].resize(EncodedSize);
+					}
+					else
+					{
+						std::memcpy(Blocks[Chunk].data(), Item.Data.data() + Begin, Size);
+					}
+				});
+
+				Uint64 StoredSize = 0;
+
+				for (const TVector<Byte> & Block : Blocks)
+				{
+					StoredSize += Block.size();
+				}
+
+				if (StoredSize <= Result.Size * Options.MaxCompressedRatio)
+				{
+					Result.Compressed = true;
+					Result.Data.reserve(static_cast<size_t>(StoredSize));
+					Result.Chunks.resize(NumChunks);
+
+					for (size_t Chunk = 0; Chunk < NumChunks; ++Chunk)
+					{
+						const size_t RawSize = std::min<size_t>(Options.ChunkSize, Item.Data.size() - Chunk * Options.ChunkSize);
+
+						Result.Chunks[Chunk].Offset	= static_cast<Uint32>(Result.Data.size());
+						Result.Chunks[Chunk].Size	= static_cast<Uint32>(Blocks[Chunk].size()) | (Blocks[Chunk].size() == RawSize ? PackChunkStored : 0);
+
+						Result.Data.insert(Result.Data.end(), Blocks[Chunk].begin(), Blocks[Chunk].end());
+					}
+
+					TVector<Byte>().swap(Item.Data);
+					return;
+				}
+			}
+
+			Result.Data.swap(Item.Data);
+		});
+
+		if (Failed)
+		{
+			return false;
+		}
+
+		TVector<PackEntry>	EntryTable(Sources.size());
+		TVector<PackChunk>	ChunkTable;
+		String				NameTable;
+
+		Uint64 Offset = sizeof(PackHeader);
+
+		for (size_t N = 0; N < Sources.size(); ++N)
+		{
+			const Encoded & Result = Results[N];
+
+			if (Result.Data.size() > 0xFFFFFFFFULL && Result.Compressed)
+			{
+				return false;
+			}
+
+			PackEntry & Entry = EntryTable[N];
+			{
+				Offset = AlignUp(Offset, Result.Compressed ? Options.CompressedAlignment : Options.Alignment);
+
+				Entry.PathHash		= HashPath(Sources[N].Path);
+				Entry.Offset		= Offset;
+				Entry.Size			= Result.Size;
+				Entry.StoredSize	= Result.Data.size();
+				Entry.NameOffset	= static_cast<Uint32>(NameTable.size());
+				Entry.NameLength	= static_cast<Uint32>(Sources[N].Path.size());
+				Entry.Flags			= Result.Compressed ? PackEntryCompressed : 0;
+				Entry.FirstChunk	= static_cast<Uint32>(ChunkTable.size());
+			}
+
+			NameTable += Sources[N].Path;
+			ChunkTable.insert(ChunkTable.end(), Result.Chunks.begin(), Result.Chunks.end());
+
+			Offset += Result.Data.size();
+		}
+
+		// Twice as many slots as entries keeps probe sequences short.
+
+		Uint32 NumSlots = Sources.empty() ? 0 : 1;
+
+		while (NumSlots < Sources.size() * 2)
+		{
+			NumSlots <<= 1;
+		}
+
+		TVector<Uint32> SlotTable(NumSlots, PackEmptySlot);
+
+		for (size_t N = 0; N < EntryTable.size(); ++N)
+		{
+			Uint32 Slot = static_cast<Uint32>(EntryTable[N].PathHash) & (NumSlots - 1);
+
+			while (SlotTable[Slot] != PackEmptySlot)
+			{
+				Slot = (Slot + 1) & (NumSlots - 1);
+			}
+
+			SlotTable[Slot] = static_cast<Uint32>(N);
+		}
+
+		PackHeader Header = {};
+		{
+			Header.Magic			= PackMagic;
+			Header.Version			= PackVersion;
+			Header.NumEntries		= static_cast<Uint32>(EntryTable.size());
+			Header.NumChunks		= static_cast<Uint32>(ChunkTable.size());
+			Header.NumSlots			= NumSlots;
+			Header.ChunkSize		= Options.ChunkSize;
+			Header.EntriesOffset	= AlignUp(Offset, TableAlignment);
+			Header.ChunksOffset		= AlignUp(Header.EntriesOffset + EntryTable.size() * sizeof(PackEntry), TableAlignment);
+			Header.SlotsOffset		= AlignUp(Header.ChunksOffset + ChunkTable.size() * sizeof(PackChunk), TableAlignment);
+			Header.NamesOffset		= Header.SlotsOffset + SlotTable.size() * sizeof(Uint32);
+			Header.NamesSize		= NameTable.size();
+		}
+
+		File::CFile Output(OutputPath);
+
+		TVector<Byte> & Content = Output.GetContentRef();
+		{
+			Content.assign(static_cast<size_t>(Header.NamesOffset + Header.NamesSize), 0);
+		}
+
+		std::memcpy(Content.data(), &Header, sizeof(Header));
+
+		for (size_t N = 0; N < EntryTable.size(); ++N)
+		{
+			std::memcpy(Content.data() + EntryTable[N].Offset, Results[N].Data.data(), Results[N].Data.size());
+
+			TVector<Byte>().swap(Results[N].Data);
+		}
+
+		std::memcpy(Content.data() + Header.EntriesOffset, EntryTable.data(), EntryTable.size() * sizeof(PackEntry));
+		std::memcpy(Content.data() + Header.ChunksOffset, ChunkTable.data(), ChunkTable.size() * sizeof(PackChunk));
+		std::memcpy(Content.data() + Header.SlotsOffset, SlotTable.data(), SlotTable.size() * sizeof(Uint32));
+		std::memcpy(Content.data() + Header.NamesOffset, NameTable.data(), NameTable.size());
+
+		const bool Written = Output.WriteFileContent() == File::ErrorNone;
+
+		Output.Close();
+
+		return Written;
+	}
+}
@@ -0,0 +1,217 @@
+#include "Utils/Archive/VirtualFileSystem.h"
+#include "Utils/File/File.h"
+
+namespace Archive
+{
+	CFileData::CFileData(CFileData && Other)
+	{
+		*this = std::move(Other);
+	}
+
+	CFileData & CFileData::operator=(CFileData && Other)
+	{
+		if (this != &Other)
+		{
+			Storage	= std::move(Other.Storage);
+			Data	= Other.View ? Other.Data : Storage.data();
+			Size	= Other.Size;
+			View	= Other.View;
+
+			Other.Storage.clear();
+			Other.Data	= NULL;
+			Other.Size	= 0;
+			Other.View	= false;
+		}
+
+		return *this;
+	}
+
+	void CFileData::SetView(const Byte * Data, const Uint64 Size)
+	{
+		Storage.clear();
+
+		this->Data = Data;
+		this->Size = Size;
+		this->View = true;
+	}
+
+	void CFileData::SetStorage(TVector<Byte> && Storage)
+	{
+		this->Storage = std::move(Storage);
+
+		Data = this->Storage.data();
+		Size = this->Storage.size();
+		View = false;
+	}
+
+	void CFileData::DetachContent(TVector<Byte> & Result)
+	{
+		if (View)
+		{
+			Result.assign(Data, Data + Size);
+		}
+		else
+		{
+			Result.swap(Storage);
+		}
+
+		Storage.clear();
+
+		Data = NULL;
+		Size = 0;
+		View = false;
+	}
+
+	bool CVirtualFileSystem::MountPack(const WString & Path)
+	{
+		Mount Target;
+		{
+			Target.Pack.reset(new CPackFile());
+		}
+
+		if (!Target.Pack->Open(Path))
+		{
+			return false;
+		}
+
+		Mounts.push_back(std::move(Target));
+
+		return true;
+	}
+
+	void CVirtualFileSystem::MountDirectory(const WString & Directory)
+	{
+		Mount Target;
+		{
+			Target.Directory = Directory;
+
+			if (!Target.Directory.empty() && Target.Directory.back() != L'/' && Target.Directory.back() != L'\\')
+			{
+				Target.Directory.push_back(L'/');
+			}
+		}
+
+		Mounts.push_back(std::move(Target));
+	}
+
+	void CVirtualFileSystem::UnmountAll()
+	{
+		Mounts.clear();
+	}
+
+	bool CVirtualFileSystem::FindFile(const WStringView & Path, const String & Normalized, const Uint64 Hash, const CPackFile *& Pack, const PackEntry *& Entry, WString & FilePath) const
+	{
+		for (auto Iter = Mounts.rbegin(); Iter != Mounts.rend(); ++Iter)
+		{
+			if (Iter->Pack)
+			{
+				if ((Entry = Iter->Pack->FindNormalized(Normalized, Hash)))
+				{
+					Pack = Iter->Pack.get();
+					return true;
+				}
+			}
+			else
+			{
+				FilePath.assign(Iter->Directory);
+				FilePath.append(Path.begin(), Path.end());
+
+				if (File::DoesFileExist(FilePath))
+				{
+					Pack	= NULL;
+					Entry	= NULL;
+
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool CVirtualFileSystem::Exists(const WStringView & Path) const
+	{
+		const String Normalized = NormalizePath(Path);
+
+		const CPackFile *	Pack;
+		const PackEntry *	Entry;
+		WString				FilePath;
+
+		return FindFile(Path, Normalized, HashPath(Normalized), Pack, Entry, FilePath);
+	}
+
+	bool CVirtualFileSystem::Open(const WStringView & Path, CFileData & Data) const
+	{
+		const String Normalized = NormalizePath(Path);
+
+		const CPackFile *	Pack;
+		const PackEntry *	Entry;
+		WString				FilePath;
+
+		if (!FindFile(Path, Normalized, HashPath(Normalized), Pack, Entry, FilePath))
+		{
+			return false;
+		}
+
+		if (Pack)
+		{
+			if (const Byte * View = Pack->GetView(*Entry))
+			{
+				Data.SetView(View, Entry->Size);
+				return true;
+			}
+
+			TVector<Byte> Storage;
+
+			if (!Pack->Read(*Entry, Storage))
+			{
+				return false;
+			}
+
+			Data.SetStorage(std::move(Storage));
+
+			return true;
+		}
+
+		File::CFile Input(FilePath);
+
+		TVector<Byte> Storage;
+
+		if (Input.ReadFileContentInto(Storage) != File::ErrorNone)
+		{
+			return false;
+		}
+
+		Data.SetStorage(std::move(Storage));
+
+		return true;
+	}
+
+	bool CVirtualFileSystem::Read(const WStringView & Path, TVector<Byte> & Output) const
+	{
+		CFileData Data;
+
+		if (!Open(Path, Data))
+		{
+			return false;
+		}
+
+		Data.DetachContent(Output);
+
+		return true;
+	}
+
+	void CVirtualFileSystem::Prefetch(const WStringView & Path) const
+	{
+		const String Normalized = NormalizePath(Path);
+
+		const CPackFile *	Pack;
+		const PackEntry *	Entry;
+		WString				FilePath;
+
+		if (FindFile(Path, Normalized, HashPath(Normalized), Pack, Entry, FilePath) && Pack)
+		{
+			Pack->Prefetch(*Entry);
+		}
+	}
+}
@@ -0,0 +1,383 @@
+#include "Utils/Container/StringTable.h"
+
+#include <cstring>
+
+namespace
+{
+	inline Uint64 MixHash
+	(
+		Uint64 Hash
+	)
+	{
+		Hash ^= Hash >> 33;
+		Hash *= 0xFF51AFD7ED558CCDull;
+		Hash ^= Hash >> 33;
+		Hash *= 0xC4CEB9FE1A85EC53ull;
+		Hash ^= Hash >> 33;
+
+		return Hash;
+	}
+
+	template<class Char>
+	inline bool IsSeparator
+	(
+		const Char Value
+	)
+	{
+		return Value == static_cast<Char>('/') || Value == static_cast<Char>('\\');
+	}
+}
+
+template<class Char>
+TStringTable<Char>::TStringTable()
+{
+	for (std::atomic<Entry *> & Page : Pages)
+	{
+		Page.store(NULL, std::memory_order_relaxed);
+	}
+
+	static const Char Empty[1] = {};
+
+	EntryPages.emplace_back(new Entry[PageSize]);
+	{
+		EntryPages.back()[0] = Entry{ Empty, 0, Hash(TView()) };
+	}
+
+	Pages[0].store(EntryPages.back().get(), std::memory_order_release);
+
+	NumEntries = 1;
+
+	TUniquePtr<IndexTable> Table(new IndexTable());
+	{
+		Table->Mask = 1024 - 1;
+		Table->Slots.reset(new std::atomic<Uint32>[Table->Mask + 1]);
+
+		for (Uint32 Slot = 0; Slot <= Table->Mask; ++Slot)
+		{
+			Table->Slots[Slot].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	Index.store(Table.get(), std::memory_order_release);
+
+	IndexTables.push_back(std::move(Table));
+}
+
+template<class Char>
+TStringTable<Char> & TStringTable<Char>::Global()
+{
+	static TStringTable * Table = new TStringTable();
+	{
+		return *Table;
+	}
+}
+
+template<class Char>
+Uint64 TStringTable<Char>::Hash(const TView & Text)
+{
+	const Byte * Data = reinterpret_cast<const Byte *>(Text.data());
+
+	size_t Size = Text.size() * sizeof(Char);
+
+	Uint64 Hash = 0x9E3779B97F4A7C15ull ^ Size;
+
+	for (; Size >= sizeof(Uint64); Data += sizeof(Uint64), Size -= sizeof(Uint64))
+	{
+		Uint64 Word;
+		{
+			memcpy(&Word, Data, sizeof(Uint64));
+		}
+
+		Hash = (Hash ^ Word) * 0x9FB21C651E98DF25ull;
+		Hash ^= Hash >> 29;
+	}
+
+	if (Size > 0)
+	{
+		Uint64 Word = 0;
+		{
+			memcpy(&Word, Data, Size);
+		}
+
+		Hash = (Hash ^ Word) * 0x9FB21C651E98DF25ull;
+	}
+
+	return MixHash(Hash);
+}
+
+template<class Char>
+void TStringTable<Char>::NormalizePath(const TView & Path, std::basic_string<Char> & Result)
+{
+	Result.clear();
+	Result.reserve(Path.size());
+
+	if (!Path.empty() && IsSeparator(Path[0]))
+	{
+		Result.push_back(static_cast<Char>('/'));
+	}
+
+	const size_t Root = Result.size();
+
+	for (size_t Position = 0; Position < Path.size();)
+	{
+		size_t End = Position;
+
+		while (End < Path.size() && !IsSeparator(Path[End]))
+		{
+			++End;
+		}
+
+		const TView Segment = Path.substr(Position, End - Position);
+
+		Position = End + 1;
+
+		if (Segment.empty() || (Segment.size() == 1 && Segment[0] == static_cast<Char>('.')))
+		{
+			continue;
+		}
+
+		if (Segment.size() == 2 && Segment[0] == static_cast<Char>('.') && Segment[1] == static_cast<Char>('.'))
+		{
+			const size_t Last	= Result.find_last_of(static_cast<Char>('/'));
+			const size_t Start	= Last == std::basic_string<Char>::npos || Last < Root ? Root : Last + 1;
+
+			const TView Previous(Result.data() + Start, Result.size() - Start);
+
+			// Leading ".." and drive letters stay.
+
+			if (!Previous.empty() && Previous != Segment && Previous.back() != static_cast<Char>(':'))
+			{
+				Result.resize(Start > Root ? Start - 1 : Root);
+				continue;
+			}
+		}
+
+		if (Result.size() > Root)
+		{
+			Result.push_back(static_cast<Char>('/'));
+		}
+
+		for (const Char Value : Segment)
+		{
+			Result.push_back(Value >= static_cast<Char>('A') && Value <= static_cast<Char>('Z') ? static_cast<Char>(Value + ('a' - 'A')) : Value);
+		}
+	}
+}
+
+template<class Char>
+Uint32 TStringTable<Char>::Probe(const IndexTable & Table, const TView & Text, const Uint64 Hash) const
+{
+	// The index is at most half full, probing always ends at an empty slot.
+
+	for (Uint32 Slot = static_cast<Uint32>(Hash) & Table.Mask;; Slot = (Slot + 1) & Table.Mask)
+	{
+		const Uint32 Found = Table.Slots[Slot].load(std::memory_order_acquire);
+
+		if (Found == 0)
+		{
+			return NotFound;
+		}
+
+		const Entry & Value = GetEntry(Found);
+
+		if (Value.Hash == Hash && Value.Length == Text.size() && memcmp(Value.Data, Text.data(), Text.size() * sizeof(Char)) == 0)
+		{
+			return Found;
+		}
+	}
+}
+
+template<class Char>
+const Char * TStringTable<Char>::Store(const TView & Text)
+{
+	const size_t Length = Text.size() + 1;
+
+	Char * Data;
+
+	if (Length > BlockSize / 4)
+	{
+		// Long strings get a block of their own, the current block keeps filling.
+
+		Blocks.emplace_back(new Char[Length]);
+		Data = Blocks.back().get();
+	}
+	else
+	{
+		if (Length > BlockRemaining)
+		{
+			Blocks.emplace_back(new Char[BlockSize]);
+
+			BlockCursor		= Blocks.back().get();
+			BlockRemaining	= BlockSize;
+		}
+
+		Data = BlockCursor;
+
+		BlockCursor		+= Length;
+		BlockRemaining	-= Length;
+	}
+
+	memcpy(Data, Text.data(), Text.size() * sizeof(Char));
+	{
+		Data[Text.size()] = 0;
+	}
+
+	NumBytes += Length * sizeof(Char);
+
+	return Data;
+}
+
+template<class Char>
+void TStringTable<Char>::Grow()
+{
+	const IndexTable & Current = *Index.load(std::memory_order_relaxed);
+
+	TUniquePtr<IndexTable> Table(new IndexTable());
+	{
+		Table->Mask = (Current.Mask << 1) | 1;
+		Table->Slots.reset(new std::atomic<Uint32>[Table->Mask + 1]);
+
+		for (Uint32 Slot = 0; Slot <= Table->Mask; ++Slot)
+		{
+			Table->Slots[Slot].store(0, std::memory_order_relaxed);
+		}
+
+		for (Uint32 Existing = 1; Existing < NumEntries; ++Existing)
+		{
+			Uint32 Slot = static_cast<Uint32>(GetEntry(Existing).Hash) & Table->Mask;
+
+			while (Table->Slots[Slot].load(std::memory_order_relaxed) != 0)
+			{
+				Slot = (Slot + 1) & Table->Mask;
+			}
+
+			Table->Slots[Slot].store(Existing, std::memory_order_relaxed);
+		}
+	}
+
+	// The previous index stays allocated, readers may still be probing it.
+
+	Index.store(Table.get(), std::memory_order_release);
+
+	IndexTables.push_back(std::move(Table));
+}
+
+template<class Char>
+Uint32 TStringTable<Char>::Find(const TView & Text) const
+{
+	if (Text.empty())
+	{
+		return 0;
+	}
+
+	return Probe(*Index.load(std::memory_order_acquire), Text, Hash(Text));
+}
+
+template<class Char>
+Uint32 TStringTable<Char>::Intern(const TView & Text)
+{
+	if (Text.empty())
+	{
+		return 0;
+	}
+
+	const Uint64 TextHash = Hash(Text);
+
+	Uint32 Found = Probe(*Index.load(std::memory_order_acquire), Text, TextHash);
+
+	if (Found != NotFound)
+	{
+		return Found;
+	}
+
+	std::lock_guard<TMutex> Lock(Mutex);
+
+	// Another thread may have added it since the lookup above.
+
+	if ((Found = Probe(*Index.load(std::memory_order_relaxed), Text, TextHash)) != NotFound)
+	{
+		return Found;
+	}
+
+	if (NumEntries >= MaxPages * PageSize)
+	{
+		throw Exception("String table is full.");
+	}
+
+	if ((NumEntries + 1) * 2 > Index.load(std::memory_order_relaxed)->Mask + 1)
+	{
+		Grow();
+	}
+
+	const Uint32 Added = NumEntries;
+
+	if ((Added & (PageSize - 1)) == 0)
+	{
+		EntryPages.emplace_back(new Entry[PageSize]);
+		Pages[Added >> PageBits].store(EntryPages.back().get(), std::memory_order_release);
+	}
+
+	Entry & Value = EntryPages.back()[Added & (PageSize - 1)];
+	{
+		Value.Data		= Store(Text);
+		Value.Length	= static_cast<Uint32>(Text.size());
+		Value.Hash		= TextHash;
+	}
+
+	NumEntries++;
+
+	IndexTable & Table = *Index.load(std::memory_order_relaxed);
+
+	Uint32 Slot = static_cast<Uint32>(TextHash) & Table.Mask;
+
+	while (Table.Slots[Slot].load(std::memory_order_relaxed) != 0)
+	{
+		Slot = (Slot + 1) & Table.Mask;
+	}
+
+	// Publishes the entry, readers acquire the slot before reading it.
+
+	Table.Slots[Slot].store(Added, std::memory_order_release);
+
+	return Added;
+}
+
+template<class Char>
+Uint32 TStringTable<Char>::InternPath(const TView & Path)
+{
+	thread_local std::basic_string<Char> Normalized;
+	{
+		NormalizePath(Path, Normalized);
+	}
+
+	return Intern(Normalized);
+}
+
+template<class Char>
+Uint32 TStringTable<Char>::FindPath(const TView & Path) const
+{
+	thread_local std::basic_string<Char> Normalized;
+	{
+		NormalizePath(Path, Normalized);
+	}
+
+	return Find(Normalized);
+}
+
+template<class Char>
+StringTableStats TStringTable<Char>::GetStats() const
+{
+	std::lock_guard<TMutex> Lock(Mutex);
+
+	StringTableStats Stats;
+	{
+		Stats.NumStrings	= NumEntries;
+		Stats.NumBytes		= NumBytes;
+		Stats.IndexCapacity	= Index.load(std::memory_order_relaxed)->Mask + 1;
+	}
+
+	return Stats;
+}
+
+template class TStringTable<char>;
+template class TStringTable<wchar_t>;
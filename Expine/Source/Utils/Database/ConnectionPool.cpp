@@ -0,0 +1,435 @@
+#include "Utils/Database/ConnectionPool.h"
+
+#include <chrono>
+
+namespace Database
+{
+	namespace SQLite
+	{
+		static CConnectionPoolManager GConnectionPoolManager;
+
+		CConnectionPool::~CConnectionPool()
+		{
+			Stop();
+		}
+
+		int CConnectionPool::InitializeWriter()
+		{
+			int ErrorCode;
+
+			DataSet Result;
+
+			Writer.reset(new CDatabase());
+
+			if ((ErrorCode = Writer->OpenDB(Options.Path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX)) != SQLITE_OK)
+			{
+				Writer.reset();
+				return ErrorCode;
+			}
+
+			Writer->SetBusyTimeout(Options.BusyTimeoutMilliseconds);
+
+			// WAL lets readers proceed while the writer commits, synchronous NORMAL is durable enough with it.
+			// The pragma returns the resulting mode, in-memory files for one keep their own.
+
+			String JournalMode;
+			{
+				CCursor Cursor = Writer->Query("PRAGMA journal_mode = WAL");
+
+				if (Cursor.Next())
+				{
+					Cursor.GetRow().Get(0, JournalMode);
+				}
+
+				Cursor.Close();
+
+				ErrorCode = Cursor.GetErrorCode();
+			}
+
+			if (ErrorCode == SQLITE_OK && sqlite3_stricmp(JournalMode.c_str(), "wal") != 0)
+			{
+				ErrorCode = SQLITE_CANTOPEN;
+			}
+
+			if (ErrorCode != SQLITE_OK ||
+				(ErrorCode = Writer->ExecutePrepared("PRAGMA synchronous = NORMAL", Result)) != SQLITE_OK)
+			{
+				Writer.reset();
+				return ErrorCode;
+			}
+
+			return SQLITE_OK;
+		}
+
+		int CConnectionPool::Initialize(const InitializeOptions & Options)
+		{
+			Stop();
+
+			this->Options = Options;
+
+			int ErrorCode;
+
+			if (!Options.ReadOnly)
+			{
+				if ((ErrorCode = InitializeWriter()) != SQLITE_OK)
+				{
+					return ErrorCode;
+				}
+			}
+
+			Uint32 NumReaders = Options.NumReaders;
+
+			if (NumReaders == 0)
+			{
+				NumReaders = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			for (Uint32 N = 0; N < NumReaders; ++N)
+			{
+				TUniquePtr<CDatabase> Reader(new CDatabase());
+
+				if ((ErrorCode = Reader->OpenDB(Options.Path, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX)) != SQLITE_OK)
+				{
+					Readers.clear();
+					Writer.reset();
+
+					return ErrorCode;
+				}
+
+				Reader->SetBusyTimeout(Options.BusyTimeoutMilliseconds);
+
+				Readers.push_back(std::move(Reader));
+			}
+
+			for (TUniquePtr<CDatabase> & Reader : Readers)
+			{
+				CDatabase * Connection = Reader.get();
+
+				ReaderThreads.emplace_back([this, Connection]()
+				{
+					ReaderMain(*Connection);
+				});
+			}
+
+			if (Writer)
+			{
+				WriterThread = std::thread([this]()
+				{
+					WriterMain();
+				});
+			}
+
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Running = true;
+			}
+
+			return SQLITE_OK;
+		}
+
+		void CConnectionPool::Stop()
+		{
+			// Nothing is queued once Running is cleared, the threads only drain what is already there.
+
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+
+				if (!Running)
+				{
+					return;
+				}
+
+				Running		= false;
+				Stopping	= true;
+			}
+
+			ReadAvailable.notify_all();
+			WriteAvailable.notify_all();
+
+			for (std::thread & Reader : ReaderThreads)
+			{
+				Reader.join();
+			}
+
+			if (WriterThread.joinable())
+			{
+				WriterThread.join();
+			}
+
+			ReaderThreads.clear();
+
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				ReadQueue = TQueue<TReadTask>();
+				Stopping = false;
+			}
+
+			Readers.clear();
+			Writer.reset();
+		}
+
+		void CConnectionPool::SubmitRead(TReadTask && Task)
+		{
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+
+				// Dropping the task breaks its future.
+
+				if (!Running)
+				{
+					return;
+				}
+
+				ReadQueue.push(std::move(Task));
+			}
+
+			ReadAvailable.notify_one();
+		}
+
+		std::future<int> CConnectionPool::WriteAsync(TWriteTask && Task)
+		{
+			WriteEntry Entry;
+			{
+				Entry.Task = std::move(Task);
+			}
+
+			std::future<int> Result = Entry.Result.get_future();
+
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+
+				if (!Running)
+				{
+					Entry.Result.set_value(SQLITE_MISUSE);
+					return Result;
+				}
+
+				if (!Writer)
+				{
+					Entry.Result.set_value(SQLITE_READONLY);
+					return Result;
+				}
+
+				WriteQueue.push(std::move(Entry));
+			}
+
+			WriteAvailable.notify_one();
+
+			return Result;
+		}
+
+		int CConnectionPool::Flush()
+		{
+			return WriteAsync([](CDatabase &)
+			{
+				return SQLITE_OK;
+			}).get();
+		}
+
+		void CConnectionPool::ReaderMain(CDatabase & Connection)
+		{
+			std::unique_lock<TMutex> Lock(Mutex);
+
+			for (;;)
+			{
+				ReadAvailable.wait(Lock, [this]()
+				{
+					return Stopping || !ReadQueue.empty();
+				});
+
+				if (Stopping)
+				{
+					return;
+				}
+
+				TReadTask Task = std::move(ReadQueue.front());
+				{
+					ReadQueue.pop();
+				}
+
+				Lock.unlock();
+
+				const auto Start = std::chrono::high_resolution_clock::now();
+				{
+					Task(Connection);
+				}
+
+				const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+				Lock.lock();
+
+				Stats.NumReads++;
+				Stats.ReadMicroseconds += Elapsed;
+			}
+		}
+
+		void CConnectionPool::WriterMain()
+		{
+			std::unique_lock<TMutex> Lock(Mutex);
+
+			for (;;)
+			{
+				WriteAvailable.wait(Lock, [this]()
+				{
+					return Stopping || !WriteQueue.empty();
+				});
+
+				// Writes still queued on stop are committed first.
+
+				if (WriteQueue.empty())
+				{
+					return;
+				}
+
+				if (!Stopping && WriteQueue.size() < Options.MaxBatchSize)
+				{
+					WriteAvailable.wait_for(Lock, std::chrono::microseconds(Options.BatchMicroseconds), [this]()
+					{
+						return Stopping || WriteQueue.size() >= Options.MaxBatchSize;
+					});
+				}
+
+				TVector<WriteEntry> Batch;
+				{
+					while (!WriteQueue.empty() && Batch.size() < std::max(1u, Options.MaxBatchSize))
+					{
+						Batch.push_back(std::move(WriteQueue.front()));
+						WriteQueue.pop();
+					}
+				}
+
+				Lock.unlock();
+
+				const auto Start = std::chrono::high_resolution_clock::now();
+
+				TVector<int>				Results(Batch.size(), SQLITE_OK);
+				TVector<std::exception_ptr>	Exceptions(Batch.size());
+
+				DataSet Ignored;
+
+				int ErrorCode = Writer->ExecutePrepared("BEGIN IMMEDIATE", Ignored);
+
+				if (ErrorCode == SQLITE_OK)
+				{
+					// Every write gets a savepoint, a failing one is rolled back alone.
+
+					for (size_t N = 0; N < Batch.size(); ++N)
+					{
+						if ((Results[N] = Writer->ExecutePrepared("SAVEPOINT PoolWrite", Ignored)) != SQLITE_OK)
+						{
+							continue;
+						}
+
+						try
+						{
+							Results[N] = Batch[N].Task(*Writer);
+						}
+						catch (...)
+						{
+							Results[N]		= SQLITE_ABORT;
+							Exceptions[N]	= std::current_exception();
+						}
+
+						if (Results[N] != SQLITE_OK)
+						{
+							Writer->ExecutePrepared("ROLLBACK TO PoolWrite", Ignored);
+						}
+
+						Writer->ExecutePrepared("RELEASE PoolWrite", Ignored);
+					}
+
+					if ((ErrorCode = Writer->ExecutePrepared("COMMIT", Ignored)) != SQLITE_OK)
+					{
+						Writer->ExecutePrepared("ROLLBACK", Ignored);
+					}
+				}
+
+				const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+				Uint64 NumFailed = 0;
+
+				for (size_t N = 0; N < Batch.size(); ++N)
+				{
+					if (ErrorCode != SQLITE_OK)
+					{
+						Results[N]		= ErrorCode;
+						Exceptions[N]	= NULL;
+					}
+
+					if (Results[N] != SQLITE_OK)
+					{
+						NumFailed++;
+					}
+
+					if (Exceptions[N])
+					{
+						Batch[N].Result.set_exception(Exceptions[N]);
+					}
+					else
+					{
+						Batch[N].Result.set_value(Results[N]);
+					}
+				}
+
+				Lock.lock();
+
+				Stats.NumWrites			+= Batch.size();
+				Stats.NumFailedWrites	+= NumFailed;
+				Stats.NumBatches++;
+				Stats.MaxBatchSize		 = std::max<Uint64>(Stats.MaxBatchSize, Batch.size());
+				Stats.WriteMicroseconds	+= Elapsed;
+			}
+		}
+
+		ConnectionPoolStats CConnectionPool::GetStats() const
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				return Stats;
+			}
+		}
+	
+		SharedPointer<CConnectionPool> CConnectionPoolManager::OpenPool(const String & Path, const bool ReadOnly)
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+
+			auto Pool = OpenedPools.find(Path);
+			{
+				if (Pool != OpenedPools.end())
+				{
+					return Pool->second;
+				}
+			}
+
+			TMap<String, SharedPointer<CConnectionPool> > & Pools = ReadOnly ? OpenedReadOnlyPools : OpenedPools;
+
+			if (ReadOnly)
+			{
+				auto ReadOnlyPool = Pools.find(Path);
+				{
+					if (ReadOnlyPool != Pools.end())
+					{
+						return ReadOnlyPool->second;
+					}
+				}
+			}
+
+			CConnectionPool::InitializeOptions Options;
+			{
+				Options.Path		= Path;
+				Options.ReadOnly	= ReadOnly;
+			}
+
+			SharedPointer<CConnectionPool> ConnectionPool = new CConnectionPool();
+
+			if (ConnectionPool->Initialize(Options) != SQLITE_OK)
+			{
+				return NULL;
+			}
+
+			Pools[Path] = ConnectionPool;
+
+			return ConnectionPool;
+		}
+	}
+}
\ No newline at end of file
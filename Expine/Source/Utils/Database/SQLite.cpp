@@ -28,8 +28,120 @@ namespace Database
 			return 0;
 		}
 
+		CStatement::CStatement(sqlite3_stmt * Statement, const String & Query) :
+			Statement(Statement)
+		{
+			Stats.Query = Query;
+		}
+
+		CStatement::~CStatement()
+		{
+			sqlite3_finalize(Statement);
+		}
+
+		void CStatement::Reset()
+		{
+			sqlite3_reset(Statement);
+			sqlite3_clear_bindings(Statement);
+		}
+
+		int CRow::FindColumn(const char * Name) const
+		{
+			const int Columns = GetColumnCount();
+
+			for (int C = 0; C < Columns; ++C)
+			{
+				if (sqlite3_stricmp(sqlite3_column_name(Statement, C), Name) == 0)
+				{
+					return C;
+				}
+			}
+
+			return -1;
+		}
+
+		CCursor::CCursor(CCursor && Other)
+		{
+			*this = std::move(Other);
+		}
+
+		CCursor & CCursor::operator=(CCursor && Other)
+		{
+			if (this != &Other)
+			{
+				Close();
+
+				Lock			= std::move(Other.Lock);
+				Statement		= Other.Statement;
+				Row				= Other.Row;
+				ErrorCode		= Other.ErrorCode;
+				NumRows			= Other.NumRows;
+				Microseconds	= Other.Microseconds;
+
+				Other.Statement = NULL;
+			}
+
+			return *this;
+		}
+
+		CCursor::~CCursor()
+		{
+			Close();
+		}
+
+		bool CCursor::Next()
+		{
+			if (Statement == NULL)
+			{
+				return false;
+			}
+
+			const auto Start = std::chrono::high_resolution_clock::now();
+
+			const int Result = sqlite3_step(Statement->Get());
+
+			Microseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+			if (Result == SQLITE_ROW)
+			{
+				NumRows++;
+				return true;
+			}
+
+			ErrorCode = Result == SQLITE_DONE ? SQLITE_OK : Result;
+
+			Close();
+
+			return false;
+		}
+
+		void CCursor::Close()
+		{
+			if (Statement)
+			{
+				Statement->Reset();
+
+				Statement->Stats.NumExecutions++;
+				Statement->Stats.NumRows			+= NumRows;
+				Statement->Stats.TotalMicroseconds	+= Microseconds;
+				Statement->Stats.MaxMicroseconds	 = std::max(Statement->Stats.MaxMicroseconds, Microseconds);
+
+				Statement	= NULL;
+				Row			= CRow();
+			}
+
+			if (Lock.owns_lock())
+			{
+				Lock.unlock();
+			}
+		}
+
 		CDatabase::~CDatabase()
 		{
+			// Unfinalized statements keep the connection open.
+
+			Statements.clear();
+
 			if (Database)
 			{
 				sqlite3_close(Database);
@@ -46,6 +158,16 @@ namespace Database
 			return sqlite3_open(Path.c_str(), &Database);
 		}
 
+		int CDatabase::OpenDB(const String & Path, const int Flags)
+		{
+			return sqlite3_open_v2(Path.c_str(), &Database, Flags, NULL);
+		}
+
+		int CDatabase::SetBusyTimeout(const int Milliseconds)
+		{
+			return sqlite3_busy_timeout(Database, Milliseconds);
+		}
+
 		int CDatabase::Execute(const String & Query, DataSet & QueryResult)
 		{
 			std::scoped_lock<TMutex> Lock(ExecuteMutex);
@@ -69,75 +191,172 @@ namespace Database
 			return Result;
 		}
 
-		int CDatabase::ExecutePrepared(const String & Query, DataSet & QueryResult)
+		int CDatabase::Prepare(const String & Query, CStatement *& Statement)
 		{
+			auto Cached = Statements.find(Query);
+
+			if (Cached != Statements.end())
+			{
+				Statement = Cached->second.get();
+				Statement->LastUsed = ++StatementUses;
+
+				return SQLITE_OK;
+			}
+
+			if (Statements.size() >= MaxStatements)
+			{
+				auto Oldest = Statements.begin();
+
+				for (auto Iter = Statements.begin(); Iter != Statements.end(); ++Iter)
+				{
+					if (Iter->second->LastUsed < Oldest->second->LastUsed)
+					{
+						Oldest = Iter;
+					}
+				}
+
+				Statements.erase(Oldest);
+			}
+
+			const auto Start = std::chrono::high_resolution_clock::now();
+
 			Int32 ErrorCode;
-			sqlite3_stmt *SelectStatement;
+			sqlite3_stmt * Prepared;
 
-			if ((ErrorCode = sqlite3_prepare_v2(Database, Query.c_str(), Query.size(), &SelectStatement, nullptr)) != SQLITE_OK)
+			if ((ErrorCode = sqlite3_prepare_v2(Database, Query.c_str(), static_cast<int>(Query.size()), &Prepared, nullptr)) != SQLITE_OK)
 			{
 				return ErrorCode;
 			}
 
-			Int32 Columns = sqlite3_column_count(SelectStatement);
+			// Empty or comment only queries compile to no statement.
 
-			TVector<String> ColumnNames(Columns);
+			if (Prepared == NULL)
 			{
-				for (Int32 C = 0; C < Columns; ++C)
-				{
-					ColumnNames[C] = sqlite3_column_name(SelectStatement, C);
-				}
+				return SQLITE_MISUSE;
 			}
 
+			auto & Entry = Statements[Query];
+			{
+				Entry.reset(new CStatement(Prepared, Query));
+			}
+
+			Statement = Entry.get();
+			Statement->LastUsed = ++StatementUses;
+			Statement->Stats.PrepareMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+			return SQLITE_OK;
+		}
+
+		int CDatabase::Fetch(CStatement & Statement, DataSet & QueryResult)
+		{
+			const auto Start = std::chrono::high_resolution_clock::now();
+
+			sqlite3_stmt * SelectStatement = Statement.Get();
+
+			Int32 ErrorCode;
+			Int32 Columns = sqlite3_column_count(SelectStatement);
+
+			Uint64 Rows = 0;
+
+			// Resolved on the first row, an empty result leaves the set untouched.
+
+			TVector<TVector<TVector<Byte> > *> Results;
+
 			while (true)
 			{
 				ErrorCode = sqlite3_step(SelectStatement);
 
-				if (ErrorCode == SQLITE_ROW)
+				if (ErrorCode != SQLITE_ROW)
+				{
+					break;
+				}
+
+				if (Rows++ == 0)
 				{
+					Results.resize(Columns);
+
+					// Inserting moves the values, so take the addresses once every column exists.
+
 					for (Int32 C = 0; C < Columns; ++C)
 					{
-						const Byte* Data = reinterpret_cast<const Byte*>(
-							sqlite3_column_blob(SelectStatement, C));
+						QueryResult[sqlite3_column_name(SelectStatement, C)];
+					}
 
-						if (!Data)
-						{
-							continue;
-						}
+					for (Int32 C = 0; C < Columns; ++C)
+					{
+						Results[C] = &QueryResult[sqlite3_column_name(SelectStatement, C)];
+					}
+				}
 
-						const Int32 DataLength = 
-							sqlite3_column_bytes(SelectStatement, C);
+				for (Int32 C = 0; C < Columns; ++C)
+				{
+					const Byte* Data = reinterpret_cast<const Byte*>(
+						sqlite3_column_blob(SelectStatement, C));
+
+					if (!Data)
+					{
+						continue;
+					}
 
-						auto & Result = QueryResult[ColumnNames[C]];
-						auto & ResultContainer = *Result.emplace(Result.end());
+					const Int32 DataLength = 
+						sqlite3_column_bytes(SelectStatement, C);
+
+					auto & Result = *Results[C];
+					auto & ResultContainer = *Result.emplace(Result.end());
 						
-						ResultContainer.reserve(DataLength + 1);
-						ResultContainer.insert(ResultContainer.end(),
-							Data,
-							Data + DataLength
-						);
+					ResultContainer.reserve(DataLength + 1);
+					ResultContainer.insert(ResultContainer.end(),
+						Data,
+						Data + DataLength
+					);
 
-						Byte * Last = ResultContainer.data() + ResultContainer.size();
+					Byte * Last = ResultContainer.data() + ResultContainer.size();
 
-						// Null termination
-						*Last = '\0';
-					}
-				}
-				else
-				{
-					break;
+					// Null termination
+					*Last = '\0';
 				}
 			}
 
+			Statement.Reset();
+
+			const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+			Statement.Stats.NumExecutions++;
+			Statement.Stats.NumRows				+= Rows;
+			Statement.Stats.TotalMicroseconds	+= Elapsed;
+			Statement.Stats.MaxMicroseconds		 = std::max(Statement.Stats.MaxMicroseconds, Elapsed);
+
 			if (ErrorCode != SQLITE_DONE)
 			{
-				sqlite3_finalize(SelectStatement);
 				return ErrorCode;
 			}
 
-			ErrorCode = sqlite3_finalize(SelectStatement);
+			return SQLITE_OK;
+		}
 
-			return ErrorCode;
+		TVector<StatementStats> CDatabase::GetStatementStats()
+		{
+			std::scoped_lock<TMutex> Lock(ExecuteMutex);
+
+			TVector<StatementStats> Result;
+			{
+				Result.reserve(Statements.size());
+			}
+
+			for (const auto & Entry : Statements)
+			{
+				Result.push_back(Entry.second->GetStats());
+			}
+
+			return Result;
+		}
+
+		void CDatabase::ClearStatements()
+		{
+			std::scoped_lock<TMutex> Lock(ExecuteMutex);
+			{
+				Statements.clear();
+			}
 		}
 
 		SharedPointer<CDatabase> CDatabaseManager::OpenDatabase(const WString & Path)
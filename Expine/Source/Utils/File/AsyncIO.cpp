@@ -0,0 +1,1229 @@
+#include "Utils/File/AsyncIO.h"
+
+#ifdef _WIN32
+#include <WindowsH.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace File
+{
+	struct CAsyncIO::Operation
+	{
+		TIOCallback	Callback;
+		Uint32		Remaining = 0;
+		bool		Failed = false;
+	};
+
+	struct CAsyncIO::Piece
+	{
+#ifdef _WIN32
+		// First member, completions hand back this address.
+
+		OVERLAPPED		Overlapped;
+#else
+		struct iovec	Vector;
+#endif
+		Operation *		Owner;
+		CAsyncFile *	File;
+		EIOPriority		Priority;
+
+		Uint64			Offset;
+		Uint64			Size;
+		Byte *			Destination;
+
+		// Direct pieces read a sector aligned range into a pooled buffer.
+
+		bool			Direct;
+		Int32			Buffer;
+
+		intptr_t		Handle;
+		Uint64			ReadOffset;
+		Uint32			ReadSize;
+		Byte *			ReadDestination;
+	};
+
+	class CAsyncIO::CBackend
+	{
+	public:
+
+		virtual ~CBackend() = default;
+
+		virtual const char * GetName() const = 0;
+
+		virtual bool Associate
+		(
+			const intptr_t Handle
+		)
+		{
+			return true;
+		}
+
+		// Queues the read described by the piece, issued by the next Flush at the latest.
+
+		virtual bool Submit
+		(
+			Piece & Target
+		) = 0;
+
+		virtual void Flush() = 0;
+
+		// Blocks until a read completed or Wake was called, results are byte counts or negative on failure.
+
+		virtual void Wait
+		(
+			TVector<TPair<Piece*, Int64> > & Completed
+		) = 0;
+
+		virtual void Wake() = 0;
+	};
+
+	namespace
+	{
+		inline Uint64 AlignUp(const Uint64 Value, const Uint64 Alignment)
+		{
+			return (Value + Alignment - 1) & ~(Alignment - 1);
+		}
+
+		Byte * AllocateAligned(const size_t Size)
+		{
+#ifdef _WIN32
+			return static_cast<Byte*>(_aligned_malloc(Size, CAsyncIO::SectorSize));
+#else
+			void * Memory = NULL;
+
+			if (posix_memalign(&Memory, CAsyncIO::SectorSize, Size) != 0)
+			{
+				return NULL;
+			}
+
+			return static_cast<Byte*>(Memory);
+#endif
+		}
+
+		void FreeAligned(Byte * Memory)
+		{
+#ifdef _WIN32
+			_aligned_free(Memory);
+#else
+			free(Memory);
+#endif
+		}
+
+#ifdef _WIN32
+		class CBackendCompletionPort : public CAsyncIO::CBackend
+		{
+		private:
+
+			HANDLE Port = NULL;
+
+		public:
+
+			~CBackendCompletionPort()
+			{
+				if (Port)
+				{
+					CloseHandle(Port);
+				}
+			}
+
+			bool Create()
+			{
+				return (Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1)) != NULL;
+			}
+
+			virtual const char * GetName() const override
+			{
+				return "IOCP";
+			}
+
+			virtual bool Associate(const intptr_t Handle) override
+			{
+				return CreateIoCompletionPort(reinterpret_cast<HANDLE>(Handle), Port, 0, 0) == Port;
+			}
+
+			virtual bool Submit(CAsyncIO::Piece & Target) override
+			{
+				ZeroMemory(&Target.Overlapped, sizeof(Target.Overlapped));
+				{
+					Target.Overlapped.Offset		= static_cast<DWORD>(Target.ReadOffset);
+					Target.Overlapped.OffsetHigh	= static_cast<DWORD>(Target.ReadOffset >> 32);
+				}
+
+				// Reads finishing right away still post their completion.
+
+				if (!ReadFile(reinterpret_cast<HANDLE>(Target.Handle), Target.ReadDestination, Target.ReadSize, NULL, &Target.Overlapped))
+				{
+					return GetLastError() == ERROR_IO_PENDING;
+				}
+
+				return true;
+			}
+
+			virtual void Flush() override
+			{
+			}
+
+			virtual void Wait(TVector<TPair<CAsyncIO::Piece*, Int64> > & Completed) override
+			{
+				OVERLAPPED_ENTRY	Entries[64];
+				ULONG				NumEntries = 0;
+
+				if (!GetQueuedCompletionStatusEx(Port, Entries, 64, &NumEntries, INFINITE, FALSE))
+				{
+					return;
+				}
+
+				for (ULONG N = 0; N < NumEntries; ++N)
+				{
+					// Wake ups carry no overlapped structure.
+
+					if (!Entries[N].lpOverlapped)
+					{
+						continue;
+					}
+
+					CAsyncIO::Piece * Target = reinterpret_cast<CAsyncIO::Piece*>(Entries[N].lpOverlapped);
+
+					const bool Succeeded = Target->Overlapped.Internal == 0;
+
+					Completed.emplace_back(Target, Succeeded ? static_cast<Int64>(Entries[N].dwNumberOfBytesTransferred) : -1);
+				}
+			}
+
+			virtual void Wake() override
+			{
+				PostQueuedCompletionStatus(Port, 0, 0, NULL);
+			}
+		};
+#else
+		// Portable fallback, blocking reads on a few threads.
+
+		class CBackendThreads : public CAsyncIO::CBackend
+		{
+		private:
+
+			TVector<std::thread>				Workers;
+
+			TMutex								Mutex;
+			std::condition_variable				Requested;
+			std::condition_variable				Finished;
+
+			TDeque<CAsyncIO::Piece*>			Queue;
+			TVector<TPair<CAsyncIO::Piece*, Int64> > Results;
+
+			bool								Woken = false;
+			bool								Stopping = false;
+
+		private:
+
+			void Work()
+			{
+				for (;;)
+				{
+					CAsyncIO::Piece * Target;
+					{
+						std::unique_lock<TMutex> Lock(Mutex);
+
+						Requested.wait(Lock, [this] { return Stopping || !Queue.empty(); });
+
+						if (Queue.empty())
+						{
+							return;
+						}
+
+						Target = Queue.front();
+						Queue.pop_front();
+					}
+
+					Int64 Result = 0;
+
+					while (Result < Target->ReadSize)
+					{
+						const ssize_t Bytes = pread(static_cast<int>(Target->Handle), Target->ReadDestination + Result, Target->ReadSize - Result, Target->ReadOffset + Result);
+
+						if (Bytes < 0)
+						{
+							Result = -1;
+							break;
+						}
+
+						if (Bytes == 0)
+						{
+							break;
+						}
+
+						Result += Bytes;
+					}
+
+					std::lock_guard<TMutex> Lock(Mutex);
+					{
+						Results.emplace_back(Target, Result);
+					}
+
+					Finished.notify_one();
+				}
+			}
+
+		public:
+
+			CBackendThreads(const Uint32 NumThreads)
+			{
+				for (Uint32 N = 0; N < NumThreads; ++N)
+				{
+					Workers.emplace_back(&CBackendThreads::Work, this);
+				}
+			}
+
+			~CBackendThreads()
+			{
+				{
+					std::lock_guard<TMutex> Lock(Mutex);
+					{
+						Stopping = true;
+					}
+				}
+
+				Requested.notify_all();
+
+				for (std::thread & Worker : Workers)
+				{
+					Worker.join();
+				}
+			}
+
+			virtual const char * GetName() const override
+			{
+				return "Threads";
+			}
+
+			virtual bool Submit(CAsyncIO::Piece & Target) override
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+				{
+					Queue.push_back(&Target);
+				}
+
+				Requested.notify_one();
+
+				return true;
+			}
+
+			virtual void Flush() override
+			{
+			}
+
+			virtual void Wait(TVector<TPair<CAsyncIO::Piece*, Int64> > & Completed) override
+			{
+				std::unique_lock<TMutex> Lock(Mutex);
+
+				Finished.wait(Lock, [this] { return Woken || !Results.empty(); });
+
+				Completed.insert(Completed.end(), Results.begin(), Results.end());
+				Results.clear();
+
+				Woken = false;
+			}
+
+			virtual void Wake() override
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+				{
+					Woken = true;
+				}
+
+				Finished.notify_one();
+			}
+		};
+
+#ifdef __linux__
+		class CBackendRing : public CAsyncIO::CBackend
+		{
+		private:
+
+			int						Ring = -1;
+			int						Event = -1;
+
+			// Pending read of the event descriptor, completes on Wake.
+
+			Uint64					EventValue = 0;
+			struct iovec			EventVector;
+			bool					EventArmed = false;
+
+			void *					SubmissionRing = MAP_FAILED;
+			void *					CompletionRing = MAP_FAILED;
+			io_uring_sqe *			Entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+			size_t					SubmissionRingSize = 0;
+			size_t					CompletionRingSize = 0;
+			size_t					EntriesSize = 0;
+
+			unsigned *				SubmissionHead;
+			unsigned *				SubmissionTail;
+			unsigned *				SubmissionMask;
+			unsigned *				SubmissionArray;
+			unsigned				SubmissionEntries = 0;
+
+			unsigned *				CompletionHead;
+			unsigned *				CompletionTail;
+			unsigned *				CompletionMask;
+			io_uring_cqe *			Completions;
+
+			Uint32					NumQueued = 0;
+			bool					FixedBuffers = false;
+
+		private:
+
+			io_uring_sqe * GetEntry()
+			{
+				const unsigned Head = __atomic_load_n(SubmissionHead, __ATOMIC_ACQUIRE);
+				const unsigned Tail = *SubmissionTail;
+
+				if (Tail - Head >= SubmissionEntries)
+				{
+					Flush();
+
+					if (Tail - __atomic_load_n(SubmissionHead, __ATOMIC_ACQUIRE) >= SubmissionEntries)
+					{
+						return NULL;
+					}
+				}
+
+				const unsigned Index = Tail & *SubmissionMask;
+
+				io_uring_sqe * Entry = &Entries[Index];
+				{
+					std::memset(Entry, 0, sizeof(*Entry));
+				}
+
+				SubmissionArray[Index] = Index;
+
+				return Entry;
+			}
+
+			void Push()
+			{
+				__atomic_store_n(SubmissionTail, *SubmissionTail + 1, __ATOMIC_RELEASE);
+
+				NumQueued++;
+			}
+
+			int Enter(const Uint32 MinComplete, const Uint32 Flags)
+			{
+				return static_cast<int>(syscall(__NR_io_uring_enter, Ring, NumQueued, MinComplete, Flags, NULL, 0));
+			}
+
+		public:
+
+			~CBackendRing()
+			{
+				if (Entries != MAP_FAILED)
+				{
+					munmap(Entries, EntriesSize);
+				}
+
+				if (CompletionRing != MAP_FAILED && CompletionRing != SubmissionRing)
+				{
+					munmap(CompletionRing, CompletionRingSize);
+				}
+
+				if (SubmissionRing != MAP_FAILED)
+				{
+					munmap(SubmissionRing, SubmissionRingSize);
+				}
+
+				if (Ring != -1)
+				{
+					close(Ring);
+				}
+
+				if (Event != -1)
+				{
+					close(Event);
+				}
+			}
+
+			bool Create(const Uint32 QueueDepth, Byte * Buffers, const Uint32 NumBuffers, const size_t BufferSize)
+			{
+				io_uring_params Params;
+				{
+					std::memset(&Params, 0, sizeof(Params));
+				}
+
+				// One more entry for the wake up read.
+
+				if ((Ring = static_cast<int>(syscall(__NR_io_uring_setup, QueueDepth + 1, &Params))) < 0)
+				{
+					return false;
+				}
+
+				SubmissionRingSize	= Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+				CompletionRingSize	= Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+				EntriesSize			= Params.sq_entries * sizeof(io_uring_sqe);
+
+				if (Params.features & IORING_FEAT_SINGLE_MMAP)
+				{
+					SubmissionRingSize = CompletionRingSize = std::max(SubmissionRingSize, CompletionRingSize);
+				}
+
+				SubmissionRing = mmap(NULL, SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQ_RING);
+
+				if (SubmissionRing == MAP_FAILED)
+				{
+					return false;
+				}
+
+				if (Params.features & IORING_FEAT_SINGLE_MMAP)
+				{
+					CompletionRing = SubmissionRing;
+				}
+				else if ((CompletionRing = mmap(NULL, CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_CQ_RING)) == MAP_FAILED)
+				{
+					return false;
+				}
+
+				Entries = static_cast<io_uring_sqe*>(mmap(NULL, EntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQES));
+
+				if (Entries == MAP_FAILED)
+				{
+					return false;
+				}
+
+				Byte * Submission = static_cast<Byte*>(SubmissionRing);
+				Byte * Completion = static_cast<Byte*>(CompletionRing);
+
+				SubmissionHead		= reinterpret_cast<unsigned*>(Submission + Params.sq_off.head);
+				SubmissionTail		= reinterpret_cast<unsigned*>(Submission + Params.sq_off.tail);
+				SubmissionMask		= reinterpret_cast<unsigned*>(Submission + Params.sq_off.ring_mask);
+				SubmissionArray		= reinterpret_cast<unsigned*>(Submission + Params.sq_off.array);
+				SubmissionEntries	= Params.sq_entries;
+
+				CompletionHead		= reinterpret_cast<unsigned*>(Completion + Params.cq_off.head);
+				CompletionTail		= reinterpret_cast<unsigned*>(Completion + Params.cq_off.tail);
+				CompletionMask		= reinterpret_cast<unsigned*>(Completion + Params.cq_off.ring_mask);
+				Completions			= reinterpret_cast<io_uring_cqe*>(Completion + Params.cq_off.cqes);
+
+				if ((Event = eventfd(0, EFD_CLOEXEC)) < 0)
+				{
+					return false;
+				}
+
+				// Registration pins the pool, it fails quietly under a low memlock limit.
+
+				if (Buffers && NumBuffers)
+				{
+					TVector<struct iovec> Vectors(NumBuffers);
+
+					for (Uint32 N = 0; N < NumBuffers; ++N)
+					{
+						Vectors[N].iov_base	= Buffers + N * BufferSize;
+						Vectors[N].iov_len	= BufferSize;
+					}
+
+					FixedBuffers = syscall(__NR_io_uring_register, Ring, IORING_REGISTER_BUFFERS, Vectors.data(), NumBuffers) == 0;
+				}
+
+				return true;
+			}
+
+			virtual const char * GetName() const override
+			{
+				return FixedBuffers ? "io_uring (registered buffers)" : "io_uring";
+			}
+
+			virtual bool Submit(CAsyncIO::Piece & Target) override
+			{
+				io_uring_sqe * Entry = GetEntry();
+
+				if (!Entry)
+				{
+					return false;
+				}
+
+				Entry->fd		= static_cast<int>(Target.Handle);
+				Entry->off		= Target.ReadOffset;
+				Entry->user_data	= reinterpret_cast<Uint64>(&Target);
+
+				if (FixedBuffers && Target.Buffer >= 0)
+				{
+					Entry->opcode		= IORING_OP_READ_FIXED;
+					Entry->addr			= reinterpret_cast<Uint64>(Target.ReadDestination);
+					Entry->len			= Target.ReadSize;
+					Entry->buf_index	= static_cast<Uint16>(Target.Buffer);
+				}
+				else
+				{
+					Target.Vector.iov_base	= Target.ReadDestination;
+					Target.Vector.iov_len	= Target.ReadSize;
+
+					Entry->opcode	= IORING_OP_READV;
+					Entry->addr		= reinterpret_cast<Uint64>(&Target.Vector);
+					Entry->len		= 1;
+				}
+
+				Push();
+
+				return true;
+			}
+
+			virtual void Flush() override
+			{
+				while (NumQueued > 0)
+				{
+					const int Submitted = Enter(0, 0);
+
+					if (Submitted < 0)
+					{
+						if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+						{
+							continue;
+						}
+
+						break;
+					}
+
+					NumQueued -= std::min<Uint32>(NumQueued, static_cast<Uint32>(Submitted));
+				}
+			}
+
+			virtual void Wait(TVector<TPair<CAsyncIO::Piece*, Int64> > & Completed) override
+			{
+				if (!EventArmed)
+				{
+					if (io_uring_sqe * Entry = GetEntry())
+					{
+						EventVector.iov_base	= &EventValue;
+						EventVector.iov_len		= sizeof(EventValue);
+
+						Entry->opcode		= IORING_OP_READV;
+						Entry->fd			= Event;
+						Entry->addr			= reinterpret_cast<Uint64>(&EventVector);
+						Entry->len			= 1;
+						Entry->user_data	= 0;
+
+						Push();
+
+						EventArmed = true;
+					}
+				}
+
+				while (Enter(1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR);
+
+				NumQueued = 0;
+
+				unsigned		Head = *CompletionHead;
+				const unsigned	Tail = __atomic_load_n(CompletionTail, __ATOMIC_ACQUIRE);
+
+				for (; Head != Tail; ++Head)
+				{
+					const io_uring_cqe & Entry = Completions[Head & *CompletionMask];
+
+					if (Entry.user_data == 0)
+					{
+						EventArmed = false;
+						continue;
+					}
+
+					Completed.emplace_back(reinterpret_cast<CAsyncIO::Piece*>(Entry.user_data), Entry.res < 0 ? -1 : static_cast<Int64>(Entry.res));
+				}
+
+				__atomic_store_n(CompletionHead, Head, __ATOMIC_RELEASE);
+			}
+
+			virtual void Wake() override
+			{
+				const Uint64 One = 1;
+
+				if (write(Event, &One, sizeof(One)) < 0)
+				{
+					// The counter only overflows if the thread is gone, nothing to wake then.
+				}
+			}
+		};
+#endif
+#endif
+	}
+
+	CAsyncFile::~CAsyncFile()
+	{
+		Close();
+	}
+
+#ifdef _WIN32
+	bool CAsyncFile::Open(const WString & Path)
+	{
+		Close();
+
+		CREATEFILE2_EXTENDED_PARAMETERS Parameters = {};
+		{
+			Parameters.dwSize				= sizeof(Parameters);
+			Parameters.dwFileAttributes		= FILE_ATTRIBUTE_NORMAL;
+			Parameters.dwFileFlags			= FILE_FLAG_OVERLAPPED;
+		}
+
+		HANDLE FileHandle = CreateFile2(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &Parameters);
+
+		if (FileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER FileSize;
+
+		if (!GetFileSizeEx(FileHandle, &FileSize))
+		{
+			CloseHandle(FileHandle);
+			return false;
+		}
+
+		Handle	= reinterpret_cast<intptr_t>(FileHandle);
+		Size	= static_cast<Uint64>(FileSize.QuadPart);
+
+		Parameters.dwFileFlags = FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING;
+
+		HANDLE Direct = CreateFile2(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &Parameters);
+
+		if (Direct != INVALID_HANDLE_VALUE)
+		{
+			DirectHandle = reinterpret_cast<intptr_t>(Direct);
+		}
+
+		return true;
+	}
+
+	void CAsyncFile::Close()
+	{
+		if (Handle != -1)
+		{
+			CloseHandle(reinterpret_cast<HANDLE>(Handle));
+		}
+
+		if (DirectHandle != -1)
+		{
+			CloseHandle(reinterpret_cast<HANDLE>(DirectHandle));
+		}
+
+		Handle			= -1;
+		DirectHandle	= -1;
+		Size			= 0;
+		Associated		= false;
+	}
+#else
+	bool CAsyncFile::Open(const WString & Path)
+	{
+		Close();
+
+		const String NarrowPath(Path.begin(), Path.end());
+
+		const int Descriptor = open(NarrowPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (Descriptor == -1)
+		{
+			return false;
+		}
+
+		struct stat FileStat;
+
+		if (fstat(Descriptor, &FileStat) != 0)
+		{
+			close(Descriptor);
+			return false;
+		}
+
+		Handle	= Descriptor;
+		Size	= static_cast<Uint64>(FileStat.st_size);
+
+#ifdef O_DIRECT
+		// Not every file system accepts direct access, tmpfs for one.
+
+		const int Direct = open(NarrowPath.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+
+		if (Direct != -1)
+		{
+			DirectHandle = Direct;
+		}
+#endif
+
+		return true;
+	}
+
+	void CAsyncFile::Close()
+	{
+		if (Handle != -1)
+		{
+			close(static_cast<int>(Handle));
+		}
+
+		if (DirectHandle != -1)
+		{
+			close(static_cast<int>(DirectHandle));
+		}
+
+		Handle			= -1;
+		DirectHandle	= -1;
+		Size			= 0;
+		Associated		= false;
+	}
+#endif
+
+	CAsyncIO::CAsyncIO()
+	{
+	}
+
+	CAsyncIO::~CAsyncIO()
+	{
+		Shutdown();
+	}
+
+	bool CAsyncIO::Initialize(const InitializeOptions & Options)
+	{
+		Shutdown();
+
+		if (Options.QueueDepth == 0 || Options.PieceSize == 0 || Options.PieceSize % SectorSize)
+		{
+			return false;
+		}
+
+		this->Options = Options;
+
+		const size_t BufferSize = Options.PieceSize + SectorSize;
+
+		if (Options.UseDirectIO && Options.NumBuffers)
+		{
+			if (!(BufferMemory = AllocateAligned(BufferSize * Options.NumBuffers)))
+			{
+				return false;
+			}
+
+			for (Uint32 N = 0; N < Options.NumBuffers; ++N)
+			{
+				FreeBuffers.push_back(N);
+			}
+		}
+
+#ifdef _WIN32
+		TUniquePtr<CBackendCompletionPort> Port(new CBackendCompletionPort());
+
+		if (Port->Create())
+		{
+			Backend = std::move(Port);
+		}
+#else
+#ifdef __linux__
+		TUniquePtr<CBackendRing> Ring(new CBackendRing());
+
+		if (Ring->Create(Options.QueueDepth, BufferMemory, static_cast<Uint32>(FreeBuffers.size()), BufferSize))
+		{
+			Backend = std::move(Ring);
+		}
+#endif
+		if (!Backend)
+		{
+			Backend.reset(new CBackendThreads(std::min<Uint32>(Options.QueueDepth, 8)));
+		}
+#endif
+
+		if (!Backend)
+		{
+			Shutdown();
+			return false;
+		}
+
+		Running	= true;
+		Thread	= std::thread(&CAsyncIO::Run, this);
+
+		return true;
+	}
+
+	void CAsyncIO::Shutdown()
+	{
+		if (Thread.joinable())
+		{
+			{
+				std::lock_guard<TMutex> Lock(QueueMutex);
+				{
+					Running = false;
+				}
+			}
+
+			Backend->Wake();
+			Thread.join();
+		}
+
+		Backend.reset();
+
+		if (BufferMemory)
+		{
+			FreeAligned(BufferMemory);
+		}
+
+		BufferMemory = NULL;
+		FreeBuffers.clear();
+	}
+
+	void CAsyncIO::Submit(IORequest * Requests, const size_t Count)
+	{
+		TVector<Piece*> Pieces;
+
+		for (size_t N = 0; N < Count; ++N)
+		{
+			IORequest & Request = Requests[N];
+
+			if (!Backend || !Request.File || !Request.File->IsOpen() || Request.Offset > Request.File->GetSize() || Request.Size > Request.File->GetSize() - Request.Offset)
+			{
+				if (Request.Callback)
+				{
+					Request.Callback(Backend ? ErrorRead : ErrorOpen);
+				}
+
+				std::lock_guard<TMutex> Lock(StatsMutex);
+				{
+					Stats.NumRequests++;
+					Stats.NumFailed++;
+				}
+
+				continue;
+			}
+
+			if (Request.Size == 0)
+			{
+				if (Request.Callback)
+				{
+					Request.Callback(ErrorNone);
+				}
+
+				continue;
+			}
+
+			const bool Direct =
+				BufferMemory &&
+				Request.File->HasDirectHandle() &&
+				Request.Size >= Options.DirectThreshold;
+
+			Operation * Owner = new Operation();
+			{
+				Owner->Callback		= std::move(Request.Callback);
+				Owner->Remaining	= static_cast<Uint32>((Request.Size + Options.PieceSize - 1) / Options.PieceSize);
+			}
+
+			for (Uint64 Offset = 0; Offset < Request.Size; Offset += Options.PieceSize)
+			{
+				Piece * Target = new Piece();
+				{
+					Target->Owner		= Owner;
+					Target->File		= Request.File;
+					Target->Priority	= Request.Priority;
+					Target->Offset		= Request.Offset + Offset;
+					Target->Size		= std::min<Uint64>(Options.PieceSize, Request.Size - Offset);
+					Target->Destination	= Request.Destination + Offset;
+					Target->Direct		= Direct;
+					Target->Buffer		= -1;
+				}
+
+				Pieces.push_back(Target);
+			}
+
+			std::lock_guard<TMutex> Lock(StatsMutex);
+			{
+				Stats.NumRequests++;
+				Stats.NumPieces += Owner->Remaining;
+
+				if (Direct)
+				{
+					Stats.NumDirectPieces += Owner->Remaining;
+				}
+			}
+		}
+
+		if (Pieces.empty())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+
+			for (Piece * Target : Pieces)
+			{
+				Pending[Target->Priority].push_back(Target);
+			}
+		}
+
+		Backend->Wake();
+	}
+
+	std::future<ErrorTypes> CAsyncIO::Read(CAsyncFile & File, const Uint64 Offset, const Uint64 Size, Byte * Destination, const EIOPriority Priority)
+	{
+		std::shared_ptr<std::promise<ErrorTypes> > Promise = std::make_shared<std::promise<ErrorTypes> >();
+
+		IORequest Request;
+		{
+			Request.File		= &File;
+			Request.Offset		= Offset;
+			Request.Size		= Size;
+			Request.Destination	= Destination;
+			Request.Priority	= Priority;
+			Request.Callback	= [Promise](const ErrorTypes Error)
+			{
+				Promise->set_value(Error);
+			};
+		}
+
+		std::future<ErrorTypes> Result = Promise->get_future();
+
+		Submit(&Request, 1);
+
+		return Result;
+	}
+
+	void CAsyncIO::Dispatch()
+	{
+		TVector<Piece*> Issued;
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+
+			while (InFlight < Options.QueueDepth)
+			{
+				Piece * Target = NULL;
+
+				for (TDeque<Piece*> & Queue : Pending)
+				{
+					if (!Queue.empty())
+					{
+						Target = Queue.front();
+						break;
+					}
+				}
+
+				if (!Target)
+				{
+					break;
+				}
+
+				// Direct pieces wait for a buffer, everything behind them waits as well to keep the order.
+
+				if (Target->Direct && Target->Buffer < 0)
+				{
+					if (FreeBuffers.empty())
+					{
+						break;
+					}
+
+					Target->Buffer = static_cast<Int32>(FreeBuffers.back());
+					FreeBuffers.pop_back();
+				}
+
+				Pending[Target->Priority].pop_front();
+
+				Issued.push_back(Target);
+				InFlight++;
+			}
+		}
+
+		if (Issued.empty())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(StatsMutex);
+			{
+				Stats.MaxInFlight = std::max(Stats.MaxInFlight, InFlight);
+			}
+		}
+
+		for (Piece * Target : Issued)
+		{
+			CAsyncFile & File = *Target->File;
+
+			if (!File.Associated)
+			{
+				File.Associated =
+					Backend->Associate(File.Handle) &&
+					(File.DirectHandle == -1 || Backend->Associate(File.DirectHandle));
+			}
+
+			if (Target->Direct)
+			{
+				Target->Handle			= File.DirectHandle;
+				Target->ReadOffset		= Target->Offset & ~Uint64(SectorSize - 1);
+				Target->ReadSize		= static_cast<Uint32>(AlignUp(Target->Offset + Target->Size - Target->ReadOffset, SectorSize));
+				Target->ReadDestination	= GetBuffer(Target->Buffer);
+			}
+			else
+			{
+				Target->Handle			= File.Handle;
+				Target->ReadOffset		= Target->Offset;
+				Target->ReadSize		= static_cast<Uint32>(Target->Size);
+				Target->ReadDestination	= Target->Destination;
+			}
+
+			if (!File.Associated || !Backend->Submit(*Target))
+			{
+				Complete(Target, -1);
+			}
+		}
+
+		Backend->Flush();
+	}
+
+	void CAsyncIO::Complete(Piece * Target, const Int64 Result)
+	{
+		Operation * Owner = Target->Owner;
+
+		bool Requeue = false;
+
+		if (Result < 0)
+		{
+			Owner->Failed = true;
+		}
+		else if (Target->Direct)
+		{
+			const Uint64 Skip = Target->Offset - Target->ReadOffset;
+
+			if (static_cast<Uint64>(Result) >= Skip + Target->Size)
+			{
+				std::memcpy(Target->Destination, Target->ReadDestination + Skip, static_cast<size_t>(Target->Size));
+			}
+			else
+			{
+				Owner->Failed = true;
+			}
+		}
+		else if (static_cast<Uint64>(Result) < Target->Size)
+		{
+			// Short reads continue where they stopped, a read of zero means the file shrank.
+
+			if (Result == 0)
+			{
+				Owner->Failed = true;
+			}
+			else
+			{
+				Target->Offset		+= Result;
+				Target->Size		-= Result;
+				Target->Destination	+= Result;
+
+				Requeue = true;
+			}
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(QueueMutex);
+
+			InFlight--;
+
+			if (Target->Buffer >= 0)
+			{
+				FreeBuffers.push_back(static_cast<Uint32>(Target->Buffer));
+				Target->Buffer = -1;
+			}
+
+			if (Requeue)
+			{
+				Pending[Target->Priority].push_front(Target);
+			}
+		}
+
+		if (Result > 0)
+		{
+			std::lock_guard<TMutex> Lock(StatsMutex);
+			{
+				Stats.BytesRead += Target->Direct ? std::min<Uint64>(Target->Size, Result) : Result;
+			}
+		}
+
+		if (Requeue)
+		{
+			return;
+		}
+
+		delete Target;
+
+		if (--Owner->Remaining == 0)
+		{
+			Finish(Owner);
+		}
+	}
+
+	void CAsyncIO::Finish(Operation * Target)
+	{
+		if (Target->Failed)
+		{
+			std::lock_guard<TMutex> Lock(StatsMutex);
+			{
+				Stats.NumFailed++;
+			}
+		}
+
+		if (Target->Callback)
+		{
+			Target->Callback(Target->Failed ? ErrorRead : ErrorNone);
+		}
+
+		delete Target;
+	}
+
+	void CAsyncIO::Run()
+	{
+		TVector<TPair<Piece*, Int64> > Completed;
+
+		for (;;)
+		{
+			Dispatch();
+
+			{
+				std::lock_guard<TMutex> Lock(QueueMutex);
+
+				bool Idle = InFlight == 0;
+
+				for (const TDeque<Piece*> & Queue : Pending)
+				{
+					Idle = Idle && Queue.empty();
+				}
+
+				// Stops once everything submitted before Shutdown has finished.
+
+				if (!Running && Idle)
+				{
+					break;
+				}
+			}
+
+			Completed.clear();
+
+			Backend->Wait(Completed);
+
+			for (const auto & Result : Completed)
+			{
+				Complete(Result.first, Result.second);
+			}
+		}
+	}
+
+	IOStats CAsyncIO::GetStats()
+	{
+		std::lock_guard<TMutex> Lock(StatsMutex);
+		{
+			return Stats;
+		}
+	}
+
+	const char * CAsyncIO::GetBackendName() const
+	{
+		return Backend ? Backend->GetName() : "None";
+	}
+}
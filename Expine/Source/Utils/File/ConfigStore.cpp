@@ -0,0 +1,1272 @@
+#include "Utils/File/ConfigStore.h"
+#include "Utils/File/File.h"
+#include "Utils/File/FileSystemWatcher.h"
+#include "Utils/Parsing/NumberParsing.h"
+#include "Utils/Parsing/RapidXML.h"
+#include "Utils/Shader/ShaderCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <iomanip>
+
+namespace File
+{
+	namespace
+	{
+		static constexpr Uint32 CacheMagic = 0x47464E43; // CNFG
+		static constexpr Uint32 CacheVersion = 2;
+
+		struct CacheHeader
+		{
+			Uint32	Magic;
+			Uint32	Version;
+			Uint64	SourceTime;
+			Uint64	SourceSize;
+			Uint64	ContentHash;
+
+			// Entries are stored as they are in memory.
+
+			Uint32	EntrySize;
+			Uint32	Reserved;
+		};
+
+		struct TableHeader
+		{
+			Uint64	NumEntries;
+			Uint64	PoolSize;
+		};
+
+		inline bool IsSpace(const char Character)
+		{
+			return Character == ' ' || Character == '\t' || Character == '\r' || Character == '\n';
+		}
+
+		inline std::string_view Trim(std::string_view Text)
+		{
+			while (!Text.empty() && IsSpace(Text.front()))
+			{
+				Text.remove_prefix(1);
+			}
+
+			while (!Text.empty() && IsSpace(Text.back()))
+			{
+				Text.remove_suffix(1);
+			}
+
+			return Text;
+		}
+
+		inline bool EqualsNoCase(const StringView & Text, const char * Literal)
+		{
+			size_t N = 0;
+
+			for (; N < Text.size() && Literal[N]; ++N)
+			{
+				if (std::tolower(static_cast<unsigned char>(Text[N])) != Literal[N])
+				{
+					return false;
+				}
+			}
+
+			return N == Text.size() && Literal[N] == 0;
+		}
+
+		// Hexadecimal text has to be followed by a null character, the pool keeps one after every value.
+
+		void ConvertValue(const char * Text, const size_t Length, CConfigTable::Entry & Value)
+		{
+			Value.Type		= ConfigValueString;
+			Value.Integer	= 0;
+			Value.Real		= 0.0;
+
+			if (Length == 0)
+			{
+				return;
+			}
+
+			const StringView View(Text, Length);
+
+			if (EqualsNoCase(View, "true") || EqualsNoCase(View, "false"))
+			{
+				Value.Type		= ConfigValueBool;
+				Value.Integer	= View.size() == 4 ? 1 : 0;
+				Value.Real		= static_cast<double>(Value.Integer);
+
+				return;
+			}
+
+			if (Length > 2 && Text[0] == '0' && (Text[1] == 'x' || Text[1] == 'X'))
+			{
+				char * End;
+
+				errno = 0;
+
+				const Uint64 Integer = std::strtoull(Text + 2, &End, 16);
+
+				if (End == Text + Length && errno == 0)
+				{
+					Value.Type		= ConfigValueInt;
+					Value.Integer	= static_cast<Int64>(Integer);
+					Value.Real		= static_cast<double>(Value.Integer);
+				}
+
+				return;
+			}
+
+			if (Parsing::TryParse(View, Value.Integer))
+			{
+				Value.Type	= ConfigValueInt;
+				Value.Real	= static_cast<double>(Value.Integer);
+
+				return;
+			}
+
+			if (Parsing::TryParse(View, Value.Real))
+			{
+				Value.Type		= ConfigValueFloat;
+				Value.Integer	= std::fabs(Value.Real) < 9.2e18 ? static_cast<Int64>(Value.Real) : 0;
+
+				return;
+			}
+
+			Value.Integer	= 0;
+			Value.Real		= 0.0;
+		}
+
+		inline bool IsLess(const CConfigTable & Table, const CConfigTable::Entry & Left, const CConfigTable::Entry & Right)
+		{
+			if (Left.KeyHash != Right.KeyHash)
+			{
+				return Left.KeyHash < Right.KeyHash;
+			}
+
+			return Table.GetKey(Left) < Table.GetKey(Right);
+		}
+
+		// Absolute, with forward slashes and without "." or ".." parts, so a config
+		// and the watched directory it lies in compare equal however they were spelled.
+
+		WString CanonicalizePath(const WStringView & Path)
+		{
+			std::experimental::filesystem::path Absolute(ShaderCache::NormalizePath(Path).c_str());
+
+			if (Absolute.is_relative())
+			{
+				std::error_code Error;
+
+				const std::experimental::filesystem::path Current = std::experimental::filesystem::current_path(Error);
+
+				if (!Error)
+				{
+					Absolute = Current / Absolute;
+				}
+			}
+
+			const WString Combined = ShaderCache::NormalizePath(WString(Absolute.wstring()));
+
+			// The drive and leading slashes are kept as they are.
+
+			size_t Root = Combined.size() >= 2 && Combined[1] == L':' ? 2 : 0;
+
+			while (Root < Combined.size() && Combined[Root] == L'/')
+			{
+				++Root;
+			}
+
+			TVector<WString> Parts;
+
+			for (size_t Begin = Root; Begin < Combined.size();)
+			{
+				size_t End = Combined.find(L'/', Begin);
+				{
+					End = End == WString::npos ? Combined.size() : End;
+				}
+
+				const WString Part(Combined, Begin, End - Begin);
+
+				if (Part == L"..")
+				{
+					if (!Parts.empty() && Parts.back() != L"..")
+					{
+						Parts.pop_back();
+					}
+					else if (Root == 0)
+					{
+						Parts.push_back(Part);
+					}
+				}
+				else if (!Part.empty() && Part != L".")
+				{
+					Parts.push_back(Part);
+				}
+
+				Begin = End + 1;
+			}
+
+			WString Result(Combined, 0, Root);
+
+			for (size_t N = 0; N < Parts.size(); ++N)
+			{
+				if (N > 0)
+				{
+					Result.push_back(L'/');
+				}
+
+				Result.append(Parts[N]);
+			}
+
+			return Result;
+		}
+	}
+
+	Uint64 CConfigTable::HashKey(const StringView & Key)
+	{
+		return ShaderCache::HashBytes(Key.data(), Key.size());
+	}
+
+	void CConfigTable::Add(const StringView & Key, const StringView & Value, const Uint32 Line)
+	{
+		Entry Added;
+		{
+			Added.KeyHash		= HashKey(Key);
+			Added.KeyOffset		= static_cast<Uint32>(Pool.size());
+			Added.KeyLength		= static_cast<Uint32>(Key.size());
+
+			Pool.append(Key.data(), Key.size()).push_back(0);
+
+			Added.ValueOffset	= static_cast<Uint32>(Pool.size());
+			Added.ValueLength	= static_cast<Uint32>(Value.size());
+
+			Pool.append(Value.data(), Value.size()).push_back(0);
+
+			Added.Line			= Line;
+		}
+
+		ConvertValue(Pool.data() + Added.ValueOffset, Added.ValueLength, Added);
+
+		Entries.push_back(Added);
+	}
+
+	bool CConfigTable::Finalize(TVector<ConfigError> & Errors)
+	{
+		std::stable_sort(Entries.begin(), Entries.end(), [this](const Entry & Left, const Entry & Right)
+		{
+			return IsLess(*this, Left, Right);
+		});
+
+		// The first definition of a key wins, later ones are reported.
+
+		bool Unique = true;
+
+		auto Last = std::unique(Entries.begin(), Entries.end(), [this, &Errors, &Unique](const Entry & Kept, const Entry & Duplicate)
+		{
+			if (Kept.KeyHash != Duplicate.KeyHash || GetKey(Kept) != GetKey(Duplicate))
+			{
+				return false;
+			}
+
+			ConfigError Error;
+			{
+				Error.Line		= Duplicate.Line;
+				Error.Key		= String(GetKey(Duplicate));
+				Error.Message	= "Key already exists.";
+			}
+
+			Errors.push_back(std::move(Error));
+
+			Unique = false;
+
+			return true;
+		});
+
+		Entries.erase(Last, Entries.end());
+
+		return Unique;
+	}
+
+	bool CConfigTable::ParseXML(char * Buffer, TVector<ConfigError> & Errors)
+	{
+		Entries.clear();
+		Pool.clear();
+
+		// Line starts are taken before the parser writes its terminators into the buffer.
+
+		TVector<size_t> LineBreaks;
+		{
+			for (size_t N = 0; Buffer[N]; ++N)
+			{
+				if (Buffer[N] == '\n')
+				{
+					LineBreaks.push_back(N);
+				}
+			}
+		}
+
+		const auto GetLine = [Buffer, &LineBreaks](const char * Position)
+		{
+			return static_cast<Uint32>(std::lower_bound(LineBreaks.begin(), LineBreaks.end(), static_cast<size_t>(Position - Buffer)) - LineBreaks.begin() + 1);
+		};
+
+		rapidxml::xml_document<char> Document;
+
+		try
+		{
+			Document.parse<rapidxml::parse_trim_whitespace | rapidxml::parse_validate_closing_tags>(Buffer);
+		}
+		catch (const rapidxml::parse_error & Exception)
+		{
+			ConfigError Error;
+			{
+				Error.Line		= GetLine(Exception.where<char>());
+				Error.Message	= Exception.what();
+			}
+
+			Errors.push_back(std::move(Error));
+
+			return false;
+		}
+
+		String Key;
+
+		const auto Visit = [this, &Key, &GetLine](const auto & Self, const rapidxml::xml_node<char> * Node) -> void
+		{
+			const size_t Length = Key.size();
+
+			for (const rapidxml::xml_attribute<char> * Attribute = Node->first_attribute(); Attribute; Attribute = Attribute->next_attribute())
+			{
+				Key.append(1, '@').append(Attribute->name(), Attribute->name_size());
+				{
+					Add(Key, StringView(Attribute->value(), Attribute->value_size()), GetLine(Attribute->name()));
+				}
+
+				Key.resize(Length);
+			}
+
+			THashMap<StringView, Uint32> Siblings;
+
+			bool HasElements = false;
+
+			for (const rapidxml::xml_node<char> * Child = Node->first_node(); Child; Child = Child->next_sibling())
+			{
+				if (Child->type() != rapidxml::node_element)
+				{
+					continue;
+				}
+
+				HasElements = true;
+
+				const StringView Name(Child->name(), Child->name_size());
+
+				const Uint32 Index = Siblings[Name]++;
+
+				Key.append(1, '.').append(Name.data(), Name.size());
+
+				if (Index > 0)
+				{
+					Key.append(1, '[').append(std::to_string(Index)).append(1, ']');
+				}
+
+				Self(Self, Child);
+
+				Key.resize(Length);
+			}
+
+			StringView Value(Node->value(), Node->value_size());
+
+			if (Value.empty())
+			{
+				if (const rapidxml::xml_node<char> * Data = Node->first_node())
+				{
+					if (Data->type() == rapidxml::node_cdata)
+					{
+						Value = StringView(Data->value(), Data->value_size());
+					}
+				}
+			}
+
+			// Elements holding only other elements have no value of their own.
+
+			if (!HasElements || !Value.empty())
+			{
+				Add(Key, Value, GetLine(Node->name()));
+			}
+		};
+
+		for (const rapidxml::xml_node<char> * Root = Document.first_node(); Root; Root = Root->next_sibling())
+		{
+			if (Root->type() == rapidxml::node_element)
+			{
+				Key.assign(Root->name(), Root->name_size());
+				{
+					Visit(Visit, Root);
+				}
+			}
+		}
+
+		return Finalize(Errors);
+	}
+
+	bool CConfigTable::ParseText(const StringView & Content, TVector<ConfigError> & Errors)
+	{
+		Entries.clear();
+		Pool.clear();
+
+		std::string_view Remaining = Content;
+
+		if (Remaining.substr(0, 3) == "\xEF\xBB\xBF")
+		{
+			Remaining.remove_prefix(3);
+		}
+
+		String Section;
+		String Key;
+
+		bool Valid = true;
+
+		for (Uint32 LineNumber = 1; !Remaining.empty(); ++LineNumber)
+		{
+			const size_t LineEnd = Remaining.find('\n');
+
+			const std::string_view Line = Trim(Remaining.substr(0, LineEnd));
+
+			Remaining.remove_prefix(LineEnd == std::string_view::npos ? Remaining.size() : LineEnd + 1);
+
+			if (Line.empty() || Line.front() == '#' || Line.front() == ';')
+			{
+				continue;
+			}
+
+			if (Line.front() == '[' && Line.back() == ']')
+			{
+				Section.assign(Trim(Line.substr(1, Line.size() - 2)));
+				continue;
+			}
+
+			const size_t Split = Line.find('=');
+
+			const std::string_view Name = Trim(Line.substr(0, Split));
+
+			if (Split == std::string_view::npos || Name.empty())
+			{
+				ConfigError Error;
+				{
+					Error.Line		= LineNumber;
+					Error.Message	= Split == std::string_view::npos ? "Expected '='." : "Expected a key before '='.";
+				}
+
+				Errors.push_back(std::move(Error));
+
+				Valid = false;
+
+				continue;
+			}
+
+			std::string_view Value = Trim(Line.substr(Split + 1));
+
+			// Quotes keep surrounding whitespace.
+
+			if (Value.size() >= 2 && Value.front() == '"' && Value.back() == '"')
+			{
+				Value = Value.substr(1, Value.size() - 2);
+			}
+
+			Key.clear();
+			{
+				if (!Section.empty())
+				{
+					Key.append(Section).append(1, '.');
+				}
+
+				Key.append(Name.data(), Name.size());
+			}
+
+			Add(Key, StringView(Value.data(), Value.size()), LineNumber);
+		}
+
+		return Finalize(Errors) && Valid;
+	}
+
+	void CConfigTable::Serialize(TVector<Byte> & Output) const
+	{
+		TableHeader Header;
+		{
+			Header.NumEntries	= Entries.size();
+			Header.PoolSize		= Pool.size();
+		}
+
+		const Byte * HeaderBytes	= reinterpret_cast<const Byte*>(&Header);
+		const Byte * EntryBytes		= reinterpret_cast<const Byte*>(Entries.data());
+
+		Output.insert(Output.end(), HeaderBytes, HeaderBytes + sizeof(Header));
+		Output.insert(Output.end(), EntryBytes, EntryBytes + Entries.size() * sizeof(Entry));
+		Output.insert(Output.end(), Pool.begin(), Pool.end());
+	}
+
+	bool CConfigTable::Deserialize(const Byte * Data, const size_t Size)
+	{
+		Entries.clear();
+		Pool.clear();
+
+		TableHeader Header;
+
+		if (Size < sizeof(Header))
+		{
+			return false;
+		}
+
+		std::memcpy(&Header, Data, sizeof(Header));
+
+		const size_t Remaining = Size - sizeof(Header);
+
+		if (Header.NumEntries > Remaining / sizeof(Entry) || Header.PoolSize != Remaining - Header.NumEntries * sizeof(Entry))
+		{
+			return false;
+		}
+
+		Data += sizeof(Header);
+
+		Entries.resize(static_cast<size_t>(Header.NumEntries));
+		{
+			std::memcpy(Entries.data(), Data, Entries.size() * sizeof(Entry));
+		}
+
+		Pool.assign(reinterpret_cast<const char*>(Data) + Entries.size() * sizeof(Entry), static_cast<size_t>(Header.PoolSize));
+
+		// Every key and value is followed by its null character.
+
+		for (const Entry & Value : Entries)
+		{
+			if (Value.Type > ConfigValueBool ||
+				static_cast<Uint64>(Value.KeyOffset) + Value.KeyLength >= Pool.size() ||
+				static_cast<Uint64>(Value.ValueOffset) + Value.ValueLength >= Pool.size())
+			{
+				Entries.clear();
+				Pool.clear();
+
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const CConfigTable::Entry * CConfigTable::Find(const StringView & Key) const
+	{
+		const Uint64 Hash = HashKey(Key);
+
+		auto Iter = std::lower_bound(Entries.begin(), Entries.end(), Hash, [](const Entry & Value, const Uint64 Hash)
+		{
+			return Value.KeyHash < Hash;
+		});
+
+		for (; Iter != Entries.end() && Iter->KeyHash == Hash; ++Iter)
+		{
+			if (GetKey(*Iter) == Key)
+			{
+				return &*Iter;
+			}
+		}
+
+		return NULL;
+	}
+
+	TVector<String> CConfigTable::Diff(const CConfigTable & Previous) const
+	{
+		TVector<String> Changed;
+
+		for (const Entry & Value : Entries)
+		{
+			const Entry * Before = Previous.Find(GetKey(Value));
+
+			if (Before == NULL || Previous.GetText(*Before) != GetText(Value))
+			{
+				Changed.emplace_back(GetKey(Value));
+			}
+		}
+
+		for (const Entry & Before : Previous.Entries)
+		{
+			if (Find(Previous.GetKey(Before)) == NULL)
+			{
+				Changed.emplace_back(Previous.GetKey(Before));
+			}
+		}
+
+		return Changed;
+	}
+
+	bool ValidateConfig(const CConfigTable & Table, const ConfigSchema & Schema, TVector<ConfigError> & Errors)
+	{
+		bool Valid = true;
+
+		for (const ConfigSchemaEntry & Expected : Schema)
+		{
+			const CConfigTable::Entry * Found = Table.Find(Expected.Key);
+
+			const char * Message = NULL;
+
+			if (Found == NULL)
+			{
+				if (Expected.Required)
+				{
+					Message = "Required key is missing.";
+				}
+			}
+			else switch (Expected.Type)
+			{
+				case ConfigValueInt:
+				{
+					if (Found->Type != ConfigValueInt)
+					{
+						Message = "Expected an integer.";
+					}
+
+					break;
+				}
+
+				case ConfigValueFloat:
+				{
+					if (Found->Type != ConfigValueInt && Found->Type != ConfigValueFloat)
+					{
+						Message = "Expected a number.";
+					}
+
+					break;
+				}
+
+				case ConfigValueBool:
+				{
+					if (Found->Type != ConfigValueBool)
+					{
+						Message = "Expected true or false.";
+					}
+
+					break;
+				}
+
+				default:
+				{
+					break;
+				}
+			}
+
+			if (Message == NULL && Found && (Expected.Type == ConfigValueInt || Expected.Type == ConfigValueFloat))
+			{
+				if (Found->Real < Expected.Min || Found->Real > Expected.Max)
+				{
+					Message = "Value is out of range.";
+				}
+			}
+
+			if (Message)
+			{
+				ConfigError Error;
+				{
+					Error.Line		= Found ? Found->Line : 0;
+					Error.Key		= Expected.Key;
+					Error.Message	= Message;
+				}
+
+				Errors.push_back(std::move(Error));
+
+				Valid = false;
+			}
+		}
+
+		return Valid;
+	}
+
+	CConfigStore::CConfigStore() = default;
+
+	CConfigStore::~CConfigStore()
+	{
+		Clear();
+	}
+
+	bool CConfigStore::Initialize(const InitializeOptions & Options)
+	{
+		Clear();
+
+		this->Options = Options;
+
+		if (!Options.UseCache)
+		{
+			return true;
+		}
+
+		std::error_code Error;
+
+		std::experimental::filesystem::create_directories(std::experimental::filesystem::path(Options.CacheDirectory.c_str()), Error);
+
+		return std::experimental::filesystem::is_directory(std::experimental::filesystem::path(Options.CacheDirectory.c_str()), Error);
+	}
+
+	WString CConfigStore::GetCachePath(const WString & Path) const
+	{
+		WStringStream Name;
+		{
+			Name << Options.CacheDirectory << L'/'
+				 << std::hex << std::setw(16) << std::setfill(L'0') << ShaderCache::HashBytes(Path.data(), Path.size() * sizeof(wchar_t))
+				 << L".bin";
+		}
+
+		return Name.str();
+	}
+
+	void CConfigStore::WriteCache(const WString & CachePath, const Uint64 SourceTime, const Uint64 SourceSize, const Uint64 ContentHash, const CConfigTable & Table) const
+	{
+		CacheHeader Header;
+		{
+			Header.Magic		= CacheMagic;
+			Header.Version		= CacheVersion;
+			Header.SourceTime	= SourceTime;
+			Header.SourceSize	= SourceSize;
+			Header.ContentHash	= ContentHash;
+			Header.EntrySize	= sizeof(CConfigTable::Entry);
+			Header.Reserved		= 0;
+		}
+
+		TVector<Byte> Content(sizeof(Header));
+		{
+			Table.Serialize(Content);
+		}
+
+		std::memcpy(Content.data(), &Header, sizeof(Header));
+
+		// Written beside the target and renamed, readers never see a partial cache.
+
+		WString Temporary = CachePath;
+		{
+			Temporary.append(L".tmp");
+		}
+
+		File::CFile Output(Temporary);
+		{
+			Output.GetContentRef().swap(Content);
+		}
+
+		const bool Written = Output.WriteFileContent() == File::ErrorNone;
+
+		Output.Close();
+
+		std::error_code Error;
+
+		if (Written)
+		{
+			std::experimental::filesystem::rename(std::experimental::filesystem::path(Temporary.c_str()), std::experimental::filesystem::path(CachePath.c_str()), Error);
+
+			if (!Error)
+			{
+				return;
+			}
+		}
+
+		std::experimental::filesystem::remove(std::experimental::filesystem::path(Temporary.c_str()), Error);
+	}
+
+	bool CConfigStore::ReadTable(const WString & Path, CConfigTable & Table, TVector<ConfigError> & Errors)
+	{
+		const std::experimental::filesystem::path SourcePath(Path.c_str());
+
+		std::error_code Error;
+
+		const Uint64 SourceSize = std::experimental::filesystem::file_size(SourcePath, Error);
+
+		if (Error)
+		{
+			ConfigError Missing;
+			{
+				Missing.Message = "Unable to access file.";
+			}
+
+			Errors.push_back(std::move(Missing));
+
+			return false;
+		}
+
+		const Uint64 SourceTime = static_cast<Uint64>(std::experimental::filesystem::last_write_time(SourcePath, Error).time_since_epoch().count());
+
+		const WString CachePath = GetCachePath(Path);
+
+		TVector<Byte>	Cached;
+		CacheHeader		Header = {};
+
+		bool HasCache = false;
+
+		if (Options.UseCache && File::DoesFileExist(CachePath))
+		{
+			File::CFile Input(CachePath);
+
+			if (Input.ReadFileContentInto(Cached) == File::ErrorNone && Cached.size() > sizeof(Header))
+			{
+				std::memcpy(&Header, Cached.data(), sizeof(Header));
+
+				HasCache =
+					Header.Magic		== CacheMagic	&&
+					Header.Version		== CacheVersion	&&
+					Header.EntrySize	== sizeof(CConfigTable::Entry);
+			}
+		}
+
+		// Unchanged write time, the source is not even read.
+
+		if (HasCache && Header.SourceTime == SourceTime && Header.SourceSize == SourceSize &&
+			Table.Deserialize(Cached.data() + sizeof(Header), Cached.size() - sizeof(Header)))
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumCacheHits++;
+			}
+
+			return true;
+		}
+
+		File::CFile Input(Path);
+
+		TVector<Byte> Content;
+
+		if (Input.ReadFileContentInto(Content) != File::ErrorNone)
+		{
+			ConfigError Unreadable;
+			{
+				Unreadable.Message = "Unable to read file.";
+			}
+
+			Errors.push_back(std::move(Unreadable));
+
+			return false;
+		}
+
+		const Uint64 ContentHash = ShaderCache::HashBytes(Content.data(), Content.size());
+
+		// Touched but unchanged, the cache is stamped with the new write time.
+
+		if (HasCache && Header.ContentHash == ContentHash && Header.SourceSize == Content.size() &&
+			Table.Deserialize(Cached.data() + sizeof(Header), Cached.size() - sizeof(Header)))
+		{
+			WriteCache(CachePath, SourceTime, Content.size(), ContentHash, Table);
+
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumContentHits++;
+			}
+
+			return true;
+		}
+
+		const auto Start = std::chrono::high_resolution_clock::now();
+
+		bool Parsed;
+
+		if (Path.size() >= 4 && std::equal(Path.end() - 4, Path.end(), L".xml", [](const wchar_t Left, const wchar_t Right)
+		{
+			return static_cast<wchar_t>(std::towlower(Left)) == Right;
+		}))
+		{
+			Content.push_back(0);
+			{
+				Parsed = Table.ParseXML(reinterpret_cast<char*>(Content.data()), Errors);
+			}
+		}
+		else
+		{
+			Parsed = Table.ParseText(StringView(reinterpret_cast<const char*>(Content.data()), Content.size()), Errors);
+		}
+
+		const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumParsed++;
+				Stats.ParseMicroseconds += Elapsed;
+			}
+		}
+
+		if (!Parsed)
+		{
+			return false;
+		}
+
+		if (Options.UseCache)
+		{
+			WriteCache(CachePath, SourceTime, SourceSize, ContentHash, Table);
+		}
+
+		return true;
+	}
+
+	bool CConfigStore::LoadDocument(const WString & Path, const ConfigSchema & Schema, TConfigTablePtr & Result, TVector<ConfigError> & Errors)
+	{
+		const auto Start = std::chrono::high_resolution_clock::now();
+
+		std::shared_ptr<CConfigTable> Table = std::make_shared<CConfigTable>();
+
+		const bool Loaded = ReadTable(Path, *Table, Errors) && ValidateConfig(*Table, Schema, Errors);
+
+		const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Stats.NumLoads++;
+		Stats.LoadMicroseconds += Elapsed;
+
+		if (!Loaded)
+		{
+			Stats.NumFailed++;
+			AddErrors(Path, Errors);
+
+			return false;
+		}
+
+		Result = std::move(Table);
+
+		return true;
+	}
+
+	void CConfigStore::AddErrors(const WString & Path, TVector<ConfigError> & Errors)
+	{
+		for (ConfigError & Error : Errors)
+		{
+			Error.Path = Path;
+			this->Errors.push_back(std::move(Error));
+		}
+
+		Errors.clear();
+	}
+
+	TConfigTablePtr CConfigStore::Load(const WString & Path)
+	{
+		const WString Normalized = CanonicalizePath(Path);
+
+		ConfigSchema Schema;
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			if (Document * Found = Documents.Find(Normalized))
+			{
+				if (Found->Table)
+				{
+					return Found->Table;
+				}
+
+				Schema = Found->Schema;
+			}
+		}
+
+		TConfigTablePtr			Table;
+		TVector<ConfigError>	LoadErrors;
+
+		if (!LoadDocument(Normalized, Schema, Table, LoadErrors))
+		{
+			return NULL;
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		// Another thread may have loaded it meanwhile, its table stays.
+
+		Document & Loaded = Documents[Normalized];
+		{
+			if (!Loaded.Table)
+			{
+				Loaded.Table = std::move(Table);
+			}
+		}
+
+		return Loaded.Table;
+	}
+
+	TConfigTablePtr CConfigStore::Get(const WString & Path) const
+	{
+		const WString Normalized = CanonicalizePath(Path);
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		const auto Iter = Documents.find(Normalized);
+
+		if (Iter != Documents.end())
+		{
+			return Iter->second.Table;
+		}
+
+		return NULL;
+	}
+
+	bool CConfigStore::SetSchema(const WString & Path, const ConfigSchema & Schema)
+	{
+		const WString Normalized = CanonicalizePath(Path);
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Document & Entry = Documents[Normalized];
+		{
+			Entry.Schema = Schema;
+		}
+
+		if (!Entry.Table)
+		{
+			return true;
+		}
+
+		// A loaded table is kept even when it does not match.
+
+		TVector<ConfigError> SchemaErrors;
+
+		if (!ValidateConfig(*Entry.Table, Schema, SchemaErrors))
+		{
+			AddErrors(Normalized, SchemaErrors);
+			return false;
+		}
+
+		return true;
+	}
+
+	Uint32 CConfigStore::Subscribe(const WString & Path, const TConfigChangeCallback & Callback)
+	{
+		const WString Normalized = CanonicalizePath(Path);
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		const Uint32 Handle = ++NextSubscription;
+		{
+			Documents[Normalized].Subscriptions.push_back({ Handle, Callback });
+			SubscriptionPaths[Handle] = Normalized;
+		}
+
+		return Handle;
+	}
+
+	void CConfigStore::Unsubscribe(const Uint32 Handle)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		const WString * Path = SubscriptionPaths.Find(Handle);
+
+		if (Path == NULL)
+		{
+			return;
+		}
+
+		if (Document * Found = Documents.Find(*Path))
+		{
+			Found->Subscriptions.erase(std::remove_if(Found->Subscriptions.begin(), Found->Subscriptions.end(), [Handle](const Subscription & Entry)
+			{
+				return Entry.Handle == Handle;
+			}), Found->Subscriptions.end());
+		}
+
+		SubscriptionPaths.erase(Handle);
+	}
+
+	bool CConfigStore::Watch(const WString & Directory)
+	{
+		WString Prefix = CanonicalizePath(Directory);
+
+		if (!Prefix.empty() && Prefix.back() != L'/')
+		{
+			Prefix.push_back(L'/');
+		}
+
+		TUniquePtr<CFileSystemWatcher> Watcher(new CFileSystemWatcher());
+
+		CFileSystemWatcher::InitializeOptions WatchOptions;
+		{
+			WatchOptions.Directory = Directory;
+		}
+
+		const bool Watching = Watcher->Initialize(WatchOptions, [this, Prefix](const FileChangeSet & Changes)
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			if (Changes.Overflow)
+			{
+				for (const auto & Entry : Documents)
+				{
+					if (Entry.first.compare(0, Prefix.size(), Prefix) == 0)
+					{
+						PendingReloads.insert(Entry.first);
+					}
+				}
+			}
+
+			for (const FileChange & Change : Changes.Changes)
+			{
+				if (Change.Type == FileChangeRemoved)
+				{
+					continue;
+				}
+
+				WString Path = Prefix;
+				{
+					Path.append(Change.Path);
+				}
+
+				Path = CanonicalizePath(Path);
+
+				if (Documents.count(Path))
+				{
+					PendingReloads.insert(std::move(Path));
+				}
+			}
+		});
+
+		if (!Watching)
+		{
+			return false;
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Watchers.push_back(std::move(Watcher));
+		}
+
+		return true;
+	}
+
+	void CConfigStore::Invalidate(const WString & Path)
+	{
+		const WString Normalized = CanonicalizePath(Path);
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		if (Documents.count(Normalized))
+		{
+			PendingReloads.insert(Normalized);
+		}
+	}
+
+	size_t CConfigStore::Update()
+	{
+		THashSet<WString> Reloads;
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Reloads.swap(PendingReloads);
+			}
+		}
+
+		size_t NumReloaded = 0;
+
+		for (const WString & Path : Reloads)
+		{
+			ConfigSchema Schema;
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+
+				Document * Found = Documents.Find(Path);
+
+				if (Found == NULL || !Found->Table)
+				{
+					continue;
+				}
+
+				Schema = Found->Schema;
+			}
+
+			TConfigTablePtr			Table;
+			TVector<ConfigError>	ReloadErrors;
+
+			if (!LoadDocument(Path, Schema, Table, ReloadErrors))
+			{
+				continue;
+			}
+
+			ConfigChange					Change;
+			TVector<TConfigChangeCallback>	Callbacks;
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+
+				Document * Found = Documents.Find(Path);
+
+				if (Found == NULL)
+				{
+					continue;
+				}
+
+				Change.Previous	= std::move(Found->Table);
+				Change.Current	= Table;
+				Found->Table	= std::move(Table);
+
+				for (const Subscription & Entry : Found->Subscriptions)
+				{
+					Callbacks.push_back(Entry.Callback);
+				}
+
+				Stats.NumReloads++;
+			}
+
+			NumReloaded++;
+
+			Change.Path			= Path;
+			Change.ChangedKeys	= Change.Current->Diff(Change.Previous ? *Change.Previous : CConfigTable());
+
+			// Saved without a change in content.
+
+			if (Change.ChangedKeys.empty())
+			{
+				continue;
+			}
+
+			for (const TConfigChangeCallback & Callback : Callbacks)
+			{
+				Callback(Change);
+			}
+		}
+
+		return NumReloaded;
+	}
+
+	TVector<ConfigError> CConfigStore::GetErrors(const bool Clear)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		TVector<ConfigError> Result = Errors;
+
+		if (Clear)
+		{
+			Errors.clear();
+		}
+
+		return Result;
+	}
+
+	ConfigStoreStats CConfigStore::GetStats() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Stats;
+		}
+	}
+
+	void CConfigStore::Clear()
+	{
+		// Watchers call back into the store, they are stopped before it is locked.
+
+		TVector<TUniquePtr<CFileSystemWatcher> > Stopped;
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stopped.swap(Watchers);
+			}
+		}
+
+		Stopped.clear();
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Documents.clear();
+			SubscriptionPaths.clear();
+			PendingReloads.clear();
+			Errors.clear();
+			Stats = ConfigStoreStats();
+			NextSubscription = 0;
+		}
+	}
+}
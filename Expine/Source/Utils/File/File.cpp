@@ -1,10 +1,37 @@
 #include "Utils/File/File.h"
+#include "Utils/File/AsyncIO.h"
 #include <WindowsH.h>
 #include <fstream>
 #include <ostream>
 
 namespace File
 {
+	namespace
+	{
+		// Whole file reads go through the asynchronous engine once it is running.
+
+		inline CAsyncIO * GetAsyncIO()
+		{
+			CAsyncIO * Engine = CAsyncIO::Instance_Pointer();
+
+			return Engine && Engine->IsRunning() && !Engine->IsIOThread() ? Engine : NULL;
+		}
+
+		ErrorTypes ReadAsync(CAsyncIO & Engine, const WString & Path, TVector<Byte> & Storage)
+		{
+			CAsyncFile Input;
+
+			if (!Input.Open(Path))
+			{
+				return ErrorOpen;
+			}
+
+			Storage.ResizeUninitialized(static_cast<size_t>(Input.GetSize()));
+
+			return Engine.Read(Input, 0, Input.GetSize(), Storage.data(), IOPriorityHigh).get();
+		}
+	}
+
 	FileMappingStream::~FileMappingStream()
 	{
 		Close();
@@ -13,7 +40,7 @@ namespace File
 	bool FileMappingStream::Open(const WStringView& File, std::ios::openmode Mode)
 	{
 		DWORD Access = FILE_GENERIC_EXECUTE;
-		DWORD AccessMem = PAGE_EXECUTE;
+		AccessMem = PAGE_EXECUTE;
 
 		if (Mode & std::ios::in)
 		{
@@ -44,8 +71,15 @@ namespace File
 			return false;
 		}
 
-		MappingHandle = CreateFileMapping(FileHandle, NULL, FILE_ALL_ACCESS, FileInfo.AllocationSize.HighPart, FileInfo.AllocationSize.LowPart, NULL);
-		MappingSizeMax = FileInfo.AllocationSize.QuadPart;
+		// Handles passed in directly are mapped for reading.
+
+		if (AccessMem == 0)
+		{
+			AccessMem = PAGE_READONLY;
+		}
+
+		MappingHandle = CreateFileMapping(FileHandle, NULL, AccessMem, FileInfo.EndOfFile.HighPart, FileInfo.EndOfFile.LowPart, NULL);
+		MappingSizeMax = static_cast<size_t>(FileInfo.EndOfFile.QuadPart);
 		MappingSize = 0;
 
 		return MappingHandle != NULL;
@@ -58,7 +92,17 @@ namespace File
 
 		if (MappingSize < MinBytes)
 		{
-			void * Data = MapViewOfFile(MappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, MinBytes);
+			// Copies out only the part not fetched by an earlier call.
+
+			const Byte * Data = static_cast<const Byte*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, MinBytes));
+
+			if (Data)
+			{
+				MappingBytes.insert(MappingBytes.end(), Data + MappingSize, Data + MinBytes);
+				MappingSize = MinBytes;
+
+				UnmapViewOfFile(Data);
+			}
 		}
 
 		return MappingBytes;
@@ -72,7 +116,7 @@ namespace File
 	bool FileMappingStream::Open(const StringView& File, std::ios::openmode Mode)
 	{
 		DWORD Access = FILE_GENERIC_EXECUTE;
-		DWORD AccessMem = PAGE_EXECUTE;
+		AccessMem = PAGE_EXECUTE;
 
 		if (Mode & std::ios::in)
 		{
@@ -93,7 +137,11 @@ namespace File
 	{
 		if (IS_VALID_HANDLE(MappingHandle))
 		{
-			return CloseHandle(MappingHandle);
+			const bool Closed = CloseHandle(MappingHandle) != FALSE;
+
+			MappingHandle = NULL;
+
+			return Closed;
 		}
 
 		return true;
@@ -199,6 +247,11 @@ namespace File
 
 	ErrorTypes CFile::ReadFileContent()
 	{
+		if (CAsyncIO * Engine = GetAsyncIO())
+		{
+			return ReadAsync(*Engine, Path, Content);
+		}
+
 		if (!OpenFileRead())
 		{
 			return ErrorTypes::ErrorOpen;
@@ -222,6 +275,11 @@ namespace File
 
 	ErrorTypes CFile::ReadFileContentInto(TVector<Byte> & Stoarge)
 	{
+		if (CAsyncIO * Engine = GetAsyncIO())
+		{
+			return ReadAsync(*Engine, Path, Stoarge);
+		}
+
 		if (!OpenFileRead())
 		{
 			return ErrorTypes::ErrorOpen;
@@ -252,8 +310,11 @@ namespace File
 
 		FileStream.unsetf(std::ios::skipws);
 		FileStream.seekg(0, std::ios::end);
-		FileStream.read(reinterpret_cast<char*>(pBuffer), FileStream.tellg());
+
+		const std::streamoff Size = FileStream.tellg();
+
 		FileStream.seekg(0, std::ios::beg);
+		FileStream.read(reinterpret_cast<char*>(pBuffer), Size);
 
 		Close();
 
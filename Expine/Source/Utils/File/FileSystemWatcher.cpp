@@ -1,227 +1,734 @@
-#include "File/FileSystemWatcher.h"
-#include "Defines.h"
-#include "Memory.h"
+#include "Utils/File/FileSystemWatcher.h"
+
+#ifdef _WIN32
+#include <WindowsH.h>
+#else
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 
 namespace File
 {
-	bool CFileSystemWatcher::OnChangeNotify()
+	struct RawChange
 	{
-		if (!GetOverlappedResult(hEvent, this, &FileNotifyInformationCount, false))
+		WString		Path;
+		EFileChange	Type;
+	};
+
+	class CFileSystemWatcher::CBackend
+	{
+	public:
+
+		virtual ~CBackend() = default;
+
+		// Waits up to TimeoutMs, a negative timeout waits until an event or Wake. Returns false once the watch broke.
+
+		virtual bool Wait
+		(
+			const Int32			  TimeoutMs,
+			TVector<RawChange>	& Changes,
+			bool				& Overflow
+		) = 0;
+
+		virtual void Wake() = 0;
+	};
+
+	namespace
+	{
+		bool MatchGlobRange(const wchar_t * Pattern, const wchar_t * PatternEnd, const wchar_t * Path, const wchar_t * PathEnd)
 		{
-			return true;
+			while (Pattern != PatternEnd)
+			{
+				if (*Pattern == L'*')
+				{
+					const bool AnyDepth = Pattern + 1 != PatternEnd && Pattern[1] == L'*';
+
+					Pattern += AnyDepth ? 2 : 1;
+
+					// Tries every possible length for the wildcard.
+
+					for (const wchar_t * Rest = Path; ; ++Rest)
+					{
+						if (MatchGlobRange(Pattern, PatternEnd, Rest, PathEnd))
+						{
+							return true;
+						}
+
+						if (Rest == PathEnd || (!AnyDepth && *Rest == L'/'))
+						{
+							return false;
+						}
+					}
+				}
+
+				if (Path == PathEnd)
+				{
+					return false;
+				}
+
+				if (*Pattern == L'?' ? *Path == L'/' : *Pattern != *Path)
+				{
+					return false;
+				}
+
+				++Pattern;
+				++Path;
+			}
+
+			return Path == PathEnd;
 		}
 
-		if (FileNotifyCallback != NULL)
+		// Folds a new event into the one already pending for the same file.
+
+		bool Merge(CFileSystemWatcher::PendingChange & Change, const EFileChange Type)
 		{
-			return FileNotifyCallback->OnFileChangeNotify(FileNotifyInformation);
-		}
+			Change.Last = Type;
 
-		return true;
-	}
+			// Created and deleted within one burst, nothing to report.
 
-	void CFileSystemWatcher::OnDirectoryChange(DWORD dwErrorCode, DWORD dwNotifyFilter, LPOVERLAPPED lpOverlapped)
-	{
-		CFileSystemWatcher * pWatcher = reinterpret_cast<CFileSystemWatcher*>(lpOverlapped);
+			return !(Change.First == FileChangeAdded && Type == FileChangeRemoved);
+		}
 
-		if (pWatcher != NULL)
+		EFileChange Resolve(const EFileChange First, const EFileChange Last)
 		{
-			PostQueuedCompletionStatus(pWatcher->GetCompletionPortHandle(), 0, 0, pWatcher);
-		}
-	}
+			if (Last == FileChangeRemoved)
+			{
+				return FileChangeRemoved;
+			}
 
-	HRESULT CFileSystemWatcher::WatchDirectoryChangesAsync()
-	{
-		if (!ReadDirectoryChangesW(
-			DirectoryHandle,
-			FileNotifyInformation,
-			sizeof(FILE_NOTIFY_INFORMATION) * FileNotifyInformationMax,
-			FALSE,
-			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
-			NULL,
-			this,
-			NULL))
-		{
-			return HRESULT_LAST_ERROR;
+			if (First == FileChangeAdded)
+			{
+				return FileChangeAdded;
+			}
+
+			return FileChangeModified;
 		}
 
-		return S_OK;
+#ifdef _WIN32
+		class CBackendDirectoryChanges : public CFileSystemWatcher::CBackend
+		{
+		private:
+
+			static constexpr DWORD BufferSize = 64 * 1024;
+
+			HANDLE				Directory = INVALID_HANDLE_VALUE;
+			HANDLE				Event = NULL;
+			HANDLE				WakeEvent = NULL;
+
+			OVERLAPPED			Overlapped;
+			TVector<DWORD>		Buffer;
+
+			WString				Root;
+			bool				Recursive = true;
+
+		private:
+
+			bool Request()
+			{
+				ZeroMemory(&Overlapped, sizeof(Overlapped));
+				{
+					Overlapped.hEvent = Event;
+				}
+
+				return ReadDirectoryChangesW(
+					Directory,
+					Buffer.data(),
+					BufferSize,
+					Recursive,
+					FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME,
+					NULL,
+					&Overlapped,
+					NULL) != FALSE;
+			}
+
+		public:
+
+			~CBackendDirectoryChanges()
+			{
+				if (Directory != INVALID_HANDLE_VALUE)
+				{
+					CancelIoEx(Directory, &Overlapped);
+					CloseHandle(Directory);
+				}
+
+				if (Event)
+				{
+					CloseHandle(Event);
+				}
+
+				if (WakeEvent)
+				{
+					CloseHandle(WakeEvent);
+				}
+			}
+
+			bool Create(const WString & Path, const bool Recursive)
+			{
+				this->Root		= Path;
+				this->Recursive	= Recursive;
+
+				Buffer.resize(BufferSize / sizeof(DWORD));
+
+				Directory = CreateFileW(
+					Path.c_str(),
+					FILE_LIST_DIRECTORY,
+					FILE_SHARE_WRITE | FILE_SHARE_READ | FILE_SHARE_DELETE,
+					NULL,
+					OPEN_EXISTING,
+					FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+					NULL);
+
+				if (Directory == INVALID_HANDLE_VALUE)
+				{
+					return false;
+				}
+
+				if (!(Event = CreateEventW(NULL, FALSE, FALSE, NULL)) ||
+					!(WakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL)))
+				{
+					return false;
+				}
+
+				return Request();
+			}
+
+			virtual bool Wait(const Int32 TimeoutMs, TVector<RawChange> & Changes, bool & Overflow) override
+			{
+				const HANDLE Handles[] = { Event, WakeEvent };
+
+				const DWORD Result = WaitForMultipleObjects(2, Handles, FALSE, TimeoutMs < 0 ? INFINITE : static_cast<DWORD>(TimeoutMs));
+
+				if (Result != WAIT_OBJECT_0)
+				{
+					return Result != WAIT_FAILED;
+				}
+
+				DWORD Bytes = 0;
+
+				if (!GetOverlappedResult(Directory, &Overlapped, &Bytes, FALSE))
+				{
+					if (GetLastError() != ERROR_NOTIFY_ENUM_DIR)
+					{
+						return false;
+					}
+
+					Bytes = 0;
+				}
+
+				// An empty result means the buffer ran over.
+
+				if (Bytes == 0)
+				{
+					Overflow = true;
+				}
+				else
+				{
+					const Byte * Current = reinterpret_cast<const Byte*>(Buffer.data());
+
+					for (;;)
+					{
+						const FILE_NOTIFY_INFORMATION * Information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(Current);
+
+						RawChange Change;
+						{
+							Change.Path.assign(Information->FileName, Information->FileNameLength / sizeof(wchar_t));
+
+							std::replace(Change.Path.begin(), Change.Path.end(), L'\\', L'/');
+						}
+
+						bool Report = true;
+
+						switch (Information->Action)
+						{
+							case FILE_ACTION_ADDED:
+							case FILE_ACTION_RENAMED_NEW_NAME:
+								Change.Type = FileChangeAdded;
+								break;
+							case FILE_ACTION_REMOVED:
+							case FILE_ACTION_RENAMED_OLD_NAME:
+								Change.Type = FileChangeRemoved;
+								break;
+							default:
+							{
+								// Directories report a write whenever an entry inside changes.
+
+								const DWORD Attributes = GetFileAttributesW((Root + L"/" + Change.Path).c_str());
+
+								Report		= Attributes == INVALID_FILE_ATTRIBUTES || !(Attributes & FILE_ATTRIBUTE_DIRECTORY);
+								Change.Type	= FileChangeModified;
+							}
+						}
+
+						if (Report)
+						{
+							Changes.push_back(std::move(Change));
+						}
+
+						if (Information->NextEntryOffset == 0)
+						{
+							break;
+						}
+
+						Current += Information->NextEntryOffset;
+					}
+				}
+
+				return Request();
+			}
+
+			virtual void Wake() override
+			{
+				SetEvent(WakeEvent);
+			}
+		};
+#else
+		class CBackendNotify : public CFileSystemWatcher::CBackend
+		{
+		private:
+
+			int						Notify = -1;
+			int						Event = -1;
+
+			// Watch descriptor to directory, relative to the root with a trailing '/'.
+
+			THashMap<int, String>	Directories;
+
+			String					Root;
+			bool					Recursive = true;
+
+		private:
+
+			static constexpr Uint32 Mask =
+				IN_CLOSE_WRITE	| IN_MODIFY		| IN_CREATE		| IN_DELETE |
+				IN_MOVED_FROM	| IN_MOVED_TO	| IN_DELETE_SELF | IN_ONLYDIR;
+
+			static WString Widen(const String & Path)
+			{
+				return WString(Path.begin(), Path.end());
+			}
+
+			// Watches a directory and, when recursive, everything below it. Files already inside are reported if requested.
+
+			void AddDirectory(const String & Relative, TVector<RawChange> * Existing)
+			{
+				String Path = Root;
+				{
+					Path.append(Relative);
+				}
+
+				const int Watch = inotify_add_watch(Notify, Path.c_str(), Mask);
+
+				if (Watch < 0)
+				{
+					return;
+				}
+
+				Directories[Watch] = Relative;
+
+				if (!Recursive && !Existing)
+				{
+					return;
+				}
+
+				DIR * Handle = opendir(Path.c_str());
+
+				if (!Handle)
+				{
+					return;
+				}
+
+				while (const dirent * Entry = readdir(Handle))
+				{
+					if (!strcmp(Entry->d_name, ".") || !strcmp(Entry->d_name, ".."))
+					{
+						continue;
+					}
+
+					String Name = Relative;
+					{
+						Name.append(Entry->d_name);
+					}
+
+					struct stat Status;
+
+					if (stat((Root + Name).c_str(), &Status) != 0)
+					{
+						continue;
+					}
+
+					if (S_ISDIR(Status.st_mode))
+					{
+						if (Recursive)
+						{
+							Name.push_back('/');
+							AddDirectory(Name, Existing);
+						}
+					}
+					else if (Existing)
+					{
+						Existing->push_back({ Widen(Name), FileChangeAdded });
+					}
+				}
+
+				closedir(Handle);
+			}
+
+		public:
+
+			~CBackendNotify()
+			{
+				if (Notify != -1)
+				{
+					close(Notify);
+				}
+
+				if (Event != -1)
+				{
+					close(Event);
+				}
+			}
+
+			bool Create(const WString & Path, const bool Recursive)
+			{
+				this->Root.assign(Path.begin(), Path.end());
+				this->Recursive = Recursive;
+
+				if (!Root.empty() && Root.back() != '/')
+				{
+					Root.push_back('/');
+				}
+
+				if ((Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 ||
+					(Event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+				{
+					return false;
+				}
+
+				AddDirectory(String(), NULL);
+
+				return !Directories.empty();
+			}
+
+			virtual bool Wait(const Int32 TimeoutMs, TVector<RawChange> & Changes, bool & Overflow) override
+			{
+				pollfd Descriptors[2];
+				{
+					Descriptors[0].fd		= Notify;
+					Descriptors[0].events	= POLLIN;
+					Descriptors[1].fd		= Event;
+					Descriptors[1].events	= POLLIN;
+				}
+
+				if (poll(Descriptors, 2, TimeoutMs) < 0)
+				{
+					return errno == EINTR;
+				}
+
+				if (Descriptors[1].revents & POLLIN)
+				{
+					Uint64 Value;
+
+					if (read(Event, &Value, sizeof(Value)) < 0)
+					{
+						// Already reset by an earlier read.
+					}
+				}
+
+				if (!(Descriptors[0].revents & POLLIN))
+				{
+					return true;
+				}
+
+				alignas(inotify_event) char Buffer[16 * 1024];
+
+				for (;;)
+				{
+					const ssize_t Bytes = read(Notify, Buffer, sizeof(Buffer));
+
+					if (Bytes <= 0)
+					{
+						break;
+					}
+
+					for (const char * Current = Buffer; Current < Buffer + Bytes; )
+					{
+						const inotify_event * Information = reinterpret_cast<const inotify_event*>(Current);
+
+						Current += sizeof(inotify_event) + Information->len;
+
+						if (Information->mask & IN_Q_OVERFLOW)
+						{
+							Overflow = true;
+							continue;
+						}
+
+						if (Information->mask & IN_IGNORED)
+						{
+							Directories.erase(Information->wd);
+							continue;
+						}
+
+						const String * Directory = Directories.Find(Information->wd);
+
+						if (!Directory || Information->len == 0)
+						{
+							continue;
+						}
+
+						String Name = *Directory;
+						{
+							Name.append(Information->name);
+						}
+
+						if (Information->mask & IN_ISDIR)
+						{
+							// New directories get their own watch, files written before it was in place are picked up by the scan.
+
+							if (Recursive && (Information->mask & (IN_CREATE | IN_MOVED_TO)))
+							{
+								Name.push_back('/');
+								AddDirectory(Name, &Changes);
+							}
+
+							continue;
+						}
+
+						if (Information->mask & (IN_CREATE | IN_MOVED_TO))
+						{
+							Changes.push_back({ Widen(Name), FileChangeAdded });
+						}
+						else if (Information->mask & (IN_DELETE | IN_MOVED_FROM))
+						{
+							Changes.push_back({ Widen(Name), FileChangeRemoved });
+						}
+						else if (Information->mask & (IN_MODIFY | IN_CLOSE_WRITE))
+						{
+							Changes.push_back({ Widen(Name), FileChangeModified });
+						}
+					}
+				}
+
+				return !Directories.empty();
+			}
+
+			virtual void Wake() override
+			{
+				const Uint64 One = 1;
+
+				if (write(Event, &One, sizeof(One)) < 0)
+				{
+					// Counter saturated, a wake up is pending anyway.
+				}
+			}
+		};
+#endif
 	}
 
-	HRESULT CFileSystemWatcher::InitializeNotifyArray()
+	bool MatchGlob(const WStringView & Pattern, const WStringView & Path)
 	{
-		FileNotifyInformation = new TFileNotifyInformation[FileNotifyInformationMax];
+		const wchar_t * Begin	= Path.data();
+		const wchar_t * End		= Path.data() + Path.size();
 
-		if (FileNotifyInformation == NULL)
+		if (Pattern.find(L'/') == WStringView::npos)
 		{
-			return E_OUTOFMEMORY;
+			for (const wchar_t * Current = End; Current != Begin; --Current)
+			{
+				if (Current[-1] == L'/')
+				{
+					Begin = Current;
+					break;
+				}
+			}
 		}
 
-		return S_OK;
+		return MatchGlobRange(Pattern.data(), Pattern.data() + Pattern.size(), Begin, End);
 	}
 
-	HRESULT CFileSystemWatcher::InitializeCompletionRoutine()
+	CFileSystemWatcher::CFileSystemWatcher() :
+		Running(false)
+	{}
+
+	CFileSystemWatcher::~CFileSystemWatcher()
 	{
-		if (!BindIoCompletionCallback(
-			DirectoryHandle,
-			&OnDirectoryChange,
-			0))
-		{
-			return HRESULT_LAST_ERROR;
-		}
+		Stop();
+	}
 
-		CompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE,
-			NULL,
-			0,
-			0);
+	bool CFileSystemWatcher::Initialize(const InitializeOptions & Options, const TFileChangeCallback & Callback)
+	{
+		Stop();
 
-		if (IS_INVALID_HANDLE(CompletionPort))
-		{
-			return HRESULT_LAST_ERROR;
-		}
+		this->Options	= Options;
+		this->Callback	= Callback;
 
-		hEvent = CreateEvent(0, 0, 0, L"SystemFileWatcherEvent");
+#ifdef _WIN32
+		TUniquePtr<CBackendDirectoryChanges> Watcher(new CBackendDirectoryChanges());
+#else
+		TUniquePtr<CBackendNotify> Watcher(new CBackendNotify());
+#endif
 
-		if (IS_INVALID_HANDLE(hEvent))
+		if (!Watcher->Create(Options.Directory, Options.Recursive))
 		{
-			return HRESULT_LAST_ERROR;
+			return false;
 		}
 
-		HRESULT hr;
+		Backend = std::move(Watcher);
+
+		Running	= true;
+		Thread	= std::thread(&CFileSystemWatcher::Run, this);
 
-		if (FAILED(hr = WatchDirectoryChangesAsync()))
+		return true;
+	}
+
+	void CFileSystemWatcher::Stop()
+	{
+		if (Thread.joinable())
 		{
-			return hr;
+			Running = false;
+
+			Backend->Wake();
+			Thread.join();
 		}
 
-		return S_OK;
+		Backend.reset();
+
+		Pending.clear();
+		PendingOverflow = false;
 	}
 
-	HRESULT CFileSystemWatcher::InitializeDirectory()
+	void CFileSystemWatcher::Add(const WString & Path, const EFileChange Type)
 	{
-		if (IS_VALID_HANDLE(DirectoryHandle))
+		if (!Options.Patterns.empty())
 		{
-			CLOSE_HANDLE(DirectoryHandle);
+			const bool Matches = std::any_of(Options.Patterns.begin(), Options.Patterns.end(), [&Path](const WString & Pattern)
+			{
+				return MatchGlob(Pattern, Path);
+			});
+
+			if (!Matches)
+			{
+				return;
+			}
 		}
 
-		DirectoryHandle = CreateFile(
-			DirectoryPath,
-			FILE_LIST_DIRECTORY,
-			FILE_SHARE_WRITE | FILE_SHARE_READ | FILE_SHARE_DELETE,
-			0,
-			OPEN_EXISTING,
-			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
-			0);
+		PendingChange * Change = Pending.Find(Path);
 
-		if (IS_INVALID_HANDLE(DirectoryHandle))
+		if (!Change)
 		{
-			return HRESULT_LAST_ERROR;
+			Pending.insert({ Path, { Type, Type } });
+		}
+		else if (!Merge(*Change, Type))
+		{
+			Pending.erase(Path);
 		}
-
-		return S_OK;
 	}
 
-	HRESULT CFileSystemWatcher::Stop()
+	void CFileSystemWatcher::Deliver()
 	{
-		if (IS_VALID_HANDLE(hEvent))
+		FileChangeSet Changes;
 		{
-			CLOSE_HANDLE(hEvent);
+			Changes.Overflow = PendingOverflow;
+			Changes.Changes.reserve(Pending.size());
 		}
 
-		if (!CancelIo(CompletionPort))
+		for (const auto & Change : Pending)
 		{
-			return HRESULT_LAST_ERROR;
+			Changes.Changes.push_back({ Change.first, Resolve(Change.second.First, Change.second.Last) });
 		}
 
-		return S_OK;
-	}
+		std::sort(Changes.Changes.begin(), Changes.Changes.end(), [](const FileChange & Left, const FileChange & Right)
+		{
+			return Left.Path < Right.Path;
+		});
 
-	CFileSystemWatcher::CFileSystemWatcher(SIZE_T iMaxNotifies)
-	{
-		FileNotifyInformationMax = iMaxNotifies;
-	}
+		Pending.clear();
+		PendingOverflow = false;
 
-	CFileSystemWatcher::~CFileSystemWatcher()
-	{
-		delete[] FileNotifyInformation;
+		if (Callback)
+		{
+			Callback(Changes);
+		}
 	}
 
-	HRESULT CFileSystemWatcher::Initialize(LPCWSTR pFileDirectory)
+	void CFileSystemWatcher::Run()
 	{
-		if (pFileDirectory == NULL)
-		{
-			return E_INVALIDARG;
-		}
+		typedef std::chrono::steady_clock Clock;
 
-		HRESULT hr;
+		TVector<RawChange> Changes;
 
-		if (FileNotifyInformation == NULL)
+		Clock::time_point First;
+		Clock::time_point Last;
+
+		while (Running)
 		{
-			if (FAILED(hr = InitializeNotifyArray()))
+			Int32 Timeout = -1;
+
+			if (!Pending.empty() || PendingOverflow)
 			{
-				return hr;
-			}
-		}
+				const Clock::time_point Now = Clock::now();
 
-		DirectoryPath = pFileDirectory;
+				const Clock::time_point Due = std::min(
+					Last + std::chrono::milliseconds(Options.DebounceMs),
+					First + std::chrono::milliseconds(Options.MaxDelayMs));
 
-		if (FAILED(hr = InitializeDirectory()))
-		{
-			return hr;
-		}
+				if (Now >= Due)
+				{
+					Deliver();
+					continue;
+				}
 
-		if (FAILED(hr = InitializeCompletionRoutine()))
-		{
-			return hr;
-		}
+				Timeout = static_cast<Int32>(std::chrono::duration_cast<std::chrono::milliseconds>(Due - Now).count()) + 1;
+			}
 
-		return S_OK;
-	}
+			bool Overflow = false;
 
-	HRESULT CFileSystemWatcher::Watch()
-	{
-		DWORD dwTrans;
-		ULONG_PTR ulCompletionKey;
-		LPOVERLAPPED pOverlapped;
+			Changes.clear();
 
-		if (GetQueuedCompletionStatus(CompletionPort, &dwTrans, &ulCompletionKey, &pOverlapped, 0))
-		{
-			if (!OnChangeNotify())
+			if (!Backend->Wait(Timeout, Changes, Overflow))
 			{
-				return E_FAIL;
+				Running = false;
+				break;
 			}
-			
-			HRESULT hr;
 
-			if (FAILED(hr = WatchDirectoryChangesAsync()))
+			if (Changes.empty() && !Overflow)
 			{
-				return hr;
+				continue;
 			}
-		}
 
-		return S_OK;
-	}
+			const bool WasEmpty = Pending.empty() && !PendingOverflow;
 
-	HRESULT CFileSystemWatcher::Watch(DWORD dwWaitMS)
-	{
-		DWORD dwTrans;
-		ULONG_PTR ulCompletionKey;
-		LPOVERLAPPED pOverlapped;
+			for (const RawChange & Change : Changes)
+			{
+				Add(Change.Path, Change.Type);
+			}
 
-		if (GetQueuedCompletionStatus(CompletionPort, &dwTrans, &ulCompletionKey, &pOverlapped, dwWaitMS))
-		{
-			if (!OnChangeNotify())
+			PendingOverflow |= Overflow;
+
+			if (Pending.empty() && !PendingOverflow)
 			{
-				return E_FAIL;
+				continue;
 			}
 
-			HRESULT hr;
+			Last = Clock::now();
 
-			if (FAILED(hr = WatchDirectoryChangesAsync()))
+			if (WasEmpty)
 			{
-				return hr;
+				First = Last;
 			}
 		}
 
-		return S_OK;
+		// Whatever arrived before Stop is still reported.
+
+		if (!Pending.empty() || PendingOverflow)
+		{
+			Deliver();
+		}
 	}
-}
\ No newline at end of file
+}
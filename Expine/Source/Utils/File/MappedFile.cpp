@@ -0,0 +1,244 @@
+#include "Utils/File/MappedFile.h"
+
+#ifdef _WIN32
+#include <WindowsH.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace File
+{
+	CMappedFile::~CMappedFile()
+	{
+		Close();
+	}
+
+	CMappedFile::CMappedFile(CMappedFile && Other) :
+		Data(Other.Data),
+		Size(Other.Size),
+		Opened(Other.Opened)
+	{
+		Other.Data		= NULL;
+		Other.Size		= 0;
+		Other.Opened	= false;
+	}
+
+	CMappedFile & CMappedFile::operator=(CMappedFile && Other)
+	{
+		if (this != &Other)
+		{
+			Close();
+
+			Data	= Other.Data;
+			Size	= Other.Size;
+			Opened	= Other.Opened;
+
+			Other.Data		= NULL;
+			Other.Size		= 0;
+			Other.Opened	= false;
+		}
+
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool CMappedFile::Open(const String & Path)
+	{
+		return Open(WString(Path.begin(), Path.end()));
+	}
+
+	bool CMappedFile::Open(const WString & Path)
+	{
+		Close();
+
+		HANDLE FileHandle = CreateFile2(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, NULL);
+
+		if (FileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER FileSize;
+
+		if (!GetFileSizeEx(FileHandle, &FileSize))
+		{
+			CloseHandle(FileHandle);
+			return false;
+		}
+
+		Size = static_cast<Uint64>(FileSize.QuadPart);
+
+		// Empty files cannot be mapped, they are open with no data.
+
+		if (Size > 0)
+		{
+			HANDLE MappingHandle = CreateFileMappingW(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+			if (MappingHandle)
+			{
+				Data = static_cast<const Byte*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+			}
+
+			// The view keeps the mapping alive on its own.
+
+			if (MappingHandle)
+			{
+				CloseHandle(MappingHandle);
+			}
+
+			if (!Data)
+			{
+				CloseHandle(FileHandle);
+				Size = 0;
+				return false;
+			}
+		}
+
+		CloseHandle(FileHandle);
+
+		return Opened = true;
+	}
+
+	void CMappedFile::Close()
+	{
+		if (Data)
+		{
+			UnmapViewOfFile(Data);
+		}
+
+		Data	= NULL;
+		Size	= 0;
+		Opened	= false;
+	}
+
+	void CMappedFile::Advise(const EMappedFileAdvice Advice) const
+	{
+		// Access patterns are fixed when the file is opened on Windows.
+	}
+
+	void CMappedFile::Prefetch(const Uint64 Offset, const Uint64 Bytes) const
+	{
+		if (!Data || Offset >= Size)
+		{
+			return;
+		}
+
+		WIN32_MEMORY_RANGE_ENTRY Range;
+		{
+			Range.VirtualAddress	= const_cast<Byte*>(Data + Offset);
+			Range.NumberOfBytes		= static_cast<SIZE_T>(Bytes < Size - Offset ? Bytes : Size - Offset);
+		}
+
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+	}
+#else
+	bool CMappedFile::Open(const WString & Path)
+	{
+		return Open(String(Path.begin(), Path.end()));
+	}
+
+	bool CMappedFile::Open(const String & Path)
+	{
+		Close();
+
+		const int FileDescriptor = open(Path.c_str(), O_RDONLY);
+
+		if (FileDescriptor == -1)
+		{
+			return false;
+		}
+
+		struct stat FileStat;
+
+		if (fstat(FileDescriptor, &FileStat) != 0)
+		{
+			close(FileDescriptor);
+			return false;
+		}
+
+		Size = static_cast<Uint64>(FileStat.st_size);
+
+		if (Size > 0)
+		{
+			void * Mapping = mmap(NULL, static_cast<size_t>(Size), PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+
+			if (Mapping == MAP_FAILED)
+			{
+				close(FileDescriptor);
+				Size = 0;
+				return false;
+			}
+
+			Data = static_cast<const Byte*>(Mapping);
+		}
+
+		close(FileDescriptor);
+
+		return Opened = true;
+	}
+
+	void CMappedFile::Close()
+	{
+		if (Data)
+		{
+			munmap(const_cast<Byte*>(Data), static_cast<size_t>(Size));
+		}
+
+		Data	= NULL;
+		Size	= 0;
+		Opened	= false;
+	}
+
+	void CMappedFile::Advise(const EMappedFileAdvice Advice) const
+	{
+		if (!Data)
+		{
+			return;
+		}
+
+		int Flags = MADV_NORMAL;
+
+		switch (Advice)
+		{
+			case MappedFileAdviceSequential:
+			{
+				Flags = MADV_SEQUENTIAL;
+			}
+
+			break;
+
+			case MappedFileAdviceRandom:
+			{
+				Flags = MADV_RANDOM;
+			}
+
+			break;
+
+			default:
+			{
+			}
+		}
+
+		madvise(const_cast<Byte*>(Data), static_cast<size_t>(Size), Flags);
+	}
+
+	void CMappedFile::Prefetch(const Uint64 Offset, const Uint64 Bytes) const
+	{
+		if (!Data || Offset >= Size)
+		{
+			return;
+		}
+
+		// madvise expects a page aligned address.
+
+		const Uint64 PageSize	= static_cast<Uint64>(sysconf(_SC_PAGESIZE));
+		const Uint64 Begin		= Offset & ~(PageSize - 1);
+		const Uint64 End		= Offset + (Bytes < Size - Offset ? Bytes : Size - Offset);
+
+		madvise(const_cast<Byte*>(Data + Begin), static_cast<size_t>(End - Begin), MADV_WILLNEED);
+	}
+#endif
+}
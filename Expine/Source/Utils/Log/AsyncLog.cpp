@@ -0,0 +1,786 @@
+#include "Utils/Log/AsyncLog.h"
+
+#include "Utils/Parsing/NumberParsing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <experimental/filesystem>
+
+namespace Logging
+{
+	namespace
+	{
+		struct alignas(64) RecordBlock
+		{
+			Byte Data[RecordSize];
+		};
+
+		/************************************************************
+		*
+		*	Single producer, single consumer ring. Head is written by
+		*	the owning thread only, Tail by the writer only, each on
+		*	its own cache line. The producer rereads Tail only when
+		*	its cached copy says the ring is full.
+		*
+		************************************************************/
+
+		struct ThreadRing
+		{
+			TVector<RecordBlock>	Blocks;
+			Uint64					Mask;
+			Uint32					Index;
+
+			alignas(64) std::atomic<Uint64>	Head{ 0 };
+			Uint64							CachedTail = 0;
+			std::atomic<Uint64>				Dropped{ 0 };
+
+			alignas(64) std::atomic<Uint64>	Tail{ 0 };
+
+			// Set when the owning thread exits, the writer frees the ring once drained.
+
+			std::atomic<bool>				Retired{ false };
+		};
+
+		struct RingRegistry
+		{
+			TMutex						Mutex;
+			TVector<TUniquePtr<ThreadRing> >	Rings;
+			Uint32						NextIndex = 0;
+			std::atomic<Uint32>			Capacity{ 1024 };
+		};
+
+		// Never destroyed, threads may still log while static objects are torn down.
+
+		RingRegistry & GetRegistry()
+		{
+			static RingRegistry * Registry = new RingRegistry();
+			{
+				return *Registry;
+			}
+		}
+
+		struct RingOwner
+		{
+			ThreadRing * Ring = NULL;
+
+			// Set once the thread exits, records of later thread local destructors get a ring of their own.
+
+			bool Exited = false;
+
+			~RingOwner()
+			{
+				ThreadRing * Retiring = Ring;
+
+				// Cleared first, the writer may free the ring as soon as it is retired.
+
+				Ring	= NULL;
+				Exited	= true;
+
+				if (Retiring)
+				{
+					Retiring->Retired.store(true, std::memory_order_release);
+				}
+			}
+		};
+
+		thread_local RingOwner ThreadOwner;
+
+		ThreadRing * CreateRing()
+		{
+			RingRegistry & Registry = GetRegistry();
+
+			Uint32 Capacity = 1;
+
+			while (Capacity < std::max<Uint32>(Registry.Capacity.load(std::memory_order_relaxed), MaxRecordBlocks))
+			{
+				Capacity <<= 1;
+			}
+
+			TUniquePtr<ThreadRing> Ring(new ThreadRing());
+			{
+				Ring->Blocks.resize(Capacity);
+				Ring->Mask = Capacity - 1;
+			}
+
+			std::lock_guard<TMutex> Lock(Registry.Mutex);
+			{
+				Ring->Index = Registry.NextIndex++;
+				Registry.Rings.push_back(std::move(Ring));
+
+				return Registry.Rings.back().get();
+			}
+		}
+
+		// Copies Size bytes at Offset of the byte stream formed by the blocks starting at Position.
+
+		void WriteStream
+		(
+				  ThreadRing	& Ring,
+			const Uint64		  Position,
+				  size_t		  Offset,
+			const Byte			* Data,
+				  size_t		  Size
+		)
+		{
+			while (Size > 0)
+			{
+				const size_t Chunk = std::min(Size, RecordSize - Offset % RecordSize);
+				{
+					memcpy(Ring.Blocks[(Position + Offset / RecordSize) & Ring.Mask].Data + Offset % RecordSize, Data, Chunk);
+				}
+
+				Data	+= Chunk;
+				Offset	+= Chunk;
+				Size	-= Chunk;
+			}
+		}
+
+		void ReadStream
+		(
+			const ThreadRing	& Ring,
+			const Uint64		  Position,
+				  Byte			* Data,
+				  size_t		  Size
+		)
+		{
+			for (size_t Offset = 0; Offset < Size; Offset += RecordSize)
+			{
+				memcpy(Data + Offset, Ring.Blocks[(Position + Offset / RecordSize) & Ring.Mask].Data, std::min(Size - Offset, RecordSize));
+			}
+		}
+
+		// Formats the argument at Cursor, false when the payload has no further argument.
+
+		bool AppendArgument
+		(
+			const Byte		*& Cursor,
+			const Byte		*  Last,
+				  String	&  Output
+		)
+		{
+			if (Cursor >= Last)
+			{
+				return false;
+			}
+
+			const Byte Type = *Cursor++;
+
+			if (Type == ArgumentString || Type == ArgumentWString)
+			{
+				Uint16 Length;
+				{
+					memcpy(&Length, Cursor, sizeof(Uint16));
+				}
+
+				Cursor += sizeof(Uint16);
+
+				if (Type == ArgumentString)
+				{
+					Output.append(reinterpret_cast<const char *>(Cursor), Length);
+					Cursor += Length;
+				}
+				else
+				{
+					TVector<wchar_t> Text(Length);
+					{
+						memcpy(Text.data(), Cursor, Length * sizeof(wchar_t));
+					}
+
+					AppendUTF8(Text.data(), Length, Output);
+					Cursor += Length * sizeof(wchar_t);
+				}
+
+				return true;
+			}
+
+			Uint64 Value;
+			{
+				memcpy(&Value, Cursor, sizeof(Uint64));
+			}
+
+			Cursor += sizeof(Uint64);
+
+			char Buffer[Parsing::MaxFloatLength + 1];
+
+			switch (Type)
+			{
+				case ArgumentInt:
+				{
+					Output.append(Buffer, snprintf(Buffer, sizeof(Buffer), "%lld", static_cast<long long>(Value)));
+				}
+				break;
+
+				case ArgumentUint:
+				{
+					Output.append(Buffer, snprintf(Buffer, sizeof(Buffer), "%llu", static_cast<unsigned long long>(Value)));
+				}
+				break;
+
+				case ArgumentFloat:
+				{
+					double Real;
+					{
+						memcpy(&Real, &Value, sizeof(double));
+					}
+
+					Output.append(Buffer, Parsing::FormatFloat(Real, Buffer));
+				}
+				break;
+
+				case ArgumentBool:
+				{
+					Output.append(Value ? "true" : "false");
+				}
+				break;
+
+				case ArgumentPointer:
+				{
+					Output.append(Buffer, snprintf(Buffer, sizeof(Buffer), "0x%016llX", static_cast<unsigned long long>(Value)));
+				}
+				break;
+
+				case ArgumentHex:
+				{
+					Output.append(Buffer, snprintf(Buffer, sizeof(Buffer), "0x%08llX", static_cast<unsigned long long>(Value)));
+				}
+				break;
+
+				default:
+				{
+					// Unknown type, the rest of the payload cannot be decoded.
+
+					Cursor = Last;
+				}
+				return false;
+			}
+
+			return true;
+		}
+	}
+
+	void AppendUTF8(const wchar_t * Text, const size_t Length, String & Output)
+	{
+		for (size_t N = 0; N < Length; ++N)
+		{
+			Uint32 Code = static_cast<Uint32>(Text[N]);
+
+			// Joins UTF-16 surrogate pairs, wchar_t is 16 bits wide on Windows.
+
+			if (Code >= 0xD800 && Code < 0xDC00 && N + 1 < Length && static_cast<Uint32>(Text[N + 1]) >= 0xDC00 && static_cast<Uint32>(Text[N + 1]) < 0xE000)
+			{
+				Code = 0x10000 + ((Code - 0xD800) << 10) + (static_cast<Uint32>(Text[++N]) - 0xDC00);
+			}
+
+			if (Code < 0x80)
+			{
+				Output.push_back(static_cast<char>(Code));
+			}
+			else if (Code < 0x800)
+			{
+				Output.push_back(static_cast<char>(0xC0 | (Code >> 6)));
+				Output.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+			}
+			else if (Code < 0x10000)
+			{
+				Output.push_back(static_cast<char>(0xE0 | (Code >> 12)));
+				Output.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+				Output.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+			}
+			else
+			{
+				Output.push_back(static_cast<char>(0xF0 | (Code >> 18)));
+				Output.push_back(static_cast<char>(0x80 | ((Code >> 12) & 0x3F)));
+				Output.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+				Output.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+			}
+		}
+	}
+
+	const char * GetLevelName(const ELogLevel Level)
+	{
+		static const char * Names[LevelNum] =
+		{
+			"Info",
+			"Warning",
+			"Error",
+			"Exception",
+			"Fatal"
+		};
+
+		return Level < LevelNum ? Names[Level] : "Unknown";
+	}
+
+	void Submit(const LogSite & Site, const Uint64 Timestamp, const Uint32 Suppressed, const Byte * Payload, const size_t PayloadSize)
+	{
+		ThreadRing * Ring = ThreadOwner.Ring;
+
+		const bool Exited = ThreadOwner.Exited;
+
+		if (Ring == NULL)
+		{
+			Ring = CreateRing();
+
+			if (!Exited)
+			{
+				ThreadOwner.Ring = Ring;
+			}
+		}
+
+		RecordHeader Header;
+		{
+			Header.Timestamp	= Timestamp;
+			Header.Site			= &Site;
+			Header.Suppressed	= Suppressed;
+			Header.PayloadSize	= static_cast<Uint16>(PayloadSize);
+			Header.NumBlocks	= static_cast<Uint8>((sizeof(RecordHeader) + PayloadSize + RecordSize - 1) / RecordSize);
+			Header.Reserved		= 0;
+		}
+
+		const Uint64 Head = Ring->Head.load(std::memory_order_relaxed);
+
+		if (Head + Header.NumBlocks - Ring->CachedTail > Ring->Blocks.size())
+		{
+			Ring->CachedTail = Ring->Tail.load(std::memory_order_acquire);
+
+			if (Head + Header.NumBlocks - Ring->CachedTail > Ring->Blocks.size())
+			{
+				Ring->Dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		WriteStream(*Ring, Head, 0, reinterpret_cast<const Byte *>(&Header), sizeof(RecordHeader));
+		WriteStream(*Ring, Head, sizeof(RecordHeader), Payload, PayloadSize);
+
+		Ring->Head.store(Head + Header.NumBlocks, std::memory_order_release);
+
+		if (Exited)
+		{
+			Ring->Retired.store(true, std::memory_order_release);
+		}
+	}
+
+	void Flush()
+	{
+		CLogWriter::Instance().Flush();
+	}
+
+	CLogWriter::~CLogWriter()
+	{
+		Stop();
+	}
+
+	CLogWriter & CLogWriter::Instance()
+	{
+		static CLogWriter Writer;
+		{
+			return Writer;
+		}
+	}
+
+	bool CLogWriter::Initialize(const InitializeOptions & Options)
+	{
+		Stop();
+
+		this->Options = Options;
+
+		GetRegistry().Capacity.store(Options.RingCapacity, std::memory_order_relaxed);
+
+		SteadyBase = static_cast<Int64>(GetTimestamp());
+		SystemBase = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		if (Options.WriteFile && !OpenFile())
+		{
+			return false;
+		}
+
+		Thread = std::thread([this]()
+		{
+			WriterMain();
+		});
+
+		return true;
+	}
+
+	void CLogWriter::Stop()
+	{
+		if (!Thread.joinable())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stopping = true;
+			}
+		}
+
+		Wake.notify_all();
+		Thread.join();
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Stopping = false;
+			FlushCompleted = FlushRequested;
+		}
+
+		Flushed.notify_all();
+
+		Stream.close();
+	}
+
+	void CLogWriter::Flush()
+	{
+		std::unique_lock<TMutex> Lock(Mutex);
+
+		if (!Thread.joinable() || std::this_thread::get_id() == Thread.get_id())
+		{
+			return;
+		}
+
+		const Uint64 Request = ++FlushRequested;
+
+		Wake.notify_all();
+		Flushed.wait(Lock, [this, Request]()
+		{
+			return FlushCompleted >= Request;
+		});
+	}
+
+	LogStats CLogWriter::GetStats() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Stats;
+		}
+	}
+
+	void CLogWriter::WriterMain()
+	{
+		String Output;
+
+		std::unique_lock<TMutex> Lock(Mutex);
+
+		for (;;)
+		{
+			Wake.wait_for(Lock, std::chrono::milliseconds(Options.FlushMilliseconds), [this]()
+			{
+				return Stopping || FlushRequested != FlushCompleted;
+			});
+
+			const bool	 Last	 = Stopping;
+			const Uint64 Request = FlushRequested;
+
+			Lock.unlock();
+
+			// Records of every thread submitted before the request are drained by this pass.
+
+			const auto Start = std::chrono::high_resolution_clock::now();
+
+			Output.clear();
+
+			const size_t NumRecords = Drain(Output);
+
+			if (!Output.empty())
+			{
+				WriteOutput(Output);
+			}
+
+			const Uint64 Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+			Lock.lock();
+
+			if (NumRecords > 0)
+			{
+				Stats.NumBatches++;
+				Stats.MaxBatchSize		 = std::max<Uint64>(Stats.MaxBatchSize, NumRecords);
+				Stats.WriteMicroseconds	+= Elapsed;
+			}
+
+			if (FlushCompleted < Request)
+			{
+				FlushCompleted = Request;
+				Flushed.notify_all();
+			}
+
+			if (Last)
+			{
+				return;
+			}
+		}
+	}
+
+	size_t CLogWriter::Drain(String & Output)
+	{
+		RingRegistry & Registry = GetRegistry();
+
+		Drained.clear();
+		Staging.clear();
+
+		Uint64 NumDropped = 0;
+		Uint64 NumThreads = 0;
+
+		{
+			std::lock_guard<TMutex> Lock(Registry.Mutex);
+
+			for (auto Ring = Registry.Rings.begin(); Ring != Registry.Rings.end();)
+			{
+				ThreadRing & Current = **Ring;
+
+				// Read before Head, a retired ring seen here has its last record published.
+
+				const bool	 Retired = Current.Retired.load(std::memory_order_acquire);
+				const Uint64 Head	 = Current.Head.load(std::memory_order_acquire);
+
+				Uint64 Tail = Current.Tail.load(std::memory_order_relaxed);
+
+				while (Tail != Head)
+				{
+					RecordHeader Header;
+					{
+						memcpy(&Header, Current.Blocks[Tail & Current.Mask].Data, sizeof(RecordHeader));
+					}
+
+					const size_t Offset = Staging.size();
+					{
+						Staging.resize(Offset + sizeof(RecordHeader) + Header.PayloadSize);
+					}
+
+					ReadStream(Current, Tail, Staging.data() + Offset, sizeof(RecordHeader) + Header.PayloadSize);
+
+					Drained.push_back({ Header.Timestamp, Current.Index, Offset });
+
+					Tail += Header.NumBlocks;
+				}
+
+				Current.Tail.store(Tail, std::memory_order_release);
+
+				NumDropped += Current.Dropped.exchange(0, std::memory_order_relaxed);
+
+				if (Retired)
+				{
+					Ring = Registry.Rings.erase(Ring);
+				}
+				else
+				{
+					++Ring;
+					++NumThreads;
+				}
+			}
+		}
+
+		// Rings are ordered per thread, merging them by time gives one ordered log.
+
+		std::stable_sort(Drained.begin(), Drained.end(), [](const DrainedRecord & First, const DrainedRecord & Second)
+		{
+			return First.Timestamp < Second.Timestamp;
+		});
+
+		Uint64 NumSuppressed = 0;
+
+		for (const DrainedRecord & Record : Drained)
+		{
+			RecordHeader Header;
+			{
+				memcpy(&Header, Staging.data() + Record.Offset, sizeof(RecordHeader));
+			}
+
+			FormatRecord(Header, Record.Thread, Staging.data() + Record.Offset + sizeof(RecordHeader), Output);
+
+			NumSuppressed += Header.Suppressed;
+		}
+
+		if (NumDropped > 0)
+		{
+			static LogSite DroppedSite("Log", "{} records dropped, thread rings were full.", __FILE__, __LINE__, LevelWarning, 0);
+
+			Byte Payload[sizeof(Uint64) + 1];
+
+			CArgumentWriter Writer(Payload);
+			{
+				Writer.Write(NumDropped);
+			}
+
+			RecordHeader Header = {};
+			{
+				Header.Timestamp	= GetTimestamp();
+				Header.Site			= &DroppedSite;
+				Header.PayloadSize	= static_cast<Uint16>(Writer.GetSize());
+			}
+
+			FormatRecord(Header, 0, Payload, Output);
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Stats.NumRecords	+= Drained.size();
+			Stats.NumDropped	+= NumDropped;
+			Stats.NumSuppressed	+= NumSuppressed;
+			Stats.NumThreads	 = NumThreads;
+		}
+
+		return Drained.size();
+	}
+
+	void CLogWriter::FormatRecord(const RecordHeader & Header, const Uint32 Thread, const Byte * Payload, String & Output)
+	{
+		const LogSite & Site = *Header.Site;
+
+		const Int64 Wall = SystemBase + (static_cast<Int64>(Header.Timestamp) - SteadyBase);
+
+		// The local time conversion is slow, it only runs once per second of records.
+
+		if (Wall / 1000000000 != DateSecond)
+		{
+			DateSecond = Wall / 1000000000;
+
+			const time_t Seconds = static_cast<time_t>(DateSecond);
+
+			tm Time = {};
+			{
+				localtime_s(&Time, &Seconds);
+			}
+
+			snprintf(Date, sizeof(Date), "%04d-%02d-%02d %02d:%02d:%02d", Time.tm_year + 1900, Time.tm_mon + 1, Time.tm_mday, Time.tm_hour, Time.tm_min, Time.tm_sec);
+		}
+
+		char Prefix[96];
+		{
+			Output.append(Prefix, snprintf(Prefix, sizeof(Prefix), "%s.%06d %-9s #%-3u ", Date, static_cast<int>(Wall % 1000000000 / 1000), GetLevelName(Site.Level), Thread));
+		}
+
+		if (Site.Category)
+		{
+			Output.push_back('[');
+			Output.append(Site.Category);
+			Output.append("] ");
+		}
+
+		const Byte * Cursor = Payload;
+		const Byte * Last	= Payload + Header.PayloadSize;
+
+		for (const char * Format = Site.Format; *Format; ++Format)
+		{
+			if (Format[0] == '{' && Format[1] == '}')
+			{
+				if (!AppendArgument(Cursor, Last, Output))
+				{
+					Output.append("{}");
+				}
+
+				++Format;
+			}
+			else if ((Format[0] == '{' && Format[1] == '{') || (Format[0] == '}' && Format[1] == '}'))
+			{
+				Output.push_back(*Format++);
+			}
+			else
+			{
+				Output.push_back(*Format);
+			}
+		}
+
+		if (Header.Suppressed > 0)
+		{
+			Output.append(Prefix, snprintf(Prefix, sizeof(Prefix), " (%u more suppressed)", Header.Suppressed));
+		}
+
+		Output.push_back('\n');
+	}
+
+	void CLogWriter::WriteOutput(const String & Output)
+	{
+		if (Options.WriteStdout)
+		{
+			fwrite(Output.data(), 1, Output.size(), stdout);
+			fflush(stdout);
+		}
+
+		if (!Stream.is_open())
+		{
+			return;
+		}
+
+		if (FileSize > 0 && FileSize + Output.size() > Options.MaxFileSize)
+		{
+			RotateFiles();
+
+			if (!Stream.is_open())
+			{
+				return;
+			}
+		}
+
+		Stream.write(Output.data(), Output.size());
+		Stream.flush();
+
+		FileSize += Output.size();
+	}
+
+	WString CLogWriter::GetFilePath(const Uint32 Index) const
+	{
+		WString Path = Options.Directory + L"/" + Options.Name;
+
+		if (Index > 0)
+		{
+			Path += L"." + std::to_wstring(Index);
+		}
+
+		return Path + L".log";
+	}
+
+	bool CLogWriter::OpenFile()
+	{
+		std::error_code Error;
+
+		std::experimental::filesystem::create_directories(std::experimental::filesystem::path(Options.Directory.c_str()), Error);
+
+		const WString Path = GetFilePath(0);
+
+		Stream.open(Path, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+
+		if (!Stream.is_open())
+		{
+			return false;
+		}
+
+		const auto Size = std::experimental::filesystem::file_size(std::experimental::filesystem::path(Path.c_str()), Error);
+		{
+			FileSize = Error ? 0 : static_cast<Uint64>(Size);
+		}
+
+		return true;
+	}
+
+	void CLogWriter::RotateFiles()
+	{
+		Stream.close();
+
+		std::error_code Error;
+
+		if (Options.MaxFiles > 1)
+		{
+			std::experimental::filesystem::remove(std::experimental::filesystem::path(GetFilePath(Options.MaxFiles - 1).c_str()), Error);
+
+			for (Uint32 Index = Options.MaxFiles - 1; Index > 0; --Index)
+			{
+				std::experimental::filesystem::rename(std::experimental::filesystem::path(GetFilePath(Index - 1).c_str()), std::experimental::filesystem::path(GetFilePath(Index).c_str()), Error);
+			}
+		}
+		else
+		{
+			std::experimental::filesystem::remove(std::experimental::filesystem::path(GetFilePath(0).c_str()), Error);
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumRotations++;
+			}
+		}
+
+		OpenFile();
+	}
+}
@@ -0,0 +1,384 @@
+#include "Utils/Shader/CompileScheduler.h"
+
+#include <algorithm>
+
+namespace ShaderCache
+{
+	TVector<TVector<ShaderDefine> > EnumeratePermutations(const TVector<PermutationAxis> & Axes)
+	{
+		TVector<PermutationAxis> Merged;
+
+		for (const PermutationAxis & Axis : Axes)
+		{
+			auto Target = std::find_if(Merged.begin(), Merged.end(), [&Axis](const PermutationAxis & Other)
+			{
+				return Other.Name == Axis.Name;
+			});
+
+			if (Target == Merged.end())
+			{
+				Merged.push_back({ Axis.Name, {} });
+				Target = Merged.end() - 1;
+			}
+
+			for (const String & Value : Axis.Values)
+			{
+				if (std::find(Target->Values.begin(), Target->Values.end(), Value) == Target->Values.end())
+				{
+					Target->Values.push_back(Value);
+				}
+			}
+		}
+
+		// An axis without values would empty the whole product.
+
+		Merged.erase(std::remove_if(Merged.begin(), Merged.end(), [](const PermutationAxis & Axis)
+		{
+			return Axis.Values.empty();
+		}), Merged.end());
+
+		size_t Count = 1;
+		{
+			for (const PermutationAxis & Axis : Merged)
+			{
+				Count *= Axis.Values.size();
+			}
+		}
+
+		TVector<TVector<ShaderDefine> > Permutations;
+		{
+			Permutations.reserve(Count);
+		}
+
+		TVector<size_t> Selection(Merged.size(), 0);
+
+		for (size_t N = 0; N < Count; ++N)
+		{
+			TVector<ShaderDefine> Defines;
+			{
+				Defines.reserve(Merged.size());
+
+				for (size_t Axis = 0; Axis < Merged.size(); ++Axis)
+				{
+					Defines.push_back({ Merged[Axis].Name, Merged[Axis].Values[Selection[Axis]] });
+				}
+			}
+
+			Permutations.push_back(std::move(Defines));
+
+			for (size_t Axis = 0; Axis < Merged.size(); ++Axis)
+			{
+				if (++Selection[Axis] < Merged[Axis].Values.size())
+				{
+					break;
+				}
+
+				Selection[Axis] = 0;
+			}
+		}
+
+		return Permutations;
+	}
+
+	CCompileScheduler::~CCompileScheduler()
+	{
+		Stop();
+	}
+
+	bool CCompileScheduler::Initialize(const InitializeOptions & Options)
+	{
+		Stop();
+
+		this->Options = Options;
+
+		Uint32 NumThreads = Options.NumThreads;
+
+		if (NumThreads == 0)
+		{
+			NumThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (Uint32 N = 0; N < NumThreads; ++N)
+		{
+			Workers.emplace_back([this]()
+			{
+				WorkerMain();
+			});
+		}
+
+		return true;
+	}
+
+	void CCompileScheduler::Stop()
+	{
+		if (Workers.empty())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stopping = true;
+			}
+		}
+
+		WorkAvailable.notify_all();
+
+		for (std::thread & Worker : Workers)
+		{
+			Worker.join();
+		}
+
+		Workers.clear();
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Jobs.clear();
+			Queue = TPriorityQueue<QueueEntry>();
+			Stopping = false;
+		}
+
+		WorkDone.notify_all();
+	}
+
+	void CCompileScheduler::Enqueue(const Uint64 KeyHash, Job & Entry)
+	{
+		Entry.Sequence = ++Sequence;
+
+		Queue.push({ Entry.Request.Priority, Entry.Sequence, KeyHash });
+
+		WorkAvailable.notify_one();
+	}
+
+	void CCompileScheduler::WorkerMain()
+	{
+		std::unique_lock<TMutex> Lock(Mutex);
+
+		for (;;)
+		{
+			WorkAvailable.wait(Lock, [this]()
+			{
+				return Stopping || !Queue.empty();
+			});
+
+			if (Stopping)
+			{
+				return;
+			}
+
+			const QueueEntry Entry = Queue.top();
+			{
+				Queue.pop();
+			}
+
+			Job * Queued = Jobs.Find(Entry.KeyHash);
+
+			// Entries left behind by a priority change.
+
+			if (Queued == NULL || Queued->Sequence != Entry.Sequence)
+			{
+				continue;
+			}
+
+			// Queued again once the running compile of this key finished.
+
+			if (Running.count(Entry.KeyHash))
+			{
+				Queued->Blocked = true;
+				continue;
+			}
+
+			Job Current = std::move(*Queued);
+			{
+				Jobs.erase(Entry.KeyHash);
+				Running.insert(Entry.KeyHash);
+			}
+
+			Stats.MaxConcurrent = std::max(Stats.MaxConcurrent, static_cast<Uint32>(Running.size()));
+
+			Lock.unlock();
+
+			CompileResult Result;
+			{
+				Result.KeyHash = Entry.KeyHash;
+
+				if (Options.Cache)
+				{
+					Result.Succeeded = Options.Cache->Compile(Current.Request.Key, *Current.Request.Compiler, Result.Output, &Result.FromCache);
+				}
+				else
+				{
+					Result.Succeeded = Current.Request.Compiler->Compile(Current.Request.Key, Result.Output);
+				}
+			}
+
+			for (const TCompileCallback & Callback : Current.Callbacks)
+			{
+				Callback(Result);
+			}
+
+			Lock.lock();
+
+			Running.erase(Entry.KeyHash);
+
+			Stats.NumCompleted++;
+
+			if (!Result.Succeeded)
+			{
+				Stats.NumFailed++;
+			}
+
+			if (Job * Next = Jobs.Find(Entry.KeyHash))
+			{
+				if (Next->Blocked)
+				{
+					Next->Blocked = false;
+					Enqueue(Entry.KeyHash, *Next);
+				}
+			}
+
+			if (Jobs.empty() && Running.empty())
+			{
+				WorkDone.notify_all();
+			}
+		}
+	}
+
+	Uint64 CCompileScheduler::Submit(CompileRequest && Request)
+	{
+		const Uint64 KeyHash = HashShaderKey(Request.Key);
+
+		// Not initialized, compile on the calling thread.
+
+		if (Workers.empty())
+		{
+			CompileResult Result;
+			{
+				Result.KeyHash = KeyHash;
+
+				if (Options.Cache)
+				{
+					Result.Succeeded = Options.Cache->Compile(Request.Key, *Request.Compiler, Result.Output, &Result.FromCache);
+				}
+				else
+				{
+					Result.Succeeded = Request.Compiler->Compile(Request.Key, Result.Output);
+				}
+			}
+
+			if (Request.Callback)
+			{
+				Request.Callback(Result);
+			}
+
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumSubmitted++;
+				Stats.NumCompleted++;
+				Stats.NumFailed += Result.Succeeded ? 0 : 1;
+				Stats.MaxConcurrent = std::max(Stats.MaxConcurrent, 1u);
+			}
+
+			return KeyHash;
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Stats.NumSubmitted++;
+
+		if (Job * Queued = Jobs.Find(KeyHash))
+		{
+			Stats.NumMerged++;
+
+			if (Request.Callback)
+			{
+				Queued->Callbacks.push_back(std::move(Request.Callback));
+			}
+
+			if (Request.Priority > Queued->Request.Priority)
+			{
+				Queued->Request.Priority = Request.Priority;
+
+				if (!Queued->Blocked)
+				{
+					Enqueue(KeyHash, *Queued);
+				}
+			}
+
+			return KeyHash;
+		}
+
+		Job & Entry = Jobs[KeyHash];
+		{
+			if (Request.Callback)
+			{
+				Entry.Callbacks.push_back(std::move(Request.Callback));
+			}
+
+			Entry.Request = std::move(Request);
+		}
+
+		Enqueue(KeyHash, Entry);
+
+		return KeyHash;
+	}
+
+	bool CCompileScheduler::SetPriority(const Uint64 KeyHash, const Int32 Priority)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Job * Queued = Jobs.Find(KeyHash);
+
+		if (Queued == NULL)
+		{
+			return false;
+		}
+
+		if (Queued->Request.Priority != Priority)
+		{
+			Queued->Request.Priority = Priority;
+
+			if (!Queued->Blocked)
+			{
+				Enqueue(KeyHash, *Queued);
+			}
+		}
+
+		return true;
+	}
+
+	bool CCompileScheduler::IsPending(const Uint64 KeyHash) const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Jobs.count(KeyHash) != 0 || Running.count(KeyHash) != 0;
+		}
+	}
+
+	size_t CCompileScheduler::GetNumPending() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Jobs.size() + Running.size();
+		}
+	}
+
+	void CCompileScheduler::Wait()
+	{
+		std::unique_lock<TMutex> Lock(Mutex);
+
+		WorkDone.wait(Lock, [this]()
+		{
+			return Jobs.empty() && Running.empty();
+		});
+	}
+
+	CompileSchedulerStats CCompileScheduler::GetStats() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Stats;
+		}
+	}
+}
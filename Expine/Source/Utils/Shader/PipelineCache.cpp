@@ -0,0 +1,580 @@
+#include "Utils/Shader/PipelineCache.h"
+#include "Utils/Shader/ShaderCache.h"
+#include "Utils/File/File.h"
+
+#include <algorithm>
+
+namespace PipelineCache
+{
+	namespace
+	{
+		static constexpr Uint32 FileMagic = 0x48434C50; // PLCH
+		static constexpr Uint32 FileVersion = 2;
+
+		static constexpr Uint64 SeedLow = 0x243F6A8885A308D3ULL;
+		static constexpr Uint64 SeedHigh = 0x13198A2E03707344ULL;
+
+		struct FileHeader
+		{
+			Uint32	Magic;
+			Uint32	Version;
+			Uint64	DeviceHash;
+			Uint32	NumStates;
+			Uint32	NumRecords;
+
+			// Hash of everything behind the header.
+
+			Uint64	Checksum;
+		};
+
+		static_assert(sizeof(FileHeader) == 32, "Unexpected pipeline cache header size");
+
+		class CReader
+		{
+		private:
+
+			const Byte *	Current;
+			const Byte *	End;
+			bool			Valid = true;
+
+		public:
+
+			CReader(const TVector<Byte> & Content) :
+				Current(Content.data()),
+				End(Content.data() + Content.size())
+			{}
+
+			template<class Type>
+			inline Type Read()
+			{
+				Type Value = Type();
+
+				if (static_cast<size_t>(End - Current) < sizeof(Type))
+				{
+					Valid = false;
+					return Value;
+				}
+
+				std::memcpy(&Value, Current, sizeof(Type));
+				Current += sizeof(Type);
+
+				return Value;
+			}
+
+			inline void Read(TVector<Byte> & Output, const size_t Size)
+			{
+				if (static_cast<size_t>(End - Current) < Size)
+				{
+					Valid = false;
+					return;
+				}
+
+				Output.assign(Current, Current + Size);
+				Current += Size;
+			}
+
+			inline bool IsValid() const
+			{
+				return Valid;
+			}
+		};
+
+		// Kind and content, shared by the pool and the loader.
+
+		inline Hash128 HashState(const Uint32 Kind, const void * Data, const size_t Size)
+		{
+			Hash128 Hash = HashBytes128(Data, Size);
+			{
+				Hash.Low = ShaderCache::HashCombine(Hash.Low, Kind);
+			}
+
+			return Hash;
+		}
+
+		// States enter the key by their hashes, handles differ between runs.
+
+		Hash128 HashDescription(const PipelineDescription & Description, const TVector<Hash128> & StateHashes)
+		{
+			CStateWriter Writer;
+			{
+				Writer.Append(Description.Type);
+				Writer.Append(static_cast<Uint32>(StateHashes.size()));
+
+				for (const Hash128 & State : StateHashes)
+				{
+					Writer.Append(State);
+				}
+
+				Writer.Append(static_cast<Uint32>(Description.Shaders.size()));
+
+				for (const Uint64 Shader : Description.Shaders)
+				{
+					Writer.Append(Shader);
+				}
+
+				Writer.Append(static_cast<Uint32>(Description.Fixed.size()));
+
+				for (const Byte Value : Description.Fixed)
+				{
+					Writer.Append(Value);
+				}
+			}
+
+			return HashBytes128(Writer.GetContent().data(), Writer.GetContent().size());
+		}
+
+		template<class Type>
+		inline void Write(TVector<Byte> & Output, const Type & Value)
+		{
+			const Byte * Bytes = reinterpret_cast<const Byte*>(&Value);
+			{
+				Output.insert(Output.end(), Bytes, Bytes + sizeof(Type));
+			}
+		}
+	}
+
+	Hash128 HashBytes128(const void * Data, const size_t Size)
+	{
+		Hash128 Hash;
+		{
+			Hash.Low	= ShaderCache::HashBytes(Data, Size, SeedLow);
+			Hash.High	= ShaderCache::HashBytes(Data, Size, SeedHigh);
+		}
+
+		return Hash;
+	}
+
+	StateHandle CStatePool::Intern(const Uint32 Kind, const void * Data, const size_t Size)
+	{
+		NumRequests++;
+
+		const Hash128 Hash = HashState(Kind, Data, Size);
+
+		if (const StateHandle * Existing = Index.Find(Hash))
+		{
+			return *Existing;
+		}
+
+		const StateHandle Handle = static_cast<StateHandle>(Entries.size());
+
+		Entry & State = Entries.emplace_back();
+		{
+			State.Kind = Kind;
+			State.Hash = Hash;
+			State.Content.assign(static_cast<const Byte*>(Data), static_cast<const Byte*>(Data) + Size);
+		}
+
+		Index[Hash] = Handle;
+
+		return Handle;
+	}
+
+	void CStatePool::Clear()
+	{
+		Entries.clear();
+		Index.clear();
+
+		NumRequests = 0;
+	}
+
+	bool CPipelineCache::Initialize(const InitializeOptions & Options)
+	{
+		Clear();
+
+		this->Options = Options;
+
+		std::error_code Error;
+
+		std::experimental::filesystem::create_directories(std::experimental::filesystem::path(Options.Directory.c_str()), Error);
+
+		return std::experimental::filesystem::is_directory(std::experimental::filesystem::path(Options.Directory.c_str()), Error);
+	}
+
+	WString CPipelineCache::GetFilePath() const
+	{
+		WString Path = Options.Directory;
+		{
+			Path.append(L"/Pipelines.bin");
+		}
+
+		return Path;
+	}
+
+	StateHandle CPipelineCache::Intern(const Uint32 Kind, const CStateWriter & Writer)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return States.Intern(Kind, Writer);
+		}
+	}
+
+	Hash128 CPipelineCache::GetKey(const PipelineDescription & Description) const
+	{
+		TVector<Hash128> StateHashes;
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			for (const StateHandle State : Description.States)
+			{
+				StateHashes.push_back(States.GetHash(State));
+			}
+		}
+
+		return HashDescription(Description, StateHashes);
+	}
+
+	bool CPipelineCache::Request(const Hash128 & Key, const PipelineDescription & Description, TVector<Byte> & Blob)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Stats.NumRequests++;
+
+		Record * Existing = Records.Find(Key);
+
+		if (Existing == NULL)
+		{
+			Record & Created = Records[Key];
+			{
+				Created.Key			= Key;
+				Created.Description	= Description;
+				Created.Used		= true;
+			}
+
+			return false;
+		}
+
+		Existing->Used = true;
+
+		if (Existing->Blob.empty())
+		{
+			return false;
+		}
+
+		Blob = Existing->Blob;
+
+		return true;
+	}
+
+	void CPipelineCache::SetBlob(const Hash128 & Key, TVector<Byte> && Blob)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		if (Record * Existing = Records.Find(Key))
+		{
+			Existing->Blob = std::move(Blob);
+		}
+	}
+
+	void CPipelineCache::RejectBlob(const Hash128 & Key)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Stats.NumBlobRejected++;
+
+		if (Record * Existing = Records.Find(Key))
+		{
+			Existing->Blob.clear();
+		}
+	}
+
+	void CPipelineCache::RecordCreation(const Uint64 Microseconds, const bool FromBlob)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		Stats.NumCreated++;
+		Stats.NumBlobHits		+= FromBlob ? 1 : 0;
+		Stats.TotalMicroseconds	+= Microseconds;
+		Stats.MaxMicroseconds	 = std::max(Stats.MaxMicroseconds, Microseconds);
+	}
+
+	bool CPipelineCache::Load()
+	{
+		const WString Path = GetFilePath();
+
+		if (!File::DoesFileExist(Path))
+		{
+			return false;
+		}
+
+		File::CFile Input(Path);
+
+		TVector<Byte> Content;
+
+		if (Input.ReadFileContentInto(Content) != File::ErrorNone)
+		{
+			return false;
+		}
+
+		CReader Reader(Content);
+
+		const FileHeader Header = Reader.Read<FileHeader>();
+
+		if (!Reader.IsValid() || Header.Magic != FileMagic || Header.Version != FileVersion)
+		{
+			return false;
+		}
+
+		if (Header.Checksum != ShaderCache::HashBytes(Content.data() + sizeof(Header), Content.size() - sizeof(Header), SeedLow))
+		{
+			return false;
+		}
+
+		// Every state takes at least its kind and size.
+
+		if (Header.NumStates > (Content.size() - sizeof(Header)) / (2 * sizeof(Uint32)))
+		{
+			return false;
+		}
+
+		// The whole file is read before anything is added, a rejected file leaves the cache as it was.
+
+		struct LoadedState
+		{
+			Uint32			Kind;
+			TVector<Byte>	Content;
+			Hash128			Hash;
+		};
+
+		TVector<LoadedState> LoadedStates(Header.NumStates);
+
+		for (LoadedState & State : LoadedStates)
+		{
+			State.Kind = Reader.Read<Uint32>();
+
+			Reader.Read(State.Content, Reader.Read<Uint32>());
+
+			if (!Reader.IsValid())
+			{
+				return false;
+			}
+
+			State.Hash = HashState(State.Kind, State.Content.data(), State.Content.size());
+		}
+
+		TVector<Record>				LoadedRecords;
+		TVector<TVector<Uint32> >	LoadedIndices;
+
+		for (Uint32 N = 0; N < Header.NumRecords; ++N)
+		{
+			Record				Loaded;
+			TVector<Uint32>		Indices;
+			TVector<Hash128>	StateHashes;
+			{
+				Loaded.Key.Low				= Reader.Read<Uint64>();
+				Loaded.Key.High				= Reader.Read<Uint64>();
+				Loaded.Description.Type		= Reader.Read<Uint32>();
+
+				const Uint32 NumStates = Reader.Read<Uint32>();
+
+				for (Uint32 State = 0; State < NumStates && Reader.IsValid(); ++State)
+				{
+					const Uint32 Index = Reader.Read<Uint32>();
+
+					if (Index >= LoadedStates.size())
+					{
+						return false;
+					}
+
+					Indices.push_back(Index);
+					StateHashes.push_back(LoadedStates[Index].Hash);
+				}
+
+				const Uint32 NumShaders = Reader.Read<Uint32>();
+
+				for (Uint32 Shader = 0; Shader < NumShaders && Reader.IsValid(); ++Shader)
+				{
+					Loaded.Description.Shaders.push_back(Reader.Read<Uint64>());
+				}
+
+				Reader.Read(Loaded.Description.Fixed, Reader.Read<Uint32>());
+				Reader.Read(Loaded.Blob, Reader.Read<Uint32>());
+			}
+
+			// A key of another derivation would never be requested again.
+
+			if (!Reader.IsValid() || HashDescription(Loaded.Description, StateHashes) != Loaded.Key)
+			{
+				return false;
+			}
+
+			LoadedRecords.push_back(std::move(Loaded));
+			LoadedIndices.push_back(std::move(Indices));
+		}
+
+		const bool KeepBlobs = Header.DeviceHash == Options.DeviceHash;
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		// Handles in the file index its own state table.
+
+		TVector<StateHandle> Handles;
+
+		for (const LoadedState & State : LoadedStates)
+		{
+			Handles.push_back(States.Intern(State.Kind, State.Content.data(), State.Content.size()));
+		}
+
+		for (size_t N = 0; N < LoadedRecords.size(); ++N)
+		{
+			Record & Loaded = LoadedRecords[N];
+
+			for (const Uint32 Index : LoadedIndices[N])
+			{
+				Loaded.Description.States.push_back(Handles[Index]);
+			}
+
+			if (!KeepBlobs)
+			{
+				Loaded.Blob.clear();
+			}
+
+			if (Records.Find(Loaded.Key) == NULL)
+			{
+				Records[Loaded.Key] = std::move(Loaded);
+			}
+		}
+
+		return true;
+	}
+
+	bool CPipelineCache::Save(const bool UsedOnly) const
+	{
+		TVector<Byte> Content(sizeof(FileHeader));
+
+		FileHeader Header = {};
+		{
+			Header.Magic		= FileMagic;
+			Header.Version		= FileVersion;
+			Header.DeviceHash	= Options.DeviceHash;
+		}
+
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			// Only states referenced by a written record, each once.
+
+			THashMap<StateHandle, Uint32>	Remap;
+			TVector<Byte>					RecordContent;
+
+			for (auto Iter = Records.begin(); Iter != Records.end(); ++Iter)
+			{
+				const Record & Entry = Iter->second;
+
+				if (UsedOnly && !Entry.Used)
+				{
+					continue;
+				}
+
+				Write(RecordContent, Entry.Key.Low);
+				Write(RecordContent, Entry.Key.High);
+				Write(RecordContent, Entry.Description.Type);
+				Write(RecordContent, static_cast<Uint32>(Entry.Description.States.size()));
+
+				for (const StateHandle State : Entry.Description.States)
+				{
+					Uint32 * Index = Remap.Find(State);
+
+					if (Index == NULL)
+					{
+						Index = &(Remap[State] = Header.NumStates++);
+
+						const TVector<Byte> & Encoded = States.GetContent(State);
+
+						Write(Content, States.GetKind(State));
+						Write(Content, static_cast<Uint32>(Encoded.size()));
+
+						Content.insert(Content.end(), Encoded.begin(), Encoded.end());
+					}
+
+					Write(RecordContent, *Index);
+				}
+
+				Write(RecordContent, static_cast<Uint32>(Entry.Description.Shaders.size()));
+
+				for (const Uint64 Shader : Entry.Description.Shaders)
+				{
+					Write(RecordContent, Shader);
+				}
+
+				Write(RecordContent, static_cast<Uint32>(Entry.Description.Fixed.size()));
+				RecordContent.insert(RecordContent.end(), Entry.Description.Fixed.begin(), Entry.Description.Fixed.end());
+
+				Write(RecordContent, static_cast<Uint32>(Entry.Blob.size()));
+				RecordContent.insert(RecordContent.end(), Entry.Blob.begin(), Entry.Blob.end());
+
+				Header.NumRecords++;
+			}
+
+			Content.insert(Content.end(), RecordContent.begin(), RecordContent.end());
+		}
+
+		Header.Checksum = ShaderCache::HashBytes(Content.data() + sizeof(Header), Content.size() - sizeof(Header), SeedLow);
+
+		std::memcpy(Content.data(), &Header, sizeof(Header));
+
+		// Written beside the target and renamed, an interrupted save keeps the previous file.
+
+		const WString Path = GetFilePath();
+
+		WString Temporary = Path;
+		{
+			Temporary.append(L".tmp");
+		}
+
+		File::CFile Output(Temporary);
+		{
+			Output.GetContentRef().swap(Content);
+		}
+
+		const bool Written = Output.WriteFileContent() == File::ErrorNone;
+
+		Output.Close();
+
+		std::error_code Error;
+
+		if (Written)
+		{
+			std::experimental::filesystem::rename(std::experimental::filesystem::path(Temporary.c_str()), std::experimental::filesystem::path(Path.c_str()), Error);
+
+			if (!Error)
+			{
+				return true;
+			}
+		}
+
+		std::experimental::filesystem::remove(std::experimental::filesystem::path(Temporary.c_str()), Error);
+
+		return false;
+	}
+
+	size_t CPipelineCache::GetNumRecords() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Records.size();
+		}
+	}
+
+	PipelineCacheStats CPipelineCache::GetStats() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		PipelineCacheStats Result = Stats;
+		{
+			Result.NumStates		= States.GetNumStates();
+			Result.NumStateRequests	= States.GetNumRequests();
+		}
+
+		return Result;
+	}
+
+	void CPipelineCache::Clear()
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		States.Clear();
+		Records.clear();
+
+		Stats = PipelineCacheStats();
+	}
+}
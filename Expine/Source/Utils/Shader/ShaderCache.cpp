@@ -0,0 +1,574 @@
+#include "Utils/Shader/ShaderCache.h"
+#include "Utils/File/File.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ShaderCache
+{
+	namespace
+	{
+		static constexpr Uint32 ObjectMagic = 0x4A424F53; // SOBJ
+		static constexpr Uint32 DependencyMagic = 0x50454453; // SDEP
+		static constexpr Uint32 CacheVersion = 1;
+
+		struct ObjectHeader
+		{
+			Uint32	Magic;
+			Uint32	Version;
+			Uint64	ObjectHash;
+			Uint64	Size;
+		};
+
+		struct DependencyHeader
+		{
+			Uint32	Magic;
+			Uint32	Version;
+			Uint64	KeyHash;
+			Uint32	NumFiles;
+			Uint32	Reserved;
+		};
+
+		static constexpr Uint64 Multiplier = 0x9E3779B97F4A7C15ULL;
+
+		inline Uint64 Rotate(const Uint64 Value, const Uint32 Bits)
+		{
+			return (Value << Bits) | (Value >> (64 - Bits));
+		}
+
+		inline Uint64 Mix(Uint64 Value)
+		{
+			Value ^= Value >> 33;
+			Value *= 0xFF51AFD7ED558CCDULL;
+			Value ^= Value >> 33;
+			Value *= 0xC4CEB9FE1A85EC53ULL;
+			Value ^= Value >> 33;
+
+			return Value;
+		}
+
+		inline Uint64 Step(const Uint64 State, const Uint64 Word)
+		{
+			return Rotate(State ^ Mix(Word), 29) * Multiplier;
+		}
+
+		// Writes next to the target and renames, readers never see half a file.
+
+		bool WriteAtomic(const WString & Path, TVector<Byte> && Content)
+		{
+			static TAtomic<Uint32> Counter(0);
+
+			WString Temporary = Path;
+			{
+				const std::wstring Suffix = L".tmp" + std::to_wstring(Counter++);
+
+				Temporary.append(Suffix.begin(), Suffix.end());
+			}
+
+			File::CFile Output(Temporary);
+			{
+				Output.GetContentRef().swap(Content);
+			}
+
+			const bool Written = Output.WriteFileContent() == File::ErrorNone;
+
+			Output.Close();
+
+			std::error_code Error;
+
+			if (Written)
+			{
+				std::experimental::filesystem::rename(std::experimental::filesystem::path(Temporary.c_str()), std::experimental::filesystem::path(Path.c_str()), Error);
+
+				if (!Error)
+				{
+					return true;
+				}
+			}
+
+			std::experimental::filesystem::remove(std::experimental::filesystem::path(Temporary.c_str()), Error);
+
+			return false;
+		}
+	}
+
+	Uint64 HashBytes(const void * Data, const size_t Size, const Uint64 Seed)
+	{
+		const Byte * Current = static_cast<const Byte*>(Data);
+
+		Uint64 State = Seed ^ (Size * Multiplier);
+
+		size_t Remaining = Size;
+
+		for (; Remaining >= 8; Remaining -= 8, Current += 8)
+		{
+			Uint64 Word;
+			{
+				std::memcpy(&Word, Current, 8);
+			}
+
+			State = Step(State, Word);
+		}
+
+		if (Remaining)
+		{
+			Uint64 Word = 0;
+			{
+				std::memcpy(&Word, Current, Remaining);
+			}
+
+			State = Step(State, Word);
+		}
+
+		return Mix(State);
+	}
+
+	Uint64 HashShaderDefines(const TVector<ShaderDefine> & Defines)
+	{
+		TVector<const ShaderDefine*> Sorted;
+		{
+			for (const ShaderDefine & Define : Defines)
+			{
+				Sorted.push_back(&Define);
+			}
+
+			std::sort(Sorted.begin(), Sorted.end(), [](const ShaderDefine * Left, const ShaderDefine * Right)
+			{
+				return Left->Name != Right->Name ? Left->Name < Right->Name : Left->Value < Right->Value;
+			});
+		}
+
+		CHasher Hasher;
+		{
+			Hasher.Append(static_cast<Uint64>(Sorted.size()));
+
+			for (const ShaderDefine * Define : Sorted)
+			{
+				Hasher.Append(StringView(Define->Name.data(), Define->Name.size()));
+				Hasher.Append(StringView(Define->Value.data(), Define->Value.size()));
+			}
+		}
+
+		return Hasher.Finish();
+	}
+
+	Uint64 HashShaderKey(const ShaderKey & Key)
+	{
+		const WString Path = NormalizePath(Key.Path);
+
+		CHasher Hasher;
+		{
+			Hasher.Append(WStringView(Path.data(), Path.size()));
+			Hasher.Append(StringView(Key.EntryPoint.data(), Key.EntryPoint.size()));
+			Hasher.Append(StringView(Key.Profile.data(), Key.Profile.size()));
+			Hasher.Append(HashShaderDefines(Key.Defines));
+		}
+
+		return Hasher.Finish();
+	}
+
+	WString NormalizePath(const WStringView & Path)
+	{
+		WString Result(Path);
+		{
+			std::replace(Result.begin(), Result.end(), L'\\', L'/');
+		}
+
+		return Result;
+	}
+
+	bool CShaderCache::Initialize(const InitializeOptions & Options)
+	{
+		Clear();
+
+		Directory = Options.Directory;
+
+		std::error_code Error;
+
+		std::experimental::filesystem::create_directories(std::experimental::filesystem::path(Directory.c_str()), Error);
+
+		return std::experimental::filesystem::is_directory(std::experimental::filesystem::path(Directory.c_str()), Error);
+	}
+
+	WString CShaderCache::GetEntryPath(const Uint64 Hash, const wchar_t * Extension) const
+	{
+		static const wchar_t Digits[] = L"0123456789abcdef";
+
+		WString Path = Directory;
+		{
+			Path.push_back(L'/');
+
+			for (int Shift = 60; Shift >= 0; Shift -= 4)
+			{
+				Path.push_back(Digits[(Hash >> Shift) & 0xF]);
+			}
+
+			Path.append(Extension);
+		}
+
+		return Path;
+	}
+
+	bool CShaderCache::ReadDependencies(const Uint64 KeyHash, TVector<WString> & Files) const
+	{
+		const WString Path = GetEntryPath(KeyHash, L".dep");
+
+		if (!File::DoesFileExist(Path))
+		{
+			return false;
+		}
+
+		File::CFile Input(Path);
+
+		TVector<Byte> Content;
+
+		if (Input.ReadFileContentInto(Content) != File::ErrorNone || Content.size() < sizeof(DependencyHeader))
+		{
+			return false;
+		}
+
+		DependencyHeader Header;
+		{
+			std::memcpy(&Header, Content.data(), sizeof(Header));
+		}
+
+		if (Header.Magic != DependencyMagic || Header.Version != CacheVersion || Header.KeyHash != KeyHash || Header.NumFiles == 0)
+		{
+			return false;
+		}
+
+		// Characters are stored as 32 bit values, wchar_t differs between platforms.
+
+		size_t Offset = sizeof(Header);
+
+		Files.clear();
+
+		for (Uint32 N = 0; N < Header.NumFiles; ++N)
+		{
+			Uint32 Length;
+
+			if (Content.size() - Offset < sizeof(Length))
+			{
+				return false;
+			}
+
+			std::memcpy(&Length, Content.data() + Offset, sizeof(Length));
+
+			Offset += sizeof(Length);
+
+			if ((Content.size() - Offset) / sizeof(Uint32) < Length)
+			{
+				return false;
+			}
+
+			WString File;
+			{
+				File.resize(Length);
+
+				for (Uint32 Char = 0; Char < Length; ++Char, Offset += sizeof(Uint32))
+				{
+					Uint32 Value;
+					{
+						std::memcpy(&Value, Content.data() + Offset, sizeof(Value));
+					}
+
+					File[Char] = static_cast<wchar_t>(Value);
+				}
+			}
+
+			Files.push_back(std::move(File));
+		}
+
+		return true;
+	}
+
+	bool CShaderCache::WriteDependencies(const Uint64 KeyHash, const TVector<WString> & Files) const
+	{
+		TVector<Byte> Content(sizeof(DependencyHeader));
+
+		DependencyHeader Header = {};
+		{
+			Header.Magic	= DependencyMagic;
+			Header.Version	= CacheVersion;
+			Header.KeyHash	= KeyHash;
+			Header.NumFiles	= static_cast<Uint32>(Files.size());
+		}
+
+		std::memcpy(Content.data(), &Header, sizeof(Header));
+
+		for (const WString & File : Files)
+		{
+			const Uint32 Length = static_cast<Uint32>(File.size());
+
+			Content.insert(Content.end(), reinterpret_cast<const Byte*>(&Length), reinterpret_cast<const Byte*>(&Length + 1));
+
+			for (const wchar_t Char : File)
+			{
+				const Uint32 Value = static_cast<Uint32>(Char);
+
+				Content.insert(Content.end(), reinterpret_cast<const Byte*>(&Value), reinterpret_cast<const Byte*>(&Value + 1));
+			}
+		}
+
+		return WriteAtomic(GetEntryPath(KeyHash, L".dep"), std::move(Content));
+	}
+
+	bool CShaderCache::ReadObject(const Uint64 ObjectHash, TVector<Byte> & Bytecode) const
+	{
+		const WString Path = GetEntryPath(ObjectHash, L".cso");
+
+		if (!File::DoesFileExist(Path))
+		{
+			return false;
+		}
+
+		File::CFile Input(Path);
+
+		TVector<Byte> Content;
+
+		if (Input.ReadFileContentInto(Content) != File::ErrorNone || Content.size() < sizeof(ObjectHeader))
+		{
+			return false;
+		}
+
+		ObjectHeader Header;
+		{
+			std::memcpy(&Header, Content.data(), sizeof(Header));
+		}
+
+		if (Header.Magic != ObjectMagic || Header.Version != CacheVersion || Header.ObjectHash != ObjectHash || Header.Size != Content.size() - sizeof(Header))
+		{
+			return false;
+		}
+
+		Bytecode.assign(Content.begin() + sizeof(Header), Content.end());
+
+		return true;
+	}
+
+	bool CShaderCache::WriteObject(const Uint64 ObjectHash, const TVector<Byte> & Bytecode) const
+	{
+		ObjectHeader Header = {};
+		{
+			Header.Magic		= ObjectMagic;
+			Header.Version		= CacheVersion;
+			Header.ObjectHash	= ObjectHash;
+			Header.Size			= Bytecode.size();
+		}
+
+		TVector<Byte> Content(sizeof(Header) + Bytecode.size());
+		{
+			std::memcpy(Content.data(), &Header, sizeof(Header));
+
+			// An empty vector may have no storage, memcpy from NULL is undefined even for zero bytes.
+
+			if (!Bytecode.empty())
+			{
+				std::memcpy(Content.data() + sizeof(Header), Bytecode.data(), Bytecode.size());
+			}
+		}
+
+		return WriteAtomic(GetEntryPath(ObjectHash, L".cso"), std::move(Content));
+	}
+
+	Uint64 CShaderCache::GetFileHash(const WString & Path)
+	{
+		const WString Normalized = NormalizePath(Path);
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			if (const Uint64 * Hash = FileHashes.Find(Normalized))
+			{
+				return *Hash;
+			}
+		}
+
+		Uint64 Hash = 0;
+
+		if (File::DoesFileExist(Normalized))
+		{
+			File::CFile Input(Normalized);
+
+			TVector<Byte> Content;
+
+			if (Input.ReadFileContentInto(Content) == File::ErrorNone)
+			{
+				Hash = HashBytes(Content.data(), Content.size()) | 1;
+			}
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			FileHashes[Normalized] = Hash;
+		}
+
+		return Hash;
+	}
+
+	Uint64 CShaderCache::GetObjectHash(const Uint64 KeyHash, const Uint64 CompilerHash, const TVector<WString> & Files)
+	{
+		CHasher Hasher(KeyHash);
+		{
+			Hasher.Append(CompilerHash);
+
+			for (const WString & File : Files)
+			{
+				Hasher.Append(WStringView(File.data(), File.size()));
+				Hasher.Append(GetFileHash(File));
+			}
+		}
+
+		return Hasher.Finish();
+	}
+
+	void CShaderCache::SetDependencies(const Uint64 KeyHash, const TVector<WString> & Files)
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		if (const TVector<WString> * Previous = Dependencies.Find(KeyHash))
+		{
+			for (const WString & File : *Previous)
+			{
+				if (THashSet<Uint64> * Keys = Dependents.Find(File))
+				{
+					Keys->erase(KeyHash);
+				}
+			}
+		}
+
+		for (const WString & File : Files)
+		{
+			Dependents[File].insert(KeyHash);
+		}
+
+		Dependencies[KeyHash] = Files;
+	}
+
+	bool CShaderCache::Compile(const ShaderKey & Key, IShaderCompiler & Compiler, ShaderCompileOutput & Output, bool * FromCache)
+	{
+		const Uint64 KeyHash		= HashShaderKey(Key);
+		const Uint64 CompilerHash	= Compiler.GetCompilerHash();
+
+		if (FromCache)
+		{
+			*FromCache = false;
+		}
+
+		TVector<WString>	Files;
+		bool				Known = false;
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+
+			if (const TVector<WString> * Recorded = Dependencies.Find(KeyHash))
+			{
+				Files = *Recorded;
+				Known = true;
+			}
+		}
+
+		if (!Known && !Directory.empty() && ReadDependencies(KeyHash, Files))
+		{
+			SetDependencies(KeyHash, Files);
+			Known = true;
+		}
+
+		if (Known && !Directory.empty() && ReadObject(GetObjectHash(KeyHash, CompilerHash, Files), Output.Bytecode))
+		{
+			Output.Includes.assign(Files.begin() + 1, Files.end());
+			Output.Messages.clear();
+
+			if (FromCache)
+			{
+				*FromCache = true;
+			}
+
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumHits++;
+			}
+
+			return true;
+		}
+
+		Output.Bytecode.clear();
+		Output.Includes.clear();
+
+		if (!Compiler.Compile(Key, Output))
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Stats.NumMisses++;
+				Stats.NumFailed++;
+			}
+
+			return false;
+		}
+
+		// The source first, then every include once in the order they were read.
+
+		Files.clear();
+		Files.push_back(NormalizePath(Key.Path));
+
+		for (const WString & Include : Output.Includes)
+		{
+			WString File = NormalizePath(Include);
+
+			if (std::find(Files.begin(), Files.end(), File) == Files.end())
+			{
+				Files.push_back(std::move(File));
+			}
+		}
+
+		SetDependencies(KeyHash, Files);
+
+		if (!Directory.empty())
+		{
+			WriteObject(GetObjectHash(KeyHash, CompilerHash, Files), Output.Bytecode);
+			WriteDependencies(KeyHash, Files);
+		}
+
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			Stats.NumMisses++;
+		}
+
+		return true;
+	}
+
+	TVector<Uint64> CShaderCache::Invalidate(const WStringView & Path)
+	{
+		const WString Normalized = NormalizePath(Path);
+
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		FileHashes.erase(Normalized);
+
+		TVector<Uint64> Keys;
+
+		if (const THashSet<Uint64> * Affected = Dependents.Find(Normalized))
+		{
+			Keys.assign(Affected->begin(), Affected->end());
+		}
+
+		return Keys;
+	}
+
+	void CShaderCache::Clear()
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+
+		FileHashes.clear();
+		Dependencies.clear();
+		Dependents.clear();
+
+		Stats = ShaderCacheStats();
+	}
+
+	ShaderCacheStats CShaderCache::GetStats() const
+	{
+		std::lock_guard<TMutex> Lock(Mutex);
+		{
+			return Stats;
+		}
+	}
+}
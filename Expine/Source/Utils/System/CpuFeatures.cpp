@@ -0,0 +1,97 @@
+#include "Utils/System/CpuFeatures.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace System
+{
+	namespace
+	{
+		void QueryCpuid(const Uint32 Leaf, const Uint32 SubLeaf, Uint32 Registers[4])
+		{
+#ifdef _MSC_VER
+			int Values[4];
+			{
+				__cpuidex(Values, static_cast<int>(Leaf), static_cast<int>(SubLeaf));
+			}
+
+			for (Uint32 N = 0; N < 4; ++N)
+			{
+				Registers[N] = static_cast<Uint32>(Values[N]);
+			}
+#else
+			__cpuid_count(Leaf, SubLeaf, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+		}
+
+		// XCR0 bits 1 and 2, the OS saves XMM and YMM registers on context switches.
+
+		bool IsYmmStateEnabled()
+		{
+#ifdef _MSC_VER
+			return (_xgetbv(0) & 6) == 6;
+#else
+			Uint32 Low;
+			Uint32 High;
+
+			__asm__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+
+			return (Low & 6) == 6;
+#endif
+		}
+
+		CpuFeatures DetectCpuFeatures()
+		{
+			CpuFeatures Features;
+
+			Uint32 Registers[4];
+			{
+				QueryCpuid(0, 0, Registers);
+			}
+
+			const Uint32 MaxLeaf = Registers[0];
+
+			if (MaxLeaf < 1)
+			{
+				return Features;
+			}
+
+			QueryCpuid(1, 0, Registers);
+
+			const Uint32 Ecx = Registers[2];
+
+			Features.SSSE3	= (Ecx & (1U << 9)) != 0;
+			Features.SSE41	= (Ecx & (1U << 19)) != 0;
+
+			const bool OSXSave = (Ecx & (1U << 27)) != 0;
+
+			if (!OSXSave || !IsYmmStateEnabled())
+			{
+				return Features;
+			}
+
+			Features.AVX	= (Ecx & (1U << 28)) != 0;
+			Features.FMA	= Features.AVX && (Ecx & (1U << 12)) != 0;
+
+			if (MaxLeaf >= 7)
+			{
+				QueryCpuid(7, 0, Registers);
+				{
+					Features.AVX2 = Features.AVX && (Registers[1] & (1U << 5)) != 0;
+				}
+			}
+
+			return Features;
+		}
+	}
+
+	const CpuFeatures & GetCpuFeatures()
+	{
+		static const CpuFeatures Features = DetectCpuFeatures();
+
+		return Features;
+	}
+}
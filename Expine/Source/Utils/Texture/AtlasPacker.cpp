@@ -0,0 +1,571 @@
+#include "Utils/Texture/AtlasPacker.h"
+#include "Utils/Texture/DDSContainer.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace Texture
+{
+	namespace Atlas
+	{
+		namespace
+		{
+			struct FreeRect
+			{
+				Uint32 X, Y, Width, Height;
+
+				inline bool Contains(const FreeRect & Other) const
+				{
+					return
+						Other.X >= X && Other.X + Other.Width <= X + Width &&
+						Other.Y >= Y && Other.Y + Other.Height <= Y + Height;
+				}
+			};
+
+			inline Uint32 AlignUp(const Uint32 Value, const Uint32 Alignment)
+			{
+				return (Value + Alignment - 1) & ~(Alignment - 1);
+			}
+
+			inline Uint32 AlignDown(const Uint32 Value, const Uint32 Alignment)
+			{
+				return Value & ~(Alignment - 1);
+			}
+
+			inline bool IsPowerOfTwo(const Uint32 Value)
+			{
+				return Value != 0 && (Value & (Value - 1)) == 0;
+			}
+
+			inline Uint32 NextPowerOfTwo(const Uint32 Value)
+			{
+				Uint32 Result = 1;
+
+				while (Result < Value)
+				{
+					Result <<= 1;
+				}
+
+				return Result;
+			}
+
+			class CMaxRectsPage
+			{
+			private:
+
+				TVector<FreeRect> Free;
+
+			private:
+
+				void Split(const FreeRect & Used)
+				{
+					TVector<FreeRect> Result;
+
+					for (const FreeRect & Rect : Free)
+					{
+						if (Used.X >= Rect.X + Rect.Width || Used.X + Used.Width <= Rect.X ||
+							Used.Y >= Rect.Y + Rect.Height || Used.Y + Used.Height <= Rect.Y)
+						{
+							Result.push_back(Rect);
+							continue;
+						}
+
+						if (Used.X > Rect.X)
+						{
+							Result.push_back({ Rect.X, Rect.Y, Used.X - Rect.X, Rect.Height });
+						}
+
+						if (Used.X + Used.Width < Rect.X + Rect.Width)
+						{
+							Result.push_back({ Used.X + Used.Width, Rect.Y, Rect.X + Rect.Width - Used.X - Used.Width, Rect.Height });
+						}
+
+						if (Used.Y > Rect.Y)
+						{
+							Result.push_back({ Rect.X, Rect.Y, Rect.Width, Used.Y - Rect.Y });
+						}
+
+						if (Used.Y + Used.Height < Rect.Y + Rect.Height)
+						{
+							Result.push_back({ Rect.X, Used.Y + Used.Height, Rect.Width, Rect.Y + Rect.Height - Used.Y - Used.Height });
+						}
+					}
+
+					// Drops rectangles inside others, of two equal ones the first is kept.
+
+					Free.clear();
+
+					for (size_t N = 0; N < Result.size(); ++N)
+					{
+						bool Redundant = false;
+
+						for (size_t M = 0; M < Result.size() && !Redundant; ++M)
+						{
+							if (N != M && Result[M].Contains(Result[N]))
+							{
+								Redundant = !Result[N].Contains(Result[M]) || M < N;
+							}
+						}
+
+						if (!Redundant)
+						{
+							Free.push_back(Result[N]);
+						}
+					}
+				}
+
+			public:
+
+				CMaxRectsPage(const Uint32 Width, const Uint32 Height)
+				{
+					Free.push_back({ 0, 0, Width, Height });
+				}
+
+				bool Insert(const Uint32 Width, const Uint32 Height, Uint32 & X, Uint32 & Y)
+				{
+					const FreeRect *	Best = NULL;
+					Uint32				BestShort = 0;
+					Uint32				BestLong = 0;
+
+					for (const FreeRect & Rect : Free)
+					{
+						if (Rect.Width < Width || Rect.Height < Height)
+						{
+							continue;
+						}
+
+						const Uint32 Short	= std::min(Rect.Width - Width, Rect.Height - Height);
+						const Uint32 Long	= std::max(Rect.Width - Width, Rect.Height - Height);
+
+						if (!Best ||
+							Short < BestShort || (Short == BestShort &&
+							(Long < BestLong || (Long == BestLong &&
+							(Rect.Y < Best->Y || (Rect.Y == Best->Y && Rect.X < Best->X))))))
+						{
+							Best		= &Rect;
+							BestShort	= Short;
+							BestLong	= Long;
+						}
+					}
+
+					if (!Best)
+					{
+						return false;
+					}
+
+					X = Best->X;
+					Y = Best->Y;
+
+					Split({ X, Y, Width, Height });
+
+					return true;
+				}
+			};
+
+			// Places what fits on one page in the given order, returns the number placed.
+
+			size_t PackPage
+			(
+				const TVector<PackRect>			& Rects,
+				const TVector<size_t>			& Order,
+				const Uint32					  Page,
+				const Uint32					  Width,
+				const Uint32					  Height,
+					  TVector<PackPlacement>	& Placements,
+					  TVector<size_t>			& Remaining
+			)
+			{
+				CMaxRectsPage Packer(Width, Height);
+
+				size_t Count = 0;
+
+				Remaining.clear();
+
+				for (const size_t Index : Order)
+				{
+					PackPlacement & Placement = Placements[Index];
+
+					if (Packer.Insert(Rects[Index].Width, Rects[Index].Height, Placement.X, Placement.Y))
+					{
+						Placement.Page = Page;
+						Count++;
+					}
+					else
+					{
+						Remaining.push_back(Index);
+					}
+				}
+
+				return Count;
+			}
+		}
+
+		bool PackRectangles
+		(
+			const TVector<PackRect>			& Rects,
+			const Uint32					  MaxWidth,
+			const Uint32					  MaxHeight,
+			const Uint32					  Alignment,
+				  TVector<PackPlacement>	& Placements,
+				  Uint32					& PageWidth,
+				  Uint32					& PageHeight,
+				  Uint32					& NumPages
+		)
+		{
+			if (!IsPowerOfTwo(Alignment))
+			{
+				return false;
+			}
+
+			const Uint32 LimitWidth		= AlignDown(MaxWidth, Alignment);
+			const Uint32 LimitHeight	= AlignDown(MaxHeight, Alignment);
+
+			TVector<PackRect> Aligned(Rects.size());
+
+			Uint64 Area			= 0;
+			Uint32 LargestWidth	= Alignment;
+			Uint32 LargestHeight = Alignment;
+
+			for (size_t N = 0; N < Rects.size(); ++N)
+			{
+				if (Rects[N].Width == 0 || Rects[N].Height == 0)
+				{
+					return false;
+				}
+
+				Aligned[N].Width	= AlignUp(Rects[N].Width, Alignment);
+				Aligned[N].Height	= AlignUp(Rects[N].Height, Alignment);
+
+				if (Aligned[N].Width > LimitWidth || Aligned[N].Height > LimitHeight)
+				{
+					return false;
+				}
+
+				Area += static_cast<Uint64>(Aligned[N].Width) * Aligned[N].Height;
+
+				LargestWidth	= std::max(LargestWidth, Aligned[N].Width);
+				LargestHeight	= std::max(LargestHeight, Aligned[N].Height);
+			}
+
+			// Longest side first, then area, then input order.
+
+			TVector<size_t> Order(Rects.size());
+			{
+				std::iota(Order.begin(), Order.end(), size_t(0));
+			}
+
+			std::sort(Order.begin(), Order.end(), [&](const size_t A, const size_t B)
+			{
+				const Uint32 SideA = std::max(Aligned[A].Width, Aligned[A].Height);
+				const Uint32 SideB = std::max(Aligned[B].Width, Aligned[B].Height);
+
+				if (SideA != SideB)
+				{
+					return SideA > SideB;
+				}
+
+				const Uint64 AreaA = static_cast<Uint64>(Aligned[A].Width) * Aligned[A].Height;
+				const Uint64 AreaB = static_cast<Uint64>(Aligned[B].Width) * Aligned[B].Height;
+
+				if (AreaA != AreaB)
+				{
+					return AreaA > AreaB;
+				}
+
+				return A < B;
+			});
+
+			Placements.assign(Rects.size(), PackPlacement());
+
+			TVector<size_t> Remaining;
+
+			Uint32 Width	= std::min(NextPowerOfTwo(LargestWidth), LimitWidth);
+			Uint32 Height	= std::min(NextPowerOfTwo(LargestHeight), LimitHeight);
+
+			for (;;)
+			{
+				if (static_cast<Uint64>(Width) * Height >= Area &&
+					PackPage(Aligned, Order, 0, Width, Height, Placements, Remaining) == Rects.size())
+				{
+					PageWidth	= Width;
+					PageHeight	= Height;
+					NumPages	= Rects.empty() ? 0 : 1;
+
+					return true;
+				}
+
+				const bool GrowWidth = Width < LimitWidth && (Width <= Height || Height >= LimitHeight);
+
+				if (GrowWidth)
+				{
+					Width = std::min(Width * 2, LimitWidth);
+				}
+				else if (Height < LimitHeight)
+				{
+					Height = std::min(Height * 2, LimitHeight);
+				}
+				else
+				{
+					break;
+				}
+			}
+
+			// Everything does not fit on one page, fill pages of the maximum size.
+
+			PageWidth	= LimitWidth;
+			PageHeight	= LimitHeight;
+			NumPages	= 0;
+
+			TVector<size_t> Pending = Order;
+
+			while (!Pending.empty())
+			{
+				PackPage(Aligned, Pending, NumPages++, PageWidth, PageHeight, Placements, Remaining);
+
+				std::swap(Pending, Remaining);
+			}
+
+			return true;
+		}
+
+		bool CAtlasBuilder::Build(const TVector<BC::ImageRGBA8> & Images, const AtlasOptions & Options)
+		{
+			this->Options = Options;
+
+			Regions.clear();
+			Pages.clear();
+
+			if (Images.empty() ||
+				Options.MipLevels == 0 ||
+				Options.MipLevels > 16 ||
+				!IsPowerOfTwo(Options.BlockAlignment))
+			{
+				return false;
+			}
+
+			for (const BC::ImageRGBA8 & Image : Images)
+			{
+				if (!Image.Data || Image.Width == 0 || Image.Height == 0 || Image.RowPitch < Image.Width * 4ULL)
+				{
+					return false;
+				}
+			}
+
+			NumLevels	= Options.MipLevels;
+			Gutter		= Options.Padding << (NumLevels - 1);
+
+			// Cells start and end on a block of the last kept mip.
+
+			const Uint32 CellAlignment = Options.BlockAlignment << (NumLevels - 1);
+
+			TVector<PackRect> Cells(Images.size());
+			{
+				for (size_t N = 0; N < Images.size(); ++N)
+				{
+					Cells[N].Width	= AlignUp(Images[N].Width + Gutter * 2, CellAlignment);
+					Cells[N].Height	= AlignUp(Images[N].Height + Gutter * 2, CellAlignment);
+				}
+			}
+
+			TVector<PackPlacement> Placements;
+
+			Uint32 NumPages = 0;
+
+			if (!PackRectangles(Cells, Options.MaxWidth, Options.MaxHeight, CellAlignment, Placements, PageWidth, PageHeight, NumPages))
+			{
+				return false;
+			}
+
+			Regions.resize(Images.size());
+			{
+				for (size_t N = 0; N < Images.size(); ++N)
+				{
+					Regions[N].Page		= Placements[N].Page;
+					Regions[N].X		= Placements[N].X + Gutter;
+					Regions[N].Y		= Placements[N].Y + Gutter;
+					Regions[N].Width	= Images[N].Width;
+					Regions[N].Height	= Images[N].Height;
+				}
+			}
+
+			Pages.resize(NumPages);
+			{
+				for (AtlasPage & Page : Pages)
+				{
+					Page.Levels.resize(NumLevels);
+
+					for (Uint32 Level = 0; Level < NumLevels; ++Level)
+					{
+						Page.Levels[Level].assign(static_cast<size_t>(PageWidth >> Level) * (PageHeight >> Level) * 4, 0);
+					}
+				}
+			}
+
+			Mip::MipOptions MipOptions = Options.Mips;
+			{
+				MipOptions.MaxLevels = NumLevels;
+			}
+
+			TAtomic<bool> Failed(false);
+
+			// Cells never overlap, every image writes its own texels on all levels.
+
+			tbb::parallel_for(size_t(0), Images.size(), [&](const size_t Index)
+			{
+				Mip::CMipChain Chain;
+
+				if (!Chain.Generate(Images[Index], MipOptions))
+				{
+					Failed = true;
+					return;
+				}
+
+				const PackPlacement & Placement = Placements[Index];
+
+				TVector<Byte>	LevelPixels;
+				BC::ImageRGBA8	LevelImage;
+
+				for (Uint32 Level = 0; Level < NumLevels; ++Level)
+				{
+					// Images smaller than the kept chain repeat their last level.
+
+					Chain.GetLevel(std::min(Level, Chain.GetNumLevels() - 1), LevelPixels, LevelImage);
+
+					const Uint32 ContentWidth	= std::max(1u, Images[Index].Width >> Level);
+					const Uint32 ContentHeight	= std::max(1u, Images[Index].Height >> Level);
+					const Uint32 LevelGutter	= Gutter >> Level;
+					const Uint32 LevelPitch		= PageWidth >> Level;
+
+					const Uint32 CellX		= Placement.X >> Level;
+					const Uint32 CellY		= Placement.Y >> Level;
+					const Uint32 CellWidth	= Cells[Index].Width >> Level;
+					const Uint32 CellHeight	= Cells[Index].Height >> Level;
+
+					Byte * Target = Pages[Placement.Page].Levels[Level].data();
+
+					const auto Remap = [&](const Uint32 Offset, const Uint32 Size, const Uint32 SourceSize)
+					{
+						Int64 Coord = static_cast<Int64>(Offset) - LevelGutter;
+
+						if (MipOptions.Wrap)
+						{
+							Coord %= Size;
+
+							if (Coord < 0)
+							{
+								Coord += Size;
+							}
+						}
+						else
+						{
+							Coord = std::max<Int64>(0, std::min<Int64>(Coord, Size - 1));
+						}
+
+						return static_cast<Uint32>(Coord * SourceSize / Size);
+					};
+
+					for (Uint32 Y = 0; Y < CellHeight; ++Y)
+					{
+						const Byte *	SourceRow = LevelImage.Data + Remap(Y, ContentHeight, LevelImage.Height) * LevelImage.RowPitch;
+						Byte *			TargetRow = Target + (static_cast<size_t>(CellY + Y) * LevelPitch + CellX) * 4;
+
+						for (Uint32 X = 0; X < CellWidth; ++X)
+						{
+							const Byte * Texel = SourceRow + Remap(X, ContentWidth, LevelImage.Width) * 4;
+
+							TargetRow[X * 4 + 0] = Texel[0];
+							TargetRow[X * 4 + 1] = Texel[1];
+							TargetRow[X * 4 + 2] = Texel[2];
+							TargetRow[X * 4 + 3] = Texel[3];
+						}
+					}
+				}
+			});
+
+			if (Failed)
+			{
+				return false;
+			}
+
+			if (Options.Compress)
+			{
+				for (AtlasPage & Page : Pages)
+				{
+					for (Uint32 Level = 0; Level < NumLevels; ++Level)
+					{
+						BC::ImageRGBA8 Image;
+						{
+							Image.Data		= Page.Levels[Level].data();
+							Image.Width		= PageWidth >> Level;
+							Image.Height	= PageHeight >> Level;
+							Image.RowPitch	= Image.Width * 4ULL;
+						}
+
+						TVector<Byte> Blocks;
+
+						if (!BC::Compress(Image, Options.Compression, Blocks))
+						{
+							return false;
+						}
+
+						Page.Levels[Level].swap(Blocks);
+					}
+				}
+			}
+
+			return true;
+		}
+
+		void CAtlasBuilder::GetRemapTable(TVector<AtlasRemap> & Table) const
+		{
+			Table.resize(Regions.size());
+
+			for (size_t N = 0; N < Regions.size(); ++N)
+			{
+				AtlasRemap & Remap = Table[N];
+				{
+					Remap.OffsetU		= static_cast<Float>(Regions[N].X) / PageWidth;
+					Remap.OffsetV		= static_cast<Float>(Regions[N].Y) / PageHeight;
+					Remap.ScaleU		= static_cast<Float>(Regions[N].Width) / PageWidth;
+					Remap.ScaleV		= static_cast<Float>(Regions[N].Height) / PageHeight;
+					Remap.Slice			= static_cast<Float>(Regions[N].Page);
+					Remap.MaxMip		= static_cast<Float>(NumLevels - 1);
+					Remap.Reserved[0]	= 0.0f;
+					Remap.Reserved[1]	= 0.0f;
+				}
+			}
+		}
+
+		Uint32 CAtlasBuilder::GetFormat() const
+		{
+			if (Options.Compress)
+			{
+				return BC::GetFormat(Options.Compression.Format, Options.Compression.Srgb);
+			}
+
+			return Options.Mips.Srgb ? DDS::DDSFormatR8G8B8A8UnormSrgb : DDS::DDSFormatR8G8B8A8Unorm;
+		}
+
+		bool CAtlasBuilder::WriteContainer(TVector<Byte> & Output) const
+		{
+			if (Pages.empty())
+			{
+				return false;
+			}
+
+			TVector<const Byte*> Subresources;
+
+			for (const AtlasPage & Page : Pages)
+			{
+				for (const TVector<Byte> & Level : Page.Levels)
+				{
+					Subresources.push_back(Level.data());
+				}
+			}
+
+			return DDS::WriteContainer(GetFormat(), PageWidth, PageHeight, static_cast<Uint32>(Pages.size()), NumLevels, Subresources, Output);
+		}
+	}
+}
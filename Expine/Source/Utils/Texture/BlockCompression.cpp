@@ -0,0 +1,1967 @@
+#include "Utils/Texture/BlockCompression.h"
+#include "Utils/Texture/DDSContainer.h"
+#include "Utils/System/CpuFeatures.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Texture
+{
+	namespace BC
+	{
+		namespace
+		{
+			constexpr Float LargeError = 3.402823466e+38F;
+
+			constexpr Uint32 WeightsBC7_2[4] =
+			{
+				0, 21, 43, 64
+			};
+
+			constexpr Uint32 WeightsBC7_3[8] =
+			{
+				0, 9, 18, 27, 37, 46, 55, 64
+			};
+
+			constexpr Uint32 WeightsBC7_4[16] =
+			{
+				0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+			};
+
+			template<class T> inline T Clamp(const T Value, const T Low, const T High)
+			{
+				return Value < Low ? Low : Value > High ? High : Value;
+			}
+
+			class CBitReader
+			{
+			private:
+
+				const Byte *	Data;
+				Uint32			Position = 0;
+
+			public:
+
+				CBitReader(const Byte * Data) :
+					Data(Data)
+				{}
+
+				inline Uint32 Read(const Uint32 Count)
+				{
+					Uint32 Value = 0;
+
+					for (Uint32 N = 0; N < Count; ++N, ++Position)
+					{
+						Value |= ((Data[Position >> 3] >> (Position & 7)) & 1) << N;
+					}
+
+					return Value;
+				}
+			};
+
+			class CBitWriter
+			{
+			private:
+
+				Byte *	Data;
+				Uint32	Position = 0;
+
+			public:
+
+				CBitWriter(Byte * Data, const Uint32 Size) :
+					Data(Data)
+				{
+					std::memset(Data, 0, Size);
+				}
+
+				inline void Write(const Uint32 Value, const Uint32 Count)
+				{
+					for (Uint32 N = 0; N < Count; ++N, ++Position)
+					{
+						Data[Position >> 3] |= static_cast<Byte>(((Value >> N) & 1) << (Position & 7));
+					}
+				}
+			};
+
+			/************************************************************
+			*
+			*	Endpoint fitting
+			*
+			************************************************************/
+
+			// Direction of largest variance through the weighted points,
+			// found by power iteration on the covariance matrix.
+
+			void ComputePrincipalAxis(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Uint32 NumChannels, Float Mean[4], Float Axis[4])
+			{
+				Float Total = 0.0f;
+
+				for (Uint32 C = 0; C < 4; ++C)
+				{
+					Mean[C] = 0.0f;
+					Axis[C] = 0.0f;
+				}
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						Mean[C] += Points[N][C] * Weights[N];
+					}
+
+					Total += Weights[N];
+				}
+
+				if (Total <= 0.0f)
+				{
+					return;
+				}
+
+				for (Uint32 C = 0; C < NumChannels; ++C)
+				{
+					Mean[C] /= Total;
+				}
+
+				Float Covariance[4][4] = {};
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Float Delta[4];
+
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						Delta[C] = Points[N][C] - Mean[C];
+					}
+
+					for (Uint32 Row = 0; Row < NumChannels; ++Row)
+					{
+						for (Uint32 Column = Row; Column < NumChannels; ++Column)
+						{
+							Covariance[Row][Column] += Delta[Row] * Delta[Column] * Weights[N];
+						}
+					}
+				}
+
+				for (Uint32 Row = 0; Row < NumChannels; ++Row)
+				{
+					for (Uint32 Column = 0; Column < Row; ++Column)
+					{
+						Covariance[Row][Column] = Covariance[Column][Row];
+					}
+				}
+
+				// Start with the row of the channel with the largest variance.
+
+				Uint32 Largest = 0;
+
+				for (Uint32 C = 1; C < NumChannels; ++C)
+				{
+					if (Covariance[C][C] > Covariance[Largest][Largest])
+					{
+						Largest = C;
+					}
+				}
+
+				if (Covariance[Largest][Largest] <= 0.0f)
+				{
+					return;
+				}
+
+				for (Uint32 C = 0; C < NumChannels; ++C)
+				{
+					Axis[C] = Covariance[Largest][C];
+				}
+
+				for (Uint32 Iteration = 0; Iteration < 8; ++Iteration)
+				{
+					Float Next[4] = {};
+					Float Scale = 0.0f;
+
+					for (Uint32 Row = 0; Row < NumChannels; ++Row)
+					{
+						for (Uint32 Column = 0; Column < NumChannels; ++Column)
+						{
+							Next[Row] += Covariance[Row][Column] * Axis[Column];
+						}
+
+						Scale = std::fmax(Scale, std::fabs(Next[Row]));
+					}
+
+					if (Scale <= 0.0f)
+					{
+						break;
+					}
+
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						Axis[C] = Next[C] / Scale;
+					}
+				}
+
+				Float Length = 0.0f;
+
+				for (Uint32 C = 0; C < NumChannels; ++C)
+				{
+					Length += Axis[C] * Axis[C];
+				}
+
+				Length = std::sqrt(Length);
+
+				for (Uint32 C = 0; C < NumChannels; ++C)
+				{
+					Axis[C] = Length > 0.0f ? Axis[C] / Length : 0.0f;
+				}
+			}
+
+			// Endpoints spanning the projection of the points onto the principal axis.
+
+			void ComputeAxisEndpoints(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Uint32 NumChannels, Float E0[4], Float E1[4])
+			{
+				Float Mean[4];
+				Float Axis[4];
+
+				ComputePrincipalAxis(Points, Weights, NumChannels, Mean, Axis);
+
+				Float Low	= LargeError;
+				Float High	= -LargeError;
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					if (Weights[N] <= 0.0f)
+					{
+						continue;
+					}
+
+					Float Projection = 0.0f;
+
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						Projection += (Points[N][C] - Mean[C]) * Axis[C];
+					}
+
+					Low		= std::fmin(Low, Projection);
+					High	= std::fmax(High, Projection);
+				}
+
+				if (Low > High)
+				{
+					Low = High = 0.0f;
+				}
+
+				for (Uint32 C = 0; C < 4; ++C)
+				{
+					E0[C] = C < NumChannels ? Mean[C] + Axis[C] * Low : 0.0f;
+					E1[C] = C < NumChannels ? Mean[C] + Axis[C] * High : 0.0f;
+				}
+			}
+
+			// Least squares endpoints for fixed interpolation factors.
+
+			bool SolveEndpoints(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Float Factors[BlockPixels], const Uint32 NumChannels, Float E0[4], Float E1[4])
+			{
+				Float A = 0.0f;
+				Float B = 0.0f;
+				Float C = 0.0f;
+
+				Float RhsA[4] = {};
+				Float RhsB[4] = {};
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					const Float T = Factors[N];
+					const Float S = 1.0f - T;
+					const Float W = Weights[N];
+
+					A += S * S * W;
+					B += S * T * W;
+					C += T * T * W;
+
+					for (Uint32 Channel = 0; Channel < NumChannels; ++Channel)
+					{
+						RhsA[Channel] += S * Points[N][Channel] * W;
+						RhsB[Channel] += T * Points[N][Channel] * W;
+					}
+				}
+
+				const Float Determinant = A * C - B * B;
+
+				if (std::fabs(Determinant) < 1e-6f)
+				{
+					return false;
+				}
+
+				for (Uint32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					E0[Channel] = (C * RhsA[Channel] - B * RhsB[Channel]) / Determinant;
+					E1[Channel] = (A * RhsB[Channel] - B * RhsA[Channel]) / Determinant;
+				}
+
+				return true;
+			}
+
+			// Picks the closest palette entry for every pixel, four pixels at a time.
+			// Returns the weighted squared error of the block.
+
+			Float SelectIndices(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Float Palette[][4], const Uint32 NumEntries, const Uint32 NumChannels, Uint32 Indices[BlockPixels])
+			{
+				alignas(16) Float Channels[4][BlockPixels];
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					for (Uint32 C = 0; C < 4; ++C)
+					{
+						Channels[C][N] = Points[N][C];
+					}
+				}
+
+				__m128 Total = _mm_setzero_ps();
+
+				for (Uint32 Group = 0; Group < BlockPixels; Group += 4)
+				{
+					__m128 Best			= _mm_set1_ps(LargeError);
+					__m128 BestIndex	= _mm_setzero_ps();
+
+					for (Uint32 Entry = 0; Entry < NumEntries; ++Entry)
+					{
+						__m128 Distance = _mm_setzero_ps();
+
+						for (Uint32 C = 0; C < NumChannels; ++C)
+						{
+							const __m128 Delta = _mm_sub_ps(_mm_load_ps(Channels[C] + Group), _mm_set1_ps(Palette[Entry][C]));
+							{
+								Distance = _mm_add_ps(Distance, _mm_mul_ps(Delta, Delta));
+							}
+						}
+
+						const __m128 Closer = _mm_cmplt_ps(Distance, Best);
+
+						Best		= _mm_min_ps(Distance, Best);
+						BestIndex	= _mm_or_ps(_mm_and_ps(Closer, _mm_set1_ps(static_cast<Float>(Entry))), _mm_andnot_ps(Closer, BestIndex));
+					}
+
+					Total = _mm_add_ps(Total, _mm_mul_ps(Best, _mm_loadu_ps(Weights + Group)));
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Indices + Group), _mm_cvttps_epi32(BestIndex));
+				}
+
+				alignas(16) Float Sum[4];
+				{
+					_mm_store_ps(Sum, Total);
+				}
+
+				return Sum[0] + Sum[1] + Sum[2] + Sum[3];
+			}
+
+			/************************************************************
+			*
+			*	BC1 to BC5
+			*
+			************************************************************/
+
+			inline Uint16 QuantizeColor565(const Float Color[4])
+			{
+				const Uint32 R = static_cast<Uint32>(Clamp(static_cast<Int32>(Color[0] * 31.0f / 255.0f + 0.5f), 0, 31));
+				const Uint32 G = static_cast<Uint32>(Clamp(static_cast<Int32>(Color[1] * 63.0f / 255.0f + 0.5f), 0, 63));
+				const Uint32 B = static_cast<Uint32>(Clamp(static_cast<Int32>(Color[2] * 31.0f / 255.0f + 0.5f), 0, 31));
+
+				return static_cast<Uint16>(R << 11 | G << 5 | B);
+			}
+
+			inline void ExpandColor565(const Uint16 Color, Byte Pixel[4])
+			{
+				const Uint32 R = (Color >> 11) & 31;
+				const Uint32 G = (Color >> 5) & 63;
+				const Uint32 B = Color & 31;
+
+				Pixel[0] = static_cast<Byte>(R << 3 | R >> 2);
+				Pixel[1] = static_cast<Byte>(G << 2 | G >> 4);
+				Pixel[2] = static_cast<Byte>(B << 3 | B >> 2);
+				Pixel[3] = 255;
+			}
+
+			// Shared by encoder and decoder so both agree on the rounding.
+
+			void BuildPaletteBC1(const Uint16 C0, const Uint16 C1, const bool FourColor, Byte Palette[4][4])
+			{
+				ExpandColor565(C0, Palette[0]);
+				ExpandColor565(C1, Palette[1]);
+
+				if (FourColor || C0 > C1)
+				{
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						Palette[2][C] = static_cast<Byte>((2 * Palette[0][C] + Palette[1][C] + 1) / 3);
+						Palette[3][C] = static_cast<Byte>((Palette[0][C] + 2 * Palette[1][C] + 1) / 3);
+					}
+
+					Palette[2][3] = 255;
+					Palette[3][3] = 255;
+				}
+				else
+				{
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						Palette[2][C] = static_cast<Byte>((Palette[0][C] + Palette[1][C] + 1) / 2);
+						Palette[3][C] = 0;
+					}
+
+					Palette[2][3] = 255;
+					Palette[3][3] = 0;
+				}
+			}
+
+			void BuildPaletteBC4(const Uint32 E0, const Uint32 E1, Uint32 Palette[8])
+			{
+				Palette[0] = E0;
+				Palette[1] = E1;
+
+				if (E0 > E1)
+				{
+					for (Uint32 N = 0; N < 6; ++N)
+					{
+						Palette[N + 2] = ((6 - N) * E0 + (1 + N) * E1 + 3) / 7;
+					}
+				}
+				else
+				{
+					for (Uint32 N = 0; N < 4; ++N)
+					{
+						Palette[N + 2] = ((4 - N) * E0 + (1 + N) * E1 + 2) / 5;
+					}
+
+					Palette[6] = 0;
+					Palette[7] = 255;
+				}
+			}
+
+			/************************************************************
+			*
+			*	Decoder palette lookups. The palette of a block fits
+			*	into one register and is indexed with byte shuffles,
+			*	so these need SSSE3. Without it the decoders keep
+			*	their scalar loops.
+			*
+			************************************************************/
+
+			const bool DecodeWithSSSE3 = System::GetCpuFeatures().SSSE3;
+
+			// Places byte N of a row at channel C of pixel N, the others are zeroed.
+
+			alignas(16) constexpr Uint8 SpreadChannel[4][16] =
+			{
+				{ 0, 0x80, 0x80, 0x80, 1, 0x80, 0x80, 0x80, 2, 0x80, 0x80, 0x80, 3, 0x80, 0x80, 0x80 },
+				{ 0x80, 0, 0x80, 0x80, 0x80, 1, 0x80, 0x80, 0x80, 2, 0x80, 0x80, 0x80, 3, 0x80, 0x80 },
+				{ 0x80, 0x80, 0, 0x80, 0x80, 0x80, 1, 0x80, 0x80, 0x80, 2, 0x80, 0x80, 0x80, 3, 0x80 },
+				{ 0x80, 0x80, 0x80, 0, 0x80, 0x80, 0x80, 1, 0x80, 0x80, 0x80, 2, 0x80, 0x80, 0x80, 3 }
+			};
+
+			void LookupPaletteBC1(const Byte Palette[4][4], const Uint32 IndexBits, Byte Pixels[BlockPixels][4])
+			{
+				const __m128i Entries = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Palette));
+
+				// Replicates every index byte four times, then tests both
+				// bits of each pixel to get the byte offset of its entry.
+
+				const __m128i Replicate	= _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+				const __m128i Bits		= _mm_shuffle_epi8(_mm_cvtsi32_si128(static_cast<Int32>(IndexBits)), Replicate);
+				const __m128i LowBit	= _mm_set1_epi32(0x40100401);
+				const __m128i HighBit	= _mm_add_epi8(LowBit, LowBit);
+
+				const __m128i Offsets = _mm_or_si128
+				(
+					_mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(Bits, LowBit), LowBit), _mm_set1_epi8(4)),
+					_mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(Bits, HighBit), HighBit), _mm_set1_epi8(8))
+				);
+
+				const __m128i Bytes = _mm_set1_epi32(0x03020100);
+
+				for (Uint32 Row = 0; Row < BlockDimension; ++Row)
+				{
+					const __m128i Control = _mm_add_epi8(_mm_shuffle_epi8(Offsets, _mm_add_epi8(Replicate, _mm_set1_epi8(static_cast<char>(Row * 4)))), Bytes);
+					{
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(Pixels[Row * BlockDimension]), _mm_shuffle_epi8(Entries, Control));
+					}
+				}
+			}
+
+			// Writes a single channel, the other three are kept.
+
+			void LookupPaletteBC4(const Uint32 Palette[8], const Byte * Block, const Uint32 Channel, Byte Pixels[BlockPixels][4])
+			{
+				const __m128i Words		= _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Palette)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(Palette + 4)));
+				const __m128i Entries	= _mm_packus_epi16(Words, Words);
+
+				// Every 16 bit lane holds the two bytes around a 3 bit index,
+				// the multiply shifts the index to the top byte. Both halves of
+				// the block share the bit offsets 0, 3, 6, 1, 4, 7, 2, 5.
+
+				const __m128i Source	= _mm_loadl_epi64(reinterpret_cast<const __m128i*>(Block));
+				const __m128i Shifts	= _mm_setr_epi16(256, 32, 4, 128, 16, 2, 64, 8);
+				const __m128i Mask		= _mm_set1_epi16(7);
+
+				const __m128i Low	= _mm_shuffle_epi8(Source, _mm_setr_epi8(2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5));
+				const __m128i High	= _mm_shuffle_epi8(Source, _mm_setr_epi8(5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, 8, 7, 8));
+
+				const __m128i Indices = _mm_packus_epi16
+				(
+					_mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(Low, Shifts), 8), Mask),
+					_mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(High, Shifts), 8), Mask)
+				);
+
+				const __m128i Values		= _mm_shuffle_epi8(Entries, Indices);
+				const __m128i Spread		= _mm_load_si128(reinterpret_cast<const __m128i*>(SpreadChannel[Channel]));
+				const __m128i ChannelMask	= _mm_set1_epi32(static_cast<Int32>(0xFFU << (Channel * 8)));
+
+				for (Uint32 Row = 0; Row < BlockDimension; ++Row)
+				{
+					// Zeroed bytes of the spread become 0x80 + 4 * Row and still select zero.
+
+					const __m128i Result = _mm_shuffle_epi8(Values, _mm_add_epi8(Spread, _mm_set1_epi8(static_cast<char>(Row * 4))));
+
+					__m128i * Target = reinterpret_cast<__m128i*>(Pixels[Row * BlockDimension]);
+					{
+						_mm_storeu_si128(Target, _mm_or_si128(_mm_andnot_si128(ChannelMask, _mm_loadu_si128(Target)), Result));
+					}
+				}
+			}
+
+			struct ColorCandidate
+			{
+				Uint16	C0;
+				Uint16	C1;
+				Uint32	Indices[BlockPixels];
+				Float	Error = LargeError;
+			};
+
+			void EncodeColorBlock(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality, const bool AlphaCutout, const Uint8 AlphaThreshold, const bool FourColor)
+			{
+				Float Points[BlockPixels][4];
+				Float Weights[BlockPixels];
+
+				Uint32 NumOpaque = 0;
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					for (Uint32 C = 0; C < 4; ++C)
+					{
+						Points[N][C] = Pixels[N][C];
+					}
+
+					Weights[N] = AlphaCutout && Pixels[N][3] < AlphaThreshold ? 0.0f : 1.0f;
+
+					if (Weights[N] > 0.0f)
+					{
+						NumOpaque++;
+					}
+				}
+
+				// Transparent pixels need the three color mode.
+
+				const bool ThreeColor = NumOpaque < BlockPixels;
+
+				if (NumOpaque == 0)
+				{
+					std::memset(Block, 0, 4);
+					std::memset(Block + 4, 0xFF, 4);
+					return;
+				}
+
+				auto Evaluate = [&](const Float E0[4], const Float E1[4], ColorCandidate & Candidate)
+				{
+					Uint16 C0 = QuantizeColor565(E0);
+					Uint16 C1 = QuantizeColor565(E1);
+
+					if (ThreeColor ? C0 > C1 : C0 < C1)
+					{
+						std::swap(C0, C1);
+					}
+
+					Byte	Palette[4][4];
+					Float	PaletteValues[4][4];
+
+					BuildPaletteBC1(C0, C1, FourColor, Palette);
+
+					for (Uint32 Entry = 0; Entry < 4; ++Entry)
+					{
+						for (Uint32 C = 0; C < 4; ++C)
+						{
+							PaletteValues[Entry][C] = Palette[Entry][C];
+						}
+					}
+
+					// Equal endpoints decode in three color mode unless forced.
+
+					const Uint32 NumEntries = ThreeColor || (C0 == C1 && !FourColor) ? 3 : 4;
+
+					Candidate.C0	= C0;
+					Candidate.C1	= C1;
+					Candidate.Error	= SelectIndices(Points, Weights, PaletteValues, NumEntries, 3, Candidate.Indices);
+
+					for (Uint32 N = 0; N < BlockPixels; ++N)
+					{
+						if (Weights[N] <= 0.0f)
+						{
+							Candidate.Indices[N] = 3;
+						}
+					}
+				};
+
+				Float E0[4];
+				Float E1[4];
+
+				ComputeAxisEndpoints(Points, Weights, 3, E0, E1);
+
+				if (Quality == BlockQualityFast)
+				{
+					// Insetting the endpoints trades range for precision in the middle.
+
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						const Float Inset = (E1[C] - E0[C]) / 16.0f;
+
+						E0[C] += Inset;
+						E1[C] -= Inset;
+					}
+				}
+
+				ColorCandidate Best;
+				{
+					Evaluate(E0, E1, Best);
+				}
+
+				const Uint32 NumIterations = Quality == BlockQualityHigh ? 4 : Quality == BlockQualityNormal ? 1 : 0;
+
+				for (Uint32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+				{
+					static constexpr Float FactorsFour[4]	= { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+					static constexpr Float FactorsThree[4]	= { 0.0f, 1.0f, 0.5f, 0.0f };
+
+					const bool FourColorMode = !ThreeColor && Best.C0 > Best.C1;
+
+					Float Factors[BlockPixels];
+
+					for (Uint32 N = 0; N < BlockPixels; ++N)
+					{
+						Factors[N] = FourColorMode || FourColor ? FactorsFour[Best.Indices[N]] : FactorsThree[Best.Indices[N]];
+					}
+
+					if (!SolveEndpoints(Points, Weights, Factors, 3, E0, E1))
+					{
+						break;
+					}
+
+					ColorCandidate Candidate;
+					{
+						Evaluate(E0, E1, Candidate);
+					}
+
+					if (Candidate.Error >= Best.Error)
+					{
+						break;
+					}
+
+					Best = Candidate;
+				}
+
+				Uint32 IndexBits = 0;
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					IndexBits |= Best.Indices[N] << (N * 2);
+				}
+
+				Block[0] = static_cast<Byte>(Best.C0);
+				Block[1] = static_cast<Byte>(Best.C0 >> 8);
+				Block[2] = static_cast<Byte>(Best.C1);
+				Block[3] = static_cast<Byte>(Best.C1 >> 8);
+				Block[4] = static_cast<Byte>(IndexBits);
+				Block[5] = static_cast<Byte>(IndexBits >> 8);
+				Block[6] = static_cast<Byte>(IndexBits >> 16);
+				Block[7] = static_cast<Byte>(IndexBits >> 24);
+			}
+
+			Uint32 SelectIndicesBC4(const Uint32 Values[BlockPixels], const Uint32 E0, const Uint32 E1, Uint32 Indices[BlockPixels])
+			{
+				Uint32 Palette[8];
+				{
+					BuildPaletteBC4(E0, E1, Palette);
+				}
+
+				Uint32 Error = 0;
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Uint32 BestError = ~0U;
+
+					for (Uint32 Entry = 0; Entry < 8; ++Entry)
+					{
+						const Int32 Delta = static_cast<Int32>(Values[N]) - static_cast<Int32>(Palette[Entry]);
+						const Uint32 EntryError = static_cast<Uint32>(Delta * Delta);
+
+						if (EntryError < BestError)
+						{
+							BestError	= EntryError;
+							Indices[N]	= Entry;
+						}
+					}
+
+					Error += BestError;
+				}
+
+				return Error;
+			}
+
+			/************************************************************
+			*
+			*	BC7 and BC6H
+			*
+			************************************************************/
+
+			struct CandidateBC7
+			{
+				Uint32	Q0[4];
+				Uint32	Q1[4];
+				Uint32	P0;
+				Uint32	P1;
+				Uint32	Indices[BlockPixels];
+				Float	Error = LargeError;
+			};
+
+			void EvaluateBC7(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Float E0[4], const Float E1[4], CandidateBC7 & Best)
+			{
+				// Endpoints are 7 bits plus a p-bit shared by all channels.
+
+				for (Uint32 P0 = 0; P0 < 2; ++P0)
+				{
+					for (Uint32 P1 = 0; P1 < 2; ++P1)
+					{
+						CandidateBC7 Candidate;
+
+						Candidate.P0 = P0;
+						Candidate.P1 = P1;
+
+						for (Uint32 C = 0; C < 4; ++C)
+						{
+							Candidate.Q0[C] = static_cast<Uint32>(Clamp(static_cast<Int32>(std::floor((E0[C] - P0) * 0.5f + 0.5f)), 0, 127));
+							Candidate.Q1[C] = static_cast<Uint32>(Clamp(static_cast<Int32>(std::floor((E1[C] - P1) * 0.5f + 0.5f)), 0, 127));
+						}
+
+						Float Palette[16][4];
+
+						for (Uint32 Entry = 0; Entry < 16; ++Entry)
+						{
+							const Uint32 W = WeightsBC7_4[Entry];
+
+							for (Uint32 C = 0; C < 4; ++C)
+							{
+								const Uint32 V0 = Candidate.Q0[C] << 1 | P0;
+								const Uint32 V1 = Candidate.Q1[C] << 1 | P1;
+
+								Palette[Entry][C] = static_cast<Float>(((64 - W) * V0 + W * V1 + 32) >> 6);
+							}
+						}
+
+						Candidate.Error = SelectIndices(Points, Weights, Palette, 16, 4, Candidate.Indices);
+
+						if (Candidate.Error < Best.Error)
+						{
+							Best = Candidate;
+						}
+					}
+				}
+			}
+
+			inline Int32 UnquantizeBC6H(const Int32 Value)
+			{
+				if (Value == 0)
+				{
+					return 0;
+				}
+
+				if (Value == 1023)
+				{
+					return 0xFFFF;
+				}
+
+				return ((Value << 16) + 0x8000) >> 10;
+			}
+
+			inline Int32 UnquantizeBC6HSigned(Int32 Value)
+			{
+				const bool Negative = Value < 0;
+
+				if (Negative)
+				{
+					Value = -Value;
+				}
+
+				Int32 Result;
+
+				if (Value == 0)
+				{
+					Result = 0;
+				}
+				else if (Value >= 511)
+				{
+					Result = 0x7FFF;
+				}
+				else
+				{
+					Result = ((Value << 15) + 0x4000) >> 9;
+				}
+
+				return Negative ? -Result : Result;
+			}
+
+			inline Int32 FinishBC6H(const Int32 Value)
+			{
+				return (Value * 31) >> 6;
+			}
+
+			inline Uint32 QuantizeBC6H(const Float Value)
+			{
+				const Int32 Estimate = Clamp(static_cast<Int32>((Value * 64.0f / 31.0f - 32.0f) / 64.0f + 0.5f), 0, 1023);
+
+				Int32 Best		= Estimate;
+				Float BestError	= LargeError;
+
+				for (Int32 Candidate = std::max(Estimate - 1, 0); Candidate <= std::min(Estimate + 1, 1023); ++Candidate)
+				{
+					const Float Error = std::fabs(static_cast<Float>(FinishBC6H(UnquantizeBC6H(Candidate))) - Value);
+
+					if (Error < BestError)
+					{
+						Best		= Candidate;
+						BestError	= Error;
+					}
+				}
+
+				return static_cast<Uint32>(Best);
+			}
+
+			struct CandidateBC6H
+			{
+				Uint32	Q0[3];
+				Uint32	Q1[3];
+				Uint32	Indices[BlockPixels];
+				Float	Error = LargeError;
+			};
+
+			void EvaluateBC6H(const Float Points[BlockPixels][4], const Float Weights[BlockPixels], const Float E0[4], const Float E1[4], CandidateBC6H & Candidate)
+			{
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					Candidate.Q0[C] = QuantizeBC6H(E0[C]);
+					Candidate.Q1[C] = QuantizeBC6H(E1[C]);
+				}
+
+				Float Palette[16][4] = {};
+
+				for (Uint32 Entry = 0; Entry < 16; ++Entry)
+				{
+					const Int32 W = static_cast<Int32>(WeightsBC7_4[Entry]);
+
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						const Int32 U0 = UnquantizeBC6H(static_cast<Int32>(Candidate.Q0[C]));
+						const Int32 U1 = UnquantizeBC6H(static_cast<Int32>(Candidate.Q1[C]));
+
+						Palette[Entry][C] = static_cast<Float>(FinishBC6H(((64 - W) * U0 + W * U1 + 32) >> 6));
+					}
+				}
+
+				Candidate.Error = SelectIndices(Points, Weights, Palette, 16, 3, Candidate.Indices);
+			}
+
+			void WriteIndices4(CBitWriter & Writer, const Uint32 Indices[BlockPixels])
+			{
+				// The anchor index drops its most significant bit.
+
+				Writer.Write(Indices[0], 3);
+
+				for (Uint32 N = 1; N < BlockPixels; ++N)
+				{
+					Writer.Write(Indices[N], 4);
+				}
+			}
+
+			inline Uint32 GetBlockChannels(const BlockCompressionOptions & Options)
+			{
+				switch (Options.Format)
+				{
+					case BlockFormatBC1:
+						return Options.AlphaCutout ? 4 : 3;
+					case BlockFormatBC4:
+						return 1;
+					case BlockFormatBC5:
+						return 2;
+					case BlockFormatBC6H:
+						return 3;
+					default:
+						return 4;
+				}
+			}
+
+			template<class Function> void ForEachBlock(const Uint32 Width, const Uint32 Height, Function && Callback)
+			{
+				const Uint32 BlocksWide = (Width + BlockDimension - 1) / BlockDimension;
+				const Uint32 BlocksHigh = (Height + BlockDimension - 1) / BlockDimension;
+
+				tbb::parallel_for(tbb::blocked_range<Uint32>(0, BlocksHigh), [&](const tbb::blocked_range<Uint32> & Range)
+				{
+					for (Uint32 BlockY = Range.begin(); BlockY != Range.end(); ++BlockY)
+					{
+						for (Uint32 BlockX = 0; BlockX < BlocksWide; ++BlockX)
+						{
+							Callback(BlockX, BlockY, BlockY * BlocksWide + BlockX);
+						}
+					}
+				});
+			}
+
+			template<class Pixel> void GatherBlock(const Byte * Data, const Uint64 RowPitch, const Uint32 Width, const Uint32 Height, const Uint32 BlockX, const Uint32 BlockY, Pixel Pixels[BlockPixels][4])
+			{
+				for (Uint32 Y = 0; Y < BlockDimension; ++Y)
+				{
+					const Uint32 SourceY = std::min(BlockY * BlockDimension + Y, Height - 1);
+
+					const Pixel * Row = reinterpret_cast<const Pixel*>(Data + SourceY * RowPitch);
+
+					for (Uint32 X = 0; X < BlockDimension; ++X)
+					{
+						const Uint32 SourceX = std::min(BlockX * BlockDimension + X, Width - 1);
+
+						std::memcpy(Pixels[Y * BlockDimension + X], Row + SourceX * 4, sizeof(Pixel) * 4);
+					}
+				}
+			}
+
+			template<class Pixel> void ScatterBlock(Pixel * Data, const Uint32 Width, const Uint32 Height, const Uint32 BlockX, const Uint32 BlockY, const Pixel Pixels[BlockPixels][4])
+			{
+				for (Uint32 Y = 0; Y < BlockDimension && BlockY * BlockDimension + Y < Height; ++Y)
+				{
+					for (Uint32 X = 0; X < BlockDimension && BlockX * BlockDimension + X < Width; ++X)
+					{
+						const Uint64 Target = (static_cast<Uint64>(BlockY * BlockDimension + Y) * Width + BlockX * BlockDimension + X) * 4;
+
+						std::memcpy(Data + Target, Pixels[Y * BlockDimension + X], sizeof(Pixel) * 4);
+					}
+				}
+			}
+
+			inline void FillStats(BlockCompressionStats * Stats, const std::chrono::high_resolution_clock::time_point Start, const Uint64 SourceBytes)
+			{
+				const double Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+
+				Stats->Seconds				= Seconds;
+				Stats->MegabytesPerSecond	= Seconds > 0.0 ? static_cast<double>(SourceBytes) / (1024.0 * 1024.0) / Seconds : 0.0;
+			}
+		}
+
+		Uint32 GetBlockSize(const EBlockFormat Format)
+		{
+			return Format == BlockFormatBC1 || Format == BlockFormatBC4 ? 8 : 16;
+		}
+
+		Uint32 GetFormat(const EBlockFormat Format, const bool Srgb)
+		{
+			switch (Format)
+			{
+				case BlockFormatBC1:
+					return Srgb ? DDS::DDSFormatBC1UnormSrgb : DDS::DDSFormatBC1Unorm;
+				case BlockFormatBC3:
+					return Srgb ? DDS::DDSFormatBC3UnormSrgb : DDS::DDSFormatBC3Unorm;
+				case BlockFormatBC4:
+					return DDS::DDSFormatBC4Unorm;
+				case BlockFormatBC5:
+					return DDS::DDSFormatBC5Unorm;
+				case BlockFormatBC6H:
+					return DDS::DDSFormatBC6HUf16;
+				case BlockFormatBC7:
+					return Srgb ? DDS::DDSFormatBC7UnormSrgb : DDS::DDSFormatBC7Unorm;
+			}
+
+			return DDS::DDSFormatUnknown;
+		}
+
+		Uint64 GetCompressedSize(const EBlockFormat Format, const Uint32 Width, const Uint32 Height)
+		{
+			const Uint64 BlocksWide = (Width + BlockDimension - 1) / BlockDimension;
+			const Uint64 BlocksHigh = (Height + BlockDimension - 1) / BlockDimension;
+
+			return BlocksWide * BlocksHigh * GetBlockSize(Format);
+		}
+
+		/************************************************************
+		*
+		*	Block encoders
+		*
+		************************************************************/
+
+		void EncodeBlockBC1(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality, const bool AlphaCutout, const Uint8 AlphaThreshold)
+		{
+			EncodeColorBlock(Pixels, Block, Quality, AlphaCutout, AlphaThreshold, false);
+		}
+
+		void EncodeBlockBC3(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality)
+		{
+			EncodeBlockBC4(Pixels, Block, Quality, 3);
+			EncodeColorBlock(Pixels, Block + 8, Quality, false, 0, true);
+		}
+
+		void EncodeBlockBC4(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality, const Uint32 Channel)
+		{
+			Uint32 Values[BlockPixels];
+
+			Uint32 Low	= 255;
+			Uint32 High	= 0;
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				Values[N] = Pixels[N][Channel];
+
+				Low		= std::min(Low, Values[N]);
+				High	= std::max(High, Values[N]);
+			}
+
+			Uint32 BestE0 = High;
+			Uint32 BestE1 = Low;
+			Uint32 BestIndices[BlockPixels];
+			Uint32 BestError = SelectIndicesBC4(Values, BestE0, BestE1, BestIndices);
+
+			auto Try = [&](const Uint32 E0, const Uint32 E1)
+			{
+				Uint32 Indices[BlockPixels];
+				Uint32 Error = SelectIndicesBC4(Values, E0, E1, Indices);
+
+				if (Error < BestError)
+				{
+					BestE0		= E0;
+					BestE1		= E1;
+					BestError	= Error;
+
+					std::memcpy(BestIndices, Indices, sizeof(Indices));
+				}
+			};
+
+			if (Quality != BlockQualityFast && BestError > 0)
+			{
+				// The six value mode has exact 0 and 255, so only the inner range matters.
+
+				Uint32 InnerLow		= 255;
+				Uint32 InnerHigh	= 0;
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					if (Values[N] != 0 && Values[N] != 255)
+					{
+						InnerLow	= std::min(InnerLow, Values[N]);
+						InnerHigh	= std::max(InnerHigh, Values[N]);
+					}
+				}
+
+				if (InnerLow <= InnerHigh)
+				{
+					Try(InnerLow, InnerHigh);
+				}
+			}
+
+			if (Quality == BlockQualityHigh && BestError > 0 && High > Low)
+			{
+				for (Int32 Delta0 = -2; Delta0 <= 2; ++Delta0)
+				{
+					for (Int32 Delta1 = -2; Delta1 <= 2; ++Delta1)
+					{
+						const Int32 E0 = static_cast<Int32>(High) + Delta0;
+						const Int32 E1 = static_cast<Int32>(Low) + Delta1;
+
+						if (E0 > E1 && E0 <= 255 && E1 >= 0)
+						{
+							Try(static_cast<Uint32>(E0), static_cast<Uint32>(E1));
+						}
+					}
+				}
+			}
+
+			Uint64 IndexBits = 0;
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				IndexBits |= static_cast<Uint64>(BestIndices[N]) << (N * 3);
+			}
+
+			Block[0] = static_cast<Byte>(BestE0);
+			Block[1] = static_cast<Byte>(BestE1);
+
+			for (Uint32 N = 0; N < 6; ++N)
+			{
+				Block[N + 2] = static_cast<Byte>(IndexBits >> (N * 8));
+			}
+		}
+
+		void EncodeBlockBC5(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality)
+		{
+			EncodeBlockBC4(Pixels, Block, Quality, 0);
+			EncodeBlockBC4(Pixels, Block + 8, Quality, 1);
+		}
+
+		void EncodeBlockBC7(const Byte Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality)
+		{
+			Float Points[BlockPixels][4];
+			Float Weights[BlockPixels];
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				for (Uint32 C = 0; C < 4; ++C)
+				{
+					Points[N][C] = Pixels[N][C];
+				}
+
+				Weights[N] = 1.0f;
+			}
+
+			Float E0[4];
+			Float E1[4];
+
+			ComputeAxisEndpoints(Points, Weights, 4, E0, E1);
+
+			CandidateBC7 Best;
+			{
+				EvaluateBC7(Points, Weights, E0, E1, Best);
+			}
+
+			const Uint32 NumIterations = Quality == BlockQualityHigh ? 3 : Quality == BlockQualityNormal ? 1 : 0;
+
+			for (Uint32 Iteration = 0; Iteration < NumIterations && Best.Error > 0.0f; ++Iteration)
+			{
+				Float Factors[BlockPixels];
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Factors[N] = WeightsBC7_4[Best.Indices[N]] / 64.0f;
+				}
+
+				if (!SolveEndpoints(Points, Weights, Factors, 4, E0, E1))
+				{
+					break;
+				}
+
+				const Float Previous = Best.Error;
+
+				EvaluateBC7(Points, Weights, E0, E1, Best);
+
+				if (Best.Error >= Previous)
+				{
+					break;
+				}
+			}
+
+			// The anchor index has an implicit zero high bit.
+
+			if (Best.Indices[0] & 8)
+			{
+				std::swap(Best.Q0, Best.Q1);
+				std::swap(Best.P0, Best.P1);
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Best.Indices[N] = 15 - Best.Indices[N];
+				}
+			}
+
+			CBitWriter Writer(Block, 16);
+			{
+				Writer.Write(1 << 6, 7);
+
+				for (Uint32 C = 0; C < 4; ++C)
+				{
+					Writer.Write(Best.Q0[C], 7);
+					Writer.Write(Best.Q1[C], 7);
+				}
+
+				Writer.Write(Best.P0, 1);
+				Writer.Write(Best.P1, 1);
+
+				WriteIndices4(Writer, Best.Indices);
+			}
+		}
+
+		void EncodeBlockBC6H(const Float Pixels[BlockPixels][4], Byte * Block, const EBlockQuality Quality)
+		{
+			// Fitting happens on half float bit patterns, which are close to logarithmic.
+
+			Float Points[BlockPixels][4];
+			Float Weights[BlockPixels];
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					Points[N][C] = static_cast<Float>(FloatToHalf(Clamp(Pixels[N][C], 0.0f, 65504.0f)));
+				}
+
+				Points[N][3]	= 0.0f;
+				Weights[N]		= 1.0f;
+			}
+
+			Float E0[4];
+			Float E1[4];
+
+			ComputeAxisEndpoints(Points, Weights, 3, E0, E1);
+
+			CandidateBC6H Best;
+			{
+				EvaluateBC6H(Points, Weights, E0, E1, Best);
+			}
+
+			const Uint32 NumIterations = Quality == BlockQualityHigh ? 3 : Quality == BlockQualityNormal ? 1 : 0;
+
+			for (Uint32 Iteration = 0; Iteration < NumIterations && Best.Error > 0.0f; ++Iteration)
+			{
+				Float Factors[BlockPixels];
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Factors[N] = WeightsBC7_4[Best.Indices[N]] / 64.0f;
+				}
+
+				if (!SolveEndpoints(Points, Weights, Factors, 3, E0, E1))
+				{
+					break;
+				}
+
+				CandidateBC6H Candidate;
+				{
+					EvaluateBC6H(Points, Weights, E0, E1, Candidate);
+				}
+
+				if (Candidate.Error >= Best.Error)
+				{
+					break;
+				}
+
+				Best = Candidate;
+			}
+
+			if (Best.Indices[0] & 8)
+			{
+				std::swap(Best.Q0, Best.Q1);
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Best.Indices[N] = 15 - Best.Indices[N];
+				}
+			}
+
+			// Mode 11, one region with 10 bit endpoints.
+
+			CBitWriter Writer(Block, 16);
+			{
+				Writer.Write(0x03, 5);
+
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					Writer.Write(Best.Q0[C], 10);
+				}
+
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					Writer.Write(Best.Q1[C], 10);
+				}
+
+				WriteIndices4(Writer, Best.Indices);
+			}
+		}
+
+		/************************************************************
+		*
+		*	Block decoders
+		*
+		************************************************************/
+
+		void DecodeBlockBC1(const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			const Uint16 C0 = static_cast<Uint16>(Block[0] | Block[1] << 8);
+			const Uint16 C1 = static_cast<Uint16>(Block[2] | Block[3] << 8);
+
+			Byte Palette[4][4];
+			{
+				BuildPaletteBC1(C0, C1, false, Palette);
+			}
+
+			const Uint32 IndexBits = Block[4] | Block[5] << 8 | Block[6] << 16 | static_cast<Uint32>(Block[7]) << 24;
+
+			if (DecodeWithSSSE3)
+			{
+				LookupPaletteBC1(Palette, IndexBits, Pixels);
+				return;
+			}
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				std::memcpy(Pixels[N], Palette[(IndexBits >> (N * 2)) & 3], 4);
+			}
+		}
+
+		void DecodeBlockBC3(const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			const Uint16 C0 = static_cast<Uint16>(Block[8] | Block[9] << 8);
+			const Uint16 C1 = static_cast<Uint16>(Block[10] | Block[11] << 8);
+
+			Byte Palette[4][4];
+			{
+				BuildPaletteBC1(C0, C1, true, Palette);
+			}
+
+			const Uint32 IndexBits = Block[12] | Block[13] << 8 | Block[14] << 16 | static_cast<Uint32>(Block[15]) << 24;
+
+			if (DecodeWithSSSE3)
+			{
+				LookupPaletteBC1(Palette, IndexBits, Pixels);
+			}
+			else
+			{
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					std::memcpy(Pixels[N], Palette[(IndexBits >> (N * 2)) & 3], 4);
+				}
+			}
+
+			DecodeBlockBC4(Block, Pixels, 3);
+		}
+
+		void DecodeBlockBC4(const Byte * Block, Byte Pixels[BlockPixels][4], const Uint32 Channel)
+		{
+			Uint32 Palette[8];
+			{
+				BuildPaletteBC4(Block[0], Block[1], Palette);
+			}
+
+			if (DecodeWithSSSE3)
+			{
+				LookupPaletteBC4(Palette, Block, Channel, Pixels);
+				return;
+			}
+
+			Uint64 IndexBits = 0;
+
+			for (Uint32 N = 0; N < 6; ++N)
+			{
+				IndexBits |= static_cast<Uint64>(Block[N + 2]) << (N * 8);
+			}
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				Pixels[N][Channel] = static_cast<Byte>(Palette[(IndexBits >> (N * 3)) & 7]);
+			}
+		}
+
+		void DecodeBlockBC5(const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				Pixels[N][2] = 0;
+				Pixels[N][3] = 255;
+			}
+
+			DecodeBlockBC4(Block, Pixels, 0);
+			DecodeBlockBC4(Block + 8, Pixels, 1);
+		}
+
+		bool DecodeBlockBC7(const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			Uint32 Mode = 0;
+
+			while (Mode < 8 && !(Block[0] & (1 << Mode)))
+			{
+				Mode++;
+			}
+
+			CBitReader Reader(Block);
+			{
+				Reader.Read(Mode + 1);
+			}
+
+			Uint32 E0[4];
+			Uint32 E1[4];
+
+			Uint32 Rotation		= 0;
+			Uint32 IndexMode	= 0;
+
+			Uint32 ColorIndices[BlockPixels];
+			Uint32 AlphaIndices[BlockPixels];
+
+			const Uint32 * ColorWeights;
+			const Uint32 * AlphaWeights;
+
+			auto ReadIndices = [&Reader](Uint32 Indices[BlockPixels], const Uint32 Bits)
+			{
+				Indices[0] = Reader.Read(Bits - 1);
+
+				for (Uint32 N = 1; N < BlockPixels; ++N)
+				{
+					Indices[N] = Reader.Read(Bits);
+				}
+			};
+
+			switch (Mode)
+			{
+				case 4:
+				{
+					Rotation	= Reader.Read(2);
+					IndexMode	= Reader.Read(1);
+
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						E0[C] = Reader.Read(5);
+						E1[C] = Reader.Read(5);
+
+						E0[C] = E0[C] << 3 | E0[C] >> 2;
+						E1[C] = E1[C] << 3 | E1[C] >> 2;
+					}
+
+					E0[3] = Reader.Read(6);
+					E1[3] = Reader.Read(6);
+
+					E0[3] = E0[3] << 2 | E0[3] >> 4;
+					E1[3] = E1[3] << 2 | E1[3] >> 4;
+
+					Uint32 Indices2[BlockPixels];
+					Uint32 Indices3[BlockPixels];
+
+					ReadIndices(Indices2, 2);
+					ReadIndices(Indices3, 3);
+
+					std::memcpy(ColorIndices, IndexMode ? Indices3 : Indices2, sizeof(ColorIndices));
+					std::memcpy(AlphaIndices, IndexMode ? Indices2 : Indices3, sizeof(AlphaIndices));
+
+					ColorWeights = IndexMode ? WeightsBC7_3 : WeightsBC7_2;
+					AlphaWeights = IndexMode ? WeightsBC7_2 : WeightsBC7_3;
+				}
+
+				break;
+
+				case 5:
+				{
+					Rotation = Reader.Read(2);
+
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						E0[C] = Reader.Read(7);
+						E1[C] = Reader.Read(7);
+
+						E0[C] = E0[C] << 1 | E0[C] >> 6;
+						E1[C] = E1[C] << 1 | E1[C] >> 6;
+					}
+
+					E0[3] = Reader.Read(8);
+					E1[3] = Reader.Read(8);
+
+					ReadIndices(ColorIndices, 2);
+					ReadIndices(AlphaIndices, 2);
+
+					ColorWeights = WeightsBC7_2;
+					AlphaWeights = WeightsBC7_2;
+				}
+
+				break;
+
+				case 6:
+				{
+					for (Uint32 C = 0; C < 4; ++C)
+					{
+						E0[C] = Reader.Read(7);
+						E1[C] = Reader.Read(7);
+					}
+
+					const Uint32 P0 = Reader.Read(1);
+					const Uint32 P1 = Reader.Read(1);
+
+					for (Uint32 C = 0; C < 4; ++C)
+					{
+						E0[C] = E0[C] << 1 | P0;
+						E1[C] = E1[C] << 1 | P1;
+					}
+
+					ReadIndices(ColorIndices, 4);
+
+					std::memcpy(AlphaIndices, ColorIndices, sizeof(AlphaIndices));
+
+					ColorWeights = WeightsBC7_4;
+					AlphaWeights = WeightsBC7_4;
+				}
+
+				break;
+
+				default:
+				{
+					// Partitioned modes are not supported.
+
+					for (Uint32 N = 0; N < BlockPixels; ++N)
+					{
+						Pixels[N][0] = 255;
+						Pixels[N][1] = 0;
+						Pixels[N][2] = 255;
+						Pixels[N][3] = 255;
+					}
+				}
+
+				return false;
+			}
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				const Uint32 ColorWeight = ColorWeights[ColorIndices[N]];
+				const Uint32 AlphaWeight = AlphaWeights[AlphaIndices[N]];
+
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					Pixels[N][C] = static_cast<Byte>(((64 - ColorWeight) * E0[C] + ColorWeight * E1[C] + 32) >> 6);
+				}
+
+				Pixels[N][3] = static_cast<Byte>(((64 - AlphaWeight) * E0[3] + AlphaWeight * E1[3] + 32) >> 6);
+
+				if (Rotation)
+				{
+					std::swap(Pixels[N][Rotation - 1], Pixels[N][3]);
+				}
+			}
+
+			return true;
+		}
+
+		bool DecodeBlockBC6H(const Byte * Block, Float Pixels[BlockPixels][4], const bool Signed)
+		{
+			CBitReader Reader(Block);
+
+			if (Reader.Read(5) != 0x03)
+			{
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Pixels[N][0] = 1.0f;
+					Pixels[N][1] = 0.0f;
+					Pixels[N][2] = 1.0f;
+					Pixels[N][3] = 1.0f;
+				}
+
+				return false;
+			}
+
+			Int32 E0[3];
+			Int32 E1[3];
+
+			for (Uint32 C = 0; C < 3; ++C)
+			{
+				E0[C] = static_cast<Int32>(Reader.Read(10));
+			}
+
+			for (Uint32 C = 0; C < 3; ++C)
+			{
+				E1[C] = static_cast<Int32>(Reader.Read(10));
+			}
+
+			for (Uint32 C = 0; C < 3; ++C)
+			{
+				if (Signed)
+				{
+					// Sign extend from 10 bits.
+
+					E0[C] = UnquantizeBC6HSigned(E0[C] & 0x200 ? E0[C] - 0x400 : E0[C]);
+					E1[C] = UnquantizeBC6HSigned(E1[C] & 0x200 ? E1[C] - 0x400 : E1[C]);
+				}
+				else
+				{
+					E0[C] = UnquantizeBC6H(E0[C]);
+					E1[C] = UnquantizeBC6H(E1[C]);
+				}
+			}
+
+			for (Uint32 N = 0; N < BlockPixels; ++N)
+			{
+				const Int32 W = static_cast<Int32>(WeightsBC7_4[Reader.Read(N == 0 ? 3 : 4)]);
+
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					const Int32 Value = ((64 - W) * E0[C] + W * E1[C] + 32) >> 6;
+
+					Uint16 Half;
+
+					if (Signed)
+					{
+						Half = static_cast<Uint16>(Value < 0 ? 0x8000 | ((-Value * 31) >> 5) : (Value * 31) >> 5);
+					}
+					else
+					{
+						Half = static_cast<Uint16>(FinishBC6H(Value));
+					}
+
+					Pixels[N][C] = HalfToFloat(Half);
+				}
+
+				Pixels[N][3] = 1.0f;
+			}
+
+			return true;
+		}
+
+		/************************************************************
+		*
+		*	Images
+		*
+		************************************************************/
+
+		bool Compress(const ImageRGBA8 & Image, const BlockCompressionOptions & Options, TVector<Byte> & Output, BlockCompressionStats * Stats)
+		{
+			if (!Image.Data || Image.Width == 0 || Image.Height == 0 || Image.RowPitch < Image.Width * 4ULL || Options.Format == BlockFormatBC6H)
+			{
+				return false;
+			}
+
+			const auto Start = std::chrono::high_resolution_clock::now();
+
+			const Uint32 BlockSize = GetBlockSize(Options.Format);
+
+			Output.resize(static_cast<size_t>(GetCompressedSize(Options.Format, Image.Width, Image.Height)));
+
+			ForEachBlock(Image.Width, Image.Height, [&](const Uint32 BlockX, const Uint32 BlockY, const Uint32 Index)
+			{
+				Byte Pixels[BlockPixels][4];
+				{
+					GatherBlock(Image.Data, Image.RowPitch, Image.Width, Image.Height, BlockX, BlockY, Pixels);
+				}
+
+				Byte * Block = Output.data() + static_cast<size_t>(Index) * BlockSize;
+
+				switch (Options.Format)
+				{
+					case BlockFormatBC1:
+						EncodeBlockBC1(Pixels, Block, Options.Quality, Options.AlphaCutout, Options.AlphaThreshold);
+						break;
+					case BlockFormatBC3:
+						EncodeBlockBC3(Pixels, Block, Options.Quality);
+						break;
+					case BlockFormatBC4:
+						EncodeBlockBC4(Pixels, Block, Options.Quality);
+						break;
+					case BlockFormatBC5:
+						EncodeBlockBC5(Pixels, Block, Options.Quality);
+						break;
+					default:
+						EncodeBlockBC7(Pixels, Block, Options.Quality);
+						break;
+				}
+			});
+
+			if (Stats)
+			{
+				FillStats(Stats, Start, static_cast<Uint64>(Image.Width) * Image.Height * 4);
+
+				if (Options.MeasureQuality)
+				{
+					TVector<Byte> Decoded;
+
+					Decompress(Options.Format, Output.data(), Image.Width, Image.Height, Decoded);
+
+					ImageRGBA8 Result;
+					{
+						Result.Data		= Decoded.data();
+						Result.Width	= Image.Width;
+						Result.Height	= Image.Height;
+						Result.RowPitch	= Image.Width * 4ULL;
+					}
+
+					Stats->PSNR = ComputePSNR(Image, Result, GetBlockChannels(Options));
+				}
+			}
+
+			return true;
+		}
+
+		bool Compress(const ImageRGBA32F & Image, const BlockCompressionOptions & Options, TVector<Byte> & Output, BlockCompressionStats * Stats)
+		{
+			if (!Image.Data || Image.Width == 0 || Image.Height == 0 || Image.RowPitch < Image.Width * sizeof(Float) * 4ULL || Options.Format != BlockFormatBC6H)
+			{
+				return false;
+			}
+
+			const auto Start = std::chrono::high_resolution_clock::now();
+
+			Output.resize(static_cast<size_t>(GetCompressedSize(Options.Format, Image.Width, Image.Height)));
+
+			ForEachBlock(Image.Width, Image.Height, [&](const Uint32 BlockX, const Uint32 BlockY, const Uint32 Index)
+			{
+				Float Pixels[BlockPixels][4];
+				{
+					GatherBlock(reinterpret_cast<const Byte*>(Image.Data), Image.RowPitch, Image.Width, Image.Height, BlockX, BlockY, Pixels);
+				}
+
+				EncodeBlockBC6H(Pixels, Output.data() + static_cast<size_t>(Index) * 16, Options.Quality);
+			});
+
+			if (Stats)
+			{
+				FillStats(Stats, Start, static_cast<Uint64>(Image.Width) * Image.Height * sizeof(Float) * 4);
+
+				if (Options.MeasureQuality)
+				{
+					TVector<Float> Decoded;
+
+					Decompress(Options.Format, Output.data(), Image.Width, Image.Height, Decoded);
+
+					ImageRGBA32F Result;
+					{
+						Result.Data		= Decoded.data();
+						Result.Width	= Image.Width;
+						Result.Height	= Image.Height;
+						Result.RowPitch	= Image.Width * sizeof(Float) * 4ULL;
+					}
+
+					Stats->PSNR = ComputePSNR(Image, Result, 3);
+				}
+			}
+
+			return true;
+		}
+
+		bool Decompress(const EBlockFormat Format, const Byte * Blocks, const Uint32 Width, const Uint32 Height, TVector<Byte> & Output)
+		{
+			if (!Blocks || Width == 0 || Height == 0 || Format == BlockFormatBC6H)
+			{
+				return false;
+			}
+
+			const Uint32 BlockSize = GetBlockSize(Format);
+
+			Output.resize(static_cast<size_t>(Width) * Height * 4);
+
+			TAtomic<bool> Valid(true);
+
+			ForEachBlock(Width, Height, [&](const Uint32 BlockX, const Uint32 BlockY, const Uint32 Index)
+			{
+				const Byte * Block = Blocks + static_cast<size_t>(Index) * BlockSize;
+
+				Byte Pixels[BlockPixels][4];
+
+				for (Uint32 N = 0; N < BlockPixels; ++N)
+				{
+					Pixels[N][0] = 0;
+					Pixels[N][1] = 0;
+					Pixels[N][2] = 0;
+					Pixels[N][3] = 255;
+				}
+
+				switch (Format)
+				{
+					case BlockFormatBC1:
+						DecodeBlockBC1(Block, Pixels);
+						break;
+					case BlockFormatBC3:
+						DecodeBlockBC3(Block, Pixels);
+						break;
+					case BlockFormatBC4:
+						DecodeBlockBC4(Block, Pixels);
+						break;
+					case BlockFormatBC5:
+						DecodeBlockBC5(Block, Pixels);
+						break;
+					default:
+					{
+						if (!DecodeBlockBC7(Block, Pixels))
+						{
+							Valid.store(false, std::memory_order_relaxed);
+						}
+					}
+				}
+
+				ScatterBlock(Output.data(), Width, Height, BlockX, BlockY, Pixels);
+			});
+
+			return Valid.load();
+		}
+
+		bool Decompress(const EBlockFormat Format, const Byte * Blocks, const Uint32 Width, const Uint32 Height, TVector<Float> & Output)
+		{
+			if (!Blocks || Width == 0 || Height == 0 || Format != BlockFormatBC6H)
+			{
+				return false;
+			}
+
+			Output.resize(static_cast<size_t>(Width) * Height * 4);
+
+			TAtomic<bool> Valid(true);
+
+			ForEachBlock(Width, Height, [&](const Uint32 BlockX, const Uint32 BlockY, const Uint32 Index)
+			{
+				Float Pixels[BlockPixels][4];
+
+				if (!DecodeBlockBC6H(Blocks + static_cast<size_t>(Index) * 16, Pixels))
+				{
+					Valid.store(false, std::memory_order_relaxed);
+				}
+
+				ScatterBlock(Output.data(), Width, Height, BlockX, BlockY, Pixels);
+			});
+
+			return Valid.load();
+		}
+
+		double ComputePSNR(const ImageRGBA8 & Reference, const ImageRGBA8 & Image, const Uint32 NumChannels)
+		{
+			double SquaredError = 0.0;
+
+			for (Uint32 Y = 0; Y < Reference.Height; ++Y)
+			{
+				const Byte * RowReference	= Reference.Data + Y * Reference.RowPitch;
+				const Byte * RowImage		= Image.Data + Y * Image.RowPitch;
+
+				for (Uint32 X = 0; X < Reference.Width * 4; X += 4)
+				{
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						const double Delta = static_cast<double>(RowReference[X + C]) - RowImage[X + C];
+						{
+							SquaredError += Delta * Delta;
+						}
+					}
+				}
+			}
+
+			const double MeanSquaredError = SquaredError / (static_cast<double>(Reference.Width) * Reference.Height * NumChannels);
+
+			if (MeanSquaredError <= 0.0)
+			{
+				return std::numeric_limits<double>::infinity();
+			}
+
+			return 10.0 * std::log10(255.0 * 255.0 / MeanSquaredError);
+		}
+
+		double ComputePSNR(const ImageRGBA32F & Reference, const ImageRGBA32F & Image, const Uint32 NumChannels)
+		{
+			double SquaredError	= 0.0;
+			double Peak			= 0.0;
+
+			for (Uint32 Y = 0; Y < Reference.Height; ++Y)
+			{
+				const Float * RowReference	= reinterpret_cast<const Float*>(reinterpret_cast<const Byte*>(Reference.Data) + Y * Reference.RowPitch);
+				const Float * RowImage		= reinterpret_cast<const Float*>(reinterpret_cast<const Byte*>(Image.Data) + Y * Image.RowPitch);
+
+				for (Uint32 X = 0; X < Reference.Width * 4; X += 4)
+				{
+					for (Uint32 C = 0; C < NumChannels; ++C)
+					{
+						const double Delta = static_cast<double>(RowReference[X + C]) - RowImage[X + C];
+						{
+							SquaredError += Delta * Delta;
+						}
+
+						Peak = std::fmax(Peak, RowReference[X + C]);
+					}
+				}
+			}
+
+			const double MeanSquaredError = SquaredError / (static_cast<double>(Reference.Width) * Reference.Height * NumChannels);
+
+			if (MeanSquaredError <= 0.0 || Peak <= 0.0)
+			{
+				return std::numeric_limits<double>::infinity();
+			}
+
+			return 10.0 * std::log10(Peak * Peak / MeanSquaredError);
+		}
+
+		Uint16 FloatToHalf(const Float Value)
+		{
+			Uint32 Bits;
+			{
+				std::memcpy(&Bits, &Value, sizeof(Bits));
+			}
+
+			const Uint32 Sign		= (Bits >> 16) & 0x8000;
+			const Int32  Exponent	= static_cast<Int32>((Bits >> 23) & 0xFF) - 127 + 15;
+
+			Uint32 Mantissa = Bits & 0x7FFFFF;
+
+			if ((Bits & 0x7FFFFFFF) > 0x7F800000)
+			{
+				return static_cast<Uint16>(Sign | 0x7E00);
+			}
+
+			if (Exponent >= 31)
+			{
+				return static_cast<Uint16>(Sign | 0x7C00);
+			}
+
+			if (Exponent <= 0)
+			{
+				if (Exponent < -10)
+				{
+					return static_cast<Uint16>(Sign);
+				}
+
+				Mantissa |= 0x800000;
+
+				const Uint32 Shift	= static_cast<Uint32>(14 - Exponent);
+				const Uint32 Half	= (Mantissa >> Shift) + ((Mantissa >> (Shift - 1)) & 1);
+
+				return static_cast<Uint16>(Sign | Half);
+			}
+
+			// Rounding may carry into the exponent, which is the correct result.
+
+			const Uint32 Half = (static_cast<Uint32>(Exponent) << 10 | Mantissa >> 13) + ((Mantissa >> 12) & 1);
+
+			return static_cast<Uint16>(Sign | Half);
+		}
+
+		Float HalfToFloat(const Uint16 Value)
+		{
+			const Uint32 Sign = static_cast<Uint32>(Value & 0x8000) << 16;
+
+			Int32	Exponent = (Value >> 10) & 31;
+			Uint32	Mantissa = Value & 0x3FF;
+			Uint32	Bits;
+
+			if (Exponent == 0)
+			{
+				if (Mantissa == 0)
+				{
+					Bits = Sign;
+				}
+				else
+				{
+					Exponent = 1;
+
+					while (!(Mantissa & 0x400))
+					{
+						Mantissa <<= 1;
+						Exponent--;
+					}
+
+					Bits = Sign | static_cast<Uint32>(Exponent + 112) << 23 | (Mantissa & 0x3FF) << 13;
+				}
+			}
+			else if (Exponent == 31)
+			{
+				Bits = Sign | 0x7F800000 | Mantissa << 13;
+			}
+			else
+			{
+				Bits = Sign | static_cast<Uint32>(Exponent + 112) << 23 | Mantissa << 13;
+			}
+
+			Float Result;
+			{
+				std::memcpy(&Result, &Bits, sizeof(Result));
+			}
+
+			return Result;
+		}
+	}
+}
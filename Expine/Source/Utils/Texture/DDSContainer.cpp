@@ -0,0 +1,838 @@
+#include "Utils/Texture/DDSContainer.h"
+
+#include <cstring>
+
+namespace Texture
+{
+	namespace DDS
+	{
+		namespace
+		{
+			constexpr Uint32 MakeFourCC(const char C0, const char C1, const char C2, const char C3)
+			{
+				return
+					static_cast<Uint32>(static_cast<Byte>(C0)) |
+					static_cast<Uint32>(static_cast<Byte>(C1)) << 8 |
+					static_cast<Uint32>(static_cast<Byte>(C2)) << 16 |
+					static_cast<Uint32>(static_cast<Byte>(C3)) << 24;
+			}
+
+			constexpr Uint32 FileMagic = MakeFourCC('D', 'D', 'S', ' ');
+
+			enum EPixelFormatFlags
+			{
+				PixelFormatAlpha		= 0x00000002,
+				PixelFormatFourCC		= 0x00000004,
+				PixelFormatRGB			= 0x00000040,
+				PixelFormatLuminance	= 0x00020000,
+				PixelFormatBumpDuDv		= 0x00080000
+			};
+
+			enum EHeaderFlags
+			{
+				HeaderFlagCaps			= 0x00000001,
+				HeaderFlagHeight		= 0x00000002,
+				HeaderFlagWidth			= 0x00000004,
+				HeaderFlagPixelFormat	= 0x00001000,
+				HeaderFlagMipMapCount	= 0x00020000,
+				HeaderFlagVolume		= 0x00800000
+			};
+
+			enum ECapsFlags
+			{
+				CapsComplex				= 0x00000008,
+				CapsTexture				= 0x00001000,
+				CapsMipMap				= 0x00400000
+			};
+
+			enum ECaps2Flags
+			{
+				Caps2CubeMap			= 0x00000200,
+				Caps2CubeMapAllFaces	= 0x0000FE00
+			};
+
+			enum EExtensionFlags
+			{
+				ExtensionMiscTextureCube	= 0x4,
+				ExtensionAlphaModeMask		= 0x7
+			};
+
+			// Limits of D3D12 feature level 11 and up.
+
+			constexpr Uint32 MaxTextureDimension1D	= 16384;
+			constexpr Uint32 MaxTextureDimension2D	= 16384;
+			constexpr Uint32 MaxTextureDimension3D	= 2048;
+			constexpr Uint32 MaxTextureCubeDimension	= 16384;
+			constexpr Uint32 MaxTextureArraySize		= 2048;
+
+#pragma pack(push, 1)
+			struct FilePixelFormat
+			{
+				Uint32 Size;
+				Uint32 Flags;
+				Uint32 FourCC;
+				Uint32 RGBBitCount;
+				Uint32 RBitMask;
+				Uint32 GBitMask;
+				Uint32 BBitMask;
+				Uint32 ABitMask;
+			};
+
+			struct FileHeader
+			{
+				Uint32			Size;
+				Uint32			Flags;
+				Uint32			Height;
+				Uint32			Width;
+				Uint32			PitchOrLinearSize;
+				Uint32			Depth;
+				Uint32			MipMapCount;
+				Uint32			Reserved1[11];
+				FilePixelFormat	PixelFormat;
+				Uint32			Caps;
+				Uint32			Caps2;
+				Uint32			Caps3;
+				Uint32			Caps4;
+				Uint32			Reserved2;
+			};
+
+			struct FileHeaderExtension
+			{
+				Uint32 Format;
+				Uint32 Dimension;
+				Uint32 MiscFlag;
+				Uint32 ArraySize;
+				Uint32 MiscFlags2;
+			};
+#pragma pack(pop)
+
+			static_assert(sizeof(FilePixelFormat) == 32, "Unexpected pixel format size");
+			static_assert(sizeof(FileHeader) == 124, "Unexpected header size");
+			static_assert(sizeof(FileHeaderExtension) == 20, "Unexpected header extension size");
+
+			inline bool IsBitMask(const FilePixelFormat & PixelFormat, const Uint32 R, const Uint32 G, const Uint32 B, const Uint32 A)
+			{
+				return
+					PixelFormat.RBitMask == R &&
+					PixelFormat.GBitMask == G &&
+					PixelFormat.BBitMask == B &&
+					PixelFormat.ABitMask == A;
+			}
+
+			// Maps headers without the DX10 extension, see GetDXGIFormat in DDSTextureLoader12.
+
+			Uint32 GetLegacyFormat(const FilePixelFormat & PixelFormat)
+			{
+				if (PixelFormat.Flags & PixelFormatRGB)
+				{
+					switch (PixelFormat.RGBBitCount)
+					{
+						case 32:
+						{
+							if (IsBitMask(PixelFormat, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000))
+							{
+								return DDSFormatR8G8B8A8Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000))
+							{
+								return DDSFormatB8G8R8A8Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000))
+							{
+								return DDSFormatB8G8R8X8Unorm;
+							}
+
+							// D3DX writes 10:10:10:2 with red and blue swapped.
+
+							if (IsBitMask(PixelFormat, 0x3FF00000, 0x000FFC00, 0x000003FF, 0xC0000000))
+							{
+								return DDSFormatR10G10B10A2Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0x0000FFFF, 0xFFFF0000, 0x00000000, 0x00000000))
+							{
+								return DDSFormatR16G16Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000))
+							{
+								return DDSFormatR32Float;
+							}
+						}
+
+						break;
+
+						case 16:
+						{
+							if (IsBitMask(PixelFormat, 0x7C00, 0x03E0, 0x001F, 0x8000))
+							{
+								return DDSFormatB5G5R5A1Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0xF800, 0x07E0, 0x001F, 0x0000))
+							{
+								return DDSFormatB5G6R5Unorm;
+							}
+
+							if (IsBitMask(PixelFormat, 0x0F00, 0x00F0, 0x000F, 0xF000))
+							{
+								return DDSFormatB4G4R4A4Unorm;
+							}
+						}
+
+						break;
+					}
+				}
+				else if (PixelFormat.Flags & PixelFormatLuminance)
+				{
+					if (PixelFormat.RGBBitCount == 8)
+					{
+						if (IsBitMask(PixelFormat, 0x000000FF, 0x00000000, 0x00000000, 0x00000000))
+						{
+							return DDSFormatR8Unorm;
+						}
+
+						if (IsBitMask(PixelFormat, 0x000000FF, 0x00000000, 0x00000000, 0x0000FF00))
+						{
+							return DDSFormatR8G8Unorm;
+						}
+					}
+
+					if (PixelFormat.RGBBitCount == 16)
+					{
+						if (IsBitMask(PixelFormat, 0x0000FFFF, 0x00000000, 0x00000000, 0x00000000))
+						{
+							return DDSFormatR16Unorm;
+						}
+
+						if (IsBitMask(PixelFormat, 0x000000FF, 0x00000000, 0x00000000, 0x0000FF00))
+						{
+							return DDSFormatR8G8Unorm;
+						}
+					}
+				}
+				else if (PixelFormat.Flags & PixelFormatAlpha)
+				{
+					if (PixelFormat.RGBBitCount == 8)
+					{
+						return DDSFormatA8Unorm;
+					}
+				}
+				else if (PixelFormat.Flags & PixelFormatBumpDuDv)
+				{
+					if (PixelFormat.RGBBitCount == 16)
+					{
+						if (IsBitMask(PixelFormat, 0x00FF, 0xFF00, 0x0000, 0x0000))
+						{
+							return DDSFormatR8G8Snorm;
+						}
+					}
+
+					if (PixelFormat.RGBBitCount == 32)
+					{
+						if (IsBitMask(PixelFormat, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000))
+						{
+							return DDSFormatR8G8B8A8Snorm;
+						}
+
+						if (IsBitMask(PixelFormat, 0x0000FFFF, 0xFFFF0000, 0x00000000, 0x00000000))
+						{
+							return DDSFormatR16G16Snorm;
+						}
+					}
+				}
+				else if (PixelFormat.Flags & PixelFormatFourCC)
+				{
+					switch (PixelFormat.FourCC)
+					{
+						case MakeFourCC('D', 'X', 'T', '1'):
+							return DDSFormatBC1Unorm;
+						case MakeFourCC('D', 'X', 'T', '2'):
+						case MakeFourCC('D', 'X', 'T', '3'):
+							return DDSFormatBC2Unorm;
+						case MakeFourCC('D', 'X', 'T', '4'):
+						case MakeFourCC('D', 'X', 'T', '5'):
+							return DDSFormatBC3Unorm;
+						case MakeFourCC('A', 'T', 'I', '1'):
+						case MakeFourCC('B', 'C', '4', 'U'):
+							return DDSFormatBC4Unorm;
+						case MakeFourCC('B', 'C', '4', 'S'):
+							return DDSFormatBC4Snorm;
+						case MakeFourCC('A', 'T', 'I', '2'):
+						case MakeFourCC('B', 'C', '5', 'U'):
+							return DDSFormatBC5Unorm;
+						case MakeFourCC('B', 'C', '5', 'S'):
+							return DDSFormatBC5Snorm;
+						case MakeFourCC('R', 'G', 'B', 'G'):
+							return DDSFormatR8G8B8G8Unorm;
+						case MakeFourCC('G', 'R', 'G', 'B'):
+							return DDSFormatG8R8G8B8Unorm;
+						case MakeFourCC('Y', 'U', 'Y', '2'):
+							return DDSFormatYUY2;
+
+						// D3DFORMAT values stored as FourCC.
+
+						case 36:
+							return DDSFormatR16G16B16A16Unorm;
+						case 110:
+							return DDSFormatR16G16B16A16Snorm;
+						case 111:
+							return DDSFormatR16Float;
+						case 112:
+							return DDSFormatR16G16Float;
+						case 113:
+							return DDSFormatR16G16B16A16Float;
+						case 114:
+							return DDSFormatR32Float;
+						case 115:
+							return DDSFormatR32G32Float;
+						case 116:
+							return DDSFormatR32G32B32A32Float;
+					}
+				}
+
+				return DDSFormatUnknown;
+			}
+
+			DDS_ALPHA_MODE GetLegacyAlphaMode(const FilePixelFormat & PixelFormat)
+			{
+				if (PixelFormat.Flags & PixelFormatFourCC)
+				{
+					if (PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '2') ||
+						PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '4'))
+					{
+						return DDS_ALPHA_MODE_PREMULTIPLIED;
+					}
+				}
+
+				return DDS_ALPHA_MODE_UNKNOWN;
+			}
+		}
+
+		bool CDDSContainer::GetFormatInfo(const Uint32 Format, DDSFormatInfo & Info)
+		{
+			Info = DDSFormatInfo();
+
+			switch (Format)
+			{
+				case DDSFormatBC1Typeless:
+				case DDSFormatBC1Unorm:
+				case DDSFormatBC1UnormSrgb:
+				case DDSFormatBC4Typeless:
+				case DDSFormatBC4Unorm:
+				case DDSFormatBC4Snorm:
+				{
+					Info.BitsPerBlock	= 64;
+					Info.BlockWidth		= 4;
+					Info.BlockHeight	= 4;
+					Info.Compressed		= true;
+				}
+
+				return true;
+
+				case DDSFormatBC2Typeless:
+				case DDSFormatBC2Unorm:
+				case DDSFormatBC2UnormSrgb:
+				case DDSFormatBC3Typeless:
+				case DDSFormatBC3Unorm:
+				case DDSFormatBC3UnormSrgb:
+				case DDSFormatBC5Typeless:
+				case DDSFormatBC5Unorm:
+				case DDSFormatBC5Snorm:
+				case DDSFormatBC6HTypeless:
+				case DDSFormatBC6HUf16:
+				case DDSFormatBC6HSf16:
+				case DDSFormatBC7Typeless:
+				case DDSFormatBC7Unorm:
+				case DDSFormatBC7UnormSrgb:
+				{
+					Info.BitsPerBlock	= 128;
+					Info.BlockWidth		= 4;
+					Info.BlockHeight	= 4;
+					Info.Compressed		= true;
+				}
+
+				return true;
+
+				// Two pixels share one block of chroma.
+
+				case DDSFormatR8G8B8G8Unorm:
+				case DDSFormatG8R8G8B8Unorm:
+				case DDSFormatYUY2:
+				{
+					Info.BitsPerBlock	= 32;
+					Info.BlockWidth		= 2;
+				}
+
+				return true;
+
+				case 108: // Y210
+				case 109: // Y216
+				{
+					Info.BitsPerBlock	= 64;
+					Info.BlockWidth		= 2;
+				}
+
+				return true;
+			}
+
+			if (Format >= 1 && Format <= 4)
+			{
+				Info.BitsPerBlock = 128;
+			}
+			else if (Format >= 5 && Format <= 8)
+			{
+				Info.BitsPerBlock = 96;
+			}
+			else if ((Format >= 9 && Format <= 22) || Format == 102)
+			{
+				Info.BitsPerBlock = 64;
+			}
+			else if ((Format >= 23 && Format <= 47) || (Format >= 87 && Format <= 93) || Format == 67 || Format == 100 || Format == 101)
+			{
+				Info.BitsPerBlock = 32;
+			}
+			else if ((Format >= 48 && Format <= 59) || Format == 85 || Format == 86 || Format == 115)
+			{
+				Info.BitsPerBlock = 16;
+			}
+			else if (Format >= 60 && Format <= 65)
+			{
+				Info.BitsPerBlock = 8;
+			}
+			else if (Format == 66)
+			{
+				Info.BitsPerBlock = 1;
+			}
+
+			// Planar and palettized formats are not supported.
+
+			return Info.BitsPerBlock != 0;
+		}
+
+		EDDSResult CDDSContainer::Open(const WString & Path)
+		{
+			Close();
+
+			if (!Mapping.Open(Path))
+			{
+				return DDSResultOpenFailed;
+			}
+
+			const EDDSResult Result = Parse(Mapping.GetData(), Mapping.GetSize());
+
+			if (Result != DDSResultOk)
+			{
+				Mapping.Close();
+			}
+
+			return Result;
+		}
+
+		EDDSResult CDDSContainer::Open(const String & Path)
+		{
+			return Open(WString(Path.begin(), Path.end()));
+		}
+
+		void CDDSContainer::Close()
+		{
+			Mapping.Close();
+			Subresources.clear();
+
+			Data		= NULL;
+			Size		= 0;
+			Dimension	= DDSDimensionUnknown;
+			Format		= DDSFormatUnknown;
+			FormatInfo	= DDSFormatInfo();
+			AlphaMode	= DDS_ALPHA_MODE_UNKNOWN;
+			Width		= 0;
+			Height		= 0;
+			Depth		= 0;
+			ArraySize	= 0;
+			MipLevels	= 0;
+			Cube		= false;
+		}
+
+		EDDSResult CDDSContainer::Parse(const Byte * Data, const Uint64 Size)
+		{
+			Subresources.clear();
+
+			if (!Data || Size < sizeof(Uint32) + sizeof(FileHeader))
+			{
+				return DDSResultTruncated;
+			}
+
+			Uint32 Magic;
+			{
+				std::memcpy(&Magic, Data, sizeof(Magic));
+			}
+
+			if (Magic != FileMagic)
+			{
+				return DDSResultInvalidMagic;
+			}
+
+			// The mapping is only guaranteed to be byte aligned past the magic.
+
+			FileHeader Header;
+			{
+				std::memcpy(&Header, Data + sizeof(Uint32), sizeof(Header));
+			}
+
+			if (Header.Size != sizeof(FileHeader) ||
+				Header.PixelFormat.Size != sizeof(FilePixelFormat))
+			{
+				return DDSResultInvalidHeader;
+			}
+
+			Uint64 Offset = sizeof(Uint32) + sizeof(FileHeader);
+
+			Width		= Header.Width;
+			Height		= Header.Height;
+			Depth		= Header.Depth;
+			ArraySize	= 1;
+			MipLevels	= Header.MipMapCount ? Header.MipMapCount : 1;
+			Cube		= false;
+
+			if ((Header.PixelFormat.Flags & PixelFormatFourCC) && Header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+			{
+				if (Size < Offset + sizeof(FileHeaderExtension))
+				{
+					return DDSResultTruncated;
+				}
+
+				FileHeaderExtension Extension;
+				{
+					std::memcpy(&Extension, Data + Offset, sizeof(Extension));
+				}
+
+				Offset += sizeof(FileHeaderExtension);
+
+				if (Extension.ArraySize == 0)
+				{
+					return DDSResultInvalidHeader;
+				}
+
+				Format		= Extension.Format;
+				ArraySize	= Extension.ArraySize;
+				AlphaMode	= static_cast<DDS_ALPHA_MODE>(Extension.MiscFlags2 & ExtensionAlphaModeMask);
+
+				switch (Extension.Dimension)
+				{
+					case DDSDimensionTexture1D:
+					{
+						// D3DX writes 1D textures with a fixed height of 1.
+
+						if ((Header.Flags & HeaderFlagHeight) && Height != 1)
+						{
+							return DDSResultInvalidHeader;
+						}
+
+						Height	= 1;
+						Depth	= 1;
+					}
+
+					break;
+
+					case DDSDimensionTexture2D:
+					{
+						Cube	= (Extension.MiscFlag & ExtensionMiscTextureCube) != 0;
+						Depth	= 1;
+					}
+
+					break;
+
+					case DDSDimensionTexture3D:
+					{
+						if (!(Header.Flags & HeaderFlagVolume) || ArraySize > 1)
+						{
+							return DDSResultInvalidHeader;
+						}
+					}
+
+					break;
+
+					default:
+					{
+						return DDSResultUnsupportedDimension;
+					}
+				}
+
+				Dimension = static_cast<EDDSDimension>(Extension.Dimension);
+			}
+			else
+			{
+				Format		= GetLegacyFormat(Header.PixelFormat);
+				AlphaMode	= GetLegacyAlphaMode(Header.PixelFormat);
+
+				if (Header.Flags & HeaderFlagVolume)
+				{
+					Dimension = DDSDimensionTexture3D;
+				}
+				else
+				{
+					if (Header.Caps2 & Caps2CubeMap)
+					{
+						// Partial cube maps are not supported.
+
+						if ((Header.Caps2 & Caps2CubeMapAllFaces) != Caps2CubeMapAllFaces)
+						{
+							return DDSResultUnsupportedDimension;
+						}
+
+						Cube = true;
+					}
+
+					Depth		= 1;
+					Dimension	= DDSDimensionTexture2D;
+				}
+			}
+
+			if (!GetFormatInfo(Format, FormatInfo))
+			{
+				return DDSResultUnsupportedFormat;
+			}
+
+			if (Width == 0 || Height == 0 || Depth == 0 || MipLevels > MaxMipLevels)
+			{
+				return DDSResultInvalidHeader;
+			}
+
+			switch (Dimension)
+			{
+				case DDSDimensionTexture1D:
+				{
+					if (ArraySize > MaxTextureArraySize || Width > MaxTextureDimension1D)
+					{
+						return DDSResultUnsupportedDimension;
+					}
+				}
+
+				break;
+
+				case DDSDimensionTexture2D:
+				{
+					if (Cube)
+					{
+						if (ArraySize > MaxTextureArraySize / 6 || Width > MaxTextureCubeDimension || Height > MaxTextureCubeDimension)
+						{
+							return DDSResultUnsupportedDimension;
+						}
+					}
+					else if (ArraySize > MaxTextureArraySize || Width > MaxTextureDimension2D || Height > MaxTextureDimension2D)
+					{
+						return DDSResultUnsupportedDimension;
+					}
+				}
+
+				break;
+
+				default:
+				{
+					if (Width > MaxTextureDimension3D || Height > MaxTextureDimension3D || Depth > MaxTextureDimension3D)
+					{
+						return DDSResultUnsupportedDimension;
+					}
+				}
+			}
+
+			const Uint32 NumSlices = GetNumSlices();
+
+			Subresources.resize(static_cast<size_t>(NumSlices) * MipLevels);
+
+			for (Uint32 Slice = 0; Slice < NumSlices; ++Slice)
+			{
+				Uint32 MipWidth		= Width;
+				Uint32 MipHeight	= Height;
+				Uint32 MipDepth		= Depth;
+
+				for (Uint32 Mip = 0; Mip < MipLevels; ++Mip)
+				{
+					DDSSubresource & Subresource = Subresources[GetSubresourceIndex(Mip, Slice)];
+
+					Subresource.Mip			= Mip;
+					Subresource.Slice		= Slice;
+					Subresource.Width		= MipWidth;
+					Subresource.Height		= MipHeight;
+					Subresource.Depth		= MipDepth;
+					Subresource.BlocksWide	= (MipWidth + FormatInfo.BlockWidth - 1) / FormatInfo.BlockWidth;
+					Subresource.BlocksHigh	= (MipHeight + FormatInfo.BlockHeight - 1) / FormatInfo.BlockHeight;
+					Subresource.NumRows		= Subresource.BlocksHigh;
+					Subresource.RowPitch	= (static_cast<Uint64>(Subresource.BlocksWide) * FormatInfo.BitsPerBlock + 7) / 8;
+					Subresource.SlicePitch	= Subresource.RowPitch * Subresource.NumRows;
+					Subresource.Size		= Subresource.SlicePitch * MipDepth;
+					Subresource.Offset		= Offset;
+
+					// Dimensions are bounded above, so this cannot overflow before the check.
+
+					if (Subresource.Size > Size - Offset)
+					{
+						Subresources.clear();
+						return DDSResultTruncated;
+					}
+
+					Subresource.Data = Data + Offset;
+
+					Offset += Subresource.Size;
+
+					MipWidth	= MipWidth > 1 ? MipWidth >> 1 : 1;
+					MipHeight	= MipHeight > 1 ? MipHeight >> 1 : 1;
+					MipDepth	= MipDepth > 1 ? MipDepth >> 1 : 1;
+				}
+			}
+
+			this->Data = Data;
+			this->Size = Size;
+
+			return DDSResultOk;
+		}
+
+		void CDDSContainer::PrefetchMips(const Uint32 FirstMip, const Uint32 NumMips) const
+		{
+			if (!Mapping.IsOpen() || FirstMip >= MipLevels || NumMips == 0)
+			{
+				return;
+			}
+
+			const Uint32 LastMip = FirstMip + NumMips < MipLevels ? FirstMip + NumMips - 1 : MipLevels - 1;
+
+			// Mips of a slice are contiguous in the file.
+
+			for (Uint32 Slice = 0; Slice < GetNumSlices(); ++Slice)
+			{
+				const DDSSubresource & First	= GetSubresource(FirstMip, Slice);
+				const DDSSubresource & Last		= GetSubresource(LastMip, Slice);
+
+				Mapping.Prefetch(First.Offset, Last.Offset + Last.Size - First.Offset);
+			}
+		}
+
+		bool CDDSContainer::CopySubresource(const Uint32 Index, Byte * Destination, const Uint64 DestinationRowPitch, const Uint64 DestinationSlicePitch) const
+		{
+			if (Index >= Subresources.size() || !Destination)
+			{
+				return false;
+			}
+
+			const DDSSubresource & Subresource = Subresources[Index];
+
+			if (DestinationRowPitch < Subresource.RowPitch)
+			{
+				return false;
+			}
+
+			const Uint64 SlicePitch = DestinationSlicePitch ? DestinationSlicePitch : DestinationRowPitch * Subresource.NumRows;
+
+			if (SlicePitch < DestinationRowPitch * Subresource.NumRows)
+			{
+				return false;
+			}
+
+			if (DestinationRowPitch == Subresource.RowPitch && SlicePitch == Subresource.SlicePitch)
+			{
+				std::memcpy(Destination, Subresource.Data, static_cast<size_t>(Subresource.Size));
+				return true;
+			}
+
+			for (Uint32 Slice = 0; Slice < Subresource.Depth; ++Slice)
+			{
+				const Byte *	Source = Subresource.Data + Subresource.SlicePitch * Slice;
+				Byte *			Target = Destination + SlicePitch * Slice;
+
+				for (Uint32 Row = 0; Row < Subresource.NumRows; ++Row)
+				{
+					std::memcpy(Target, Source, static_cast<size_t>(Subresource.RowPitch));
+
+					Source += Subresource.RowPitch;
+					Target += DestinationRowPitch;
+				}
+			}
+
+			return true;
+		}
+
+		bool WriteContainer(const Uint32 Format, const Uint32 Width, const Uint32 Height, const Uint32 ArraySize, const Uint32 MipLevels, const TVector<const Byte*> & Subresources, TVector<Byte> & Output)
+		{
+			DDSFormatInfo FormatInfo;
+
+			if (!CDDSContainer::GetFormatInfo(Format, FormatInfo) ||
+				Width == 0 || Height == 0 || ArraySize == 0 ||
+				MipLevels == 0 || MipLevels > CDDSContainer::MaxMipLevels ||
+				Subresources.size() != static_cast<size_t>(ArraySize) * MipLevels)
+			{
+				return false;
+			}
+
+			FileHeader Header = {};
+			{
+				Header.Size						= sizeof(FileHeader);
+				Header.Flags					= HeaderFlagCaps | HeaderFlagHeight | HeaderFlagWidth | HeaderFlagPixelFormat;
+				Header.Height					= Height;
+				Header.Width					= Width;
+				Header.Depth					= 1;
+				Header.MipMapCount				= MipLevels;
+				Header.PixelFormat.Size			= sizeof(FilePixelFormat);
+				Header.PixelFormat.Flags		= PixelFormatFourCC;
+				Header.PixelFormat.FourCC		= MakeFourCC('D', 'X', '1', '0');
+				Header.Caps						= CapsTexture;
+			}
+
+			if (MipLevels > 1)
+			{
+				Header.Flags	|= HeaderFlagMipMapCount;
+				Header.Caps		|= CapsComplex | CapsMipMap;
+			}
+
+			FileHeaderExtension Extension = {};
+			{
+				Extension.Format		= Format;
+				Extension.Dimension		= DDSDimensionTexture2D;
+				Extension.ArraySize		= ArraySize;
+			}
+
+			Output.clear();
+			Output.reserve(sizeof(Uint32) + sizeof(FileHeader) + sizeof(FileHeaderExtension));
+
+			auto Append = [&Output](const void * Data, const size_t Size)
+			{
+				const Byte * Bytes = static_cast<const Byte*>(Data);
+				{
+					Output.insert(Output.end(), Bytes, Bytes + Size);
+				}
+			};
+
+			Append(&FileMagic, sizeof(FileMagic));
+			Append(&Header, sizeof(Header));
+			Append(&Extension, sizeof(Extension));
+
+			for (Uint32 Slice = 0; Slice < ArraySize; ++Slice)
+			{
+				Uint32 MipWidth		= Width;
+				Uint32 MipHeight	= Height;
+
+				for (Uint32 Mip = 0; Mip < MipLevels; ++Mip)
+				{
+					const Uint64 BlocksWide	= (MipWidth + FormatInfo.BlockWidth - 1) / FormatInfo.BlockWidth;
+					const Uint64 BlocksHigh	= (MipHeight + FormatInfo.BlockHeight - 1) / FormatInfo.BlockHeight;
+					const Uint64 RowPitch	= (BlocksWide * FormatInfo.BitsPerBlock + 7) / 8;
+
+					const Byte * Data = Subresources[Mip + Slice * MipLevels];
+
+					if (!Data)
+					{
+						return false;
+					}
+
+					Append(Data, static_cast<size_t>(RowPitch * BlocksHigh));
+
+					MipWidth	= MipWidth > 1 ? MipWidth >> 1 : 1;
+					MipHeight	= MipHeight > 1 ? MipHeight >> 1 : 1;
+				}
+			}
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,605 @@
+#include "Utils/Texture/MipGenerator.h"
+#include "Utils/System/CpuFeatures.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Texture
+{
+	namespace Mip
+	{
+		// Defined in MipGeneratorAVX2.cpp, the only file built with /arch:AVX2.
+		// Writes one output row from the weighted source rows.
+
+		void AccumulateRowsAVX2(const Float * Source, const Uint32 * Indices, const Float * Weights, const Uint32 NumTaps, const Uint32 RowLength, Float * Target);
+
+		namespace
+		{
+			constexpr Float Pi = 3.14159265358979f;
+
+			// Kaiser window parameters, a width of three source texels per side.
+
+			constexpr Float KaiserRadius	= 3.0f;
+			constexpr Float KaiserAlpha		= 4.0f;
+			constexpr Float LanczosRadius	= 3.0f;
+
+			// Rows per task, small levels run on a single thread.
+
+			constexpr Uint32 RowGrain = 16;
+
+			// Bisection steps when searching the alpha reference of a level.
+
+			constexpr Uint32 CoverageIterations = 16;
+
+			template<class T> inline T Clamp(const T Value, const T Low, const T High)
+			{
+				return Value < Low ? Low : Value > High ? High : Value;
+			}
+
+			inline Float SrgbToLinear(const Float Value)
+			{
+				return Value <= 0.04045f ? Value / 12.92f : std::pow((Value + 0.055f) / 1.055f, 2.4f);
+			}
+
+			inline Float LinearToSrgb(const Float Value)
+			{
+				return Value <= 0.0031308f ? Value * 12.92f : 1.055f * std::pow(Value, 1.0f / 2.4f) - 0.055f;
+			}
+
+			class CSrgbTable
+			{
+			private:
+
+				Float ToLinear[256];
+
+			public:
+
+				CSrgbTable()
+				{
+					for (Uint32 N = 0; N < 256; ++N)
+					{
+						ToLinear[N] = SrgbToLinear(N / 255.0f);
+					}
+				}
+
+				inline Float operator[](const Byte Value) const
+				{
+					return ToLinear[Value];
+				}
+			};
+
+			const CSrgbTable & GetSrgbTable()
+			{
+				static const CSrgbTable Table;
+				{
+					return Table;
+				}
+			}
+
+			inline Byte QuantizeUnorm(const Float Value)
+			{
+				return static_cast<Byte>(Clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+
+			inline Float Sinc(const Float X)
+			{
+				if (std::fabs(X) < 1e-5f)
+				{
+					return 1.0f;
+				}
+
+				return std::sin(Pi * X) / (Pi * X);
+			}
+
+			// Zeroth order modified Bessel function of the first kind.
+
+			Float BesselI0(const Float X)
+			{
+				const Float Half = X * 0.5f;
+
+				Float Sum	= 1.0f;
+				Float Term	= 1.0f;
+
+				for (Uint32 K = 1; K < 32; ++K)
+				{
+					Term *= (Half / K) * (Half / K);
+					Sum += Term;
+
+					if (Term < Sum * 1e-8f)
+					{
+						break;
+					}
+				}
+
+				return Sum;
+			}
+
+			inline Float GetFilterRadius(const EMipFilter Filter)
+			{
+				switch (Filter)
+				{
+					case MipFilterKaiser:
+						return KaiserRadius;
+					case MipFilterLanczos:
+						return LanczosRadius;
+					default:
+						return 0.5f;
+				}
+			}
+
+			Float GetFilterWeight(const EMipFilter Filter, const Float X)
+			{
+				const Float Distance = std::fabs(X);
+
+				switch (Filter)
+				{
+					case MipFilterKaiser:
+					{
+						if (Distance >= KaiserRadius)
+						{
+							return 0.0f;
+						}
+
+						const Float T = Distance / KaiserRadius;
+						{
+							return Sinc(X) * BesselI0(KaiserAlpha * std::sqrt(1.0f - T * T)) / BesselI0(KaiserAlpha);
+						}
+					}
+					case MipFilterLanczos:
+					{
+						if (Distance >= LanczosRadius)
+						{
+							return 0.0f;
+						}
+
+						return Sinc(X) * Sinc(X / LanczosRadius);
+					}
+					default:
+					{
+						if (Distance < 0.5f)
+						{
+							return 1.0f;
+						}
+
+						return Distance == 0.5f ? 0.5f : 0.0f;
+					}
+				}
+			}
+
+			/************************************************************
+			*
+			*	Polyphase weights for one axis. Every destination
+			*	texel reads the same number of taps, indices are
+			*	already wrapped or clamped to the source.
+			*
+			************************************************************/
+
+			struct FilterTaps
+			{
+				Uint32			NumTaps = 0;
+
+				TVector<Uint32>	Indices;
+				TVector<Float>	Weights;
+			};
+
+			void BuildFilterTaps(const EMipFilter Filter, const Uint32 SourceSize, const Uint32 DestinationSize, const bool Wrap, FilterTaps & Taps)
+			{
+				const Float Scale	= static_cast<Float>(SourceSize) / DestinationSize;
+				const Float Support	= GetFilterRadius(Filter) * std::max(Scale, 1.0f);
+				const Float Inverse	= 1.0f / std::max(Scale, 1.0f);
+
+				Taps.NumTaps = static_cast<Uint32>(std::ceil(Support * 2.0f)) + 1;
+				Taps.Indices.resize(static_cast<size_t>(DestinationSize) * Taps.NumTaps);
+				Taps.Weights.resize(static_cast<size_t>(DestinationSize) * Taps.NumTaps);
+
+				for (Uint32 X = 0; X < DestinationSize; ++X)
+				{
+					const Float Center	= (X + 0.5f) * Scale;
+					const Int32 First	= static_cast<Int32>(std::floor(Center - Support));
+
+					Uint32 *	Indices	= &Taps.Indices[static_cast<size_t>(X) * Taps.NumTaps];
+					Float *		Weights	= &Taps.Weights[static_cast<size_t>(X) * Taps.NumTaps];
+					Float		Sum		= 0.0f;
+
+					for (Uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+					{
+						const Int32 Source = First + static_cast<Int32>(Tap);
+
+						if (Wrap)
+						{
+							const Int32 Size = static_cast<Int32>(SourceSize);
+							{
+								Indices[Tap] = static_cast<Uint32>(((Source % Size) + Size) % Size);
+							}
+						}
+						else
+						{
+							Indices[Tap] = static_cast<Uint32>(Clamp(Source, 0, static_cast<Int32>(SourceSize) - 1));
+						}
+
+						Weights[Tap] = GetFilterWeight(Filter, (Source + 0.5f - Center) * Inverse);
+						Sum += Weights[Tap];
+					}
+
+					if (std::fabs(Sum) < 1e-6f)
+					{
+						// Degenerate footprint, fall back to the nearest texel.
+
+						std::fill(Weights, Weights + Taps.NumTaps, 0.0f);
+
+						Indices[0] = std::min(static_cast<Uint32>(Center), SourceSize - 1);
+						Weights[0] = 1.0f;
+					}
+					else
+					{
+						for (Uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+						{
+							Weights[Tap] /= Sum;
+						}
+					}
+				}
+			}
+
+			template<class Function> void ForEachRow(const Uint32 Height, Function && Callback)
+			{
+				tbb::parallel_for(tbb::blocked_range<Uint32>(0, Height, RowGrain), [&](const tbb::blocked_range<Uint32> & Range)
+				{
+					for (Uint32 Y = Range.begin(); Y != Range.end(); ++Y)
+					{
+						Callback(Y);
+					}
+				});
+			}
+
+			// Filters every row to the destination width, one RGBA texel per register.
+
+			void ResampleHorizontal(const MipLevel & Source, const FilterTaps & Taps, const Uint32 Width, TVector<Float> & Output)
+			{
+				Output.resize(static_cast<size_t>(Width) * Source.Height * 4);
+
+				ForEachRow(Source.Height, [&](const Uint32 Y)
+				{
+					const Float *	Row		= &Source.Pixels[static_cast<size_t>(Y) * Source.Width * 4];
+					Float *			Target	= &Output[static_cast<size_t>(Y) * Width * 4];
+
+					for (Uint32 X = 0; X < Width; ++X)
+					{
+						const Uint32 *	Indices = &Taps.Indices[static_cast<size_t>(X) * Taps.NumTaps];
+						const Float *	Weights = &Taps.Weights[static_cast<size_t>(X) * Taps.NumTaps];
+
+						__m128 Sum = _mm_setzero_ps();
+
+						for (Uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+						{
+							Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Weights[Tap]), _mm_loadu_ps(Row + Indices[Tap] * 4)));
+						}
+
+						_mm_storeu_ps(Target + X * 4, Sum);
+					}
+				});
+			}
+
+			const bool ResampleWithAVX2 = System::GetCpuFeatures().AVX2 && System::GetCpuFeatures().FMA;
+
+			// Accumulates whole source rows, the row length is always a multiple of four.
+
+			void ResampleVertical(const TVector<Float> & Source, const Uint32 Width, const FilterTaps & Taps, MipLevel & Output)
+			{
+				const Uint32 RowLength = Width * 4;
+
+				Output.Pixels.resize(static_cast<size_t>(RowLength) * Output.Height);
+
+				ForEachRow(Output.Height, [&](const Uint32 Y)
+				{
+					const Uint32 *	Indices = &Taps.Indices[static_cast<size_t>(Y) * Taps.NumTaps];
+					const Float *	Weights = &Taps.Weights[static_cast<size_t>(Y) * Taps.NumTaps];
+
+					Float * Target = &Output.Pixels[static_cast<size_t>(Y) * RowLength];
+
+					if (ResampleWithAVX2)
+					{
+						AccumulateRowsAVX2(Source.data(), Indices, Weights, Taps.NumTaps, RowLength, Target);
+						return;
+					}
+
+					std::fill(Target, Target + RowLength, 0.0f);
+
+					for (Uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+					{
+						const Float * Row = &Source[static_cast<size_t>(Indices[Tap]) * RowLength];
+
+						const __m128 Weight = _mm_set1_ps(Weights[Tap]);
+
+						for (Uint32 N = 0; N < RowLength; N += 4)
+						{
+							_mm_storeu_ps(Target + N, _mm_add_ps(_mm_mul_ps(Weight, _mm_loadu_ps(Row + N)), _mm_loadu_ps(Target + N)));
+						}
+					}
+				});
+			}
+
+			Float ComputeCoverage(const MipLevel & Level, const Float Reference, const Float Scale)
+			{
+				Uint64 Passed = 0;
+
+				for (size_t N = 3; N < Level.Pixels.size(); N += 4)
+				{
+					if (Level.Pixels[N] * Scale > Reference)
+					{
+						++Passed;
+					}
+				}
+
+				return static_cast<Float>(Passed) / (static_cast<Uint64>(Level.Width) * Level.Height);
+			}
+		}
+
+		Uint32 CMipChain::GetNumLevels(const Uint32 Width, const Uint32 Height)
+		{
+			Uint32 Size		= std::max(Width, Height);
+			Uint32 Count	= 1;
+
+			while (Size > 1)
+			{
+				Size >>= 1;
+				++Count;
+			}
+
+			return Count;
+		}
+
+		bool CMipChain::Generate(const BC::ImageRGBA8 & Source, const MipOptions & Options)
+		{
+			if (!Source.Data || Source.Width == 0 || Source.Height == 0 || Source.RowPitch < Source.Width * 4ULL)
+			{
+				return false;
+			}
+
+			this->Options = Options;
+
+			Levels.clear();
+			Levels.emplace_back();
+
+			MipLevel & Top = Levels.front();
+			{
+				Top.Width	= Source.Width;
+				Top.Height	= Source.Height;
+				Top.Pixels.resize(static_cast<size_t>(Source.Width) * Source.Height * 4);
+			}
+
+			const CSrgbTable & Table = GetSrgbTable();
+
+			ForEachRow(Source.Height, [&](const Uint32 Y)
+			{
+				const Byte *	Row		= Source.Data + Y * Source.RowPitch;
+				Float *			Target	= &Top.Pixels[static_cast<size_t>(Y) * Source.Width * 4];
+
+				for (Uint32 N = 0; N < Source.Width * 4; N += 4)
+				{
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						if (Options.NormalMap)
+						{
+							Target[N + C] = Row[N + C] / 255.0f * 2.0f - 1.0f;
+						}
+						else if (Options.Srgb)
+						{
+							Target[N + C] = Table[Row[N + C]];
+						}
+						else
+						{
+							Target[N + C] = Row[N + C] / 255.0f;
+						}
+					}
+
+					Target[N + 3] = Row[N + 3] / 255.0f;
+				}
+			});
+
+			BuildChain();
+
+			return true;
+		}
+
+		bool CMipChain::Generate(const BC::ImageRGBA32F & Source, const MipOptions & Options)
+		{
+			if (!Source.Data || Source.Width == 0 || Source.Height == 0 || Source.RowPitch < Source.Width * sizeof(Float) * 4ULL)
+			{
+				return false;
+			}
+
+			// Float data is taken as linear, normals as already decoded.
+
+			this->Options = Options;
+			this->Options.Srgb = false;
+
+			Levels.clear();
+			Levels.emplace_back();
+
+			MipLevel & Top = Levels.front();
+			{
+				Top.Width	= Source.Width;
+				Top.Height	= Source.Height;
+				Top.Pixels.resize(static_cast<size_t>(Source.Width) * Source.Height * 4);
+			}
+
+			ForEachRow(Source.Height, [&](const Uint32 Y)
+			{
+				const Float * Row = reinterpret_cast<const Float*>(reinterpret_cast<const Byte*>(Source.Data) + Y * Source.RowPitch);
+				{
+					std::copy(Row, Row + Source.Width * 4, &Top.Pixels[static_cast<size_t>(Y) * Source.Width * 4]);
+				}
+			});
+
+			BuildChain();
+
+			return true;
+		}
+
+		void CMipChain::BuildChain()
+		{
+			const Uint32 FullLevels	= GetNumLevels(Levels.front().Width, Levels.front().Height);
+			const Uint32 NumLevels	= Options.MaxLevels ? std::min(Options.MaxLevels, FullLevels) : FullLevels;
+
+			FilterTaps		TapsX;
+			FilterTaps		TapsY;
+			TVector<Float>	Intermediate;
+
+			Levels.reserve(NumLevels);
+
+			// Each level is filtered from the one above, which keeps
+			// the footprint of the kernel constant.
+
+			for (Uint32 Level = 1; Level < NumLevels; ++Level)
+			{
+				const MipLevel & Source = Levels[Level - 1];
+
+				MipLevel Target;
+				{
+					Target.Width	= std::max(Source.Width >> 1, 1U);
+					Target.Height	= std::max(Source.Height >> 1, 1U);
+				}
+
+				BuildFilterTaps(Options.Filter, Source.Width, Target.Width, Options.Wrap, TapsX);
+				BuildFilterTaps(Options.Filter, Source.Height, Target.Height, Options.Wrap, TapsY);
+
+				ResampleHorizontal(Source, TapsX, Target.Width, Intermediate);
+				ResampleVertical(Intermediate, Target.Width, TapsY, Target);
+
+				if (Options.NormalMap)
+				{
+					RenormalizeLevel(Target);
+				}
+
+				Levels.push_back(std::move(Target));
+			}
+
+			if (Options.PreserveAlphaCoverage && !Options.NormalMap)
+			{
+				PreserveAlphaCoverage();
+			}
+		}
+
+		void CMipChain::RenormalizeLevel(MipLevel & Level)
+		{
+			ForEachRow(Level.Height, [&](const Uint32 Y)
+			{
+				Float * Row = &Level.Pixels[static_cast<size_t>(Y) * Level.Width * 4];
+
+				for (Uint32 N = 0; N < Level.Width * 4; N += 4)
+				{
+					const Float Length = std::sqrt(Row[N] * Row[N] + Row[N + 1] * Row[N + 1] + Row[N + 2] * Row[N + 2]);
+
+					if (Length > 1e-6f)
+					{
+						Row[N + 0] /= Length;
+						Row[N + 1] /= Length;
+						Row[N + 2] /= Length;
+					}
+					else
+					{
+						Row[N + 0] = 0.0f;
+						Row[N + 1] = 0.0f;
+						Row[N + 2] = 1.0f;
+					}
+				}
+			});
+		}
+
+		void CMipChain::PreserveAlphaCoverage()
+		{
+			const Float Reference	= Options.AlphaReference;
+			const Float Coverage	= ComputeCoverage(Levels.front(), Reference, 1.0f);
+
+			tbb::parallel_for(tbb::blocked_range<size_t>(1, Levels.size(), 1), [&](const tbb::blocked_range<size_t> & Range)
+			{
+				for (size_t Index = Range.begin(); Index != Range.end(); ++Index)
+				{
+					MipLevel & Level = Levels[Index];
+
+					// Search the threshold at which the level reaches the
+					// same coverage, then scale alpha so it maps onto the
+					// reference.
+
+					Float Low	= 0.0f;
+					Float High	= 1.0f;
+
+					for (Uint32 Iteration = 0; Iteration < CoverageIterations; ++Iteration)
+					{
+						const Float Middle = (Low + High) * 0.5f;
+
+						if (ComputeCoverage(Level, Middle, 1.0f) > Coverage)
+						{
+							Low = Middle;
+						}
+						else
+						{
+							High = Middle;
+						}
+					}
+
+					const Float Threshold	= (Low + High) * 0.5f;
+					const Float Scale		= Threshold > 0.0f ? Reference / Threshold : 1.0f;
+
+					for (size_t N = 3; N < Level.Pixels.size(); N += 4)
+					{
+						Level.Pixels[N] = Clamp(Level.Pixels[N] * Scale, 0.0f, 1.0f);
+					}
+				}
+			});
+		}
+
+		void CMipChain::GetLevel(const Uint32 Level, TVector<Byte> & Pixels, BC::ImageRGBA8 & Image) const
+		{
+			const MipLevel & Source = Levels[Level];
+
+			Pixels.resize(static_cast<size_t>(Source.Width) * Source.Height * 4);
+
+			ForEachRow(Source.Height, [&](const Uint32 Y)
+			{
+				const Float *	Row		= &Source.Pixels[static_cast<size_t>(Y) * Source.Width * 4];
+				Byte *			Target	= &Pixels[static_cast<size_t>(Y) * Source.Width * 4];
+
+				for (Uint32 N = 0; N < Source.Width * 4; N += 4)
+				{
+					for (Uint32 C = 0; C < 3; ++C)
+					{
+						if (Options.NormalMap)
+						{
+							Target[N + C] = QuantizeUnorm(Row[N + C] * 0.5f + 0.5f);
+						}
+						else if (Options.Srgb)
+						{
+							Target[N + C] = QuantizeUnorm(LinearToSrgb(Clamp(Row[N + C], 0.0f, 1.0f)));
+						}
+						else
+						{
+							Target[N + C] = QuantizeUnorm(Row[N + C]);
+						}
+					}
+
+					Target[N + 3] = QuantizeUnorm(Row[N + 3]);
+				}
+			});
+
+			Image.Data		= Pixels.data();
+			Image.Width		= Source.Width;
+			Image.Height	= Source.Height;
+			Image.RowPitch	= Source.Width * 4ULL;
+		}
+
+		void CMipChain::GetLevel(const Uint32 Level, BC::ImageRGBA32F & Image) const
+		{
+			const MipLevel & Source = Levels[Level];
+			{
+				Image.Data		= Source.Pixels.data();
+				Image.Width		= Source.Width;
+				Image.Height	= Source.Height;
+				Image.RowPitch	= Source.Width * sizeof(Float) * 4ULL;
+			}
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#include "Utils/Texture/MipGenerator.h"
+
+// Compiled with /arch:AVX2, only reached through the CPUID check in MipGenerator.cpp.
+
+namespace Texture
+{
+	namespace Mip
+	{
+		void AccumulateRowsAVX2(const Float * Source, const Uint32 * Indices, const Float * Weights, const Uint32 NumTaps, const Uint32 RowLength, Float * Target)
+		{
+			Uint32 N = 0;
+
+			// Sums all taps of a column block in a register, the target is written once.
+
+			for (; N + 8 <= RowLength; N += 8)
+			{
+				__m256 Sum = _mm256_setzero_ps();
+
+				for (Uint32 Tap = 0; Tap < NumTaps; ++Tap)
+				{
+					Sum = _mm256_fmadd_ps(_mm256_set1_ps(Weights[Tap]), _mm256_loadu_ps(Source + static_cast<size_t>(Indices[Tap]) * RowLength + N), Sum);
+				}
+
+				_mm256_storeu_ps(Target + N, Sum);
+			}
+
+			for (; N < RowLength; N += 4)
+			{
+				__m128 Sum = _mm_setzero_ps();
+
+				for (Uint32 Tap = 0; Tap < NumTaps; ++Tap)
+				{
+					Sum = _mm_fmadd_ps(_mm_set1_ps(Weights[Tap]), _mm_loadu_ps(Source + static_cast<size_t>(Indices[Tap]) * RowLength + N), Sum);
+				}
+
+				_mm_storeu_ps(Target + N, Sum);
+			}
+		}
+	}
+}
@@ -0,0 +1,448 @@
+#include "Utils/Texture/SplatMap.h"
+#include "Utils/File/File.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Texture
+{
+	namespace Splat
+	{
+		namespace
+		{
+			inline Uint32 AlignUp(const Uint32 Value, const Uint32 Alignment)
+			{
+				return (Value + Alignment - 1) & ~(Alignment - 1);
+			}
+
+			inline bool IsInside(const Uint64 Offset, const Uint64 Bytes, const Uint64 Size)
+			{
+				return Offset <= Size && Bytes <= Size - Offset;
+			}
+
+			inline Uint32 GetBits(const Uint32 NumColors)
+			{
+				if (NumColors <= 1)
+				{
+					return 0;
+				}
+
+				if (NumColors <= 2)
+				{
+					return 1;
+				}
+
+				if (NumColors <= 4)
+				{
+					return 2;
+				}
+
+				return NumColors <= SplatMaxPalette ? 4 : 8;
+			}
+
+			inline Uint32 GetTileBytes(const SplatTile & Tile, const Uint32 TileShift)
+			{
+				const Uint32 NumWords = ((Uint32(Tile.Bits) << (TileShift * 2)) + 31) / 32;
+
+				return AlignUp(Tile.NumColors, 4) + NumWords * 4;
+			}
+
+			// Encodes one tile, the result starts with the palette and is padded to whole words.
+
+			void EncodeTile(const Uint8 * Indices, const Uint32 Width, const Uint32 X, const Uint32 Y, const Uint32 TileWidth, const Uint32 TileHeight, const Uint32 TileShift, SplatTile & Tile, TVector<Byte> & Output)
+			{
+				bool	Used[256] = {};
+				Uint8	Slots[256];
+				Uint32	NumColors = 0;
+
+				for (Uint32 Row = 0; Row < TileHeight; ++Row)
+				{
+					const Uint8 * Source = Indices + static_cast<size_t>(Y + Row) * Width + X;
+
+					for (Uint32 Column = 0; Column < TileWidth; ++Column)
+					{
+						if (!Used[Source[Column]])
+						{
+							Used[Source[Column]] = true;
+							NumColors++;
+						}
+					}
+				}
+
+				Tile.Bits		= static_cast<Uint8>(GetBits(NumColors));
+				Tile.NumColors	= static_cast<Uint8>(Tile.Bits == 8 ? 0 : NumColors);
+				Tile.Reserved	= 0;
+
+				Output.assign(GetTileBytes(Tile, TileShift), 0);
+
+				// Palette in ascending order keeps the output independent of scan order.
+
+				for (Uint32 Value = 0, Slot = 0; Value < 256 && Tile.NumColors; ++Value)
+				{
+					if (Used[Value])
+					{
+						Output[Slot]	= static_cast<Byte>(Value);
+						Slots[Value]	= static_cast<Uint8>(Slot++);
+					}
+				}
+
+				if (Tile.Bits == 0)
+				{
+					return;
+				}
+
+				Uint32 * Words = reinterpret_cast<Uint32*>(Output.data() + AlignUp(Tile.NumColors, 4));
+
+				for (Uint32 Row = 0; Row < TileHeight; ++Row)
+				{
+					const Uint8 * Source = Indices + static_cast<size_t>(Y + Row) * Width + X;
+
+					for (Uint32 Column = 0; Column < TileWidth; ++Column)
+					{
+						const Uint32 Value	= Tile.NumColors ? Slots[Source[Column]] : Source[Column];
+						const Uint32 Bit	= ((Row << TileShift) | Column) * Tile.Bits;
+
+						Words[Bit >> 5] |= Value << (Bit & 31);
+					}
+				}
+			}
+		}
+
+		bool CSplatMap::IsSplatMap(const Byte * Content, const Uint64 Size)
+		{
+			return Size >= sizeof(SplatHeader) && reinterpret_cast<const SplatHeader*>(Content)->Magic == SplatMagic;
+		}
+
+		bool CSplatMap::Encode(const Uint8 * Indices, const Uint32 Width, const Uint32 Height, const Uint32 TileSize)
+		{
+			Close();
+
+			if (!Indices || Width == 0 || Height == 0 || TileSize < 4 || TileSize > 256 || (TileSize & (TileSize - 1)))
+			{
+				return false;
+			}
+
+			Uint32 TileShift = 0;
+
+			while ((1u << TileShift) < TileSize)
+			{
+				TileShift++;
+			}
+
+			const Uint32 TilesX = (Width + TileSize - 1) >> TileShift;
+			const Uint32 TilesY = (Height + TileSize - 1) >> TileShift;
+
+			TVector<SplatTile>		TileTable(static_cast<size_t>(TilesX) * TilesY);
+			TVector<TVector<Byte> >	TileData(TileTable.size());
+
+			tbb::parallel_for(size_t(0), TileTable.size(), [&](const size_t Index)
+			{
+				const Uint32 X = static_cast<Uint32>(Index % TilesX) << TileShift;
+				const Uint32 Y = static_cast<Uint32>(Index / TilesX) << TileShift;
+
+				EncodeTile(Indices, Width, X, Y, std::min(TileSize, Width - X), std::min(TileSize, Height - Y), TileShift, TileTable[Index], TileData[Index]);
+			});
+
+			Uint64 DataSize = 0;
+
+			for (size_t N = 0; N < TileTable.size(); ++N)
+			{
+				TileTable[N].Offset = static_cast<Uint32>(DataSize);
+
+				DataSize += TileData[N].size();
+
+				if (DataSize > 0xFFFFFFFFull)
+				{
+					return false;
+				}
+			}
+
+			const Uint64 TablesSize = sizeof(SplatHeader) + TileTable.size() * sizeof(SplatTile);
+
+			TVector<Byte> Content(static_cast<size_t>(TablesSize + DataSize));
+
+			SplatHeader * Target = reinterpret_cast<SplatHeader*>(Content.data());
+			{
+				Target->Magic		= SplatMagic;
+				Target->Version		= SplatVersion;
+				Target->Width		= Width;
+				Target->Height		= Height;
+				Target->TileShift	= TileShift;
+				Target->TilesX		= TilesX;
+				Target->TilesY		= TilesY;
+				Target->Reserved	= 0;
+				Target->DataSize	= DataSize;
+			}
+
+			std::memcpy(Content.data() + sizeof(SplatHeader), TileTable.data(), TileTable.size() * sizeof(SplatTile));
+
+			for (size_t N = 0; N < TileTable.size(); ++N)
+			{
+				std::memcpy(Content.data() + TablesSize + TileTable[N].Offset, TileData[N].data(), TileData[N].size());
+			}
+
+			return Load(std::move(Content));
+		}
+
+		bool CSplatMap::Attach(const Byte * Content, const Uint64 Size)
+		{
+			if (!IsSplatMap(Content, Size))
+			{
+				return false;
+			}
+
+			const SplatHeader & Candidate = *reinterpret_cast<const SplatHeader*>(Content);
+
+			if (Candidate.Version != SplatVersion ||
+				Candidate.Width == 0 ||
+				Candidate.Height == 0 ||
+				Candidate.TileShift < 2 ||
+				Candidate.TileShift > 8 ||
+				Candidate.TilesX != (Candidate.Width + (1u << Candidate.TileShift) - 1) >> Candidate.TileShift ||
+				Candidate.TilesY != (Candidate.Height + (1u << Candidate.TileShift) - 1) >> Candidate.TileShift)
+			{
+				return false;
+			}
+
+			const Uint64 NumTiles	= static_cast<Uint64>(Candidate.TilesX) * Candidate.TilesY;
+			const Uint64 TablesSize	= sizeof(SplatHeader) + NumTiles * sizeof(SplatTile);
+
+			if (!IsInside(TablesSize, Candidate.DataSize, Size))
+			{
+				return false;
+			}
+
+			const SplatTile * Table = reinterpret_cast<const SplatTile*>(Content + sizeof(SplatHeader));
+
+			// Every tile has to be readable with the layout it claims, so Get needs no checks.
+
+			for (Uint64 N = 0; N < NumTiles; ++N)
+			{
+				const SplatTile & Tile = Table[N];
+
+				const bool ValidLayout =
+					(Tile.Bits == 0 && Tile.NumColors == 1) ||
+					(Tile.Bits == 8 && Tile.NumColors == 0) ||
+					((Tile.Bits == 1 || Tile.Bits == 2 || Tile.Bits == 4) && Tile.NumColors > 1 && Tile.NumColors <= (1u << Tile.Bits));
+
+				if (!ValidLayout || Tile.Offset % 4 || !IsInside(Tile.Offset, GetTileBytes(Tile, Candidate.TileShift), Candidate.DataSize))
+				{
+					return false;
+				}
+			}
+
+			Header		= Candidate;
+			Tiles		= Table;
+			Data		= Content + TablesSize;
+			TileMask	= (1u << Header.TileShift) - 1;
+
+			return true;
+		}
+
+		bool CSplatMap::Open(const WString & Path)
+		{
+			Close();
+
+			if (!Mapping.Open(Path))
+			{
+				return false;
+			}
+
+			if (!Attach(Mapping.GetData(), Mapping.GetSize()))
+			{
+				Close();
+				return false;
+			}
+
+			Mapping.Advise(File::MappedFileAdviceRandom);
+
+			return true;
+		}
+
+		bool CSplatMap::Load(TVector<Byte> && Content)
+		{
+			Close();
+
+			Storage = std::move(Content);
+
+			if (!Attach(Storage.data(), Storage.size()))
+			{
+				Close();
+				return false;
+			}
+
+			return true;
+		}
+
+		bool CSplatMap::Write(const WString & Path) const
+		{
+			if (IsEmpty())
+			{
+				return false;
+			}
+
+			const Uint64 TablesSize = sizeof(SplatHeader) + static_cast<Uint64>(Header.TilesX) * Header.TilesY * sizeof(SplatTile);
+
+			File::CFile Output(Path);
+
+			TVector<Byte> & Content = Output.GetContentRef();
+			{
+				const Byte * Begin = Data - TablesSize;
+
+				Content.assign(Begin, Begin + TablesSize + Header.DataSize);
+			}
+
+			const bool Written = Output.WriteFileContent() == File::ErrorNone;
+
+			Output.Close();
+
+			return Written;
+		}
+
+		void CSplatMap::Close()
+		{
+			Mapping.Close();
+			Storage.clear();
+
+			Header		= {};
+			Tiles		= NULL;
+			Data		= NULL;
+			TileMask	= 0;
+		}
+
+		void CSplatMap::DecodeTile(const Uint32 TileX, const Uint32 TileY, const Uint32 X, const Uint32 Y, const Uint32 Width, const Uint32 Height, Uint8 * Output, const size_t Pitch) const
+		{
+			const SplatTile & Tile = Tiles[TileY * Header.TilesX + TileX];
+
+			const Byte * Palette = Data + Tile.Offset;
+
+			if (Tile.Bits == 0)
+			{
+				for (Uint32 Row = 0; Row < Height; ++Row)
+				{
+					std::memset(Output + Row * Pitch, Palette[0], Width);
+				}
+
+				return;
+			}
+
+			const Uint32 * Words	= reinterpret_cast<const Uint32*>(Palette + AlignUp(Tile.NumColors, 4));
+			const Uint32 Mask		= (1u << Tile.Bits) - 1;
+
+			for (Uint32 Row = 0; Row < Height; ++Row)
+			{
+				Uint8 * Target = Output + Row * Pitch;
+
+				Uint32 Bit = (((Y + Row) << Header.TileShift) | X) * Tile.Bits;
+
+				if (Tile.Bits == 8)
+				{
+					std::memcpy(Target, reinterpret_cast<const Byte*>(Words) + (Bit >> 3), Width);
+					continue;
+				}
+
+				for (Uint32 Column = 0; Column < Width; ++Column, Bit += Tile.Bits)
+				{
+					Target[Column] = Palette[(Words[Bit >> 5] >> (Bit & 31)) & Mask];
+				}
+			}
+		}
+
+		void CSplatMap::DecodeRegion(const Uint32 X, const Uint32 Y, const Uint32 Width, const Uint32 Height, Uint8 * Output, const size_t Pitch) const
+		{
+			const Uint32 EndX = std::min(X + Width, Header.Width);
+			const Uint32 EndY = std::min(Y + Height, Header.Height);
+
+			for (Uint32 TileY = Y >> Header.TileShift; (TileY << Header.TileShift) < EndY; ++TileY)
+			{
+				const Uint32 Top	= std::max(Y, TileY << Header.TileShift);
+				const Uint32 Bottom	= std::min(EndY, (TileY + 1) << Header.TileShift);
+
+				for (Uint32 TileX = X >> Header.TileShift; (TileX << Header.TileShift) < EndX; ++TileX)
+				{
+					const Uint32 Left	= std::max(X, TileX << Header.TileShift);
+					const Uint32 Right	= std::min(EndX, (TileX + 1) << Header.TileShift);
+
+					DecodeTile
+					(
+						TileX,
+						TileY,
+						Left & TileMask,
+						Top & TileMask,
+						Right - Left,
+						Bottom - Top,
+						Output + (Top - Y) * Pitch + (Left - X),
+						Pitch
+					);
+				}
+			}
+		}
+
+		void CSplatMap::DecodeLinear(const Uint64 Position, const Uint64 Count, Uint8 * Output) const
+		{
+			const Uint64 End = std::min(Position + Count, GetNumCells());
+
+			for (Uint64 Current = Position; Current < End; )
+			{
+				const Uint32 X = static_cast<Uint32>(Current % Header.Width);
+				const Uint32 Y = static_cast<Uint32>(Current / Header.Width);
+
+				const Uint32 Length = static_cast<Uint32>(std::min<Uint64>(Header.Width - X, End - Current));
+
+				DecodeRegion(X, Y, Length, 1, Output, Length);
+
+				Output	+= Length;
+				Current	+= Length;
+			}
+		}
+
+		void CSplatMap::Decode(TVector<Uint8> & Output) const
+		{
+			Output.resize(static_cast<size_t>(GetNumCells()));
+
+			if (IsEmpty())
+			{
+				return;
+			}
+
+			// One band of tiles per task.
+
+			tbb::parallel_for(Uint32(0), Header.TilesY, [&](const Uint32 TileY)
+			{
+				const Uint32 Y = TileY << Header.TileShift;
+
+				DecodeRegion(0, Y, Header.Width, std::min(Header.Height - Y, 1u << Header.TileShift), Output.data() + static_cast<size_t>(Y) * Header.Width, Header.Width);
+			});
+		}
+
+		void CSplatMap::Prefetch(const Uint32 X, const Uint32 Y, const Uint32 Width, const Uint32 Height) const
+		{
+			if (!Mapping.IsOpen() || Width == 0 || Height == 0)
+			{
+				return;
+			}
+
+			const Uint32 EndX = std::min(X + Width, Header.Width);
+			const Uint32 EndY = std::min(Y + Height, Header.Height);
+
+			if (X >= EndX || Y >= EndY)
+			{
+				return;
+			}
+
+			const Uint64 Base = Data - Mapping.GetData();
+
+			// Tiles of a row are stored back to back, one range per tile row.
+
+			for (Uint32 TileY = Y >> Header.TileShift; (TileY << Header.TileShift) < EndY; ++TileY)
+			{
+				const SplatTile & First	= Tiles[TileY * Header.TilesX + (X >> Header.TileShift)];
+				const SplatTile & Last	= Tiles[TileY * Header.TilesX + ((EndX - 1) >> Header.TileShift)];
+
+				Mapping.Prefetch(Base + First.Offset, Last.Offset + GetTileBytes(Last, Header.TileShift) - First.Offset);
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#include "Utils/Archive/PackFile.h"
+
+#include <experimental/filesystem>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace FileSystem = std::experimental::filesystem;
+
+// Packs every file below a directory, paths in the pack are relative to it.
+
+static void PrintUsage()
+{
+	std::wcerr << L"Usage: PackBuilder <output> <directory> [-store] [-chunk <bytes>] [-align <bytes>] [-nocompress <extension>]..." << std::endl;
+}
+
+int wmain(int Argc, wchar_t ** Argv)
+{
+	if (Argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const WString			OutputPath	= Argv[1];
+	const FileSystem::path	Root		= Argv[2];
+
+	Archive::CPackWriter::InitializeOptions Options;
+
+	TVector<WString> StoredExtensions;
+
+	for (int N = 3; N < Argc; ++N)
+	{
+		const WStringView Argument = Argv[N];
+
+		if (Argument == L"-store")
+		{
+			Options.Compress = false;
+		}
+		else if (Argument == L"-chunk" && N + 1 < Argc)
+		{
+			Options.ChunkSize = static_cast<Uint32>(std::wcstoul(Argv[++N], NULL, 10));
+		}
+		else if (Argument == L"-align" && N + 1 < Argc)
+		{
+			Options.Alignment = static_cast<Uint32>(std::wcstoul(Argv[++N], NULL, 10));
+		}
+		else if (Argument == L"-nocompress" && N + 1 < Argc)
+		{
+			StoredExtensions.push_back(Argv[++N]);
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (!FileSystem::is_directory(Root))
+	{
+		std::wcerr << L"Not a directory: " << Root.wstring() << std::endl;
+		return 1;
+	}
+
+	Archive::CPackWriter Writer(Options);
+
+	for (const FileSystem::directory_entry & Entry : FileSystem::recursive_directory_iterator(Root))
+	{
+		if (!FileSystem::is_regular_file(Entry.status()))
+		{
+			continue;
+		}
+
+		const WString Extension = Entry.path().extension().wstring();
+
+		// Already compressed formats only cost time to run through the codec.
+
+		const bool Compress = std::find(StoredExtensions.begin(), StoredExtensions.end(), Extension) == StoredExtensions.end();
+
+		WString Relative = Entry.path().wstring().substr(Root.wstring().size());
+
+		while (!Relative.empty() && (Relative.front() == L'\\' || Relative.front() == L'/'))
+		{
+			Relative.erase(Relative.begin());
+		}
+
+		Writer.AddFile(Relative, Entry.path().wstring(), Compress);
+	}
+
+	if (!Writer.Write(OutputPath))
+	{
+		std::wcerr << L"Failed to write " << OutputPath << std::endl;
+		return 1;
+	}
+
+	std::wcout << L"Packed " << Writer.GetNumEntries() << L" files into " << OutputPath << std::endl;
+
+	return 0;
+}
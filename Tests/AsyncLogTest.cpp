@@ -0,0 +1,289 @@
+#include "TestHarness.h"
+
+#include "Utils/Log/AsyncLog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <experimental/filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+using namespace Logging;
+
+// Logs through the shared writer into a temporary directory. The writer is
+// a process wide instance, every case initializes it and stops it again.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	class CLogDirectory
+	{
+	private:
+
+		Filesystem::path Root;
+
+	public:
+
+		CLogDirectory()
+		{
+			static Uint32 Counter = 0;
+
+			Root = Filesystem::temp_directory_path() / ("AsyncLogTest" + std::to_string(Counter++));
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+		}
+
+		~CLogDirectory()
+		{
+			CLogWriter::Instance().Stop();
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+		}
+
+		CLogWriter::InitializeOptions GetOptions() const
+		{
+			CLogWriter::InitializeOptions Options;
+			{
+				Options.Directory	= WString(Root.wstring());
+				Options.Name		= L"Test";
+				Options.WriteStdout	= false;
+			}
+
+			return Options;
+		}
+
+		TVector<std::string> ReadLines() const
+		{
+			std::ifstream Input(Root / "Test.log", std::ios::in | std::ios::binary);
+
+			TVector<std::string> Lines;
+
+			for (std::string Line; std::getline(Input, Line);)
+			{
+				Lines.push_back(Line);
+			}
+
+			return Lines;
+		}
+	};
+
+	// Logs from the destructor, which runs after the ring of its thread was retired.
+
+	struct CLateLogger
+	{
+		Uint32 Thread = 0;
+
+		~CLateLogger()
+		{
+			LOG_LIMITED(LevelWarning, "Test", 0, "Late record of thread {}", Thread);
+		}
+	};
+
+	size_t CountContaining(const TVector<std::string> & Lines, const char * Text)
+	{
+		return std::count_if(Lines.begin(), Lines.end(), [Text](const std::string & Line)
+		{
+			return Line.find(Text) != std::string::npos;
+		});
+	}
+}
+
+TEST_CASE(LogConvertsWideText)
+{
+	String Output;
+
+	// Two and three byte sequences and a character outside of the basic plane.
+
+	const WString Text = L"ü€\U0001F600";
+
+	AppendUTF8(Text.data(), Text.size(), Output);
+
+	CHECK(Output == "\xC3\xBC\xE2\x82\xAC\xF0\x9F\x98\x80");
+}
+
+TEST_CASE(LogRecordsOfExitedThreads)
+{
+	CLogDirectory Directory;
+
+	CHECK(CLogWriter::Instance().Initialize(Directory.GetOptions()));
+
+	const Uint32 NumThreads = 4;
+	const Uint32 NumRecords = 200;
+
+	TVector<std::thread> Threads;
+
+	for (Uint32 Thread = 0; Thread < NumThreads; ++Thread)
+	{
+		Threads.emplace_back([Thread]()
+		{
+			// Constructed before the ring of the thread, so destroyed after it.
+
+			thread_local CLateLogger Late;
+			{
+				Late.Thread = Thread;
+			}
+
+			for (Uint32 N = 0; N < NumRecords; ++N)
+			{
+				LOG_LIMITED(LevelInfo, "Test", 0, "Thread {} record {} {} {}", Thread, N, L"ü", Hex(0x8007000Eu));
+			}
+		});
+	}
+
+	for (std::thread & Thread : Threads)
+	{
+		Thread.join();
+	}
+
+	CLogWriter::Instance().Flush();
+
+	const LogStats Stats = CLogWriter::Instance().GetStats();
+
+	CLogWriter::Instance().Stop();
+
+	const TVector<std::string> Lines = Directory.ReadLines();
+
+	CHECK(Stats.NumDropped == 0);
+	CHECK(Lines.size() == NumThreads * (NumRecords + 1));
+
+	// Retired rings are freed once drained, only rings of live threads remain.
+
+	CHECK(Stats.NumThreads <= 1);
+
+	CHECK(CountContaining(Lines, "\xC3\xBC 0x8007000E") == NumThreads * NumRecords);
+	CHECK(CountContaining(Lines, "Late record of thread") == NumThreads);
+
+	// The records of one thread keep their order.
+
+	for (Uint32 Thread = 0; Thread < NumThreads; ++Thread)
+	{
+		const std::string Prefix = "Thread " + std::to_string(Thread) + " record ";
+
+		Uint32 Next = 0;
+
+		for (const std::string & Line : Lines)
+		{
+			const size_t Found = Line.find(Prefix);
+
+			if (Found != std::string::npos)
+			{
+				CHECK(std::stoul(Line.substr(Found + Prefix.size())) == Next++);
+			}
+		}
+
+		CHECK(Next == NumRecords);
+	}
+}
+
+TEST_CASE(LogRateLimitsSites)
+{
+	CLogDirectory Directory;
+
+	CHECK(CLogWriter::Instance().Initialize(Directory.GetOptions()));
+
+	for (Uint32 N = 0; N < 50; ++N)
+	{
+		LOG_LIMITED(LevelWarning, "Test", 10, "Limited {}", N);
+	}
+
+	CLogWriter::Instance().Flush();
+	CLogWriter::Instance().Stop();
+
+	// The window of one second is still open, the rest is suppressed.
+
+	CHECK(CountContaining(Directory.ReadLines(), "Limited") == 10);
+}
+
+BENCHMARK_CASE(BenchmarkLogProducerLatency)
+{
+	constexpr Uint32 NumRecords	= 1 << 18;
+	constexpr Uint32 BurstSize	= 4096;
+
+	CLogDirectory Directory;
+
+	CLogWriter::InitializeOptions Options = Directory.GetOptions();
+	{
+		Options.RingCapacity = BurstSize * 2;
+	}
+
+	CHECK(CLogWriter::Instance().Initialize(Options));
+
+	TVector<Uint64> Latencies(NumRecords);
+
+	// Nanoseconds of one call, the writer catches up between bursts so no record is dropped.
+
+	const auto Run = [&](const char * Name, auto && Log)
+	{
+		for (Uint32 N = 0; N < NumRecords; ++N)
+		{
+			const Uint64 Start = GetTimestamp();
+			{
+				Log(N);
+			}
+
+			Latencies[N] = GetTimestamp() - Start;
+
+			if (N % BurstSize == BurstSize - 1)
+			{
+				CLogWriter::Instance().Flush();
+			}
+		}
+
+		std::sort(Latencies.begin(), Latencies.end());
+
+		Test::Report((String(Name) + " p50").c_str(), static_cast<double>(Latencies[NumRecords / 2]), "ns");
+		Test::Report((String(Name) + " p99").c_str(), static_cast<double>(Latencies[NumRecords * 99 / 100]), "ns");
+		Test::Report((String(Name) + " p99.9").c_str(), static_cast<double>(Latencies[NumRecords * 999 / 1000]), "ns");
+	};
+
+	Run("Clock only", [](const Uint32 N) {});
+
+	Run("LOG_LIMITED", [](const Uint32 N)
+	{
+		LOG_LIMITED(LevelError, "Benchmark", 0, "Allocation of {} bytes failed for {} ({})", N * 64ull, "Texture", Hex(0x8007000Eu));
+	});
+
+	// Past the first records of its window the site only counts, what a failing call in a frame loop pays.
+
+	Run("LOG_ERROR rate limited", [](const Uint32 N)
+	{
+		LOG_ERROR("Benchmark", "Allocation of {} bytes failed for {} ({})", N * 64ull, "Texture", Hex(0x8007000Eu));
+	});
+
+	// What CErrorLog did before: format on the calling thread and write under a lock.
+
+	std::mutex	Mutex;
+	FILE *		File = std::fopen((Filesystem::temp_directory_path() / "AsyncLogBaseline.log").string().c_str(), "wb");
+
+	Run("Synchronous", [&](const Uint32 N)
+	{
+		std::ostringstream Line;
+		{
+			Line << "Allocation of " << N * 64ull << " bytes failed for " << "Texture" << " (0x" << std::hex << 0x8007000Eu << ")\n";
+		}
+
+		const std::string Text = Line.str();
+
+		std::lock_guard<std::mutex> Lock(Mutex);
+		{
+			std::fwrite(Text.data(), 1, Text.size(), File);
+			std::fflush(File);
+		}
+	});
+
+	std::fclose(File);
+	std::remove((Filesystem::temp_directory_path() / "AsyncLogBaseline.log").string().c_str());
+
+	CLogWriter::Instance().Flush();
+
+	const LogStats Stats = CLogWriter::Instance().GetStats();
+
+	Test::Report("Dropped", static_cast<double>(Stats.NumDropped), "records");
+	Test::Report("Writer per record", static_cast<double>(Stats.WriteMicroseconds) * 1000.0 / std::max<Uint64>(Stats.NumRecords, 1), "ns");
+}
@@ -0,0 +1,502 @@
+#include "TestHarness.h"
+
+#include "Utils/Texture/BlockCompression.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace Texture::BC;
+
+// Scalar decoders written straight from the format description and a
+// bounding box BC1 encoder, the usual baseline for real time encoders.
+// The decoders must match bit for bit, the encoder must be beaten.
+
+namespace
+{
+	struct Random
+	{
+		Uint32 State = 0x9E3779B9;
+
+		Uint32 Next()
+		{
+			State ^= State << 13;
+			State ^= State >> 17;
+			State ^= State << 5;
+
+			return State;
+		}
+	};
+
+	void ReferenceExpand565(const Uint32 Color, Byte Pixel[4])
+	{
+		const Uint32 R = (Color >> 11) & 31;
+		const Uint32 G = (Color >> 5) & 63;
+		const Uint32 B = Color & 31;
+
+		// Bit replication like the hardware, not rounded division.
+
+		Pixel[0] = static_cast<Byte>(R * 8 + R / 4);
+		Pixel[1] = static_cast<Byte>(G * 4 + G / 16);
+		Pixel[2] = static_cast<Byte>(B * 8 + B / 4);
+		Pixel[3] = 255;
+	}
+
+	void ReferencePaletteBC1(const Byte * Block, const bool FourColor, Byte Palette[4][4])
+	{
+		const Uint32 C0 = Block[0] | Block[1] << 8;
+		const Uint32 C1 = Block[2] | Block[3] << 8;
+
+		ReferenceExpand565(C0, Palette[0]);
+		ReferenceExpand565(C1, Palette[1]);
+
+		const bool Opaque = FourColor || C0 > C1;
+
+		for (Uint32 C = 0; C < 3; ++C)
+		{
+			const Uint32 A = Palette[0][C];
+			const Uint32 B = Palette[1][C];
+
+			Palette[2][C] = static_cast<Byte>(Opaque ? (2 * A + B + 1) / 3 : (A + B + 1) / 2);
+			Palette[3][C] = static_cast<Byte>(Opaque ? (A + 2 * B + 1) / 3 : 0);
+		}
+
+		Palette[2][3] = 255;
+		Palette[3][3] = Opaque ? 255 : 0;
+	}
+
+	void ReferenceDecodeColor(const Byte * Block, const bool FourColor, Byte Pixels[BlockPixels][4])
+	{
+		Byte Palette[4][4];
+		{
+			ReferencePaletteBC1(Block, FourColor, Palette);
+		}
+
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			const Uint32 Index = (Block[4 + N / 4] >> ((N % 4) * 2)) & 3;
+
+			for (Uint32 C = 0; C < 4; ++C)
+			{
+				Pixels[N][C] = Palette[Index][C];
+			}
+		}
+	}
+
+	void ReferenceDecodeAlpha(const Byte * Block, const Uint32 Channel, Byte Pixels[BlockPixels][4])
+	{
+		const Uint32 E0 = Block[0];
+		const Uint32 E1 = Block[1];
+
+		Uint32 Palette[8] = { E0, E1 };
+
+		if (E0 > E1)
+		{
+			for (Uint32 N = 1; N < 7; ++N)
+			{
+				Palette[N + 1] = ((7 - N) * E0 + N * E1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (Uint32 N = 1; N < 5; ++N)
+			{
+				Palette[N + 1] = ((5 - N) * E0 + N * E1 + 2) / 5;
+			}
+
+			Palette[6] = 0;
+			Palette[7] = 255;
+		}
+
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			const Uint32 Bit	= 16 + N * 3;
+			const Uint32 Word	= Block[Bit / 8] | (Bit / 8 + 1 < 8 ? Block[Bit / 8 + 1] << 8 : 0);
+
+			Pixels[N][Channel] = static_cast<Byte>(Palette[(Word >> (Bit % 8)) & 7]);
+		}
+	}
+
+	void ReferenceEncodeBC1(const Byte Pixels[BlockPixels][4], Byte * Block)
+	{
+		Uint32 Low[3]	= { 255, 255, 255 };
+		Uint32 High[3]	= { 0, 0, 0 };
+
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			for (Uint32 C = 0; C < 3; ++C)
+			{
+				Low[C]	= std::min<Uint32>(Low[C], Pixels[N][C]);
+				High[C]	= std::max<Uint32>(High[C], Pixels[N][C]);
+			}
+		}
+
+		Uint32 C0 = (High[0] * 31 + 127) / 255 << 11 | (High[1] * 63 + 127) / 255 << 5 | (High[2] * 31 + 127) / 255;
+		Uint32 C1 = (Low[0] * 31 + 127) / 255 << 11 | (Low[1] * 63 + 127) / 255 << 5 | (Low[2] * 31 + 127) / 255;
+
+		if (C0 < C1)
+		{
+			std::swap(C0, C1);
+		}
+
+		std::memset(Block, 0, 8);
+
+		Block[0] = static_cast<Byte>(C0);
+		Block[1] = static_cast<Byte>(C0 >> 8);
+		Block[2] = static_cast<Byte>(C1);
+		Block[3] = static_cast<Byte>(C1 >> 8);
+
+		if (C0 == C1)
+		{
+			return;
+		}
+
+		Byte Palette[4][4];
+		{
+			ReferencePaletteBC1(Block, true, Palette);
+		}
+
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			Uint32 Best			= 0;
+			Uint32 BestError	= ~0U;
+
+			for (Uint32 Entry = 0; Entry < 4; ++Entry)
+			{
+				Uint32 Error = 0;
+
+				for (Uint32 C = 0; C < 3; ++C)
+				{
+					const Int32 Delta = static_cast<Int32>(Pixels[N][C]) - Palette[Entry][C];
+					{
+						Error += static_cast<Uint32>(Delta * Delta);
+					}
+				}
+
+				if (Error < BestError)
+				{
+					Best		= Entry;
+					BestError	= Error;
+				}
+			}
+
+			Block[4 + N / 4] |= static_cast<Byte>(Best << ((N % 4) * 2));
+		}
+	}
+
+	// Smooth gradients with noise and hard edges, roughly like albedo maps.
+
+	TVector<Byte> CreateImage(const Uint32 Width, const Uint32 Height)
+	{
+		TVector<Byte> Pixels(static_cast<size_t>(Width) * Height * 4);
+
+		Random Noise;
+
+		for (Uint32 Y = 0; Y < Height; ++Y)
+		{
+			for (Uint32 X = 0; X < Width; ++X)
+			{
+				Byte * Pixel = &Pixels[(static_cast<size_t>(Y) * Width + X) * 4];
+
+				const Uint32 Edge = ((X / 37) + (Y / 53)) & 1 ? 64 : 0;
+
+				Pixel[0] = static_cast<Byte>(std::min<Uint32>(255, X * 255 / Width / 2 + Edge + Noise.Next() % 16));
+				Pixel[1] = static_cast<Byte>(std::min<Uint32>(255, Y * 255 / Height / 2 + Edge + Noise.Next() % 16));
+				Pixel[2] = static_cast<Byte>(std::min<Uint32>(255, (X + Y) * 255 / (Width + Height) + Noise.Next() % 32));
+				Pixel[3] = static_cast<Byte>(X * 255 / Width);
+			}
+		}
+
+		return Pixels;
+	}
+
+	void GatherBlock(const TVector<Byte> & Image, const Uint32 Width, const Uint32 BlockX, const Uint32 BlockY, Byte Pixels[BlockPixels][4])
+	{
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			std::memcpy(Pixels[N], &Image[((static_cast<size_t>(BlockY) * 4 + N / 4) * Width + BlockX * 4 + N % 4) * 4], 4);
+		}
+	}
+
+	TVector<Byte> CreateRandomBlocks(const Uint32 NumBlocks, const Uint32 BlockSize)
+	{
+		TVector<Byte> Blocks(static_cast<size_t>(NumBlocks) * BlockSize);
+
+		Random Noise;
+
+		for (Byte & Value : Blocks)
+		{
+			Value = static_cast<Byte>(Noise.Next() >> 24);
+		}
+
+		return Blocks;
+	}
+
+	template<class Decoder, class Reference> void CheckDecoder(const Uint32 BlockSize, Decoder && Decode, Reference && ReferenceDecode)
+	{
+		const TVector<Byte> Blocks = CreateRandomBlocks(4096, BlockSize);
+
+		for (size_t Offset = 0; Offset < Blocks.size(); Offset += BlockSize)
+		{
+			Byte Pixels[BlockPixels][4];
+			Byte Expected[BlockPixels][4];
+
+			std::memset(Pixels, 0x5A, sizeof(Pixels));
+			std::memset(Expected, 0x5A, sizeof(Expected));
+
+			Decode(&Blocks[Offset], Pixels);
+			ReferenceDecode(&Blocks[Offset], Expected);
+
+			CHECK(std::memcmp(Pixels, Expected, sizeof(Pixels)) == 0);
+		}
+	}
+
+	double ComputeEncodedPSNR(const TVector<Byte> & Image, const TVector<Byte> & Decoded, const Uint32 Width, const Uint32 Height)
+	{
+		ImageRGBA8 Reference;
+		{
+			Reference.Data		= Image.data();
+			Reference.Width		= Width;
+			Reference.Height	= Height;
+			Reference.RowPitch	= Width * 4ULL;
+		}
+
+		ImageRGBA8 Result = Reference;
+		{
+			Result.Data = Decoded.data();
+		}
+
+		return ComputePSNR(Reference, Result, 3);
+	}
+}
+
+TEST_CASE(DecodeBC1MatchesReference)
+{
+	CheckDecoder(8, [](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		DecodeBlockBC1(Block, Pixels);
+	},
+	[](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		ReferenceDecodeColor(Block, false, Pixels);
+	});
+}
+
+TEST_CASE(DecodeBC3MatchesReference)
+{
+	CheckDecoder(16, [](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		DecodeBlockBC3(Block, Pixels);
+	},
+	[](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		ReferenceDecodeColor(Block + 8, true, Pixels);
+		ReferenceDecodeAlpha(Block, 3, Pixels);
+	});
+}
+
+TEST_CASE(DecodeBC4MatchesReference)
+{
+	for (Uint32 Channel = 0; Channel < 4; ++Channel)
+	{
+		CheckDecoder(8, [Channel](const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			DecodeBlockBC4(Block, Pixels, Channel);
+		},
+		[Channel](const Byte * Block, Byte Pixels[BlockPixels][4])
+		{
+			ReferenceDecodeAlpha(Block, Channel, Pixels);
+		});
+	}
+}
+
+TEST_CASE(DecodeBC5MatchesReference)
+{
+	CheckDecoder(16, [](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		DecodeBlockBC5(Block, Pixels);
+	},
+	[](const Byte * Block, Byte Pixels[BlockPixels][4])
+	{
+		for (Uint32 N = 0; N < BlockPixels; ++N)
+		{
+			Pixels[N][2] = 0;
+			Pixels[N][3] = 255;
+		}
+
+		ReferenceDecodeAlpha(Block, 0, Pixels);
+		ReferenceDecodeAlpha(Block + 8, 1, Pixels);
+	});
+}
+
+TEST_CASE(EncodeBC1BeatsBoundingBox)
+{
+	constexpr Uint32 Width	= 256;
+	constexpr Uint32 Height	= 256;
+
+	const TVector<Byte> Image = CreateImage(Width, Height);
+
+	ImageRGBA8 Source;
+	{
+		Source.Data		= Image.data();
+		Source.Width	= Width;
+		Source.Height	= Height;
+		Source.RowPitch	= Width * 4ULL;
+	}
+
+	TVector<Byte> Reference(GetCompressedSize(BlockFormatBC1, Width, Height));
+
+	for (Uint32 BlockY = 0; BlockY < Height / 4; ++BlockY)
+	{
+		for (Uint32 BlockX = 0; BlockX < Width / 4; ++BlockX)
+		{
+			Byte Pixels[BlockPixels][4];
+			{
+				GatherBlock(Image, Width, BlockX, BlockY, Pixels);
+			}
+
+			ReferenceEncodeBC1(Pixels, &Reference[(static_cast<size_t>(BlockY) * (Width / 4) + BlockX) * 8]);
+		}
+	}
+
+	TVector<Byte> ReferenceDecoded;
+	{
+		CHECK(Decompress(BlockFormatBC1, Reference.data(), Width, Height, ReferenceDecoded));
+	}
+
+	const double ReferencePSNR = ComputeEncodedPSNR(Image, ReferenceDecoded, Width, Height);
+
+	for (const EBlockQuality Quality : { BlockQualityFast, BlockQualityNormal, BlockQualityHigh })
+	{
+		BlockCompressionOptions Options;
+		{
+			Options.Format	= BlockFormatBC1;
+			Options.Quality	= Quality;
+		}
+
+		TVector<Byte> Blocks;
+		TVector<Byte> Decoded;
+
+		CHECK(Compress(Source, Options, Blocks));
+		CHECK(Decompress(BlockFormatBC1, Blocks.data(), Width, Height, Decoded));
+
+		CHECK(ComputeEncodedPSNR(Image, Decoded, Width, Height) >= ReferencePSNR);
+	}
+}
+
+BENCHMARK_CASE(BenchmarkBlockDecode)
+{
+	constexpr Uint32 NumBlocks = 1 << 18;
+
+	const double Megabytes = NumBlocks * BlockPixels * 4.0 / (1024.0 * 1024.0);
+
+	const TVector<Byte> Blocks = CreateRandomBlocks(NumBlocks, 16);
+
+	Byte Pixels[BlockPixels][4];
+
+	Uint32 Checksum = 0;
+
+	const auto Run = [&](const char * Name, const Uint32 BlockSize, auto && Decode)
+	{
+		const double Seconds = Test::Measure(5, [&]
+		{
+			for (Uint32 N = 0; N < NumBlocks; ++N)
+			{
+				Decode(&Blocks[static_cast<size_t>(N) * BlockSize], Pixels);
+
+				Checksum += Pixels[N % BlockPixels][N % 4];
+			}
+		});
+
+		Test::Report(Name, Megabytes / Seconds, "MB/s");
+	};
+
+	Run("BC1 reference", 8, [](const Byte * Block, Byte Output[BlockPixels][4]) { ReferenceDecodeColor(Block, false, Output); });
+	Run("BC1", 8, [](const Byte * Block, Byte Output[BlockPixels][4]) { DecodeBlockBC1(Block, Output); });
+
+	Run("BC3 reference", 16, [](const Byte * Block, Byte Output[BlockPixels][4]) { ReferenceDecodeColor(Block + 8, true, Output); ReferenceDecodeAlpha(Block, 3, Output); });
+	Run("BC3", 16, [](const Byte * Block, Byte Output[BlockPixels][4]) { DecodeBlockBC3(Block, Output); });
+
+	Run("BC4 reference", 8, [](const Byte * Block, Byte Output[BlockPixels][4]) { ReferenceDecodeAlpha(Block, 0, Output); });
+	Run("BC4", 8, [](const Byte * Block, Byte Output[BlockPixels][4]) { DecodeBlockBC4(Block, Output, 0); });
+
+	Run("BC5 reference", 16, [](const Byte * Block, Byte Output[BlockPixels][4]) { ReferenceDecodeAlpha(Block, 0, Output); ReferenceDecodeAlpha(Block + 8, 1, Output); });
+	Run("BC5", 16, [](const Byte * Block, Byte Output[BlockPixels][4]) { DecodeBlockBC5(Block, Output); });
+
+	Test::Report("Checksum", Checksum, "");
+}
+
+BENCHMARK_CASE(BenchmarkBlockEncode)
+{
+	constexpr Uint32 Width	= 1024;
+	constexpr Uint32 Height	= 1024;
+
+	const double Megabytes = Width * Height * 4.0 / (1024.0 * 1024.0);
+
+	const TVector<Byte> Image = CreateImage(Width, Height);
+
+	ImageRGBA8 Source;
+	{
+		Source.Data		= Image.data();
+		Source.Width	= Width;
+		Source.Height	= Height;
+		Source.RowPitch	= Width * 4ULL;
+	}
+
+	TVector<Byte> Blocks(GetCompressedSize(BlockFormatBC1, Width, Height));
+	TVector<Byte> Decoded;
+
+	const double ReferenceSeconds = Test::Measure(3, [&]
+	{
+		for (Uint32 BlockY = 0; BlockY < Height / 4; ++BlockY)
+		{
+			for (Uint32 BlockX = 0; BlockX < Width / 4; ++BlockX)
+			{
+				Byte Pixels[BlockPixels][4];
+				{
+					GatherBlock(Image, Width, BlockX, BlockY, Pixels);
+				}
+
+				ReferenceEncodeBC1(Pixels, &Blocks[(static_cast<size_t>(BlockY) * (Width / 4) + BlockX) * 8]);
+			}
+		}
+	});
+
+	Decompress(BlockFormatBC1, Blocks.data(), Width, Height, Decoded);
+
+	Test::Report("BC1 reference, 1 thread", Megabytes / ReferenceSeconds, "MB/s");
+	Test::Report("BC1 reference PSNR", ComputeEncodedPSNR(Image, Decoded, Width, Height), "dB");
+
+	const char * QualityNames[] = { "fast", "normal", "high" };
+
+	for (const EBlockFormat Format : { BlockFormatBC1, BlockFormatBC3, BlockFormatBC7 })
+	{
+		const char * FormatName = Format == BlockFormatBC1 ? "BC1" : Format == BlockFormatBC3 ? "BC3" : "BC7";
+
+		for (const EBlockQuality Quality : { BlockQualityFast, BlockQualityNormal, BlockQualityHigh })
+		{
+			BlockCompressionOptions Options;
+			{
+				Options.Format			= Format;
+				Options.Quality			= Quality;
+				Options.MeasureQuality	= true;
+			}
+
+			BlockCompressionStats Stats;
+			{
+				CHECK(Compress(Source, Options, Blocks, &Stats));
+			}
+
+			char Name[64];
+
+			std::snprintf(Name, sizeof(Name), "%s %s, parallel", FormatName, QualityNames[Quality]);
+			{
+				Test::Report(Name, Stats.MegabytesPerSecond, "MB/s");
+			}
+
+			std::snprintf(Name, sizeof(Name), "%s %s PSNR", FormatName, QualityNames[Quality]);
+			{
+				Test::Report(Name, Stats.PSNR, "dB");
+			}
+		}
+	}
+}
@@ -0,0 +1,356 @@
+#include "TestHarness.h"
+
+#include "Utils/Shader/CompileScheduler.h"
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace ShaderCache;
+
+// Runs the scheduler without a cache against a compiler that only records
+// what it was asked for. Compiles can be held at a gate, so the queue fills
+// up deterministically before the workers continue.
+
+namespace
+{
+	class CFakeCompiler : public IShaderCompiler
+	{
+	private:
+
+		TMutex						Mutex;
+		std::condition_variable		Changed;
+
+		bool						Open = true;
+
+		TVector<String>				Order;
+		TVector<String>				Active;
+		Uint32						NumActive = 0;
+		Uint32						MaxActive = 0;
+		bool						Overlapped = false;
+
+	public:
+
+		virtual bool Compile(const ShaderKey & Key, ShaderCompileOutput & Output) override
+		{
+			std::unique_lock<TMutex> Lock(Mutex);
+
+			Order.push_back(Key.EntryPoint);
+
+			if (std::find(Active.begin(), Active.end(), Key.EntryPoint) != Active.end())
+			{
+				Overlapped = true;
+			}
+
+			Active.push_back(Key.EntryPoint);
+
+			MaxActive = std::max(MaxActive, ++NumActive);
+
+			Changed.notify_all();
+			Changed.wait(Lock, [this]()
+			{
+				return Open;
+			});
+
+			--NumActive;
+
+			Active.erase(std::find(Active.begin(), Active.end(), Key.EntryPoint));
+
+			Output.Bytecode.assign(Key.EntryPoint.begin(), Key.EntryPoint.end());
+
+			return Key.EntryPoint != "Failing";
+		}
+
+		virtual Uint64 GetCompilerHash() const override
+		{
+			return 1;
+		}
+
+		void Close()
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				Open = false;
+			}
+		}
+
+		void Release()
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				Open = true;
+			}
+
+			Changed.notify_all();
+		}
+
+		// Blocks until the given number of compiles has started.
+
+		void WaitForStarted(const size_t Count)
+		{
+			std::unique_lock<TMutex> Lock(Mutex);
+
+			Changed.wait(Lock, [this, Count]()
+			{
+				return Order.size() >= Count;
+			});
+		}
+
+		TVector<String> GetOrder()
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				return Order;
+			}
+		}
+
+		Uint32 GetMaxActive()
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				return MaxActive;
+			}
+		}
+
+		bool HasOverlapped()
+		{
+			std::scoped_lock<TMutex> Lock(Mutex);
+			{
+				return Overlapped;
+			}
+		}
+	};
+
+	class CSchedulerFixture
+	{
+	public:
+
+		std::shared_ptr<CFakeCompiler>	Compiler = std::make_shared<CFakeCompiler>();
+		CCompileScheduler				Scheduler;
+
+	public:
+
+		CSchedulerFixture(const Uint32 NumThreads)
+		{
+			CCompileScheduler::InitializeOptions Options;
+			{
+				Options.NumThreads = NumThreads;
+			}
+
+			CHECK(Scheduler.Initialize(Options));
+		}
+
+		Uint64 Submit(const char * EntryPoint, const Int32 Priority = CompilePriorityNormal, TCompileCallback Callback = TCompileCallback())
+		{
+			CompileRequest Request;
+			{
+				Request.Key.Path		= L"Fake.hlsl";
+				Request.Key.EntryPoint	= EntryPoint;
+				Request.Key.Profile		= "ps_5_1";
+				Request.Compiler		= Compiler;
+				Request.Priority		= Priority;
+				Request.Callback		= std::move(Callback);
+			}
+
+			return Scheduler.Submit(std::move(Request));
+		}
+
+		// Occupies the only worker, everything submitted afterwards waits in the queue.
+
+		void Block()
+		{
+			Compiler->Close();
+
+			Submit("Blocker", CompilePriorityVisible);
+
+			Compiler->WaitForStarted(1);
+		}
+
+		void Finish()
+		{
+			Compiler->Release();
+
+			Scheduler.Wait();
+		}
+	};
+}
+
+TEST_CASE(HigherPriorityCompilesFirst)
+{
+	CSchedulerFixture Fixture(1);
+	{
+		Fixture.Block();
+	}
+
+	Fixture.Submit("Background", CompilePriorityBackground);
+	Fixture.Submit("NormalFirst", CompilePriorityNormal);
+	Fixture.Submit("Visible", CompilePriorityVisible);
+	Fixture.Submit("NormalSecond", CompilePriorityNormal);
+
+	Fixture.Finish();
+
+	const TVector<String> Expected = { "Blocker", "Visible", "NormalFirst", "NormalSecond", "Background" };
+
+	CHECK(Fixture.Compiler->GetOrder() == Expected);
+	CHECK(Fixture.Scheduler.GetStats().NumCompleted == 5);
+}
+
+TEST_CASE(QueuedDuplicatesAreMerged)
+{
+	CSchedulerFixture Fixture(1);
+	{
+		Fixture.Block();
+	}
+
+	Uint32 NumCallbacks = 0;
+	Uint32 NumSucceeded = 0;
+
+	const TCompileCallback Count = [&NumCallbacks, &NumSucceeded](const CompileResult & Result)
+	{
+		++NumCallbacks;
+
+		if (Result.Succeeded && Result.Output.Bytecode.size() == 9)
+		{
+			++NumSucceeded;
+		}
+	};
+
+	Fixture.Submit("Other");
+	Fixture.Submit("Duplicate", CompilePriorityBackground, Count);
+
+	// The second request raises the queued one ahead of the other shader.
+
+	Fixture.Submit("Duplicate", CompilePriorityVisible, Count);
+
+	Fixture.Finish();
+
+	const TVector<String> Expected = { "Blocker", "Duplicate", "Other" };
+
+	CHECK(Fixture.Compiler->GetOrder() == Expected);
+	CHECK(NumCallbacks == 2 && NumSucceeded == 2);
+	CHECK(Fixture.Scheduler.GetStats().NumMerged == 1);
+	CHECK(Fixture.Scheduler.GetStats().NumCompleted == 3);
+}
+
+TEST_CASE(RunningKeyIsNotCompiledTwiceAtOnce)
+{
+	CSchedulerFixture Fixture(4);
+	{
+		Fixture.Compiler->Close();
+	}
+
+	Fixture.Submit("Edited");
+	Fixture.Compiler->WaitForStarted(1);
+
+	// Arrives while the first compile runs, so it has to run again afterwards.
+
+	Fixture.Submit("Edited");
+	Fixture.Submit("First");
+	Fixture.Submit("Second");
+	Fixture.Compiler->WaitForStarted(3);
+
+	Fixture.Finish();
+
+	const TVector<String> Order = Fixture.Compiler->GetOrder();
+
+	CHECK(Order.size() == 4);
+	CHECK(std::count(Order.begin(), Order.end(), "Edited") == 2);
+	CHECK(!Fixture.Compiler->HasOverlapped());
+	CHECK(Fixture.Scheduler.GetStats().NumMerged == 0);
+}
+
+TEST_CASE(WorkersCompileConcurrently)
+{
+	constexpr Uint32 NumThreads = 4;
+
+	CSchedulerFixture Fixture(NumThreads);
+	{
+		Fixture.Compiler->Close();
+	}
+
+	const char * EntryPoints[] = { "A", "B", "C", "D", "E", "F", "G", "H" };
+
+	for (const char * EntryPoint : EntryPoints)
+	{
+		Fixture.Submit(EntryPoint);
+	}
+
+	// Every worker holds a compile at the gate at the same time.
+
+	Fixture.Compiler->WaitForStarted(NumThreads);
+
+	CHECK(Fixture.Scheduler.GetNumPending() == _countof(EntryPoints));
+
+	Fixture.Finish();
+
+	CHECK(Fixture.Compiler->GetMaxActive() == NumThreads);
+	CHECK(Fixture.Scheduler.GetStats().MaxConcurrent == NumThreads);
+	CHECK(Fixture.Scheduler.GetStats().NumCompleted == _countof(EntryPoints));
+	CHECK(Fixture.Scheduler.GetNumPending() == 0);
+}
+
+TEST_CASE(SetPriorityMovesQueuedRequest)
+{
+	CSchedulerFixture Fixture(1);
+	{
+		Fixture.Block();
+	}
+
+	Fixture.Submit("Early");
+
+	const Uint64 Late = Fixture.Submit("Late");
+
+	CHECK(Fixture.Scheduler.IsPending(Late));
+	CHECK(Fixture.Scheduler.SetPriority(Late, CompilePriorityVisible));
+
+	Fixture.Finish();
+
+	const TVector<String> Expected = { "Blocker", "Late", "Early" };
+
+	CHECK(Fixture.Compiler->GetOrder() == Expected);
+	CHECK(!Fixture.Scheduler.IsPending(Late));
+	CHECK(!Fixture.Scheduler.SetPriority(Late, CompilePriorityBackground));
+}
+
+TEST_CASE(FailedCompileIsReported)
+{
+	CSchedulerFixture Fixture(2);
+
+	bool Succeeded = true;
+
+	Fixture.Submit("Failing", CompilePriorityNormal, [&Succeeded](const CompileResult & Result)
+	{
+		Succeeded = Result.Succeeded;
+	});
+
+	Fixture.Scheduler.Wait();
+
+	CHECK(!Succeeded);
+	CHECK(Fixture.Scheduler.GetStats().NumFailed == 1);
+}
+
+TEST_CASE(PermutationsAreUnique)
+{
+	const TVector<PermutationAxis> Axes =
+	{
+		{ "A", { "1", "2" } },
+		{ "B", { "X" } },
+		{ "A", { "2", "3" } },
+		{ "C", { } }
+	};
+
+	const TVector<TVector<ShaderDefine> > Permutations = EnumeratePermutations(Axes);
+
+	CHECK(Permutations.size() == 3);
+
+	THashSet<Uint64> Hashes;
+
+	for (const TVector<ShaderDefine> & Defines : Permutations)
+	{
+		CHECK(Defines.size() == 2);
+		CHECK(Defines[0].Name == "A" && Defines[1].Name == "B");
+
+		Hashes.insert(HashShaderDefines(Defines));
+	}
+
+	CHECK(Hashes.size() == Permutations.size());
+}
@@ -0,0 +1,255 @@
+#include "TestHarness.h"
+
+#include "Utils/File/ConfigStore.h"
+#include "Utils/File/File.h"
+#include "Utils/Shader/ShaderCache.h"
+
+#include <cstring>
+#include <thread>
+
+using namespace File;
+
+// Loads key value configs from a temporary directory through stores sharing
+// one cache directory, so every store after the first starts from the cache
+// files the others left behind.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	class CConfigDirectory
+	{
+	private:
+
+		WString Path;
+
+	public:
+
+		CConfigDirectory()
+		{
+			static Uint32 Counter = 0;
+
+			const Filesystem::path Root = Filesystem::temp_directory_path() / ("ConfigStoreTest" + std::to_string(Counter++));
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+			Filesystem::create_directories(Root / "Sub", Error);
+
+			Path = ShaderCache::NormalizePath(WString(Root.wstring()));
+		}
+
+		~CConfigDirectory()
+		{
+			std::error_code Error;
+
+			Filesystem::remove_all(Filesystem::path(Path.c_str()), Error);
+		}
+
+		WString Get(const wchar_t * Name) const
+		{
+			WString Result = Path;
+			{
+				Result.push_back(L'/');
+				Result.append(Name);
+			}
+
+			return Result;
+		}
+
+		void Write(const wchar_t * Name, const char * Content) const
+		{
+			File::CFile Output(Get(Name));
+			{
+				Output.GetContentRef().assign(Content, Content + std::strlen(Content));
+			}
+
+			CHECK(Output.WriteFileContent() == File::ErrorNone);
+
+			Output.Close();
+		}
+
+		// Moves the write time forward, file systems with a coarse clock would miss a quick rewrite.
+
+		void Touch(const wchar_t * Name) const
+		{
+			const Filesystem::path File(Get(Name).c_str());
+
+			std::error_code Error;
+
+			Filesystem::last_write_time(File, Filesystem::last_write_time(File) + std::chrono::seconds(10), Error);
+
+			CHECK(!Error);
+		}
+
+		CConfigStore::InitializeOptions GetOptions() const
+		{
+			CConfigStore::InitializeOptions Options;
+			{
+				Options.CacheDirectory = Get(L"Cache");
+			}
+
+			return Options;
+		}
+	};
+
+	class CStoreFixture
+	{
+	public:
+
+		CConfigStore Store;
+
+	public:
+
+		CStoreFixture(const CConfigDirectory & Directory)
+		{
+			CHECK(Store.Initialize(Directory.GetOptions()));
+		}
+
+		Int32 LoadValue(const WString & Path)
+		{
+			const TConfigTablePtr Table = Store.Load(Path);
+			{
+				CHECK(Table);
+			}
+
+			return Table->GetOr<Int32>("Graphics.Width", -1);
+		}
+	};
+}
+
+TEST_CASE(UnchangedConfigSkipsSource)
+{
+	CConfigDirectory Directory;
+	{
+		Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1280\n");
+	}
+
+	CStoreFixture First(Directory);
+
+	CHECK(First.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	CHECK(First.Store.GetStats().NumParsed == 1);
+	CHECK(First.Store.GetStats().NumCacheHits == 0);
+
+	// Write time and size match the stamp, the table comes from the cache file.
+
+	CStoreFixture Second(Directory);
+
+	CHECK(Second.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	CHECK(Second.Store.GetStats().NumParsed == 0);
+	CHECK(Second.Store.GetStats().NumCacheHits == 1);
+}
+
+TEST_CASE(TouchedConfigIsRestamped)
+{
+	CConfigDirectory Directory;
+	{
+		Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1280\n");
+	}
+
+	CStoreFixture First(Directory);
+	{
+		CHECK(First.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	}
+
+	Directory.Touch(L"Config.txt");
+
+	// The content hash matches, the cache is used and stamped with the new write time.
+
+	CStoreFixture Second(Directory);
+
+	CHECK(Second.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	CHECK(Second.Store.GetStats().NumContentHits == 1);
+	CHECK(Second.Store.GetStats().NumParsed == 0);
+
+	CStoreFixture Third(Directory);
+
+	CHECK(Third.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	CHECK(Third.Store.GetStats().NumCacheHits == 1);
+	CHECK(Third.Store.GetStats().NumContentHits == 0);
+}
+
+TEST_CASE(EditedConfigIsParsed)
+{
+	CConfigDirectory Directory;
+	{
+		Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1280\n");
+	}
+
+	CStoreFixture First(Directory);
+	{
+		CHECK(First.LoadValue(Directory.Get(L"Config.txt")) == 1280);
+	}
+
+	Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1920\n");
+	Directory.Touch(L"Config.txt");
+
+	CStoreFixture Second(Directory);
+
+	CHECK(Second.LoadValue(Directory.Get(L"Config.txt")) == 1920);
+	CHECK(Second.Store.GetStats().NumParsed == 1);
+	CHECK(Second.Store.GetStats().NumCacheHits == 0);
+	CHECK(Second.Store.GetStats().NumContentHits == 0);
+}
+
+TEST_CASE(ConfigPathsAreCanonicalized)
+{
+	CConfigDirectory Directory;
+	{
+		Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1280\n");
+	}
+
+	CStoreFixture Fixture(Directory);
+
+	WString Spelled = Directory.Get(L"Sub/.././/Config.txt");
+	{
+		std::replace(Spelled.begin(), Spelled.end(), L'/', L'\\');
+	}
+
+	const TConfigTablePtr Table = Fixture.Store.Load(Spelled);
+
+	CHECK(Table);
+	CHECK(Fixture.Store.Get(Directory.Get(L"Config.txt")) == Table);
+	CHECK(Fixture.Store.Load(Directory.Get(L"./Config.txt")) == Table);
+
+	Fixture.Store.Invalidate(Directory.Get(L"Sub/../Config.txt"));
+
+	CHECK(Fixture.Store.Update() == 1);
+}
+
+TEST_CASE(WatchedConfigIsReloaded)
+{
+	CConfigDirectory Directory;
+	{
+		Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1280\n");
+	}
+
+	CStoreFixture Fixture(Directory);
+
+	// The directory and the config are spelled differently, they still match.
+
+	CHECK(Fixture.Store.Watch(Directory.Get(L"Sub/..")));
+	CHECK(Fixture.LoadValue(Directory.Get(L"./Config.txt")) == 1280);
+
+	TVector<String> ChangedKeys;
+
+	Fixture.Store.Subscribe(Directory.Get(L"Config.txt"), [&ChangedKeys](const ConfigChange & Change)
+	{
+		ChangedKeys = Change.ChangedKeys;
+	});
+
+	Directory.Write(L"Config.txt", "[Graphics]\nWidth = 1920\n");
+
+	size_t NumReloaded = 0;
+
+	for (Uint32 Attempt = 0; Attempt < 100 && NumReloaded == 0; ++Attempt)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		NumReloaded = Fixture.Store.Update();
+	}
+
+	CHECK(NumReloaded == 1);
+	CHECK(ChangedKeys.size() == 1 && ChangedKeys[0] == "Graphics.Width");
+	CHECK(Fixture.Store.Get(Directory.Get(L"Config.txt"))->GetOr<Int32>("Graphics.Width", -1) == 1920);
+}
@@ -0,0 +1,423 @@
+#include "TestHarness.h"
+
+#include "Utils/Texture/DDSContainer.h"
+
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+#include <functional>
+
+using namespace Texture::DDS;
+
+// Parses containers assembled in memory, files written by WriteContainer
+// carry the DX10 header, legacy headers are built word by word.
+
+namespace
+{
+	constexpr Uint32 MakeFourCC(const char C0, const char C1, const char C2, const char C3)
+	{
+		return
+			static_cast<Uint32>(static_cast<Byte>(C0)) |
+			static_cast<Uint32>(static_cast<Byte>(C1)) << 8 |
+			static_cast<Uint32>(static_cast<Byte>(C2)) << 16 |
+			static_cast<Uint32>(static_cast<Byte>(C3)) << 24;
+	}
+
+	// Word offsets in the file, the magic is word zero.
+
+	enum EWords
+	{
+		WordMagic			= 0,
+		WordSize			= 1,
+		WordFlags			= 2,
+		WordHeight			= 3,
+		WordWidth			= 4,
+		WordDepth			= 6,
+		WordMipMapCount		= 7,
+		WordPixelSize		= 19,
+		WordPixelFlags		= 20,
+		WordFourCC			= 21,
+		WordBitCount		= 22,
+		WordRedMask			= 23,
+		WordGreenMask		= 24,
+		WordBlueMask		= 25,
+		WordAlphaMask		= 26,
+		WordCaps2			= 28,
+		WordFormat			= 32,
+		WordDimension		= 33,
+		WordMiscFlag		= 34,
+		WordArraySize		= 35,
+		WordMiscFlags2		= 36
+	};
+
+	constexpr Uint32 HeaderSize				= 128;
+	constexpr Uint32 ExtendedHeaderSize		= 148;
+
+	constexpr Uint32 FlagsTexture			= 0x00001007;
+	constexpr Uint32 FlagVolume				= 0x00800000;
+	constexpr Uint32 PixelFormatFourCC		= 0x00000004;
+	constexpr Uint32 PixelFormatRGB			= 0x00000040;
+	constexpr Uint32 PixelFormatAlphaPixels	= 0x00000001;
+	constexpr Uint32 Caps2CubeMapAllFaces	= 0x0000FE00;
+
+	class CFileBuilder
+	{
+	public:
+
+		TVector<Byte> Bytes;
+
+	public:
+
+		CFileBuilder(const Uint32 Width, const Uint32 Height, const Uint32 MipLevels, const bool Extended)
+		{
+			Bytes.resize(Extended ? ExtendedHeaderSize : HeaderSize);
+
+			Set(WordMagic,			MakeFourCC('D', 'D', 'S', ' '));
+			Set(WordSize,			124);
+			Set(WordFlags,			FlagsTexture);
+			Set(WordHeight,			Height);
+			Set(WordWidth,			Width);
+			Set(WordMipMapCount,	MipLevels);
+			Set(WordPixelSize,		32);
+
+			if (Extended)
+			{
+				Set(WordPixelFlags,	PixelFormatFourCC);
+				Set(WordFourCC,		MakeFourCC('D', 'X', '1', '0'));
+				Set(WordDimension,	DDSDimensionTexture2D);
+				Set(WordArraySize,	1);
+			}
+		}
+
+		void Set(const Uint32 Word, const Uint32 Value)
+		{
+			std::memcpy(Bytes.data() + Word * sizeof(Uint32), &Value, sizeof(Value));
+		}
+
+		// Fills the payload with its own byte offsets.
+
+		void AddPayload(const Uint64 Size)
+		{
+			const size_t First = Bytes.size();
+
+			Bytes.resize(First + static_cast<size_t>(Size));
+
+			for (size_t N = First; N < Bytes.size(); ++N)
+			{
+				Bytes[N] = static_cast<Byte>(N * 7);
+			}
+		}
+
+		EDDSResult Parse(CDDSContainer & Container) const
+		{
+			return Container.Parse(Bytes.data(), Bytes.size());
+		}
+	};
+
+	// Checks every subresource against the layout computed by hand.
+
+	void CheckLayout(const CDDSContainer & Container, const TVector<Byte> & File, const Uint32 HeaderBytes, const Uint32 BlockSize, const Uint32 BlockBytes)
+	{
+		Uint64 Offset = HeaderBytes;
+
+		for (Uint32 Slice = 0; Slice < Container.GetNumSlices(); ++Slice)
+		{
+			for (Uint32 Mip = 0; Mip < Container.GetMipLevels(); ++Mip)
+			{
+				const DDSSubresource & Subresource = Container.GetSubresource(Mip, Slice);
+
+				const Uint32 Width	= Math::Max(Container.GetWidth() >> Mip, 1U);
+				const Uint32 Height	= Math::Max(Container.GetHeight() >> Mip, 1U);
+				const Uint32 Depth	= Math::Max(Container.GetDepth() >> Mip, 1U);
+
+				CHECK(Subresource.Mip == Mip && Subresource.Slice == Slice);
+				CHECK(Subresource.Width == Width && Subresource.Height == Height && Subresource.Depth == Depth);
+				CHECK(Subresource.BlocksWide == (Width + BlockSize - 1) / BlockSize);
+				CHECK(Subresource.BlocksHigh == (Height + BlockSize - 1) / BlockSize);
+				CHECK(Subresource.NumRows == Subresource.BlocksHigh);
+				CHECK(Subresource.RowPitch == Subresource.BlocksWide * BlockBytes);
+				CHECK(Subresource.SlicePitch == Subresource.RowPitch * Subresource.NumRows);
+				CHECK(Subresource.Size == Subresource.SlicePitch * Depth);
+				CHECK(Subresource.Offset == Offset);
+				CHECK(Subresource.Data == File.data() + Offset);
+
+				Offset += Subresource.Size;
+			}
+		}
+
+		CHECK(Offset == File.size());
+	}
+
+	// Writes a DX10 container with every subresource filled with its index.
+
+	TVector<Byte> WriteArray(const Uint32 Format, const Uint32 Width, const Uint32 Height, const Uint32 ArraySize, const Uint32 MipLevels, const Uint32 BlockSize, const Uint32 BlockBytes)
+	{
+		TVector<TVector<Byte> >	Data;
+		TVector<const Byte*>	Subresources;
+
+		for (Uint32 Slice = 0; Slice < ArraySize; ++Slice)
+		{
+			for (Uint32 Mip = 0; Mip < MipLevels; ++Mip)
+			{
+				const Uint32 BlocksWide = (Math::Max(Width >> Mip, 1U) + BlockSize - 1) / BlockSize;
+				const Uint32 BlocksHigh = (Math::Max(Height >> Mip, 1U) + BlockSize - 1) / BlockSize;
+
+				Data.emplace_back(BlocksWide * BlocksHigh * BlockBytes, static_cast<Byte>(Data.size()));
+			}
+		}
+
+		for (const TVector<Byte> & Subresource : Data)
+		{
+			Subresources.push_back(Subresource.data());
+		}
+
+		TVector<Byte> Output;
+		{
+			CHECK(WriteContainer(Format, Width, Height, ArraySize, MipLevels, Subresources, Output));
+		}
+
+		return Output;
+	}
+}
+
+TEST_CASE(DDSBlockCompressedLayout)
+{
+	// Sizes that are not multiples of the block size, the last mips are a single block.
+
+	const TVector<Byte> BC1 = WriteArray(DDSFormatBC1Unorm, 10, 6, 2, 4, 4, 8);
+	const TVector<Byte> BC7 = WriteArray(DDSFormatBC7UnormSrgb, 13, 3, 1, 4, 4, 16);
+
+	CDDSContainer Container;
+
+	CHECK(Container.Parse(BC1.data(), BC1.size()) == DDSResultOk);
+	CHECK(Container.GetDimension() == DDSDimensionTexture2D);
+	CHECK(Container.GetFormatInfo().Compressed);
+	CHECK(Container.GetArraySize() == 2 && Container.GetNumSlices() == 2);
+	CHECK(Container.GetSubresources().size() == 8);
+
+	CheckLayout(Container, BC1, ExtendedHeaderSize, 4, 8);
+
+	CHECK(Container.GetSubresource(0, 1).Data[0] == 4);
+	CHECK(Container.GetSubresource(3, 1).Data[0] == 7);
+
+	CHECK(Container.Parse(BC7.data(), BC7.size()) == DDSResultOk);
+	CHECK(Container.GetFormat() == DDSFormatBC7UnormSrgb);
+
+	CheckLayout(Container, BC7, ExtendedHeaderSize, 4, 16);
+
+	CHECK(Container.GetSubresource(0, 0).RowPitch == 4 * 16);
+	CHECK(Container.GetSubresource(0, 0).NumRows == 1);
+}
+
+TEST_CASE(DDSUncompressedLayout)
+{
+	const TVector<Byte> RGBA = WriteArray(DDSFormatR8G8B8A8Unorm, 5, 3, 3, 3, 1, 4);
+	const TVector<Byte> R16 = WriteArray(DDSFormatR16Float, 7, 9, 1, 4, 1, 2);
+
+	CDDSContainer Container;
+
+	CHECK(Container.Parse(RGBA.data(), RGBA.size()) == DDSResultOk);
+	CHECK(!Container.GetFormatInfo().Compressed);
+
+	CheckLayout(Container, RGBA, ExtendedHeaderSize, 1, 4);
+
+	CHECK(Container.GetSubresource(0, 0).RowPitch == 20);
+	CHECK(Container.GetSubresource(2, 2).Size == 4);
+
+	CHECK(Container.Parse(R16.data(), R16.size()) == DDSResultOk);
+
+	CheckLayout(Container, R16, ExtendedHeaderSize, 1, 2);
+
+	// Rows are padded on copy, the payload stays the same.
+
+	const DDSSubresource & Source = Container.GetSubresource(0, 0);
+
+	TVector<Byte> Padded(static_cast<size_t>(Source.NumRows * 32), 0xCD);
+
+	CHECK(!Container.CopySubresource(0, Padded.data(), Source.RowPitch - 1));
+	CHECK(Container.CopySubresource(0, Padded.data(), 32));
+
+	for (Uint32 Row = 0; Row < Source.NumRows; ++Row)
+	{
+		CHECK(std::memcmp(Padded.data() + Row * 32, Source.Data + Row * Source.RowPitch, static_cast<size_t>(Source.RowPitch)) == 0);
+		CHECK(Padded[Row * 32 + static_cast<size_t>(Source.RowPitch)] == 0xCD);
+	}
+}
+
+TEST_CASE(DDSLegacyHeaders)
+{
+	CDDSContainer Container;
+
+	// DXT5 with a full mip chain.
+
+	CFileBuilder DXT5(8, 8, 4, false);
+	{
+		DXT5.Set(WordPixelFlags,	PixelFormatFourCC);
+		DXT5.Set(WordFourCC,		MakeFourCC('D', 'X', 'T', '5'));
+		DXT5.AddPayload(64 + 16 + 16 + 16);
+	}
+
+	CHECK(DXT5.Parse(Container) == DDSResultOk);
+	CHECK(Container.GetFormat() == DDSFormatBC3Unorm);
+
+	CheckLayout(Container, DXT5.Bytes, HeaderSize, 4, 16);
+
+	// Bit masks select the format, a cube map has six slices.
+
+	CFileBuilder Cube(4, 4, 1, false);
+	{
+		Cube.Set(WordPixelFlags,	PixelFormatRGB | PixelFormatAlphaPixels);
+		Cube.Set(WordBitCount,		32);
+		Cube.Set(WordRedMask,		0x00FF0000);
+		Cube.Set(WordGreenMask,		0x0000FF00);
+		Cube.Set(WordBlueMask,		0x000000FF);
+		Cube.Set(WordAlphaMask,		0xFF000000);
+		Cube.Set(WordCaps2,			Caps2CubeMapAllFaces);
+		Cube.AddPayload(6 * 4 * 4 * 4);
+	}
+
+	CHECK(Cube.Parse(Container) == DDSResultOk);
+	CHECK(Container.GetFormat() == DDSFormatB8G8R8A8Unorm);
+	CHECK(Container.IsCubeMap());
+	CHECK(Container.GetArraySize() == 1 && Container.GetNumSlices() == 6);
+
+	CheckLayout(Container, Cube.Bytes, HeaderSize, 1, 4);
+
+	Cube.Set(WordCaps2, 0x00000200 | 0x00000400);
+
+	CHECK(Cube.Parse(Container) == DDSResultUnsupportedDimension);
+
+	// Volume slices are stored one after another in each mip.
+
+	CFileBuilder Volume(4, 4, 2, false);
+	{
+		Volume.Set(WordFlags,		FlagsTexture | FlagVolume);
+		Volume.Set(WordDepth,		4);
+		Volume.Set(WordPixelFlags,	PixelFormatFourCC);
+		Volume.Set(WordFourCC,		MakeFourCC('D', 'X', 'T', '1'));
+		Volume.AddPayload(8 * 4 + 8 * 2);
+	}
+
+	CHECK(Volume.Parse(Container) == DDSResultOk);
+	CHECK(Container.GetDimension() == DDSDimensionTexture3D);
+	CHECK(Container.GetSubresource(0, 0).Size == 8 * 4);
+
+	CheckLayout(Container, Volume.Bytes, HeaderSize, 4, 8);
+
+	// Unknown masks have no format.
+
+	Cube.Set(WordCaps2,		Caps2CubeMapAllFaces);
+	Cube.Set(WordRedMask,	0x000000F0);
+
+	CHECK(Cube.Parse(Container) == DDSResultUnsupportedFormat);
+}
+
+TEST_CASE(DDSHeaderValidation)
+{
+	CDDSContainer Container;
+
+	auto Parse = [&Container](const std::function<void(CFileBuilder&)> & Modify)
+	{
+		CFileBuilder Builder(16, 16, 1, true);
+		{
+			Builder.Set(WordFormat, DDSFormatR8G8B8A8Unorm);
+			Builder.AddPayload(16 * 16 * 4);
+		}
+
+		Modify(Builder);
+
+		return Builder.Parse(Container);
+	};
+
+	CHECK(Parse([](CFileBuilder & Builder) {}) == DDSResultOk);
+
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordMagic, MakeFourCC('D', 'D', 'S', 'X')); }) == DDSResultInvalidMagic);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordSize, 120); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordPixelSize, 24); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordWidth, 0); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordMipMapCount, CDDSContainer::MaxMipLevels + 1); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordWidth, 16385); }) == DDSResultUnsupportedDimension);
+
+	// DX10 header fields.
+
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordArraySize, 0); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordArraySize, 2049); }) == DDSResultUnsupportedDimension);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordDimension, 5); }) == DDSResultUnsupportedDimension);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordFormat, DDSFormatUnknown); }) == DDSResultUnsupportedFormat);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordFormat, 130); }) == DDSResultUnsupportedFormat);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordDimension, DDSDimensionTexture1D); }) == DDSResultInvalidHeader);
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordDimension, DDSDimensionTexture3D); }) == DDSResultInvalidHeader);
+
+	CHECK(Parse([](CFileBuilder & Builder)
+	{
+		Builder.Set(WordFlags, FlagsTexture | FlagVolume);
+		Builder.Set(WordDimension, DDSDimensionTexture3D);
+		Builder.Set(WordArraySize, 2);
+	}) == DDSResultInvalidHeader);
+
+	// Six faces per cube, the payload only holds one.
+
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordMiscFlag, 0x4); }) == DDSResultTruncated);
+
+	CHECK(Parse([](CFileBuilder & Builder) { Builder.Set(WordMiscFlags2, DDS_ALPHA_MODE_PREMULTIPLIED); }) == DDSResultOk);
+	CHECK(Container.GetAlphaMode() == DDS_ALPHA_MODE_PREMULTIPLIED);
+}
+
+TEST_CASE(DDSTruncatedFilesRejected)
+{
+	const TVector<Byte> File = WriteArray(DDSFormatBC3Unorm, 12, 12, 2, 3, 4, 16);
+
+	CDDSContainer Container;
+
+	CHECK(Container.Parse(NULL, File.size()) == DDSResultTruncated);
+
+	// Every prefix of the file fails and leaves no subresources behind.
+
+	for (size_t Size = 0; Size < File.size(); ++Size)
+	{
+		CHECK(Container.Parse(File.data(), Size) == DDSResultTruncated);
+		CHECK(Container.GetSubresources().empty());
+	}
+
+	CHECK(Container.Parse(File.data(), File.size()) == DDSResultOk);
+	CHECK(Container.GetSubresources().size() == 6);
+
+	// Trailing bytes are ignored.
+
+	TVector<Byte> Padded = File;
+	{
+		Padded.resize(File.size() + 100);
+	}
+
+	CHECK(Container.Parse(Padded.data(), Padded.size()) == DDSResultOk);
+}
+
+TEST_CASE(DDSOpenMapsFile)
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	const Filesystem::path Path = Filesystem::temp_directory_path() / "DDSContainerTest.dds";
+
+	const TVector<Byte> File = WriteArray(DDSFormatBC1Unorm, 8, 8, 1, 2, 4, 8);
+	{
+		std::ofstream Output(Path, std::ios::out | std::ios::binary | std::ios::trunc);
+		{
+			Output.write(reinterpret_cast<const char*>(File.data()), File.size());
+		}
+	}
+
+	CDDSContainer Container;
+
+	CHECK(Container.Open(WString(Path.wstring())) == DDSResultOk);
+	CHECK(Container.GetSize() == File.size());
+	CHECK(std::memcmp(Container.GetSubresource(1, 0).Data, File.data() + ExtendedHeaderSize + 32, 8) == 0);
+
+	Container.Close();
+
+	std::error_code Error;
+
+	Filesystem::remove(Path, Error);
+
+	CHECK(Container.Open(WString(Path.wstring())) == DDSResultOpenFailed);
+	CHECK(Container.GetSubresources().empty());
+}
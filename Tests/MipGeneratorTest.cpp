@@ -0,0 +1,99 @@
+#include "TestHarness.h"
+
+#include "Utils/Texture/MipGenerator.h"
+
+#include <cmath>
+
+using namespace Texture;
+
+// Runs through the AVX2 resampler on CPUs that have it, the SSE one otherwise.
+
+namespace
+{
+	TVector<Float> CreateImage(const Uint32 Width, const Uint32 Height, BC::ImageRGBA32F & Image)
+	{
+		TVector<Float> Pixels(static_cast<size_t>(Width) * Height * 4);
+
+		for (size_t N = 0; N < Pixels.size(); ++N)
+		{
+			Pixels[N] = static_cast<Float>((N * 7919) % 251) / 250.0f;
+		}
+
+		Image.Data		= Pixels.data();
+		Image.Width		= Width;
+		Image.Height	= Height;
+		Image.RowPitch	= Width * sizeof(Float) * 4ULL;
+
+		return Pixels;
+	}
+}
+
+TEST_CASE(BoxFilterAveragesQuads)
+{
+	constexpr Uint32 Width	= 64;
+	constexpr Uint32 Height	= 36;
+
+	BC::ImageRGBA32F Source;
+
+	const TVector<Float> Pixels = CreateImage(Width, Height, Source);
+
+	Mip::MipOptions Options;
+	{
+		Options.Filter		= Mip::MipFilterBox;
+		Options.MaxLevels	= 2;
+	}
+
+	Mip::CMipChain Chain;
+	{
+		CHECK(Chain.Generate(Source, Options));
+		CHECK(Chain.GetNumLevels() == 2);
+	}
+
+	const Mip::MipLevel & Level = Chain.GetLevel(1);
+
+	CHECK(Level.Width == Width / 2 && Level.Height == Height / 2);
+
+	for (Uint32 Y = 0; Y < Level.Height; ++Y)
+	{
+		for (Uint32 X = 0; X < Level.Width; ++X)
+		{
+			for (Uint32 C = 0; C < 4; ++C)
+			{
+				Float Expected = 0.0f;
+
+				for (Uint32 N = 0; N < 4; ++N)
+				{
+					Expected += Pixels[((static_cast<size_t>(Y) * 2 + N / 2) * Width + X * 2 + N % 2) * 4 + C] * 0.25f;
+				}
+
+				CHECK(std::fabs(Level.Pixels[(static_cast<size_t>(Y) * Level.Width + X) * 4 + C] - Expected) < 1e-5f);
+			}
+		}
+	}
+}
+
+TEST_CASE(KaiserFilterKeepsConstantImage)
+{
+	constexpr Uint32 Width	= 100;
+	constexpr Uint32 Height	= 60;
+
+	BC::ImageRGBA32F Source;
+
+	TVector<Float> Pixels = CreateImage(Width, Height, Source);
+	{
+		std::fill(Pixels.begin(), Pixels.end(), 0.75f);
+	}
+
+	Mip::CMipChain Chain;
+	{
+		CHECK(Chain.Generate(Source, Mip::MipOptions()));
+	}
+
+	for (Uint32 Level = 1; Level < Chain.GetNumLevels(); ++Level)
+	{
+		for (const Float Value : Chain.GetLevel(Level).Pixels)
+		{
+			CHECK(std::fabs(Value - 0.75f) < 1e-5f);
+		}
+	}
+}
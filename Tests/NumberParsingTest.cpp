@@ -0,0 +1,575 @@
+#include "TestHarness.h"
+
+#include "Utils/Parsing/NumberParsing.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+using namespace Parsing;
+
+// The C runtime is the reference, every parse has to match it bit for bit
+// and stop at the same character. Inputs come from random bit patterns
+// printed in several notations and from random digit strings, the latter
+// reach the long mantissas and far exponents of the fallback path.
+
+namespace
+{
+	template<class Type> struct FloatReference;
+
+	template<> struct FloatReference<double>
+	{
+		typedef Uint64 BitsType;
+
+		static double Parse(const char * Text, char ** End)
+		{
+			return std::strtod(Text, End);
+		}
+	};
+
+	template<> struct FloatReference<float>
+	{
+		typedef Uint32 BitsType;
+
+		static float Parse(const char * Text, char ** End)
+		{
+			return std::strtof(Text, End);
+		}
+	};
+
+	template<class Type> typename FloatReference<Type>::BitsType GetBits(const Type Value)
+	{
+		typename FloatReference<Type>::BitsType Bits;
+		{
+			std::memcpy(&Bits, &Value, sizeof(Bits));
+		}
+
+		return Bits;
+	}
+
+	template<class Type> Type FromBits(const typename FloatReference<Type>::BitsType Bits)
+	{
+		Type Value;
+		{
+			std::memcpy(&Value, &Bits, sizeof(Value));
+		}
+
+		return Value;
+	}
+
+	// Parses the whole text with both and compares the value and the end.
+
+	template<class Type> bool MatchesReference(const String & Text)
+	{
+		char * ReferenceEnd;
+
+		const Type Reference = FloatReference<Type>::Parse(Text.c_str(), &ReferenceEnd);
+
+		Type Value = 0;
+
+		const char * End = ParseFloat(Text.data(), Text.data() + Text.size(), Value);
+
+		if (ReferenceEnd == Text.c_str())
+		{
+			return End == NULL;
+		}
+
+		if (End != ReferenceEnd)
+		{
+			return false;
+		}
+
+		if (std::isnan(Reference))
+		{
+			return std::isnan(Value);
+		}
+
+		return GetBits(Value) == GetBits(Reference);
+	}
+
+	template<class Type> String Print(const char * Format, const int Precision, const Type Value)
+	{
+		char Buffer[512];
+		{
+			std::snprintf(Buffer, sizeof(Buffer), Format, Precision, static_cast<double>(Value));
+		}
+
+		return Buffer;
+	}
+
+	// Digits with an optional sign, point and exponent, up to 40 digits long.
+
+	String CreateDecimal(std::mt19937_64 & Random)
+	{
+		std::uniform_int_distribution<Uint32> Count(1, 40);
+		std::uniform_int_distribution<Uint32> Digit(0, 9);
+		std::uniform_int_distribution<Int32> Power(-360, 360);
+		std::uniform_int_distribution<Uint32> Choice(0, 7);
+
+		String Text;
+
+		if (Choice(Random) == 0)
+		{
+			Text += Choice(Random) < 4 ? '-' : '+';
+		}
+
+		const Uint32 NumDigits	= Count(Random) % (Choice(Random) < 6 ? 20 : 40) + 1;
+		const Uint32 Point		= Choice(Random) < 5 ? Count(Random) % (NumDigits + 1) : NumDigits + 1;
+
+		for (Uint32 N = 0; N < NumDigits; ++N)
+		{
+			if (N == Point)
+			{
+				Text += '.';
+			}
+
+			Text += static_cast<char>('0' + Digit(Random));
+		}
+
+		if (Point == NumDigits)
+		{
+			Text += '.';
+		}
+
+		if (Choice(Random) < 5)
+		{
+			Text += Choice(Random) < 4 ? 'e' : 'E';
+
+			if (Choice(Random) < 4)
+			{
+				Text += Choice(Random) < 6 ? '-' : '+';
+			}
+
+			Text += std::to_string(std::abs(Power(Random)));
+		}
+
+		return Text;
+	}
+
+	template<class Type> void FuzzAgainstReference(const Uint32 NumValues)
+	{
+		typedef typename FloatReference<Type>::BitsType BitsType;
+
+		std::mt19937_64 Random(static_cast<Uint64>(sizeof(Type)) * 7919);
+		std::uniform_int_distribution<int> Precision(0, 24);
+
+		for (Uint32 N = 0; N < NumValues; ++N)
+		{
+			const Type Value = FromBits<Type>(static_cast<BitsType>(Random()));
+
+			CHECK(MatchesReference<Type>(Print("%.*e", Precision(Random), Value)));
+			CHECK(MatchesReference<Type>(Print("%.*g", Precision(Random), Value)));
+			CHECK(MatchesReference<Type>(CreateDecimal(Random)));
+		}
+	}
+
+	// Significant digits of a formatted value.
+
+	size_t CountDigits(const String & Text)
+	{
+		String Digits;
+
+		for (const char Character : Text.substr(0, Text.find('e')))
+		{
+			if (Character >= '0' && Character <= '9')
+			{
+				Digits += Character;
+			}
+		}
+
+		const size_t First	= Digits.find_first_not_of('0');
+		const size_t Last	= Digits.find_last_not_of('0');
+
+		return First == String::npos ? 1 : Last - First + 1;
+	}
+
+	// Parses back to the value and no text with one digit less does.
+
+	template<class Type> void CheckShortest(const Type Value)
+	{
+		const String Text = FormatFloat(Value);
+
+		CHECK(Text.size() <= MaxFloatLength);
+
+		Type Parsed;
+
+		CHECK(TryParse(Text, Parsed));
+		CHECK(GetBits(Parsed) == GetBits(Value));
+
+		const size_t NumDigits = CountDigits(Text);
+
+		if (NumDigits > 1)
+		{
+			const String Shorter = Print("%.*e", static_cast<int>(NumDigits) - 2, Value);
+
+			CHECK(FloatReference<Type>::Parse(Shorter.c_str(), NULL) != Value);
+		}
+	}
+
+	template<class Type> bool ParsesTo(const char * Text, const Type Expected)
+	{
+		Type Value;
+		{
+			return TryParse(StringView(Text), Value) && Value == Expected;
+		}
+	}
+
+	template<class Type> bool Rejects(const char * Text)
+	{
+		Type Value;
+		{
+			return !TryParse(StringView(Text), Value);
+		}
+	}
+}
+
+TEST_CASE(FloatsMatchStrtod)
+{
+	// Halfway cases, the extremes of both types and the inputs that broke other parsers.
+
+	static const char * Cases[] =
+	{
+		"0", "-0", "+0.0", "0e999999", "1", ".5", "5.", "1e", "1e+", "1.5E-3x", "00000000000000000000000000001",
+		"9007199254740992", "9007199254740993", "9007199254740993.0000000001", "9007199254740994", "9007199254740995",
+		"1.00000000000000011102230246251565404236316680908203125",
+		"1.00000000000000011102230246251565404236316680908203124",
+		"1.00000000000000011102230246251565404236316680908203126",
+		"2.2250738585072011e-308", "2.2250738585072012e-308", "2.2250738585072014e-308",
+		"4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400",
+		"1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309",
+		"3.4028234663852886e38", "3.4028235677973366e38", "1.4012984643e-45", "7.006492321624085e-46",
+		"16777217", "16777217.000000001", "33554435", "8.589973e9", "0.1", "0.2", "0.3", "123456789012345678901234567890",
+		"7.2057594037927933e16", "3.0517578125e-5", "1448997445238699", "0.000000000000000000000000000000000000000001e40",
+		"inf", "-Infinity", "INFINITY", "infin", "nan", "-NaN", "na", "-", "+", ".", "e5", ""
+	};
+
+	for (const char * Case : Cases)
+	{
+		CHECK(MatchesReference<double>(Case));
+		CHECK(MatchesReference<float>(Case));
+	}
+
+	FuzzAgainstReference<double>(200000);
+	FuzzAgainstReference<float>(200000);
+}
+
+TEST_CASE(FloatsRoundTrip)
+{
+	CHECK(FormatFloat(0.1) == "0.1");
+	CHECK(FormatFloat(0.1f) == "0.1");
+	CHECK(FormatFloat(1.0) == "1");
+	CHECK(FormatFloat(-0.0) == "-0");
+	CHECK(FormatFloat(100.0) == "100");
+	CHECK(FormatFloat(1.0 / 3.0) == "0.3333333333333333");
+	CHECK(FormatFloat(1.0f / 3.0f) == "0.33333334");
+	CHECK(FormatFloat(5e-324) == "5e-324");
+	CHECK(FormatFloat(std::numeric_limits<double>::infinity()) == "inf");
+	CHECK(FormatFloat(-std::numeric_limits<float>::infinity()) == "-inf");
+	CHECK(FormatFloat(std::numeric_limits<double>::quiet_NaN()) == "nan");
+
+	// The notation switches at the exponent bounds.
+
+	CHECK(FormatFloat(1e-5) == "0.00001");
+	CHECK(FormatFloat(1e16) == "10000000000000000");
+	CHECK(CountDigits(FormatFloat(1e-6)) == 1 && FormatFloat(1e-6).find('e') != String::npos);
+	CHECK(CountDigits(FormatFloat(1e17)) == 1 && FormatFloat(1e17).find('e') != String::npos);
+
+	CheckShortest(std::numeric_limits<double>::max());
+	CheckShortest(std::numeric_limits<double>::min());
+	CheckShortest(std::numeric_limits<double>::denorm_min());
+	CheckShortest(std::numeric_limits<float>::max());
+	CheckShortest(std::numeric_limits<float>::min());
+	CheckShortest(std::numeric_limits<float>::denorm_min());
+
+	std::mt19937_64 Random(31);
+
+	for (Uint32 N = 0; N < 200000; ++N)
+	{
+		const double Double	= FromBits<double>(Random());
+		const float Single	= FromBits<float>(static_cast<Uint32>(Random()));
+
+		if (std::isfinite(Double))
+		{
+			CheckShortest(Double);
+		}
+
+		if (std::isfinite(Single))
+		{
+			CheckShortest(Single);
+		}
+	}
+
+	// Every float of a few binades near one, where the shortest text is hardest.
+
+	for (Uint32 Bits = 0x3F000000; Bits < 0x3F000000 + (1 << 21); Bits += 3)
+	{
+		CheckShortest(FromBits<float>(Bits));
+	}
+}
+
+TEST_CASE(IntegerBounds)
+{
+	CHECK(ParsesTo<Int64>("9223372036854775807", std::numeric_limits<Int64>::max()));
+	CHECK(ParsesTo<Int64>("-9223372036854775808", std::numeric_limits<Int64>::min()));
+	CHECK(ParsesTo<Int64>("+0000000000000000000000000000042", 42));
+	CHECK(Rejects<Int64>("9223372036854775808"));
+	CHECK(Rejects<Int64>("-9223372036854775809"));
+	CHECK(Rejects<Int64>("18446744073709551616"));
+
+	CHECK(ParsesTo<Uint64>("18446744073709551615", std::numeric_limits<Uint64>::max()));
+	CHECK(ParsesTo<Uint64>("09999999999999999999", 9999999999999999999ULL));
+	CHECK(Rejects<Uint64>("18446744073709551616"));
+	CHECK(Rejects<Uint64>("99999999999999999999"));
+	CHECK(Rejects<Uint64>("184467440737095516150"));
+	CHECK(Rejects<Uint64>("-1"));
+	CHECK(Rejects<Uint64>("-0"));
+
+	CHECK(ParsesTo<Int32>("2147483647", std::numeric_limits<Int32>::max()));
+	CHECK(ParsesTo<Int32>("-2147483648", std::numeric_limits<Int32>::min()));
+	CHECK(Rejects<Int32>("2147483648"));
+	CHECK(Rejects<Int32>("-2147483649"));
+	CHECK(ParsesTo<Uint32>("4294967295", std::numeric_limits<Uint32>::max()));
+	CHECK(Rejects<Uint32>("4294967296"));
+
+	CHECK(ParsesTo<Int16>("-32768", std::numeric_limits<Int16>::min()));
+	CHECK(Rejects<Int16>("32768"));
+	CHECK(ParsesTo<Uint16>("65535", std::numeric_limits<Uint16>::max()));
+	CHECK(Rejects<Uint16>("65536"));
+	CHECK(ParsesTo<Int8>("-128", std::numeric_limits<Int8>::min()));
+	CHECK(Rejects<Int8>("128"));
+	CHECK(ParsesTo<Uint8>("255", std::numeric_limits<Uint8>::max()));
+	CHECK(Rejects<Uint8>("256"));
+
+	// Nothing but a sign, signs twice, trailing garbage.
+
+	CHECK(Rejects<Int64>(""));
+	CHECK(Rejects<Int64>("-"));
+	CHECK(Rejects<Int64>("--1"));
+	CHECK(Rejects<Int64>("1 "));
+	CHECK(Rejects<Uint64>("+"));
+
+	// Random lengths around the limit against the C runtime.
+
+	std::mt19937_64 Random(5);
+	std::uniform_int_distribution<Uint32> Length(1, 22);
+	std::uniform_int_distribution<Uint32> Digit(0, 9);
+
+	for (Uint32 N = 0; N < 200000; ++N)
+	{
+		String Text = N % 2 ? "-" : "";
+
+		for (Uint32 Count = Length(Random); Count > 0; --Count)
+		{
+			Text += static_cast<char>('0' + Digit(Random));
+		}
+
+		errno = 0;
+
+		const long long Reference = std::strtoll(Text.c_str(), NULL, 10);
+
+		Int64 Value;
+
+		if (errno == ERANGE)
+		{
+			CHECK(!TryParse(Text, Value));
+		}
+		else
+		{
+			CHECK(TryParse(Text, Value) && Value == Reference);
+		}
+
+		if (N % 2)
+		{
+			continue;
+		}
+
+		errno = 0;
+
+		const unsigned long long UnsignedReference = std::strtoull(Text.c_str(), NULL, 10);
+
+		Uint64 UnsignedValue;
+
+		if (errno == ERANGE)
+		{
+			CHECK(!TryParse(Text, UnsignedValue));
+		}
+		else
+		{
+			CHECK(TryParse(Text, UnsignedValue) && UnsignedValue == UnsignedReference);
+		}
+	}
+}
+
+TEST_CASE(ScanningAndLists)
+{
+	// Matches on either side of the 16 byte steps.
+
+	for (size_t Length = 0; Length < 70; ++Length)
+	{
+		for (size_t Position = 0; Position <= Length; ++Position)
+		{
+			String Text(Length, 'x');
+			String Spaces(Length, ' ');
+
+			if (Position < Length)
+			{
+				Text[Position]		= "\t\r\n "[Position % 4];
+				Spaces[Position]	= 'x';
+			}
+
+			const char * First	= Text.data();
+			const char * Last	= First + Length;
+
+			CHECK(FindWhitespace(First, Last) == First + Position);
+			CHECK(FindCharacter(First, Last, Position < Length ? Text[Position] : ',') == First + Position);
+			CHECK(SkipWhitespace(Spaces.data(), Spaces.data() + Length) == Spaces.data() + Position);
+		}
+	}
+
+	const String Text = " 1.5\t-2e3\r\n 0x 7";
+
+	float Values[3];
+
+	CHECK(ParseList(Text.data(), Text.data() + Text.size(), Values, 3) == Text.data() + 13);
+	CHECK(Values[0] == 1.5f && Values[1] == -2000.0f && Values[2] == 0.0f);
+
+	// Only the last number may be followed by something other than whitespace.
+
+	CHECK(ParseList(Text.data(), Text.data() + Text.size(), Values, 4) == NULL);
+}
+
+BENCHMARK_CASE(BenchmarkNumberParsing)
+{
+	constexpr Uint32 NumValues = 1 << 20;
+
+	// Typical asset text, short vertex data and full precision values.
+
+	std::mt19937_64 Random(11);
+	std::uniform_real_distribution<double> Position(-1000.0, 1000.0);
+	std::uniform_int_distribution<Int64> Index(0, 1 << 24);
+
+	String Floats;
+	String Integers;
+
+	TVector<double> Doubles(NumValues);
+
+	for (Uint32 N = 0; N < NumValues; ++N)
+	{
+		Doubles[N] = Position(Random);
+
+		Floats		+= Print("%.*g", N % 4 ? 6 : 17, Doubles[N]) + ' ';
+		Integers	+= std::to_string(Index(Random)) + ' ';
+	}
+
+	double Checksum = 0.0;
+
+	const auto Run = [&](const char * Name, const String & Text, auto && Parse)
+	{
+		const double Seconds = Test::Measure(5, [&]
+		{
+			const char * First	= Text.data();
+			const char * Last	= First + Text.size();
+
+			while ((First = SkipWhitespace(First, Last)) != Last)
+			{
+				First = Parse(First, Last, Checksum);
+			}
+		});
+
+		Test::Report(Name, NumValues / Seconds / 1e6, "M/s");
+
+		return Seconds;
+	};
+
+	const double ReferenceFloatSeconds = Run("strtod", Floats, [](const char * First, const char * Last, double & Sum)
+	{
+		char * End;
+		{
+			Sum += std::strtod(First, &End);
+		}
+
+		return static_cast<const char *>(End);
+	});
+
+	Run("istringstream", Floats, [](const char * First, const char * Last, double & Sum)
+	{
+		const char * End = FindWhitespace(First, Last);
+
+		std::istringstream Stream(String(First, End));
+
+		double Value = 0.0;
+		{
+			Stream >> Value;
+		}
+
+		Sum += Value;
+
+		return End;
+	});
+
+	const double FloatSeconds = Run("ParseFloat", Floats, [](const char * First, const char * Last, double & Sum)
+	{
+		double Value;
+
+		const char * End = ParseFloat(First, Last, Value);
+		{
+			Sum += Value;
+		}
+
+		return End;
+	});
+
+	Test::Report("Float speedup", ReferenceFloatSeconds / FloatSeconds, "x");
+
+	const double ReferenceIntegerSeconds = Run("strtoll", Integers, [](const char * First, const char * Last, double & Sum)
+	{
+		char * End;
+		{
+			Sum += static_cast<double>(std::strtoll(First, &End, 10));
+		}
+
+		return static_cast<const char *>(End);
+	});
+
+	const double IntegerSeconds = Run("ParseInteger", Integers, [](const char * First, const char * Last, double & Sum)
+	{
+		Int64 Value;
+
+		const char * End = ParseInteger(First, Last, Value);
+		{
+			Sum += static_cast<double>(Value);
+		}
+
+		return End;
+	});
+
+	Test::Report("Integer speedup", ReferenceIntegerSeconds / IntegerSeconds, "x");
+
+	char Buffer[MaxFloatLength + 8];
+
+	size_t Length = 0;
+
+	const double ReferenceFormatSeconds = Test::Measure(5, [&]
+	{
+		for (const double Value : Doubles)
+		{
+			Length += std::snprintf(Buffer, sizeof(Buffer), "%.17g", Value);
+		}
+	});
+
+	const double FormatSeconds = Test::Measure(5, [&]
+	{
+		for (const double Value : Doubles)
+		{
+			Length += FormatFloat(Value, Buffer) - Buffer;
+		}
+	});
+
+	Test::Report("snprintf %.17g", NumValues / ReferenceFormatSeconds / 1e6, "M/s");
+	Test::Report("FormatFloat", NumValues / FormatSeconds / 1e6, "M/s");
+	Test::Report("Checksum", Checksum + static_cast<double>(Length), "");
+}
@@ -0,0 +1,252 @@
+#include "TestHarness.h"
+
+#include "Scene/Object/ObjectBatch.h"
+
+#include <cmath>
+
+using namespace D3D;
+
+// Builds instance batches on the CPU only, nothing is uploaded.
+
+namespace
+{
+	struct KMaterialTest : public KMaterialStatic
+	{
+		KMaterialTest() :
+			KMaterialStatic(NULL, NULL)
+		{}
+
+		virtual void FreeComponents() override
+		{}
+	};
+
+	InstanceTransform CreateTransform(const Float X, const Float Y, const Uint32 ObjectId)
+	{
+		InstanceTransform Transform;
+		{
+			Transform.Position	= Vector3f(X, Y, 0.0f);
+			Transform.Rotation	= Vector3f(0.0f, 0.0f, X * 0.001f);
+			Transform.Scale		= 1.0f + Y * 0.001f;
+			Transform.ObjectId	= ObjectId;
+		}
+
+		return Transform;
+	}
+
+	// Two quads, the first one of material zero and the second one of material one.
+
+	void CreateMesh(KStaticMesh & Mesh, KMesh & Model, KMaterialTest (&Materials)[2])
+	{
+		const Vector3f Positions[] =
+		{
+			Vector3f(0.0f, 0.0f, 0.0f), Vector3f(1.0f, 0.0f, 0.0f), Vector3f(1.0f, 1.0f, 0.0f), Vector3f(0.0f, 1.0f, 0.0f)
+		};
+
+		const int32_t Wedges[] = { 0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 2, 3 };
+
+		Model.VertexPositions.assign(std::begin(Positions), std::end(Positions));
+		Model.WedgeIndices.assign(std::begin(Wedges), std::end(Wedges));
+		Model.FaceMaterialIndices = { 0, 0, 1, 1 };
+
+		KStaticMeshSourceModel Source = {};
+		{
+			Source.Mesh = &Model;
+		}
+
+		Mesh.SourceModels.push_back(Source);
+		Mesh.StaticMaterials = { &Materials[0], &Materials[1] };
+	}
+}
+
+TEST_CASE(BatchKeySortsMaterialFirst)
+{
+	const InstanceBatchKey Key = { InstanceBatchKey::Create(0x123456, 0x42, 0xABCDEF) };
+
+	CHECK(Key.GetMesh() == 0x123456);
+	CHECK(Key.GetLod() == 0x42);
+	CHECK(Key.GetMaterial() == 0xABCDEF);
+
+	// The material outweighs the mesh, the mesh outweighs the lod.
+
+	CHECK(InstanceBatchKey::Create(InstanceBatchKey::MaxMeshes - 1, 0, 0) < InstanceBatchKey::Create(0, 0, 1));
+	CHECK(InstanceBatchKey::Create(0, InstanceBatchKey::MaxLods - 1, 0) < InstanceBatchKey::Create(1, 0, 0));
+}
+
+TEST_CASE(InstancesGroupIntoBatches)
+{
+	CInstanceBatchBuilder::InitializeOptions Options;
+	{
+		Options.ParallelSortThreshold = 64;
+	}
+
+	CInstanceBatchBuilder Builder(Options);
+
+	int MeshA;
+	int MeshB;
+	int Material;
+
+	const Uint32 IdA		= Builder.RegisterMesh(&MeshA);
+	const Uint32 IdB		= Builder.RegisterMesh(&MeshB);
+	const Uint32 IdMaterial	= Builder.RegisterMaterial(&Material);
+
+	CHECK(Builder.RegisterMesh(&MeshA) == IdA);
+	CHECK(Builder.RegisterMaterial(&Material) == IdMaterial);
+	CHECK(Builder.GetMaterial(IdMaterial) == &Material);
+
+	// Interleaved over two meshes and two lods, enough to take the parallel sort.
+
+	for (Uint32 N = 0; N < 256; ++N)
+	{
+		Builder.AddInstance(N % 2 ? IdB : IdA, (N / 2) % 2, IdMaterial, CreateTransform(static_cast<Float>(N), 0.0f, N));
+	}
+
+	Builder.Build();
+
+	const TVector<InstanceBatch> & Batches = Builder.GetBatches();
+
+	CHECK(Batches.size() == 4);
+	CHECK(Builder.GetInstances().size() == 256);
+
+	Uint32 FirstInstance = 0;
+
+	for (size_t N = 0; N < Batches.size(); ++N)
+	{
+		const InstanceBatch & Batch = Batches[N];
+
+		CHECK(Batch.FirstInstance == FirstInstance);
+		CHECK(Batch.NumInstances == 64);
+		CHECK(N == 0 || Batches[N - 1].Key < Batch.Key);
+
+		// Instances of a batch keep the order they were added in.
+
+		for (Uint32 Instance = 0; Instance < Batch.NumInstances; ++Instance)
+		{
+			const InstanceTransform & Transform = Builder.GetInstances()[Batch.FirstInstance + Instance];
+
+			CHECK((Transform.ObjectId % 2 ? IdB : IdA) == Batch.Key.GetMesh());
+			CHECK((Transform.ObjectId / 2) % 2 == Batch.Key.GetLod());
+			CHECK(Instance == 0 || Builder.GetInstances()[Batch.FirstInstance + Instance - 1].ObjectId < Transform.ObjectId);
+		}
+
+		FirstInstance += Batch.NumInstances;
+	}
+
+	Builder.Reset();
+	Builder.Build();
+
+	CHECK(Builder.GetBatches().empty());
+	CHECK(Builder.GetMaterial(IdMaterial) == &Material);
+}
+
+TEST_CASE(QuantizedInstancesRoundTrip)
+{
+	CInstanceBatchBuilder::InitializeOptions Options;
+	{
+		Options.QuantizePositions = true;
+	}
+
+	CInstanceBatchBuilder Builder(Options);
+
+	int Mesh;
+	int Material;
+
+	const Uint32 IdMesh		= Builder.RegisterMesh(&Mesh);
+	const Uint32 IdMaterial	= Builder.RegisterMaterial(&Material);
+
+	// Object ids are handle values, they do not fit in 16 bits.
+
+	for (Uint32 N = 0; N < 100; ++N)
+	{
+		Builder.AddInstance(IdMesh, 0, IdMaterial, CreateTransform(N * 10.0f - 500.0f, N * 3.0f, 0x12340000 + N));
+	}
+
+	Builder.Build();
+
+	const InstanceBatch & Batch = Builder.GetBatches()[0];
+
+	CHECK(Builder.GetInstancesQuantized().size() == 100);
+
+	const Float Tolerance = Batch.BoundsExtent.X / 65535.0f + 1e-3f;
+
+	for (Uint32 N = 0; N < 100; ++N)
+	{
+		const InstanceTransform & Source = Builder.GetInstances()[N];
+
+		InstanceTransform Result;
+		{
+			CInstanceBatchBuilder::Dequantize(Builder.GetInstancesQuantized()[N], Batch, Result);
+		}
+
+		CHECK(Result.ObjectId == Source.ObjectId);
+		CHECK(std::abs(Result.Position.X - Source.Position.X) <= Tolerance);
+		CHECK(std::abs(Result.Position.Y - Source.Position.Y) <= Tolerance);
+		CHECK(std::abs(Result.Position.Z - Source.Position.Z) <= Tolerance);
+		CHECK(std::abs(Result.Rotation.Z - Source.Rotation.Z) <= 2.0f * PI / 65535.0f);
+		CHECK(std::abs(Result.Scale - Source.Scale) <= Batch.ScaleMax / 65535.0f);
+	}
+}
+
+TEST_CASE(CommandsSplitAtMaterials)
+{
+	KMaterialTest Materials[2];
+
+	KMesh		Model;
+	KStaticMesh	Mesh = {};
+
+	CreateMesh(Mesh, Model, Materials);
+
+	CInstanceBatchBuilder Builder;
+
+	const Uint32 IdMesh = Builder.RegisterMesh(&Mesh);
+
+	Builder.AddMeshGeometry(IdMesh, 0, Mesh);
+
+	CHECK(Builder.HasMeshGeometry(IdMesh, 0));
+	CHECK(Builder.GetGeometryVertices().size() == 12);
+	CHECK(Builder.GetGeometryIndices().size() == 12);
+
+	const Uint32 IdMaterials[2] =
+	{
+		Builder.RegisterMaterial(&Materials[0]),
+		Builder.RegisterMaterial(&Materials[1])
+	};
+
+	const InstanceMeshRange * Ranges[2] =
+	{
+		Builder.GetMeshRange(IdMesh, 0, IdMaterials[0]),
+		Builder.GetMeshRange(IdMesh, 0, IdMaterials[1])
+	};
+
+	CHECK(Ranges[0] && Ranges[0]->IndexCount == 6);
+	CHECK(Ranges[1] && Ranges[1]->IndexCount == 6);
+	CHECK(Ranges[0]->StartIndex != Ranges[1]->StartIndex);
+
+	// The second lod has no geometry, its instances are batched but not drawn.
+
+	for (Uint32 N = 0; N < 3; ++N)
+	{
+		Builder.AddInstance(IdMesh, 0, IdMaterials[1], CreateTransform(0.0f, 0.0f, N));
+		Builder.AddInstance(IdMesh, 0, IdMaterials[0], CreateTransform(0.0f, 0.0f, N));
+		Builder.AddInstance(IdMesh, 1, IdMaterials[0], CreateTransform(0.0f, 0.0f, N));
+	}
+
+	Builder.Build();
+
+	TVector<D3D12_DRAW_INDEXED_ARGUMENTS>	Commands;
+	TVector<InstanceMaterialRange>			MaterialRanges;
+
+	CHECK(Builder.GetBatches().size() == 3);
+	CHECK(Builder.EmitCommands(Commands, &MaterialRanges) == 2);
+
+	CHECK(MaterialRanges.size() == 2);
+	CHECK(MaterialRanges[0].Material == IdMaterials[0]);
+	CHECK(MaterialRanges[0].FirstCommand == 0 && MaterialRanges[0].NumCommands == 1);
+	CHECK(MaterialRanges[1].Material == IdMaterials[1]);
+	CHECK(MaterialRanges[1].FirstCommand == 1 && MaterialRanges[1].NumCommands == 1);
+
+	CHECK(Commands[0].InstanceCount == 3);
+	CHECK(Commands[0].IndexCountPerInstance == Ranges[0]->IndexCount);
+	CHECK(Commands[0].StartIndexLocation == Ranges[0]->StartIndex);
+	CHECK(Commands[1].StartIndexLocation == Ranges[1]->StartIndex);
+	CHECK(Commands[1].StartInstanceLocation == Commands[0].StartInstanceLocation + 6);
+}
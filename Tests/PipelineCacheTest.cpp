@@ -0,0 +1,380 @@
+#include "TestHarness.h"
+
+#include "Utils/Shader/PipelineCache.h"
+#include "Utils/File/File.h"
+
+using namespace PipelineCache;
+
+// Builds descriptions from made up sub-states, no device is involved.
+// Blobs are arbitrary bytes standing in for driver pipeline blobs.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	enum EStateKind
+	{
+		StateBlend,
+		StateRasterizer
+	};
+
+	class CCacheDirectory
+	{
+	private:
+
+		Filesystem::path Root;
+
+	public:
+
+		CCacheDirectory()
+		{
+			static Uint32 Counter = 0;
+
+			Root = Filesystem::temp_directory_path() / ("PipelineCacheTest" + std::to_string(Counter++));
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+		}
+
+		~CCacheDirectory()
+		{
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+		}
+
+		CPipelineCache::InitializeOptions GetOptions(const Uint64 DeviceHash = 1) const
+		{
+			CPipelineCache::InitializeOptions Options;
+			{
+				Options.Directory	= WString(Root.wstring());
+				Options.DeviceHash	= DeviceHash;
+			}
+
+			return Options;
+		}
+
+		TVector<Byte> Read() const
+		{
+			TVector<Byte> Content;
+
+			File::CFile Input(WString((Root / "Pipelines.bin").wstring()));
+			{
+				CHECK(Input.ReadFileContentInto(Content) == File::ErrorNone);
+			}
+
+			return Content;
+		}
+
+		void Write(const TVector<Byte> & Content) const
+		{
+			File::CFile Output(WString((Root / "Pipelines.bin").wstring()));
+			{
+				Output.GetContentRef() = Content;
+			}
+
+			CHECK(Output.WriteFileContent() == File::ErrorNone);
+
+			Output.Close();
+		}
+	};
+
+	StateHandle InternBlend(CPipelineCache & Cache, const bool Enabled, const char * Name)
+	{
+		CStateWriter Writer;
+		{
+			Writer.Append(Enabled).Append(0.5f).Append(Name);
+		}
+
+		return Cache.Intern(StateBlend, Writer);
+	}
+
+	StateHandle InternRasterizer(CPipelineCache & Cache, const Int32 DepthBias)
+	{
+		CStateWriter Writer;
+		{
+			Writer.Append(DepthBias).Append(static_cast<Uint8>(3));
+		}
+
+		return Cache.Intern(StateRasterizer, Writer);
+	}
+
+	PipelineDescription CreateDescription(CPipelineCache & Cache, const Int32 DepthBias, const Uint64 Shader)
+	{
+		PipelineDescription Description;
+		{
+			Description.Type	= 1;
+			Description.States	= { InternBlend(Cache, true, "Opaque"), InternRasterizer(Cache, DepthBias) };
+			Description.Shaders	= { Shader, 0 };
+			Description.Fixed	= { 28, 0, 0, 0, 4 };
+		}
+
+		return Description;
+	}
+
+	// Requests a description and stores a blob made from its key when none was loaded.
+
+	bool RequestBlob(CPipelineCache & Cache, const PipelineDescription & Description, TVector<Byte> & Blob)
+	{
+		const Hash128 Key = Cache.GetKey(Description);
+
+		if (Cache.Request(Key, Description, Blob))
+		{
+			return true;
+		}
+
+		Cache.SetBlob(Key, TVector<Byte>(static_cast<size_t>(Key.Low % 64) + 1, static_cast<Byte>(Key.High)));
+
+		return false;
+	}
+}
+
+TEST_CASE(PipelineKeysAreStable)
+{
+	CCacheDirectory Directory;
+
+	CPipelineCache First;
+	CPipelineCache Second;
+
+	CHECK(First.Initialize(Directory.GetOptions()));
+	CHECK(Second.Initialize(Directory.GetOptions()));
+
+	// Handles differ between the caches, the keys do not.
+
+	InternRasterizer(Second, 7);
+	InternBlend(Second, false, "Other");
+
+	const PipelineDescription A = CreateDescription(First, 2, 0x1234);
+	const PipelineDescription B = CreateDescription(Second, 2, 0x1234);
+
+	CHECK(A.States != B.States);
+	CHECK(First.GetKey(A) == Second.GetKey(B));
+	CHECK(First.GetKey(A) == First.GetKey(A));
+
+	// The encoding is little endian and field by field, the key is the same on every
+	// platform and build. A change here invalidates every cache file out there.
+
+	CHECK(First.GetKey(A).Low == 0xAA51F196DB9CC444ULL);
+	CHECK(First.GetKey(A).High == 0x5745279BC31F60E7ULL);
+
+	// Equal states share a handle, equal content of another kind does not.
+
+	CHECK(InternBlend(First, true, "Opaque") == A.States[0]);
+	CHECK(InternBlend(First, true, NULL) == InternBlend(First, true, ""));
+
+	CStateWriter Writer;
+	{
+		Writer.Append(static_cast<Int32>(2)).Append(static_cast<Uint8>(3));
+	}
+
+	CHECK(First.Intern(StateBlend, Writer) != A.States[1]);
+	CHECK(First.Intern(StateRasterizer, Writer) == A.States[1]);
+
+	// Every part of the description reaches the key.
+
+	PipelineDescription Changed = A;
+	{
+		Changed.Type = 2;
+	}
+
+	CHECK(First.GetKey(Changed) != First.GetKey(A));
+
+	Changed = A;
+	{
+		std::swap(Changed.States[0], Changed.States[1]);
+	}
+
+	CHECK(First.GetKey(Changed) != First.GetKey(A));
+	CHECK(First.GetKey(CreateDescription(First, 3, 0x1234)) != First.GetKey(A));
+	CHECK(First.GetKey(CreateDescription(First, 2, 0x1235)) != First.GetKey(A));
+
+	Changed = A;
+	{
+		Changed.Fixed.back() = 5;
+	}
+
+	CHECK(First.GetKey(Changed) != First.GetKey(A));
+
+	Changed = A;
+	{
+		Changed.Shaders.pop_back();
+	}
+
+	CHECK(First.GetKey(Changed) != First.GetKey(A));
+}
+
+TEST_CASE(PipelineCacheRoundTrip)
+{
+	CCacheDirectory Directory;
+
+	TVector<TVector<Byte> > Blobs(3);
+
+	{
+		CPipelineCache Cache;
+
+		CHECK(Cache.Initialize(Directory.GetOptions()));
+		CHECK(!Cache.Load());
+
+		for (Int32 N = 0; N < 3; ++N)
+		{
+			CHECK(!RequestBlob(Cache, CreateDescription(Cache, N, 0x1000 + N), Blobs[N]));
+		}
+
+		CHECK(Cache.GetNumRecords() == 3);
+		CHECK(Cache.Save());
+	}
+
+	CPipelineCache Cache;
+
+	CHECK(Cache.Initialize(Directory.GetOptions()));
+	CHECK(Cache.Load());
+	CHECK(Cache.GetNumRecords() == 3);
+
+	// The blend state is shared by every record and stored once.
+
+	CHECK(Cache.GetStats().NumStates == 4);
+
+	for (Int32 N = 0; N < 3; ++N)
+	{
+		const PipelineDescription Description = CreateDescription(Cache, N, 0x1000 + N);
+
+		TVector<Byte> Blob;
+
+		CHECK(RequestBlob(Cache, Description, Blob));
+		CHECK(Blob.size() == Cache.GetKey(Description).Low % 64 + 1);
+	}
+
+	// Saving only what this run used drops the rest.
+
+	CHECK(!RequestBlob(Cache, CreateDescription(Cache, 9, 0x2000), Blobs[0]));
+	CHECK(Cache.Save());
+
+	CPipelineCache Used;
+
+	CHECK(Used.Initialize(Directory.GetOptions()));
+	CHECK(Used.Load());
+	CHECK(Used.GetNumRecords() == 4);
+
+	TVector<Byte> Blob;
+
+	CHECK(RequestBlob(Used, CreateDescription(Used, 9, 0x2000), Blob));
+	CHECK(Used.Save(true));
+
+	CPipelineCache Pruned;
+
+	CHECK(Pruned.Initialize(Directory.GetOptions()));
+	CHECK(Pruned.Load());
+	CHECK(Pruned.GetNumRecords() == 1);
+}
+
+TEST_CASE(PipelineBlobsOfOtherDevicesDropped)
+{
+	CCacheDirectory Directory;
+
+	{
+		CPipelineCache Cache;
+
+		CHECK(Cache.Initialize(Directory.GetOptions(1)));
+
+		TVector<Byte> Blob;
+
+		CHECK(!RequestBlob(Cache, CreateDescription(Cache, 0, 0x1000), Blob));
+		CHECK(Cache.Save());
+	}
+
+	CPipelineCache Cache;
+
+	CHECK(Cache.Initialize(Directory.GetOptions(2)));
+	CHECK(Cache.Load());
+	CHECK(Cache.GetNumRecords() == 1);
+
+	TVector<Byte> Blob;
+
+	CHECK(!RequestBlob(Cache, CreateDescription(Cache, 0, 0x1000), Blob));
+
+	// A blob the driver refuses is not handed out again.
+
+	CHECK(RequestBlob(Cache, CreateDescription(Cache, 0, 0x1000), Blob));
+
+	Cache.RejectBlob(Cache.GetKey(CreateDescription(Cache, 0, 0x1000)));
+
+	CHECK(!Cache.Request(Cache.GetKey(CreateDescription(Cache, 0, 0x1000)), CreateDescription(Cache, 0, 0x1000), Blob));
+	CHECK(Cache.GetStats().NumBlobRejected == 1);
+}
+
+TEST_CASE(PipelineCacheRejectsDamagedFiles)
+{
+	CCacheDirectory Directory;
+
+	{
+		CPipelineCache Cache;
+
+		CHECK(Cache.Initialize(Directory.GetOptions()));
+
+		TVector<Byte> Blob;
+
+		for (Int32 N = 0; N < 4; ++N)
+		{
+			RequestBlob(Cache, CreateDescription(Cache, N, 0x1000), Blob);
+		}
+
+		CHECK(Cache.Save());
+	}
+
+	const TVector<Byte> Saved = Directory.Read();
+
+	auto Load = [&Directory](const TVector<Byte> & Content)
+	{
+		Directory.Write(Content);
+
+		CPipelineCache Cache;
+
+		CHECK(Cache.Initialize(Directory.GetOptions()));
+
+		const bool Loaded = Cache.Load();
+
+		// A rejected file adds nothing.
+
+		CHECK(Loaded || (Cache.GetNumRecords() == 0 && Cache.GetStats().NumStates == 0));
+
+		return Loaded;
+	};
+
+	CHECK(Load(Saved));
+
+	// Magic and version of an older format.
+
+	TVector<Byte> Damaged = Saved;
+	{
+		Damaged[0] ^= 0xFF;
+	}
+
+	CHECK(!Load(Damaged));
+
+	Damaged = Saved;
+	{
+		Damaged[4] = 1;
+	}
+
+	CHECK(!Load(Damaged));
+
+	// Every single flipped bit behind the header and every truncation.
+
+	for (size_t N = 32; N < Saved.size(); N += 7)
+	{
+		Damaged = Saved;
+		{
+			Damaged[N] ^= static_cast<Byte>(1 << (N % 8));
+		}
+
+		CHECK(!Load(Damaged));
+	}
+
+	for (size_t Size = 0; Size < Saved.size(); Size += 5)
+	{
+		CHECK(!Load(TVector<Byte>(Saved.begin(), Saved.begin() + Size)));
+	}
+
+	CHECK(!Load(TVector<Byte>()));
+}
@@ -0,0 +1,276 @@
+#include "TestHarness.h"
+
+#include "Resource/ResourceStream.h"
+
+#include <experimental/filesystem>
+#include <fstream>
+
+using namespace D3D;
+
+// Streams small files from a temporary directory into the null sink, the
+// processors hold on to their read blocks to keep the budget in use.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	class CStreamDirectory
+	{
+	private:
+
+		Filesystem::path Root;
+
+	public:
+
+		CStreamDirectory()
+		{
+			static Uint32 Counter = 0;
+
+			Root = Filesystem::temp_directory_path() / ("ResourceStreamTest" + std::to_string(Counter++));
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+			Filesystem::create_directories(Root, Error);
+		}
+
+		~CStreamDirectory()
+		{
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+		}
+
+		WString Get(const Uint32 Index) const
+		{
+			return WString((Root / ("Stream" + std::to_string(Index) + ".bin")).wstring());
+		}
+
+		// Every byte of the file holds its index.
+
+		WString Write(const Uint32 Index, const size_t Size) const
+		{
+			const WString Path = Get(Index);
+
+			std::ofstream Output(Filesystem::path(Path.c_str()), std::ios::out | std::ios::binary);
+			{
+				const TVector<char> Content(Size, static_cast<char>(Index));
+
+				Output.write(Content.data(), Content.size());
+			}
+
+			return Path;
+		}
+	};
+
+	// Waits until opened, then passes the input through.
+
+	class CGateProcessor : public IResourceStreamProcessor
+	{
+	private:
+
+		TMutex						Mutex;
+		std::condition_variable		Signal;
+
+		bool						Opened = false;
+
+	public:
+
+		TAtomic<Uint32>				NumProcessed;
+
+	public:
+
+		CGateProcessor() :
+			NumProcessed(0)
+		{}
+
+		void Open()
+		{
+			{
+				std::lock_guard<TMutex> Lock(Mutex);
+				{
+					Opened = true;
+				}
+			}
+
+			Signal.notify_all();
+		}
+
+		virtual ErrorCode Process(const ResourceStreamRequest & Request, const ResourceStreamData & Input, TVector<Byte> & Output) override
+		{
+			{
+				std::unique_lock<TMutex> Lock(Mutex);
+
+				Signal.wait(Lock, [this]()
+				{
+					return Opened;
+				});
+			}
+
+			Output.resize(Input.GetSize());
+			Input.CopyTo(Output.data());
+
+			NumProcessed++;
+
+			return S_OK;
+		}
+	};
+
+	// Earlier files take longer, without ordering they would complete last.
+
+	class CDelayProcessor : public IResourceStreamProcessor
+	{
+	public:
+
+		Uint32 NumFiles = 0;
+
+		virtual ErrorCode Process(const ResourceStreamRequest & Request, const ResourceStreamData & Input, TVector<Byte> & Output) override
+		{
+			const Uint32 Index = Input.GetSpan(0).first[0];
+
+			std::this_thread::sleep_for(std::chrono::milliseconds((NumFiles - Index) * 5));
+
+			Output.assign(Input.GetSpan(0).first, Input.GetSpan(0).first + Input.GetSpan(0).second);
+
+			return S_OK;
+		}
+	};
+
+	class CCompletionLog
+	{
+	private:
+
+		TMutex Mutex;
+
+	public:
+
+		TVector<TPair<Uint32, ErrorCode> > Entries;
+
+	public:
+
+		void Add(const Uint32 Index, const ResourceStreamResult & Result)
+		{
+			std::lock_guard<TMutex> Lock(Mutex);
+			{
+				Entries.emplace_back(Index, Result.Status);
+			}
+		}
+	};
+}
+
+TEST_CASE(StreamStallsAtBudget)
+{
+	CStreamDirectory		Directory;
+	CResourceStreamSinkNull	Sink;
+	CGateProcessor			Processor;
+	CCompletionLog			Log;
+
+	CResourceStream::InitializeOptions Options;
+	{
+		Options.BlockSize	= 4096;
+		Options.BudgetBytes	= 4096 * 4;
+		Options.Sink		= &Sink;
+	}
+
+	CResourceStream Stream;
+
+	CHECK(Stream.Initialize(Options) == S_OK);
+
+	// Every request takes two blocks, the budget holds two requests.
+
+	const Uint32 NumFiles = 8;
+
+	for (Uint32 N = 0; N < NumFiles; ++N)
+	{
+		ResourceStreamRequest Request;
+		{
+			Request.Path		= Directory.Write(N, 4096 + 100);
+			Request.Processor	= &Processor;
+			Request.OnComplete	= [&Log, N](const ResourceStreamResult & Result) { Log.Add(N, Result); };
+		}
+
+		Stream.Enqueue(std::move(Request));
+	}
+
+	for (Uint32 Attempt = 0; Attempt < 200 && Stream.GetBytesInFlight() < Options.BudgetBytes; ++Attempt)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	// The reader waits for blocks, nothing more is read while the processors hold them.
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	CHECK(Stream.GetBytesInFlight() == Options.BudgetBytes);
+	CHECK(Processor.NumProcessed == 0);
+	CHECK(Log.Entries.empty());
+
+	Processor.Open();
+	Stream.Flush();
+
+	CHECK(Processor.NumProcessed == NumFiles);
+	CHECK(Stream.GetBytesInFlight() == 0);
+	CHECK(Stream.GetBytesInFlightPeak() == Options.BudgetBytes);
+	CHECK(Sink.GetBytesStaged() == NumFiles * (4096 + 100));
+
+	CHECK(Log.Entries.size() == NumFiles);
+
+	for (Uint32 N = 0; N < Log.Entries.size(); ++N)
+	{
+		CHECK(Log.Entries[N].first == N);
+		CHECK(Log.Entries[N].second == S_OK);
+	}
+
+	Stream.Shutdown();
+}
+
+TEST_CASE(StreamCompletesInOrder)
+{
+	CStreamDirectory		Directory;
+	CResourceStreamSinkNull	Sink;
+	CDelayProcessor			Processor;
+	CCompletionLog			Log;
+
+	CResourceStream::InitializeOptions Options;
+	{
+		Options.BlockSize	= 4096;
+		Options.BudgetBytes	= 4096 * 16;
+		Options.Sink		= &Sink;
+	}
+
+	CResourceStream Stream;
+
+	CHECK(Stream.Initialize(Options) == S_OK);
+
+	const Uint32 NumFiles = 12;
+
+	Processor.NumFiles = NumFiles;
+
+	// Missing files and files over the budget fail on the reader, their
+	// reports still wait for the files enqueued before them.
+
+	for (Uint32 N = 0; N < NumFiles; ++N)
+	{
+		ResourceStreamRequest Request;
+		{
+			Request.Path		= N == 5 ? Directory.Get(N) : Directory.Write(N, N == 8 ? Options.BudgetBytes + 1 : 1000);
+			Request.Processor	= &Processor;
+			Request.OnComplete	= [&Log, N](const ResourceStreamResult & Result) { Log.Add(N, Result); };
+		}
+
+		Stream.Enqueue(std::move(Request));
+	}
+
+	Stream.Flush();
+
+	CHECK(Log.Entries.size() == NumFiles);
+
+	for (Uint32 N = 0; N < Log.Entries.size(); ++N)
+	{
+		CHECK(Log.Entries[N].first == N);
+		CHECK((Log.Entries[N].second == S_OK) == (N != 5 && N != 8));
+	}
+
+	CHECK(Sink.GetBytesStaged() == (NumFiles - 2) * 1000);
+	CHECK(Stream.GetBytesInFlight() == 0);
+}
@@ -0,0 +1,203 @@
+#include "TestHarness.h"
+
+#include "Utils/Database/SQLite.h"
+#include "Utils/Database/ConnectionPool.h"
+
+#include <experimental/filesystem>
+
+using namespace Database::SQLite;
+
+// Loads the object tables of every area from a map database laid out like
+// the game's, once with the id assembled into the SQL text as the loaders
+// used to do, once through the statement cache with a bound parameter, and
+// through connection pools with one and with many readers.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	constexpr Uint32 NumAreas			= 4096;
+	constexpr Uint32 NumTablesPerArea	= 2;
+	constexpr Uint32 TableSize			= 256;
+
+	class CAreaDatabase
+	{
+	private:
+
+		Filesystem::path Path;
+
+	public:
+
+		CDatabase Database;
+
+	public:
+
+		// The file of the previous run is replaced, the open connection keeps it locked until then.
+
+		CAreaDatabase()
+		{
+			Path = Filesystem::temp_directory_path() / "SQLiteBenchmark.db";
+
+			std::error_code Error;
+			{
+				Filesystem::remove(Path, Error);
+			}
+
+			CHECK(Database.OpenDB(Path.string()) == SQLITE_OK);
+
+			DataSet Result;
+
+			Database.Execute("CREATE TABLE ObjectTable (ObjectTableId INTEGER PRIMARY KEY, AreaId INTEGER NOT NULL, Data BLOB NOT NULL)", Result);
+			Database.Execute("CREATE INDEX ObjectTableArea ON ObjectTable (AreaId)", Result);
+			Database.Execute("BEGIN", Result);
+
+			TVector<Byte> Data(TableSize);
+
+			for (Uint32 Area = 0; Area < NumAreas; ++Area)
+			{
+				for (Uint32 Table = 0; Table < NumTablesPerArea; ++Table)
+				{
+					std::fill(Data.begin(), Data.end(), static_cast<Byte>(Area + Table));
+
+					CHECK(Database.ExecutePrepared("INSERT INTO ObjectTable (AreaId, Data) VALUES (?, ?)", Result, Area, Data) == SQLITE_OK);
+				}
+			}
+
+			Database.Execute("COMMIT", Result);
+		}
+
+		// Walks the rows like CSceneArea::Load, the blobs are only summed.
+
+		static Uint64 ReadArea(CCursor && Cursor)
+		{
+			Uint64 Checksum = 0;
+
+			while (Cursor.Next())
+			{
+				const BlobView Data = Cursor.GetRow().GetBlobView(1);
+
+				Checksum += Data.Size + (Data.Size ? Data.Data[0] : 0);
+			}
+
+			CHECK(Cursor.GetErrorCode() == SQLITE_OK);
+
+			return Checksum;
+		}
+	};
+}
+
+BENCHMARK_CASE(BenchmarkAreaQueries)
+{
+	CAreaDatabase Areas;
+
+	Uint64 AssembledChecksum = 0;
+	Uint64 CachedChecksum = 0;
+
+	// Every area has its own SQL text, each query is prepared and the cache only churns.
+
+	const double AssembledSeconds = Test::Measure(3, [&]
+	{
+		AssembledChecksum = 0;
+
+		for (Uint32 Area = 0; Area < NumAreas; ++Area)
+		{
+			const String Query = "SELECT ObjectTableId, Data FROM ObjectTable WHERE AreaId = " + std::to_string(Area);
+
+			AssembledChecksum += CAreaDatabase::ReadArea(Areas.Database.Query(Query));
+		}
+	});
+
+	Areas.Database.ClearStatements();
+
+	const double CachedSeconds = Test::Measure(3, [&]
+	{
+		CachedChecksum = 0;
+
+		for (Uint32 Area = 0; Area < NumAreas; ++Area)
+		{
+			CachedChecksum += CAreaDatabase::ReadArea(Areas.Database.Query("SELECT ObjectTableId, Data FROM ObjectTable WHERE AreaId = ?", Area));
+		}
+	});
+
+	CHECK(AssembledChecksum == CachedChecksum);
+
+	const TVector<StatementStats> Stats = Areas.Database.GetStatementStats();
+
+	CHECK(Stats.size() == 1);
+	CHECK(Stats[0].NumRows == 3ULL * NumAreas * NumTablesPerArea);
+
+	Test::Report("Assembled SQL", NumAreas / AssembledSeconds, "areas/s");
+	Test::Report("Cached statement", NumAreas / CachedSeconds, "areas/s");
+	Test::Report("Speedup", AssembledSeconds / CachedSeconds, "x");
+	Test::Report("Prepare once", static_cast<double>(Stats[0].PrepareMicroseconds), "us");
+	Test::Report("Step per area", static_cast<double>(Stats[0].TotalMicroseconds) / Stats[0].NumExecutions, "us");
+}
+
+BENCHMARK_CASE(BenchmarkConcurrentAreaReads)
+{
+	CAreaDatabase Areas;
+
+	// Every area is its own read task, as when the scene loads areas side by side.
+
+	auto LoadAreas = [&Areas](const Uint32 NumReaders, Uint64 & Checksum, ConnectionPoolStats & Stats)
+	{
+		CConnectionPool Pool;
+		{
+			CConnectionPool::InitializeOptions Options;
+			{
+				Options.Path		= Areas.GetPath();
+				Options.NumReaders	= NumReaders;
+			}
+
+			CHECK(Pool.Initialize(Options) == SQLITE_OK);
+		}
+
+		const double Seconds = Test::Measure(3, [&]
+		{
+			TVector<std::future<Uint64> > Loads;
+			{
+				Loads.reserve(NumAreas);
+			}
+
+			for (Uint32 Area = 0; Area < NumAreas; ++Area)
+			{
+				Loads.push_back(Pool.ReadAsync([Area](CDatabase & Connection)
+				{
+					return CAreaDatabase::ReadArea(Connection.Query("SELECT ObjectTableId, Data FROM ObjectTable WHERE AreaId = ?", Area));
+				}));
+			}
+
+			Checksum = 0;
+
+			for (std::future<Uint64> & Load : Loads)
+			{
+				Checksum += Load.get();
+			}
+		});
+
+		Stats = Pool.GetStats();
+
+		return Seconds;
+	};
+
+	const Uint32 NumReaders = std::max(2u, std::thread::hardware_concurrency());
+
+	Uint64 SingleChecksum = 0;
+	Uint64 PooledChecksum = 0;
+
+	ConnectionPoolStats SingleStats;
+	ConnectionPoolStats PooledStats;
+
+	const double SingleSeconds = LoadAreas(1, SingleChecksum, SingleStats);
+	const double PooledSeconds = LoadAreas(NumReaders, PooledChecksum, PooledStats);
+
+	CHECK(SingleChecksum == PooledChecksum);
+	CHECK(SingleStats.NumReads == 3ULL * NumAreas);
+	CHECK(PooledStats.NumReads == 3ULL * NumAreas);
+
+	Test::Report("One reader", NumAreas / SingleSeconds, "areas/s");
+	Test::Report("Readers", static_cast<double>(NumReaders), "threads");
+	Test::Report("All readers", NumAreas / PooledSeconds, "areas/s");
+	Test::Report("Speedup", SingleSeconds / PooledSeconds, "x");
+	Test::Report("Read per area", static_cast<double>(PooledStats.ReadMicroseconds) / PooledStats.NumReads, "us");
+}
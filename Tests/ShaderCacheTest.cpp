@@ -0,0 +1,364 @@
+#include "TestHarness.h"
+
+#include "Utils/Shader/ShaderCache.h"
+#include "Utils/File/File.h"
+
+#include <cstring>
+
+using namespace ShaderCache;
+
+// Runs the cache against a stub compiler on a temporary directory, no
+// D3D compiler is needed. The stub follows #include "..." lines and
+// emits the preprocessed text together with the defines as bytecode.
+
+namespace
+{
+	namespace Filesystem = std::experimental::filesystem;
+
+	class CStubCompiler : public IShaderCompiler
+	{
+	public:
+
+		Uint32	NumCompiles = 0;
+		bool	EmitEmpty = false;
+
+	private:
+
+		bool Preprocess(const WString & Path, ShaderCompileOutput & Output)
+		{
+			TVector<Byte> Content;
+
+			File::CFile Input(Path);
+
+			if (Input.ReadFileContentInto(Content) != File::ErrorNone)
+			{
+				return false;
+			}
+
+			const String Text(Content.begin(), Content.end());
+			const WString Directory(Path.begin(), Path.begin() + (Path.find_last_of(L'/') + 1));
+
+			size_t Line = 0;
+
+			while (Line < Text.size())
+			{
+				size_t End = Text.find('\n', Line);
+				{
+					End = End == String::npos ? Text.size() : End;
+				}
+
+				const String Current(Text.begin() + Line, Text.begin() + End);
+
+				if (Current.compare(0, 10, "#include \"") == 0 && Current.back() == '"')
+				{
+					const String Name(Current.begin() + 10, Current.end() - 1);
+
+					WString Include = Directory;
+					{
+						Include.append(Name.begin(), Name.end());
+					}
+
+					Output.Includes.push_back(Include);
+
+					if (!Preprocess(Include, Output))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					Output.Bytecode.insert(Output.Bytecode.end(), Current.begin(), Current.end());
+					Output.Bytecode.push_back('\n');
+				}
+
+				Line = End + 1;
+			}
+
+			return true;
+		}
+
+	public:
+
+		virtual bool Compile(const ShaderKey & Key, ShaderCompileOutput & Output) override
+		{
+			++NumCompiles;
+
+			if (!Preprocess(Key.Path, Output))
+			{
+				return false;
+			}
+
+			for (const ShaderDefine & Define : Key.Defines)
+			{
+				Output.Bytecode.insert(Output.Bytecode.end(), Define.Name.begin(), Define.Name.end());
+				Output.Bytecode.insert(Output.Bytecode.end(), Define.Value.begin(), Define.Value.end());
+			}
+
+			if (EmitEmpty)
+			{
+				Output.Bytecode.clear();
+			}
+
+			return true;
+		}
+
+		virtual Uint64 GetCompilerHash() const override
+		{
+			return 1;
+		}
+	};
+
+	// A fresh directory per test, removed again when the test ends.
+
+	class CTemporaryDirectory
+	{
+	private:
+
+		WString Path;
+
+	public:
+
+		CTemporaryDirectory()
+		{
+			static Uint32 Counter = 0;
+
+			const Filesystem::path Root = Filesystem::temp_directory_path() / ("ShaderCacheTest" + std::to_string(Counter++));
+
+			std::error_code Error;
+
+			Filesystem::remove_all(Root, Error);
+			Filesystem::create_directories(Root, Error);
+
+			Path = NormalizePath(WString(Root.wstring()));
+		}
+
+		~CTemporaryDirectory()
+		{
+			std::error_code Error;
+
+			Filesystem::remove_all(Filesystem::path(Path.c_str()), Error);
+		}
+
+		WString Get(const wchar_t * Name) const
+		{
+			WString Result = Path;
+			{
+				Result.push_back(L'/');
+				Result.append(Name);
+			}
+
+			return Result;
+		}
+
+		void Write(const wchar_t * Name, const char * Content) const
+		{
+			File::CFile Output(Get(Name));
+			{
+				Output.GetContentRef().assign(Content, Content + std::strlen(Content));
+			}
+
+			CHECK(Output.WriteFileContent() == File::ErrorNone);
+
+			Output.Close();
+		}
+	};
+
+	ShaderKey CreateKey(const CTemporaryDirectory & Directory)
+	{
+		ShaderKey Key;
+		{
+			Key.Path		= Directory.Get(L"Shader.hlsl");
+			Key.EntryPoint	= "Main";
+			Key.Profile		= "ps_5_1";
+			Key.Defines		= { { "A", "1" }, { "B", "2" } };
+		}
+
+		return Key;
+	}
+
+	CShaderCache::InitializeOptions GetOptions(const CTemporaryDirectory & Directory)
+	{
+		CShaderCache::InitializeOptions Options;
+		{
+			Options.Directory = Directory.Get(L"Cache");
+		}
+
+		return Options;
+	}
+}
+
+TEST_CASE(ShaderKeyIgnoresDefineOrder)
+{
+	ShaderKey Left;
+	{
+		Left.Path		= L"Shaders\\Lighting.hlsl";
+		Left.EntryPoint	= "Main";
+		Left.Profile	= "cs_5_1";
+		Left.Defines	= { { "A", "1" }, { "B", "2" } };
+	}
+
+	ShaderKey Right = Left;
+	{
+		Right.Path		= L"Shaders/Lighting.hlsl";
+		Right.Defines	= { { "B", "2" }, { "A", "1" } };
+	}
+
+	CHECK(HashShaderKey(Left) == HashShaderKey(Right));
+
+	Right.Defines[0].Value = "3";
+
+	CHECK(HashShaderKey(Left) != HashShaderKey(Right));
+}
+
+TEST_CASE(SecondCompileHitsCache)
+{
+	CTemporaryDirectory Directory;
+	{
+		Directory.Write(L"Shader.hlsl", "#include \"Common.hlsli\"\nfloat4 Main();");
+		Directory.Write(L"Common.hlsli", "float Common;");
+	}
+
+	CStubCompiler Compiler;
+	CShaderCache Cache;
+	{
+		CHECK(Cache.Initialize(GetOptions(Directory)));
+	}
+
+	const ShaderKey Key = CreateKey(Directory);
+
+	ShaderCompileOutput First;
+	ShaderCompileOutput Second;
+
+	bool FromCache = true;
+
+	CHECK(Cache.Compile(Key, Compiler, First, &FromCache) && !FromCache);
+	CHECK(First.Includes.size() == 1);
+
+	CHECK(Cache.Compile(Key, Compiler, Second, &FromCache) && FromCache);
+	CHECK(Second.Bytecode == First.Bytecode);
+	CHECK(Second.Includes.size() == 1);
+
+	CHECK(Compiler.NumCompiles == 1);
+	CHECK(Cache.GetStats().NumHits == 1 && Cache.GetStats().NumMisses == 1);
+
+	// Another instance finds the recorded dependencies and the object on disk.
+
+	CShaderCache Reopened;
+	{
+		CHECK(Reopened.Initialize(GetOptions(Directory)));
+	}
+
+	ShaderCompileOutput Third;
+
+	CHECK(Reopened.Compile(Key, Compiler, Third, &FromCache) && FromCache);
+	CHECK(Third.Bytecode == First.Bytecode);
+	CHECK(Compiler.NumCompiles == 1);
+}
+
+TEST_CASE(IncludeEditRecompilesDependents)
+{
+	CTemporaryDirectory Directory;
+	{
+		Directory.Write(L"Shader.hlsl", "#include \"Common.hlsli\"\nfloat4 Main();");
+		Directory.Write(L"Common.hlsli", "float Common;");
+		Directory.Write(L"Other.hlsl", "float4 Other();");
+	}
+
+	CStubCompiler Compiler;
+	CShaderCache Cache;
+	{
+		CHECK(Cache.Initialize(GetOptions(Directory)));
+	}
+
+	const ShaderKey Key = CreateKey(Directory);
+
+	ShaderKey OtherKey = Key;
+	{
+		OtherKey.Path = Directory.Get(L"Other.hlsl");
+	}
+
+	ShaderCompileOutput Original;
+	ShaderCompileOutput Unrelated;
+
+	CHECK(Cache.Compile(Key, Compiler, Original));
+	CHECK(Cache.Compile(OtherKey, Compiler, Unrelated));
+
+	Directory.Write(L"Common.hlsli", "float Edited;");
+
+	// Only the shader reading the include is reported.
+
+	const TVector<Uint64> Affected = Cache.Invalidate(Directory.Get(L"Common.hlsli"));
+
+	CHECK(Affected.size() == 1 && Affected[0] == HashShaderKey(Key));
+
+	ShaderCompileOutput Edited;
+
+	bool FromCache = true;
+
+	CHECK(Cache.Compile(Key, Compiler, Edited, &FromCache) && !FromCache);
+	CHECK(Edited.Bytecode != Original.Bytecode);
+	CHECK(Compiler.NumCompiles == 3);
+
+	// Going back to the old contents finds the old object again.
+
+	Directory.Write(L"Common.hlsli", "float Common;");
+	Cache.Invalidate(Directory.Get(L"Common.hlsli"));
+
+	ShaderCompileOutput Reverted;
+
+	CHECK(Cache.Compile(Key, Compiler, Reverted, &FromCache) && FromCache);
+	CHECK(Reverted.Bytecode == Original.Bytecode);
+	CHECK(Compiler.NumCompiles == 3);
+}
+
+TEST_CASE(EmptyBytecodeRoundTrips)
+{
+	CTemporaryDirectory Directory;
+	{
+		Directory.Write(L"Shader.hlsl", "float4 Main();");
+	}
+
+	CStubCompiler Compiler;
+	{
+		Compiler.EmitEmpty = true;
+	}
+
+	CShaderCache Cache;
+	{
+		CHECK(Cache.Initialize(GetOptions(Directory)));
+	}
+
+	const ShaderKey Key = CreateKey(Directory);
+
+	ShaderCompileOutput First;
+	ShaderCompileOutput Second;
+
+	bool FromCache = false;
+
+	CHECK(Cache.Compile(Key, Compiler, First) && First.Bytecode.empty());
+	CHECK(Cache.Compile(Key, Compiler, Second, &FromCache) && FromCache);
+	CHECK(Second.Bytecode.empty());
+}
+
+TEST_CASE(FailedCompileIsNotCached)
+{
+	CTemporaryDirectory Directory;
+
+	CStubCompiler Compiler;
+	CShaderCache Cache;
+	{
+		CHECK(Cache.Initialize(GetOptions(Directory)));
+	}
+
+	const ShaderKey Key = CreateKey(Directory);
+
+	ShaderCompileOutput Output;
+
+	CHECK(!Cache.Compile(Key, Compiler, Output));
+
+	Directory.Write(L"Shader.hlsl", "float4 Main();");
+
+	CHECK(Cache.Compile(Key, Compiler, Output));
+	CHECK(Compiler.NumCompiles == 2);
+	CHECK(Cache.GetStats().NumFailed == 1);
+}
@@ -0,0 +1,344 @@
+#include "TestHarness.h"
+
+#include "Scene/Spatial/BoundingVolumeHierarchy.h"
+#include "Scene/Spatial/LooseQuadTree.h"
+
+#include <random>
+
+using namespace D3D;
+
+// Compares the quadtree and the bounding volume hierarchy against a linear
+// scan over the same boxes. Frustum queries need the view math and are left
+// to the engine, box, sphere and ray queries share the traversal with them.
+
+namespace
+{
+	class CBruteForce
+	{
+	public:
+
+		TVector<BoundingBox>	Bounds;
+		TVector<bool>			Alive;
+
+	public:
+
+		template<class Test> TVector<Uint32> Query(Test && Intersects) const
+		{
+			TVector<Uint32> Result;
+
+			for (Uint32 N = 0; N < Bounds.size(); ++N)
+			{
+				if (Alive[N] && Intersects(Bounds[N]))
+				{
+					Result.push_back(N);
+				}
+			}
+
+			return Result;
+		}
+	};
+
+	// A fifth of the boxes leaves the tree on one side, some are larger than the tree.
+
+	BoundingBox CreateBox(std::mt19937 & Random)
+	{
+		std::uniform_real_distribution<Float> Position(-200.0f, 1200.0f);
+		std::uniform_real_distribution<Float> Height(-50.0f, 50.0f);
+		std::uniform_real_distribution<Float> Size(0.0f, 1.0f);
+
+		const Float Extent = Size(Random) < 0.05f ? 1500.0f * Size(Random) : 20.0f * Size(Random);
+
+		return BoundingBox::FromCenter(
+			Vector3f(Position(Random), Position(Random), Height(Random)),
+			Vector3f(Extent, Extent * Size(Random) + 0.1f, 5.0f * Size(Random)));
+	}
+
+	template<class Index> TVector<Uint32> QueryBox(const Index & Tree, const BoundingBox & Box)
+	{
+		TVector<Uint32> Result;
+
+		Tree.QueryBox(Box, [&Result](const Uint32 UserData)
+		{
+			Result.push_back(UserData);
+			return true;
+		});
+
+		std::sort(Result.begin(), Result.end());
+
+		return Result;
+	}
+
+	template<class Index> TVector<Uint32> QuerySphere(const Index & Tree, const SpatialSphere & Sphere)
+	{
+		TVector<Uint32> Result;
+
+		Tree.QuerySphere(Sphere, [&Result](const Uint32 UserData)
+		{
+			Result.push_back(UserData);
+			return true;
+		});
+
+		std::sort(Result.begin(), Result.end());
+
+		return Result;
+	}
+
+	template<class Index> TVector<Uint32> QueryRay(const Index & Tree, const SpatialRay & Ray)
+	{
+		TVector<Uint32> Result;
+
+		Tree.QueryRay(Ray, [&Result](const Uint32 UserData, const Float Distance)
+		{
+			Result.push_back(UserData);
+			return true;
+		});
+
+		std::sort(Result.begin(), Result.end());
+
+		return Result;
+	}
+
+	// Runs every kind of query from random positions against both the index and the scan.
+
+	template<class Index> void CheckQueries(const Index & Tree, const CBruteForce & Reference, std::mt19937 & Random)
+	{
+		std::uniform_real_distribution<Float> Position(-400.0f, 1400.0f);
+		std::uniform_real_distribution<Float> Size(0.0f, 300.0f);
+		std::uniform_real_distribution<Float> Direction(-1.0f, 1.0f);
+
+		for (Uint32 Query = 0; Query < 50; ++Query)
+		{
+			const Vector3f Center(Position(Random), Position(Random), Direction(Random) * 60.0f);
+
+			const BoundingBox Box = BoundingBox::FromCenter(Center, Vector3f(Size(Random), Size(Random), Size(Random) * 0.2f));
+
+			CHECK(QueryBox(Tree, Box) == Reference.Query([&Box](const BoundingBox & Bounds) { return Bounds.Intersects(Box); }));
+
+			const SpatialSphere Sphere = { Center, Size(Random) };
+
+			CHECK(QuerySphere(Tree, Sphere) == Reference.Query([&Sphere](const BoundingBox & Bounds) { return Bounds.Intersects(Sphere); }));
+
+			SpatialRay Ray;
+			{
+				Ray.Origin		= Center;
+				Ray.Direction	= Vector3f(Direction(Random), Direction(Random), Direction(Random) * 0.1f);
+				Ray.Length		= Query % 2 ? MAX_FLT : Size(Random) * 4.0f;
+			}
+
+			const Vector3f InverseDirection = Ray.GetInverseDirection();
+
+			CHECK(QueryRay(Tree, Ray) == Reference.Query([&](const BoundingBox & Bounds)
+			{
+				Float Distance;
+				return Bounds.Intersects(Ray, InverseDirection, Distance);
+			}));
+		}
+	}
+
+	CLooseQuadTree::InitializeOptions GetQuadTreeOptions()
+	{
+		CLooseQuadTree::InitializeOptions Options;
+		{
+			Options.Origin	= Vector2f(0.0f, 0.0f);
+			Options.Size	= Vector2f(1000.0f, 1000.0f);
+			Options.Depth	= 6;
+		}
+
+		return Options;
+	}
+}
+
+TEST_CASE(QuadTreeMatchesBruteForce)
+{
+	std::mt19937 Random(17);
+
+	CLooseQuadTree	Tree(GetQuadTreeOptions());
+	CBruteForce		Reference;
+
+	// Enough for the parallel node selection of the batch insert.
+
+	TVector<Uint32>			UserData(3000);
+	TVector<SpatialHandle>	Handles(UserData.size());
+
+	for (Uint32 N = 0; N < UserData.size(); ++N)
+	{
+		Reference.Bounds.push_back(CreateBox(Random));
+		Reference.Alive.push_back(true);
+
+		UserData[N] = N;
+	}
+
+	Tree.InsertBatch(Reference.Bounds.data(), UserData.data(), UserData.size(), Handles.data());
+
+	CHECK(Tree.GetNumItems() == UserData.size());
+
+	CheckQueries(Tree, Reference, Random);
+
+	// Single inserts take the same path as the batch.
+
+	for (Uint32 N = 0; N < 200; ++N)
+	{
+		Reference.Bounds.push_back(CreateBox(Random));
+		Reference.Alive.push_back(true);
+
+		Handles.push_back(Tree.Insert(Reference.Bounds.back(), static_cast<Uint32>(Reference.Bounds.size() - 1)));
+	}
+
+	CheckQueries(Tree, Reference, Random);
+
+	// Moves cross cells, levels and the tree border, removed handles are reused.
+
+	std::uniform_int_distribution<Uint32> Pick(0, static_cast<Uint32>(Handles.size() - 1));
+
+	for (Uint32 N = 0; N < 1000; ++N)
+	{
+		const Uint32 Index = Pick(Random);
+
+		if (!Reference.Alive[Index])
+		{
+			continue;
+		}
+
+		if (N % 3 == 0)
+		{
+			Tree.Remove(Handles[Index]);
+			Reference.Alive[Index] = false;
+		}
+		else
+		{
+			Reference.Bounds[Index] = CreateBox(Random);
+			Tree.Update(Handles[Index], Reference.Bounds[Index]);
+
+			CHECK(Tree.GetBounds(Handles[Index]).Min.X == Reference.Bounds[Index].Min.X);
+		}
+	}
+
+	CheckQueries(Tree, Reference, Random);
+
+	CHECK(Tree.GetNumItems() == static_cast<size_t>(std::count(Reference.Alive.begin(), Reference.Alive.end(), true)));
+
+	Tree.Clear();
+
+	CHECK(Tree.GetNumItems() == 0);
+	CHECK(QueryBox(Tree, BoundingBox::FromCenter(Vector3f(500.0f, 500.0f, 0.0f), Vector3f(5000.0f, 5000.0f, 5000.0f))).empty());
+}
+
+TEST_CASE(QuadTreeVisitorStops)
+{
+	CLooseQuadTree Tree(GetQuadTreeOptions());
+
+	// One object inside, one in the overflow node.
+
+	Tree.Insert(BoundingBox::FromCenter(Vector3f(500.0f, 500.0f, 0.0f), Vector3f(1.0f, 1.0f, 1.0f)), 0);
+	Tree.Insert(BoundingBox::FromCenter(Vector3f(-500.0f, 500.0f, 0.0f), Vector3f(1.0f, 1.0f, 1.0f)), 1);
+
+	Uint32 NumVisited = 0;
+
+	Tree.QueryBox(BoundingBox::FromCenter(Vector3f(0.0f, 500.0f, 0.0f), Vector3f(1000.0f, 10.0f, 10.0f)), [&NumVisited](const Uint32 UserData)
+	{
+		NumVisited++;
+		return false;
+	});
+
+	CHECK(NumVisited == 1);
+}
+
+TEST_CASE(BoundingVolumeHierarchyMatchesBruteForce)
+{
+	std::mt19937 Random(23);
+
+	CBoundingVolumeHierarchy::InitializeOptions Options;
+	{
+		Options.MaxLeafSize = 2;
+	}
+
+	CBoundingVolumeHierarchy	Tree(Options);
+	CBruteForce					Reference;
+
+	TVector<Uint32>			UserData(2000);
+	TVector<SpatialHandle>	Handles(UserData.size());
+
+	for (Uint32 N = 0; N < UserData.size(); ++N)
+	{
+		Reference.Bounds.push_back(CreateBox(Random));
+		Reference.Alive.push_back(true);
+
+		UserData[N] = N;
+	}
+
+	Tree.InsertBatch(Reference.Bounds.data(), UserData.data(), UserData.size(), Handles.data());
+
+	CHECK(Tree.IsDirty());
+
+	Tree.Commit();
+
+	CHECK(!Tree.IsDirty());
+	CHECK(Tree.GetNumNodes() > 1);
+
+	CheckQueries(Tree, Reference, Random);
+
+	// Small moves are refitted, removals wait for the rebuild.
+
+	std::uniform_int_distribution<Uint32> Pick(0, static_cast<Uint32>(Handles.size() - 1));
+	std::uniform_real_distribution<Float> Offset(-5.0f, 5.0f);
+
+	for (Uint32 N = 0; N < 500; ++N)
+	{
+		const Uint32 Index = Pick(Random);
+
+		if (!Reference.Alive[Index])
+		{
+			continue;
+		}
+
+		const Vector3f Move(Offset(Random), Offset(Random), Offset(Random));
+
+		Reference.Bounds[Index] = BoundingBox(Reference.Bounds[Index].Min + Move, Reference.Bounds[Index].Max + Move);
+		Tree.Update(Handles[Index], Reference.Bounds[Index]);
+	}
+
+	Tree.Commit();
+
+	CheckQueries(Tree, Reference, Random);
+
+	for (Uint32 N = 0; N < 500; ++N)
+	{
+		const Uint32 Index = Pick(Random);
+
+		if (!Reference.Alive[Index])
+		{
+			continue;
+		}
+
+		if (N % 2 == 0)
+		{
+			Tree.Remove(Handles[Index]);
+			Reference.Alive[Index] = false;
+		}
+		else
+		{
+			Reference.Bounds[Index] = CreateBox(Random);
+			Tree.Update(Handles[Index], Reference.Bounds[Index]);
+		}
+	}
+
+	Tree.Commit();
+
+	CheckQueries(Tree, Reference, Random);
+
+	// Handles of removed items are reused once the tree no longer references them.
+
+	const SpatialHandle Reused = Tree.Insert(CreateBox(Random), static_cast<Uint32>(Reference.Bounds.size()));
+
+	CHECK(Reused < Handles.size());
+	CHECK(!Reference.Alive[std::find(Handles.begin(), Handles.end(), Reused) - Handles.begin()]);
+
+	Reference.Bounds.push_back(Tree.GetBounds(Reused));
+	Reference.Alive.push_back(true);
+
+	Tree.Commit();
+
+	CheckQueries(Tree, Reference, Random);
+
+	CHECK(Tree.GetNumItems() == static_cast<size_t>(std::count(Reference.Alive.begin(), Reference.Alive.end(), true)));
+}
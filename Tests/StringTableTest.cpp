@@ -0,0 +1,342 @@
+#include "TestHarness.h"
+
+#include "Utils/Container/StringTable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+// Tables are created per case, only the handle cases use the global table
+// and only with texts of their own.
+
+namespace
+{
+	template<class Char>
+	std::basic_string<Char> Normalize(const std::basic_string_view<Char> & Path)
+	{
+		std::basic_string<Char> Result;
+		{
+			TStringTable<Char>::NormalizePath(Path, Result);
+		}
+
+		return Result;
+	}
+
+	std::string CreateKey(const Uint32 Value)
+	{
+		return "textures/terrain/rock_" + std::to_string(Value) + ".dds";
+	}
+}
+
+TEST_CASE(StringTableInternAndFind)
+{
+	auto Table = std::make_unique<TStringTable<char> >();
+
+	CHECK(Table->Intern("") == 0);
+	CHECK(Table->Find("") == 0);
+	CHECK(Table->Get(0).empty());
+
+	const Uint32 Stone = Table->Intern("Stone");
+
+	CHECK(Stone != 0);
+	CHECK(Table->Intern("Stone") == Stone);
+	CHECK(Table->Find("Stone") == Stone);
+	CHECK(Table->Intern("stone") != Stone);
+	CHECK(Table->Find("Ston") == TStringTable<char>::NotFound);
+	CHECK(Table->Find("Stones") == TStringTable<char>::NotFound);
+
+	// Views into the text are interned as their own string.
+
+	const std::string Text = "Stone/Moss";
+
+	CHECK(Table->Intern(std::string_view(Text).substr(0, 5)) == Stone);
+	CHECK(Table->Get(Stone) == "Stone");
+	CHECK(std::strcmp(Table->GetData(Stone), "Stone") == 0);
+	CHECK(Table->GetHash(Stone) == TStringTable<char>::Hash("Stone"));
+
+	// Long strings are stored apart, the index grows several times. Stored text never moves.
+
+	const std::string Long(100000, 'x');
+
+	const Uint32 LongIndex = Table->Intern(Long);
+
+	const char * StoneData = Table->GetData(Stone);
+
+	TVector<Uint32> Indices;
+
+	for (Uint32 N = 0; N < 50000; ++N)
+	{
+		Indices.push_back(Table->Intern(CreateKey(N)));
+	}
+
+	CHECK(Table->GetData(Stone) == StoneData);
+	CHECK(Table->Get(LongIndex) == Long);
+	CHECK(Table->GetData(LongIndex)[Long.size()] == '\0');
+
+	for (Uint32 N = 0; N < 50000; ++N)
+	{
+		CHECK(Table->Find(CreateKey(N)) == Indices[N]);
+		CHECK(Table->Get(Indices[N]) == CreateKey(N));
+	}
+
+	// The keys, the empty string, both spellings of stone and the long string.
+
+	const StringTableStats Stats = Table->GetStats();
+
+	CHECK(Stats.NumStrings == 50000 + 4);
+	CHECK(Stats.IndexCapacity >= Stats.NumStrings * 2);
+
+	// Wide tables hash the characters, not a narrowed copy.
+
+	auto WideTable = std::make_unique<TStringTable<wchar_t> >();
+
+	const Uint32 Wide = WideTable->Intern(L"Stein\u00FC");
+
+	CHECK(WideTable->Find(L"Stein\u00FC") == Wide);
+	CHECK(WideTable->Find(L"Stein\u00DC") == TStringTable<wchar_t>::NotFound);
+	CHECK(WideTable->Get(Wide) == L"Stein\u00FC");
+}
+
+TEST_CASE(StringTableNormalizesPaths)
+{
+	const std::pair<const char *, const char *> Cases[] =
+	{
+		{ "Textures\\Terrain\\Rock.DDS",	"textures/terrain/rock.dds"	},
+		{ "textures//terrain/./rock.dds/",	"textures/terrain/rock.dds"	},
+		{ "/Data/Shaders",					"/data/shaders"				},
+		{ "\\\\Data\\\\",					"/data"						},
+		{ "a/b/../c",						"a/c"						},
+		{ "a/b/../../c",					"c"							},
+		{ "a/..",							""							},
+		{ "../a",							"../a"						},
+		{ "../../a/..",						"../.."						},
+		{ "C:\\Data\\..\\Shaders",			"c:/shaders"				},
+		{ ".",								""							},
+		{ "",								""							}
+	};
+
+	for (const auto & Case : Cases)
+	{
+		CHECK(Normalize<char>(Case.first) == Case.second);
+	}
+
+	// Only ASCII letters are lowered, UTF-8 sequences and wide characters outside of it stay.
+
+	CHECK(Normalize<char>("\xC3\x84/Moos") == "\xC3\x84/moos");
+	CHECK(Normalize<wchar_t>(L"Gel\u00C4nde\\Moos") == L"gel\u00C4nde/moos");
+
+	auto Table = std::make_unique<TStringTable<char> >();
+
+	const Uint32 Path = Table->InternPath("Textures\\Rock.dds");
+
+	CHECK(Table->Get(Path) == "textures/rock.dds");
+	CHECK(Table->InternPath("textures/./ROCK.dds") == Path);
+	CHECK(Table->FindPath("TEXTURES//rock.dds") == Path);
+	CHECK(Table->Find("Textures\\Rock.dds") == TStringTable<char>::NotFound);
+	CHECK(Table->FindPath("textures/stone.dds") == TStringTable<char>::NotFound);
+}
+
+TEST_CASE(StringTableInternsConcurrently)
+{
+	constexpr Uint32 NumThreads	= 4;
+	constexpr Uint32 NumShared	= 20000;
+	constexpr Uint32 NumOwn		= 5000;
+
+	auto Table = std::make_unique<TStringTable<char> >();
+
+	TVector<TVector<Uint32> > Shared(NumThreads, TVector<Uint32>(NumShared));
+	TVector<TVector<Uint32> > Own(NumThreads, TVector<Uint32>(NumOwn));
+
+	std::atomic<Uint32> NumMissing(0);
+
+	TVector<std::thread> Threads;
+
+	for (Uint32 Thread = 0; Thread < NumThreads; ++Thread)
+	{
+		Threads.emplace_back([&, Thread]()
+		{
+			// Every thread interns the shared keys in its own order, so inserts of one text race.
+
+			TVector<Uint32> Order(NumShared);
+			{
+				for (Uint32 N = 0; N < NumShared; ++N)
+				{
+					Order[N] = N;
+				}
+
+				std::shuffle(Order.begin(), Order.end(), std::mt19937(Thread));
+			}
+
+			for (Uint32 N = 0; N < NumShared; ++N)
+			{
+				Shared[Thread][Order[N]] = Table->Intern(CreateKey(Order[N]));
+
+				if (N < NumOwn)
+				{
+					const std::string Key = "thread" + std::to_string(Thread) + "/" + std::to_string(N);
+
+					Own[Thread][N] = Table->Intern(Key);
+
+					// Published before Intern returns, seen by lookups of any thread from then on.
+
+					if (Table->Find(Key) != Own[Thread][N])
+					{
+						NumMissing.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}
+		});
+	}
+
+	for (std::thread & Thread : Threads)
+	{
+		Thread.join();
+	}
+
+	CHECK(NumMissing.load() == 0);
+
+	for (Uint32 Thread = 1; Thread < NumThreads; ++Thread)
+	{
+		CHECK(Shared[Thread] == Shared[0]);
+	}
+
+	for (Uint32 N = 0; N < NumShared; ++N)
+	{
+		CHECK(Table->Get(Shared[0][N]) == CreateKey(N));
+	}
+
+	for (Uint32 Thread = 0; Thread < NumThreads; ++Thread)
+	{
+		for (Uint32 N = 0; N < NumOwn; ++N)
+		{
+			CHECK(Table->Get(Own[Thread][N]) == "thread" + std::to_string(Thread) + "/" + std::to_string(N));
+		}
+	}
+
+	CHECK(Table->GetStats().NumStrings == 1 + NumShared + NumThreads * NumOwn);
+}
+
+TEST_CASE(StringTableHandles)
+{
+	CHECK(InternedString().IsEmpty());
+	CHECK(InternedString().GetView().empty());
+	CHECK(std::strcmp(InternedString().c_str(), "") == 0);
+
+	const InternedString Rock("StringTableTest/Rock");
+
+	CHECK(!Rock.IsEmpty());
+	CHECK(Rock == InternedString(std::string_view("StringTableTest/Rock")));
+	CHECK(Rock != InternedString("StringTableTest/Moss"));
+	CHECK(Rock.GetView() == "StringTableTest/Rock");
+	CHECK(Rock.GetHash() == InternedString::TTable::Hash("StringTableTest/Rock"));
+
+	InternedString Found = Rock;
+
+	CHECK(InternedString::Find("StringTableTest/Rock", Found) && Found == Rock);
+	CHECK(!InternedString::Find("StringTableTest/Unknown", Found) && Found.IsEmpty());
+
+	const InternedString Path = InternedString::FromPath("StringTableTest\\Sub\\..\\Rock.DDS");
+
+	CHECK(Path.GetView() == "stringtabletest/rock.dds");
+	CHECK(InternedString::FindPath("StringTableTest/ROCK.dds", Found) && Found == Path);
+
+	const InternedWString Wide(L"StringTableTest/Rock");
+
+	CHECK(Wide.GetView() == L"StringTableTest/Rock");
+
+	std::unordered_map<InternedString, Uint32> Map;
+	{
+		Map[Rock] = 1;
+		Map[Path] = 2;
+	}
+
+	CHECK(Map.at(InternedString("StringTableTest/Rock")) == 1);
+	CHECK(Map.count(InternedString()) == 0);
+}
+
+BENCHMARK_CASE(BenchmarkStringTable)
+{
+	constexpr Uint32 NumKeys	= 1 << 16;
+	constexpr Uint32 NumLookups	= 1 << 22;
+
+	TVector<std::string> Keys(NumKeys);
+	TVector<Uint32> Lookups(NumLookups);
+
+	std::mt19937 Random(5);
+
+	for (Uint32 N = 0; N < NumKeys; ++N)
+	{
+		Keys[N] = CreateKey(N);
+	}
+
+	for (Uint32 & Lookup : Lookups)
+	{
+		Lookup = Random() % NumKeys;
+	}
+
+	auto Table = std::make_unique<TStringTable<char> >();
+
+	Uint64 Checksum = 0;
+
+	const double InternSeconds = Test::Measure(1, [&]
+	{
+		for (const std::string & Key : Keys)
+		{
+			Checksum += Table->Intern(Key);
+		}
+	});
+
+	Test::Report("Intern new", NumKeys / InternSeconds / 1e6, "M/s");
+
+	const auto Run = [&](const char * Name, auto && Lookup)
+	{
+		const double Seconds = Test::Measure(5, [&]
+		{
+			for (const Uint32 Key : Lookups)
+			{
+				Checksum += Lookup(Key);
+			}
+		});
+
+		Test::Report(Name, NumLookups / Seconds / 1e6, "M/s");
+	};
+
+	// What the managers did: string keys hashed on every lookup.
+
+	std::unordered_map<std::string, Uint32> StringMap;
+	std::unordered_map<InternedString, Uint32> HandleMap;
+
+	TVector<InternedString> Handles(NumKeys);
+
+	for (Uint32 N = 0; N < NumKeys; ++N)
+	{
+		Handles[N]				= InternedString(Keys[N]);
+		StringMap[Keys[N]]		= N;
+		HandleMap[Handles[N]]	= N;
+	}
+
+	Run("String map", [&](const Uint32 Key)
+	{
+		return StringMap.find(Keys[Key])->second;
+	});
+
+	Run("Find", [&](const Uint32 Key)
+	{
+		return Table->Find(Keys[Key]);
+	});
+
+	Run("Intern existing", [&](const Uint32 Key)
+	{
+		return Table->Intern(Keys[Key]);
+	});
+
+	Run("Handle map", [&](const Uint32 Key)
+	{
+		return HandleMap.find(Handles[Key])->second;
+	});
+
+	Test::Report("Checksum", static_cast<double>(Checksum % 1000), "");
+}
@@ -0,0 +1,105 @@
+#include "TestHarness.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace Test
+{
+	TVector<Case> & GetCases()
+	{
+		static TVector<Case> Cases;
+
+		return Cases;
+	}
+
+	CRegistrar::CRegistrar(const char * Name, ECaseKind Kind, CaseFunction Function)
+	{
+		GetCases().push_back({ Name, Kind, Function });
+	}
+
+	void Fail(const char * File, const int Line, const char * Expression)
+	{
+		char Message[512];
+		{
+			std::snprintf(Message, sizeof(Message), "%s(%d): CHECK(%s) failed", File, Line, Expression);
+		}
+
+		throw CFailure(Message);
+	}
+
+	void Report(const char * Name, const double Value, const char * Unit)
+	{
+		char Line[256];
+		{
+			std::snprintf(Line, sizeof(Line), "    %-40s %12.3f %s", Name, Value, Unit);
+		}
+
+		std::cout << Line << std::endl;
+	}
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: Tests [-bench] [filter]" << std::endl;
+}
+
+int main(int Argc, char ** Argv)
+{
+	bool			Benchmarks	= false;
+	const char *	Filter		= NULL;
+
+	for (int N = 1; N < Argc; ++N)
+	{
+		if (std::strcmp(Argv[N], "-bench") == 0)
+		{
+			Benchmarks = true;
+		}
+		else if (Argv[N][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			Filter = Argv[N];
+		}
+	}
+
+	Uint32 NumRun		= 0;
+	Uint32 NumFailed	= 0;
+
+	for (const Test::Case & Case : Test::GetCases())
+	{
+		if (Case.Kind == Test::CaseBenchmark && !Benchmarks)
+		{
+			continue;
+		}
+
+		if (Filter && !std::strstr(Case.Name, Filter))
+		{
+			continue;
+		}
+
+		std::cout << "[ RUN  ] " << Case.Name << std::endl;
+
+		NumRun++;
+
+		try
+		{
+			Case.Function();
+
+			std::cout << "[  OK  ] " << Case.Name << std::endl;
+		}
+		catch (const std::exception & Exception)
+		{
+			std::cout << "[ FAIL ] " << Case.Name << ": " << Exception.what() << std::endl;
+
+			NumFailed++;
+		}
+	}
+
+	std::cout << NumRun - NumFailed << " of " << NumRun << " passed" << std::endl;
+
+	return NumFailed == 0 ? 0 : 1;
+}
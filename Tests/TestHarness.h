@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Defines.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// Minimal self registering test runner. Tests run by default,
+// benchmarks only with -bench since they take seconds each.
+
+namespace Test
+{
+	enum ECaseKind
+	{
+		CaseTest,
+		CaseBenchmark
+	};
+
+	typedef void(*CaseFunction)();
+
+	struct Case
+	{
+		const char *	Name;
+		ECaseKind		Kind;
+		CaseFunction	Function;
+	};
+
+	class CFailure : public std::exception
+	{
+	private:
+
+		String Message;
+
+	public:
+
+		CFailure(String Message) :
+			Message(std::move(Message))
+		{}
+
+		const char * what() const noexcept override
+		{
+			return Message.c_str();
+		}
+	};
+
+	class CRegistrar
+	{
+	public:
+
+		CRegistrar
+		(
+			const char *	Name,
+			ECaseKind		Kind,
+			CaseFunction	Function
+		);
+	};
+
+	TVector<Case> & GetCases();
+
+	[[noreturn]] void Fail
+	(
+		const char *	File,
+		const int		Line,
+		const char *	Expression
+	);
+
+	// Best wall time of a number of runs in seconds.
+
+	template<class Function> double Measure(const Uint32 Runs, Function && Callback)
+	{
+		double Best = std::numeric_limits<double>::max();
+
+		for (Uint32 Run = 0; Run < Runs; ++Run)
+		{
+			const auto Start = std::chrono::high_resolution_clock::now();
+			{
+				Callback();
+			}
+
+			Best = std::min(Best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count());
+		}
+
+		return Best;
+	}
+
+	// Prints one aligned result line of a benchmark.
+
+	void Report
+	(
+		const char *	Name,
+		const double	Value,
+		const char *	Unit
+	);
+}
+
+#define TEST_CASE(Name) \
+	static void Name(); \
+	static ::Test::CRegistrar Name##Registrar(#Name, ::Test::CaseTest, &Name); \
+	static void Name()
+
+#define BENCHMARK_CASE(Name) \
+	static void Name(); \
+	static ::Test::CRegistrar Name##Registrar(#Name, ::Test::CaseBenchmark, &Name); \
+	static void Name()
+
+#define CHECK(Expression) \
+	do \
+	{ \
+		if (!(Expression)) \
+		{ \
+			::Test::Fail(__FILE__, __LINE__, #Expression); \
+		} \
+	} while (false)
@@ -0,0 +1,243 @@
+#include "TestHarness.h"
+
+#include "Resource/Texture/TextureStreaming.h"
+
+using namespace D3D;
+
+// Drives the residency policy with the null backend, no device is involved.
+
+namespace
+{
+	constexpr Uint32 TextureSize = 256;
+	constexpr Uint32 MipLevels = 9;
+
+	// The unknown format is sized as four bytes per texel.
+
+	TextureStreamingDesc CreateDesc()
+	{
+		TextureStreamingDesc Desc;
+		{
+			Desc.Width		= TextureSize;
+			Desc.Height		= TextureSize;
+			Desc.MipLevels	= MipLevels;
+		}
+
+		return Desc;
+	}
+
+	Uint64 GetTailBytes(const Uint32 FirstMip)
+	{
+		const TextureStreamingDesc Desc = CreateDesc();
+
+		Uint64 Bytes = 0;
+
+		for (Uint32 Mip = FirstMip; Mip < MipLevels; ++Mip)
+		{
+			Bytes += CTextureStreamer::ComputeMipBytes(Desc, Mip);
+		}
+
+		return Bytes;
+	}
+
+	class CStreamingFixture
+	{
+	public:
+
+		CTextureStreamer				Streamer;
+		CTextureStreamingBackendNull	Backend;
+
+	public:
+
+		CStreamingFixture
+		(
+			const Uint64	BudgetBytes,
+			const bool		Immediate = true
+		) :
+			Backend(&Streamer, Immediate)
+		{
+			CTextureStreamer::InitializeOptions Options;
+			{
+				Options.BudgetBytes		= BudgetBytes;
+				Options.Backend			= &Backend;
+				Options.MinResidentSize	= 64;
+				Options.EvictionDelay	= 4;
+			}
+
+			CHECK(Streamer.Initialize(Options) == S_OK);
+		}
+
+		TextureStreamingHandle Register()
+		{
+			const TextureStreamingHandle Handle = Streamer.Register(CreateDesc());
+			{
+				CHECK(Handle != InvalidTextureStreamingHandle);
+			}
+
+			return Handle;
+		}
+
+		// Loads of the immediate backend are applied with the next update.
+
+		void Update(const Uint32 Count = 1)
+		{
+			for (Uint32 N = 0; N < Count; ++N)
+			{
+				Streamer.Update();
+
+				const TextureStreamingStats & Stats = Streamer.GetStats();
+				{
+					CHECK(Stats.ResidentBytes + Stats.PendingBytes <= std::max(Stats.BudgetBytes, Stats.PinnedBytes));
+				}
+			}
+		}
+	};
+}
+
+TEST_CASE(PinnedMipsLoadWithoutRequest)
+{
+	CStreamingFixture Fixture(0);
+
+	const TextureStreamingHandle Handle = Fixture.Register();
+
+	// The mips from 64 texels down are pinned, even without any budget.
+
+	CHECK(Fixture.Streamer.GetMinResidentMip(Handle) == 2);
+	CHECK(Fixture.Streamer.GetResidentMip(Handle) == MipLevels);
+
+	Fixture.Streamer.RequestMip(Handle, 0);
+	Fixture.Update(2);
+
+	CHECK(Fixture.Streamer.GetResidentMip(Handle) == 2);
+	CHECK(Fixture.Streamer.GetStats().ResidentBytes == GetTailBytes(2));
+}
+
+TEST_CASE(FinestRequestWins)
+{
+	CStreamingFixture Fixture(GetTailBytes(0));
+
+	const TextureStreamingHandle Handle = Fixture.Register();
+
+	Fixture.Update(2);
+
+	Fixture.Streamer.RequestMip(Handle, 1);
+	Fixture.Streamer.RequestScreenSize(Handle, static_cast<Float>(TextureSize));
+	Fixture.Streamer.RequestMip(Handle, 3);
+	Fixture.Update(2);
+
+	CHECK(Fixture.Streamer.GetResidentMip(Handle) == 0);
+}
+
+TEST_CASE(BudgetLimitsResidency)
+{
+	// Room for the pinned mips of both textures and the full chain of one.
+
+	CStreamingFixture Fixture(GetTailBytes(0) + GetTailBytes(2));
+
+	const TextureStreamingHandle Near	= Fixture.Register();
+	const TextureStreamingHandle Far	= Fixture.Register();
+
+	Fixture.Update(2);
+
+	for (Uint32 Frame = 0; Frame < 3; ++Frame)
+	{
+		Fixture.Streamer.RequestScreenSize(Near, 256.0f);
+		Fixture.Streamer.RequestScreenSize(Far, 200.0f);
+		Fixture.Update();
+	}
+
+	CHECK(Fixture.Streamer.GetResidentMip(Near) == 0);
+	CHECK(Fixture.Streamer.GetResidentMip(Far) == 2);
+	CHECK(Fixture.Streamer.GetStats().NumDeferred > 0);
+}
+
+TEST_CASE(LowerPriorityIsDemoted)
+{
+	CStreamingFixture Fixture(GetTailBytes(0) + GetTailBytes(2));
+
+	const TextureStreamingHandle Near	= Fixture.Register();
+	const TextureStreamingHandle Far	= Fixture.Register();
+
+	Fixture.Update(2);
+
+	Fixture.Streamer.RequestScreenSize(Far, 256.0f);
+	Fixture.Update(2);
+
+	CHECK(Fixture.Streamer.GetResidentMip(Far) == 0);
+
+	// The other texture comes closer while the first keeps being requested.
+
+	for (Uint32 Frame = 0; Frame < 3; ++Frame)
+	{
+		Fixture.Streamer.RequestScreenSize(Near, 512.0f);
+		Fixture.Streamer.RequestScreenSize(Far, 128.0f);
+		Fixture.Update();
+	}
+
+	CHECK(Fixture.Streamer.GetResidentMip(Near) == 0);
+	CHECK(Fixture.Streamer.GetResidentMip(Far) == Fixture.Streamer.GetMinResidentMip(Far));
+	CHECK(Fixture.Streamer.GetStats().NumEvictions > 0);
+}
+
+TEST_CASE(UnrequestedMipsEvictedAfterDelay)
+{
+	CStreamingFixture Fixture(GetTailBytes(0) + GetTailBytes(2));
+
+	const TextureStreamingHandle Old = Fixture.Register();
+	const TextureStreamingHandle New = Fixture.Register();
+
+	Fixture.Update(2);
+
+	Fixture.Streamer.RequestScreenSize(Old, 256.0f);
+	Fixture.Update(2);
+
+	CHECK(Fixture.Streamer.GetResidentMip(Old) == 0);
+
+	// A smaller request cannot take the memory while the first one is recent.
+
+	Fixture.Streamer.RequestScreenSize(New, 64.0f);
+	Fixture.Update(2);
+
+	CHECK(Fixture.Streamer.GetResidentMip(Old) == 0);
+	CHECK(Fixture.Streamer.GetResidentMip(New) == 2);
+
+	for (Uint32 Frame = 0; Frame < 6; ++Frame)
+	{
+		Fixture.Streamer.RequestScreenSize(New, 200.0f);
+		Fixture.Update();
+	}
+
+	CHECK(Fixture.Streamer.GetResidentMip(Old) == Fixture.Streamer.GetMinResidentMip(Old));
+	CHECK(Fixture.Streamer.GetResidentMip(New) == 0);
+}
+
+TEST_CASE(DeferredLoadsCompleteOnUpdate)
+{
+	CStreamingFixture Fixture(GetTailBytes(0), false);
+
+	const TextureStreamingHandle Handle = Fixture.Register();
+
+	Fixture.Update();
+
+	CHECK(Fixture.Streamer.IsPending(Handle));
+	CHECK(Fixture.Backend.GetNumPending() == 1);
+
+	Fixture.Backend.Complete();
+	Fixture.Update();
+
+	CHECK(Fixture.Streamer.GetResidentMip(Handle) == 2);
+
+	// A failed load leaves the resident mips as they were.
+
+	Fixture.Streamer.RequestMip(Handle, 0);
+	Fixture.Update();
+
+	CHECK(Fixture.Streamer.IsPending(Handle));
+	CHECK(Fixture.Streamer.GetStats().PendingBytes == GetTailBytes(0) - GetTailBytes(2));
+
+	Fixture.Backend.Complete(false);
+	Fixture.Update();
+
+	CHECK(Fixture.Streamer.GetResidentMip(Handle) == 2);
+	CHECK(Fixture.Streamer.GetStats().NumFailedLoads == 1);
+	CHECK(Fixture.Streamer.GetStats().PendingBytes > 0);
+}